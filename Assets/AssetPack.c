@@ -0,0 +1,281 @@
+#include "AssetPack.h"
+#include "Telemetry.h"
+#include <string.h>
+
+/**
+ * @file AssetPack.c
+ * @brief Asset pack checks and lookups
+ *
+ * The header and index are read as the structs they were written as: the
+ * pack is little-endian and 4-byte aligned, like the core, so nothing needs
+ * converting. Lookups are a linear search of the index, which is a handful
+ * of entries; look each asset up once and keep the result. An external
+ * pack goes through the same checks, with its index copied into RAM and
+ * its payloads read through pack->read.
+ */
+
+// Header fields (see AssetPack.h)
+#define HEADER_MAGIC   0
+#define HEADER_VERSION 4
+#define HEADER_BPP     6
+#define HEADER_COUNT   8
+#define HEADER_CRC     10
+#define HEADER_SIZE    12
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+// The payload size an entry of its type and dimensions must have (0: any)
+static uint32_t expected_size(const AssetPack_Entry_t* entry) {
+    switch (entry->type) {
+        case ASSETPACK_SPRITE:
+            return LCD_SPRITE_BAKED_SIZE((uint32_t)entry->height, (uint32_t)entry->width);
+        case ASSETPACK_PALETTE:
+            return 16u * sizeof(uint16_t);
+        case ASSETPACK_FONT:
+            return ASSETPACK_FONT_BYTES;
+        default:
+            return 0;
+    }
+}
+
+// Bytes of the pack, where it lies or through its read function
+static uint8_t read_pack(const AssetPack_t* pack, uint32_t offset, void* buffer, uint32_t length) {
+    if (pack->read != NULL) {
+        return pack->read(pack->read_context, offset, buffer, length);
+    }
+    memcpy(buffer, pack->base + offset, length);
+    return 1;
+}
+
+// Whether a payload matches its CRC; an external one is read a block at a time
+static uint8_t payload_ok(const AssetPack_t* pack, const AssetPack_Entry_t* entry) {
+    if (pack->read == NULL) {
+        return Telemetry_CRC16(pack->base + entry->offset, (uint16_t)entry->size) == entry->crc;
+    }
+    uint8_t block[64];
+    uint16_t crc = 0xFFFF;
+    for (uint32_t done = 0; done < entry->size; ) {
+        uint32_t piece = entry->size - done;
+        if (piece > sizeof(block)) {
+            piece = sizeof(block);
+        }
+        if (!pack->read(pack->read_context, entry->offset + done, block, piece)) {
+            return 0;
+        }
+        crc = Telemetry_CRC16_Update(crc, block, (uint16_t)piece);
+        done += piece;
+    }
+    return crc == entry->crc;
+}
+
+static uint8_t entry_ok(const AssetPack_t* pack, const AssetPack_Entry_t* entry, uint32_t first, uint32_t size) {
+    if ((entry->offset & 3u) != 0 || entry->offset < first ||
+        entry->offset > size || entry->size > size - entry->offset || entry->size > 0xFFFFu) {
+        return 0;
+    }
+    if (memchr(entry->name, 0, ASSETPACK_NAME_LENGTH) == NULL) {
+        return 0;
+    }
+    uint32_t expected = expected_size(entry);
+    if (expected != 0 && entry->size != expected) {
+        return 0;
+    }
+    if (entry->type == ASSETPACK_PALETTE && entry->width != 16) {
+        return 0;
+    }
+    return payload_ok(pack, entry);
+}
+
+static void close_pack(AssetPack_t* pack) {
+    pack->base = NULL;
+    pack->entries = NULL;
+    pack->count = 0;
+    pack->size = 0;
+    pack->read = NULL;
+    pack->read_context = NULL;
+}
+
+// The header's checks; gives its entry count and pack size
+static uint8_t header_ok(const uint8_t* header, uint16_t* count, uint32_t* size) {
+    if (get32(header + HEADER_MAGIC) != ASSETPACK_MAGIC ||
+        get16(header + HEADER_VERSION) != ASSETPACK_VERSION ||
+        header[HEADER_BPP] != LCD_BITS_PER_PIXEL || header[HEADER_BPP + 1] != 0) {
+        return 0;
+    }
+    *count = get16(header + HEADER_COUNT);
+    *size = get32(header + HEADER_SIZE);
+    uint32_t index_bytes = (uint32_t)*count * sizeof(AssetPack_Entry_t);
+    return *size >= ASSETPACK_HEADER_BYTES + index_bytes && index_bytes <= 0xFFFFu;
+}
+
+// The index's and payloads' checks, with pack->base or pack->read set; opens the pack if they pass
+static uint8_t index_ok(AssetPack_t* pack, const uint8_t* header, const AssetPack_Entry_t* entries,
+                        uint16_t count, uint32_t size) {
+    uint32_t index_bytes = (uint32_t)count * sizeof(AssetPack_Entry_t);
+    if (Telemetry_CRC16((const uint8_t*)entries, (uint16_t)index_bytes) != get16(header + HEADER_CRC)) {
+        return 0;
+    }
+
+    // The pack ends with the last payload, padded to 4 bytes
+    uint32_t end = ASSETPACK_HEADER_BYTES + index_bytes;
+    for (uint16_t i = 0; i < count; i++) {
+        if (!entry_ok(pack, &entries[i], ASSETPACK_HEADER_BYTES + index_bytes, size)) {
+            return 0;
+        }
+        uint32_t payload_end = entries[i].offset + ((entries[i].size + 3u) & ~3u);
+        if (payload_end > end) {
+            end = payload_end;
+        }
+    }
+    if (end != size) {
+        return 0;
+    }
+
+    pack->entries = entries;
+    pack->count = count;
+    pack->size = size;
+    return 1;
+}
+
+uint8_t AssetPack_Open(AssetPack_t* pack, const uint8_t* base) {
+    close_pack(pack);
+    uint16_t count;
+    uint32_t size;
+    if (base == NULL || ((uintptr_t)base & 3u) != 0 || !header_ok(base, &count, &size)) {
+        return 0;
+    }
+    pack->base = base;
+    if (!index_ok(pack, base, (const AssetPack_Entry_t*)(base + ASSETPACK_HEADER_BYTES), count, size)) {
+        close_pack(pack);
+        return 0;
+    }
+    return 1;
+}
+
+uint8_t AssetPack_Open_External(AssetPack_t* pack, AssetPack_Read_t read, void* context,
+                                AssetPack_Entry_t* index, uint16_t max_entries) {
+    close_pack(pack);
+    uint8_t header[ASSETPACK_HEADER_BYTES];
+    uint16_t count;
+    uint32_t size;
+    if (read == NULL || !read(context, 0, header, sizeof(header)) || !header_ok(header, &count, &size) ||
+        count > max_entries ||
+        !read(context, ASSETPACK_HEADER_BYTES, index, (uint32_t)count * sizeof(AssetPack_Entry_t))) {
+        return 0;
+    }
+    pack->read = read;
+    pack->read_context = context;
+    if (!index_ok(pack, header, index, count, size)) {
+        close_pack(pack);
+        return 0;
+    }
+    return 1;
+}
+
+const AssetPack_Entry_t* AssetPack_Find(const AssetPack_t* pack, const char* name, AssetPack_Type_t type) {
+    for (uint16_t i = 0; i < pack->count; i++) {
+        const AssetPack_Entry_t* entry = &pack->entries[i];
+        if (entry->type == type && strncmp(entry->name, name, ASSETPACK_NAME_LENGTH) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+const uint8_t* AssetPack_Data(const AssetPack_t* pack, const AssetPack_Entry_t* entry) {
+    return (pack->base != NULL) ? pack->base + entry->offset : NULL;
+}
+
+uint8_t AssetPack_Load(const AssetPack_t* pack, const AssetPack_Entry_t* entry, void* buffer, uint32_t max) {
+    if (entry->size > max) {
+        return 0;
+    }
+    return read_pack(pack, entry->offset, buffer, entry->size);
+}
+
+uint8_t AssetPack_Stream_Open(AssetPack_Stream_t* stream, const AssetPack_t* pack, const AssetPack_Entry_t* entry) {
+    stream->pack = pack;
+    stream->entry = entry;
+    stream->pos = 0;
+    return entry != NULL;
+}
+
+uint32_t AssetPack_Stream_Read(void* stream, uint8_t* buffer, uint32_t max) {
+    AssetPack_Stream_t* s = (AssetPack_Stream_t*)stream;
+    if (s->entry == NULL) {
+        return 0;
+    }
+    uint32_t piece = s->entry->size - s->pos;
+    if (piece > max) {
+        piece = max;
+    }
+    if (piece == 0 || !read_pack(s->pack, s->entry->offset + s->pos, buffer, piece)) {
+        return 0;
+    }
+    s->pos += piece;
+    return piece;
+}
+
+uint8_t AssetPack_Sprite(const AssetPack_t* pack, const char* name, LCD_Sprite* sprite) {
+    const AssetPack_Entry_t* entry = AssetPack_Find(pack, name, ASSETPACK_SPRITE);
+    if (entry == NULL || pack->base == NULL) {
+        return 0;
+    }
+    sprite->nrows = entry->height;
+    sprite->ncols = entry->width;
+    sprite->stride = LCD_SPRITE_STRIDE(entry->width);
+    sprite->mask_stride = LCD_SPRITE_MASK_STRIDE(entry->width);
+    sprite->data = AssetPack_Data(pack, entry);
+    return 1;
+}
+
+const uint16_t* AssetPack_Palette(const AssetPack_t* pack, const char* name) {
+    const AssetPack_Entry_t* entry = AssetPack_Find(pack, name, ASSETPACK_PALETTE);
+    return (entry != NULL) ? (const uint16_t*)AssetPack_Data(pack, entry) : NULL;  // NULL for an external pack
+}
+
+const uint8_t* AssetPack_Font(const AssetPack_t* pack, const char* name) {
+    const AssetPack_Entry_t* entry = AssetPack_Find(pack, name, ASSETPACK_FONT);
+    return (entry != NULL) ? AssetPack_Data(pack, entry) : NULL;
+}
+
+const uint8_t* AssetPack_Image(const AssetPack_t* pack, const char* name, uint32_t* length) {
+    const AssetPack_Entry_t* entry = AssetPack_Find(pack, name, ASSETPACK_IMAGE);
+    if (entry == NULL || pack->base == NULL) {
+        return NULL;
+    }
+    *length = entry->size;
+    return AssetPack_Data(pack, entry);
+}
+
+uint8_t AssetPack_Atlas(const AssetPack_t* pack, const char* name, LCD_Font* font) {
+    const AssetPack_Entry_t* entry = AssetPack_Find(pack, name, ASSETPACK_ATLAS);
+    if (entry == NULL || pack->base == NULL) {
+        return 0;
+    }
+    const uint8_t* data = AssetPack_Data(pack, entry);
+    const uint32_t records = ASSETPACK_ATLAS_HEADER_BYTES + (uint32_t)data[1] * sizeof(LCD_Font_Glyph);
+    if (entry->size < records || data[1] != entry->width || data[2] != entry->height) {
+        return 0;
+    }
+    const LCD_Font_Glyph* glyphs = (const LCD_Font_Glyph*)(data + ASSETPACK_ATLAS_HEADER_BYTES);
+    const uint32_t bitmap_bytes = entry->size - records;
+    for (uint8_t i = 0; i < data[1]; i++) {
+        const uint32_t bytes = (uint32_t)glyphs[i].rows * ((glyphs[i].width + 1u) >> 1);
+        if (glyphs[i].offset > bitmap_bytes || bytes > bitmap_bytes - glyphs[i].offset) {
+            return 0;
+        }
+    }
+    font->first = data[0];
+    font->count = data[1];
+    font->height = data[2];
+    font->glyphs = glyphs;
+    font->bitmaps = data + records;
+    return 1;
+}
@@ -0,0 +1,276 @@
+/**
+ * @file AssetPack.h
+ * @brief Sprites, palettes, fonts and images read straight from a packed blob in flash
+ *
+ * An asset pack is one block of bytes built on the PC by make_asset_pack.py
+ * from PNG files: a header, an index of named entries and the payloads, each
+ * starting on a 4-byte boundary. Nothing is unpacked or copied to RAM; the
+ * pack is either linked into the program (the tool can write it out as a C
+ * array) or flashed on its own at a fixed address, and every asset is used
+ * where it lies:
+ *
+ * - SPRITE: already in the LCD_Sprite layout LCD_Bake_Sprite() makes at
+ *   run time (4bpp pixels, both x phases, 1bpp transparency mask), so
+ *   AssetPack_Sprite() only points an LCD_Sprite at it for
+ *   LCD_Draw_Baked_Sprite().
+ * - PALETTE: 16 RGB565 colours, byte-swapped like the RGB565_* definitions,
+ *   for LCD_Set_Palette_Colours().
+ * - FONT: 96 glyphs of 5 column bytes, as font5x7_, for LCD_Set_Font().
+ * - IMAGE: a compressed full-colour picture (LCD_Image.h) for LCD_Show_Image().
+ * - ATLAS: a proportional font rendered at one size, 4-bit coverage glyphs
+ *   (LCD_Font) for LCD_Print_Font(): the first character code, the count and
+ *   the line height, a 0, then an LCD_Font_Glyph for each character and the
+ *   glyph bitmaps.
+ * - RAW: anything else, as the bytes it was built from.
+ *
+ * **Layout** (little-endian, as the core reads it):
+ * - Header, 16 bytes: magic "APK1", version (2 bytes), sprite bits per
+ *   pixel, 0, entry count (2), CRC-16 of the index (2), pack size (4).
+ * - Index: one AssetPack_Entry_t (32 bytes) per asset, with the CRC-16 of
+ *   its payload.
+ * - Payloads, at the offsets in the index.
+ *
+ * AssetPack_Open() checks all of it once (a few ms for tens of KB), so
+ * erased flash (0xFF) or a half-written pack is turned down rather than drawn.
+ * The sprites must have been built for this build's LCD_BITS_PER_PIXEL.
+ *
+ * A pack too big for the internal flash can sit on an external one
+ * (ExtFlash.h), which is not in the address space: AssetPack_Open_External()
+ * reads the header and index into RAM through a read function and checks the
+ * payloads a block at a time. The payloads stay where they are, so
+ * AssetPack_Data() and the lookups built on it find nothing; AssetPack_Load()
+ * copies one into RAM, and an AssetPack_Stream_t hands one to
+ * LCD_Show_Image_Stream() a window at a time. Both also work on an in-place
+ * pack.
+ *
+ * Example usage:
+ * @code
+ * // Flashed with: STM32_Programmer_CLI -c port=SWD -w pack.bin 0x08060000
+ * AssetPack_t pack;
+ * if (AssetPack_Open(&pack, (const uint8_t*)0x08060000)) {
+ *     LCD_Sprite logo;
+ *     if (AssetPack_Sprite(&pack, "logo", &logo)) {
+ *         LCD_Draw_Baked_Sprite(40, 100, &logo);
+ *     }
+ * }
+ *
+ * // On an external flash, reading the splash image as it is drawn
+ * static AssetPack_Entry_t index[16];
+ * if (AssetPack_Open_External(&pack, read_flash, &ext_flash, index, 16)) {
+ *     const AssetPack_Entry_t* splash = AssetPack_Find(&pack, "splash", ASSETPACK_IMAGE);
+ *     AssetPack_Stream_t stream;
+ *     static uint8_t window[LCD_IMAGE_WINDOW_BYTES(240)];
+ *     if (splash != NULL && AssetPack_Stream_Open(&stream, &pack, splash)) {
+ *         LCD_Show_Image_Stream(&cfg0, 0, 0, AssetPack_Stream_Read, &stream, window, sizeof(window));
+ *     }
+ * }
+ * @endcode
+ */
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <stdint.h>
+#include "LCD.h"
+
+#define ASSETPACK_MAGIC 0x314B5041u  // "APK1"
+#define ASSETPACK_VERSION 1
+#define ASSETPACK_HEADER_BYTES 16
+#define ASSETPACK_NAME_LENGTH 16     // Including the terminating 0
+
+// Payload bytes of the built-in font layout: 96 characters (32-127), 5 columns each
+#define ASSETPACK_FONT_BYTES 480
+
+// Bytes of an atlas font before its glyph records (first, count, height, 0)
+#define ASSETPACK_ATLAS_HEADER_BYTES 4
+
+/**
+ * @enum AssetPack_Type_t
+ * @brief What an entry's payload is
+ */
+typedef enum {
+    ASSETPACK_RAW = 0,      ///< Bytes as given
+    ASSETPACK_SPRITE = 1,   ///< Baked sprite, width x height pixels
+    ASSETPACK_PALETTE = 2,  ///< width RGB565 colours (16)
+    ASSETPACK_FONT = 3,     ///< 5x7 font, font5x7_ layout
+    ASSETPACK_IMAGE = 4,    ///< Compressed full-colour image (LCD_Image.h), width x height pixels
+    ASSETPACK_ATLAS = 5     ///< Atlas font (LCD_Font), width characters, height pixels a line
+} AssetPack_Type_t;
+
+/**
+ * @struct AssetPack_Entry_t
+ * @brief One index entry, as stored in the pack
+ */
+typedef struct {
+    char name[ASSETPACK_NAME_LENGTH];  // 0-terminated
+    uint8_t type;                      // AssetPack_Type_t
+    uint8_t reserved;
+    uint16_t crc;                      // Telemetry_CRC16() of the payload
+    uint16_t width;                    // Sprite/image columns, palette colours, font glyph width, atlas characters...
+    uint16_t height;                   // ...sprite/image rows, font glyph height, atlas line height
+    uint32_t offset;                   // Payload start from the start of the pack (multiple of 4)
+    uint32_t size;                     // Payload bytes
+} AssetPack_Entry_t;
+
+/**
+ * @brief Reads bytes of a pack that is not in the address space (e.g. ExtFlash_Read())
+ *
+ * @param context As given to AssetPack_Open_External()
+ * @param offset First byte, from the start of the pack
+ * @param buffer Where the bytes go
+ * @param length Bytes to read
+ * @return 1 if read, 0 if not
+ */
+typedef uint8_t (*AssetPack_Read_t)(void* context, uint32_t offset, void* buffer, uint32_t length);
+
+/**
+ * @struct AssetPack_t
+ * @brief An opened pack (nothing but pointers into it)
+ */
+typedef struct {
+    const uint8_t* base;               // Start of the pack, NULL if it did not open or is external
+    const AssetPack_Entry_t* entries;  // Index
+    uint16_t count;                    // Entries in the index
+    uint32_t size;                     // Pack bytes
+    AssetPack_Read_t read;             // External packs: how to read it, NULL for one in place
+    void* read_context;                // Its context
+} AssetPack_t;
+
+/**
+ * @struct AssetPack_Stream_t
+ * @brief Where reading a payload out of a pack is up to (AssetPack_Stream_Read())
+ */
+typedef struct {
+    const AssetPack_t* pack;
+    const AssetPack_Entry_t* entry;
+    uint32_t pos;                      // Payload bytes read so far
+} AssetPack_Stream_t;
+
+/**
+ * @brief Check a pack and get ready to look assets up in it
+ *
+ * @param pack Pointer to pack handle
+ * @param base Start of the pack (4-byte aligned), in flash or RAM; it must stay there
+ * @return 1 if the pack is good, 0 if not (bad magic, version, bits per pixel,
+ *         layout or CRC); lookups then find nothing
+ */
+uint8_t AssetPack_Open(AssetPack_t* pack, const uint8_t* base);
+
+/**
+ * @brief Check a pack outside the address space and read its index into RAM
+ *
+ * Makes the same checks as AssetPack_Open(), reading every payload once for
+ * its CRC (about 5ms per 100KB at 20MHz SPI).
+ *
+ * @param pack Pointer to pack handle
+ * @param read Reads bytes of the pack; it is kept for AssetPack_Load() and streams
+ * @param context Passed to read
+ * @param index Room for the index; it must stay there
+ * @param max_entries Entries index has room for
+ * @return 1 if the pack is good, 0 if not (as AssetPack_Open(), or a read failed,
+ *         or the index does not fit)
+ */
+uint8_t AssetPack_Open_External(AssetPack_t* pack, AssetPack_Read_t read, void* context,
+                                AssetPack_Entry_t* index, uint16_t max_entries);
+
+/**
+ * @brief Find an asset by name
+ *
+ * @param pack Pointer to pack handle
+ * @param name Asset name (the PNG's file name without .png, unless the tool was given another)
+ * @param type Type it must be
+ * @return Its index entry, or NULL if there is no such asset of that type
+ */
+const AssetPack_Entry_t* AssetPack_Find(const AssetPack_t* pack, const char* name, AssetPack_Type_t type);
+
+/**
+ * @brief Get an entry's payload
+ *
+ * @param pack Pointer to pack handle
+ * @param entry Entry from AssetPack_Find()
+ * @return Pointer to the first payload byte, in the pack, or NULL for an external pack
+ */
+const uint8_t* AssetPack_Data(const AssetPack_t* pack, const AssetPack_Entry_t* entry);
+
+/**
+ * @brief Copy an entry's payload into RAM, from either kind of pack
+ *
+ * @param pack Pointer to pack handle
+ * @param entry Entry from AssetPack_Find()
+ * @param buffer Where the payload goes
+ * @param max Bytes buffer has room for
+ * @return 1 if copied, 0 if it does not fit or the read failed
+ */
+uint8_t AssetPack_Load(const AssetPack_t* pack, const AssetPack_Entry_t* entry, void* buffer, uint32_t max);
+
+/**
+ * @brief Get ready to read an entry's payload a piece at a time
+ *
+ * @param stream Stream to set up
+ * @param pack Pointer to pack handle
+ * @param entry Entry from AssetPack_Find()
+ * @return 1 (0 if entry is NULL)
+ */
+uint8_t AssetPack_Stream_Open(AssetPack_Stream_t* stream, const AssetPack_t* pack, const AssetPack_Entry_t* entry);
+
+/**
+ * @brief Read the next piece of a payload, as an LCD_Image_Reader (LCD_Show_Image_Stream())
+ *
+ * @param stream AssetPack_Stream_t from AssetPack_Stream_Open()
+ * @param buffer Where the bytes go
+ * @param max Most bytes to read
+ * @return Bytes read, 0 at the end of the payload or if a read failed
+ */
+uint32_t AssetPack_Stream_Read(void* stream, uint8_t* buffer, uint32_t max);
+
+/**
+ * @brief Set up a sprite for LCD_Draw_Baked_Sprite() that reads the pack in place
+ *
+ * @param pack Pointer to pack handle
+ * @param name Sprite name
+ * @param sprite Sprite to fill in (its data points into the pack)
+ * @return 1 if found, 0 if not or the pack is external (sprite unchanged)
+ */
+uint8_t AssetPack_Sprite(const AssetPack_t* pack, const char* name, LCD_Sprite* sprite);
+
+/**
+ * @brief Get a palette's colours, for LCD_Set_Palette_Colours()
+ *
+ * @param pack Pointer to pack handle
+ * @param name Palette name
+ * @return The 16 colours in the pack, or NULL if not found or the pack is external
+ */
+const uint16_t* AssetPack_Palette(const AssetPack_t* pack, const char* name);
+
+/**
+ * @brief Get a font's glyphs, for LCD_Set_Font()
+ *
+ * @param pack Pointer to pack handle
+ * @param name Font name
+ * @return The ASSETPACK_FONT_BYTES glyph bytes in the pack, or NULL if not found or the pack is external
+ */
+const uint8_t* AssetPack_Font(const AssetPack_t* pack, const char* name);
+
+/**
+ * @brief Get a compressed image, for LCD_Show_Image()
+ *
+ * @param pack Pointer to pack handle
+ * @param name Image name
+ * @param length Set to the image's bytes
+ * @return The image in the pack, or NULL if not found or the pack is external
+ */
+const uint8_t* AssetPack_Image(const AssetPack_t* pack, const char* name, uint32_t* length);
+
+/**
+ * @brief Set up an atlas font for LCD_Print_Font() that reads the pack in place
+ *
+ * Every glyph's bitmap is checked to lie inside the payload.
+ *
+ * @param pack Pointer to pack handle
+ * @param name Font name
+ * @param font Font to fill in (its glyphs and bitmaps point into the pack)
+ * @return 1 if found and good, 0 if not or the pack is external (font unchanged)
+ */
+uint8_t AssetPack_Atlas(const AssetPack_t* pack, const char* name, LCD_Font* font);
+
+#endif // ASSETPACK_H
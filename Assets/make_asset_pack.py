@@ -0,0 +1,645 @@
+#!/usr/bin/env python3
+"""Build an asset pack (see AssetPack.h) from PNG files.
+
+Sprites are mapped to the nearest colour of the pack's palette (the
+default LCD palette if it has none) and baked the way LCD_Bake_Sprite()
+bakes them, so the board draws them straight from flash. Pixels with
+alpha below 128 are transparent.
+
+    python3 make_asset_pack.py -o pack.bin logo.png --palette palette.png
+    python3 make_asset_pack.py -o pack.bin --font font=font.png ball=art/ball_6x6.png
+    python3 make_asset_pack.py --c-array pong_assets -o pong_assets.c logo.png
+    python3 make_asset_pack.py -o pack.bin --image splash=splash.png
+    python3 make_asset_pack.py -o pack.bin --atlas title=DejaVuSans-Bold.ttf:32
+
+Assets are named after their file (logo.png is "logo") unless given as
+name=path. A palette PNG is read as its first 16 pixels, left to right and
+top to bottom. A font PNG is a sheet of the 96 characters from space to
+DEL, 16 to a row in cells of 6x8 pixels with the glyph's 5x7 in the
+top-left corner; any pixel brighter than mid grey is lit. An image is kept
+in full colour (RGB565) and compressed as LCD_Image.h describes, for
+LCD_Show_Image(); it is opaque, alpha is ignored.
+
+An atlas font is rendered here from a TrueType font's outlines, at a line
+height in pixels (font.ttf:size), into glyphs of 4-bit coverage for
+LCD_Print_Font(): characters space to ~, each as wide as it is drawn.
+
+Flash a .bin at the address the game opens it from (PONG_ASSET_PACK_ADDRESS):
+
+    STM32_Programmer_CLI -c port=SWD -w pack.bin 0x08060000
+
+or write it as a C array with --c-array and add the .c file to the build.
+"""
+
+import argparse
+import binascii
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x314B5041  # "APK1"
+VERSION = 1
+HEADER_BYTES = 16
+ENTRY_BYTES = 32
+NAME_LENGTH = 16
+
+RAW, SPRITE, PALETTE, FONT, IMAGE, ATLAS = 0, 1, 2, 3, 4, 5
+KIND_NAMES = ("raw", "sprite", "palette", "font", "image", "atlas")
+TRANSPARENT = 255
+
+# palette_default in LCD.c, byte-swapped RGB565 like the RGB565_* definitions
+DEFAULT_PALETTE = [
+    0x0000, 0xFFFF, 0x00F8, 0xE007, 0x1F00, 0x20FD, 0xE0FF, 0x18FC,
+    0x0F78, 0x0F00, 0xA0FE, 0x5C91, 0x45A1, 0x1084, 0xFF07, 0x1FF8,
+]
+
+
+def read_png(path):
+    """Return (width, height, rows of (r, g, b, a) pixels) of a non-interlaced PNG."""
+    with open(path, "rb") as png:
+        data = png.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError("%s: not a PNG file" % path)
+
+    chunks = {}
+    idat = b""
+    pos = 8
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        if kind == b"IDAT":
+            idat += body
+        else:
+            chunks.setdefault(kind, body)
+        pos += 12 + length
+
+    width, height, depth, colour_type, _, _, interlace = struct.unpack(">IIBBBBB", chunks[b"IHDR"])
+    if interlace:
+        raise ValueError("%s: interlaced PNGs are not supported" % path)
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[colour_type]
+    if depth != 8 and colour_type != 3:
+        raise ValueError("%s: only 8 bits per channel are supported" % path)
+
+    bits_per_pixel = channels * depth
+    stride = (width * bits_per_pixel + 7) // 8
+    step = max(1, bits_per_pixel // 8)
+    raw = zlib.decompress(idat)
+
+    # Undo the row filters
+    rows = []
+    previous = bytearray(stride)
+    for y in range(height):
+        line = raw[y * (stride + 1):(y + 1) * (stride + 1)]
+        kind = line[0]
+        row = bytearray(line[1:])
+        for i in range(stride):
+            left = row[i - step] if i >= step else 0
+            up = previous[i]
+            up_left = previous[i - step] if i >= step else 0
+            if kind == 1:
+                row[i] = (row[i] + left) & 0xFF
+            elif kind == 2:
+                row[i] = (row[i] + up) & 0xFF
+            elif kind == 3:
+                row[i] = (row[i] + (left + up) // 2) & 0xFF
+            elif kind == 4:
+                p = left + up - up_left
+                pa, pb, pc = abs(p - left), abs(p - up), abs(p - up_left)
+                predictor = left if pa <= pb and pa <= pc else (up if pb <= pc else up_left)
+                row[i] = (row[i] + predictor) & 0xFF
+        rows.append(row)
+        previous = row
+
+    plte = chunks.get(b"PLTE", b"")
+    trns = chunks.get(b"tRNS", b"")
+    pixels = []
+    for row in rows:
+        out = []
+        for x in range(width):
+            if colour_type == 3:
+                index = (row[x * depth // 8] >> (8 - depth - (x * depth) % 8)) & ((1 << depth) - 1)
+                r, g, b = plte[3 * index:3 * index + 3]
+                a = trns[index] if index < len(trns) else 255
+            else:
+                p = row[x * channels:(x + 1) * channels]
+                if colour_type == 0:
+                    r = g = b = p[0]
+                    a = 255
+                elif colour_type == 4:
+                    r = g = b = p[0]
+                    a = p[1]
+                elif colour_type == 2:
+                    r, g, b = p
+                    a = 255
+                else:
+                    r, g, b, a = p
+            out.append((r, g, b, a))
+        pixels.append(out)
+    return width, height, pixels
+
+
+def rgb565_swapped(r, g, b):
+    """An RGB565 colour byte-swapped like the RGB565_* definitions."""
+    colour = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+    return ((colour >> 8) | (colour << 8)) & 0xFFFF
+
+
+def rgb_of(swapped):
+    colour = ((swapped >> 8) | (swapped << 8)) & 0xFFFF
+    r, g, b = colour >> 11, (colour >> 5) & 0x3F, colour & 0x1F
+    return (r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2)
+
+
+def nearest(palette_rgb, r, g, b):
+    return min(range(len(palette_rgb)),
+               key=lambda i: (palette_rgb[i][0] - r) ** 2 + (palette_rgb[i][1] - g) ** 2
+               + (palette_rgb[i][2] - b) ** 2)
+
+
+def bake_sprite(indices, width, height, bpp):
+    """Bytes of LCD_Bake_Sprite()'s layout for rows of colour indices (TRANSPARENT: none)."""
+    phases = 1 if bpp == 8 else 2
+    stride = width if bpp == 8 else (width + 2) // 2
+    mask_stride = ((8 // bpp) * stride + 7) // 8
+    out = bytearray(phases * height * (stride + mask_stride))
+    for phase in range(phases):
+        for i in range(height):
+            base = (phase * height + i) * (stride + mask_stride)
+            for j in range(width):
+                pixel = indices[i][j]
+                if pixel == TRANSPARENT:
+                    continue
+                n = phase + j
+                if bpp == 8:
+                    out[base + n] = pixel
+                else:
+                    out[base + (n >> 1)] |= (pixel & 0x0F) << (4 if n & 1 else 0)
+                out[base + stride + (n >> 3)] |= 1 << (n & 7)
+    return bytes(out)
+
+
+def make_palette(path):
+    width, height, pixels = read_png(path)
+    flat = [p for row in pixels for p in row]
+    if len(flat) < 16:
+        raise ValueError("%s: a palette needs 16 pixels, it has %d" % (path, len(flat)))
+    colours = [rgb565_swapped(r, g, b) for r, g, b, _ in flat[:16]]
+    return colours, struct.pack("<16H", *colours)
+
+
+def make_font(path):
+    width, height, pixels = read_png(path)
+    if width < 16 * 6 or height < 6 * 8:
+        raise ValueError("%s: a font sheet is 16x6 cells of 6x8 pixels (96x48)" % path)
+    out = bytearray()
+    for c in range(96):
+        cell_x, cell_y = (c % 16) * 6, (c // 16) * 8
+        for i in range(5):
+            column = 0
+            for j in range(7):
+                r, g, b, a = pixels[cell_y + j][cell_x + i]
+                if a >= 128 and r + g + b > 3 * 128:
+                    column |= 1 << j
+            out.append(column)
+    return bytes(out)
+
+
+def make_sprite(path, palette, bpp):
+    width, height, pixels = read_png(path)
+    palette_rgb = [rgb_of(c) for c in palette]
+    indices = [[TRANSPARENT if a < 128 else nearest(palette_rgb, r, g, b) for r, g, b, a in row]
+               for row in pixels]
+    return width, height, bake_sprite(indices, width, height, bpp)
+
+
+# LCD_Image.h
+IMAGE_MAGIC = 0x3149  # "I1"
+IMAGE_LITERAL, IMAGE_RUN, IMAGE_UP, IMAGE_DELTA = 0x00, 0x40, 0x80, 0xC0
+IMAGE_MAX_COUNT = 64
+
+
+def delta_byte(previous, pixel):
+    """The LCD_IMAGE_DELTA byte taking previous to pixel (native RGB565), or None if out of range."""
+    dr = (pixel >> 11) - (previous >> 11)
+    dg = ((pixel >> 5) & 0x3F) - ((previous >> 5) & 0x3F)
+    db = (pixel & 0x1F) - (previous & 0x1F)
+    if -4 <= dr <= 3 and -4 <= dg <= 3 and -2 <= db <= 1:
+        return ((dr + 4) << 5) | ((dg + 4) << 2) | (db + 2)
+    return None
+
+
+def compress_row(row, above):
+    """Packets for one row of native RGB565 pixels, given the row above (or None)."""
+    out = bytearray()
+    literal = []
+
+    def flush():
+        if literal:
+            out.append(IMAGE_LITERAL | (len(literal) - 1))
+            for pixel in literal:
+                out.extend(struct.pack("<H", pixel))
+            del literal[:]
+
+    x = 0
+    width = len(row)
+    while x < width:
+        limit = min(width, x + IMAGE_MAX_COUNT)
+        up = 0
+        if above is not None:
+            while x + up < limit and row[x + up] == above[x + up]:
+                up += 1
+        run = 1
+        while x + run < limit and row[x + run] == row[x]:
+            run += 1
+        deltas = []
+        if x > 0:
+            while x + len(deltas) < limit:
+                byte = delta_byte(row[x + len(deltas) - 1], row[x + len(deltas)])
+                if byte is None:
+                    break
+                deltas.append(byte)
+
+        # Cheapest bytes per pixel, a literal pixel costing 2
+        options = []
+        if up:
+            options.append((1.0 / up, IMAGE_UP, up))
+        if run > 1:
+            options.append((3.0 / run, IMAGE_RUN, run))
+        if len(deltas) > 1:
+            options.append(((1.0 + len(deltas)) / len(deltas), IMAGE_DELTA, len(deltas)))
+        best = min(options, key=lambda option: (option[0], -option[2])) if options else None
+        if best is None or best[0] >= 2.0:
+            literal.append(row[x])
+            if len(literal) == IMAGE_MAX_COUNT:
+                flush()
+            x += 1
+            continue
+
+        flush()
+        _, kind, count = best
+        out.append(kind | (count - 1))
+        if kind == IMAGE_RUN:
+            out.extend(struct.pack("<H", row[x]))
+        elif kind == IMAGE_DELTA:
+            out.extend(deltas)
+        x += count
+    flush()
+    return bytes(out)
+
+
+def make_image(path):
+    width, height, pixels = read_png(path)
+    rows = [[((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3) for r, g, b, _ in row] for row in pixels]
+    out = bytearray(struct.pack("<HHHH", IMAGE_MAGIC, width, height, 0))
+    for y, row in enumerate(rows):
+        out += compress_row(row, rows[y - 1] if y > 0 else None)
+    return width, height, bytes(out)
+
+
+# LCD_Font: characters of an atlas, and vertical samples per pixel when rendering one
+ATLAS_FIRST, ATLAS_LAST = 32, 126
+ATLAS_GLYPH_BYTES = 8
+ATLAS_SUBSAMPLES = 5
+CURVE_STEPS = 8
+
+
+class TrueType:
+    """Outlines and metrics of the glyphs of a TrueType (glyf) font."""
+
+    def __init__(self, path):
+        with open(path, "rb") as ttf:
+            self.data = ttf.read()
+        count = self.u16(4)
+        self.tables = {}
+        for i in range(count):
+            tag, _, offset, length = struct.unpack(">4sIII", self.data[12 + 16 * i:28 + 16 * i])
+            self.tables[tag] = offset
+        for tag in (b"head", b"hhea", b"hmtx", b"loca", b"glyf", b"cmap"):
+            if tag not in self.tables:
+                raise ValueError("%s: no %s table (only TrueType outlines are supported)" % (path, tag.decode()))
+        head, hhea = self.tables[b"head"], self.tables[b"hhea"]
+        self.units_per_em = self.u16(head + 18)
+        self.long_loca = self.s16(head + 50) != 0
+        self.ascent = self.s16(hhea + 4)
+        self.descent = self.s16(hhea + 6)
+        self.metrics = self.u16(hhea + 34)
+        self.cmap = self.find_cmap(path)
+
+    def u16(self, pos):
+        return struct.unpack(">H", self.data[pos:pos + 2])[0]
+
+    def s16(self, pos):
+        return struct.unpack(">h", self.data[pos:pos + 2])[0]
+
+    def find_cmap(self, path):
+        """Offset of the Unicode BMP (format 4) character map."""
+        cmap = self.tables[b"cmap"]
+        for i in range(self.u16(cmap + 2)):
+            platform, encoding = self.u16(cmap + 4 + 8 * i), self.u16(cmap + 6 + 8 * i)
+            offset = cmap + struct.unpack(">I", self.data[cmap + 8 + 8 * i:cmap + 12 + 8 * i])[0]
+            if (platform, encoding) in ((3, 1), (0, 3)) and self.u16(offset) == 4:
+                return offset
+        raise ValueError("%s: no Unicode character map" % path)
+
+    def glyph_index(self, code):
+        table = self.cmap
+        segments = self.u16(table + 6) // 2
+        ends, starts = table + 14, table + 16 + 2 * segments
+        deltas, ranges = starts + 2 * segments, starts + 4 * segments
+        for i in range(segments):
+            if self.u16(ends + 2 * i) < code:
+                continue
+            start = self.u16(starts + 2 * i)
+            if code < start:
+                return 0
+            delta, range_offset = self.s16(deltas + 2 * i), self.u16(ranges + 2 * i)
+            if range_offset == 0:
+                return (code + delta) & 0xFFFF
+            glyph = self.u16(ranges + 2 * i + range_offset + 2 * (code - start))
+            return (glyph + delta) & 0xFFFF if glyph else 0
+        return 0
+
+    def advance(self, glyph):
+        return self.u16(self.tables[b"hmtx"] + 4 * min(glyph, self.metrics - 1))
+
+    def glyph_offset(self, glyph):
+        loca = self.tables[b"loca"]
+        if self.long_loca:
+            start, end = struct.unpack(">II", self.data[loca + 4 * glyph:loca + 4 * glyph + 8])
+        else:
+            start, end = 2 * self.u16(loca + 2 * glyph), 2 * self.u16(loca + 2 * glyph + 2)
+        return (self.tables[b"glyf"] + start) if end > start else None
+
+    def contours(self, glyph, dx=0, dy=0):
+        """The glyph's contours in font units, as lists of (x, y, on_curve)."""
+        pos = self.glyph_offset(glyph)
+        if pos is None:
+            return []
+        count = self.s16(pos)
+        if count < 0:
+            return self.composite(pos + 10, dx, dy)
+        ends = [self.u16(pos + 10 + 2 * i) for i in range(count)]
+        points = ends[-1] + 1 if ends else 0
+        pos += 10 + 2 * count
+        pos += 2 + self.u16(pos)  # Skip the instructions
+        flags = []
+        while len(flags) < points:
+            flag = self.data[pos]
+            pos += 1
+            repeat = 0
+            if flag & 8:
+                repeat = self.data[pos]
+                pos += 1
+            flags += [flag] * (repeat + 1)
+        coordinates = []
+        for short, same in ((2, 16), (4, 32)):
+            value, values = 0, []
+            for flag in flags[:points]:
+                if flag & short:
+                    step = self.data[pos]
+                    pos += 1
+                    value += step if flag & same else -step
+                elif not flag & same:
+                    value += self.s16(pos)
+                    pos += 2
+                values.append(value)
+            coordinates.append(values)
+        result, first = [], 0
+        for end in ends:
+            result.append([(coordinates[0][i] + dx, coordinates[1][i] + dy, flags[i] & 1)
+                           for i in range(first, end + 1)])
+            first = end + 1
+        return result
+
+    def composite(self, pos, dx, dy):
+        result = []
+        while True:
+            flags, glyph = self.u16(pos), self.u16(pos + 2)
+            pos += 4
+            if flags & 1:
+                ox, oy = self.s16(pos), self.s16(pos + 2)
+                pos += 4
+            else:
+                ox, oy = struct.unpack(">bb", self.data[pos:pos + 2])
+                pos += 2
+            if not flags & 2:
+                raise ValueError("glyph %d: composites placed by point are not supported" % glyph)
+            pos += 2 if flags & 8 else 4 if flags & 0x40 else 8 if flags & 0x80 else 0
+            result += self.contours(glyph, dx + ox, dy + oy)
+            if not flags & 0x20:
+                return result
+
+
+def flatten(contour):
+    """Points of a closed polyline following a contour's lines and quadratic curves."""
+    # Between two off-curve points lies an implied on-curve point, halfway
+    points = []
+    for i, (x, y, on) in enumerate(contour):
+        nx, ny, next_on = contour[(i + 1) % len(contour)]
+        points.append((x, y, on))
+        if not on and not next_on:
+            points.append(((x + nx) / 2.0, (y + ny) / 2.0, 1))
+    start = next((i for i, point in enumerate(points) if point[2]), None)
+    if start is None:
+        return []
+    points = points[start:] + points[:start]
+    out = [points[0][:2]]
+    i = 1
+    while i <= len(points):
+        x, y, on = points[i % len(points)]
+        if on:
+            out.append((x, y))
+            i += 1
+            continue
+        (x0, y0), (x2, y2, _) = out[-1], points[(i + 1) % len(points)]
+        for step in range(1, CURVE_STEPS + 1):
+            t = step / float(CURVE_STEPS)
+            out.append(((1 - t) ** 2 * x0 + 2 * t * (1 - t) * x + t * t * x2,
+                        (1 - t) ** 2 * y0 + 2 * t * (1 - t) * y + t * t * y2))
+        i += 2
+    return out
+
+
+def coverage(edges, x0, width, y0, rows):
+    """Rows of coverage 0.0-1.0 of pixels x0.., y0.. inside the edges (non-zero winding)."""
+    out = [[0.0] * width for _ in range(rows)]
+    for row in range(rows):
+        for sample in range(ATLAS_SUBSAMPLES):
+            sy = y0 + row + (sample + 0.5) / ATLAS_SUBSAMPLES
+            crossings = []
+            for ax, ay, bx, by in edges:
+                if (ay <= sy < by) or (by <= sy < ay):
+                    crossings.append((ax + (sy - ay) * (bx - ax) / (by - ay), 1 if by > ay else -1))
+            crossings.sort()
+            winding = 0
+            for i, (x, direction) in enumerate(crossings[:-1]):
+                winding += direction
+                if winding == 0:
+                    continue
+                # Inside from x to the next crossing: add the part of each pixel it covers
+                left, right = x - x0, crossings[i + 1][0] - x0
+                for column in range(max(0, int(left)), min(width, int(right) + 1)):
+                    covered = min(right, column + 1) - max(left, column)
+                    if covered > 0:
+                        out[row][column] += covered / ATLAS_SUBSAMPLES
+    return out
+
+
+def render_glyph(font, code, scale, baseline):
+    """(LCD_Font_Glyph fields, bitmap bytes) of a character rendered at scale pixels per unit."""
+    glyph = font.glyph_index(code)
+    advance = int(round(font.advance(glyph) * scale))
+    edges = []
+    for contour in font.contours(glyph):
+        points = [(x * scale, baseline - y * scale) for x, y in flatten(contour)]
+        for i, (ax, ay) in enumerate(points):
+            bx, by = points[(i + 1) % len(points)]
+            if ay != by:
+                edges.append((ax, ay, bx, by))
+    if not edges:
+        return (0, 0, 0, 0, advance), b""
+    x0 = int(min(min(e[0], e[2]) for e in edges))
+    y0 = max(0, int(min(min(e[1], e[3]) for e in edges)))
+    x1 = int(max(max(e[0], e[2]) for e in edges)) + 1
+    y1 = int(max(max(e[1], e[3]) for e in edges)) + 1
+    levels = [[min(15, int(c * 15 + 0.5)) for c in row] for row in coverage(edges, x0, x1 - x0, y0, y1 - y0)]
+
+    # Trim blank rows and columns
+    lit_rows = [r for r, row in enumerate(levels) if any(row)]
+    lit_columns = [c for c in range(x1 - x0) if any(row[c] for row in levels)]
+    if not lit_rows:
+        return (0, 0, 0, 0, advance), b""
+    levels = [row[lit_columns[0]:lit_columns[-1] + 1] for row in levels[lit_rows[0]:lit_rows[-1] + 1]]
+    width = len(levels[0])
+    bitmap = bytearray()
+    for row in levels:
+        row = row + [0] * (width & 1)
+        bitmap += bytes(row[i] | (row[i + 1] << 4) for i in range(0, len(row), 2))
+    x_offset, y_offset = x0 + lit_columns[0], y0 + lit_rows[0]
+    if not -128 <= x_offset <= 127 or width > 255 or advance > 255:
+        raise ValueError("character %d: too big for an atlas" % code)
+    return (width, len(levels), x_offset, y_offset, advance), bytes(bitmap)
+
+
+def make_atlas(argument):
+    """(line height, payload) of path:size, a TrueType font rendered size pixels a line."""
+    path, _, size = argument.rpartition(":")
+    if not path or not size.isdigit() or not 4 <= int(size) <= 255:
+        raise ValueError("%s: an atlas is font.ttf:size, size 4-255 pixels" % argument)
+    height = int(size)
+    font = TrueType(path)
+    scale = height / float(font.ascent - font.descent)
+    baseline = font.ascent * scale
+    count = ATLAS_LAST - ATLAS_FIRST + 1
+    records, bitmaps = b"", b""
+    for code in range(ATLAS_FIRST, ATLAS_LAST + 1):
+        (width, rows, x_offset, y_offset, advance), bitmap = render_glyph(font, code, scale, baseline)
+        records += struct.pack("<HBBbBBB", len(bitmaps), width, rows, x_offset, min(y_offset, 255), advance, 0)
+        bitmaps += bitmap
+    return height, struct.pack("<BBBB", ATLAS_FIRST, count, height, 0) + records + bitmaps
+
+
+def named(argument):
+    """(name, path) of a name=path or path argument."""
+    if "=" in argument:
+        name, path = argument.split("=", 1)
+    else:
+        path = argument
+        name = os.path.splitext(os.path.basename(path))[0]
+    if not name or len(name.encode()) >= NAME_LENGTH:
+        raise ValueError("%s: names are 1-%d characters" % (argument, NAME_LENGTH - 1))
+    return name, path
+
+
+def build(entries, bpp):
+    """Pack bytes for [(name, type, width, height, payload)]."""
+    offset = HEADER_BYTES + ENTRY_BYTES * len(entries)
+    index = b""
+    payloads = b""
+    for name, kind, width, height, payload in entries:
+        if len(payload) > 0xFFFF:
+            raise ValueError("%s: payloads are at most 65535 bytes" % name)
+        index += struct.pack("<16sBBHHHII", name.encode(), kind, 0,
+                             binascii.crc_hqx(payload, 0xFFFF), width, height,
+                             offset + len(payloads), len(payload))
+        payloads += payload + b"\0" * (-len(payload) % 4)
+    size = HEADER_BYTES + len(index) + len(payloads)
+    header = struct.pack("<IHBBHHI", MAGIC, VERSION, bpp, 0, len(entries),
+                         binascii.crc_hqx(index, 0xFFFF), size)
+    return header + index + payloads
+
+
+def write_c_array(path, symbol, pack):
+    with open(path, "w") as out:
+        out.write("// Built by make_asset_pack.py, open with AssetPack_Open(&pack, %s)\n" % symbol)
+        out.write("#include <stdint.h>\n\n")
+        out.write("extern const uint8_t %s[%d];\n" % (symbol, len(pack)))
+        out.write("const uint8_t %s[%d] __attribute__((aligned(4))) = {\n" % (symbol, len(pack)))
+        for i in range(0, len(pack), 16):
+            out.write("    " + " ".join("0x%02X," % b for b in pack[i:i + 16]) + "\n")
+        out.write("};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("sprites", nargs="*", help="sprite PNGs, as path or name=path")
+    parser.add_argument("-o", "--output", required=True, help="pack file to write")
+    parser.add_argument("--palette", action="append", default=[], help="16-colour palette PNG (the first is used for sprites)")
+    parser.add_argument("--font", action="append", default=[], help="font sheet PNG")
+    parser.add_argument("--image", action="append", default=[], help="full-colour image PNG, compressed")
+    parser.add_argument("--atlas", action="append", default=[], help="TrueType font rendered for LCD_Print_Font(), as name=font.ttf:size")
+    parser.add_argument("--raw", action="append", default=[], help="any file, stored as it is")
+    parser.add_argument("--bpp", type=int, choices=(4, 8), default=4, help="LCD_BITS_PER_PIXEL of the build (default 4)")
+    parser.add_argument("--c-array", metavar="SYMBOL", help="write a C array of this name instead of a binary")
+    args = parser.parse_args()
+
+    try:
+        entries = []
+        sprite_palette = DEFAULT_PALETTE
+        for argument in args.palette:
+            name, path = named(argument)
+            colours, payload = make_palette(path)
+            if sprite_palette is DEFAULT_PALETTE:
+                sprite_palette = colours
+            entries.append((name, PALETTE, 16, 1, payload))
+        for argument in args.font:
+            name, path = named(argument)
+            entries.append((name, FONT, 5, 7, make_font(path)))
+        for argument in args.sprites:
+            name, path = named(argument)
+            width, height, payload = make_sprite(path, sprite_palette, args.bpp)
+            entries.append((name, SPRITE, width, height, payload))
+        for argument in args.image:
+            name, path = named(argument)
+            width, height, payload = make_image(path)
+            entries.append((name, IMAGE, width, height, payload))
+        for argument in args.atlas:
+            name, source = named(argument)
+            height, payload = make_atlas(source)
+            entries.append((name, ATLAS, ATLAS_LAST - ATLAS_FIRST + 1, height, payload))
+        for argument in args.raw:
+            name, path = named(argument)
+            with open(path, "rb") as raw:
+                entries.append((name, RAW, 0, 0, raw.read()))
+        names = [entry[0] for entry in entries]
+        for name in set(names):
+            kinds = [entry[1] for entry in entries if entry[0] == name]
+            if len(kinds) != len(set(kinds)):
+                raise ValueError("%s: two assets of the same type and name" % name)
+        pack = build(entries, args.bpp)
+    except (OSError, ValueError, KeyError, zlib.error) as error:
+        sys.exit("make_asset_pack.py: %s" % error)
+
+    if args.c_array:
+        write_c_array(args.output, args.c_array, pack)
+    else:
+        with open(args.output, "wb") as out:
+            out.write(pack)
+    print("%s: %d assets, %d bytes" % (args.output, len(entries), len(pack)))
+    for name, kind, width, height, payload in entries:
+        print("  %-16s %-8s %4d x %-4d %6d bytes" % (name, KIND_NAMES[kind], width, height, len(payload)))
+
+
+if __name__ == "__main__":
+    main()
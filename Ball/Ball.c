@@ -4,70 +4,235 @@
  */
 
 #include "Ball.h"
+#include "Renderer.h"
+#include <stddef.h>
+#if !PONG_HEADLESS
 #include "LCD.h"
+#endif
 
-// Screen dimensions (ST7789V2 display)
-#define SCREEN_WIDTH  240
-#define SCREEN_HEIGHT 240
 
 void Ball_Init(Ball_t* ball, int16_t size, float speed) {
     ball->size = size;
-    ball->x = (SCREEN_WIDTH - size) / 2;
-    ball->y = (SCREEN_HEIGHT - size) / 2;
+    ball->x = Fixed_FromInt((SCREEN_WIDTH - size) / 2);
+    ball->y = Fixed_FromInt((SCREEN_HEIGHT - size) / 2);
+    ball->prev_x = ball->x;
+    ball->prev_y = ball->y;
+    ball->sprites = NULL;
+    ball->anim_tick = 0;
     
     // Start moving at 45 degrees (down and to the right)
     // Using 0.707 ≈ sin(45°) for diagonal movement at constant speed
-    ball->velocity.x = speed * 0.707f;  // cos(45°)
-    ball->velocity.y = speed * 0.707f;  // sin(45°)
+    // (float is only used here, once, to convert the speed to fixed point)
+    ball->velocity.x = FIXED_FROM_FLOAT(speed * 0.707f);  // cos(45°)
+    ball->velocity.y = FIXED_FROM_FLOAT(speed * 0.707f);  // sin(45°)
 }
 
 void Ball_Update(Ball_t* ball) {
-    ball->x += (int16_t)ball->velocity.x;
-    ball->y += (int16_t)ball->velocity.y;
+    ball->prev_x = ball->x;
+    ball->prev_y = ball->y;
+    // Fixed-point add keeps the fraction of a pixel for the next step
+    ball->x += ball->velocity.x;
+    ball->y += ball->velocity.y;
 }
 
-void Ball_Draw(Ball_t* ball) {
+// Draw a ball of the given size with its top-left corner at court (x, y); with sprites, the
+// frame at tick, skip frames further on
+static void Ball_DrawAt(int16_t x, int16_t y, int16_t size, const struct LCD_Sprite_Anim* sprites,
+                        uint16_t tick, uint8_t skip) {
+#if !PONG_HEADLESS
+    if (sprites != NULL) {
+        const uint8_t ticks = (sprites->ticks_per_frame > 0) ? sprites->ticks_per_frame : 1;
+        const LCD_Sprite* frame = LCD_Sprite_Anim_Frame(sprites, (uint16_t)(tick + skip * ticks));
+        Renderer_Blit(PLAYFIELD_X(x + size / 2) - (int16_t)frame->ncols / 2,
+                      PLAYFIELD_Y(y + size / 2) - (int16_t)frame->nrows / 2, frame);
+        return;
+    }
+#else
+    (void)sprites; (void)tick; (void)skip;
+#endif
     // Draw ball as a filled circle
-    // Color: white (15 in 4-bit color), filled (1)
-    LCD_Draw_Circle(
-        ball->x + ball->size / 2,  // center x
-        ball->y + ball->size / 2,  // center y
-        ball->size / 2,            // radius
-        15,                        // white color
-        1                          // filled
+    // Color: white (15 in 4-bit color)
+    Renderer_Fill_Circle(
+        PLAYFIELD_X(x + size / 2),     // center x
+        PLAYFIELD_Y(y + size / 2),     // center y
+        PLAYFIELD_SCALE(size / 2),     // radius
+        15                         // white color
     );
 }
 
+void Ball_Draw(Ball_t* ball) {
+    Ball_DrawAt(Fixed_ToInt(ball->x), Fixed_ToInt(ball->y), ball->size, ball->sprites, ball->anim_tick++, 0);
+}
+
+void Ball_DrawInterpolated(Ball_t* ball, uint16_t alpha) {
+    Ball_DrawAt(Fixed_ToInt(Fixed_Lerp(ball->prev_x, ball->x, alpha)),
+                Fixed_ToInt(Fixed_Lerp(ball->prev_y, ball->y, alpha)),
+                ball->size, ball->sprites, ball->anim_tick++, 0);
+}
+
+void Ball_SetSprites(Ball_t* ball, const struct LCD_Sprite_Anim* sprites) {
+    ball->sprites = sprites;
+    ball->anim_tick = 0;
+}
+
 AABB Ball_GetAABB(Ball_t* ball) {
     AABB box;
-    box.x = ball->x;
-    box.y = ball->y;
+    box.x = Fixed_ToInt(ball->x);
+    box.y = Fixed_ToInt(ball->y);
     box.width = ball->size;
     box.height = ball->size;
     return box;
 }
 
-void Ball_SetVelocity(Ball_t* ball, float vx, float vy) {
+void Ball_SetVelocity(Ball_t* ball, Fixed16 vx, Fixed16 vy) {
     ball->velocity.x = vx;
     ball->velocity.y = vy;
 }
 
 Position2D Ball_GetPos(Ball_t* ball) {
     Position2D pos;
-    pos.x = ball->x;
-    pos.y = ball->y;
+    pos.x = Fixed_ToInt(ball->x);
+    pos.y = Fixed_ToInt(ball->y);
     return pos;
 }
 
 void Ball_SetPos(Ball_t* ball, Position2D pos) {
-    ball->x = pos.x;
-    ball->y = pos.y;
+    ball->x = Fixed_FromInt(pos.x);
+    ball->y = Fixed_FromInt(pos.y);
+    ball->prev_x = ball->x;
+    ball->prev_y = ball->y;
 }
 
-Vector2D Ball_GetVelocity(Ball_t* ball) {
+FixedVector2D Ball_GetVelocity(Ball_t* ball) {
     return ball->velocity;
 }
 
 int16_t Ball_GetSize(Ball_t* ball) {
     return ball->size;
 }
+
+// ===== MULTI-BALL STORAGE =====
+
+void BallSet_Clear(BallSet_t* set) {
+    set->count = 0;
+}
+
+void BallSet_SetSprites(BallSet_t* set, const struct LCD_Sprite_Anim* sprites) {
+    set->sprites = sprites;
+    set->anim_tick = 0;
+}
+
+int8_t BallSet_Add(BallSet_t* set, const Ball_t* ball) {
+    if (set->count >= BALL_MAX_COUNT) {
+        return -1;
+    }
+    uint8_t i = set->count++;
+    set->x[i] = ball->x;
+    set->y[i] = ball->y;
+    set->prev_x[i] = ball->prev_x;
+    set->prev_y[i] = ball->prev_y;
+    set->vx[i] = ball->velocity.x;
+    set->vy[i] = ball->velocity.y;
+    set->size[i] = ball->size;
+    return (int8_t)i;
+}
+
+void BallSet_Get(const BallSet_t* set, uint8_t index, Ball_t* ball) {
+    ball->x = set->x[index];
+    ball->y = set->y[index];
+    ball->prev_x = set->prev_x[index];
+    ball->prev_y = set->prev_y[index];
+    ball->velocity.x = set->vx[index];
+    ball->velocity.y = set->vy[index];
+    ball->size = set->size[index];
+}
+
+void BallSet_Remove(BallSet_t* set, uint8_t index) {
+    uint8_t last = --set->count;
+    if (index == last) {
+        return;
+    }
+    set->x[index] = set->x[last];
+    set->y[index] = set->y[last];
+    set->prev_x[index] = set->prev_x[last];
+    set->prev_y[index] = set->prev_y[last];
+    set->vx[index] = set->vx[last];
+    set->vy[index] = set->vy[last];
+    set->size[index] = set->size[last];
+}
+
+void BallSet_Update(BallSet_t* set) {
+    // One loop per axis: each only touches two position arrays and one velocity array
+    const uint8_t n = set->count;
+    for (uint8_t i = 0; i < n; i++) {
+        set->prev_x[i] = set->x[i];
+        set->x[i] += set->vx[i];
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        set->prev_y[i] = set->y[i];
+        set->y[i] += set->vy[i];
+    }
+}
+
+void BallSet_UpdatePart(BallSet_t* set, uint8_t shift) {
+    const uint8_t n = set->count;
+    for (uint8_t i = 0; i < n; i++) {
+        set->prev_x[i] = set->x[i];
+        set->x[i] += set->vx[i] >> shift;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        set->prev_y[i] = set->y[i];
+        set->y[i] += set->vy[i] >> shift;
+    }
+}
+
+AABB BallSet_GetAABB(const BallSet_t* set, uint8_t index) {
+    AABB box;
+    box.x = Fixed_ToInt(set->x[index]);
+    box.y = Fixed_ToInt(set->y[index]);
+    box.width = set->size[index];
+    box.height = set->size[index];
+    return box;
+}
+
+AABB BallSet_GetSweptAABB(const BallSet_t* set, uint8_t index) {
+    int16_t x0 = Fixed_ToInt(set->prev_x[index]);
+    int16_t y0 = Fixed_ToInt(set->prev_y[index]);
+    int16_t x1 = Fixed_ToInt(set->x[index]);
+    int16_t y1 = Fixed_ToInt(set->y[index]);
+    AABB box;
+    box.x = (x0 < x1) ? x0 : x1;
+    box.y = (y0 < y1) ? y0 : y1;
+    // +1 covers the fraction of a pixel lost by rounding both ends down
+    box.width = (int16_t)(((x0 > x1) ? x0 - x1 : x1 - x0) + set->size[index] + 1);
+    box.height = (int16_t)(((y0 > y1) ? y0 - y1 : y1 - y0) + set->size[index] + 1);
+    return box;
+}
+
+void BallSet_DrawInterpolated(BallSet_t* set, uint16_t alpha) {
+    // One tick of the animation per frame of the set, each ball a frame on from the one before
+    const uint16_t tick = set->anim_tick++;
+    for (uint8_t i = 0; i < set->count; i++) {
+        Ball_DrawAt(Fixed_ToInt(Fixed_Lerp(set->prev_x[i], set->x[i], alpha)),
+                    Fixed_ToInt(Fixed_Lerp(set->prev_y[i], set->y[i], alpha)),
+                    set->size[i], set->sprites, tick, i);
+    }
+}
+
+void BallSet_DrawTrails(const BallSet_t* set, uint16_t alpha, uint8_t colour, const struct LCD_Blend_Table* table) {
+    for (uint8_t i = 0; i < set->count; i++) {
+        const int16_t radius = set->size[i] / 2;
+        const int16_t cx = Fixed_ToInt(Fixed_Lerp(set->prev_x[i], set->x[i], alpha) - set->vx[i]) + radius;
+        const int16_t cy = Fixed_ToInt(Fixed_Lerp(set->prev_y[i], set->y[i], alpha) - set->vy[i]) + radius;
+        Renderer_Blend_Circle(PLAYFIELD_X(cx), PLAYFIELD_Y(cy), PLAYFIELD_SCALE(radius), colour, table);
+    }
+}
+
+void BallSet_DrawInterpolatedSquares(const BallSet_t* set, uint16_t alpha) {
+    for (uint8_t i = 0; i < set->count; i++) {
+        const int16_t x = Fixed_ToInt(Fixed_Lerp(set->prev_x[i], set->x[i], alpha));
+        const int16_t y = Fixed_ToInt(Fixed_Lerp(set->prev_y[i], set->y[i], alpha));
+        Renderer_Fill_Rect(PLAYFIELD_X(x), PLAYFIELD_Y(y),
+                           PLAYFIELD_LEN(x, set->size[i]), PLAYFIELD_LEN(y, set->size[i]), 15);
+    }
+}
@@ -4,6 +4,12 @@
  * 
  * Controls the ball position, velocity, and rendering.
  * The ball moves continuously and bounces off walls.
+ * Position and velocity are Q16.16 fixed point (see Utils.h), so any speed
+ * and angle is tracked exactly without float maths in the update.
+ * 
+ * A ball is a filled circle unless it is given sprite frames (an
+ * LCD_Sprite_Anim, e.g. a spinning ball from an asset pack): it then
+ * draws the next frame each time, centred on the ball.
  */
 
 #ifndef BALL_H
@@ -11,17 +17,29 @@
 
 #include <stdint.h>
 #include "Utils.h"
-#include "Joystick.h"
+#include "Joystick_Types.h"
+
+struct LCD_Sprite_Anim;  // LCD.h (not needed by headless builds)
+struct LCD_Blend_Table;
+
+// Most balls a BallSet_t can hold (multi-ball power-up)
+#ifndef BALL_MAX_COUNT
+#define BALL_MAX_COUNT 64
+#endif
 
 /**
  * @struct Ball_t
  * @brief Ball object containing position, size, and velocity
  */
 typedef struct {
-    int16_t x;              // Ball X position (top-left)
-    int16_t y;              // Ball Y position (top-left)
+    Fixed16 x;              // Ball X position (top-left, Q16.16 pixels)
+    Fixed16 y;              // Ball Y position (top-left, Q16.16 pixels)
+    Fixed16 prev_x;         // X position before the last update (for interpolated drawing)
+    Fixed16 prev_y;         // Y position before the last update
     int16_t size;           // Ball size (diameter in pixels)
-    Vector2D velocity;      // Velocity per frame (x, y components)
+    FixedVector2D velocity; // Velocity per step (x, y components, Q16.16 pixels)
+    const struct LCD_Sprite_Anim* sprites;  // Frames to draw instead of the circle, or NULL
+    uint16_t anim_tick;     // Draws so far, picks the frame
 } Ball_t;
 
 /**
@@ -52,6 +70,28 @@ void Ball_Update(Ball_t* ball);
  */
 void Ball_Draw(Ball_t* ball);
 
+/**
+ * @brief Draw ball between its previous and current position
+ * 
+ * Used when the physics runs faster or slower than the display, so the
+ * drawn position follows real time instead of snapping to physics steps.
+ * 
+ * @param ball Pointer to ball object
+ * @param alpha Fraction of a physics step since the last update (0 to LERP_ONE)
+ */
+void Ball_DrawInterpolated(Ball_t* ball, uint16_t alpha);
+
+/**
+ * @brief Draw the ball as sprite frames instead of a circle
+ * 
+ * Only changes how the ball looks: the frames are centred on it and its
+ * size still sets the collision box.
+ * 
+ * @param ball Pointer to ball object
+ * @param sprites Frames (kept, not copied), or NULL for the circle
+ */
+void Ball_SetSprites(Ball_t* ball, const struct LCD_Sprite_Anim* sprites);
+
 /**
  * @brief Get ball bounding box for collision detection
  * 
@@ -64,22 +104,25 @@ AABB Ball_GetAABB(Ball_t* ball);
  * @brief Set ball velocity
  * 
  * @param ball Pointer to ball object
- * @param vx Velocity X component (pixels/frame)
- * @param vy Velocity Y component (pixels/frame)
+ * @param vx Velocity X component (Q16.16 pixels/step)
+ * @param vy Velocity Y component (Q16.16 pixels/step)
  */
-void Ball_SetVelocity(Ball_t* ball, float vx, float vy);
+void Ball_SetVelocity(Ball_t* ball, Fixed16 vx, Fixed16 vy);
 
 /**
  * @brief Get ball position
  * 
  * @param ball Pointer to ball object
- * @return Current position
+ * @return Current position (whole pixels, top-left)
  */
 Position2D Ball_GetPos(Ball_t* ball);
 
 /**
  * @brief Set ball position
  * 
+ * Teleports the ball: the previous position is reset too, so an
+ * interpolated draw does not sweep across the screen.
+ * 
  * @param ball Pointer to ball object
  * @param pos New position
  */
@@ -89,9 +132,9 @@ void Ball_SetPos(Ball_t* ball, Position2D pos);
  * @brief Get ball velocity
  * 
  * @param ball Pointer to ball object
- * @return Current velocity
+ * @return Current velocity (Q16.16 pixels/step)
  */
-Vector2D Ball_GetVelocity(Ball_t* ball);
+FixedVector2D Ball_GetVelocity(Ball_t* ball);
 
 /**
  * @brief Get ball size
@@ -101,4 +144,149 @@ Vector2D Ball_GetVelocity(Ball_t* ball);
  */
 int16_t Ball_GetSize(Ball_t* ball);
 
+/* ===== MULTI-BALL STORAGE ===== */
+
+/**
+ * @struct BallSet_t
+ * @brief Many balls stored as a structure of arrays (SoA)
+ * 
+ * Instead of an array of Ball_t (x, y, vx, vy, x, y, vx, vy, ...), each field
+ * has its own array (x, x, x, ..., y, y, y, ...). A pass that only needs
+ * positions and velocities, like BallSet_Update(), then walks straight
+ * through contiguous memory, which is what the CPU does fastest.
+ * 
+ * Balls 0..count-1 are live. Removing a ball moves the last one into its slot,
+ * so the order of balls can change.
+ */
+typedef struct {
+    Fixed16 x[BALL_MAX_COUNT];          // X positions (top-left, Q16.16 pixels)
+    Fixed16 y[BALL_MAX_COUNT];          // Y positions (top-left, Q16.16 pixels)
+    Fixed16 prev_x[BALL_MAX_COUNT];     // X positions before the last update
+    Fixed16 prev_y[BALL_MAX_COUNT];     // Y positions before the last update
+    Fixed16 vx[BALL_MAX_COUNT];         // X velocities (Q16.16 pixels/step)
+    Fixed16 vy[BALL_MAX_COUNT];         // Y velocities (Q16.16 pixels/step)
+    int16_t size[BALL_MAX_COUNT];       // Diameters in pixels
+    uint8_t count;                      // Number of live balls
+    const struct LCD_Sprite_Anim* sprites;  // Frames every ball is drawn with, or NULL (circles)
+    uint16_t anim_tick;                 // Draws of the set so far
+} BallSet_t;
+
+/**
+ * @brief Remove all balls from a set
+ * 
+ * How they are drawn (BallSet_SetSprites()) is kept.
+ * 
+ * @param set Pointer to ball set
+ */
+void BallSet_Clear(BallSet_t* set);
+
+/**
+ * @brief Draw every ball of a set as sprite frames instead of a circle
+ * 
+ * Each ball starts a frame further on, so a set of balls don't spin in step.
+ * BallSet_DrawInterpolatedSquares() still draws squares.
+ * 
+ * @param set Pointer to ball set
+ * @param sprites Frames (kept, not copied), or NULL for circles
+ */
+void BallSet_SetSprites(BallSet_t* set, const struct LCD_Sprite_Anim* sprites);
+
+/**
+ * @brief Add a copy of a single ball to a set
+ * 
+ * @param set Pointer to ball set
+ * @param ball Ball to copy in (e.g. set up with Ball_Init())
+ * @return Index of the new ball, or -1 if the set is full
+ */
+int8_t BallSet_Add(BallSet_t* set, const Ball_t* ball);
+
+/**
+ * @brief Copy one ball of a set out as a single Ball_t
+ * 
+ * @param set Pointer to ball set
+ * @param index Ball index (0..count-1)
+ * @param ball Filled with the ball's state
+ */
+void BallSet_Get(const BallSet_t* set, uint8_t index, Ball_t* ball);
+
+/**
+ * @brief Remove a ball from a set
+ * 
+ * The last ball is moved into the freed slot.
+ * 
+ * @param set Pointer to ball set
+ * @param index Ball index (0..count-1)
+ */
+void BallSet_Remove(BallSet_t* set, uint8_t index);
+
+/**
+ * @brief Move every ball by its velocity (Ball_Update() for the whole set)
+ * 
+ * @param set Pointer to ball set
+ */
+void BallSet_Update(BallSet_t* set);
+
+/**
+ * @brief Move every ball by a 2^-shift share of its velocity (one physics substep)
+ * 
+ * 2^shift calls move each ball its whole velocity, to within 2^shift - 1 Q16.16
+ * units. The previous positions are where this substep started.
+ * 
+ * @param set Pointer to ball set
+ * @param shift Log2 of the substeps in the step (0 is BallSet_Update())
+ */
+void BallSet_UpdatePart(BallSet_t* set, uint8_t shift);
+
+/**
+ * @brief Get one ball's bounding box for collision detection
+ * 
+ * @param set Pointer to ball set
+ * @param index Ball index (0..count-1)
+ * @return AABB structure representing the ball's collision box
+ */
+AABB BallSet_GetAABB(const BallSet_t* set, uint8_t index);
+
+/**
+ * @brief Get the box one ball swept through during its last update
+ * 
+ * Covers both the previous and current position, for broad-phase checks.
+ * 
+ * @param set Pointer to ball set
+ * @param index Ball index (0..count-1)
+ * @return Bounding box of the ball's whole move
+ */
+AABB BallSet_GetSweptAABB(const BallSet_t* set, uint8_t index);
+
+/**
+ * @brief Draw every ball between its previous and current position
+ * 
+ * With sprites (BallSet_SetSprites()) this moves the animation on a tick.
+ * 
+ * @param set Pointer to ball set
+ * @param alpha Fraction of a physics step since the last update (0 to LERP_ONE)
+ */
+void BallSet_DrawInterpolated(BallSet_t* set, uint16_t alpha);
+
+/**
+ * @brief Draw a translucent shadow of every ball a step behind where it is drawn
+ * 
+ * A motion trail: a disc the ball's size, blended into what is under it by
+ * table (a table lookup per pixel). Draw before BallSet_DrawInterpolated(),
+ * so the ball covers the part of the trail it overlaps.
+ * 
+ * @param set Pointer to ball set
+ * @param alpha Fraction of a physics step since the last update (0 to LERP_ONE)
+ * @param colour Palette colour of the trail
+ * @param table Blend table (LCD_Build_Blend_Table()) setting the trail's opacity
+ */
+void BallSet_DrawTrails(const BallSet_t* set, uint16_t alpha, uint8_t colour, const struct LCD_Blend_Table* table);
+
+/**
+ * @brief Same as BallSet_DrawInterpolated(), but each ball as a filled square (cheaper)
+ * 
+ * @param set Pointer to ball set
+ * @param alpha Fraction of a physics step since the last update (0 to LERP_ONE)
+ */
+void BallSet_DrawInterpolatedSquares(const BallSet_t* set, uint16_t alpha);
+
 #endif // BALL_H
@@ -0,0 +1,166 @@
+/**
+ * @file Bricks.c
+ * @brief Breakout-style brick wall implementation
+ */
+
+#include "Bricks.h"
+
+// Bits c0..c1 set (inclusive)
+static uint16_t span_mask(uint8_t c0, uint8_t c1) {
+    return (uint16_t)(((1u << (c1 + 1)) - 1) & ~((1u << c0) - 1));
+}
+
+// Bricks covering pixels lo..hi on one axis of the wall (0 if none)
+static uint8_t brick_span(int16_t lo, int16_t hi, int16_t origin, int16_t pitch, uint8_t count,
+                          uint8_t* first, uint8_t* last) {
+    lo -= origin;
+    hi -= origin;
+    if (count == 0 || hi < 0 || lo >= pitch * count) {
+        return 0;
+    }
+    *first = (lo < 0) ? 0 : (uint8_t)(lo / pitch);
+    *last = (hi >= pitch * count) ? (uint8_t)(count - 1) : (uint8_t)(hi / pitch);
+    return 1;
+}
+
+static AABB brick_box(BrickField_t* field, uint8_t row, uint8_t col) {
+    AABB box;
+    box.x = field->x + col * field->pitch_x;
+    box.y = field->y + row * field->pitch_y;
+    box.width = field->brick_width;
+    box.height = field->brick_height;
+    return box;
+}
+
+void Bricks_Init(BrickField_t* field, int16_t x, int16_t y, uint8_t cols, uint8_t rows,
+                 int16_t pitch_x, int16_t pitch_y, int16_t gap, uint8_t colour) {
+    field->x = x;
+    field->y = y;
+    field->cols = (cols > BRICK_MAX_COLS) ? BRICK_MAX_COLS : cols;
+    field->rows = (rows > BRICK_MAX_ROWS) ? BRICK_MAX_ROWS : rows;
+    field->pitch_x = pitch_x;
+    field->pitch_y = pitch_y;
+    field->brick_width = pitch_x - gap;
+    field->brick_height = pitch_y - gap;
+    field->colour = colour;
+
+    for (uint8_t r = 0; r < field->rows; r++) {
+        // On the panel: the court mapped by Geometry.h
+        LCD_Retained_Area* area = &field->row_area[r];
+        const int16_t row_y = (int16_t)(y + r * pitch_y);
+        area->x = (uint16_t)PLAYFIELD_X(x);
+        area->y = (uint16_t)PLAYFIELD_Y(row_y);
+        area->width = (uint16_t)PLAYFIELD_LEN(x, field->cols * pitch_x);
+        area->height = (uint16_t)PLAYFIELD_LEN(row_y, field->brick_height);
+    }
+    Bricks_Reset(field);
+}
+
+void Bricks_Reset(BrickField_t* field) {
+    // No columns (PONG_BRICK_MODE 0) is no bricks, not a mask of 256 bits
+    const uint16_t full = field->cols ? span_mask(0, field->cols - 1) : 0;
+    for (uint8_t r = 0; r < field->rows; r++) {
+        field->alive[r] = full;
+        field->erase_pending[r] = 0;
+        // Redraw the whole row on the next Bricks_Draw()
+        field->row_area[r].stale = 1;
+    }
+    field->remaining = (uint16_t)(field->rows * field->cols);
+}
+
+uint8_t Bricks_Hit(BrickField_t* field, Fixed16 x, Fixed16 y, int16_t size, FixedVector2D move,
+                   AABB_SweepResult* contact, AABB* brick) {
+    // Pixel span covered by the whole move
+    Fixed16 x_end = x + move.x;
+    Fixed16 y_end = y + move.y;
+    int16_t px0 = Fixed_ToInt((x < x_end) ? x : x_end);
+    int16_t px1 = Fixed_ToInt((x < x_end) ? x_end : x) + size;
+    int16_t py0 = Fixed_ToInt((y < y_end) ? y : y_end);
+    int16_t py1 = Fixed_ToInt((y < y_end) ? y_end : y) + size;
+
+    uint8_t c0, c1, r0, r1;
+    if (!brick_span(px0, px1, field->x, field->pitch_x, field->cols, &c0, &c1) ||
+        !brick_span(py0, py1, field->y, field->pitch_y, field->rows, &r0, &r1)) {
+        return 0;
+    }
+
+    const uint16_t cols = span_mask(c0, c1);
+    uint8_t hit_row = 0, hit_col = 0, found = 0;
+    AABB_SweepResult best = {0, FIXED_ONE, 0, 0};
+
+    for (uint8_t r = r0; r <= r1; r++) {
+        uint16_t candidates = field->alive[r] & cols;  // Whole row skipped when empty
+        while (candidates) {
+            uint8_t c = (uint8_t)__builtin_ctz(candidates);
+            candidates &= candidates - 1;
+
+            AABB box = brick_box(field, r, c);
+            AABB_SweepResult result = AABB_Sweep(x, y, size, size, move, &box);
+            if (result.hit && (!found || result.time < best.time)) {
+                best = result;
+                hit_row = r;
+                hit_col = c;
+                found = 1;
+            }
+        }
+    }
+    if (!found) {
+        return 0;
+    }
+
+    const uint16_t bit = (uint16_t)(1u << hit_col);
+    field->alive[hit_row] &= ~bit;
+    field->erase_pending[hit_row] |= bit;
+    field->remaining--;
+    *contact = best;
+    *brick = brick_box(field, hit_row, hit_col);
+    return 1;
+}
+
+AABB Bricks_GetAABB(BrickField_t* field) {
+    AABB box;
+    box.x = field->x;
+    box.y = field->y;
+    box.width = field->cols * field->pitch_x;
+    box.height = field->rows * field->pitch_y;
+    return box;
+}
+
+uint16_t Bricks_GetRemaining(BrickField_t* field) {
+    return field->remaining;
+}
+
+#if !PONG_HEADLESS
+// A brick's court box, filled on the panel
+static inline void draw_box(AABB box, uint8_t colour) {
+    LCD_Draw_Rect(PLAYFIELD_X(box.x), PLAYFIELD_Y(box.y),
+                  PLAYFIELD_LEN(box.x, box.width), PLAYFIELD_LEN(box.y, box.height), colour, 1);
+}
+#endif
+
+void Bricks_Draw(BrickField_t* field) {
+#if PONG_HEADLESS
+    // Nothing to draw on: just forget the pending erases
+    for (uint8_t r = 0; r < field->rows; r++) {
+        field->erase_pending[r] = 0;
+    }
+#else
+    for (uint8_t r = 0; r < field->rows; r++) {
+        if (LCD_Retained_Begin(&field->row_area[r])) {
+            // Row was cleared (or is new): erase it and draw every standing brick
+            LCD_Draw_Rect(field->row_area[r].x, field->row_area[r].y,
+                          field->row_area[r].width, field->row_area[r].height, 0, 1);
+            for (uint16_t bits = field->alive[r]; bits; bits &= bits - 1) {
+                draw_box(brick_box(field, r, (uint8_t)__builtin_ctz(bits)), field->colour);
+            }
+        } else {
+            // Only erase bricks knocked down since the last draw
+            for (uint16_t bits = field->erase_pending[r]; bits; bits &= bits - 1) {
+                draw_box(brick_box(field, r, (uint8_t)__builtin_ctz(bits)), 0);
+            }
+        }
+        field->erase_pending[r] = 0;
+        LCD_Retained_End();
+    }
+#endif
+}
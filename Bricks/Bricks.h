@@ -0,0 +1,121 @@
+/**
+ * @file Bricks.h
+ * @brief Breakout-style brick wall for Pong
+ * 
+ * A grid of bricks stored as a packed bitset: one uint16_t per row, bit c
+ * set while the brick in column c is still standing. A 16x16 wall costs
+ * 32 bytes of occupancy, and the whole field stays allocation-free.
+ * 
+ * Collision only looks at the bricks in the rows and columns a ball's move
+ * overlaps. One AND of a row's bits with a column-span mask skips empty rows
+ * without testing their bricks one by one.
+ * 
+ * The wall is drawn as retained LCD content: it is not erased and redrawn
+ * every frame, and a destroyed brick only marks its own rectangle dirty.
+ */
+
+#ifndef BRICKS_H
+#define BRICKS_H
+
+#include <stdint.h>
+#include "Utils.h"
+#if !PONG_HEADLESS
+#include "LCD.h"
+#endif
+
+#define BRICK_MAX_ROWS 16   // Rows of bricks a field can hold
+#define BRICK_MAX_COLS 16   // Columns of bricks (bits in a row mask)
+
+/**
+ * @struct BrickField_t
+ * @brief Brick wall layout, occupancy and drawing state
+ */
+typedef struct {
+    int16_t x;                  // Left edge of the wall
+    int16_t y;                  // Top edge of the wall
+    int16_t pitch_x;            // Horizontal distance between brick left edges
+    int16_t pitch_y;            // Vertical distance between brick top edges
+    int16_t brick_width;        // Brick width (pitch minus the gap)
+    int16_t brick_height;       // Brick height
+    uint8_t cols;               // Columns in use (up to BRICK_MAX_COLS)
+    uint8_t rows;               // Rows in use (up to BRICK_MAX_ROWS)
+    uint8_t colour;             // Brick colour (0-15)
+    uint16_t remaining;         // Bricks still standing
+    uint16_t alive[BRICK_MAX_ROWS];         // Bit c set: brick (row, c) is standing
+    uint16_t erase_pending[BRICK_MAX_ROWS]; // Bit c set: brick (row, c) hit, not yet erased on screen
+    LCD_Retained_Area row_area[BRICK_MAX_ROWS];  // Panel area of each row
+} BrickField_t;
+
+/**
+ * @brief Initialize a full brick wall
+ * 
+ * @param field Pointer to brick field
+ * @param x Left edge of the wall
+ * @param y Top edge of the wall
+ * @param cols Number of columns (1 to BRICK_MAX_COLS)
+ * @param rows Number of rows (1 to BRICK_MAX_ROWS)
+ * @param pitch_x Horizontal distance between bricks (brick width + gap)
+ * @param pitch_y Vertical distance between bricks (brick height + gap)
+ * @param gap Pixels left empty between neighbouring bricks
+ * @param colour Brick colour (0-15)
+ * 
+ * @note The field must start zeroed (e.g. a global or static) so its retained
+ *       LCD areas register correctly; it may be re-initialized later.
+ */
+void Bricks_Init(BrickField_t* field, int16_t x, int16_t y, uint8_t cols, uint8_t rows,
+                 int16_t pitch_x, int16_t pitch_y, int16_t gap, uint8_t colour);
+
+/**
+ * @brief Stand every brick back up (new wall)
+ * 
+ * @param field Pointer to brick field
+ */
+void Bricks_Reset(BrickField_t* field);
+
+/**
+ * @brief Find the first brick a moving box hits and knock it down
+ * 
+ * Only bricks in the row/column span covered by the move are tested, with
+ * AABB_Sweep() giving the exact contact time and face. The brick hit first is
+ * removed; the caller reflects the ball using the returned contact.
+ * 
+ * @param field Pointer to brick field
+ * @param x Moving box X at the start of the move (Q16.16 pixels)
+ * @param y Moving box Y at the start of the move (Q16.16 pixels)
+ * @param size Moving box width and height in pixels
+ * @param move Displacement over the move (Q16.16 pixels)
+ * @param contact Filled with the contact time and normal when a brick is hit
+ * @param brick Filled with the bounding box of the brick hit
+ * @return 1 if a brick was hit, 0 otherwise
+ */
+uint8_t Bricks_Hit(BrickField_t* field, Fixed16 x, Fixed16 y, int16_t size, FixedVector2D move,
+                   AABB_SweepResult* contact, AABB* brick);
+
+/**
+ * @brief Get the bounding box of the whole wall
+ * 
+ * @param field Pointer to brick field
+ * @return AABB covering every brick position
+ */
+AABB Bricks_GetAABB(BrickField_t* field);
+
+/**
+ * @brief Get number of bricks still standing
+ * 
+ * @param field Pointer to brick field
+ * @return Remaining bricks (0 = wall cleared)
+ */
+uint16_t Bricks_GetRemaining(BrickField_t* field);
+
+/**
+ * @brief Bring the wall on screen up to date
+ * 
+ * Retained drawing: only bricks destroyed since the last call are erased
+ * (marking just their rectangles dirty), and a row is only redrawn when
+ * the LCD reports it was cleared. Call every frame after LCD_Clear_Background().
+ * 
+ * @param field Pointer to brick field
+ */
+void Bricks_Draw(BrickField_t* field);
+
+#endif // BRICKS_H
@@ -0,0 +1,126 @@
+#include "Buttons.h"
+#include "ClockProfile.h"
+
+/**
+ * @file Buttons.c
+ * @brief Implementation of the debounced buttons
+ *
+ * A line stays masked from its first edge until the timer runs out, so the
+ * EXTI interrupt fires once per press or release, not once per bounce. The
+ * pending lines are cleared before they are unmasked: the bounces seen while
+ * masked are thrown away, and only the level read afterwards counts.
+ */
+
+#define BUTTONS_TIM     TIM16
+#define BUTTONS_TICK_HZ 10000u   // 0.1ms timer ticks: 1-255ms fits the 16-bit ARR
+
+// (Re)start the one-shot wait. The prescaler is worked out each time, so a clock change
+// since Buttons_Init() (ClockProfile_Set()) doesn't change the debounce time
+static void start_timer(const Buttons_cfg_t* cfg)
+{
+    const uint32_t ms = cfg->debounce_ms ? cfg->debounce_ms : BUTTONS_DEFAULT_DEBOUNCE_MS;
+    BUTTONS_TIM->CR1 &= ~TIM_CR1_CEN;
+    BUTTONS_TIM->PSC = (ClockProfile_Timer_Hz(BUTTONS_TIM) / BUTTONS_TICK_HZ) - 1;
+    BUTTONS_TIM->ARR = ms * (BUTTONS_TICK_HZ / 1000u) - 1;
+    BUTTONS_TIM->EGR = TIM_EGR_UG;   // loads the prescaler and clears the counter
+    BUTTONS_TIM->SR = ~TIM_SR_UIF;
+    BUTTONS_TIM->CR1 |= TIM_CR1_CEN;  // one pulse: stops itself at the update
+}
+
+static uint8_t is_down(const Button_Pin_t* button)
+{
+    const uint8_t high = (button->port->IDR & button->pin) != 0;
+    return high == (button->active_high != 0);
+}
+
+void Buttons_Init(Buttons_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+    if (cfg->count > BUTTONS_MAX) {
+        cfg->count = BUTTONS_MAX;
+    }
+
+    RCC->APB2ENR |= RCC_APB2ENR_TIM16EN;
+    (void)RCC->APB2ENR;  // the clock has to be on before the registers are written
+    BUTTONS_TIM->CR1 = TIM_CR1_OPM | TIM_CR1_URS;  // only the end of a wait raises the interrupt
+    BUTTONS_TIM->DIER = TIM_DIER_UIE;
+    // A press is only ever a few ms late, so the lowest priority
+    NVIC_SetPriority(TIM1_UP_TIM16_IRQn, 15);
+    NVIC_EnableIRQ(TIM1_UP_TIM16_IRQn);
+
+    uint16_t lines = 0;
+    uint8_t held = 0;
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        lines |= cfg->buttons[i].pin;
+        if (is_down(&cfg->buttons[i])) {
+            held |= (uint8_t)(1u << i);
+        }
+    }
+    cfg->held = held;
+    cfg->pending = 0;
+
+    // Both edges, so releases are seen too; edges from before now are stale
+    EXTI->RTSR1 |= lines;
+    EXTI->FTSR1 |= lines;
+    EXTI->PR1 = lines;
+    cfg->lines = lines;
+    EXTI->IMR1 |= lines;
+    cfg->setup_done = 1;
+}
+
+void Buttons_EXTI_Callback(Buttons_cfg_t* cfg, uint16_t pin)
+{
+    if ((cfg->lines & pin) == 0) {
+        return;
+    }
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        if (cfg->buttons[i].pin == pin) {
+            cfg->pending |= (uint8_t)(1u << i);
+            cfg->edge_ticks[i] = HAL_GetTick();
+        }
+    }
+    EXTI->IMR1 &= ~(uint32_t)pin;
+    start_timer(cfg);
+}
+
+void Buttons_Timer_IRQHandler(Buttons_cfg_t* cfg)
+{
+    if ((BUTTONS_TIM->SR & TIM_SR_UIF) == 0) {
+        return;
+    }
+    BUTTONS_TIM->SR = ~TIM_SR_UIF;
+
+    // The EXTI interrupts run above this one: take the waiting buttons and unmask their
+    // lines in one go, so an edge from here on starts a new wait
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint8_t waiting = cfg->pending;
+    cfg->pending = 0;
+    uint32_t lines = 0;
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        if (waiting & (1u << i)) {
+            lines |= cfg->buttons[i].pin;
+        }
+    }
+    EXTI->PR1 = lines;
+    EXTI->IMR1 |= lines;
+    __set_PRIMASK(primask);
+
+    for (uint8_t i = 0; i < cfg->count; i++) {
+        const uint8_t bit = (uint8_t)(1u << i);
+        if ((waiting & bit) == 0) {
+            continue;
+        }
+        const uint8_t down = is_down(&cfg->buttons[i]);
+        if (down == ((cfg->held & bit) != 0)) {
+            continue;  // bounced back to where it was
+        }
+        cfg->held ^= bit;
+        if (cfg->events != NULL) {
+            EventQueue_Push(cfg->events, down ? BUTTONS_EVENT_PRESS : BUTTONS_EVENT_RELEASE, i,
+                            cfg->edge_ticks[i]);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+#include "EventQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Buttons.h
+ * @brief Debounced push buttons on EXTI lines, with press/release events
+ *
+ * Each button's EXTI line is set to interrupt on both edges. The first edge
+ * masks the line, so contact bounce raises no more interrupts, and starts
+ * TIM16 as a one-shot debounce timer. When it runs out the pins are read
+ * again, the lines are unmasked, and each button whose level really changed
+ * updates held and queues a press or release event. Nothing polls and
+ * nothing waits: with no buttons moving, the module costs no cycles at all.
+ *
+ * A change is only seen if the button still holds it when the timer runs out,
+ * so a tap shorter than debounce_ms is filtered out along with the bounce.
+ *
+ * The pins are set up by MX_GPIO_Init() (input, pull, EXTI line and its NVIC
+ * interrupt); Buttons_Init() only adds the second edge. TIM16 is set up at
+ * register level, so CubeMX does not need to know about it.
+ *
+ * Example usage:
+ * @code
+ * EventQueue_t button_events;
+ * Buttons_cfg_t buttons = {
+ *     .buttons = {
+ *         {.port = B1_GPIO_Port, .pin = B1_Pin},      // Nucleo user button, low when pressed
+ *         {.port = BTN2_GPIO_Port, .pin = BTN2_Pin}
+ *     },
+ *     .count = 2,
+ *     .debounce_ms = 20,
+ *     .events = &button_events
+ * };
+ * EventQueue_Init(&button_events);
+ * Buttons_Init(&buttons);  // after MX_GPIO_Init()
+ *
+ * // In HAL_GPIO_EXTI_Callback(GPIO_Pin):
+ * Buttons_EXTI_Callback(&buttons, GPIO_Pin);
+ * // In TIM1_UP_TIM16_IRQHandler():
+ * Buttons_Timer_IRQHandler(&buttons);
+ *
+ * // Main loop:
+ * Event_t event;
+ * while (EventQueue_Pop(&button_events, &event)) {
+ *     if (event.type == BUTTONS_EVENT_PRESS && event.arg == 0) toggle_pause();
+ * }
+ * if (buttons.held & (1u << 1)) boost();
+ * @endcode
+ */
+
+#define BUTTONS_MAX 8                   ///< Most buttons one Buttons_cfg_t handles
+#define BUTTONS_DEFAULT_DEBOUNCE_MS 20  ///< Debounce time when debounce_ms is 0
+
+/**
+ * @enum Buttons_Event_t
+ * @brief Event_t types pushed to cfg->events; arg is the button index, data the HAL tick of its first edge
+ */
+typedef enum {
+    BUTTONS_EVENT_PRESS = 1,    ///< Button went down
+    BUTTONS_EVENT_RELEASE       ///< Button came back up
+} Buttons_Event_t;
+
+/**
+ * @struct Button_Pin_t
+ * @brief One button: its pin, and the level it reads when pressed
+ */
+typedef struct {
+    GPIO_TypeDef* port;     ///< GPIO port (e.g. GPIOC)
+    uint16_t pin;           ///< GPIO_PIN_x; no two buttons on the same pin number (one EXTI line each)
+    uint8_t active_high;    ///< 1 if the pin reads high when pressed (pull-down), 0 for low (pull-up)
+} Button_Pin_t;
+
+/**
+ * @struct Buttons_cfg_t
+ * @brief A set of buttons sharing the debounce timer; fill in the fields up to events
+ */
+typedef struct {
+    Button_Pin_t buttons[BUTTONS_MAX];      ///< Buttons, indexed in events and held
+    uint8_t count;                          ///< Buttons in use, up to BUTTONS_MAX
+    uint8_t debounce_ms;                    ///< Time a change has to last, 1-255 ms (0 for BUTTONS_DEFAULT_DEBOUNCE_MS)
+    EventQueue_t* events;                   ///< Queue for press/release events, or NULL for held only
+    volatile uint8_t held;                  ///< Debounced state, bit i set while button i is down
+    volatile uint8_t pending;               ///< Internal: buttons waiting for the debounce timer
+    uint16_t lines;                         ///< Internal: EXTI lines of all the buttons
+    uint32_t edge_ticks[BUTTONS_MAX];       ///< Internal: HAL tick of the edge that started each wait
+    uint8_t setup_done;                     ///< Internal flag: 1 if initialized
+} Buttons_cfg_t;
+
+/**
+ * @brief Read the buttons' state, and enable both edges and the debounce timer
+ *
+ * @param cfg Pointer to buttons configuration; call once, after MX_GPIO_Init()
+ */
+void Buttons_Init(Buttons_cfg_t* cfg);
+
+/**
+ * @brief Handle an edge on an EXTI line (masks it and starts the debounce)
+ *
+ * Call from HAL_GPIO_EXTI_Callback(). Pins that are not one of the buttons
+ * are ignored, so other EXTI users can share the callback.
+ *
+ * @param cfg Pointer to buttons configuration
+ * @param pin GPIO_PIN_x of the line that fired
+ */
+void Buttons_EXTI_Callback(Buttons_cfg_t* cfg, uint16_t pin);
+
+/**
+ * @brief TIM16 update interrupt handler (debounce over: read the buttons that moved)
+ *
+ * Call from TIM1_UP_TIM16_IRQHandler().
+ *
+ * @param cfg Pointer to buttons configuration
+ */
+void Buttons_Timer_IRQHandler(Buttons_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,9 @@
 #include "Buzzer.h"
 #include "stm32l4xx_hal.h"
+#include "DmaChannel.h"
+#include "ClockProfile.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @file Buzzer.c
@@ -18,23 +21,121 @@ static inline uint32_t clamp_u32(uint32_t x, uint32_t lo, uint32_t hi)
     return x;
 }
 
+/**
+ * @brief Per-note timer values for BUZZER_NOTE_TICK_HZ, worked out by the compiler
+ * 
+ * Sorted by frequency (the enum order) for a binary search on the note's Hz value.
+ */
+typedef struct {
+    uint16_t freq_hz;       ///< Buzzer_Note_t value
+    uint16_t arr;           ///< tick / freq - 1
+    uint16_t half_period;   ///< (arr + 1) / 2, the CCR at 100% volume
+} Buzzer_Note_Timing_t;
+
+#define NOTE_TIMING(note) \
+    {(note), (uint16_t)((BUZZER_NOTE_TICK_HZ / (note)) - 1u), (uint16_t)((BUZZER_NOTE_TICK_HZ / (note)) / 2u)}
+
+// The lowest note (C4, 262Hz) must fit a 16-bit ARR
+#if (BUZZER_NOTE_TICK_HZ / 262) > 0x10000
+#error "BUZZER_NOTE_TICK_HZ is too high for the 16-bit note table"
+#endif
+
+static const Buzzer_Note_Timing_t note_timings[] = {
+    NOTE_TIMING(NOTE_C4), NOTE_TIMING(NOTE_CS4), NOTE_TIMING(NOTE_D4), NOTE_TIMING(NOTE_DS4),
+    NOTE_TIMING(NOTE_E4), NOTE_TIMING(NOTE_F4), NOTE_TIMING(NOTE_FS4), NOTE_TIMING(NOTE_G4),
+    NOTE_TIMING(NOTE_GS4), NOTE_TIMING(NOTE_A4), NOTE_TIMING(NOTE_AS4), NOTE_TIMING(NOTE_B4),
+    NOTE_TIMING(NOTE_C5), NOTE_TIMING(NOTE_CS5), NOTE_TIMING(NOTE_D5), NOTE_TIMING(NOTE_DS5),
+    NOTE_TIMING(NOTE_E5), NOTE_TIMING(NOTE_F5), NOTE_TIMING(NOTE_FS5), NOTE_TIMING(NOTE_G5),
+    NOTE_TIMING(NOTE_GS5), NOTE_TIMING(NOTE_A5), NOTE_TIMING(NOTE_AS5), NOTE_TIMING(NOTE_B5),
+    NOTE_TIMING(NOTE_C6), NOTE_TIMING(NOTE_CS6), NOTE_TIMING(NOTE_D6), NOTE_TIMING(NOTE_DS6),
+    NOTE_TIMING(NOTE_E6), NOTE_TIMING(NOTE_F6), NOTE_TIMING(NOTE_FS6), NOTE_TIMING(NOTE_G6),
+    NOTE_TIMING(NOTE_GS6), NOTE_TIMING(NOTE_A6), NOTE_TIMING(NOTE_AS6), NOTE_TIMING(NOTE_B6),
+    NOTE_TIMING(NOTE_C7), NOTE_TIMING(NOTE_CS7), NOTE_TIMING(NOTE_D7), NOTE_TIMING(NOTE_DS7),
+    NOTE_TIMING(NOTE_E7), NOTE_TIMING(NOTE_F7), NOTE_TIMING(NOTE_FS7), NOTE_TIMING(NOTE_G7),
+    NOTE_TIMING(NOTE_GS7), NOTE_TIMING(NOTE_A7), NOTE_TIMING(NOTE_AS7), NOTE_TIMING(NOTE_B7),
+    NOTE_TIMING(NOTE_C8)
+};
+
+// Table entry for a note, or NULL if the value is not one of the enum's notes
+static const Buzzer_Note_Timing_t* note_timing(uint32_t freq_hz)
+{
+    uint32_t lo = 0;
+    uint32_t hi = sizeof(note_timings) / sizeof(note_timings[0]);
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2u;
+        if (note_timings[mid].freq_hz < freq_hz) {
+            lo = mid + 1u;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < sizeof(note_timings) / sizeof(note_timings[0]) && note_timings[lo].freq_hz == freq_hz)
+               ? &note_timings[lo] : NULL;
+}
+
+// Index of a HAL channel constant (TIM_CHANNEL_1 = 0x0 .. TIM_CHANNEL_4 = 0xC)
+static inline uint32_t channel_index(uint32_t channel)
+{
+    return channel >> 2;
+}
+
+// ARR and CCR for a tone, as described in buzzer_tone()
+static void tone_registers(Buzzer_cfg_t* cfg, uint32_t freq_hz, uint8_t volume_percent,
+                           uint32_t* arr, uint32_t* ccr)
+{
+    freq_hz = clamp_u32(freq_hz, cfg->min_freq_hz, cfg->max_freq_hz);
+    *arr = clamp_u32((cfg->tick_freq_hz / freq_hz) - 1u, 1u, 0xFFFFFFFFu);
+    volume_percent = (uint8_t)clamp_u32(volume_percent, 0u, 100u);
+    *ccr = (((*arr + 1u) / 2u) * volume_percent) / 100u;
+}
+
+// Stop a waveform playback, leaving the timer registers as they are
+static void wave_stop(Buzzer_cfg_t* cfg)
+{
+    if (cfg->dma_channel != NULL) {
+        __HAL_TIM_DISABLE_DMA(cfg->htim, TIM_DMA_UPDATE);
+        cfg->dma_channel->CCR &= ~DMA_CCR_EN;
+    }
+}
+
 void buzzer_init(Buzzer_cfg_t* cfg)
 {
     if (!cfg->setup_done) {
         // Timer should be initialized by CubeMX (MX_TIMx_Init)
         // This just marks the buzzer as ready to use
         cfg->pwm_started = 0;
+        cfg->ccr_reg = &cfg->htim->Instance->CCR1 + channel_index(cfg->channel);
         cfg->setup_done = 1;
     }
 }
 
+void buzzer_clock_changed(Buzzer_cfg_t* cfg)
+{
+    if (!cfg->setup_done) {
+        return;  // The timer is set up later, for the clock as it is then
+    }
+    cfg->htim->Instance->PSC = (ClockProfile_Timer_Hz(cfg->htim->Instance) / cfg->tick_freq_hz) - 1;
+}
+
 uint8_t buzzer_is_running(Buzzer_cfg_t* cfg)
 {
     return cfg->pwm_started ? 1u : 0u;
 }
 
+void buzzer_tone_ticks(Buzzer_cfg_t* cfg, uint32_t freq_hz, uint8_t volume_percent, Buzzer_Tone_t* tone)
+{
+    if (freq_hz == 0 || volume_percent == 0) {
+        // Silent: keep the period running, with the output low
+        tone->arr = cfg->htim->Instance->ARR;
+        tone->ccr = 0;
+        return;
+    }
+    tone_registers(cfg, freq_hz, volume_percent, &tone->arr, &tone->ccr);
+}
+
 void buzzer_off(Buzzer_cfg_t* cfg)
 {
+    wave_stop(cfg);
     if (cfg->pwm_started) {
         // Make sure duty is zero first, then stop PWM fully
         __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, 0);
@@ -49,6 +150,7 @@ void buzzer_tone(Buzzer_cfg_t* cfg, uint32_t freq_hz, uint8_t volume_percent)
     if (!cfg->setup_done) {
         buzzer_init(cfg);
     }
+    wave_stop(cfg);
 
     // volume 0 => fully off
     if (volume_percent == 0 || freq_hz == 0) {
@@ -56,9 +158,6 @@ void buzzer_tone(Buzzer_cfg_t* cfg, uint32_t freq_hz, uint8_t volume_percent)
         return;
     }
 
-    // Clamp frequency to configured range
-    freq_hz = clamp_u32(freq_hz, cfg->min_freq_hz, cfg->max_freq_hz);
-
     // Start PWM ONLY when first used -> buzzer is completely off until called
     if (!cfg->pwm_started) {
         // Start PWM output
@@ -78,18 +177,9 @@ void buzzer_tone(Buzzer_cfg_t* cfg, uint32_t freq_hz, uint8_t volume_percent)
     //   ARR = (1,000,000 / 440) - 1 = 2272
     //   This gives a period of 2273 ticks = 2.273ms (1/440Hz = 2.27ms) ✓
     
-    uint32_t arr = (cfg->tick_freq_hz / freq_hz) - 1u;
-
-    // ARR must be >= 1 for a meaningful PWM period
-    arr = clamp_u32(arr, 1u, 0xFFFFFFFFu);
-
-    // Update ARR and reset the counter for a clean phase start
-    __HAL_TIM_SET_AUTORELOAD(cfg->htim, arr);
-    __HAL_TIM_SET_COUNTER(cfg->htim, 0);
-
-    // Force registers reload immediately (safe with ARPE enabled)
-    HAL_TIM_GenerateEvent(cfg->htim, TIM_EVENTSOURCE_UPDATE);
-
+    // (the frequency is clamped to the configured range, and ARR must be >= 1
+    // for a meaningful PWM period)
+    
     // ============ DUTY CYCLE / VOLUME CONTROL ============
     // Duty cycle controls the "volume" - how loud the tone sounds
     // Duty cycle = CCR / (ARR + 1), where CCR is the Compare register value
@@ -104,16 +194,151 @@ void buzzer_tone(Buzzer_cfg_t* cfg, uint32_t freq_hz, uint8_t volume_percent)
     //   - At 50% volume: CCR = 1136 * 50 / 100 = 568 counts
     //   - Duty = 568 / 2273 ≈ 25% of period (half of our 50% max)
     
-    volume_percent = (uint8_t)clamp_u32(volume_percent, 0u, 100u);
+    uint32_t arr, ccr;
+    tone_registers(cfg, freq_hz, volume_percent, &arr, &ccr);
 
-    uint32_t half_period = (arr + 1u) / 2u;
-    uint32_t ccr = (half_period * volume_percent) / 100u;
+    // Update ARR and reset the counter for a clean phase start
+    __HAL_TIM_SET_AUTORELOAD(cfg->htim, arr);
+    __HAL_TIM_SET_COUNTER(cfg->htim, 0);
+
+    // Force registers reload immediately (safe with ARPE enabled)
+    HAL_TIM_GenerateEvent(cfg->htim, TIM_EVENTSOURCE_UPDATE);
 
     __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, ccr);
 }
 
 void buzzer_note(Buzzer_cfg_t* cfg, Buzzer_Note_t note, uint8_t volume_percent)
 {
-    // Simply play the note frequency (note enum contains the Hz value)
-    buzzer_tone(cfg, (uint32_t)note, volume_percent);
-}
\ No newline at end of file
+    const Buzzer_Note_Timing_t* timing = note_timing((uint32_t)note);
+    if (timing == NULL || volume_percent == 0 || cfg->tick_freq_hz != BUZZER_NOTE_TICK_HZ ||
+        (uint32_t)note < cfg->min_freq_hz || (uint32_t)note > cfg->max_freq_hz) {
+        // Not in the table (or it would be clamped): the general path does the maths
+        buzzer_tone(cfg, (uint32_t)note, volume_percent);
+        return;
+    }
+
+    if (!cfg->setup_done) {
+        buzzer_init(cfg);
+    }
+    wave_stop(cfg);
+    if (!cfg->pwm_started) {
+        HAL_TIM_PWM_Start(cfg->htim, cfg->channel);
+        cfg->pwm_started = 1;
+    }
+
+    // Same register sequence as buzzer_tone(), with the table's ARR and duty.
+    // The "/ 100" is by a constant, so the compiler turns it into a multiply
+    if (volume_percent > 100u) {
+        volume_percent = 100u;
+    }
+    TIM_TypeDef* tim = cfg->htim->Instance;
+    tim->ARR = timing->arr;
+    tim->CNT = 0;
+    tim->EGR = TIM_EGR_UG;
+    __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, ((uint32_t)timing->half_period * volume_percent) / 100u);
+}
+uint16_t buzzer_wave_build(Buzzer_cfg_t* cfg, const Buzzer_Wave_Note_t* notes, uint16_t count,
+                           uint16_t* table, uint16_t max_steps)
+{
+    const uint32_t stride = BUZZER_WAVE_STRIDE(cfg->channel);
+    const uint32_t own = 2u + channel_index(cfg->channel);  // Offset of this channel's CCR in a step
+    TIM_TypeDef* tim = cfg->htim->Instance;
+    const uint16_t other_ccr[3] = {(uint16_t)tim->CCR1, (uint16_t)tim->CCR2, (uint16_t)tim->CCR3};
+    uint16_t steps = 0;
+
+    for (uint16_t n = 0; n <= count && steps <= max_steps; n++) {
+        uint32_t arr, ccr, periods;
+        if (n == count) {
+            // Closing silent step: playback stops on it
+            arr = (cfg->tick_freq_hz / 1000u) - 1u;
+            ccr = 0;
+            periods = 1;
+        } else if (notes[n].freq_hz == 0 || notes[n].volume_percent == 0) {
+            arr = (cfg->tick_freq_hz / 1000u) - 1u;
+            ccr = 0;
+            periods = notes[n].duration_ms;
+        } else {
+            tone_registers(cfg, notes[n].freq_hz, notes[n].volume_percent, &arr, &ccr);
+            periods = ((uint32_t)notes[n].duration_ms * cfg->tick_freq_hz) / ((arr + 1u) * 1000u);
+        }
+        // Table entries are 16 bits (the DMA zero-extends them into the 32-bit registers)
+        arr = clamp_u32(arr, 1u, 0xFFFFu);
+
+        // The silent step always fits: BUZZER_WAVE_SIZE() reserves it
+        uint32_t room = (n == count) ? 1u : (uint32_t)(max_steps - steps);
+        if (periods > room) {
+            periods = room;
+        }
+        for (uint32_t p = 0; p < periods; p++, steps++) {
+            uint16_t* step = &table[steps * stride];
+            step[0] = (uint16_t)arr;
+            step[1] = 0;  // RCR: not implemented on general purpose timers
+            for (uint32_t c = 2; c < own; c++) {
+                step[c] = other_ccr[c - 2];
+            }
+            step[own] = (uint16_t)ccr;
+        }
+    }
+    return steps - 1u;
+}
+
+void buzzer_wave_play(Buzzer_cfg_t* cfg, const uint16_t* table, uint16_t steps)
+{
+    if (cfg->dma_channel == NULL) {
+        return;
+    }
+    // Routes the request too; nothing plays if another module has the channel
+    if (DmaChannel_Claim(cfg->dma_channel, cfg->dma_request, cfg, "Buzzer") != DMACHANNEL_OK) {
+        return;
+    }
+    if (!cfg->setup_done) {
+        buzzer_init(cfg);
+    }
+    wave_stop(cfg);
+
+    const uint32_t stride = BUZZER_WAVE_STRIDE(cfg->channel);
+    TIM_TypeDef* tim = cfg->htim->Instance;
+    DMA_Channel_TypeDef* channel = cfg->dma_channel;
+
+    // Play the first step now (preload on, so ARR and CCR load together on the forced update)
+    const uint32_t own = 2u + channel_index(cfg->channel);
+    const uint32_t total = (uint32_t)steps + 1u;  // including the closing silent step
+    tim->CR1 |= TIM_CR1_ARPE;
+    __HAL_TIM_SET_AUTORELOAD(cfg->htim, table[0]);
+    __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, table[own]);
+    __HAL_TIM_SET_COUNTER(cfg->htim, 0);
+    HAL_TIM_GenerateEvent(cfg->htim, TIM_EVENTSOURCE_UPDATE);
+    if (!cfg->pwm_started) {
+        HAL_TIM_PWM_Start(cfg->htim, cfg->channel);
+        cfg->pwm_started = 1;
+    }
+    if (total < 2u) {
+        return;
+    }
+
+    // The second step goes straight into the preload registers, to take over at the end
+    // of the first period. From then on, the DMA burst at each update event writes the
+    // step after the one starting (ARR .. own CCR, through DMAR)
+    __HAL_TIM_SET_AUTORELOAD(cfg->htim, table[stride]);
+    __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, table[stride + own]);
+    if (total < 3u) {
+        return;
+    }
+    tim->DCR = ((stride - 1u) << TIM_DCR_DBL_Pos) | ((offsetof(TIM_TypeDef, ARR) / 4u) << TIM_DCR_DBA_Pos);
+    channel->CCR = 0;
+    channel->CPAR = (uint32_t)&tim->DMAR;
+    channel->CMAR = (uint32_t)&table[2u * stride];
+    channel->CNDTR = (total - 2u) * stride;
+    // 16-bit memory to 32-bit timer register, increment memory, normal (one-shot) mode
+    channel->CCR = DMA_CCR_PL_0 | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_1 | DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_EN;
+    __HAL_TIM_CLEAR_FLAG(cfg->htim, TIM_FLAG_UPDATE);
+    __HAL_TIM_ENABLE_DMA(cfg->htim, TIM_DMA_UPDATE);
+}
+
+uint8_t buzzer_wave_busy(Buzzer_cfg_t* cfg)
+{
+    if (cfg->dma_channel == NULL || !(cfg->dma_channel->CCR & DMA_CCR_EN)) {
+        return 0;
+    }
+    return (cfg->dma_channel->CNDTR != 0) ? 1u : 0u;
+}
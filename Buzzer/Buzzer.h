@@ -17,6 +17,8 @@ extern "C" {
  * - Play tones at arbitrary frequencies
  * - Play musical notes (C4-C7) with symbolic names, including sharps/flats
  * - Volume control (0-100%)
+ * - Waveform playback: a precomputed table of periods and duty cycles streamed
+ *   into the timer by DMA, so melodies and sweeps play with no CPU at all
  * 
  * Example usage:
  * @code
@@ -35,9 +37,26 @@ extern "C" {
  * buzzer_note(&buzzer_cfg, NOTE_C4, 50);   // Play musical note C4 at 50% volume
  * buzzer_note(&buzzer_cfg, NOTE_CS5, 50);  // Play C# in octave 5
  * buzzer_off(&buzzer_cfg);                 // Turn off
+ * 
+ * // Waveform playback (needs .dma_channel/.dma_request, e.g. TIM2_UP = DMA1_Channel2, request 4):
+ * static const Buzzer_Wave_Note_t jingle[] = {{NOTE_C5, 50, 100}, {0, 0, 50}, {NOTE_G5, 50, 200}};
+ * static uint16_t wave[BUZZER_WAVE_SIZE(TIM_CHANNEL_3, 400)];
+ * uint16_t steps = buzzer_wave_build(&buzzer_cfg, jingle, 3, wave, 400);
+ * buzzer_wave_play(&buzzer_cfg, wave, steps);  // returns at once
  * @endcode
  */
 
+/**
+ * @brief Timer tick frequency the note table is built for
+ * 
+ * buzzer_note() takes each note's ARR and half period from a table computed at
+ * compile time for this tick rate, instead of dividing on every call. Buzzers
+ * with another tick_freq_hz still work, through buzzer_tone().
+ */
+#ifndef BUZZER_NOTE_TICK_HZ
+#define BUZZER_NOTE_TICK_HZ 1000000
+#endif
+
 /**
  * @enum Buzzer_Note_t
  * @brief Musical notes C4 to C8 with sharps/flats
@@ -119,10 +138,46 @@ typedef struct {
     uint32_t tick_freq_hz;      ///< Timer tick frequency after prescaler (Hz)
     uint32_t min_freq_hz;       ///< Minimum audible frequency (Hz)
     uint32_t max_freq_hz;       ///< Maximum audible frequency (Hz)
+    DMA_Channel_TypeDef* dma_channel;   ///< DMA channel of the timer's update request for waveform playback, or NULL
+    uint8_t dma_request;        ///< DMA request number for that channel (CSELR), e.g. 4 for TIM2_UP on DMA1_Channel2
     uint8_t setup_done;         ///< Internal flag: 1 if initialized, 0 otherwise
     uint8_t pwm_started;        ///< Internal flag: 1 if PWM is running, 0 otherwise
+    volatile uint32_t* ccr_reg; ///< Internal: the channel's CCR (set by buzzer_init()), for buzzer_tone_fast()
 } Buzzer_cfg_t;
 
+/**
+ * @struct Buzzer_Tone_t
+ * @brief Timer values of a tone, worked out ahead by buzzer_tone_ticks() for buzzer_tone_fast()
+ */
+typedef struct {
+    uint32_t arr;               ///< Auto-reload: period in ticks - 1
+    uint32_t ccr;               ///< Compare: the duty in ticks (0 => silent)
+} Buzzer_Tone_t;
+
+/**
+ * @struct Buzzer_Wave_Note_t
+ * @brief One note (or rest) for buzzer_wave_build()
+ */
+typedef struct {
+    uint16_t freq_hz;           ///< Note frequency in Hz, or 0 for a rest
+    uint8_t volume_percent;     ///< 0..100 (0 => rest)
+    uint16_t duration_ms;       ///< Note length in ms
+} Buzzer_Wave_Note_t;
+
+/**
+ * @brief Halfwords per waveform step for a timer channel
+ * 
+ * Each step is one PWM period. The DMA burst writes the timer registers from
+ * ARR up to the channel's CCR (ARR, RCR, CCR1 .. CCRn), so a step holds ARR,
+ * a placeholder and every CCR up to the buzzer's own.
+ */
+#define BUZZER_WAVE_STRIDE(channel) (3u + ((channel) >> 2))
+
+/**
+ * @brief Table size in halfwords for a number of waveform steps (one extra step ends the sound)
+ */
+#define BUZZER_WAVE_SIZE(channel, steps) (BUZZER_WAVE_STRIDE(channel) * ((steps) + 1u))
+
 /**
  * @brief Initialize buzzer timer
  * 
@@ -149,11 +204,14 @@ void buzzer_tone(Buzzer_cfg_t* cfg, uint32_t freq_hz, uint8_t volume_percent);
 /**
  * @brief Play a musical note on the buzzer
  *
- * Convenience function for playing pre-defined musical notes (C4-C5).
- * Internally calls buzzer_tone() with the note's frequency.
+ * Convenience function for playing pre-defined musical notes (C4-C8).
+ * The note's ARR and half period come from a table built at compile time for
+ * BUZZER_NOTE_TICK_HZ, so a note change is a few register writes and no
+ * division. With another tick_freq_hz, or a note outside min/max_freq_hz,
+ * it calls buzzer_tone() with the note's frequency instead.
  *
  * @param cfg Pointer to buzzer configuration struct
- * @param note Musical note from Buzzer_Note_t enum (NOTE_C4 to NOTE_C5)
+ * @param note Musical note from Buzzer_Note_t enum (NOTE_C4 to NOTE_C8)
  * @param volume_percent 0..100 (0 => off)
  */
 void buzzer_note(Buzzer_cfg_t* cfg, Buzzer_Note_t note, uint8_t volume_percent);
@@ -173,6 +231,96 @@ void buzzer_off(Buzzer_cfg_t* cfg);
  */
 uint8_t buzzer_is_running(Buzzer_cfg_t* cfg);
 
+/**
+ * @brief Work out a tone's timer values, for buzzer_tone_fast()
+ *
+ * Does the clamping and division buzzer_tone() does on every call, once,
+ * e.g. when a tone is queued or a table of them is set up.
+ *
+ * @param cfg Pointer to buzzer configuration struct
+ * @param freq_hz Tone frequency in Hz (clamped to min/max_freq_hz)
+ * @param volume_percent 0..100 (0, or freq_hz 0, gives a silent tone: ccr 0 at the current period)
+ * @param tone Filled in with ARR and CCR for the current tick_freq_hz
+ */
+void buzzer_tone_ticks(Buzzer_cfg_t* cfg, uint32_t freq_hz, uint8_t volume_percent, Buzzer_Tone_t* tone);
+
+/**
+ * @brief Change the tone playing to one from buzzer_tone_ticks(): two register writes
+ *
+ * No clamping, division or HAL call, so it can be called from an interrupt at
+ * kHz rates. Both registers are preloaded, so the new tone starts cleanly at
+ * the end of the period playing, rather than with the counter reset and a
+ * forced update as buzzer_tone() does.
+ *
+ * @param cfg Pointer to buzzer configuration struct
+ * @param tone Timer values from buzzer_tone_ticks()
+ *
+ * @note The buzzer must be running already (buzzer_tone() or buzzer_note()
+ *       since the last buzzer_off()), with no waveform playing: this only
+ *       changes the registers, it does not start or stop the PWM.
+ */
+static inline void buzzer_tone_fast(Buzzer_cfg_t* cfg, const Buzzer_Tone_t* tone)
+{
+    cfg->htim->Instance->ARR = tone->arr;
+    *cfg->ccr_reg = tone->ccr;
+}
+
+/**
+ * @brief Keep tick_freq_hz after the core clock changed (e.g. ClockProfile_Set())
+ * 
+ * @param cfg Pointer to buzzer configuration struct
+ * 
+ * @details Sets the prescaler for tick_freq_hz from the timer's new kernel clock.
+ * Tones, notes and waveform tables are in ticks, so they carry on at the same pitch.
+ * The prescaler is preloaded: the period already running finishes at the old rate.
+ */
+void buzzer_clock_changed(Buzzer_cfg_t* cfg);
+
+/**
+ * @brief Precompute a waveform table from a list of notes
+ * 
+ * @param cfg Pointer to buzzer configuration struct
+ * @param notes Notes to play in order
+ * @param count Number of notes
+ * @param table Output table, BUZZER_WAVE_SIZE(cfg->channel, max_steps) halfwords
+ * @param max_steps Most PWM periods the table can hold
+ * @return Number of steps written (pass to buzzer_wave_play()), not counting the final silent step
+ * 
+ * @details Each note becomes one step per PWM period, with the same period and
+ * duty cycle buzzer_tone() would use (a 1kHz note for 100ms is 100 steps).
+ * Rests are 1ms steps at 0% duty. A silent step is appended so playback ends
+ * quietly. Notes that do not fit are cut short.
+ * 
+ * CCRs of the timer's lower-numbered channels are written by the DMA burst too;
+ * the table keeps the values they had when it was built.
+ */
+uint16_t buzzer_wave_build(Buzzer_cfg_t* cfg, const Buzzer_Wave_Note_t* notes, uint16_t count,
+                           uint16_t* table, uint16_t max_steps);
+
+/**
+ * @brief Start playing a waveform table in the background
+ * 
+ * @param cfg Pointer to buzzer configuration struct
+ * @param table Table from buzzer_wave_build() (must stay valid while playing)
+ * @param steps Step count returned by buzzer_wave_build()
+ * 
+ * @details Loads the first step, then the timer's update DMA request writes the
+ * next step's ARR and CCR (burst through DMAR) at the end of every period. No
+ * interrupts are used. The new values go into the preload registers, so each
+ * period is played whole. buzzer_tone() or buzzer_off() stop the playback.
+ * 
+ * @note Requires cfg->dma_channel; does nothing without it
+ */
+void buzzer_wave_play(Buzzer_cfg_t* cfg, const uint16_t* table, uint16_t steps);
+
+/**
+ * @brief Check whether waveform playback is still going
+ * 
+ * @param cfg Pointer to buzzer configuration struct
+ * @return 1 while the DMA is still loading steps (the last two play after it finishes)
+ */
+uint8_t buzzer_wave_busy(Buzzer_cfg_t* cfg);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
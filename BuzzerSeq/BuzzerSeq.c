@@ -0,0 +1,163 @@
+#include "BuzzerSeq.h"
+#include "stm32l4xx_hal.h"
+#include "ClockProfile.h"
+
+/**
+ * @file BuzzerSeq.c
+ * @brief Implementation of the interrupt-driven buzzer sequencer
+ *
+ * The timer runs in one-pulse mode: each event loads its duration into the
+ * auto-reload register and starts the counter, and the update interrupt at
+ * the end of it starts the next event (or silences the buzzer).
+ *
+ * BuzzerSeq_Play() never touches the buzzer or the timer. It publishes the
+ * event and sets the timer interrupt pending; the handler then starts it if
+ * nothing is playing, or leaves it queued. Since the handler always runs
+ * after the event was published, an event can never be stranded in the queue.
+ * BuzzerSeq_Play_Now() publishes the same way and then sets cut, which the
+ * handler takes as "stop, and start from the newest event".
+ */
+
+#define BUZZERSEQ_QUEUE_MASK (BUZZERSEQ_QUEUE_LEN - 1)
+
+void BuzzerSeq_Clock_Changed(BuzzerSeq_cfg_t* cfg)
+{
+    if (!cfg->setup_done) {
+        return;
+    }
+    TIM_TypeDef* tim = cfg->htim->Instance;
+    tim->PSC = (ClockProfile_Timer_Hz(tim) / cfg->tick_freq_hz) - 1;
+    if (!(tim->CR1 & TIM_CR1_CEN)) {
+        // Idle: load it now (URS, so no interrupt), or the next event would run at the old rate
+        tim->EGR = TIM_EGR_UG;
+        __HAL_TIM_CLEAR_FLAG(cfg->htim, TIM_FLAG_UPDATE);
+    }
+}
+
+static IRQn_Type timer_irqn(BuzzerSeq_cfg_t* cfg)
+{
+    return (cfg->htim->Instance == TIM6) ? TIM6_DAC_IRQn : TIM7_IRQn;
+}
+
+void BuzzerSeq_Init(BuzzerSeq_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    cfg->head = 0;
+    cfg->tail = 0;
+    cfg->active = 0;
+    cfg->cut = 0;
+    cfg->dropped = 0;
+
+    TIM_TypeDef* tim = cfg->htim->Instance;
+    tim->CR1 = 0;
+    tim->PSC = (ClockProfile_Timer_Hz(tim) / cfg->tick_freq_hz) - 1;
+    // Load the prescaler now; URS keeps this (and later) forced updates from interrupting
+    tim->CR1 = TIM_CR1_URS;
+    tim->EGR = TIM_EGR_UG;
+    __HAL_TIM_CLEAR_FLAG(cfg->htim, TIM_FLAG_UPDATE);
+    // One-pulse: the counter stops itself at the end of each event
+    tim->CR1 = TIM_CR1_URS | TIM_CR1_OPM;
+    tim->DIER = TIM_DIER_UIE;
+    NVIC_EnableIRQ(timer_irqn(cfg));
+
+    cfg->setup_done = 1;
+}
+
+uint8_t BuzzerSeq_Play(BuzzerSeq_cfg_t* cfg, uint16_t freq_hz, uint8_t volume_percent, uint16_t duration_ms)
+{
+    uint8_t head = cfg->head;
+    if ((uint8_t)(head - cfg->tail) >= BUZZERSEQ_QUEUE_LEN) {
+        cfg->dropped++;
+        return 0;
+    }
+
+    BuzzerSeq_Event_t* event = &cfg->queue[head & BUZZERSEQ_QUEUE_MASK];
+    event->freq_hz = freq_hz;
+    event->volume_percent = volume_percent;
+    event->duration_ms = duration_ms;
+    buzzer_tone_ticks(cfg->buzzer, freq_hz, volume_percent, &event->tone);
+
+    // The event must be in memory before the interrupt can see the new head
+    __DMB();
+    cfg->head = head + 1;
+    NVIC_SetPendingIRQ(timer_irqn(cfg));
+    return 1;
+}
+
+uint8_t BuzzerSeq_Play_Now(BuzzerSeq_cfg_t* cfg, uint16_t freq_hz, uint8_t volume_percent, uint16_t duration_ms)
+{
+    if (!BuzzerSeq_Play(cfg, freq_hz, volume_percent, duration_ms)) {
+        return 0;
+    }
+    // After the new head: a handler run in between has seen it already, and the next one cuts
+    cfg->cut = 1;
+    NVIC_SetPendingIRQ(timer_irqn(cfg));
+    return 1;
+}
+
+uint8_t BuzzerSeq_Is_Idle(BuzzerSeq_cfg_t* cfg)
+{
+    return (cfg->head == cfg->tail && !cfg->active) ? 1u : 0u;
+}
+
+void BuzzerSeq_IRQHandler(BuzzerSeq_cfg_t* cfg)
+{
+    TIM_TypeDef* tim = cfg->htim->Instance;
+    if (tim->SR & TIM_SR_UIF) {
+        __HAL_TIM_CLEAR_FLAG(cfg->htim, TIM_FLAG_UPDATE);
+        cfg->active = 0;
+    }
+
+    // BuzzerSeq_Play_Now(): unless its event is the one playing already, stop the one timing
+    // and drop everything queued before it. The handler is the only one to move tail, and
+    // the main loop cannot run in the middle of it
+    if (cfg->cut) {
+        cfg->cut = 0;
+        uint8_t head = cfg->head;
+        if (head != cfg->tail) {
+            tim->CR1 &= ~TIM_CR1_CEN;
+            __HAL_TIM_CLEAR_FLAG(cfg->htim, TIM_FLAG_UPDATE);
+            cfg->tail = head - 1;
+            cfg->active = 0;
+        }
+    }
+
+    // Woken by BuzzerSeq_Play() while an event is still timing: it waits its turn
+    if (cfg->active) {
+        return;
+    }
+
+    uint8_t tail = cfg->tail;
+    if (tail == cfg->head) {
+        buzzer_off(cfg->buzzer);
+        return;
+    }
+
+    BuzzerSeq_Event_t event = cfg->queue[tail & BUZZERSEQ_QUEUE_MASK];
+    __DMB();
+    cfg->tail = tail + 1;
+
+    // A tone straight after a tone is two preloaded register writes. Otherwise buzzer_tone()
+    // starts the PWM, or turns it off for a rest (0Hz or 0%)
+    Buzzer_cfg_t* buzzer = cfg->buzzer;
+    if (event.tone.ccr != 0 && buzzer->pwm_started && !buzzer_wave_busy(buzzer)) {
+        buzzer_tone_fast(buzzer, &event.tone);
+    } else {
+        buzzer_tone(buzzer, event.freq_hz, event.volume_percent);
+    }
+
+    uint32_t ticks = ((uint32_t)event.duration_ms * cfg->tick_freq_hz) / 1000u;
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    if (ticks > 0x10000u) {
+        ticks = 0x10000u;
+    }
+    tim->ARR = ticks - 1;
+    tim->CNT = 0;
+    cfg->active = 1;
+    tim->CR1 |= TIM_CR1_CEN;
+}
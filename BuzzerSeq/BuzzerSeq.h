@@ -0,0 +1,147 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+#include "Buzzer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file BuzzerSeq.h
+ * @brief Interrupt-driven buzzer sequencer for STM32L4
+ *
+ * Plays queued (frequency, volume, duration) events on a Buzzer library
+ * instance, timed by a basic timer (TIM6/TIM7) in one-pulse mode. Game code
+ * queues an event and returns at once; each event starts and stops on the
+ * timer interrupt, so durations are exact to the timer tick instead of
+ * being rounded to the frame period.
+ *
+ * The queue is a single-producer, single-consumer ring: only BuzzerSeq_Play()
+ * (main loop) moves head and only the interrupt moves tail, so no locking is
+ * needed. Call BuzzerSeq_Play() from one context only.
+ *
+ * Example usage:
+ * @code
+ * BuzzerSeq_cfg_t buzzer_seq = {
+ *     .buzzer = &buzzer_cfg,
+ *     .htim = &htim7,
+ *     .tick_freq_hz = 10000,   // 0.1ms resolution, events up to 6.5s
+ *     .setup_done = 0
+ * };
+ *
+ * BuzzerSeq_Init(&buzzer_seq);
+ * BuzzerSeq_Play(&buzzer_seq, NOTE_C5, 50, 100);  // queued back to back
+ * BuzzerSeq_Play(&buzzer_seq, 0, 0, 50);          // 50ms rest
+ * BuzzerSeq_Play(&buzzer_seq, NOTE_G5, 50, 200);
+ *
+ * // In TIMx_IRQHandler(), before HAL_TIM_IRQHandler():
+ * BuzzerSeq_IRQHandler(&buzzer_seq);
+ * @endcode
+ */
+
+#define BUZZERSEQ_QUEUE_LEN 16  ///< Events that can be queued (power of 2)
+
+/**
+ * @struct BuzzerSeq_Event_t
+ * @brief One queued tone or rest
+ */
+typedef struct {
+    uint16_t freq_hz;       ///< Tone frequency in Hz, or 0 for silence
+    uint8_t volume_percent; ///< 0..100 (0 => silence)
+    uint16_t duration_ms;   ///< How long the tone (or rest) lasts
+    Buzzer_Tone_t tone;     ///< Timer values, worked out by BuzzerSeq_Play() rather than in the interrupt
+} BuzzerSeq_Event_t;
+
+/**
+ * @struct BuzzerSeq_cfg_t
+ * @brief Configuration and queue for a buzzer sequencer instance
+ *
+ * @details The timer's prescaler, auto-reload and mode are reprogrammed by
+ * BuzzerSeq_Init(), so only the CubeMX base init (clock and NVIC) is required.
+ * The longest event is 65536 / tick_freq_hz seconds.
+ */
+typedef struct {
+    Buzzer_cfg_t* buzzer;                           ///< Buzzer to play on (owned by the sequencer after Init)
+    TIM_HandleTypeDef* htim;                        ///< Basic timer timing the events (e.g., &htim7)
+    uint32_t tick_freq_hz;                          ///< Timer tick frequency after prescaler (Hz)
+    uint8_t setup_done;                             ///< Internal flag: 1 if initialized, 0 otherwise
+    BuzzerSeq_Event_t queue[BUZZERSEQ_QUEUE_LEN];   ///< Internal: event ring
+    volatile uint8_t head;                          ///< Internal: next free slot, written by BuzzerSeq_Play() only
+    volatile uint8_t tail;                          ///< Internal: next event to play, written by the interrupt only
+    volatile uint8_t active;                        ///< Internal: 1 while an event is timing (interrupt only)
+    volatile uint8_t cut;                           ///< Internal: set by BuzzerSeq_Play_Now(), cleared by the interrupt
+    uint32_t dropped;                               ///< Internal: events not queued because the ring was full
+} BuzzerSeq_cfg_t;
+
+/**
+ * @brief Initialize the sequencer and its timer
+ *
+ * @param cfg Pointer to sequencer configuration struct
+ *
+ * @note The timer must be initialized by CubeMX (MX_TIMx_Init) first, and the
+ *       buzzer by buzzer_init()
+ */
+void BuzzerSeq_Init(BuzzerSeq_cfg_t* cfg);
+
+/**
+ * @brief Queue a tone (or a rest, with freq_hz or volume_percent 0)
+ *
+ * Starts straight away if nothing is playing, otherwise after the events
+ * already queued. Never blocks.
+ *
+ * @param cfg Pointer to sequencer configuration struct
+ * @param freq_hz Tone frequency in Hz, or 0 for silence
+ * @param volume_percent 0..100
+ * @param duration_ms Length of the event in ms
+ * @return 1 if queued, 0 if the queue was full (the event is dropped)
+ */
+uint8_t BuzzerSeq_Play(BuzzerSeq_cfg_t* cfg, uint16_t freq_hz, uint8_t volume_percent, uint16_t duration_ms);
+
+/**
+ * @brief Play a tone straight away, cutting off whatever is playing or queued
+ *
+ * For sound effects, where a new one matters more than the end of the last.
+ * The interrupt stops the event timing, skips the ones queued behind it and
+ * starts this one. Never blocks.
+ *
+ * @param cfg Pointer to sequencer configuration struct
+ * @param freq_hz Tone frequency in Hz, or 0 for silence
+ * @param volume_percent 0..100
+ * @param duration_ms Length of the event in ms
+ * @return 1 if queued, 0 if the queue was full (the event is dropped)
+ */
+uint8_t BuzzerSeq_Play_Now(BuzzerSeq_cfg_t* cfg, uint16_t freq_hz, uint8_t volume_percent, uint16_t duration_ms);
+
+/**
+ * @brief Check whether anything is playing or queued
+ *
+ * @param cfg Pointer to sequencer configuration struct
+ * @return 1 if the queue is empty and the last event has finished
+ */
+uint8_t BuzzerSeq_Is_Idle(BuzzerSeq_cfg_t* cfg);
+
+/**
+ * @brief Keep tick_freq_hz after the core clock changed (e.g. ClockProfile_Set())
+ *
+ * Sets the prescaler from the timer's new kernel clock. An event already playing
+ * finishes at the old rate, the ones after it are timed at the new one.
+ *
+ * @param cfg Pointer to sequencer configuration struct
+ */
+void BuzzerSeq_Clock_Changed(BuzzerSeq_cfg_t* cfg);
+
+/**
+ * @brief Sequencer timer interrupt handler
+ *
+ * Call from the timer's IRQ handler (TIM7_IRQHandler or TIM6_DAC_IRQHandler),
+ * ahead of HAL_TIM_IRQHandler(). It clears the update flag itself, and also
+ * runs when BuzzerSeq_Play() sets the interrupt pending to start an event.
+ *
+ * @param cfg Pointer to sequencer configuration struct
+ */
+void BuzzerSeq_IRQHandler(BuzzerSeq_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,127 @@
+#include "ClockProfile.h"
+#include "stm32l4xx_hal.h"
+
+/**
+ * @file ClockProfile.c
+ * @brief Implementation of the clock profiles
+ *
+ * Going down, SYSCLK moves to HSI16 before the PLL is stopped and the voltage
+ * lowered; going up, the voltage is raised first. The full profile is read back
+ * from the RCC on the first switch rather than duplicated here, so it stays
+ * whatever SystemClock_Config() sets.
+ */
+
+// Range 2 needs 2 wait states from 12 to 18MHz
+#define LOW_FLASH_LATENCY FLASH_LATENCY_2
+
+// PLLSAI1 Q and R divided by 8 (both field bits set)
+#define PLLSAI1_LOW_DIVIDERS (RCC_PLLSAI1CFGR_PLLSAI1Q | RCC_PLLSAI1CFGR_PLLSAI1R)
+
+static ClockProfile_t active = CLOCK_PROFILE_FULL;
+static uint8_t full_saved = 0;
+static RCC_OscInitTypeDef full_osc;
+static RCC_ClkInitTypeDef full_clk;
+static uint32_t full_latency;
+static uint32_t full_pllsai1;
+
+// Reprogram PLLSAI1 if it is running (it has to be stopped to change its dividers)
+static void pllsai1_write(uint32_t cfgr)
+{
+    if (!(RCC->CR & RCC_CR_PLLSAI1ON)) {
+        return;
+    }
+    CLEAR_BIT(RCC->CR, RCC_CR_PLLSAI1ON);
+    while (RCC->CR & RCC_CR_PLLSAI1RDY) {
+    }
+    RCC->PLLSAI1CFGR = cfgr;
+    SET_BIT(RCC->CR, RCC_CR_PLLSAI1ON);
+    while (!(RCC->CR & RCC_CR_PLLSAI1RDY)) {
+    }
+}
+
+static HAL_StatusTypeDef enter_low(void)
+{
+    if (!full_saved) {
+        HAL_RCC_GetOscConfig(&full_osc);
+        HAL_RCC_GetClockConfig(&full_clk, &full_latency);
+        full_clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+        full_saved = 1;
+    }
+    full_pllsai1 = RCC->PLLSAI1CFGR;
+
+    RCC_OscInitTypeDef osc = {0};
+    osc.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+    osc.HSIState = RCC_HSI_ON;
+    osc.HSICalibrationValue = full_osc.HSICalibrationValue;
+    osc.PLL.PLLState = RCC_PLL_NONE;
+    HAL_StatusTypeDef status = HAL_RCC_OscConfig(&osc);
+    if (status != HAL_OK) {
+        return status;
+    }
+
+    RCC_ClkInitTypeDef clk = {0};
+    clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clk.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+    clk.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    clk.APB1CLKDivider = RCC_HCLK_DIV1;
+    clk.APB2CLKDivider = RCC_HCLK_DIV1;
+    status = HAL_RCC_ClockConfig(&clk, LOW_FLASH_LATENCY);
+    if (status != HAL_OK) {
+        return status;
+    }
+
+    // Nothing runs from the main PLL now. Stopped here rather than with HAL_RCC_OscConfig(),
+    // which also clears PLLSRC, the input PLLSAI1 shares
+    CLEAR_BIT(RCC->CR, RCC_CR_PLLON);
+    while (RCC->CR & RCC_CR_PLLRDY) {
+    }
+
+    pllsai1_write(full_pllsai1 | PLLSAI1_LOW_DIVIDERS);
+    return HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE2);
+}
+
+static HAL_StatusTypeDef enter_full(void)
+{
+    HAL_StatusTypeDef status = HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1);
+    if (status != HAL_OK) {
+        return status;
+    }
+    pllsai1_write(full_pllsai1);
+
+    // The PLL part of HAL_RCC_OscConfig() runs whatever OscillatorType says. The PLL's settings
+    // were left as they were, so this only starts it again
+    RCC_OscInitTypeDef osc = full_osc;
+    osc.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+    status = HAL_RCC_OscConfig(&osc);
+    if (status != HAL_OK) {
+        return status;
+    }
+    return HAL_RCC_ClockConfig(&full_clk, full_latency);
+}
+
+HAL_StatusTypeDef ClockProfile_Set(ClockProfile_t profile)
+{
+    if (profile == active) {
+        return HAL_OK;
+    }
+    HAL_StatusTypeDef status = (profile == CLOCK_PROFILE_LOW) ? enter_low() : enter_full();
+    if (status == HAL_OK) {
+        active = profile;
+    }
+    return status;
+}
+
+ClockProfile_t ClockProfile_Get(void)
+{
+    return active;
+}
+
+uint32_t ClockProfile_Timer_Hz(const TIM_TypeDef* tim)
+{
+    if ((uint32_t)tim >= APB2PERIPH_BASE) {
+        uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+        return (RCC->CFGR & RCC_CFGR_PPRE2_2) ? pclk2 * 2 : pclk2;
+    }
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+    return (RCC->CFGR & RCC_CFGR_PPRE1_2) ? pclk1 * 2 : pclk1;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file ClockProfile.h
+ * @brief Switching the STM32L4 core clock between a full-speed and a low-power profile
+ *
+ * Gameplay needs the 80MHz PLL, but the splash and game over screens only wait.
+ * ClockProfile_Set() moves between:
+ * - CLOCK_PROFILE_FULL: whatever SystemClock_Config() set up (80MHz PLL, voltage range 1)
+ * - CLOCK_PROFILE_LOW: 16MHz straight from HSI16, main PLL off, voltage range 2
+ *
+ * Only the clock tree changes. SysTick follows by itself (HAL_RCC_ClockConfig()), but
+ * timers, the UART baud rate and so on were worked out from the old clock: call each
+ * module's clock-changed function afterwards so their rates stay the same, e.g.
+ *
+ * @code
+ * LCD_Refresh_Wait();                    // No SPI transfer across the switch
+ * Joystick_Pause(&joystick_cfg);         // The ADC clock changes too (PLLSAI1, see below)
+ * if (ClockProfile_Set(CLOCK_PROFILE_LOW) != HAL_OK) Error_Handler();
+ * UartLog_Clock_Changed(&uart_log);      // BRR
+ * buzzer_clock_changed(&buzzer_cfg);     // TIM2 prescaler, tick_freq_hz kept
+ * PWM_Clock_Changed(&pwm_cfg);           // TIM4 prescaler
+ * BuzzerSeq_Clock_Changed(&buzzer_seq);  // TIM7 prescaler
+ * Joystick_Resume(&joystick_cfg);
+ * @endcode
+ *
+ * The SPI needs nothing: its divider is kept, so SCLK scales with APB1 (8MHz with
+ * ST7789V2_BAUD_DIV_2 in the low profile). FrameTimer_Init() reads the clock when
+ * it runs, so start the frame timer after switching back to full speed.
+ *
+ * Range 2 allows at most 26MHz from the PLLs and 128MHz VCOs, so while in the low
+ * profile the PLLSAI1 Q and R outputs (RNG and ADC kernel clocks) are divided by
+ * 8 instead: 16MHz from a 128MHz VCO. Do not use the RNG in the low profile.
+ */
+
+/**
+ * @enum ClockProfile_t
+ * @brief Core clock profiles
+ */
+typedef enum {
+    CLOCK_PROFILE_FULL = 0,     ///< Clocks as SystemClock_Config() left them (gameplay)
+    CLOCK_PROFILE_LOW           ///< 16MHz HSI16, voltage range 2 (static screens)
+} ClockProfile_t;
+
+/**
+ * @brief Core clock in the low profile (Hz)
+ */
+#define CLOCK_PROFILE_LOW_HZ 16000000u
+
+/**
+ * @brief Switch to a clock profile
+ *
+ * Does nothing if the profile is already active. The first switch to the low
+ * profile remembers the full profile's settings, so call it after
+ * SystemClock_Config() and PeriphCommonClock_Config().
+ *
+ * @param profile Profile to switch to
+ * @return HAL_OK, or the error of the HAL call that failed (the clocks may then be
+ *         part way between the profiles)
+ *
+ * @note No bus master may be using a peripheral clocked from SYSCLK, APB1/2 or
+ *       PLLSAI1 while it switches (see the example above)
+ */
+HAL_StatusTypeDef ClockProfile_Set(ClockProfile_t profile);
+
+/**
+ * @brief Get the active clock profile
+ *
+ * @return CLOCK_PROFILE_FULL until ClockProfile_Set() first switches away from it
+ */
+ClockProfile_t ClockProfile_Get(void);
+
+/**
+ * @brief Kernel clock of a timer in the current profile
+ *
+ * Its APB bus clock, doubled when that bus is divided (top PPRE bit set), as
+ * the reference manual's clock tree has it. For working out prescalers, so
+ * call it again from a module's clock-changed function.
+ *
+ * @param tim Timer instance (APB1 or APB2)
+ * @return Timer kernel clock (Hz)
+ */
+uint32_t ClockProfile_Timer_Hz(const TIM_TypeDef* tim);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,152 @@
+#include "Console.h"
+#include "stm32l4xx_hal.h"
+#include "DmaChannel.h"
+#include "DmaBuffer.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @file Console.c
+ * @brief Implementation of the UART command console
+ *
+ * The RX DMA runs in circular mode and is never stopped; the write position
+ * is the ring size minus CNDTR, as in LinkUart. The IDLE interrupt is only a
+ * hint that bytes have arrived: the flag is cleared before the ring is read,
+ * so a byte landing during the read sets it again and is picked up next time.
+ */
+
+#if (CONSOLE_RX_BYTES & (CONSOLE_RX_BYTES - 1)) != 0
+#error "CONSOLE_RX_BYTES must be a power of 2"
+#endif
+// The ring is a single circular run, CNDTR counting down from CONSOLE_RX_BYTES
+DMA_BUFFER_CHECK(((Console_cfg_t*)0)->rx_buf, 1);
+
+static IRQn_Type uart_irqn(Console_cfg_t* cfg)
+{
+    USART_TypeDef* uart = cfg->huart->Instance;
+    return (uart == USART1) ? USART1_IRQn : (uart == USART3) ? USART3_IRQn : USART2_IRQn;
+}
+
+// Splits the line into words in place and runs the command named by the first
+static void run_line(Console_cfg_t* cfg)
+{
+    char* argv[CONSOLE_MAX_ARGS];
+    int argc = 0;
+    char* p = cfg->line;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t') {
+            *p++ = '\0';
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (argc == CONSOLE_MAX_ARGS) {
+            printf("Too many words (at most %d)\n", CONSOLE_MAX_ARGS);
+            return;
+        }
+        argv[argc++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+    }
+    if (argc == 0) {
+        return;  // Empty line
+    }
+
+    if (strcmp(argv[0], "help") == 0) {
+        for (uint8_t i = 0; i < cfg->command_count; i++) {
+            printf("  %s\n", cfg->commands[i].help);
+        }
+        return;
+    }
+    for (uint8_t i = 0; i < cfg->command_count; i++) {
+        if (strcmp(argv[0], cfg->commands[i].name) == 0) {
+            cfg->commands[i].run(argc, argv);
+            return;
+        }
+    }
+    printf("Unknown command '%s', try help\n", argv[0]);
+}
+
+void Console_Init(Console_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+    if (DmaChannel_Claim(cfg->dma_channel, cfg->dma_request, cfg, "Console") != DMACHANNEL_OK) {
+        return;  // No input, and not set up: Console_Poll() does nothing
+    }
+
+    cfg->rx_tail = 0;
+    cfg->line_length = 0;
+    cfg->line_overflow = 0;
+    cfg->rx_idle = 0;
+
+    // RX DMA: peripheral to memory, 8-bit, increment memory, circular, no interrupts
+    cfg->dma_channel->CCR = 0;
+    cfg->dma_channel->CPAR = (uint32_t)&cfg->huart->Instance->RDR;
+    cfg->dma_channel->CMAR = (uint32_t)cfg->rx_buf;
+    cfg->dma_channel->CNDTR = CONSOLE_RX_BYTES;
+    cfg->dma_channel->CCR = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_EN;
+
+    // OVRDIS can only be changed with the UART disabled: let the log's last bytes out first.
+    // A byte lost to an overrun only spoils a typed line, but an overrun would stop reception.
+    while (!__HAL_UART_GET_FLAG(cfg->huart, UART_FLAG_TC)) {
+    }
+    __HAL_UART_DISABLE(cfg->huart);
+    SET_BIT(cfg->huart->Instance->CR3, USART_CR3_OVRDIS | USART_CR3_DMAR);
+    __HAL_UART_ENABLE(cfg->huart);
+    cfg->huart->Instance->ICR = USART_ICR_IDLECF;
+    SET_BIT(cfg->huart->Instance->CR1, USART_CR1_IDLEIE);
+
+    // Someone typing can wait: the lowest priority
+    NVIC_SetPriority(uart_irqn(cfg), 15);
+    NVIC_EnableIRQ(uart_irqn(cfg));
+
+    cfg->setup_done = 1;
+}
+
+uint8_t Console_Poll(Console_cfg_t* cfg)
+{
+    if (!cfg->setup_done || !cfg->rx_idle) {
+        return 0;
+    }
+    cfg->rx_idle = 0;
+
+    uint8_t lines = 0;
+    uint32_t head = (CONSOLE_RX_BYTES - cfg->dma_channel->CNDTR) & (CONSOLE_RX_BYTES - 1u);
+    while (cfg->rx_tail != head) {
+        const char c = (char)cfg->rx_buf[cfg->rx_tail];
+        cfg->rx_tail = (cfg->rx_tail + 1u) & (CONSOLE_RX_BYTES - 1u);
+
+        if (c == '\r' || c == '\n') {
+            if (cfg->line_overflow) {
+                printf("Line too long (at most %d characters)\n", CONSOLE_LINE_BYTES);
+            } else if (cfg->line_length > 0) {
+                cfg->line[cfg->line_length] = '\0';
+                run_line(cfg);
+                lines++;
+            }
+            cfg->line_length = 0;
+            cfg->line_overflow = 0;
+        } else if (c == '\b' || c == 0x7F) {
+            if (cfg->line_length > 0) {
+                cfg->line_length--;
+            }
+        } else if (cfg->line_length < CONSOLE_LINE_BYTES) {
+            cfg->line[cfg->line_length++] = c;
+        } else {
+            cfg->line_overflow = 1;
+        }
+    }
+    return lines;
+}
+
+void Console_IRQHandler(Console_cfg_t* cfg)
+{
+    if (!(cfg->huart->Instance->ISR & USART_ISR_IDLE)) {
+        return;
+    }
+    cfg->huart->Instance->ICR = USART_ICR_IDLECF;
+    cfg->rx_idle = 1;
+}
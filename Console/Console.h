@@ -0,0 +1,136 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Console.h
+ * @brief Line-based command shell on the log UART's receive side
+ *
+ * Typed characters are collected by a circular RX DMA in the background, as
+ * in LinkUart, so nothing is lost while a frame is being drawn and receiving
+ * costs no interrupt per byte. The UART's IDLE interrupt (a character time
+ * with no new byte) only sets a flag: Console_Poll() in the main loop costs a
+ * load and a compare until something has been typed. It then takes the new
+ * bytes, and each complete line (ended by CR or LF) is split into words and
+ * handed to the command whose name is the first word. Replies go out through
+ * printf, i.e. the UartLog ring, so a command never waits for the UART either.
+ *
+ * The commands run in the main loop, between frames, so they can change game
+ * and LCD settings without any locking. "help" is built in and lists the
+ * table. A line longer than CONSOLE_LINE_BYTES is thrown away whole. Typed
+ * characters are not echoed back: turn on the terminal's local echo.
+ *
+ * The UART is the one CubeMX set up for the log (USART2, TX and RX on the
+ * ST-LINK's virtual COM port). RX uses DMA1_Channel6 (USART2_RX, request 2);
+ * TX stays with UartLog on DMA1_Channel7.
+ *
+ * Example usage:
+ * @code
+ * static void set_fps(int argc, char** argv) { ... }
+ * static const Console_Command_t commands[] = {
+ *     {"fps", "fps <n>: frames a second", set_fps},
+ * };
+ * Console_cfg_t console = {
+ *     .huart = &huart2,
+ *     .dma_channel = DMA1_Channel6,   // USART2_RX
+ *     .dma_request = 2,
+ *     .commands = commands,
+ *     .command_count = 1,
+ *     .setup_done = 0
+ * };
+ *
+ * Console_Init(&console);   // after UartLog_Init()
+ *
+ * // Main loop, once a frame:
+ * Console_Poll(&console);
+ *
+ * // In USART2_IRQHandler():
+ * Console_IRQHandler(&console);
+ * @endcode
+ */
+
+/**
+ * @brief Receive ring size in bytes (power of 2)
+ *
+ * Typing (or pasting) a line at 115200 baud fills about 192 bytes per 60Hz
+ * frame at most, so this holds over a frame's worth before Console_Poll().
+ */
+#ifndef CONSOLE_RX_BYTES
+#define CONSOLE_RX_BYTES 256
+#endif
+
+#define CONSOLE_LINE_BYTES 64   ///< Longest command line, the line end not included
+#define CONSOLE_MAX_ARGS 6      ///< Most words on a line, the command name included
+
+/**
+ * @brief Runs a command
+ *
+ * @param argc Number of words on the line, at least 1
+ * @param argv The words, argv[0] being the command name; valid until the call returns
+ */
+typedef void (*Console_Fn_t)(int argc, char** argv);
+
+/**
+ * @struct Console_Command_t
+ * @brief One entry of the command table
+ */
+typedef struct {
+    const char* name;   ///< First word of the line that runs it
+    const char* help;   ///< One line for "help", usage first (e.g. "set fps <n>: ...")
+    Console_Fn_t run;   ///< Called from Console_Poll()
+} Console_Command_t;
+
+/**
+ * @struct Console_cfg_t
+ * @brief Configuration, receive ring and line buffer of a console
+ */
+typedef struct {
+    UART_HandleTypeDef* huart;          ///< UART to read (e.g., &huart2), initialised by CubeMX
+    DMA_Channel_TypeDef* dma_channel;   ///< DMA channel of the UART's RX request (USART2_RX: DMA1_Channel6)
+    uint8_t dma_request;                ///< DMA request number for that channel (CSELR), 2 for USART2_RX
+    const Console_Command_t* commands;  ///< Command table
+    uint8_t command_count;              ///< Entries in commands
+    uint8_t setup_done;                 ///< Internal flag: 1 if initialized, 0 otherwise
+    uint8_t rx_buf[CONSOLE_RX_BYTES];   ///< Internal: receive ring, written by the DMA
+    uint32_t rx_tail;                   ///< Internal: next ring index Console_Poll() reads
+    char line[CONSOLE_LINE_BYTES + 1];  ///< Internal: line being typed, NUL-terminated when run
+    uint8_t line_length;                ///< Internal: characters in line
+    uint8_t line_overflow;              ///< Internal: 1 if the line being typed is too long
+    volatile uint8_t rx_idle;           ///< Internal: set by the IDLE interrupt, bytes to read
+} Console_cfg_t;
+
+/**
+ * @brief Start the RX DMA into the ring and enable the UART's IDLE interrupt
+ *
+ * @param cfg Pointer to console configuration struct
+ *
+ * @note The UART must be initialized by CubeMX (MX_USARTx_UART_Init) first.
+ */
+void Console_Init(Console_cfg_t* cfg);
+
+/**
+ * @brief Read what has been typed and run each complete line
+ *
+ * Returns straight away if nothing has arrived since the last call.
+ *
+ * @param cfg Pointer to console configuration struct
+ * @return Number of lines run (unknown commands included)
+ */
+uint8_t Console_Poll(Console_cfg_t* cfg);
+
+/**
+ * @brief UART interrupt handler (the line went idle: bytes are waiting)
+ *
+ * Call from the UART's IRQ handler.
+ *
+ * @param cfg Pointer to console configuration struct
+ */
+void Console_IRQHandler(Console_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,98 @@
+/**
+ * @file FreeRTOSConfig.h
+ * @brief FreeRTOS kernel settings for the PONG_RTOS build (CMSIS-RTOS2 wrapper, Cortex-M4F at 80MHz)
+ *
+ * Only used when the PONG_RTOS CMake option builds the kernel in (see the
+ * README). The kernel tick is SysTick at 1kHz, shared with the HAL tick
+ * (stm32l4xx_it.c calls xPortSysTickHandler() once the kernel has started),
+ * and the port takes over SVC and PendSV.
+ *
+ * Interrupts at NVIC priority 5 or lower (numerically 5-15) may call the
+ * ...FromISR() / osThreadFlagsSet() API; rtos_play() moves TIM6 and the LCD
+ * DMA there. Higher-priority interrupts (the buzzer TIM7/DMA, USART) are never
+ * masked by the kernel and must not call it.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#if defined(__GNUC__) || defined(__ICCARM__)
+#include <stdint.h>
+extern uint32_t SystemCoreClock;
+#endif
+
+#define configUSE_PREEMPTION                     1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION  0    // Needs 32 priorities or fewer
+#define configUSE_TICKLESS_IDLE                  0
+#define configCPU_CLOCK_HZ                       (SystemCoreClock)
+#define configTICK_RATE_HZ                       ((TickType_t)1000)
+#define configMAX_PRIORITIES                     56   // CMSIS-RTOS2 osPriority_t range
+#define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
+#define configMAX_TASK_NAME_LEN                  16
+#define configUSE_16_BIT_TICKS                   0
+#define configIDLE_SHOULD_YIELD                  1
+#define configUSE_TASK_NOTIFICATIONS             1
+#define configUSE_MUTEXES                        1
+#define configUSE_RECURSIVE_MUTEXES              1
+#define configUSE_COUNTING_SEMAPHORES            1
+#define configQUEUE_REGISTRY_SIZE                0
+#define configUSE_NEWLIB_REENTRANT               0
+#define configENABLE_BACKWARD_COMPATIBILITY      0
+#define configUSE_OS2_THREAD_FLAGS               1
+
+// Memory: heap_4 holds the three task stacks (6KB) plus the kernel objects
+#define configSUPPORT_STATIC_ALLOCATION          1
+#define configSUPPORT_DYNAMIC_ALLOCATION         1
+#define configTOTAL_HEAP_SIZE                    ((size_t)(10 * 1024))
+
+// Hooks: the idle hook sleeps with WFI and counts the time for PONG_DUTY_STATS
+#define configUSE_IDLE_HOOK                      1
+#define configUSE_TICK_HOOK                      0
+#define configUSE_MALLOC_FAILED_HOOK             0
+#define configCHECK_FOR_STACK_OVERFLOW           0
+
+// Run time and task statistics
+#define configGENERATE_RUN_TIME_STATS            0
+#define configUSE_TRACE_FACILITY                 1
+#define configUSE_STATS_FORMATTING_FUNCTIONS     0
+
+// Software timers (cmsis_os2.c needs them built, the game does not use them)
+#define configUSE_TIMERS                         1
+#define configTIMER_TASK_PRIORITY                2
+#define configTIMER_QUEUE_LENGTH                 4
+#define configTIMER_TASK_STACK_DEPTH             256
+
+// API functions cmsis_os2.c calls
+#define INCLUDE_vTaskPrioritySet                 1
+#define INCLUDE_uxTaskPriorityGet                1
+#define INCLUDE_vTaskDelete                      1
+#define INCLUDE_vTaskSuspend                     1
+#define INCLUDE_vTaskDelayUntil                  1
+#define INCLUDE_xTaskDelayUntil                  1
+#define INCLUDE_vTaskDelay                       1
+#define INCLUDE_xTaskGetSchedulerState           1
+#define INCLUDE_xTaskGetCurrentTaskHandle        1
+#define INCLUDE_uxTaskGetStackHighWaterMark      1
+#define INCLUDE_eTaskGetState                    1
+#define INCLUDE_xTimerPendFunctionCall           1
+
+// Cortex-M4 NVIC: 4 priority bits
+#ifdef __NVIC_PRIO_BITS
+#define configPRIO_BITS __NVIC_PRIO_BITS
+#else
+#define configPRIO_BITS 4
+#endif
+
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY       15
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY  5
+#define configKERNEL_INTERRUPT_PRIORITY      (configLIBRARY_LOWEST_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+
+#define configASSERT(x) if ((x) == 0) { taskDISABLE_INTERRUPTS(); for (;;) {} }
+
+// The port's handlers take the core's vector names; SysTick stays in stm32l4xx_it.c
+#define vPortSVCHandler    SVC_Handler
+#define xPortPendSVHandler PendSV_Handler
+#define USE_CUSTOM_SYSTICK_HANDLER_IMPLEMENTATION 1
+
+#endif // FREERTOS_CONFIG_H
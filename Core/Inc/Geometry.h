@@ -0,0 +1,93 @@
+/**
+ * @file Geometry.h
+ * @brief Playfield size shared by every game module, and where it goes on the panel
+ *
+ * The one place the court size comes from. SCREEN_WIDTH x SCREEN_HEIGHT is
+ * the logical playfield the game runs in: 240x240 unless set on the command
+ * line, whatever the panel. Physics, the grid, the AI and replays only ever
+ * see these co-ordinates, so a game plays (and a replay replays) the same on
+ * every panel.
+ *
+ * On the board the court is drawn onto the panel of ST7789V2_Driver.h
+ * (ST7789V2_WIDTH x ST7789V2_HEIGHT, e.g. set with -D for a 240x320 or
+ * 135x240 ST7789 panel): scaled by PLAYFIELD_NUM/PLAYFIELD_DEN to fit, and
+ * centred, with the bars either side left to the HUD. The draw code maps its
+ * co-ordinates through PLAYFIELD_X()/PLAYFIELD_Y() per shape, not per pixel:
+ * with constant scale and offset that is a multiply and a shift or an add,
+ * and nothing at all when the court fills the panel (240x240 on 240x240).
+ * Headless builds have no panel and map the court onto itself.
+ *
+ * Everything here is a preprocessor constant, so loops bounded by it have
+ * constant trip counts the compiler can unroll and strength-reduce.
+ *
+ * Sprites are drawn at their baked size, only their position is mapped.
+ *
+ * Included by Utils.h, so every module that includes Utils.h has it.
+ */
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+// Logical court
+#ifndef SCREEN_WIDTH
+#define SCREEN_WIDTH  240
+#endif
+#ifndef SCREEN_HEIGHT
+#define SCREEN_HEIGHT 240
+#endif
+
+// Pixel co-ordinates are kept in bytes in places (LCD dirty spans, particles)
+#if SCREEN_WIDTH > 256 || SCREEN_HEIGHT > 256
+#error "SCREEN_WIDTH and SCREEN_HEIGHT must be at most 256"
+#endif
+
+#if !PONG_HEADLESS
+#include "ST7789V2_Driver.h"
+#define PANEL_WIDTH  ST7789V2_WIDTH
+#define PANEL_HEIGHT ST7789V2_HEIGHT
+#else
+#define PANEL_WIDTH  SCREEN_WIDTH
+#define PANEL_HEIGHT SCREEN_HEIGHT
+#endif
+
+// Scale: the court fills whichever of the panel's width or height runs out first
+#if PANEL_WIDTH * SCREEN_HEIGHT <= PANEL_HEIGHT * SCREEN_WIDTH
+#define PLAYFIELD_NUM PANEL_WIDTH
+#define PLAYFIELD_DEN SCREEN_WIDTH
+#else
+#define PLAYFIELD_NUM PANEL_HEIGHT
+#define PLAYFIELD_DEN SCREEN_HEIGHT
+#endif
+
+// 1 when court pixels are not panel pixels
+#define PLAYFIELD_SCALED (PLAYFIELD_NUM != PLAYFIELD_DEN)
+
+#if PLAYFIELD_SCALED
+#define PLAYFIELD_SCALE(v) ((int16_t)((int32_t)(v) * PLAYFIELD_NUM / PLAYFIELD_DEN))
+#else
+#define PLAYFIELD_SCALE(v) (v)
+#endif
+
+// The court on the panel: its size, and its top-left corner (the letterbox bars' width)
+#define PLAYFIELD_PANEL_WIDTH  (SCREEN_WIDTH * PLAYFIELD_NUM / PLAYFIELD_DEN)
+#define PLAYFIELD_PANEL_HEIGHT (SCREEN_HEIGHT * PLAYFIELD_NUM / PLAYFIELD_DEN)
+#define PLAYFIELD_X0 ((PANEL_WIDTH - PLAYFIELD_PANEL_WIDTH) / 2)
+#define PLAYFIELD_Y0 ((PANEL_HEIGHT - PLAYFIELD_PANEL_HEIGHT) / 2)
+
+// 1 when the court does not start at the panel's top-left corner
+#define PLAYFIELD_LETTERBOXED (PLAYFIELD_X0 != 0 || PLAYFIELD_Y0 != 0)
+
+// Court co-ordinates to panel co-ordinates
+#define PLAYFIELD_X(x) (PLAYFIELD_X0 + PLAYFIELD_SCALE(x))
+#define PLAYFIELD_Y(y) (PLAYFIELD_Y0 + PLAYFIELD_SCALE(y))
+
+// Panel length of a court length n starting at v: edges scale alike, so shapes side by side
+// (bricks, a paddle and the strip it erases) still meet without gaps or overlaps
+#define PLAYFIELD_LEN(v, n) (PLAYFIELD_SCALE((v) + (n)) - PLAYFIELD_SCALE(v))
+
+// Drawn positions are kept in bytes too (particles, phosphor runs)
+#if PLAYFIELD_PANEL_WIDTH > 256 || PLAYFIELD_PANEL_HEIGHT > 256
+#error "The court scaled onto the panel must be at most 256 pixels each way"
+#endif
+
+#endif // GEOMETRY_H
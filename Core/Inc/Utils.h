@@ -3,19 +3,36 @@
  * @brief Common utility structures and types for the Pong game
  * 
  * Includes position vectors, input structures, and collision detection types.
- * Uses Direction, Vector2D, and UserInput from Joystick.h
+ * Uses Direction, Vector2D, and UserInput from Joystick_Types.h
  *
- * NOTE: This header currently contains tiny static inline helpers.
- * If utilities grow more complex, move implementations to a .c file
- * and leave only prototypes here (standard .h/.c style).
+ * NOTE: This header mostly contains tiny static inline helpers.
+ * Larger utilities (AABB_Sweep, random seeding) are implemented in Utils.c with only
+ * their prototypes here (standard .h/.c style).
  */
 
 #ifndef UTILS_H
 #define UTILS_H
 
 #include <stdint.h>
-#include "Joystick.h"
-#include "rng.h"
+#include "Joystick_Types.h"
+
+// Set to 1 to build the game logic (PongEngine, Ball, Paddle, Bricks, SpatialGrid, Replay, Pool,
+// Particles, Utils) with a host compiler and no STM32 HAL, e.g. to simulate or benchmark millions of
+// steps on a PC. Drawing and beeps become no-ops and Random_Seed_Hardware() is left out.
+#ifndef PONG_HEADLESS
+#define PONG_HEADLESS 0
+#endif
+
+#include "Geometry.h"
+
+#if PONG_HEADLESS
+// Headless builds keep the geometry of retained LCD areas (bricks, paddles) only
+typedef struct LCD_Retained_Area {
+  uint16_t x, y;
+  uint16_t width, height;
+  uint8_t stale;
+} LCD_Retained_Area;
+#endif
 
 /* ===== POSITION TYPE ===== */
 
@@ -28,6 +45,57 @@ typedef struct {
     int16_t y;
 } Position2D;
 
+/* ===== FIXED-POINT MATHS ===== */
+
+/**
+ * @brief Q16.16 fixed-point number (16 integer bits, 16 fraction bits)
+ * 
+ * Lets positions and velocities carry fractions of a pixel using integer
+ * maths only: 5.656 pixels is stored as 5.656 * 65536 = 370671.
+ * Range is +/-32768 pixels with 1/65536 pixel resolution.
+ */
+typedef int32_t Fixed16;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE   ((Fixed16)1 << FIXED_SHIFT)
+
+/**
+ * @brief Convert a float constant to Q16.16
+ * 
+ * Macro so constant expressions fold at compile time (no float maths at runtime).
+ */
+#define FIXED_FROM_FLOAT(f) ((Fixed16)((f) * (float)FIXED_ONE))
+
+/**
+ * @struct FixedVector2D
+ * @brief 2D vector in Q16.16 fixed point
+ */
+typedef struct {
+    Fixed16 x;
+    Fixed16 y;
+} FixedVector2D;
+
+/**
+ * @brief Convert whole pixels to Q16.16
+ */
+static inline Fixed16 Fixed_FromInt(int16_t v) {
+    return (Fixed16)v * FIXED_ONE;
+}
+
+/**
+ * @brief Convert Q16.16 to whole pixels (rounds towards minus infinity)
+ */
+static inline int16_t Fixed_ToInt(Fixed16 v) {
+    return (int16_t)(v >> FIXED_SHIFT);
+}
+
+/**
+ * @brief Multiply two Q16.16 numbers
+ */
+static inline Fixed16 Fixed_Mul(Fixed16 a, Fixed16 b) {
+    return (Fixed16)(((int64_t)a * b) >> FIXED_SHIFT);
+}
+
 /* ===== AABB COLLISION DETECTION ===== */
 
 /**
@@ -71,34 +139,200 @@ typedef struct {
  * a.y + a.height > b.y         // A's bottom > B's top
  * ```
  * 
+ * The far edges (x + width, y + height) are summed as int32_t, so boxes
+ * reaching past INT16_MAX still compare right.
+ * 
  * NOTE: Defined as static inline in a header to avoid duplicate symbol errors.
  * This pattern is best kept for very small helper functions like this one.
  */
 static inline uint8_t AABB_Collides(AABB* a, AABB* b) {
-    return (a->x < b->x + b->width &&
-            a->x + a->width > b->x &&
-            a->y < b->y + b->height &&
-            a->y + a->height > b->y);
+    return (a->x < (int32_t)b->x + b->width &&
+            (int32_t)a->x + a->width > b->x &&
+            a->y < (int32_t)b->y + b->height &&
+            (int32_t)a->y + a->height > b->y);
+}
+
+/**
+ * @struct AABB_SoA
+ * @brief Many boxes as separate arrays (structure of arrays), for AABB_CollidesMany()
+ * 
+ * Arrays may be shared, e.g. width and height both pointing at the ball sizes.
+ */
+typedef struct {
+    const int16_t* x;       // Top-left X of each box
+    const int16_t* y;       // Top-left Y of each box
+    const int16_t* width;   // Width of each box
+    const int16_t* height;  // Height of each box
+} AABB_SoA;
+
+/**
+ * @function AABB_CollidesMany
+ * @brief Test one box against many: which of them AABB_Collides() with it
+ * 
+ * Each test is the four comparisons of AABB_Collides() worked as int32
+ * differences whose sign bits are ORed together, so there is no branch per
+ * comparison or per box, and the loop keeps going at one box every few
+ * cycles however the results fall.
+ * 
+ * @param box Box to test
+ * @param boxes Boxes to test it against
+ * @param n Number of boxes
+ * @param mask Bit i % 32 of word i / 32 set if box i collides; (n + 31) / 32 words
+ * @return Number of boxes that collide
+ */
+uint8_t AABB_CollidesMany(const AABB* box, const AABB_SoA* boxes, uint8_t n, uint32_t* mask);
+
+/* ===== INTERPOLATION ===== */
+
+/**
+ * @brief Full-scale value of an interpolation factor (1.0 in Q8)
+ */
+#define LERP_ONE 256
+
+/**
+ * @function Lerp_I16
+ * @brief Linear interpolation between two positions
+ * 
+ * Used to draw objects between their last two physics steps when the
+ * display runs at a different rate from the simulation.
+ * 
+ * @param from Value at the previous step
+ * @param to Value at the current step
+ * @param alpha Fraction from 0 (from) to LERP_ONE (to)
+ * @return Interpolated value, rounded to nearest
+ */
+static inline int16_t Lerp_I16(int16_t from, int16_t to, uint16_t alpha) {
+    return (int16_t)(from + (((int32_t)(to - from) * alpha + LERP_ONE / 2) >> 8));
+}
+
+/**
+ * @function Fixed_Lerp
+ * @brief Linear interpolation between two Q16.16 values
+ * 
+ * @param from Value at the previous step
+ * @param to Value at the current step
+ * @param alpha Fraction from 0 (from) to LERP_ONE (to)
+ * @return Interpolated value
+ */
+static inline Fixed16 Fixed_Lerp(Fixed16 from, Fixed16 to, uint16_t alpha) {
+    return from + (Fixed16)(((int64_t)(to - from) * alpha) >> 8);
 }
 
+/* ===== SWEPT (CONTINUOUS) COLLISION DETECTION ===== */
+
+/**
+ * @struct AABB_SweepResult
+ * @brief First contact between a moving box and a static box
+ */
+typedef struct {
+    uint8_t hit;        // 1 if the boxes touch during the move, 0 otherwise
+    Fixed16 time;       // Fraction of the move at first contact (0 to FIXED_ONE)
+    int8_t normal_x;    // Normal of the static box face that was hit (-1, 0 or 1)
+    int8_t normal_y;
+} AABB_SweepResult;
+
+/**
+ * @function AABB_Sweep
+ * @brief Find when a moving box first hits a static box (time of impact)
+ * 
+ * AABB_Collides() only checks where the box ends up, so a box moving further
+ * per step than the target is thick can jump straight over it ("tunnelling").
+ * AABB_Sweep() checks the whole path instead.
+ * 
+ * **How Swept AABB Works:**
+ * For each axis, find the fraction of the move at which the boxes start to
+ * overlap (entry) and stop overlapping (exit) on that axis. Boxes overlap when
+ * they overlap on BOTH axes, so contact starts at the later entry time:
+ * ```
+ * entry = max(entry_x, entry_y)     exit = min(exit_x, exit_y)
+ * hit if entry < exit and 0 <= entry <= 1
+ * ```
+ * The axis with the later entry gives the face that was hit (the normal).
+ * Boxes that already overlap at the start report a hit at time 0.
+ * 
+ * @param x Moving box X at the start of the move (Q16.16 pixels)
+ * @param y Moving box Y at the start of the move (Q16.16 pixels)
+ * @param width Moving box width in pixels
+ * @param height Moving box height in pixels
+ * @param move Displacement over the move (Q16.16 pixels)
+ * @param target Static box to test against
+ * @return Contact time and normal (hit = 0 if they never touch)
+ */
+AABB_SweepResult AABB_Sweep(Fixed16 x, Fixed16 y, int16_t width, int16_t height,
+                            FixedVector2D move, const AABB* target);
+
+/* ===== RANDOM NUMBERS ===== */
+
 /**
- * @brief Generate random number in range [0, max]
- * This function uses the RNG peripheral which returns a pseudorandom number
- * which is more random than the standard library rand() function.
+ * @brief State of the software random number generator (PCG32)
+ * 
+ * Defined in Utils.c. Only touch it through the Random_ functions.
+ */
+extern uint64_t random_state;
+
+/**
+ * @brief Seed the random number generator
+ * 
+ * The same seed always gives the same sequence, e.g. for repeatable tests.
+ * 
+ * @param seed Any value
+ */
+void Random_Seed(uint32_t seed);
+
+/**
+ * @brief Seed the random number generator from the RNG peripheral
+ * 
+ * Call once at startup, after MX_RNG_Init(). The hardware RNG is only read
+ * here: it blocks until a value is ready, which is too slow to do on every draw.
+ * 
+ * @return Seed that was used (0 if the RNG peripheral failed)
+ */
+#if !PONG_HEADLESS
+uint32_t Random_Seed_Hardware(void);
+#endif
+
+/**
+ * @brief Generate a random 32-bit number
+ * 
+ * PCG32 (permuted congruential generator): a 64-bit LCG step, output by an
+ * xorshift and a random rotation of the high bits. A handful of cycles on
+ * the Cortex-M4, with much better statistics than a plain LCG or xorshift.
  * 
  * NOTE: Defined as static inline in a header to avoid duplicate symbol errors.
  * This pattern is best kept for very small helper functions like this one.
  */
+static inline uint32_t Random_U32(void)
+{
+    uint64_t old = random_state;
+    random_state = old * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+/**
+ * @brief Generate random number in range [0, max)
+ * 
+ * Unbiased: uses Lemire's multiply-and-shift instead of %, which favours
+ * low values whenever max does not divide 2^32. The high half of
+ * Random_U32() * max is the result; the rare draws that would make some
+ * results more likely than others are rejected (at most max in 2^32 of them).
+ * 
+ * @param max Exclusive upper bound (0 returns 0)
+ */
 static inline uint16_t Random_U16(uint16_t max)
 {
-    uint32_t rnd = 0;
-    if (HAL_RNG_GenerateRandomNumber(&hrng, &rnd) != HAL_OK) {
-        return 0;
-    }
     if (max == 0) {
         return 0;
     }
-    return (uint16_t)(rnd % max);
+    uint64_t m = (uint64_t)Random_U32() * max;
+    if ((uint32_t)m < max) {
+        uint32_t threshold = (uint32_t)(-(uint32_t)max) % max;
+        while ((uint32_t)m < threshold) {
+            m = (uint64_t)Random_U32() * max;
+        }
+    }
+    return (uint16_t)(m >> 32);
 }
 
 #endif // UTILS_H
@@ -111,6 +111,10 @@ void Error_Handler(void);
 #define PWM_GPIO_Port GPIOB
 
 /* USER CODE BEGIN Private defines */
+// LD2 fault codes with PONG_STATUS_LED: the blinks before each pause (StatusLed.h)
+#define LED_FAULT_ERROR_HANDLER 1
+#define LED_FAULT_HARD_FAULT    2
+#define LED_FAULT_LCD           3
 
 /* USER CODE END Private defines */
 
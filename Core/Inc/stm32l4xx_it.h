@@ -63,6 +63,14 @@ void EXTI15_10_IRQHandler(void);
 void TIM6_DAC_IRQHandler(void);
 void TIM7_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void DMA1_Channel5_IRQHandler(void);
+void DMA1_Channel3_IRQHandler(void);
+void DMA2_Channel2_IRQHandler(void);
+void DMA1_Channel1_IRQHandler(void);
+void ADC1_2_IRQHandler(void);
+void DMA1_Channel7_IRQHandler(void);
+void USART3_IRQHandler(void);
+void FLASH_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -0,0 +1,147 @@
+/**
+ * @file Utils.c
+ * @brief Implementation of the larger shared utilities (see Utils.h)
+ */
+
+#include "Utils.h"
+#if !PONG_HEADLESS
+#include "rng.h"
+#endif
+
+#define SWEEP_NEVER INT32_MAX
+
+/**
+ * @brief Clamp a fraction of a move to the Q16.16 range (SWEEP_NEVER is "not in this move")
+ */
+static Fixed16 sweep_clamp(int64_t t) {
+    if (t > SWEEP_NEVER) {
+        return SWEEP_NEVER;
+    }
+    if (t < -SWEEP_NEVER) {
+        return -SWEEP_NEVER;
+    }
+    return (Fixed16)t;
+}
+
+/**
+ * @brief Entry and exit time of a moving interval against a static one, on one axis
+ * 
+ * Worked in 64 bits: edges and distances near the ends of the int16/Q16.16
+ * ranges don't wrap, and a long way divided by a tiny move saturates instead
+ * of wrapping round to a time inside the move.
+ * 
+ * @param pos Moving interval start position (Q16.16)
+ * @param size Moving interval length (Q16.16)
+ * @param move Displacement over the move (Q16.16)
+ * @param lo Static interval start (Q16.16)
+ * @param hi Static interval end (Q16.16)
+ * @param entry Set to the fraction of the move when overlap starts
+ * @param exit Set to the fraction of the move when overlap ends
+ * @return 0 if the intervals can never overlap during the move
+ */
+static uint8_t sweep_axis(int64_t pos, int64_t size, Fixed16 move, int64_t lo, int64_t hi,
+                          Fixed16* entry, Fixed16* exit) {
+    if (move == 0) {
+        // Not moving on this axis: overlapping for the whole move, or never
+        if (pos < hi && pos + size > lo) {
+            *entry = -SWEEP_NEVER;
+            *exit = SWEEP_NEVER;
+            return 1;
+        }
+        return 0;
+    }
+
+    int64_t entry_dist, exit_dist;
+    if (move > 0) {
+        entry_dist = lo - (pos + size);
+        exit_dist = hi - pos;
+    } else {
+        entry_dist = hi - pos;
+        exit_dist = lo - (pos + size);
+    }
+    // distance / move, as a Q16.16 fraction of the move
+    *entry = sweep_clamp((entry_dist * FIXED_ONE) / move);
+    *exit = sweep_clamp((exit_dist * FIXED_ONE) / move);
+    return 1;
+}
+
+AABB_SweepResult AABB_Sweep(Fixed16 x, Fixed16 y, int16_t width, int16_t height,
+                            FixedVector2D move, const AABB* target) {
+    AABB_SweepResult result = {0, FIXED_ONE, 0, 0};
+    Fixed16 entry_x, exit_x, entry_y, exit_y;
+
+    // Far edges as int32 sums, shifted in 64 bits: x + width can be past INT16_MAX
+    if (!sweep_axis(x, (int64_t)width * FIXED_ONE, move.x,
+                    (int64_t)target->x * FIXED_ONE, (int64_t)((int32_t)target->x + target->width) * FIXED_ONE,
+                    &entry_x, &exit_x) ||
+        !sweep_axis(y, (int64_t)height * FIXED_ONE, move.y,
+                    (int64_t)target->y * FIXED_ONE, (int64_t)((int32_t)target->y + target->height) * FIXED_ONE,
+                    &entry_y, &exit_y)) {
+        return result;
+    }
+
+    Fixed16 entry = (entry_x > entry_y) ? entry_x : entry_y;
+    Fixed16 exit = (exit_x < exit_y) ? exit_x : exit_y;
+
+    // Touching edges only (entry == exit) is not a collision, matching AABB_Collides()
+    if (entry >= exit || exit <= 0 || entry > FIXED_ONE) {
+        return result;
+    }
+
+    result.hit = 1;
+    result.time = (entry > 0) ? entry : 0;
+    if (entry_x > entry_y) {
+        result.normal_x = (move.x > 0) ? -1 : 1;
+    } else {
+        result.normal_y = (move.y > 0) ? -1 : 1;
+    }
+    return result;
+}
+
+uint8_t AABB_CollidesMany(const AABB* box, const AABB_SoA* boxes, uint8_t n, uint32_t* mask) {
+    const int32_t left = box->x;
+    const int32_t top = box->y;
+    const int32_t right = (int32_t)box->x + box->width;
+    const int32_t bottom = (int32_t)box->y + box->height;
+    uint8_t hits = 0;
+
+    for (uint8_t word = 0; word < (n + 31u) / 32u; word++) {
+        uint32_t bits = 0;
+        const uint8_t first = (uint8_t)(word * 32u);
+        const uint8_t count = (n - first < 32) ? (uint8_t)(n - first) : 32;
+        for (uint8_t k = 0; k < count; k++) {
+            const uint8_t i = first + k;
+            const int32_t x = boxes->x[i];
+            const int32_t y = boxes->y[i];
+            // Each difference is negative when its comparison in AABB_Collides() fails
+            const int32_t fails = (right - x - 1) | (x + boxes->width[i] - left - 1) |
+                                  (bottom - y - 1) | (y + boxes->height[i] - top - 1);
+            bits |= (uint32_t)(~fails >> 31 & 1) << k;
+        }
+        mask[word] = bits;
+        hits += (uint8_t)__builtin_popcount(bits);
+    }
+    return hits;
+}
+
+// Any fixed start state works; this one is used until Random_Seed() is called
+uint64_t random_state = 0x853C49E6748FEA9BULL;
+
+void Random_Seed(uint32_t seed) {
+    // Standard PCG32 seeding: step once, add the seed, step again
+    random_state = 0;
+    Random_U32();
+    random_state += seed;
+    Random_U32();
+}
+
+#if !PONG_HEADLESS
+uint32_t Random_Seed_Hardware(void) {
+    uint32_t seed = 0;
+    if (HAL_RNG_GenerateRandomNumber(&hrng, &seed) != HAL_OK) {
+        seed = 0;
+    }
+    Random_Seed(seed);
+    return seed;
+}
+#endif
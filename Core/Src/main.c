@@ -33,14 +33,50 @@ void PeriphCommonClock_Config(void);
 
 // Buzzer library
 #include "Buzzer.h" // For buzzer control using TIM2
+#include "BuzzerSeq.h" // Queued beeps timed by TIM7, so game code never waits on audio
+#if PONG_AUDIO_MIXER
+#include "Mixer.h"  // Beeps mixed into PWM samples streamed by DMA, for overlapping sounds
+#endif
 #include "PWM.h"    // For PWM control of the LED - not used in this demo but included for completeness and future expansion
 #include "LCD.h"  // For LCD demonstration 
 #include "Joystick.h" // include the Joystick driver functions
 #include "PongEngine.h" // Main pong game engine
 #include "Utils.h" // Common utility types and functions (Position2D, AABB, etc.)
+#include "FrameTimer.h" // Fixed-timestep frame scheduler on TIM6
+#include "Latency.h" // Input-to-photon latency measurement (PONG_LATENCY_STATS)
+#include "LCDBench.h" // LCD drawing micro-benchmarks (PONG_LCD_BENCH)
+#include "Profiler.h" // Per-stage frame times with an on-screen overlay (PONG_PROFILER)
+#include "Telemetry.h" // Binary per-frame game state over UART (PONG_TELEMETRY)
+#include "UartLog.h" // printf output drained by USART2 TX DMA, so logging never stalls a frame
+#include "MemStats.h" // Stack high-water mark and peak heap use
+#include "Fmt.h" // Integer to text without sprintf, for the HUD and log lines
+#include "ClockProfile.h" // 80MHz for gameplay, 16MHz on the static screens (PONG_CLOCK_SCALING)
+#include "Lockstep.h" // Two players on two linked boards, inputs exchanged every step (PONG_LINK_PLAY)
+#include "LinkUart.h" // The board-to-board UART for link play, on USART3
+#include "SnapshotRing.h" // Packed engine states of the last steps (PONG_STATE_HISTORY)
+#include "FlashStore.h" // High scores kept in flash over resets, written a double-word a frame
+#include "AssetPack.h" // Palette, font and sprites used in place from a pack in flash (PONG_ASSET_PACK)
+#include "EventQueue.h" // Lock-free single-producer, single-consumer event rings
+#include "Scheduler.h" // Game loop stages, each at its own rate on the TIM6 timebase (PONG_SCHEDULER)
+#include "TimeBase.h" // Monotonic microsecond clock on TIM5 (time_us())
+#include "Governor.h" // Sheds optional drawing while frames run over budget (PONG_ADAPTIVE_QUALITY)
+#include "Scope.h" // Streaming scope traces of the joystick ADC samples (PONG_SCOPE)
+#include "Buttons.h" // Debounced EXTI buttons: pause and boost (PONG_BUTTONS)
+#include "StatusLed.h" // LD2 blink patterns from TIM8 and DMA (PONG_STATUS_LED)
+#include "Console.h" // Command shell on the USART2 RX line: stats and live settings (PONG_CONSOLE)
+#include "FrameDump.h" // A drawn frame sent over the UART, run-length encoded, for PNGs (PONG_FRAME_DUMP)
+#include "Jitter.h" // p50/p95/p99/max of frame intervals and stage costs, rolling window (PONG_JITTER_STATS)
+#include "Trace.h" // Frame, refresh, DMA, collision and input events on the ITM/SWO (PONG_TRACE)
+#include "DmaChannel.h" // Owner of each DMA channel, so two modules never share one unnoticed
+#include "ExtFlash.h" // SPI NOR flash on SPI1, read by DMA, for asset packs too big for the chip (PONG_EXT_FLASH)
+#if PONG_RTOS
+#include "cmsis_os2.h" // CMSIS-RTOS2 on FreeRTOS: input, game and render tasks (PONG_RTOS)
+#endif
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 // ===== BUZZER CONFIGURATION =====
@@ -51,9 +87,37 @@ Buzzer_cfg_t buzzer_cfg = {
     .tick_freq_hz = 1000000,  // 1MHz timer clock (prescaler = 79 with 80MHz input)
     .min_freq_hz = 20,
     .max_freq_hz = 20000,
+    .dma_channel = DMA1_Channel2,  // TIM2_UP: waveform tables play with no CPU
+    .dma_request = 4,
     .setup_done = 0
 };
 
+// Game over jingle, played as a DMA waveform (one table step per PWM period), or by the mixer
+static const Buzzer_Wave_Note_t game_over_jingle[] = {
+    {NOTE_C5, 50, 120}, {NOTE_G4, 50, 120}, {NOTE_E4, 50, 120}, {NOTE_C4, 50, 300}
+};
+#if !PONG_AUDIO_MIXER
+#define GAME_OVER_JINGLE_STEPS 240
+static uint16_t game_over_wave[BUZZER_WAVE_SIZE(TIM_CHANNEL_3, GAME_OVER_JINGLE_STEPS)];
+#endif
+
+// Buzzer sequencer: plays queued tones on buzzer_cfg, timed by the TIM7 interrupt
+BuzzerSeq_cfg_t buzzer_seq = {
+    .buzzer = &buzzer_cfg,
+    .htim = &htim7,
+    .tick_freq_hz = 10000,    // 0.1ms resolution, events up to 6.5s
+    .setup_done = 0
+};
+
+#if PONG_AUDIO_MIXER
+// Buzzer mixer: takes buzzer_cfg's timer channel and DMA over in place of the sequencer
+Mixer_cfg_t mixer = {
+    .buzzer = &buzzer_cfg,
+    .sample_rate_hz = 32000,  // 2500 duty steps from the 80MHz timer clock
+    .setup_done = 0
+};
+#endif
+
 // ===== LCD CONFIGURATION =====
 ST7789V2_cfg_t cfg0 = {
     .setup_done = 0,
@@ -64,10 +128,147 @@ ST7789V2_cfg_t cfg0 = {
     .CS = {.port = GPIOB, .pin = GPIO_PIN_12},
     .MOSI = {.port = GPIOB, .pin = GPIO_PIN_15},
     .SCLK = {.port = GPIOB, .pin = GPIO_PIN_13},
-    .dma = {.instance = DMA1, .channel = DMA1_Channel5}
+    .dma = {.instance = DMA1, .channel = DMA1_Channel5},
+    .spi_baud_div = ST7789V2_BAUD_DIV_2,  // 40MHz SCLK from the 80MHz APB1 clock
+    // .TE = {.port = GPIOC, .pin = GPIO_PIN_11},  // Optional TE pin (EXTI15_10), syncs frames to the panel
 };
 
+// Set to 1 to measure input-to-photon latency with the DWT cycle counter: ADC sample ->
+// engine update -> paddle rows sent to the panel. Min/avg/max are printed over UART every
+// LATENCY_REPORT_FRAMES frames (the printing itself holds up the game for a few ms).
+#ifndef PONG_LATENCY_STATS
+#define PONG_LATENCY_STATS 0
+#endif
+#define LATENCY_REPORT_FRAMES 300
+
+// Set to 1 to have the joystick's DMA interrupt queue direction and threshold events for
+// every sample. A flick that goes out and back between two frames then still moves the
+// paddle for a frame, where the once-a-frame Joystick_Read() would have missed it.
+#ifndef PONG_INPUT_EVENTS
+#define PONG_INPUT_EVENTS 0
+#endif
+
+// Set to 1 for button controls, debounced in the EXTI and TIM16 interrupts: the Nucleo's
+// blue button (B1) pauses and resumes, and BTN2 held moves the paddle at full speed
+#ifndef PONG_BUTTONS
+#define PONG_BUTTONS 0
+#endif
+
+// Set to 1 to have LD2 (PA5) show the board's health, blinked by TIM8 with no CPU: a
+// heartbeat while running, a fast blink for PONG_STATUS_WARN_MS after a physics overrun, and
+// a fault code (main.h LED_FAULT_*) from Error_Handler(), a HardFault or an LCD given up on
+#ifndef PONG_STATUS_LED
+#define PONG_STATUS_LED 0
+#endif
+
+#ifndef PONG_STATUS_WARN_MS
+#define PONG_STATUS_WARN_MS 3000
+#endif
+
+// Set to 1 to print the CPU duty cycle (share of time awake, not sleeping in FrameTimer_Wait())
+// over UART once a second, to see what the frame work costs in battery life
+#ifndef PONG_DUTY_STATS
+#define PONG_DUTY_STATS 0
+#endif
+
+// Set to 1 to wait on the game over screen in STOP2 (a few uA) rather than SLEEP. The ADC
+// stops in STOP2, so a button press (any BTN EXTI line) starts the next game instead of
+// moving the joystick
+#ifndef PONG_GAME_OVER_STOP2
+#define PONG_GAME_OVER_STOP2 0
+#endif
+
+// Set to 1 to paint the free stack at start-up and print the stack high-water mark and the
+// peak heap use at game over (the static RAM per module is printed by every build)
+#ifndef PONG_MEMORY_STATS
+#define PONG_MEMORY_STATS 0
+#endif
+
+// Set to 1 to drop the core clock to 16MHz (HSI16, voltage range 2) on the splash and game over
+// screens, and go back to the 80MHz PLL for the game. The LCD refreshes at 8MHz SCLK meanwhile
+#ifndef PONG_CLOCK_SCALING
+#define PONG_CLOCK_SCALING 0
+#endif
+
+// Set to 1 to run the LCD drawing micro-benchmarks at start-up instead of the game.
+// The table of cycles per call is printed over UART, then the board idles.
+#ifndef PONG_LCD_BENCH
+#define PONG_LCD_BENCH 0
+#endif
+
+// Set to 1 to show live scope traces of the joystick's X and Y ADC samples at start-up
+// instead of the game, to check the stick and its filtering. The board stays on that screen.
+// Needs the image buffer, so not with LCD_DISPLAY_LIST.
+#ifndef PONG_SCOPE
+#define PONG_SCOPE 0
+#endif
+
+// Set to 1 to stream a binary telemetry frame (ball, paddles, score, lives, frame times)
+// over UART every main loop iteration. Decode on a PC with Telemetry/telemetry_decode.py.
+#ifndef PONG_TELEMETRY
+#define PONG_TELEMETRY 0
+#endif
+
+// Set to 1 to time each start-up phase of main() with the DWT cycle counter, up to the first
+// frame being sent. The table is printed over UART once that frame is on the screen.
+#ifndef PONG_BOOT_TIMING
+#define PONG_BOOT_TIMING 0
+#endif
+
+// Set to 1 (the FastBoot CMake preset) for the shortest power-on to first frame: the splash
+// and instructions screens are skipped, and the buzzer and LED timers are set up only once
+// the first frame is on the screen
+#ifndef PONG_FAST_BOOT
+#define PONG_FAST_BOOT 0
+#endif
+
+// Set to 1 for an attract mode: once the game over screen has been left alone for
+// PONG_ATTRACT_DELAY_MS, the CPU plays itself on both paddles, silently, at the 16MHz clock
+// profile and PONG_ATTRACT_FPS frames a second, halved while the CPU is awake more than
+// PONG_ATTRACT_AWAKE_PERMILLE of the time. Moving the stick starts a game at once, with no
+// reset or splash screens. Needs PONG_AI_OPPONENT and PONG_CLOCK_SCALING
+#ifndef PONG_ATTRACT_MODE
+#define PONG_ATTRACT_MODE 0
+#endif
+
+#ifndef PONG_ATTRACT_DELAY_MS
+#define PONG_ATTRACT_DELAY_MS 10000
+#endif
+
+#ifndef PONG_ATTRACT_FPS
+#define PONG_ATTRACT_FPS 30
+#endif
+
+#ifndef PONG_ATTRACT_AWAKE_PERMILLE
+#define PONG_ATTRACT_AWAKE_PERMILLE 100
+#endif
+
+#if PONG_ATTRACT_MODE && !(PONG_AI_OPPONENT && PONG_CLOCK_SCALING)
+#error "PONG_ATTRACT_MODE plays the CPU against itself at the low clock: set PONG_AI_OPPONENT and PONG_CLOCK_SCALING"
+#endif
+#if PONG_ATTRACT_MODE && (PONG_RTOS || PONG_SCHEDULER || PONG_GAME_OVER_STOP2)
+#error "PONG_ATTRACT_MODE runs from the main loop's game over screen: not with PONG_RTOS, PONG_SCHEDULER or PONG_GAME_OVER_STOP2"
+#endif
+
+// ===== FSM STATE DEFINITIONS =====
+// TITLE (splash and instructions) -> PLAYING <-> PAUSED (PONG_BUTTONS) -> OVER. Only PLAYING
+// draws frames. The title and game over screens, and the pause banner, are sent once, and the
+// CPU then sleeps with nothing drawn or sent until the input that ends the state arrives.
+// With PONG_ATTRACT_MODE, OVER -> ATTRACT (the demo, drawing frames) -> PLAYING.
+typedef enum {
+    GAME_STATE_TITLE = 0,
+    GAME_STATE_PLAYING,
+    GAME_STATE_PAUSED,
+    GAME_STATE_OVER,
+    GAME_STATE_ATTRACT
+} Game_State_t;
+static volatile Game_State_t game_state = GAME_STATE_TITLE;  // set by the loops and apply_buttons()
+
 // ===== JOYSTICK CONFIGURATION =====
+#if PONG_INPUT_EVENTS
+EventQueue_t joystick_events;  // filled by the DMA interrupt, drained by apply_input_events()
+#endif
+
 Joystick_cfg_t joystick_cfg = {
     .adc = &hadc1,
     .x_channel = ADC_CHANNEL_1, //A5 on Nucleo board
@@ -76,12 +277,120 @@ Joystick_cfg_t joystick_cfg = {
     .center_x = JOYSTICK_DEFAULT_CENTER_X,
     .center_y = JOYSTICK_DEFAULT_CENTER_Y,
     .deadzone = JOYSTICK_DEADZONE,
+    .dma_channel = DMA1_Channel1,  // sample continuously in the background, Joystick_Read() never waits
+    .oversampling = 256,           // each sample averages 256 conversions in hardware
+    .filter = JOYSTICK_FILTER_MEDIAN | JOYSTICK_FILTER_IIR,  // steady at the deadzone edge
+    .filter_strength = 1,          // light smoothing: about 2 reads (2 frames) of lag
+    .direction_only = 1,           // paddle only needs N/S: integer classifier, no sqrt/atan2
+    .auto_center = 1,              // calibrate while the stick is at rest, no blocking at boot
+    .sample_timestamps = PONG_LATENCY_STATS,  // DMA interrupt timestamps each sample
+#if PONG_INPUT_EVENTS
+    .events = &joystick_events,    // direction changes between frames aren't lost
+    .event_threshold = JOYSTICK_EVENT_ONE / 4,  // a flick's strength is its peak past 1/4
+#endif
     .setup_done = 0
 };
 
 // Joystick data structure to hold readings
 Joystick_t joystick_data;
 
+#if PONG_TWO_STICKS
+// Second player's stick on A0/A1, filtered and calibrated like the first
+Joystick_cfg_t joystick2_cfg = {
+    .x_channel = ADC_CHANNEL_5, //A0 on Nucleo board
+    .y_channel = ADC_CHANNEL_6, //A1 on Nucleo board
+    .center_x = JOYSTICK_DEFAULT_CENTER_X,
+    .center_y = JOYSTICK_DEFAULT_CENTER_Y,
+    .deadzone = JOYSTICK_DEADZONE,
+    .filter = JOYSTICK_FILTER_MEDIAN | JOYSTICK_FILTER_IIR,
+    .filter_strength = 1,
+    .direction_only = 1,
+    .auto_center = 1,
+    .setup_done = 0
+};
+Joystick_t joystick2_data;
+
+// Both sticks in one ADC1 sequence (X1, Y1, X2, Y2) on the first stick's DMA channel: the
+// second player costs two more conversions a pass, nothing on the CPU
+Joystick_Scan_t joystick_scan = {
+    .adc = &hadc1,
+    .dma_channel = DMA1_Channel1,
+    .sampling_time = ADC_SAMPLETIME_47CYCLES_5,
+    .oversampling = 256,
+    .sticks = {&joystick_cfg, &joystick2_cfg},
+    .count = 2,
+    .setup_done = 0
+};
+#endif
+
+#if PONG_BUTTONS
+enum { BUTTON_PAUSE = 0, BUTTON_BOOST };
+
+EventQueue_t button_events;  // filled by the TIM16 interrupt, drained by apply_buttons()
+Buttons_cfg_t buttons = {
+    .buttons = {
+        [BUTTON_PAUSE] = {.port = B1_GPIO_Port, .pin = B1_Pin},     // low when pressed
+        [BUTTON_BOOST] = {.port = BTN2_GPIO_Port, .pin = BTN2_Pin}  // pulled up, low when pressed
+    },
+    .count = 2,
+    .debounce_ms = 20,
+    .events = &button_events
+};
+#endif
+
+// Drain the button events since the last call: a press of pause goes between PLAYING and
+// PAUSED. Boost held
+// turns any deflection into full speed. With input NULL the events are only thrown away
+static void apply_buttons(UserInput* input) {
+#if PONG_BUTTONS
+    Event_t event;
+    while (EventQueue_Pop(&button_events, &event)) {
+#if PONG_TRACE
+        Trace_Event(TRACE_PORT_INPUT, (uint8_t)(((event.type == BUTTONS_EVENT_PRESS) ? TRACE_INPUT_PRESS
+                                                                                : TRACE_INPUT_RELEASE) + event.arg));
+#endif
+        // In link play a pause here would only hold the other board up until the link is lost
+        if (!PONG_LINK_PLAY && input != NULL && event.type == BUTTONS_EVENT_PRESS &&
+            event.arg == BUTTON_PAUSE) {
+            if (game_state == GAME_STATE_PLAYING) {
+                game_state = GAME_STATE_PAUSED;
+            } else if (game_state == GAME_STATE_PAUSED) {
+                game_state = GAME_STATE_PLAYING;
+            }
+        }
+    }
+    if (input != NULL && (buttons.held & (1u << BUTTON_BOOST)) && input->direction != CENTRE) {
+        input->magnitude = 1.0f;
+    }
+#else
+    (void)input;
+#endif
+}
+
+// Drain the joystick events since the last call. If the stick is centred now but went into a
+// direction meanwhile, steer that way for this frame, as hard as the flick's peak. With input
+// NULL the events are only thrown away (the ones queued before a game starts)
+static void apply_input_events(UserInput* input) {
+#if PONG_INPUT_EVENTS
+    Event_t event;
+    Direction flicked = CENTRE;
+    uint16_t peak = 0;
+    while (EventQueue_Pop(&joystick_events, &event)) {
+        if (event.type == JOYSTICK_EVENT_ENTER && event.arg != CENTRE) {
+            flicked = (Direction)event.arg;
+        } else if (event.type == JOYSTICK_EVENT_RELEASE) {
+            peak = event.arg;
+        }
+    }
+    if (input != NULL && input->direction == CENTRE && flicked != CENTRE) {
+        input->direction = flicked;
+        input->magnitude = (float)(peak ? peak : joystick_cfg.event_threshold) / JOYSTICK_EVENT_ONE;
+    }
+#else
+    (void)input;
+#endif
+}
+
 // ===== PWM CONFIGURATION =====
 // Configure PWM to use TIM4 Channel 1 (current hardware setup)
 PWM_cfg_t pwm_cfg = {
@@ -90,24 +399,105 @@ PWM_cfg_t pwm_cfg = {
     .tick_freq_hz = 1000000,  // 1MHz timer clock (prescaler = 79 with 80MHz input)
     .min_freq_hz = 10,
     .max_freq_hz = 50000,
+    .dma_channel = DMA1_Channel4,  // TIM4_CH2: duty patterns play by DMA (DMA1_Channel7 is USART2_TX)
+    .dma_request = 6,
+    .dma_trigger = TIM_DMA_CC2,    // CH2 is unused, its compare steps the pattern on CH1
+    .pattern_step_hz = 250,   // 4ms pattern steps (250Hz PWM while a pattern plays)
     .setup_done = 0
 };
 
-// ===== FSM STATE DEFINITIONS =====
-// For this Pong demo, we will not use a complex FSM with multiple states like the character demo.
-// Instead, we will have a single "game running" state and a "game over" state. 
-// The main game loop will run while the game is active, and when the player loses all lives, 
-// it will transition to the game over state which displays the final score.
+// LED pulse played on every point scored (0.4s = 100 steps at 250Hz)
+#define SCORE_PULSE_MS 400
+static uint8_t score_pulse[100];
+static uint16_t score_pulse_steps;
+
+// Set to 1 to run the game loop as registered stages (Scheduler/Scheduler.h), each at the
+// rate it needs on a PONG_SCHEDULER_HZ timebase, instead of input, update and render once
+// per physics step. The stages' runs, overruns and longest runs are printed at game over.
+#ifndef PONG_SCHEDULER
+#define PONG_SCHEDULER 0
+#endif
+
+// Timebase of the stages with PONG_SCHEDULER: TIM6 ticks at this rate instead of PONG_PHYSICS_HZ
+#ifndef PONG_SCHEDULER_HZ
+#define PONG_SCHEDULER_HZ 1000
+#endif
+
+// Joystick sampling rate with PONG_SCHEDULER; physics uses the latest sample
+#ifndef PONG_INPUT_HZ
+#define PONG_INPUT_HZ 500
+#endif
+
+// PONG_RTOS=1 (set by the CMake option of the same name, which builds FreeRTOS in) runs the
+// game as CMSIS-RTOS2 tasks instead of the super-loop: see the RTOS TASKS section below.
+#ifndef PONG_RTOS
+#define PONG_RTOS 0
+#endif
+
+// Telemetry frame rate with PONG_SCHEDULER (without it, one frame per game loop iteration)
+#ifndef PONG_TELEMETRY_HZ
+#define PONG_TELEMETRY_HZ 10
+#endif
+
+// Set to 1 for a frame-budget governor: while drawing a frame takes over 3/4 of a display
+// frame, optional drawing is shed a level at a time (1: HUD values update every 8th frame,
+// 2: half the sparks, 3: no sparks and square balls) and given back when there is time again.
+// The level and the frame's share of the budget go out in the telemetry frames.
+#ifndef PONG_ADAPTIVE_QUALITY
+#define PONG_ADAPTIVE_QUALITY 0
+#endif
+
+// Set to 1 for palette effects: the background flashes red when a life is lost, and with
+// PONG_BRICK_MODE the bricks shimmer. Only palette colours change, nothing is redrawn, and
+// with LCD_PALETTE_ROW_MASKS only the rows showing those colours are resent.
+#ifndef PONG_PALETTE_EFFECTS
+#define PONG_PALETTE_EFFECTS 0
+#endif
+
+#if PONG_ADAPTIVE_QUALITY
+// Budget set before play, from the core clock
+Governor_t governor = {.max_level = 3, .shed_after = 3, .restore_after = 120};
+#endif
+
+// ===== FRAME TIMER CONFIGURATION =====
+// TIM6 update interrupt is the physics clock (with PONG_SCHEDULER, the stages' timebase);
+// the CPU sleeps between ticks
+#if PONG_SCHEDULER
+#define FRAME_TIMER_HZ PONG_SCHEDULER_HZ
+#define FRAME_TIMER_CATCH_UP 255  // each stage limits its own catch-up
+#else
+#define FRAME_TIMER_HZ PONG_PHYSICS_HZ
+#define FRAME_TIMER_CATCH_UP 8    // at most 8 physics steps per wake-up
+#endif
+FrameTimer_cfg_t frame_timer = {
+    .htim = &htim6,
+    .tick_freq_hz = 1000000,  // 1MHz timer clock (prescaler = 79 with 80MHz input)
+    .fps = FRAME_TIMER_HZ,    // exact: at 60Hz periods alternate 16667/16667/16666us
+    .overrun_policy = FRAMETIMER_OVERRUN_CATCH_UP,  // keep game speed when rendering runs long
+    .max_catch_up = FRAME_TIMER_CATCH_UP,
+    .setup_done = 0
+};
 
 // ===== UTILITY FUNCTIONS =====
 
 // Other utility functions (e.g. for collision detection) are defined in Utils.h
 
+// ===== UART LOG CONFIGURATION =====
+UartLog_cfg_t uart_log = {
+    .huart = &huart2,
+    .dma_channel = DMA1_Channel7,  // USART2_TX
+    .dma_request = 2,
+    .setup_done = 0
+};
+
 /**
  * @brief Redirect printf to UART for debugging
+ *
+ * Output is queued and sent in the background; if the log buffer is full the
+ * message is dropped rather than waiting for the UART.
  */
 int _write(int file, char *ptr, int len) {
-    HAL_UART_Transmit(&huart2, (uint8_t*)ptr, len, HAL_MAX_DELAY);
+    UartLog_Write(&uart_log, ptr, len);
     return len;
 }
 
@@ -115,22 +505,1543 @@ int _write(int file, char *ptr, int len) {
 // Global pong game engine
 PongEngine_t pong_engine;
 
-// Game state flag
-volatile uint8_t game_over = 0;
+#if PONG_LINK_PLAY
+// ===== LINK PLAY CONFIGURATION =====
+// USART3 on PC4 (TX) and PC5 (RX), crossed over to the other board's
+LinkUart_cfg_t link_uart = {
+    .uart = USART3,
+    .dma_channel = DMA1_Channel3,  // USART3_RX, polled: no interrupt per byte received
+    .dma_request = 2,
+    .baud = 115200,
+    .setup_done = 0
+};
+
+// Inputs of both players, rollback snapshot and link state
+Lockstep_t lockstep;
+
+// Hand what has arrived to the lockstep layer, and send the packet it has due, if any
+static void link_pump(void) {
+    uint8_t bytes[64];
+    uint16_t n;
+    while ((n = LinkUart_Read(&link_uart, bytes, sizeof(bytes))) > 0) {
+        Lockstep_Receive(&lockstep, bytes, n);
+    }
+    uint8_t packet[LOCKSTEP_PACKET_BYTES];
+    uint16_t length = Lockstep_Take_Packet(&lockstep, packet);
+    if (length > 0) {
+        LinkUart_Send(&link_uart, packet, length);
+    }
+}
+
+// Find the other board: both then start the game from the same seed
+static void link_connect(void) {
+    LinkUart_Init(&link_uart);
+    Lockstep_Init(&lockstep, Random_U32(), LOCKSTEP_INPUT_DELAY);
+    LCD_Fill_Buffer(0);
+    LCD_printString_Aligned("Waiting for", ST7789V2_WIDTH / 2, 90, 1, 2, LCD_ALIGN_CENTRE);
+    LCD_printString_Aligned("player 2", ST7789V2_WIDTH / 2, 115, 1, 2, LCD_ALIGN_CENTRE);
+    LCD_Refresh(&cfg0);
+    while (Lockstep_Get_Status(&lockstep) == LOCKSTEP_CONNECTING) {
+        link_pump();
+        HAL_Delay(50);
+    }
+    Random_Seed(Lockstep_Get_Seed(&lockstep));
+    printf("Link up: playing the %s paddle\n", Lockstep_Get_Side(&lockstep) ? "right" : "left");
+}
+#endif
+
+// Set to 1 to journal the game (inputs and random draws) and print it over UART at game over.
+// Loading the dump with Replay_Load() and PongEngine_SetReplay() replays the game exactly.
+#ifndef PONG_REPLAY_RECORD
+#define PONG_REPLAY_RECORD 0
+#endif
+
+#if PONG_REPLAY_RECORD
+Replay_t replay;
+#endif
+#if PONG_REPLAY_RECORD && PONG_TWO_STICKS
+#error "PONG_REPLAY_RECORD journals the left input only, PONG_TWO_STICKS moves both paddles"
+#endif
+#if PONG_REPLAY_RECORD && PONG_LINK_PLAY
+#error "PONG_REPLAY_RECORD journals each step once, PONG_LINK_PLAY runs steps again after a rollback"
+#endif
+
+// Set to 1 to pack the engine state after every step into a ring of the last
+// SNAPSHOT_RING_DEPTH, and print the oldest as hex at game over (PongEngine_Unpack() on a PC
+// picks the game up from there)
+#ifndef PONG_STATE_HISTORY
+#define PONG_STATE_HISTORY 0
+#endif
+
+#if PONG_STATE_HISTORY
+SnapshotRing_t state_history;
+static uint32_t history_step = 0;
+#endif
+
+// Set to 1 to check the engine's invariants (PongEngine_Check()) after every step, and print
+// how many steps broke one at game over. Not with PONG_LINK_PLAY, which runs steps again
+#ifndef PONG_CHECK_INVARIANTS
+#define PONG_CHECK_INVARIANTS 0
+#endif
+
+#if PONG_CHECK_INVARIANTS && PONG_LINK_PLAY
+#error "PONG_CHECK_INVARIANTS checks one step at a time, PONG_LINK_PLAY rolls steps back"
+#endif
+
+#if PONG_CHECK_INVARIANTS
+static uint32_t invariant_failures = 0;
+static uint8_t invariant_flags = 0;     // PONG_CHECK_x of every failure
+#endif
+
+// Set to 1 for a command console on the ST-LINK's serial port (USART2 RX, see Console.h):
+// "stats" prints frame times and the LCD's refresh counts, "set fps" / "set spi_div" /
+// "palette" change settings while the game runs. Polled by the main loop, so not with
+// PONG_RTOS, and its replies would break up PONG_TELEMETRY's binary stream
+#ifndef PONG_CONSOLE
+#define PONG_CONSOLE 0
+#endif
+
+#if PONG_CONSOLE && (PONG_RTOS || PONG_TELEMETRY)
+#error "PONG_CONSOLE needs the main loop and a text log: not with PONG_RTOS or PONG_TELEMETRY"
+#endif
+
+// Set to 1 for the console's "dump" command: the next frame drawn is captured whole, run-length
+// encoded (FrameDump.h, ~8KB of RAM), and sent over the log as packets while the game runs on.
+// FrameDump/frame_dump_to_png.py saves it as a PNG
+#ifndef PONG_FRAME_DUMP
+#define PONG_FRAME_DUMP 0
+#endif
+
+#if PONG_FRAME_DUMP && !PONG_CONSOLE
+#error "PONG_FRAME_DUMP is started by a console command: it needs PONG_CONSOLE"
+#endif
+#if PONG_FRAME_DUMP && LCD_BITS_PER_PIXEL != 4
+#error "PONG_FRAME_DUMP sends 16-colour frames: it needs LCD_BITS_PER_PIXEL 4"
+#endif
+
+// Set to 1 to keep rolling p50/p95/p99/max of the frame interval and of the update and render
+// costs (Jitter.h, ~2KB of RAM). Printed by the console's "jitter" command, or every
+// JITTER_WINDOW frames without PONG_CONSOLE. Cheap enough to leave on
+#ifndef PONG_JITTER_STATS
+#define PONG_JITTER_STATS 0
+#endif
+
+// Set to 1 to show the frame interval's p99 and max in the bottom-right corner
+#ifndef PONG_JITTER_OVERLAY
+#define PONG_JITTER_OVERLAY 0
+#endif
+
+#if PONG_JITTER_OVERLAY && !PONG_JITTER_STATS
+#error "PONG_JITTER_OVERLAY shows PONG_JITTER_STATS: set both"
+#endif
+
+// Set to 1 to send frame, step, refresh, DMA, collision and input events out of the SWO pin
+// (ITM, see Trace.h); Trace/trace_decode.py turns a capture into a Chrome / Perfetto trace.
+// PONG_TRACE_SWO_HZ is the SWO bit rate to set the debugger's trace viewer to, or 0 to leave
+// the SWO set-up to the debugger
+#ifndef PONG_TRACE
+#define PONG_TRACE 0
+#endif
+
+#ifndef PONG_TRACE_SWO_HZ
+#define PONG_TRACE_SWO_HZ 2000000
+#endif
+
+// Set to 1 to run the independent watchdog (IWDG, on the 32kHz LSI), fed once a frame and
+// while waiting (HAL_Delay(), the pause screen). It resets the board if the game stops for
+// PONG_WATCHDOG_MS, or if the LCD still faults after PONG_LCD_RECOVERY_TRIES recoveries in a
+// row. Once started it can't be stopped, and it keeps counting in STOP2
+#ifndef PONG_WATCHDOG
+#define PONG_WATCHDOG 0
+#endif
+
+#ifndef PONG_WATCHDOG_MS
+#define PONG_WATCHDOG_MS 2000
+#endif
+
+// LCD recoveries (LCD_Recover()) each within 5 seconds of the last before giving up on it;
+// the display then stays frozen, or the watchdog resets the board
+#ifndef PONG_LCD_RECOVERY_TRIES
+#define PONG_LCD_RECOVERY_TRIES 3
+#endif
+
+#if PONG_WATCHDOG && PONG_GAME_OVER_STOP2
+#error "PONG_WATCHDOG would reset the board sleeping in STOP2: not with PONG_GAME_OVER_STOP2"
+#endif
+
+#if PONG_WATCHDOG_MS < 2 || PONG_WATCHDOG_MS > 8190
+#error "PONG_WATCHDOG_MS must be 2-8190"
+#endif
+
+#if PONG_WATCHDOG
+#define IWDG_KEY_START  0xCCCCu
+#define IWDG_KEY_ACCESS 0x5555u
+#define IWDG_KEY_RELOAD 0xAAAAu
+
+// LSI / 64 is 500Hz, a count every 2ms
+static void watchdog_start(void) {
+    DBGMCU->APB1FZR1 |= DBGMCU_APB1FZR1_DBG_IWDG_STOP;  // Held while the debugger halts the core
+    IWDG->KR = IWDG_KEY_START;
+    IWDG->KR = IWDG_KEY_ACCESS;
+    IWDG->PR = IWDG_PR_PR_2;
+    IWDG->RLR = PONG_WATCHDOG_MS / 2 - 1;
+    while (IWDG->SR != 0) {
+    }
+    IWDG->KR = IWDG_KEY_RELOAD;
+}
+#endif
+
+static uint8_t lcd_recoveries = 0;     // In a row, each within 5s of the last
+static uint32_t lcd_recovered_ms = 0;
+
+#if PONG_STATUS_LED
+// Picks LD2's pattern, once a frame and while waiting. StatusLed_Set() does nothing unless
+// the pattern changes, so this is a couple of compares; the timer does the blinking
+static void status_led_check(void) {
+    static uint32_t overruns_seen = 0;
+    static uint32_t warn_since_ms = 0;
+    if (StatusLed_Get() == STATUSLED_FAULT) {
+        return;  // Stays until the reset
+    }
+    if (LCD_Get_Fault(&cfg0) != 0 && lcd_recoveries >= PONG_LCD_RECOVERY_TRIES) {
+        StatusLed_Set(STATUSLED_FAULT, LED_FAULT_LCD);
+        return;
+    }
+    const uint32_t overruns = FrameTimer_Get_Overruns(&frame_timer);
+    if (overruns > overruns_seen) {
+        overruns_seen = overruns;
+        warn_since_ms = HAL_GetTick();
+        StatusLed_Set(STATUSLED_WARNING, 0);
+    } else if (overruns < overruns_seen) {
+        overruns_seen = overruns;  // FrameTimer_Init() again (PONG_ATTRACT_MODE)
+    } else if (HAL_GetTick() - warn_since_ms >= PONG_STATUS_WARN_MS) {
+        StatusLed_Set(STATUSLED_HEARTBEAT, 0);
+    }
+}
+#endif
+
+// Called once a frame and while waiting: gets the LCD going again after a DMA error, SPI timeout
+// or stalled refresh, and feeds the watchdog unless the recoveries aren't working
+static void display_check(void) {
+    const uint8_t fault = LCD_Get_Fault(&cfg0);
+    if (fault) {
+        if (HAL_GetTick() - lcd_recovered_ms > 5000u) {
+            lcd_recoveries = 0;
+        }
+        if (lcd_recoveries < PONG_LCD_RECOVERY_TRIES) {
+            lcd_recoveries++;
+            printf("LCD fault 0x%02X, recovering (%u)\n", (unsigned)fault, (unsigned)lcd_recoveries);
+            LCD_Recover(&cfg0);
+            lcd_recovered_ms = HAL_GetTick();
+        }
+    }
+#if PONG_WATCHDOG
+    if (LCD_Get_Fault(&cfg0) == 0 || lcd_recoveries < PONG_LCD_RECOVERY_TRIES) {
+        IWDG->KR = IWDG_KEY_RELOAD;
+    }
+#endif
+#if PONG_STATUS_LED
+    status_led_check();
+#endif
+}
+
+#if PONG_JITTER_STATS
+static Jitter_t frame_interval;     // render_pong() start to start
+static Jitter_t update_cost;        // One physics step (update_pong())
+static Jitter_t render_cost;        // render_pong(), as timed for the console's frame times
+
+static void jitter_reset(void) {
+    Jitter_Reset(&frame_interval);
+    Jitter_Reset(&update_cost);
+    Jitter_Reset(&render_cost);
+}
+
+static void jitter_report(void) {
+    Jitter_Report("interval", &frame_interval);
+    Jitter_Report("update", &update_cost);
+    Jitter_Report("render", &render_cost);
+}
+#endif
+
+// Set to 0 to leave out the high-score table kept in flash (the last 4KB, see FlashStore.h)
+#ifndef PONG_HIGH_SCORES
+#define PONG_HIGH_SCORES 1
+#endif
+
+#if PONG_HIGH_SCORES
+// FlashStore keys
+#define STORE_KEY_HIGH_SCORES 0
+
+#define HIGH_SCORE_COUNT 5
+FlashStore_t flash_store;
+static uint16_t high_scores[HIGH_SCORE_COUNT];  // Best first, 0 = empty
+
+// Put a score in the table and queue the table for writing if it made it
+// @return Place in the table (0 = new best), or HIGH_SCORE_COUNT if it did not make it
+static uint8_t high_score_add(uint16_t score) {
+    uint8_t place = 0;
+    while (place < HIGH_SCORE_COUNT && high_scores[place] >= score) {
+        place++;
+    }
+    if (score == 0 || place == HIGH_SCORE_COUNT) {
+        return HIGH_SCORE_COUNT;
+    }
+    for (uint8_t i = HIGH_SCORE_COUNT - 1; i > place; i--) {
+        high_scores[i] = high_scores[i - 1];
+    }
+    high_scores[place] = score;
+    FlashStore_Write(&flash_store, STORE_KEY_HIGH_SCORES, (const uint8_t*)high_scores, sizeof(high_scores));
+    return place;
+}
+#endif
+
+// Set to 1 to tune the LCD on the first start-up: the fastest SPI divider the panel reads back
+// right, the rows per refresh batch that send a game frame quickest and the highest frame rate
+// (up to PONG_RENDER_FPS) that leaves a quarter of each frame spare. The result is kept in the
+// flash store and applied on later start-ups without testing again
+#ifndef PONG_AUTO_TUNE
+#define PONG_AUTO_TUNE 0
+#endif
+#if PONG_AUTO_TUNE && !PONG_HIGH_SCORES
+#error "PONG_AUTO_TUNE keeps its profile in the flash store, which comes with PONG_HIGH_SCORES"
+#endif
+
+#if PONG_AUTO_TUNE
+#define STORE_KEY_LCD_PROFILE 1
+#define LCD_PROFILE_VERSION 1  // Bump when the layout changes: an older profile is tuned again
+
+// What the tune found, and what it was tuned under: a build at another core clock, frame rate
+// or fastest divider tunes again
+typedef struct {
+    uint8_t version;           // LCD_PROFILE_VERSION, 0 for none
+    uint8_t spi_baud_div;      // ST7789V2_BAUD_DIV_x
+    uint8_t lines_per_batch;
+    uint8_t fastest_baud_div;  // cfg0.spi_baud_div it started from
+    uint16_t render_fps;
+    uint16_t max_fps;          // PONG_RENDER_FPS it was tuned with
+    uint16_t full_frame_us;    // A whole screen sent, at spi_baud_div
+    uint16_t game_frame_us;    // The slowest game frame (update, draw and refresh) with the profile
+    uint32_t core_hz;          // SystemCoreClock it was tuned at
+} LCD_Profile_t;
+#endif
+
+// Set to 1 to take the palette, font and splash screen logo and image from an asset pack flashed at
+// PONG_ASSET_PACK_ADDRESS (built by Assets/make_asset_pack.py). Whatever the pack does not
+// have, or all of it if there is no good pack there, stays built in.
+#ifndef PONG_ASSET_PACK
+#define PONG_ASSET_PACK 0
+#endif
+
+// Bank 1, above the program (which must stay below it), so FlashStore writes don't stall reads
+#ifndef PONG_ASSET_PACK_ADDRESS
+#define PONG_ASSET_PACK_ADDRESS 0x08060000u
+#endif
+
+// Set to 1 to read the asset pack from a SPI NOR flash (W25Q-style) on SPI1 at
+// PONG_EXT_FLASH_PACK_ADDRESS instead: 16MB on the flash rather than what is left of the 1MB
+// chip. The palette, font and logo are copied into RAM, and the splash image is read a window
+// at a time while it is drawn.
+#ifndef PONG_EXT_FLASH
+#define PONG_EXT_FLASH 0
+#endif
+
+#ifndef PONG_EXT_FLASH_PACK_ADDRESS
+#define PONG_EXT_FLASH_PACK_ADDRESS 0u
+#endif
+
+#if PONG_EXT_FLASH && !PONG_ASSET_PACK
+#error "PONG_EXT_FLASH holds the asset pack: set PONG_ASSET_PACK too"
+#endif
+
+#if PONG_EXT_FLASH && PONG_STATUS_LED
+#error "PONG_EXT_FLASH takes PA5 for SPI1_SCK, where PONG_STATUS_LED blinks LD2"
+#endif
+
+#if PONG_EXT_FLASH
+// Arduino D13/D12/D11 for SCK/MISO/MOSI, D8 for chip select
+ExtFlash_cfg_t ext_flash = {
+    .spi = SPI1,
+    .cs_port = GPIOA,
+    .cs_pin = GPIO_PIN_9,
+    .rx_channel = DMA2_Channel3,
+    .tx_channel = DMA2_Channel4,
+    .dma_request = 4,
+    .baud_div = 1,      // 20MHz
+    .setup_done = 0
+};
+#endif
+
+#if PONG_ASSET_PACK
+AssetPack_t asset_pack;
+static LCD_Sprite logo;
+static uint8_t have_logo = 0;
+static const AssetPack_Entry_t* splash = NULL;  // Compressed full-colour image, sent past the image buffer
+static LCD_Font title_font;  // Atlas font the title is drawn in, if the pack has one
+static uint8_t have_title_font = 0;
+static LCD_Font_Shades title_shades;
+
+#if PONG_EXT_FLASH
+#define EXT_PACK_MAX_ENTRIES 16
+#define EXT_LOGO_BYTES 4096  // Room for a baked logo of up to 96x32 (LCD_SPRITE_BAKED_SIZE)
+static AssetPack_Entry_t ext_index[EXT_PACK_MAX_ENTRIES];
+static uint16_t ext_palette[16];
+static uint8_t ext_font[ASSETPACK_FONT_BYTES];
+static uint8_t ext_logo[EXT_LOGO_BYTES];
+static uint8_t splash_window[LCD_IMAGE_WINDOW_BYTES(ST7789V2_WIDTH)];
+
+// AssetPack_Read_t on the external flash, the pack starting at PONG_EXT_FLASH_PACK_ADDRESS
+static uint8_t read_ext_pack(void* context, uint32_t offset, void* buffer, uint32_t length) {
+    return ExtFlash_Read((ExtFlash_cfg_t*)context, PONG_EXT_FLASH_PACK_ADDRESS + offset, buffer, length);
+}
+
+// The pack on the external flash: what the game keeps using goes into RAM, the splash stays out there
+static void load_ext_assets(void) {
+    if (!ExtFlash_Init(&ext_flash) ||
+        !AssetPack_Open_External(&asset_pack, read_ext_pack, &ext_flash, ext_index, EXT_PACK_MAX_ENTRIES)) {
+        printf("No asset pack on the external flash, using the built-in palette and font\n");
+        return;
+    }
+    const AssetPack_Entry_t* entry = AssetPack_Find(&asset_pack, "palette", ASSETPACK_PALETTE);
+    if (entry != NULL && AssetPack_Load(&asset_pack, entry, ext_palette, sizeof(ext_palette))) {
+        LCD_Set_Palette_Colours(ext_palette);
+    }
+    entry = AssetPack_Find(&asset_pack, "font", ASSETPACK_FONT);
+    if (entry != NULL && AssetPack_Load(&asset_pack, entry, ext_font, sizeof(ext_font))) {
+        LCD_Set_Font(ext_font);
+    }
+    entry = AssetPack_Find(&asset_pack, "logo", ASSETPACK_SPRITE);
+    if (entry != NULL && AssetPack_Load(&asset_pack, entry, ext_logo, sizeof(ext_logo))) {
+        logo.nrows = entry->height;
+        logo.ncols = entry->width;
+        logo.stride = LCD_SPRITE_STRIDE(entry->width);
+        logo.mask_stride = LCD_SPRITE_MASK_STRIDE(entry->width);
+        logo.data = ext_logo;
+        have_logo = 1;
+    }
+    splash = AssetPack_Find(&asset_pack, "splash", ASSETPACK_IMAGE);
+    printf("Asset pack on the external flash (JEDEC ID %06lX): %u assets, %lu bytes\n",
+           (unsigned long)ext_flash.jedec_id, asset_pack.count, (unsigned long)asset_pack.size);
+}
+#endif
+
+#if !PONG_EXT_FLASH
+// Sprites are used in place, so only from a pack in the chip's flash: the external one isn't mapped
+#define ANIM_MAX_FRAMES 8
+static LCD_Sprite ball_frames[ANIM_MAX_FRAMES];
+static LCD_Sprite paddle_frames[ANIM_MAX_FRAMES];
+static LCD_Sprite_Anim ball_anim = { .frames = ball_frames, .ticks_per_frame = 3 };
+static LCD_Sprite_Anim paddle_anim = { .frames = paddle_frames, .ticks_per_frame = 6 };
+
+// The pack's sprites <base>0, <base>1... (as many as there are in a row) into frames, anim's frames
+static uint8_t load_anim(const char* base, LCD_Sprite* frames, LCD_Sprite_Anim* anim) {
+    char name[ASSETPACK_NAME_LENGTH];
+    const size_t length = strlen(base);
+    if (length + 2 > sizeof(name)) {
+        return 0;
+    }
+    memcpy(name, base, length);
+    name[length + 1] = '\0';
+    uint8_t count = 0;
+    while (count < ANIM_MAX_FRAMES) {
+        name[length] = (char)('0' + count);
+        if (!AssetPack_Sprite(&asset_pack, name, &frames[count])) {
+            break;
+        }
+        count++;
+    }
+    anim->count = count;
+    return count > 0;
+}
+#endif
+
+// Point the LCD at the pack's "palette", "font", "logo", "title" and "splash", and the ball and paddles
+// at its "ball0".. and "paddle0".. animation frames (nothing is copied)
+static void load_assets(void) {
+#if PONG_EXT_FLASH
+    load_ext_assets();
+#else
+    if (!AssetPack_Open(&asset_pack, (const uint8_t*)PONG_ASSET_PACK_ADDRESS)) {
+        printf("No asset pack, using the built-in palette and font\n");
+        return;
+    }
+    const uint16_t* palette = AssetPack_Palette(&asset_pack, "palette");
+    if (palette != NULL) {
+        LCD_Set_Palette_Colours(palette);
+    }
+    LCD_Set_Font(AssetPack_Font(&asset_pack, "font"));  // NULL keeps font5x7_
+    have_logo = AssetPack_Sprite(&asset_pack, "logo", &logo);
+    have_title_font = AssetPack_Atlas(&asset_pack, "title", &title_font);
+    splash = AssetPack_Find(&asset_pack, "splash", ASSETPACK_IMAGE);
+    if (load_anim("ball", ball_frames, &ball_anim)) {
+        BallSet_SetSprites(&pong_engine.balls, &ball_anim);
+    }
+    if (load_anim("paddle", paddle_frames, &paddle_anim)) {
+        Paddle_SetSprites(&pong_engine.paddle, &paddle_anim);
+        Paddle_SetSprites(&pong_engine.opponent, &paddle_anim);
+    }
+    printf("Asset pack: %u assets, %lu bytes\n", asset_pack.count, (unsigned long)asset_pack.size);
+#endif
+}
+#endif
+
+#if PONG_LATENCY_STATS
+Latency_t latency;
+
+// LCD_Set_Row_Watch() callback (DMA interrupt): the paddle's rows are on the panel
+static void latency_rows_shown(void) {
+    Latency_Mark_Shown(&latency);
+}
+#endif
+
+#if ST7789V2_BUS_STATS && (PONG_PROFILER || PONG_TELEMETRY)
+// What the LCD driver sent since *last was taken, moving *last on to now. The DMA interrupt
+// adds to the totals as well, so a refresh still running is split across two such reads.
+static ST7789V2_Bus_Stats_t bus_stats_since(ST7789V2_Bus_Stats_t* last) {
+    const ST7789V2_Bus_Stats_t now = cfg0.bus_stats;
+    const ST7789V2_Bus_Stats_t sent = {
+        .pixel_bytes = now.pixel_bytes - last->pixel_bytes,
+        .command_bytes = now.command_bytes - last->command_bytes,
+        .windows = now.windows - last->windows,
+        .window_commands = now.window_commands - last->window_commands,
+        .busy_cycles = now.busy_cycles - last->busy_cycles,
+    };
+    *last = now;
+    return sent;
+}
+#endif
+
+#if PONG_PROFILER
+// Ends the profiler frame with this frame's LCD traffic as its counts. The overlay only shows
+// stage times, so each window's traffic per frame goes to the log.
+static void profiler_frame_end(void) {
+#if ST7789V2_BUS_STATS
+    static ST7789V2_Bus_Stats_t last;
+    const ST7789V2_Bus_Stats_t sent = bus_stats_since(&last);
+    PROF_COUNT(PROF_COUNT_PIXEL_BYTES, sent.pixel_bytes);
+    PROF_COUNT(PROF_COUNT_COMMAND_BYTES, sent.command_bytes);
+    PROF_COUNT(PROF_COUNT_WINDOWS, sent.windows);
+    PROF_COUNT(PROF_COUNT_BUSY_CYCLES, sent.busy_cycles);
+    if (Profiler_Frame_End()) {
+        const Profiler_Result_t* pixels = Profiler_Get_Count(PROF_COUNT_PIXEL_BYTES);
+        const Profiler_Result_t* busy = Profiler_Get_Count(PROF_COUNT_BUSY_CYCLES);
+        const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+        printf("LCD per frame: %lu pixel bytes (max %lu), %lu command bytes, %lu windows, %lu us busy (max %lu)\n",
+               (unsigned long)pixels->avg, (unsigned long)pixels->max,
+               (unsigned long)Profiler_Get_Count(PROF_COUNT_COMMAND_BYTES)->avg,
+               (unsigned long)Profiler_Get_Count(PROF_COUNT_WINDOWS)->avg,
+               (unsigned long)(busy->avg / cycles_per_us), (unsigned long)(busy->max / cycles_per_us));
+    }
+#else
+    Profiler_Frame_End();
+#endif
+}
+#endif
+
+#if PONG_TELEMETRY
+// Queue one telemetry frame; dropped whole if the log buffer is full
+static void send_telemetry(uint32_t step, uint32_t steps, uint32_t update_cycles, uint32_t render_cycles) {
+    const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    const BallSet_t* balls = &pong_engine.balls;
+    Telemetry_Frame_t frame = {
+        .step = step,
+        .ball_count = balls->count,
+        .ball_x = Fixed_ToInt(balls->x[0]),
+        .ball_y = Fixed_ToInt(balls->y[0]),
+        .ball_vx = (int16_t)(balls->vx[0] >> 8),  // Q16.16 -> Q8.8
+        .ball_vy = (int16_t)(balls->vy[0] >> 8),
+        .paddle_y = pong_engine.paddle.y,
+        .opponent_y = pong_engine.opponent.y,
+        .score = PongEngine_GetScore(&pong_engine),
+        .opponent_score = PongEngine_GetOpponentScore(&pong_engine),
+        .lives = PongEngine_GetLives(&pong_engine),
+        .steps = (uint8_t)steps,
+        .update_us = (uint16_t)(update_cycles / cycles_per_us),
+        .render_us = (uint16_t)(render_cycles / cycles_per_us),
+        .overruns = FrameTimer_Get_Overruns(&frame_timer),
+        .log_dropped = UartLog_Get_Dropped(&uart_log),
+#if PONG_ADAPTIVE_QUALITY
+        .quality_level = governor.level,
+        .frame_load = Governor_Get_Load(&governor),
+#endif
+    };
+#if ST7789V2_BUS_STATS
+    static ST7789V2_Bus_Stats_t last_bus_stats;
+    const ST7789V2_Bus_Stats_t sent = bus_stats_since(&last_bus_stats);
+    frame.lcd_pixel_bytes = sent.pixel_bytes;
+    frame.lcd_command_bytes = (uint16_t)sent.command_bytes;
+    frame.lcd_windows = (uint16_t)sent.windows;
+    frame.lcd_busy_us = (uint16_t)(sent.busy_cycles / cycles_per_us);
+#endif
+    uint8_t bytes[TELEMETRY_FRAME_BYTES];
+    UartLog_Write(&uart_log, (const char*)bytes, Telemetry_Encode(&frame, bytes));
+}
+#endif
+
+#if LCD_REFRESH_CHECK
+// A row the LCD sent (or the panel read back) differently from the image buffer
+static void lcd_check_failed(uint16_t y, uint32_t crc, uint32_t expected, uint8_t read_back) {
+    printf("LCD check: row %u %s CRC %08lx, expected %08lx\n", (unsigned)y, read_back ? "read back" : "sent",
+           (unsigned long)crc, (unsigned long)expected);
+}
+#endif
+
+#if PONG_BOOT_TIMING
+// Start-up phases and how long each took. Cycles are converted at the core clock the phase
+// started on, so SystemClock_Config (4MHz MSI to the 80MHz PLL) is slightly overstated.
+#define BOOT_MAX_PHASES 16
+static struct {
+    const char* name;
+    uint32_t us;
+} boot_phases[BOOT_MAX_PHASES];
+static uint8_t boot_phase_count = 0;
+static uint32_t boot_phase_start = 0;
+static uint32_t boot_phase_hz = 0;
+
+// Starts the cycle counter at the top of main(), before the HAL is up. Phases are differences
+// from the count here, so nothing that starts the counter later may reset it.
+static void boot_timing_start(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    boot_phase_start = DWT->CYCCNT;
+    boot_phase_hz = SystemCoreClock;
+}
+
+// Ends the phase running since the last mark
+static void boot_mark(const char* name) {
+    const uint32_t now = DWT->CYCCNT;
+    if (boot_phase_count < BOOT_MAX_PHASES) {
+        boot_phases[boot_phase_count].name = name;
+        boot_phases[boot_phase_count].us = (uint32_t)(((uint64_t)(now - boot_phase_start) * 1000000u) / boot_phase_hz);
+        boot_phase_count++;
+    }
+    boot_phase_start = now;
+    boot_phase_hz = SystemCoreClock;
+}
+
+static void boot_report(void) {
+    uint32_t total_us = 0;
+    for (uint8_t i = 0; i < boot_phase_count; i++) {
+        printf("Boot %-22s %7lu us\n", boot_phases[i].name, (unsigned long)boot_phases[i].us);
+        total_us += boot_phases[i].us;
+    }
+    printf("Boot %-22s %7lu us\n", "main() to first frame", (unsigned long)total_us);
+}
+#define BOOT_MARK(name) boot_mark(name)
+#else
+#define BOOT_MARK(name)
+#endif
+
+// Buzzer, sound sequencer and LED PWM. Nothing uses them before the game loop, so a fast boot
+// leaves them until the first frame has been sent.
+static void init_feedback_peripherals(void) {
+    // Initialize buzzer timer
+    MX_TIM2_Init();
+    buzzer_init(&buzzer_cfg);
+    MX_TIM7_Init();
+#if PONG_AUDIO_MIXER
+    Mixer_Init(&mixer);
+#else
+    BuzzerSeq_Init(&buzzer_seq);
+#endif
+
+    // Initialize TIM4 AFTER LCD to avoid GPIO conflict on PB6
+    MX_TIM4_Init();
+
+    // Initialize PWM for LED control: off, apart from a DMA-driven pulse when a point is scored
+    PWM_Init(&pwm_cfg);
+    PWM_SetFreq(&pwm_cfg, 1000);
+    PWM_SetDuty(&pwm_cfg, 0);
+    score_pulse_steps = PWM_Pattern_Build(&pwm_cfg, PWM_PATTERN_PULSE, SCORE_PULSE_MS, 1,
+                                          score_pulse, sizeof(score_pulse));
+}
+
+#if PONG_CLOCK_SCALING
+// Switch the core clock with everything that runs from it kept at the same rate: nothing is
+// sent to the LCD across the switch and the joystick scan is paused (the ADC clock changes
+// too), then each module works its dividers out again. The frame timer is started after the
+// switch to full speed, so it is set up for that clock already.
+static void set_clock_profile(ClockProfile_t profile) {
+    LCD_Refresh_Wait();
+    Joystick_Pause(&joystick_cfg);
+    UartLog_Flush(&uart_log);
+    if (ClockProfile_Set(profile) != HAL_OK) {
+        Error_Handler();
+    }
+    UartLog_Clock_Changed(&uart_log);
+#if PONG_LINK_PLAY
+    LinkUart_Clock_Changed(&link_uart);
+#endif
+#if PONG_AUDIO_MIXER
+    Mixer_Clock_Changed(&mixer);  // Not buzzer_clock_changed(): the mixer runs the timer unprescaled
+#else
+    buzzer_clock_changed(&buzzer_cfg);
+    BuzzerSeq_Clock_Changed(&buzzer_seq);
+#endif
+#if PONG_TRACE
+    Trace_Clock_Changed();
+#endif
+    PWM_Clock_Changed(&pwm_cfg);
+#if PONG_STATUS_LED
+    StatusLed_Clock_Changed();
+#endif
+    TimeBase_Clock_Changed();
+    Joystick_Resume(&joystick_cfg);
+}
+#endif
+
+// Game events, queued by the engine step (update_pong) and handled by the loop. Only the loop
+// moves game_state to OVER, so the steps of one wake-up stop as soon as the game is over.
+enum {
+    GAME_EVENT_SCORED = 1,  // data: new score
+    GAME_EVENT_LIFE_LOST,   // data: lives left
+    GAME_EVENT_OVER         // arg: GAME_OVER_*, data: final score
+};
+enum {
+    GAME_OVER_NO_LIVES = 0,
+    GAME_OVER_LINK_LOST
+};
+EventQueue_t game_events;
+static uint64_t game_start_us = 0;  // time_us() when play started, for the game time
+
+#if PONG_PALETTE_EFFECTS
+// Palette colours are only changed by render_pong(), between frames: the loop (or the game
+// task) just asks for a flash
+#define FLASH_FRAMES 6
+#define FLASH_COLOUR RGB565_MAROON
+#define SHIMMER_COLOUR 5   // BRICK_WALL_COLOUR in PongEngine.c
+static volatile uint8_t flash_requested = 0;
+
+static void palette_effects_frame(void) {
+    static uint8_t flash_frames = 0;
+    static uint16_t flash_saved;
+    if (flash_requested) {
+        flash_requested = 0;
+        if (flash_frames == 0) {
+            flash_saved = LCD_Get_Palette_Colour(0);
+            LCD_Set_Palette_Colour(0, FLASH_COLOUR);
+        }
+        flash_frames = FLASH_FRAMES;
+    } else if (flash_frames && --flash_frames == 0) {
+        LCD_Set_Palette_Colour(0, flash_saved);
+    }
+#if PONG_BRICK_MODE
+    // A new shade every 8 frames
+    static const uint16_t shimmer[] = {RGB565_ORANGE, RGB565_GOLD, RGB565_YELLOW, RGB565_GOLD};
+    static uint8_t shimmer_frame = 0;
+    if ((++shimmer_frame & 7u) == 0) {
+        LCD_Set_Palette_Colour(SHIMMER_COLOUR, shimmer[(shimmer_frame >> 3) & 3u]);
+    }
+#endif
+}
+#endif
+
+// Handle the queued game events; returns 1 while the game goes on
+static void finish_game(void);
+
+static uint8_t game_running(void) {
+    Event_t event;
+    while (EventQueue_Pop(&game_events, &event)) {
+        switch (event.type) {
+            case GAME_EVENT_SCORED:
+                // Pulse the LED; the DMA plays it, nothing to do per frame
+                PWM_Pattern_Play(&pwm_cfg, score_pulse, score_pulse_steps, 0);
+                break;
+            case GAME_EVENT_LIFE_LOST:
+#if PONG_PALETTE_EFFECTS
+                flash_requested = 1;
+#endif
+                break;
+            case GAME_EVENT_OVER:
+                if (event.arg == GAME_OVER_LINK_LOST) {
+                    printf("Link lost\n");
+                } else {
+                    printf("Game Over! Final Score: %lu\n", (unsigned long)event.data);
+                }
+                game_state = GAME_STATE_OVER;  // Exit game loop
+                break;
+            default:
+                break;
+        }
+    }
+#if PONG_ATTRACT_MODE
+    if (game_state == GAME_STATE_OVER) {
+        finish_game();  // Back with a new game set up, once someone moves the stick
+    }
+#endif
+    return game_state != GAME_STATE_OVER;
+}
 
 // Frame timing
-// For a smooth game experience, we want to run the game loop at a consistent frame rate (e.g. 60 FPS).
+// For a smooth game experience, we want to run the game loop at a consistent frame rate (60 FPS).
+// The simulation steps at PONG_PHYSICS_HZ (TIM6, see frame_timer above) and is never slowed down
+// by the display: a frame is only drawn when one is due and the LCD has finished the last one.
+// PONG_RENDER_FPS is the rate at start-up, changed while running by the console's "set fps".
+// The main loop and the RTOS game task wake once a physics step, so they draw at most
+// PONG_PHYSICS_HZ frames a second; PONG_SCHEDULER draws at up to its 1kHz tick (e.g. 75 or 120)
+#ifndef PONG_RENDER_FPS
+#define PONG_RENDER_FPS 60
+#endif
+#if PONG_RENDER_FPS < 1 || PONG_RENDER_FPS > (PONG_SCHEDULER ? PONG_SCHEDULER_HZ : PONG_PHYSICS_HZ)
+#error "PONG_RENDER_FPS must be 1 to PONG_PHYSICS_HZ (1 to PONG_SCHEDULER_HZ with PONG_SCHEDULER)"
+#endif
+#define FPS PONG_RENDER_FPS
+static uint16_t render_fps = FPS;  // Frames drawn a second, changed by the console's "set fps"
+#if PONG_ATTRACT_MODE || PONG_AUTO_TUNE
+static uint16_t play_fps = FPS;    // The rate each game starts at, lowered by PONG_AUTO_TUNE
+#endif
+
+// Frame time owed by the physics steps since the last frame, in units of 1/(render_fps *
+// PONG_PHYSICS_HZ) seconds: a step adds render_fps, a frame takes PONG_PHYSICS_HZ. A rate
+// that doesn't divide PONG_PHYSICS_HZ (50 or 45 of 60) comes out exact over each second,
+// where a frame period in whole steps, ms or even us would be rounded
+static uint32_t render_owed = 0;
+
+static inline void render_step_done(void) {
+    render_owed += render_fps;
+}
+
+static inline uint8_t render_is_due(void) {
+    return render_owed >= PONG_PHYSICS_HZ;
+}
+
+// A frame drawn. Frames missed behind a busy LCD are dropped, the fraction of one is kept
+static inline void render_taken(void) {
+    render_owed %= PONG_PHYSICS_HZ;
+}
+
+#if (PONG_CONSOLE && !PONG_SCHEDULER) || PONG_ATTRACT_MODE || PONG_AUTO_TUNE
+static void set_render_fps(uint16_t fps) {
+    if (fps != render_fps) {
+        render_fps = fps;
+        render_owed = 0;  // In the old rate's units
+    }
+}
+#endif
 // In this game we are not doing many calculations, so we can afford to do a full clear and redraw each frame for simplicity.
-#define FPS 60
-#define FRAME_TIME_MS (1000 / FPS)
 
 // ===== NO EXTERNAL INPUT HANDLING NEEDED =====
 // For simplicity, Pong only uses the joystick which is read synchronously
 // (no interrupt-based input needed like the character demo had for buttons)
 
 // ===== FUNCTION PROTOTYPES =====
+#if PONG_SCOPE
+#define SCOPE_WIDTH 220
+static int16_t scope_ring[SCOPE_WIDTH * 2];
+
+// One column a frame: the refresh only sends the column drawn and the cursor ahead of it
+static void scope_screen(void) {
+    Scope_t scope = {
+        .x = 10, .y = 40, .width = SCOPE_WIDTH, .height = 180,
+        .min = 0, .max = JOYSTICK_MAX_VALUE,
+        .traces = 2, .colours = {3, 6}, .background = 0,
+        .samples = scope_ring
+    };
+    LCD_Fill_Buffer(0);
+    LCD_printString("X", 10, 10, 3, 2);
+    LCD_printString("Y", 40, 10, 6, 2);
+    LCD_Draw_Rect(scope.x - 1, scope.y - 1, scope.width + 2, scope.height + 2, 13, 0);
+    Scope_Init(&scope);
+    while (1) {
+        Joystick_Read(&joystick_cfg, &joystick_data);
+        const int16_t values[2] = { (int16_t)joystick_data.x_raw, (int16_t)joystick_data.y_raw };
+        Scope_Push(&scope, values);
+        LCD_Refresh(&cfg0);
+        HAL_Delay(1000 / FPS);
+    }
+}
+#endif
+
 void update_pong(UserInput input);
-void render_pong(void);
+void render_pong(uint16_t alpha);
+
+#if PONG_BUTTONS && !PONG_RTOS
+// PAUSED: one frame with the banner is sent, then the frame timer, the ADC and SysTick stop
+// and the CPU sleeps until the pause button is pressed again. The first frame after redraws
+// the screen without the banner
+static void pause_screen(void) {
+    LCD_Refresh_Wait();
+    render_pong(FrameTimer_Get_Phase(&frame_timer));
+    LCD_Refresh_Wait();
+    FrameTimer_Pause(&frame_timer);
+    Joystick_Pause(&joystick_cfg);
+    // With the watchdog, SysTick is left running to wake the core to feed it
+#if !PONG_WATCHDOG
+    HAL_SuspendTick();
+#endif
+
+    // Button interrupts wake the core. Masked around the check, so an event queued between
+    // the test and WFI still wakes it (as in FrameTimer_Wait())
+    UserInput idle = {CENTRE, 0.0f, -1.0f};
+    while (game_state == GAME_STATE_PAUSED) {
+        __disable_irq();
+        if (EventQueue_Count(&button_events) == 0) {
+            __WFI();
+        }
+        __enable_irq();
+        apply_buttons(&idle);
+#if PONG_WATCHDOG
+        display_check();
+#endif
+    }
+
+#if !PONG_WATCHDOG
+    HAL_ResumeTick();
+#endif
+    Joystick_Resume(&joystick_cfg);
+    FrameTimer_Resume(&frame_timer);
+#if PONG_JITTER_STATS
+    Jitter_Break(&frame_interval);  // The pause isn't a long frame
+#endif
+}
+#endif
+
+#if PONG_DUTY_STATS
+// Print the share of time the CPU was awake since the last report, in per mille
+static void report_duty(uint16_t duty) {
+    // Formatted by hand: printf would run the full float-capable vfprintf in the game loop
+    char line[24] = "CPU awake: ";
+    uint8_t len = 11;
+    len += Fmt_U16(line + len, duty / 10);
+    line[len++] = '.';
+    len += Fmt_U16(line + len, duty % 10);
+    line[len++] = '%';
+    line[len++] = '\n';
+    UartLog_Write(&uart_log, line, len);
+}
+#endif
+
+#if PONG_SCHEDULER
+// ===== GAME LOOP STAGES =====
+// Input, physics and render as scheduler stages, highest priority first. Input is sampled
+// at PONG_INPUT_HZ and physics steps at PONG_PHYSICS_HZ with the latest sample, catching up
+// missed steps so game time stays real time. Render draws at most one frame per period and
+// declines while the LCD is busy, so a saturated bus drops frames, not steps. Audio needs no
+// stage: BuzzerSeq is paced by the TIM7 interrupt.
+Scheduler_t scheduler;
+static UserInput scheduled_input;
+static uint32_t physics_steps = 0;
+static uint8_t te_paced = 0;
+static uint32_t last_te = 0;
+#if PONG_LATENCY_STATS
+static uint32_t frames_since_report = 0;
+#endif
+
+static uint8_t input_stage(uint32_t periods) {
+    (void)periods;
+    PROF_BEGIN(PROF_INPUT);
+    Joystick_Read(&joystick_cfg, &joystick_data);
+    PROF_END(PROF_INPUT);
+    scheduled_input = Joystick_GetInput(&joystick_data);
+    apply_input_events(&scheduled_input);
+    apply_buttons(&scheduled_input);
+    return 1;
+}
+
+static uint8_t physics_stage(uint32_t periods) {
+#if PONG_LATENCY_STATS
+    Latency_Mark_Step(&latency);
+#endif
+    while (periods-- && game_running()) {
+        PROF_BEGIN(PROF_UPDATE);
+        update_pong(scheduled_input);
+        PROF_END(PROF_UPDATE);
+        physics_steps++;
+#if PONG_LATENCY_STATS
+        Latency_Mark_Update(&latency, joystick_data.sample_cycles);
+#endif
+    }
+    return 1;
+}
+
+static Scheduler_Stage_t input_stage_cfg = {.name = "input", .run = input_stage,
+                                            .rate_hz = PONG_INPUT_HZ, .priority = 0, .max_catch_up = 1};
+static Scheduler_Stage_t physics_stage_cfg = {.name = "physics", .run = physics_stage,
+                                              .rate_hz = PONG_PHYSICS_HZ, .priority = 1, .max_catch_up = 8};
+
+// How far into the current physics step real time is, 0 to LERP_ONE (for render_pong)
+static uint16_t physics_phase(void) {
+    const uint32_t period = physics_stage_cfg.period_ticks;
+    const uint32_t into = scheduler.now - (physics_stage_cfg.next_due - period);
+    const uint32_t phase = (into * 256u + FrameTimer_Get_Phase(&frame_timer)) / period;
+    return (phase > 256u) ? 256u : (uint16_t)phase;
+}
+
+static uint8_t render_stage(uint32_t periods) {
+    (void)periods;
+    if (te_paced) {
+        // Runs every tick, and draws once the panel has started a new refresh and the LCD is free
+        if (LCD_Get_TE_Count() == last_te || LCD_Refresh_Busy()) {
+            return 1;
+        }
+    }
+    else if (LCD_Refresh_Busy()) {
+        return 0;  // Still due; dropped if the bus is busy for a whole period
+    }
+    last_te = LCD_Get_TE_Count();
+    render_pong(physics_phase());
+#if PONG_LATENCY_STATS
+    if (++frames_since_report >= LATENCY_REPORT_FRAMES) {
+        frames_since_report = 0;
+        Latency_Report(&latency);
+    }
+#endif
+#if PONG_PROFILER
+    profiler_frame_end();
+#endif
+    return 1;
+}
+
+static Scheduler_Stage_t render_stage_cfg = {.name = "render", .run = render_stage,
+                                             .rate_hz = FPS, .priority = 2, .max_catch_up = 1};
+
+#if PONG_TELEMETRY
+static uint8_t telemetry_stage(uint32_t periods) {
+    (void)periods;
+    static uint32_t last_steps = 0;
+    send_telemetry(physics_steps, physics_steps - last_steps, physics_stage_cfg.last_cycles,
+                   render_stage_cfg.last_cycles);
+    last_steps = physics_steps;
+    return 1;
+}
+
+static Scheduler_Stage_t telemetry_stage_cfg = {.name = "telemetry", .run = telemetry_stage,
+                                                .rate_hz = PONG_TELEMETRY_HZ, .priority = 3, .max_catch_up = 1};
+#endif
+
+#if PONG_HIGH_SCORES
+static uint8_t store_stage(uint32_t periods) {
+    (void)periods;
+    FlashStore_Poll(&flash_store);  // Never waits: at most one flash operation started
+    return 1;
+}
+
+static Scheduler_Stage_t store_stage_cfg = {.name = "store", .run = store_stage,
+                                            .rate_hz = 0, .priority = 4, .max_catch_up = 1};
+#endif
+
+#if PONG_DUTY_STATS
+static uint8_t duty_stage(uint32_t periods) {
+    (void)periods;
+    report_duty(FrameTimer_Take_Duty_Cycle(&frame_timer));
+    return 1;
+}
+
+static Scheduler_Stage_t duty_stage_cfg = {.name = "duty", .run = duty_stage,
+                                           .rate_hz = 1, .priority = 5, .max_catch_up = 1};
+#endif
+#endif
+
+#if PONG_BALL_TRAILS || PONG_PHOSPHOR_TRAILS
+#if PONG_BALL_TRAILS
+// Opacity of the ball trails, in 16ths
+#define TRAIL_ALPHA 6
+static LCD_Blend_Table trail_table;
+#else
+// Frames a phosphor trail takes to fade out, one colour of the ramp each
+#define TRAIL_LEVELS 8
+#endif
+
+// Work the trail colours out for the active palette and hand them to the engine
+static void build_trails(void) {
+#if PONG_BALL_TRAILS
+    LCD_Build_Blend_Table(&trail_table, TRAIL_ALPHA);
+    PongEngine_SetTrails(&pong_engine, 15, &trail_table);
+#else
+    // The ball's colour over the background at rising opacities, nearest palette colour each
+    static LCD_Blend_Table table;
+    uint8_t ramp[TRAIL_LEVELS];
+    for (uint8_t level = 0; level < TRAIL_LEVELS; level++) {
+        LCD_Build_Blend_Table(&table, (uint8_t)(LCD_BLEND_OPAQUE * (level + 1) / (TRAIL_LEVELS + 1)));
+        ramp[level] = table.index[15][0];
+    }
+    PongEngine_SetPhosphor(&pong_engine, ramp, TRAIL_LEVELS);
+#endif
+}
+#endif
+
+#if PONG_CONSOLE
+// ===== COMMAND CONSOLE =====
+// Frame times are render_pong() from start to the refresh being handed over, the wait for the
+// draw buffer included, counted in buckets up to each of these bounds (the last has the rest)
+#define FRAME_BUCKETS 7
+static const uint16_t frame_bucket_us[FRAME_BUCKETS - 1] = {1000, 2000, 4000, 8000, 16667, 33333};
+static uint32_t frame_histogram[FRAME_BUCKETS];
+static uint32_t frame_longest_us = 0;
+
+static void frame_stats_add(uint32_t cycles) {
+    const uint32_t us = cycles / (SystemCoreClock / 1000000u);
+    uint8_t bucket = 0;
+    while (bucket < FRAME_BUCKETS - 1 && us > frame_bucket_us[bucket]) {
+        bucket++;
+    }
+    frame_histogram[bucket]++;
+    if (us > frame_longest_us) {
+        frame_longest_us = us;
+    }
+}
+
+static void console_stats(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    uint32_t frames = 0;
+    for (uint8_t i = 0; i < FRAME_BUCKETS; i++) {
+        frames += frame_histogram[i];
+    }
+    printf("Frames: %lu at %u fps, longest %lu us\n", (unsigned long)frames, (unsigned)render_fps,
+           (unsigned long)frame_longest_us);
+    for (uint8_t i = 0; i < FRAME_BUCKETS; i++) {
+        if (i < FRAME_BUCKETS - 1) {
+            printf("  <= %5u us: %lu\n", (unsigned)frame_bucket_us[i], (unsigned long)frame_histogram[i]);
+        } else {
+            printf("  >  %5u us: %lu\n", (unsigned)frame_bucket_us[i - 1], (unsigned long)frame_histogram[i]);
+        }
+    }
+    LCD_Refresh_Stats lcd;
+    LCD_Get_Refresh_Stats(&lcd);
+    printf("LCD: %lu refreshes, %lu rows sent, %lu skipped, %lu bytes sent, %lu waits\n",
+           (unsigned long)lcd.refreshes, (unsigned long)lcd.rows_sent,
+           (unsigned long)(lcd.refreshes * ST7789V2_HEIGHT - lcd.rows_sent),
+           (unsigned long)lcd.bytes_sent, (unsigned long)lcd.waits);
+    printf("LCD faults: %lu, recoveries: %lu\n", (unsigned long)lcd.faults, (unsigned long)lcd.recoveries);
+#if LCD_ROW_CACHE_ROWS
+    printf("LCD rows sent from the cache: %lu\n", (unsigned long)lcd.rows_cached);
+#endif
+#if LCD_REFRESH_CHECK
+    printf("LCD rows checked: %lu, mismatched: %lu\n", (unsigned long)lcd.check_rows,
+           (unsigned long)lcd.check_mismatches);
+#endif
+    printf("SPI: divider %u (%lu kHz clock)\n", (unsigned)cfg0.spi_baud_div,
+           (unsigned long)(HAL_RCC_GetPCLK1Freq() / (2u << cfg0.spi_baud_div) / 1000u));
+#if ST7789V2_BUS_STATS
+    // Driver totals since start-up (not cleared by reset: the profiler and telemetry take deltas)
+    const ST7789V2_Bus_Stats_t* bus = &cfg0.bus_stats;
+    printf("SPI sent: %lu pixel bytes, %lu command bytes, %lu windows (%lu CASET/RASET), %lu ms busy\n",
+           (unsigned long)bus->pixel_bytes, (unsigned long)bus->command_bytes, (unsigned long)bus->windows,
+           (unsigned long)bus->window_commands, (unsigned long)(bus->busy_cycles / (SystemCoreClock / 1000u)));
+#endif
+    printf("Physics overruns: %lu, log messages dropped: %lu\n",
+           (unsigned long)FrameTimer_Get_Overruns(&frame_timer), (unsigned long)UartLog_Get_Dropped(&uart_log));
+}
+
+static void console_reset(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    memset(frame_histogram, 0, sizeof(frame_histogram));
+    frame_longest_us = 0;
+    LCD_Reset_Refresh_Stats();
+#if PONG_JITTER_STATS
+    jitter_reset();
+#endif
+    printf("Stats reset\n");
+}
+
+#if PONG_JITTER_STATS
+static void console_jitter(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    jitter_report();
+}
+#endif
+
+// Reads a whole decimal number, 0 if it isn't one
+static uint8_t console_number(const char* text, uint32_t* value) {
+    char* end;
+    *value = strtoul(text, &end, 10);
+    return end != text && *end == '\0';
+}
+
+static void console_set(int argc, char** argv) {
+    uint32_t value;
+    if (argc != 3 || !console_number(argv[2], &value)) {
+        printf("Usage: set fps <n> | set spi_div <0-7>\n");
+        return;
+    }
+    if (strcmp(argv[1], "fps") == 0) {
+#if PONG_SCHEDULER
+        if (value == 0 || te_paced || !Scheduler_Set_Rate(&scheduler, &render_stage_cfg, value)) {
+            printf("fps must be 1 to %u, and the TE pin not connected\n", (unsigned)PONG_SCHEDULER_HZ);
+            return;
+        }
+        render_fps = (uint16_t)value;
+#else
+        // At most a frame a physics step, the loop's wake-ups
+        if (value == 0 || value > PONG_PHYSICS_HZ || cfg0.TE.port != NULL) {
+            printf("fps must be 1 to %u, and the TE pin not connected\n", (unsigned)PONG_PHYSICS_HZ);
+            return;
+        }
+        set_render_fps((uint16_t)value);
+#endif
+#if PONG_ADAPTIVE_QUALITY
+        governor.budget_cycles = SystemCoreClock / render_fps * 3 / 4;
+#endif
+    } else if (strcmp(argv[1], "spi_div") == 0) {
+        if (value > ST7789V2_BAUD_DIV_256) {
+            printf("spi_div must be 0 (/2) to 7 (/256)\n");
+            return;
+        }
+        LCD_Refresh_Wait();  // Not under a running refresh
+        ST7789V2_Set_Baud_Div(&cfg0, (uint8_t)value);
+    } else {
+        printf("Unknown setting '%s'\n", argv[1]);
+        return;
+    }
+    printf("%s = %lu\n", argv[1], (unsigned long)value);
+}
+
+static void console_palette(int argc, char** argv) {
+    static const char* const names[] = {"default", "greyscale", "vintage", "custom"};
+    for (uint8_t i = 0; argc == 2 && i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(argv[1], names[i]) == 0) {
+            LCD_Set_Palette((LCD_Palette)i);  // Waits for a running refresh first
+#if PONG_BALL_TRAILS || PONG_PHOSPHOR_TRAILS
+            build_trails();  // The trail colours were the old palette's
+#endif
+            printf("Palette %s\n", names[i]);
+            return;
+        }
+    }
+    printf("Usage: palette default|greyscale|vintage|custom\n");
+}
+
+static void console_dma(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    DmaChannel_Report();
+}
+
+#if PONG_FRAME_DUMP
+static FrameDump_t frame_dump;
+static uint8_t frame_dump_wanted = 0;  // Set by "dump", cleared by the next frame drawn
+
+static void console_dump(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    if (FrameDump_Get_State(&frame_dump) == FRAMEDUMP_SENDING) {
+        printf("A dump is still being sent\n");
+        return;
+    }
+    frame_dump_wanted = 1;
+    printf("Dumping the next frame\n");
+}
+
+// Captures the frame just drawn, before it is handed to the LCD (and, double-buffered, before
+// the buffers swap): the whole frame at once, so it is never torn
+static void frame_dump_capture(void) {
+    uint16_t palette[FRAMEDUMP_MAX_COLOURS];
+    for (uint8_t i = 0; i < FRAMEDUMP_MAX_COLOURS; i++) {
+        const uint16_t colour = LCD_Get_Palette_Colour(i);
+        palette[i] = (uint16_t)((colour << 8) | (colour >> 8));  // The LCD keeps them byte-swapped
+    }
+    uint8_t row[ST7789V2_WIDTH];
+    FrameDump_Begin(&frame_dump, ST7789V2_WIDTH, ST7789V2_HEIGHT, palette, FRAMEDUMP_MAX_COLOURS);
+    for (uint16_t y = 0; y < ST7789V2_HEIGHT; y++) {
+        LCD_Get_Row(y, 0, ST7789V2_WIDTH - 1, row);
+        if (!FrameDump_Add_Row(&frame_dump, row)) {
+            printf("Frame dump: over FRAMEDUMP_BUFFER_BYTES (%u), not sent\n", (unsigned)FRAMEDUMP_BUFFER_BYTES);
+            return;
+        }
+    }
+}
+
+// Sends as many packets as the log has room for, never waiting for the UART
+static void frame_dump_send(void) {
+    uint8_t packet[FRAMEDUMP_PACKET_BYTES];
+    uint16_t length;
+    while ((length = FrameDump_Packet(&frame_dump, packet)) > 0 &&
+           UartLog_Write(&uart_log, (const char*)packet, length) > 0) {
+        FrameDump_Packet_Sent(&frame_dump);
+    }
+}
+#endif
+
+#if PONG_AUTO_TUNE
+// An empty profile in its place, so the next start-up tunes again
+static void console_retune(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    const LCD_Profile_t none = {0};
+    if (!FlashStore_Write(&flash_store, STORE_KEY_LCD_PROFILE, (const uint8_t*)&none, sizeof(none))) {
+        printf("The flash store is busy, try again\n");
+        return;
+    }
+    printf("LCD profile cleared: the next start-up tunes again\n");
+}
+#endif
+
+static const Console_Command_t console_commands[] = {
+    {"stats", "stats: frame time histogram, LCD refresh counts, SPI clock", console_stats},
+    {"reset", "reset: clear the frame times and LCD counts", console_reset},
+    {"set", "set fps <n> | set spi_div <0-7>: frames drawn a second, SPI clock divider", console_set},
+    {"palette", "palette default|greyscale|vintage|custom: switch the LCD palette", console_palette},
+    {"dma", "dma: owner and request of each DMA channel in use", console_dma},
+#if PONG_JITTER_STATS
+    {"jitter", "jitter: p50/p95/p99/max of the frame interval, update and render, last frames", console_jitter},
+#endif
+#if PONG_FRAME_DUMP
+    {"dump", "dump: send the next frame drawn, for FrameDump/frame_dump_to_png.py", console_dump},
+#endif
+#if PONG_AUTO_TUNE
+    {"retune", "retune: clear the stored LCD profile, so the next start-up tunes again", console_retune},
+#endif
+};
+
+Console_cfg_t console = {
+    .huart = &huart2,
+    .dma_channel = DMA1_Channel6,  // USART2_RX
+    .dma_request = 2,
+    .commands = console_commands,
+    .command_count = sizeof(console_commands) / sizeof(console_commands[0]),
+    .setup_done = 0
+};
+
+#if PONG_SCHEDULER
+static uint8_t console_stage(uint32_t periods) {
+    (void)periods;
+    Console_Poll(&console);
+#if PONG_FRAME_DUMP
+    frame_dump_send();
+#endif
+    return 1;
+}
+
+static Scheduler_Stage_t console_stage_cfg = {.name = "console", .run = console_stage,
+                                              .rate_hz = 20, .priority = 6, .max_catch_up = 1};
+#endif
+#endif
+
+#if PONG_SCHEDULER
+// Register the stages of the game loop
+static void register_stages(void) {
+    Scheduler_Init(&scheduler, PONG_SCHEDULER_HZ);
+    te_paced = (cfg0.TE.port != NULL);
+    last_te = LCD_Get_TE_Count();
+    if (te_paced) {
+        render_stage_cfg.rate_hz = 0;  // Paced by the panel instead of FPS
+    }
+    Scheduler_Register(&scheduler, &input_stage_cfg);
+    Scheduler_Register(&scheduler, &physics_stage_cfg);
+    Scheduler_Register(&scheduler, &render_stage_cfg);
+#if PONG_TELEMETRY
+    Scheduler_Register(&scheduler, &telemetry_stage_cfg);
+#endif
+#if PONG_HIGH_SCORES
+    Scheduler_Register(&scheduler, &store_stage_cfg);
+#endif
+#if PONG_DUTY_STATS
+    Scheduler_Register(&scheduler, &duty_stage_cfg);
+#endif
+#if PONG_CONSOLE
+    Scheduler_Register(&scheduler, &console_stage_cfg);
+#endif
+}
+#endif
+
+#if PONG_RTOS
+// ===== RTOS TASKS =====
+// The game as CMSIS-RTOS2 tasks (FreeRTOS underneath), highest priority first:
+// - game: woken by the TIM6 interrupt through a thread flag, steps the engine (catching up
+//   missed steps), handles the game events and tells render when a frame is due
+// - input: samples the joystick every PONG_INPUT_HZ on the kernel tick
+// - render: draws a frame when told to, and sleeps on a thread flag from the LCD DMA
+//   interrupt while a refresh is going out, so the lower tasks and idle run meanwhile
+// Audio has no task: BuzzerSeq and the jingle are played by the TIM7 interrupt and DMA.
+// The engine is guarded by a mutex (priority inheritance), as game steps it while render
+// draws it. Only the game task prints, so the UartLog ring keeps a single producer.
+#define RTOS_FLAG_STEP           0x01u  // game: the frame timer ticked
+#define RTOS_FLAG_FRAME          0x02u  // render: a frame is due
+#define RTOS_FLAG_REFRESH_DONE   0x04u  // render: the last refresh has been sent
+#define RTOS_FLAG_STOP           0x08u  // input, render: the game is over
+#define RTOS_FLAG_INPUT_STOPPED  0x10u  // game: the input task has finished
+#define RTOS_FLAG_RENDER_STOPPED 0x20u  // game: the render task has finished
+
+static osThreadId_t game_thread = NULL;
+static osThreadId_t input_thread = NULL;
+static osThreadId_t render_thread = NULL;
+static osMutexId_t engine_mutex = NULL;
+static UserInput rtos_input;        // Latest sample, copied with the scheduler locked
+static uint32_t idle_cycles = 0;    // DWT cycles the idle task slept, for the duty cycle
+
+// LCD_RefreshAsync() callback (DMA interrupt)
+static void rtos_refresh_done(void) {
+    osThreadFlagsSet(render_thread, RTOS_FLAG_REFRESH_DONE);
+}
+
+// Block the calling task until the LCD is not sending; the others run meanwhile. A flag left
+// from an earlier refresh only makes the loop check again.
+static void rtos_wait_refresh(void) {
+    while (LCD_Refresh_Busy()) {
+        osThreadFlagsWait(RTOS_FLAG_REFRESH_DONE, osFlagsWaitAny, osWaitForever);
+    }
+}
+
+// Idle task hook (configUSE_IDLE_HOOK): sleep until an interrupt, timing it. Masked around
+// WFI as in FrameTimer_Wait(), so the time is added before the interrupt can switch tasks.
+void vApplicationIdleHook(void) {
+    __disable_irq();
+    const uint32_t start = DWT->CYCCNT;
+    __WFI();
+    idle_cycles += DWT->CYCCNT - start;
+    __enable_irq();
+}
+
+#if PONG_DUTY_STATS
+// Share of the time since the last call that the CPU was not asleep in the idle task
+static uint16_t rtos_take_duty_cycle(void) {
+    static uint32_t window_start = 0;
+    __disable_irq();
+    const uint32_t now = DWT->CYCCNT;
+    const uint32_t window = now - window_start;
+    const uint32_t asleep = idle_cycles;
+    idle_cycles = 0;
+    window_start = now;
+    __enable_irq();
+    return (window == 0 || asleep >= window) ? 0 : (uint16_t)(1000u - (uint32_t)(((uint64_t)asleep * 1000u) / window));
+}
+#endif
+
+static void input_task(void* argument) {
+    (void)argument;
+    const uint32_t period = (osKernelGetTickFreq() >= PONG_INPUT_HZ) ? osKernelGetTickFreq() / PONG_INPUT_HZ : 1;
+    uint32_t next = osKernelGetTickCount();
+    while ((osThreadFlagsGet() & RTOS_FLAG_STOP) == 0) {
+        PROF_BEGIN(PROF_INPUT);
+        Joystick_Read(&joystick_cfg, &joystick_data);
+        PROF_END(PROF_INPUT);
+        UserInput input = Joystick_GetInput(&joystick_data);
+        apply_input_events(&input);
+        apply_buttons(&input);
+        const int32_t lock = osKernelLock();
+        rtos_input = input;
+        osKernelRestoreLock(lock);
+        next += period;
+        osDelayUntil(next);
+    }
+    osThreadFlagsSet(game_thread, RTOS_FLAG_INPUT_STOPPED);
+    osThreadExit();
+}
+
+static void render_task(void* argument) {
+    (void)argument;
+    for (;;) {
+        const uint32_t flags = osThreadFlagsWait(RTOS_FLAG_FRAME | RTOS_FLAG_STOP, osFlagsWaitAny, osWaitForever);
+        if ((flags & osFlagsError) == 0 && (flags & RTOS_FLAG_STOP)) {
+            break;
+        }
+        // Waited for here, not holding the engine: render_pong() then finds the draw buffer
+        // free and its refresh starts at once
+        rtos_wait_refresh();
+        osMutexAcquire(engine_mutex, osWaitForever);
+        render_pong(FrameTimer_Get_Phase(&frame_timer));
+        osMutexRelease(engine_mutex);
+#if PONG_PROFILER
+        profiler_frame_end();
+#endif
+    }
+    rtos_wait_refresh();
+    osThreadFlagsSet(game_thread, RTOS_FLAG_RENDER_STOPPED);
+    osThreadExit();
+}
+
+static void game_task(void* argument) {
+    (void)argument;
+    // With the TE pin connected, frames are paced by the panel's own refresh instead of FPS
+    const uint8_t te_paced = (cfg0.TE.port != NULL);
+    uint32_t last_te = LCD_Get_TE_Count();
+#if PONG_LATENCY_STATS
+    uint32_t frames_since_report = 0;
+#endif
+#if PONG_DUTY_STATS
+    uint32_t duty_report_step = 0;
+#endif
+
+    EventQueue_Init(&game_events);
+    while (game_running()) {
+        osThreadFlagsWait(RTOS_FLAG_STEP, osFlagsWaitAny, osWaitForever);
+        uint32_t steps = FrameTimer_Take_Steps(&frame_timer);
+#if PONG_LATENCY_STATS
+        Latency_Mark_Step(&latency);
+#endif
+        int32_t lock = osKernelLock();
+        const UserInput input = rtos_input;
+        osKernelRestoreLock(lock);
+
+#if PONG_TELEMETRY
+        const uint32_t telemetry_steps = steps;
+        const uint32_t telemetry_start = DWT->CYCCNT;
+#endif
+        osMutexAcquire(engine_mutex, osWaitForever);
+        while (steps-- && game_running()) {
+            PROF_BEGIN(PROF_UPDATE);
+            update_pong(input);
+            PROF_END(PROF_UPDATE);
+            render_step_done();
+#if PONG_LATENCY_STATS
+            Latency_Mark_Update(&latency, joystick_data.sample_cycles);
+#endif
+        }
+        osMutexRelease(engine_mutex);
+#if PONG_TELEMETRY
+        // The render time is render's own, on another task: not included
+        send_telemetry(frame_timer.consumed, telemetry_steps, DWT->CYCCNT - telemetry_start, 0);
+#endif
+
+        const uint8_t frame_due = te_paced ? (LCD_Get_TE_Count() != last_te)
+                                           : render_is_due();
+        if (frame_due && !LCD_Refresh_Busy()) {
+            last_te = LCD_Get_TE_Count();
+            render_taken();
+            osThreadFlagsSet(render_thread, RTOS_FLAG_FRAME);
+#if PONG_LATENCY_STATS
+            if (++frames_since_report >= LATENCY_REPORT_FRAMES) {
+                frames_since_report = 0;
+                Latency_Report(&latency);
+            }
+#endif
+        }
+#if PONG_HIGH_SCORES
+        FlashStore_Poll(&flash_store);  // Never waits: at most one flash operation started
+#endif
+#if PONG_DUTY_STATS
+        if (frame_timer.consumed - duty_report_step >= PONG_PHYSICS_HZ) {
+            duty_report_step = frame_timer.consumed;
+            report_duty(rtos_take_duty_cycle());
+        }
+#endif
+    }
+
+    // Let input and render finish what they are doing, then carry on alone
+    osThreadFlagsSet(input_thread, RTOS_FLAG_STOP);
+    osThreadFlagsSet(render_thread, RTOS_FLAG_STOP);
+    osThreadFlagsWait(RTOS_FLAG_INPUT_STOPPED | RTOS_FLAG_RENDER_STOPPED, osFlagsWaitAll, osWaitForever);
+    finish_game();
+}
+
+// Start the tasks and the kernel; the game task ends in finish_game(), so this never returns
+static void rtos_play(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    osKernelInitialize();
+    const osMutexAttr_t mutex_attr = {.name = "engine", .attr_bits = osMutexPrioInherit};
+    engine_mutex = osMutexNew(&mutex_attr);
+    const osThreadAttr_t game_attr = {.name = "game", .stack_size = 3072, .priority = osPriorityHigh};
+    const osThreadAttr_t input_attr = {.name = "input", .stack_size = 1024, .priority = osPriorityAboveNormal};
+    const osThreadAttr_t render_attr = {.name = "render", .stack_size = 2048, .priority = osPriorityNormal};
+    game_thread = osThreadNew(game_task, NULL, &game_attr);
+    input_thread = osThreadNew(input_task, NULL, &input_attr);
+    render_thread = osThreadNew(render_task, NULL, &render_attr);
+
+    // Interrupts that call the kernel must be at or below configMAX_SYSCALL_INTERRUPT_PRIORITY
+    // (MX_TIM6_Init() sets TIM6 to 0, so lower it afterwards). EXTI15_10 is the TE line, which
+    // starts a synced refresh and so can end in rtos_refresh_done() (MX_GPIO_Init() sets it to 0).
+    MX_TIM6_Init();
+    HAL_NVIC_SetPriority(TIM6_DAC_IRQn, 5, 0);
+    NVIC_SetPriority(DMA1_Channel5_IRQn, 5);
+    HAL_NVIC_SetPriority(EXTI15_10_IRQn, 5, 0);
+    FrameTimer_Init(&frame_timer);
+    osKernelStart();
+}
+#endif
 
 // ===== Main Function =====
 
@@ -138,112 +2049,778 @@ void render_pong(void);
   * @brief  The application entry point - Pong Game Demo
   * @retval int
   */
+// A game from the start: the engine, and the journal and history kept of it
+static void new_game(void) {
+    // Initialize Pong Game Engine
+    // PongEngine_Init(engine, paddle_x, paddle_y, paddle_width, paddle_height, ball_size, ball_speed)
+    PongEngine_Init(&pong_engine, 
+                    10,     // paddle at left side
+                    100,    // roughly center Y
+                    4,      // paddle width (4 pixels)
+                    40,     // paddle height (40 pixels)
+                    6,      // ball size (6 pixels - adjust for difficulty)
+                    8.0f);  // ball speed (8 pixels/frame - adjust for difficulty)
+#if PONG_REPLAY_RECORD
+    Replay_Init(&replay, REPLAY_RECORD);
+    PongEngine_SetReplay(&pong_engine, &replay);
+#endif
+#if PONG_STATE_HISTORY
+    SnapshotRing_Init(&state_history);
+    history_step = 0;
+#endif
+}
+
+#if PONG_AUTO_TUNE
+#define TUNE_FRAMES 60         // Game frames timed for each rows-per-batch candidate
+#define TUNE_SEED 0x5EED5EEDu  // So each candidate draws the same game
+
+static uint32_t tune_us(uint32_t cycles) {
+    return cycles / (SystemCoreClock / 1000000u);
+}
+
+// A whole screen, in the other colour from the last, so every row is sent
+static uint32_t tune_full_frame(void) {
+    static uint8_t colour = 0;
+    colour ^= 1u;
+    LCD_Fill_Buffer(colour);
+    const uint32_t start = DWT->CYCCNT;
+    LCD_Refresh(&cfg0);
+    return DWT->CYCCNT - start;
+}
+
+// TUNE_FRAMES of a game from the same start, a physics step and a blocking refresh each
+// @param refresh_cycles Set to the cycles spent in LCD_Refresh() over all of them
+// @return Cycles of the slowest frame, its update, draw and refresh
+static uint32_t tune_game_frames(uint32_t* refresh_cycles) {
+    Random_Seed(TUNE_SEED);
+    new_game();
+    LCD_Fill_Buffer(0);
+    LCD_Refresh(&cfg0);
+    uint32_t slowest = 0;
+    *refresh_cycles = 0;
+    for (uint16_t frame = 0; frame < TUNE_FRAMES; frame++) {
+        const uint32_t start = DWT->CYCCNT;
+        PongEngine_UpdateN(&pong_engine, NULL, 1, NULL);  // Quiet: no beeps while tuning
+        LCD_Clear_Background(0);
+        PongEngine_Draw(&pong_engine);
+        const uint32_t refresh_start = DWT->CYCCNT;
+        LCD_Refresh(&cfg0);
+        const uint32_t end = DWT->CYCCNT;
+        *refresh_cycles += end - refresh_start;
+        if (end - start > slowest) {
+            slowest = end - start;
+        }
+    }
+    return slowest;
+}
+
+// Finds the settings for this board and panel, and leaves them set. Takes a second or two,
+// the tuning frames showing on the panel
+static void lcd_tune(LCD_Profile_t* profile) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    memset(profile, 0, sizeof(*profile));
+    profile->version = LCD_PROFILE_VERSION;
+    profile->fastest_baud_div = cfg0.spi_baud_div;
+    profile->max_fps = PONG_RENDER_FPS;
+    profile->core_hz = SystemCoreClock;
+
+    // A faster SPI clock only ever sends sooner, so the fastest divider read back right wins
+    uint8_t baud_div = cfg0.spi_baud_div;
+    while (baud_div < ST7789V2_BAUD_DIV_256 && !ST7789V2_Test_Baud(&cfg0, baud_div)) {
+        baud_div++;
+    }
+    ST7789V2_Set_Baud_Div(&cfg0, baud_div);
+    profile->spi_baud_div = baud_div;
+    tune_full_frame();  // Over the test pattern, which the image buffer doesn't know of
+    profile->full_frame_us = (uint16_t)tune_us(tune_full_frame());
+
+    // Bigger batches send fewer window commands, but each row the union of the batch's
+    // spans: which is quicker depends on what is drawn, so time the game itself
+    uint32_t best_refresh = UINT32_MAX;
+    uint32_t best_slowest = 0;
+    uint16_t lines = 1;
+    while (1) {
+        LCD_Set_Lines_Per_Batch(lines);
+        uint32_t refresh_cycles;
+        const uint32_t slowest = tune_game_frames(&refresh_cycles);
+        printf("LCD tune: %u rows a batch, %lu us refresh, slowest frame %lu us\n", (unsigned)lines,
+               (unsigned long)tune_us(refresh_cycles / TUNE_FRAMES), (unsigned long)tune_us(slowest));
+        if (refresh_cycles < best_refresh) {
+            best_refresh = refresh_cycles;
+            best_slowest = slowest;
+            profile->lines_per_batch = (uint8_t)lines;
+        }
+        if (lines >= LCD_MAX_LINES_PER_BATCH || lines >= UINT8_MAX) {
+            break;
+        }
+        lines = (lines * 2u < LCD_MAX_LINES_PER_BATCH) ? lines * 2u : LCD_MAX_LINES_PER_BATCH;
+    }
+    LCD_Set_Lines_Per_Batch(profile->lines_per_batch);
+    profile->game_frame_us = (uint16_t)tune_us(best_slowest);
+
+    // The highest rate whose slowest frame fits in 3/4 of its period, the rest for the
+    // physics steps (PONG_ADAPTIVE_QUALITY's budget)
+    uint32_t fps = (SystemCoreClock / 4u * 3u) / (best_slowest ? best_slowest : 1u);
+    fps = (fps < 1u) ? 1u : (fps > PONG_RENDER_FPS) ? PONG_RENDER_FPS : fps;
+    profile->render_fps = (uint16_t)fps;
+
+    // Back to a game of its own
+    Random_Seed_Hardware();
+    new_game();
+}
+
+static void lcd_profile_apply(const LCD_Profile_t* profile) {
+    ST7789V2_Set_Baud_Div(&cfg0, profile->spi_baud_div);
+    LCD_Set_Lines_Per_Batch(profile->lines_per_batch);
+    play_fps = profile->render_fps;
+    set_render_fps(play_fps);
+#if PONG_SCHEDULER
+    render_stage_cfg.rate_hz = render_fps;  // Before register_stages()
+#endif
+}
+
+// Applies the profile kept in flash, or tunes and keeps one if there is none for this build
+static void lcd_profile_start(void) {
+    LCD_Profile_t profile;
+    const uint8_t length = FlashStore_Read(&flash_store, STORE_KEY_LCD_PROFILE, (uint8_t*)&profile, sizeof(profile));
+    if (length == sizeof(profile) && profile.version == LCD_PROFILE_VERSION &&
+        profile.core_hz == SystemCoreClock && profile.max_fps == PONG_RENDER_FPS &&
+        profile.fastest_baud_div == cfg0.spi_baud_div) {
+        lcd_profile_apply(&profile);
+        printf("LCD profile: SPI divider %u, %u rows a batch, %u fps\n", (unsigned)profile.spi_baud_div,
+               (unsigned)profile.lines_per_batch, (unsigned)profile.render_fps);
+        return;
+    }
+
+    lcd_tune(&profile);
+    lcd_profile_apply(&profile);
+    printf("LCD tuned: SPI divider %u (full screen %u us), %u rows a batch, %u fps (slowest frame %u us)\n",
+           (unsigned)profile.spi_baud_div, (unsigned)profile.full_frame_us, (unsigned)profile.lines_per_batch,
+           (unsigned)profile.render_fps, (unsigned)profile.game_frame_us);
+    // Nothing else is being written this early; finished now, in case of an early reset
+    FlashStore_Write(&flash_store, STORE_KEY_LCD_PROFILE, (const uint8_t*)&profile, sizeof(profile));
+    while (!FlashStore_Is_Idle(&flash_store)) {
+        HAL_Delay(1);
+        FlashStore_Poll(&flash_store);
+    }
+}
+#endif
+
 int main(void)
 {
+#if PONG_MEMORY_STATS
+    MemStats_Paint_Stack();
+#endif
+#if PONG_BOOT_TIMING
+    boot_timing_start();
+#endif
     /* MCU Configuration */
     HAL_Init();
+    BOOT_MARK("HAL_Init");
     SystemClock_Config();
     PeriphCommonClock_Config();
+    TimeBase_Init();
+    BOOT_MARK("SystemClock_Config");
+
+    // The LCD driver routes its own requests. Claiming its channels before any other
+    // module's init keeps everyone else off them
+    DmaChannel_Claim(cfg0.dma.channel, 1, &cfg0, "LCD SPI2_TX");
+#if LCD_DMA_CLEAR
+    DmaChannel_Claim(LCD_DMA_CLEAR_CHANNEL, 0, &cfg0, "LCD clear (mem-to-mem)");
+#endif
 
     /* Initialize peripherals */
     MX_GPIO_Init();
     MX_USART2_UART_Init();
+    UartLog_Init(&uart_log);
+#if PONG_CONSOLE
+    Console_Init(&console);
+#endif
+    BOOT_MARK("MX_GPIO/USART2_Init");
+#if PONG_WATCHDOG
+    if (RCC->CSR & RCC_CSR_IWDGRSTF) {
+        printf("Reset by the watchdog\n");
+    }
+    RCC->CSR |= RCC_CSR_RMVF;
+#endif
     MX_ADC1_Init();  // Initialize ADC for joystick
+    BOOT_MARK("MX_ADC1_Init");
     MX_RNG_Init();   // Initialize RNG for ball reset
+    Random_Seed_Hardware();  // Seed the software random generator once from the hardware RNG
+    BOOT_MARK("MX_RNG_Init + seed");
+#if PONG_HIGH_SCORES
+    // A blank or unreadable store leaves the table empty
+    FlashStore_Init(&flash_store);
+    FlashStore_Read(&flash_store, STORE_KEY_HIGH_SCORES, (uint8_t*)high_scores, sizeof(high_scores));
+    BOOT_MARK("FlashStore_Init");
+#endif
     
-    // Initialize LCD first (this sets up GPIOB pins)
-    LCD_init(&cfg0);
-
-    // Initialize buzzer timer
-    MX_TIM2_Init();
-    buzzer_init(&buzzer_cfg);
+#if PONG_STATUS_LED
+    // After the LCD's claims: TIM8_UP has only DMA2_Channel1, LCD_DMA_CLEAR's default. Without
+    // it the LED is steady on instead of blinking
+    StatusLed_Init();
+    StatusLed_Set(STATUSLED_HEARTBEAT, 0);
+#endif
+    // Initialize LCD first (this sets up GPIOB pins). The panel's ~300ms power-up runs on
+    // while the rest is set up, moved along by LCD_Init_Poll()
+#if LCD_REFRESH_CHECK
+    LCD_Set_Check_Callback(lcd_check_failed);  // Before LCD_Init_Poll() runs the self test
+#endif
+    LCD_Init_Start(&cfg0, HAL_GetTick());
+    BOOT_MARK("LCD_Init_Start");
+#if PONG_LCD_BENCH
+    while (!LCD_Init_Poll(&cfg0, HAL_GetTick())) {
+    }
+    LCDBench_Run(&cfg0);
+    UartLog_Flush(&uart_log);
+    while (1) {
+        __WFI();
+    }
+#endif
 
-    // Initialize TIM4 AFTER LCD to avoid GPIO conflict on PB6
-    MX_TIM4_Init();
+#if !PONG_FAST_BOOT
+    init_feedback_peripherals();
+    LCD_Init_Poll(&cfg0, HAL_GetTick());
+    BOOT_MARK("Buzzer/TIM/PWM init");
+#endif
   
     // Initialize Joystick
+#if PONG_LATENCY_STATS
+    Latency_Init(&latency);  // Start the cycle counter before the first sample is timestamped
+#endif
+#if PONG_PROFILER
+    Profiler_Init();
+#endif
+#if PONG_JITTER_STATS
+    jitter_reset();  // Starts the cycle counter too
+#endif
+#if PONG_TRACE
+    Trace_Init(PONG_TRACE_SWO_HZ);
+#endif
+#if PONG_TELEMETRY || PONG_ADAPTIVE_QUALITY || PONG_CONSOLE
+    // Frame times are measured with the DWT cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+#if PONG_TWO_STICKS
+    Joystick_Scan_Init(&joystick_scan);
+#else
     Joystick_Init(&joystick_cfg);
+#endif
+    LCD_Init_Poll(&cfg0, HAL_GetTick());
+    BOOT_MARK("Joystick_Init");
+#if PONG_BUTTONS
+    EventQueue_Init(&button_events);
+    Buttons_Init(&buttons);
+#endif
     
-    // Initialize Pong Game Engine
-    // PongEngine_Init(engine, paddle_x, paddle_y, paddle_width, paddle_height, ball_size, ball_speed)
-    PongEngine_Init(&pong_engine, 
-                    10,     // paddle at left side
-                    100,    // roughly center Y
-                    4,      // paddle width (4 pixels)
-                    40,     // paddle height (40 pixels)
-                    6,      // ball size (6 pixels - adjust for difficulty)
-                    8.0f);  // ball speed (8 pixels/frame - adjust for difficulty)
+#if PONG_LINK_PLAY
+    // Both boards must build the same game: wait for the other one, then seed from the link
+    while (!LCD_Init_Poll(&cfg0, HAL_GetTick())) {
+    }
+    link_connect();
+#endif
+
+    new_game();
+    BOOT_MARK("PongEngine_Init");
     
+    // The panel has to be up before the first refresh
+    while (!LCD_Init_Poll(&cfg0, HAL_GetTick())) {
+    }
+    BOOT_MARK("LCD power-up (rest)");
+#if LCD_REFRESH_CHECK
+    printf("LCD self test: SPI divider %u\n", (unsigned)cfg0.spi_baud_div);
+#endif
+#if PONG_AUTO_TUNE
+    lcd_profile_start();  // Before the watchdog: the first start-up's tune takes a second or two
+    BOOT_MARK("LCD profile");
+#endif
+    if (DmaChannel_Conflicts()) {
+        // A module left without its channel runs without it (or not at all): say which
+        DmaChannel_Report();
+    }
+#if PONG_WATCHDOG
+    watchdog_start();
+#endif
+
+#if PONG_ASSET_PACK
+    load_assets();
+    BOOT_MARK("AssetPack_Open");
+#endif
+#if PONG_BALL_TRAILS || PONG_PHOSPHOR_TRAILS
+    build_trails();  // For the palette the game is drawn in, the pack's if it has one
+#endif
+
     // Clear screen
     LCD_Fill_Buffer(0);
     LCD_Refresh(&cfg0);
+    BOOT_MARK("First LCD_Refresh");
+#if PONG_BOOT_TIMING
+    boot_report();
+#endif
+#if PONG_SCOPE
+    scope_screen();
+#endif
 
+#if PONG_FAST_BOOT
+    init_feedback_peripherals();
+#else
+#if PONG_CLOCK_SCALING
+    set_clock_profile(CLOCK_PROFILE_LOW);  // Nothing but waiting until the game starts
+#endif
     // Startup animation
-    LCD_printString("PONG",  70, 50, 1, 4);
+#if PONG_ASSET_PACK
+    if (have_title_font) {
+        LCD_Build_Font_Shades(&title_shades);  // For the palette the pack set
+        LCD_Print_Font("PONG", (ST7789V2_WIDTH - LCD_Font_Width("PONG", &title_font)) / 2, 50, 1,
+                       &title_font, &title_shades);
+    } else {
+        LCD_printString_Aligned("PONG", ST7789V2_WIDTH / 2, 50, 1, 4, LCD_ALIGN_CENTRE);
+    }
+#else
+    LCD_printString_Aligned("PONG", ST7789V2_WIDTH / 2, 50, 1, 4, LCD_ALIGN_CENTRE);
+#endif
+#if PONG_ASSET_PACK
+    if (have_logo) {
+        LCD_Draw_Baked_Sprite((ST7789V2_WIDTH - logo.ncols) / 2, 100, &logo);
+    }
+#endif
     LCD_Refresh(&cfg0);
+#if PONG_ASSET_PACK
+    if (splash != NULL) {
+#if PONG_EXT_FLASH
+        AssetPack_Stream_t stream;
+        AssetPack_Stream_Open(&stream, &asset_pack, splash);
+        LCD_Show_Image_Stream(&cfg0, (ST7789V2_WIDTH - splash->width) / 2, 140, AssetPack_Stream_Read, &stream,
+                              splash_window, sizeof(splash_window));
+#else
+        LCD_Show_Image(&cfg0, (ST7789V2_WIDTH - splash->width) / 2, 140,
+                       AssetPack_Data(&asset_pack, splash), splash->size);
+#endif
+    }
+#endif
     HAL_Delay(1000);
     
-    // Display instructions
+    // Display instructions: white on black, so the 8-colour idle mode shows them unchanged
+    LCD_Set_Power_Profile(&cfg0, LCD_POWER_IDLE, 0, 0);
     LCD_Fill_Buffer(0);
-    LCD_printString("Use Joystick", 50, 30, 1, 2);
-    LCD_printString("UP/DOWN", 80, 60, 1, 2);
-    LCD_printString("to Move", 80, 85, 1, 2);
-    LCD_printString("Paddle!", 75, 110, 1, 2);
+    LCD_printString_Aligned("Use Joystick", ST7789V2_WIDTH / 2, 30, 1, 2, LCD_ALIGN_CENTRE);
+    LCD_printString_Aligned("UP/DOWN", ST7789V2_WIDTH / 2, 60, 1, 2, LCD_ALIGN_CENTRE);
+    LCD_printString_Aligned("to Move", ST7789V2_WIDTH / 2, 85, 1, 2, LCD_ALIGN_CENTRE);
+    LCD_printString_Aligned("Paddle!", ST7789V2_WIDTH / 2, 110, 1, 2, LCD_ALIGN_CENTRE);
     LCD_Refresh(&cfg0);
     HAL_Delay(2000);
-
-    // Initialize PWM for LED control - not used in this demo but included for completeness and future expansion
-    PWM_Init(&pwm_cfg);
-    PWM_SetFreq(&pwm_cfg, 1000);
-    PWM_SetDuty(&pwm_cfg, 0);
+    LCD_Set_Power_Profile(&cfg0, LCD_POWER_NORMAL, 0, 0);
+#if PONG_CLOCK_SCALING
+    set_clock_profile(CLOCK_PROFILE_FULL);
+#endif
+#endif
     
+#if !PONG_STATUS_LED
     // Ensure LD2 on PA5 starts OFF
     HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET);
+#endif
 
     printf("Pong Game Engine initialized.\n");
+#if PONG_ADAPTIVE_QUALITY
+    governor.budget_cycles = SystemCoreClock / render_fps * 3 / 4;  // the rest is for the physics steps
+    Governor_Init(&governor);
+#endif
+    game_start_us = time_us();
+    game_state = GAME_STATE_PLAYING;
 
-    uint32_t last_tick = HAL_GetTick();
+#if PONG_RTOS
+    rtos_play();
+#elif PONG_SCHEDULER
+    register_stages();
+    MX_TIM6_Init();
+    FrameTimer_Init(&frame_timer);
 
-    while (!game_over)
-    {
-      uint32_t now = HAL_GetTick();
-      if ((now - last_tick) < FRAME_TIME_MS) {
-        continue; // this means skip this whole loop iteration and start at the top of the while loop again
+    // Sleep until the next tick; the stages that are due run, each as often as it needs
+    EventQueue_Init(&game_events);
+    apply_input_events(NULL);
+    apply_buttons(NULL);
+    while (game_running()) {
+      Scheduler_Run(&scheduler, FrameTimer_Wait(&frame_timer));
+#if PONG_BUTTONS
+      if (game_state == GAME_STATE_PAUSED) {
+        pause_screen();
       }
-      last_tick = now;
+#endif
+    }
+#else
+    // With the TE pin connected, frames are paced by the panel's own refresh instead of FPS
+    const uint8_t te_paced = (cfg0.TE.port != NULL);
+    uint32_t last_te = LCD_Get_TE_Count();
+#if PONG_LATENCY_STATS
+    uint32_t frames_since_report = 0;
+#endif
+#if PONG_DUTY_STATS
+    uint32_t duty_report_step = 0;
+#endif
+    MX_TIM6_Init();
+    FrameTimer_Init(&frame_timer);
+
+    EventQueue_Init(&game_events);
+    apply_input_events(NULL);
+    apply_buttons(NULL);
+    while (game_running())
+    {
+      // Sleep until the next physics step is due. If the last iteration ran long
+      // (e.g. a render), steps > 1 runs the missed steps so the game keeps real-time speed
+      uint32_t steps = FrameTimer_Wait(&frame_timer);
+#if PONG_LATENCY_STATS
+      Latency_Mark_Step(&latency);
+#endif
 
       // ===== PONG GAME LOOP =====
       // Classic game loop pattern: INPUT -> UPDATE -> RENDER
         
       // Step 1: READ INPUT
+      PROF_BEGIN(PROF_INPUT);
       Joystick_Read(&joystick_cfg, &joystick_data);
+      PROF_END(PROF_INPUT);
         
       // Get UserInput structure from joystick data
       UserInput input = Joystick_GetInput(&joystick_data);
+      apply_input_events(&input);
+      apply_buttons(&input);
+#if PONG_BUTTONS
+      if (game_state == GAME_STATE_PAUSED) {
+        pause_screen();
+        continue;
+      }
+#endif
         
-      // Step 2: UPDATE GAME STATE
-      update_pong(input);
+      // Step 2: UPDATE GAME STATE (fixed physics steps)
+      // (the previous frame may still be going out to the LCD in the background)
+#if PONG_TELEMETRY
+      const uint32_t telemetry_steps = steps;
+      uint32_t telemetry_start = DWT->CYCCNT;
+#endif
+      while (steps-- && game_running()) {
+        PROF_BEGIN(PROF_UPDATE);
+        update_pong(input);
+        PROF_END(PROF_UPDATE);
+        render_step_done();
+#if PONG_LATENCY_STATS
+        Latency_Mark_Update(&latency, joystick_data.sample_cycles);
+#endif
+      }
         
-      // Step 3: RENDER TO SCREEN (full clear and redraw)
-      render_pong();
+#if PONG_TELEMETRY
+      const uint32_t update_cycles = DWT->CYCCNT - telemetry_start;
+      telemetry_start = DWT->CYCCNT;
+#endif
+
+      // Step 3: RENDER TO SCREEN
+      // Only when a frame is due and the LCD is free, so a saturated SPI bus skips
+      // frames instead of holding up the simulation
+      uint8_t frame_due = te_paced ? (LCD_Get_TE_Count() != last_te)
+                                   : render_is_due();
+      if (frame_due && !LCD_Refresh_Busy()) {
+        last_te = LCD_Get_TE_Count();
+        render_taken();
+        // Draw positions part way into the next step, so motion follows real time
+        render_pong(FrameTimer_Get_Phase(&frame_timer));
+#if PONG_LATENCY_STATS
+        if (++frames_since_report >= LATENCY_REPORT_FRAMES) {
+          frames_since_report = 0;
+          Latency_Report(&latency);
+        }
+#endif
+      }
+#if PONG_TELEMETRY
+      const uint32_t render_cycles = DWT->CYCCNT - telemetry_start;
+      send_telemetry(frame_timer.consumed, telemetry_steps, update_cycles, render_cycles);
+#endif
+#if PONG_HIGH_SCORES
+      FlashStore_Poll(&flash_store);  // Never waits: at most one flash operation started
+#endif
+#if PONG_CONSOLE
+      Console_Poll(&console);  // Only reads the ring once the line has gone idle
+#endif
+#if PONG_FRAME_DUMP
+      frame_dump_send();
+#endif
+#if PONG_PROFILER
+      profiler_frame_end();
+#endif
+#if PONG_DUTY_STATS
+      if (frame_timer.consumed - duty_report_step >= PONG_PHYSICS_HZ) {
+        duty_report_step = frame_timer.consumed;
+        report_duty(FrameTimer_Take_Duty_Cycle(&frame_timer));
+      }
+#endif
+    }
+#endif
+    finish_game();
+}
+
+#if PONG_ATTRACT_MODE
+// A demo game, silent and left out of the replay journal and state history
+static void demo_game(void) {
+    new_game();
+    PongEngine_SetReplay(&pong_engine, NULL);
+    pong_engine.quiet = 1;
+}
+
+// ATTRACT: the CPU on both paddles, at the 16MHz profile finish_game() switched to. The frame
+// timer is set up again for that clock; the LCD only sends the rows each frame changed.
+// Returns as soon as the stick moves
+static void attract_mode(void) {
+    game_state = GAME_STATE_ATTRACT;
+    demo_game();
+    LCD_Set_Power_Profile(&cfg0, LCD_POWER_NORMAL, 0, 0);
+    LCD_Fill_Buffer(0);
+    frame_timer.setup_done = 0;
+    FrameTimer_Init(&frame_timer);
+    set_render_fps(PONG_ATTRACT_FPS);
+    printf("Attract mode\n");
+
+    uint32_t check_step = 0;
+    for (;;) {
+        uint32_t steps = FrameTimer_Wait(&frame_timer);
+        Joystick_Read(&joystick_cfg, &joystick_data);
+        if (joystick_data.x_processed != 0 || joystick_data.y_processed != 0) {
+            return;
+        }
+        while (steps--) {
+            if (PongEngine_UpdateDemo(&pong_engine) == 0) {
+                demo_game();
+            }
+            render_step_done();
+        }
+        if (render_is_due() && !LCD_Refresh_Busy()) {
+            render_taken();
+            render_pong(FrameTimer_Get_Phase(&frame_timer));
+        }
+        // Once a second: half the frame rate while the CPU is awake more than the budget,
+        // back to the full rate once it is well under
+        if (frame_timer.consumed - check_step >= PONG_PHYSICS_HZ) {
+            check_step = frame_timer.consumed;
+            const uint16_t awake = FrameTimer_Take_Duty_Cycle(&frame_timer);
+            if (awake > PONG_ATTRACT_AWAKE_PERMILLE) {
+                set_render_fps(PONG_ATTRACT_FPS / 2);
+            } else if (awake < PONG_ATTRACT_AWAKE_PERMILLE / 2) {
+                set_render_fps(PONG_ATTRACT_FPS);
+            }
+        }
     }
+}
+
+// PLAYING again, at full speed, without the reset and splash screens of the other builds
+static void play_again(void) {
+    set_clock_profile(CLOCK_PROFILE_FULL);
+    new_game();
+    LCD_Set_Power_Profile(&cfg0, LCD_POWER_NORMAL, 0, 0);
+    LCD_Fill_Buffer(0);
+    set_render_fps(play_fps);
+    EventQueue_Init(&game_events);
+    frame_timer.setup_done = 0;
+    FrameTimer_Init(&frame_timer);  // After the switch, as at start-up
+    game_start_us = time_us();
+    game_state = GAME_STATE_PLAYING;
+}
+#endif
+
+/**
+ * @brief Wind the game down and show the game over screen
+ *
+ * Reports the statistics of the builds that keep them, plays the jingle, shows the score
+ * (and saves it with PONG_HIGH_SCORES), then sleeps until the player wants another game
+ * and resets. Called once the game loop has ended; it does not return. With
+ * PONG_ATTRACT_MODE it runs the attract demo instead of sleeping, and returns with a new
+ * game set up when the stick is moved.
+ */
+static void finish_game(void) {
+#if PONG_LINK_PLAY
+    // The other board may still be waiting for this one's last inputs to see the game end:
+    // keep the link going for half a second
+    for (uint32_t k = 0; k < PONG_PHYSICS_HZ / 2 && Lockstep_Get_Status(&lockstep) == LOCKSTEP_RUNNING; k++) {
+#if PONG_SCHEDULER
+      for (uint32_t t = 0; t < PONG_SCHEDULER_HZ / PONG_PHYSICS_HZ; t += FrameTimer_Wait(&frame_timer)) {
+      }
+#else
+      FrameTimer_Wait(&frame_timer);
+#endif
+      link_pump();
+      Lockstep_Step(&lockstep, &pong_engine, (UserInput){CENTRE, 0.0f, -1.0f});
+    }
+    printf("Link: %lu rollbacks (%lu steps run again), %lu stalls, %lu bad packets\n",
+           (unsigned long)lockstep.rollbacks, (unsigned long)lockstep.resimulated,
+           (unsigned long)lockstep.stalls, (unsigned long)lockstep.bad_packets);
+#endif
+    LCD_Refresh_Wait();
+    HAL_TIM_Base_Stop_IT(&htim6);
+    const uint32_t game_ms = (uint32_t)((time_us() - game_start_us) / 1000u);
+    printf("Game time: %lu.%03lu s\n", (unsigned long)(game_ms / 1000u), (unsigned long)(game_ms % 1000u));
+    printf("Physics overruns: %lu\n", (unsigned long)FrameTimer_Get_Overruns(&frame_timer));
+    printf("Physics substeps: up to %u per step\n", (unsigned)pong_engine.max_substeps);
+#if PONG_CHECK_INVARIANTS
+    printf("Invariants: %lu steps broke one (flags 0x%02X)\n", (unsigned long)invariant_failures,
+           (unsigned)invariant_flags);
+#endif
+#if PONG_SCHEDULER
+    Scheduler_Report(&scheduler);
+#endif
+#if PONG_LATENCY_STATS
+    Latency_Report(&latency);
+#endif
+#if PONG_MEMORY_STATS
+    MemStats_Report();
+    printf("Round arena: %u of %u bytes at most\n", pong_engine.round_arena.high_water,
+           pong_engine.round_arena.capacity);
+#endif
+#if PONG_REPLAY_RECORD
+    // Dump the journal as hex, 32 bytes per line
+    printf("Replay: %lu steps%s\n", (unsigned long)replay.steps, replay.overflow ? " (truncated)" : "");
+    uint8_t chunk[32];
+    uint16_t n;
+    while ((n = Replay_Read(&replay, chunk, sizeof(chunk))) > 0) {
+        for (uint16_t k = 0; k < n; k++) {
+            printf("%02X", chunk[k]);
+        }
+        printf("\n");
+        UartLog_Flush(&uart_log);  // the dump is longer than the log buffer
+    }
+#endif
+#if PONG_STATE_HISTORY
+    uint32_t oldest_step;
+    uint16_t oldest_length;
+    const uint8_t* oldest = SnapshotRing_Oldest(&state_history, &oldest_step, &oldest_length);
+    if (oldest != NULL) {
+        printf("State at step %lu of %lu (%u bytes):\n", (unsigned long)oldest_step,
+               (unsigned long)history_step, oldest_length);
+        for (uint16_t k = 0; k < oldest_length; k++) {
+            printf("%02X", oldest[k]);
+        }
+        printf("\n");
+    }
+#endif
     
-    int16_t line_offset = 0;
-    // Game over display
-    while (1) {
-        
-        LCD_Fill_Buffer(0);
-        LCD_printString("Game Over!", 20 , 0 +line_offset, 1, 3);
-        char score_str[32];
-        sprintf(score_str, "Score: %d", PongEngine_GetScore(&pong_engine));
-        LCD_printString(score_str, 20 , 20 + line_offset, 1, 2);
-        LCD_Refresh(&cfg0);
-        HAL_Delay(500);
-        line_offset += 10;
-        if (line_offset > 220) {
-            line_offset = 0;
-        } 
+#if PONG_CLOCK_SCALING
+    set_clock_profile(CLOCK_PROFILE_LOW);  // The reset for the next game brings the PLL back
+#endif
+
+#if PONG_AUDIO_MIXER
+    // Game over jingle: its notes queued at once, each delayed to follow the one before
+    uint16_t jingle_at_ms = 0;
+    for (uint32_t i = 0; i < sizeof(game_over_jingle) / sizeof(game_over_jingle[0]); i++) {
+        Mixer_Play(&mixer, game_over_jingle[i].freq_hz, game_over_jingle[i].volume_percent,
+                   game_over_jingle[i].duration_ms, jingle_at_ms);
+        jingle_at_ms += game_over_jingle[i].duration_ms;
+    }
+#else
+    // Game over jingle: once the last beep has finished, the timer's DMA plays it by itself
+    while (!BuzzerSeq_Is_Idle(&buzzer_seq)) {
     }
+    uint16_t jingle_steps = buzzer_wave_build(&buzzer_cfg, game_over_jingle,
+                                              sizeof(game_over_jingle) / sizeof(game_over_jingle[0]),
+                                              game_over_wave, GAME_OVER_JINGLE_STEPS);
+    buzzer_wave_play(&buzzer_cfg, game_over_wave, jingle_steps);
+#endif
+
+    // Game over display: drawn once, slid up into place with the panel's hardware scroll
+    // (one command per step, nothing redrawn or resent), then the CPU sleeps until the
+    // joystick is moved
+    LCD_Set_Scroll_Area(&cfg0, 0, 0);
+    LCD_Scroll(&cfg0, ST7789V2_HEIGHT / 2);
+    LCD_Fill_Buffer(0);
+    LCD_printString("Game Over!", 20, 0, 1, 3);
+    char score_str[32];
+    Fmt_Label_Int(score_str, sizeof(score_str), "Score: ", PongEngine_GetScore(&pong_engine));
+    LCD_printString(score_str, 20, 30, 1, 2);
+#if PONG_HIGH_SCORES
+    // Saved while the screen slides in, a double-word a frame
+    const uint8_t place = high_score_add(PongEngine_GetScore(&pong_engine));
+    Fmt_Label_Int(score_str, sizeof(score_str), (place == 0) ? "New best: " : "Best: ", high_scores[0]);
+    LCD_printString(score_str, 20, 52, 1, 2);
+#endif
+#if PONG_GAME_OVER_STOP2
+    LCD_printString("Press a button", 20, 80, 1, 2);
+#else
+    LCD_printString("Move joystick", 20, 80, 1, 2);
+#endif
+    LCD_printString("to play again", 20, 100, 1, 2);
+    LCD_Refresh(&cfg0);
+    for (uint16_t offset = ST7789V2_HEIGHT / 2 + 4; offset <= ST7789V2_HEIGHT; offset += 4) {
+        HAL_Delay(16);
+        LCD_Scroll(&cfg0, offset);  // ends on ST7789V2_HEIGHT, i.e. not scrolled
+#if PONG_HIGH_SCORES
+        FlashStore_Poll(&flash_store);
+#endif
+    }
+#if PONG_HIGH_SCORES
+    // Whatever is left (a page erase takes about 20ms) before the board can sleep or reset
+    while (!FlashStore_Is_Idle(&flash_store)) {
+        HAL_Delay(1);
+        FlashStore_Poll(&flash_store);
+    }
+#endif
+    // Only the text rows stay lit, in 8 colours, while waiting
+    LCD_Set_Power_Profile(&cfg0, LCD_POWER_PARTIAL_IDLE, 0, 119);
+
+#if PONG_GAME_OVER_STOP2
+    // Let the jingle and the log finish, as STOP2 halts the timers, DMA and UART
+#if PONG_AUDIO_MIXER
+    while (!Mixer_Is_Idle(&mixer)) {
+        HAL_Delay(1);
+    }
+#else
+    while (buzzer_cfg.dma_channel->CNDTR != 0) {
+        HAL_Delay(1);
+    }
+#endif
+    UartLog_Flush(&uart_log);
+    // The panel's tearing signal would wake the core every frame
+    if (cfg0.TE.port != NULL) {
+        EXTI->IMR1 &= ~(uint32_t)cfg0.TE.pin;
+    }
+    // The panel keeps showing its frame memory and the GPIOs hold their levels. Nothing has to
+    // be restored on waking: the game starts over from the splash screen with a reset
+#if PONG_STATUS_LED
+    StatusLed_Set(STATUSLED_OFF, 0);  // STOP2 freezes the timer, maybe with the LED lit
+#endif
+    HAL_SuspendTick();
+    HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
+    NVIC_SystemReset();
+#else
+    // The stick is likely still held from the last rally: let go first
+    do {
+        HAL_Delay(20);
+        Joystick_Read(&joystick_cfg, &joystick_data);
+    } while (joystick_data.x_processed != 0 || joystick_data.y_processed != 0);
+
+#if PONG_ATTRACT_MODE
+    // Moved within PONG_ATTRACT_DELAY_MS: another game straight away. Left alone, the CPU
+    // plays itself until someone moves it. Polled, which feeds the watchdog too
+    const uint32_t shown_ms = HAL_GetTick();
+    do {
+        HAL_Delay(20);
+        Joystick_Read(&joystick_cfg, &joystick_data);
+    } while (joystick_data.x_processed == 0 && joystick_data.y_processed == 0 &&
+             HAL_GetTick() - shown_ms < PONG_ATTRACT_DELAY_MS);
+    if (joystick_data.x_processed == 0 && joystick_data.y_processed == 0) {
+        attract_mode();
+    }
+    play_again();
+#elif PONG_WATCHDOG
+    // Polled rather than asleep until the ADC's analog watchdog wakes the core, as the
+    // IWDG has to be fed in the meantime
+    do {
+        HAL_Delay(20);
+        Joystick_Read(&joystick_cfg, &joystick_data);
+    } while (joystick_data.x_processed == 0 && joystick_data.y_processed == 0);
+#else
+    // Woken by the ADC analog watchdog, then start over from the splash screen
+    Joystick_Wait_For_Input(&joystick_cfg);
+#endif
+#if !PONG_ATTRACT_MODE
+    NVIC_SystemReset();
+#endif
+#endif
 }
 
 // ===== UPDATE & RENDER FUNCTIONS =====
@@ -260,13 +2837,84 @@ int main(void)
  * Separated from rendering for cleaner code architecture.
  */
 void update_pong(UserInput input) {
+#if PONG_BUTTONS
+    // Only the RTOS tasks step while paused (the other loops stop in pause_screen())
+    if (game_state == GAME_STATE_PAUSED) {
+        return;
+    }
+#endif
+#if PONG_TRACE
+    static Direction traced_direction = CENTRE;
+    if (input.direction != traced_direction) {
+        traced_direction = input.direction;
+        Trace_Event(TRACE_PORT_INPUT, (uint8_t)input.direction);
+    }
+    Trace_Event(TRACE_PORT_UPDATE, 0);
+#endif
+#if PONG_JITTER_STATS
+    const uint32_t update_start = DWT->CYCCNT;
+#endif
+#if PONG_LINK_PLAY
+    // Both paddles move from the two boards' inputs; a step may be held back for the other
+    // board, or steps since run again with its real input
+    link_pump();
+    Lockstep_Step(&lockstep, &pong_engine, input);
+    if (Lockstep_Get_Status(&lockstep) == LOCKSTEP_LOST) {
+        EventQueue_Push(&game_events, GAME_EVENT_OVER, GAME_OVER_LINK_LOST, PongEngine_GetScore(&pong_engine));
+        return;
+    }
+    // A game over seen on a predicted step may yet be rolled back
+    uint8_t lives = Lockstep_Is_Confirmed(&lockstep) ? PongEngine_GetLives(&pong_engine) : 1;
+#else
+#if PONG_CHECK_INVARIANTS
+    PongEngine_Watch_t watch;
+    PongEngine_Watch(&pong_engine, &watch);
+#endif
+#if PONG_TWO_STICKS
+    // The right paddle follows the second stick, whose latest pair is already in memory
+    Joystick_Read(&joystick2_cfg, &joystick2_data);
+    uint8_t lives = PongEngine_UpdateVersus(&pong_engine, input, Joystick_GetInput(&joystick2_data));
+#else
     // Update the game engine with input
     uint8_t lives = PongEngine_Update(&pong_engine, input);
+#endif
+#if PONG_CHECK_INVARIANTS
+    const uint8_t broken = PongEngine_Check(&pong_engine, &watch);
+    if (broken) {
+        invariant_failures++;
+        invariant_flags |= broken;
+    }
+#endif
+#endif
+#if PONG_JITTER_STATS
+    Jitter_Add(&update_cost, DWT->CYCCNT - update_start);
+#endif
+#if PONG_TRACE
+    Trace_Event(TRACE_PORT_UPDATE, 1);
+#endif
+#if PONG_STATE_HISTORY
+    SnapshotRing_Push(&state_history, &pong_engine, ++history_step);
+#endif
+
+    // Tell the loop what the step did: the player scoring pulses the LED (once, however many
+    // points the step made), and a life lost flashes the screen
+    PongEngine_Event_t event;
+    uint8_t scored = 0;
+    while (PongEngine_PollEvent(&pong_engine, &event)) {
+        if (event.type == PONG_EVENT_SCORE_CHANGED && event.side == PONG_SIDE_LEFT) {
+            scored = 1;
+        } else if (event.type == PONG_EVENT_LIFE_LOST && event.value > 0) {
+            EventQueue_Push(&game_events, GAME_EVENT_LIFE_LOST, 0, event.value);
+        }
+    }
+    const uint16_t score = PongEngine_GetScore(&pong_engine);
+    if (scored) {
+        EventQueue_Push(&game_events, GAME_EVENT_SCORED, 0, score);
+    }
     
     // Check for game over
     if (lives == 0) {
-        printf("Game Over! Final Score: %d\n", PongEngine_GetScore(&pong_engine));
-        game_over = 1;  // Exit game loop
+        EventQueue_Push(&game_events, GAME_EVENT_OVER, GAME_OVER_NO_LIVES, score);
     }
 }
 
@@ -278,36 +2926,217 @@ void update_pong(UserInput input) {
  * - Draws ball sprite
  * - Draws paddle sprite
  * - Draws debug information (lives, score)
- * - Refreshes LCD to display the frame
+ * - Starts a background LCD refresh to display the frame
  * 
  * Separated from game logic for cleaner code architecture.
  * IMPORTANT: This does a FULL clear and redraw every frame for simplicity.
+ * 
+ * @param alpha Fraction of a physics step since the last update (0 to LERP_ONE),
+ *              used to interpolate the ball and paddle positions
  */
-void render_pong(void) {
-    // Step 1: Clear screen buffer (full clear for simple rendering)
-    LCD_Fill_Buffer(0);
+void render_pong(uint16_t alpha) {
+#if PONG_TRACE
+    Trace_Event(TRACE_PORT_FRAME, 0);
+#endif
+    // A fault in the last frame's background refresh shows up here
+    display_check();
+#if PONG_JITTER_STATS
+    Jitter_Mark(&frame_interval);
+#endif
+#if PONG_ADAPTIVE_QUALITY || PONG_CONSOLE || PONG_JITTER_STATS
+    // The whole frame is timed, the wait for the draw buffer included: a refresh that
+    // outlasts the frame is cut short by drawing less, and shows in the console's stats
+    const uint32_t frame_start = DWT->CYCCNT;
+#endif
+#if PONG_ADAPTIVE_QUALITY
+    static const PongEngine_Detail_t level_detail[] = {
+        PONG_DETAIL_FULL, PONG_DETAIL_FULL, PONG_DETAIL_FEWER_SPARKS, PONG_DETAIL_MINIMAL
+    };
+    PongEngine_SetDetail(&pong_engine, level_detail[governor.level]);
+#endif
+
+    // Step 1: Wait until the draw buffer is free (immediate with LCD_DOUBLE_BUFFER, otherwise
+    // the previous frame must finish sending), then erase what the last frame drew
+    PROF_BEGIN(PROF_REFRESH);
+    LCD_Wait_Draw_Buffer();
+#if PONG_PALETTE_EFFECTS
+    palette_effects_frame();  // Waits for the refresh on the frames a colour changes
+#endif
+    PROF_END(PROF_REFRESH);
+    PROF_BEGIN(PROF_DRAW);
+    LCD_Clear_Background(0);
     
     // Step 2: Draw all game objects
-    PongEngine_Draw(&pong_engine);
+    PongEngine_DrawInterpolated(&pong_engine, alpha);
+    PROF_END(PROF_DRAW);
     
     // Step 3: Draw debug info (lives and score)
-    char info_str[32];
-    
+    // These are retained text widgets: they are only redrawn when the value changes
+    static LCD_Text_Widget lives_text = {.x = 10, .y = 10, .colour = 1, .font_size = 2, .label = "Lives: "};
+    static LCD_Text_Widget score_text = {.x = 130, .y = 10, .colour = 1, .font_size = 2, .label = "Score: "};
+
+    // The values shown; with work shed they catch up every 8th frame, but a widget
+    // something has cleared is still drawn again straight away
+    static int32_t lives_shown, score_shown, opponent_shown;
+#if PONG_ADAPTIVE_QUALITY
+    static uint8_t hud_frame = 0;
+    const uint8_t hud_update = (governor.level == 0) || ((++hud_frame & 7u) == 0);
+#else
+    const uint8_t hud_update = 1;
+#endif
+    if (hud_update) {
+        lives_shown = PongEngine_GetLives(&pong_engine);
+        score_shown = PongEngine_GetScore(&pong_engine);
+        opponent_shown = PongEngine_GetOpponentScore(&pong_engine);
+    }
+
+    PROF_BEGIN(PROF_HUD);
     // Display lives in top-left
-    sprintf(info_str, "Lives: %d", PongEngine_GetLives(&pong_engine));
-    LCD_printString(info_str, 10, 10, 1, 2);
+    LCD_Text_Widget_Set_Value(&lives_text, lives_shown);
     
     // Display score in top-right
-    sprintf(info_str, "Score: %d", PongEngine_GetScore(&pong_engine));
-    LCD_printString(info_str, 130, 10, 1, 2);
+    LCD_Text_Widget_Set_Value(&score_text, score_shown);
+
+#if PONG_AI_OPPONENT
+    // CPU opponent's score underneath
+    static LCD_Text_Widget cpu_text = {.x = 130, .y = 30, .colour = 1, .font_size = 2, .label = "CPU: "};
+    LCD_Text_Widget_Set_Value(&cpu_text, opponent_shown);
+#elif PONG_LINK_PLAY || PONG_TWO_STICKS
+    // Right player's score underneath
+    static LCD_Text_Widget p2_text = {.x = 130, .y = 30, .colour = 1, .font_size = 2, .label = "P2: "};
+    LCD_Text_Widget_Set_Value(&p2_text, opponent_shown);
+#else
+    (void)opponent_shown;
+#endif
+#if PONG_BUTTONS
+    if (game_state == GAME_STATE_PAUSED) {
+        LCD_printString_Aligned("Paused", ST7789V2_WIDTH / 2, 110, 1, 3, LCD_ALIGN_CENTRE);
+    }
+#endif
+#if PONG_ATTRACT_MODE
+    if (game_state == GAME_STATE_ATTRACT) {
+        LCD_printString_Aligned("Move stick to play", ST7789V2_WIDTH / 2, ST7789V2_HEIGHT - 24, 1, 2,
+                                LCD_ALIGN_CENTRE);
+    }
+#endif
+#if PONG_PROFILER
+    // Stage times as bars in the bottom-left corner, full width = one display frame
+    Profiler_Draw_Overlay(4, ST7789V2_HEIGHT - 4 - PROFILER_OVERLAY_HEIGHT, SystemCoreClock / render_fps);
+#endif
+#if PONG_JITTER_OVERLAY
+    // Frame interval p99 and max in ms with a decimal, e.g. "99% 16.9 max 33.4"
+    Jitter_Summary_t jitter;
+    Jitter_Summarize(&frame_interval, &jitter);
+    const uint32_t cycles_per_100us = SystemCoreClock / 10000u;
+    const uint32_t p99 = jitter.p99 / cycles_per_100us;
+    const uint32_t max = jitter.max / cycles_per_100us;
+    char jitter_line[24] = "99% ";
+    uint8_t len = 4;
+    len += Fmt_U16(jitter_line + len, (uint16_t)(p99 / 10u));
+    jitter_line[len++] = '.';
+    len += Fmt_U16(jitter_line + len, (uint16_t)(p99 % 10u));
+    memcpy(jitter_line + len, " max ", 5);
+    len += 5;
+    len += Fmt_U16(jitter_line + len, (uint16_t)(max / 10u));
+    jitter_line[len++] = '.';
+    len += Fmt_U16(jitter_line + len, (uint16_t)(max % 10u));
+    jitter_line[len] = '\0';
+    LCD_printString_Aligned(jitter_line, ST7789V2_WIDTH - 4, ST7789V2_HEIGHT - 12, 1, 1, LCD_ALIGN_RIGHT);
+#endif
+    PROF_END(PROF_HUD);
     
-    // Step 4: Refresh LCD to display this frame
-    LCD_Refresh(&cfg0);
+#if PONG_LATENCY_STATS
+    // Time this frame's paddle rows (where it was and where it is) reaching the panel
+    Paddle_t* paddle = &pong_engine.paddle;
+    int16_t watch_y0 = (paddle->prev_y < paddle->y) ? paddle->prev_y : paddle->y;
+    int16_t watch_y1 = ((paddle->prev_y > paddle->y) ? paddle->prev_y : paddle->y) + paddle->height - 1;
+    Latency_Mark_Frame(&latency);
+    LCD_Set_Row_Watch(watch_y0, watch_y1, latency_rows_shown);
+#endif
+
+#if PONG_FRAME_DUMP
+    if (frame_dump_wanted) {
+        frame_dump_wanted = 0;
+        frame_dump_capture();
+    }
+#endif
+
+    // Step 4: Start sending this frame to the LCD in the background (DMA interrupt driven),
+    // so input and game logic for the next frame can run while it goes out
+    PROF_BEGIN(PROF_REFRESH);
+#if PONG_TRACE
+    Trace_Event(TRACE_PORT_REFRESH, 0);  // Its end is traced by the DMA interrupt
+#endif
+#if PONG_RTOS
+    LCD_RefreshAsync(&cfg0, rtos_refresh_done);  // The render task sleeps until it has been sent
+#else
+    LCD_Swap(&cfg0);
+#endif
+    PROF_END(PROF_REFRESH);
+#if PONG_ADAPTIVE_QUALITY
+    Governor_Frame(&governor, DWT->CYCCNT - frame_start);
+#endif
+#if PONG_CONSOLE
+    frame_stats_add(DWT->CYCCNT - frame_start);
+#endif
+#if PONG_TRACE
+    Trace_Event(TRACE_PORT_FRAME, 1);
+#endif
+#if PONG_JITTER_STATS
+    Jitter_Add(&render_cost, DWT->CYCCNT - frame_start);
+#if !PONG_CONSOLE
+    static uint16_t frames_since_report = 0;
+    if (++frames_since_report >= JITTER_WINDOW) {
+        frames_since_report = 0;
+        jitter_report();
+    }
+#endif
+#endif
 }
 
 // ===== Interrupt Callback =====
-// Note: Pong game only uses joystick input which is handled synchronously in the main loop.
-// If button input is needed in the future, an interrupt handler can be added here.
+// The joystick is read in the main loop; only the buttons (PONG_BUTTONS) use the EXTI lines.
+#if PONG_BUTTONS
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+    Buttons_EXTI_Callback(&buttons, GPIO_Pin);
+}
+#endif
+
+/**
+ * @brief Millisecond delay that sleeps (overrides the weak HAL_Delay() in the HAL)
+ *
+ * The HAL version spins on HAL_GetTick() at full power. This one sleeps (WFI) between
+ * SysTick interrupts, so the splash and game over screens cost next to nothing. Timing
+ * is the HAL's: one tick is added, so it waits at least Delay ms.
+ */
+void HAL_Delay(uint32_t Delay) {
+    uint32_t start = HAL_GetTick();
+    uint32_t wait = Delay;
+    if (wait < HAL_MAX_DELAY) {
+        wait += (uint32_t)uwTickFreq;
+    }
+    while ((HAL_GetTick() - start) < wait) {
+        __WFI();
+        display_check();
+    }
+}
+
+/**
+ * @brief Timer update callback (called by HAL_TIM_IRQHandler)
+ *
+ * TIM6 is the frame clock: each update interrupt marks the start of a new frame.
+ */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+    if (htim == frame_timer.htim) {
+        FrameTimer_IRQHandler(&frame_timer);
+#if PONG_LATENCY_STATS
+        Latency_Mark_Tick(&latency);
+#endif
+#if PONG_RTOS
+        osThreadFlagsSet(game_thread, RTOS_FLAG_STEP);
+#endif
+    }
+}
 
 
 
@@ -405,6 +3234,9 @@ void Error_Handler(void)
   /* USER CODE BEGIN Error_Handler_Debug */
   /* User can add his own implementation to report the HAL error return state */
   __disable_irq();
+#if PONG_STATUS_LED
+  StatusLed_Set(STATUSLED_FAULT, LED_FAULT_ERROR_HANDLER);  // Blinks on by itself from here
+#endif
   while (1)
   {
   }
@@ -22,6 +22,36 @@
 #include "stm32l4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "LCD.h"
+#include "Joystick.h"
+#include "BuzzerSeq.h"
+#include "UartLog.h"
+#include "PongEngine.h"
+#include "TimeBase.h"
+#include "Buttons.h"
+#if PONG_LINK_PLAY
+#include "LinkUart.h"
+#endif
+#if PONG_CONSOLE
+#include "Console.h"
+#endif
+#if PONG_TRACE
+#include "Trace.h"
+#endif
+#if PONG_EXT_FLASH
+#include "ExtFlash.h"
+#endif
+#if PONG_AUDIO_MIXER
+#include "Mixer.h"
+#endif
+#if PONG_STATUS_LED
+#include "StatusLed.h"
+#endif
+#if PONG_RTOS
+#include "FreeRTOS.h"
+#include "task.h"
+extern void xPortSysTickHandler(void);  // FreeRTOS port.c, not in a kernel header
+#endif
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -58,6 +88,27 @@
 extern TIM_HandleTypeDef htim6;
 extern TIM_HandleTypeDef htim7;
 /* USER CODE BEGIN EV */
+extern Joystick_cfg_t joystick_cfg;
+#if PONG_TWO_STICKS
+extern Joystick_Scan_t joystick_scan;
+#endif
+extern BuzzerSeq_cfg_t buzzer_seq;
+extern UartLog_cfg_t uart_log;
+#if PONG_BUTTONS
+extern Buttons_cfg_t buttons;
+#endif
+#if PONG_LINK_PLAY
+extern LinkUart_cfg_t link_uart;
+#endif
+#if PONG_CONSOLE
+extern Console_cfg_t console;
+#endif
+#if PONG_EXT_FLASH
+extern ExtFlash_cfg_t ext_flash;
+#endif
+#if PONG_AUDIO_MIXER
+extern Mixer_cfg_t mixer;
+#endif
 
 /* USER CODE END EV */
 
@@ -85,6 +136,9 @@ void NMI_Handler(void)
 void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
+#if PONG_STATUS_LED
+  StatusLed_Set(STATUSLED_FAULT, LED_FAULT_HARD_FAULT);  // TIM8 and its DMA blink it from here
+#endif
 
   /* USER CODE END HardFault_IRQn 0 */
   while (1)
@@ -139,6 +193,8 @@ void UsageFault_Handler(void)
   }
 }
 
+#if !PONG_RTOS
+/* With PONG_RTOS, SVC and PendSV are the FreeRTOS port's (FreeRTOSConfig.h) */
 /**
   * @brief This function handles System service call via SWI instruction.
   */
@@ -151,6 +207,7 @@ void SVC_Handler(void)
 
   /* USER CODE END SVCall_IRQn 1 */
 }
+#endif
 
 /**
   * @brief This function handles Debug monitor.
@@ -165,6 +222,7 @@ void DebugMon_Handler(void)
   /* USER CODE END DebugMonitor_IRQn 1 */
 }
 
+#if !PONG_RTOS
 /**
   * @brief This function handles Pendable request for system service.
   */
@@ -177,6 +235,7 @@ void PendSV_Handler(void)
 
   /* USER CODE END PendSV_IRQn 1 */
 }
+#endif
 
 /**
   * @brief This function handles System tick timer.
@@ -188,6 +247,12 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
+#if PONG_RTOS
+  // The kernel tick shares SysTick with the HAL tick, and only once osKernelStart() has run
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+    xPortSysTickHandler();
+  }
+#endif
 
   /* USER CODE END SysTick_IRQn 1 */
 }
@@ -263,7 +328,7 @@ void EXTI9_5_IRQHandler(void)
 void EXTI15_10_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI15_10_IRQn 0 */
-
+  LCD_TE_IRQHandler();
   /* USER CODE END EXTI15_10_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(BTN5_Pin);
   HAL_GPIO_EXTI_IRQHandler(B1_Pin);
@@ -292,6 +357,7 @@ void TIM6_DAC_IRQHandler(void)
 void TIM7_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM7_IRQn 0 */
+  BuzzerSeq_IRQHandler(&buzzer_seq);
 
   /* USER CODE END TIM7_IRQn 0 */
   HAL_TIM_IRQHandler(&htim7);
@@ -302,4 +368,134 @@ void TIM7_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles DMA1 channel5 global interrupt (LCD SPI2 TX).
+  */
+void DMA1_Channel5_IRQHandler(void)
+{
+#if PONG_TRACE
+  // The refresh has ended once the transfer that finished here left nothing to start
+  const uint8_t refreshing = LCD_Refresh_Busy();
+  Trace_Event(TRACE_PORT_DMA, 0);
+  LCD_DMA_IRQHandler();
+  if (refreshing && !LCD_Refresh_Busy()) {
+    Trace_Event(TRACE_PORT_REFRESH, 1);
+  }
+#else
+  LCD_DMA_IRQHandler();
+#endif
+}
+
+#if LCD_MAX_DISPLAYS > 1
+/**
+  * @brief This function handles DMA1 channel3 global interrupt (second LCD on SPI1 TX).
+  */
+void DMA1_Channel3_IRQHandler(void)
+{
+  LCD_DMA_IRQHandler();
+}
+
+/**
+  * @brief This function handles DMA2 channel2 global interrupt (second LCD on SPI3 TX).
+  */
+void DMA2_Channel2_IRQHandler(void)
+{
+  LCD_DMA_IRQHandler();
+}
+#endif
+
+/**
+  * @brief This function handles DMA1 channel1 global interrupt (joystick ADC1 sample timestamps).
+  */
+void DMA1_Channel1_IRQHandler(void)
+{
+#if PONG_TWO_STICKS
+  Joystick_Scan_DMA_IRQHandler(&joystick_scan);
+#else
+  Joystick_DMA_IRQHandler(&joystick_cfg);
+#endif
+}
+
+#if PONG_AUDIO_MIXER
+/**
+  * @brief This function handles DMA1 channel2 global interrupt (buzzer mixer, TIM2_UP samples).
+  */
+void DMA1_Channel2_IRQHandler(void)
+{
+  Mixer_DMA_IRQHandler(&mixer);
+}
+#endif
+
+/**
+  * @brief This function handles ADC1 and ADC2 global interrupt (joystick analog watchdog wake-up).
+  */
+void ADC1_2_IRQHandler(void)
+{
+  Joystick_ADC_IRQHandler(&joystick_cfg);
+}
+
+/**
+  * @brief This function handles DMA1 channel7 global interrupt (USART2 TX log).
+  */
+void DMA1_Channel7_IRQHandler(void)
+{
+  UartLog_DMA_IRQHandler(&uart_log);
+}
+
+/**
+  * @brief This function handles the flash global interrupt (FlashStore erase/program done).
+  */
+void FLASH_IRQHandler(void)
+{
+  HAL_FLASH_IRQHandler();
+}
+
+/**
+  * @brief This function handles TIM5 global interrupt (time_us() counter wrap).
+  */
+void TIM5_IRQHandler(void)
+{
+  TimeBase_IRQHandler();
+}
+
+#if PONG_BUTTONS
+/**
+  * @brief This function handles TIM1 update and TIM16 global interrupt (button debounce done).
+  */
+void TIM1_UP_TIM16_IRQHandler(void)
+{
+  Buttons_Timer_IRQHandler(&buttons);
+}
+#endif
+
+#if PONG_LINK_PLAY
+/**
+  * @brief This function handles USART3 global interrupt (link play TX).
+  */
+void USART3_IRQHandler(void)
+{
+  LinkUart_IRQHandler(&link_uart);
+}
+#endif
+
+#if PONG_CONSOLE
+/**
+  * @brief This function handles USART2 global interrupt (console RX line idle).
+  */
+void USART2_IRQHandler(void)
+{
+  Console_IRQHandler(&console);
+}
+#endif
+
+#if PONG_EXT_FLASH
+/**
+  * @brief This function handles DMA2 channel3 global interrupt (external flash SPI1 RX done).
+  */
+void DMA2_Channel3_IRQHandler(void)
+{
+  ExtFlash_DMA_IRQHandler(&ext_flash);
+}
+#endif
+
 /* USER CODE END 1 */
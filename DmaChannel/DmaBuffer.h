@@ -0,0 +1,77 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file DmaBuffer.h
+ * @brief Where the buffers DMA channels read and write go, and the checks they pass
+ *
+ * The STM32's DMA drops the low address bits to fit the memory transfer size,
+ * so a buffer of 16-bit samples at an odd address is not moved half a sample
+ * out but read from the halfword before: wrong data with no error raised.
+ * DMA_ALIGNED starts a buffer (or a struct member) on a DMA_BUFFER_ALIGN
+ * boundary, enough for any of the byte, halfword and word transfers.
+ * The Cortex-M4 has no data cache, so there are no cache lines to keep
+ * buffers apart and nothing to clean or invalidate around a transfer;
+ * DMA_BUFFER_ALIGN only needs to be raised on a part that has one.
+ *
+ * ALIGNED_DMA_BUFFER also places a static buffer in SRAM1 (the .sram1 section
+ * of the linker script). SRAM1 and SRAM2 are separate slaves on the bus
+ * matrix, so DMA streaming from SRAM1 does not hold up the CPU drawing into
+ * the framebuffer in SRAM2. The section is NOLOAD: the buffer is not zeroed at
+ * start-up, so it must be written before a transfer reads it. Buffers that
+ * start out relying on being zero belong in .bss with DMA_ALIGNED instead.
+ *
+ * DMA_BUFFER_CHECK() fails the build if a buffer breaks what its channel
+ * needs: a start aligned to its item size, a whole number of items, and no
+ * more of them than one run of the 16-bit CNDTR counter.
+ *
+ * Example usage:
+ * @code
+ * static uint16_t steps[6] ALIGNED_DMA_BUFFER;   // in SRAM1, written before the DMA starts
+ * DMA_BUFFER_CHECK(steps, 2);
+ *
+ * typedef struct {
+ *     uint16_t samples[64] DMA_ALIGNED;          // a member: aligned where the struct is placed
+ * } Thing_t;
+ * DMA_BUFFER_CHECK(((Thing_t*)0)->samples, 2);
+ * @endcode
+ */
+
+#ifndef DMA_BUFFER_ALIGN
+#define DMA_BUFFER_ALIGN 4      ///< Alignment of DMA buffers: the widest (word) transfer
+#endif
+
+#ifndef DMA_BUFFER_SECTION
+#define DMA_BUFFER_SECTION ".sram1"   ///< Section ALIGNED_DMA_BUFFER places buffers in
+#endif
+
+#define DMA_BUFFER_MAX_ITEMS 65535u   ///< Most items one run of a channel (CNDTR) moves
+
+/// Start on a DMA_BUFFER_ALIGN boundary (a variable or a struct member)
+#define DMA_ALIGNED __attribute__((aligned(DMA_BUFFER_ALIGN)))
+
+/// Aligned, and placed in DMA_BUFFER_SECTION on the target (a static buffer only)
+#if defined(__arm__)
+#define ALIGNED_DMA_BUFFER __attribute__((section(DMA_BUFFER_SECTION), aligned(DMA_BUFFER_ALIGN)))
+#else
+#define ALIGNED_DMA_BUFFER DMA_ALIGNED
+#endif
+
+/**
+ * @brief Fail the build unless a buffer suits a channel moving item_bytes at a time
+ *
+ * @param buffer The buffer (an array, or a struct member reached through a null pointer)
+ * @param item_bytes Memory transfer size of the channel: 1, 2 or 4
+ */
+#define DMA_BUFFER_CHECK(buffer, item_bytes) \
+    _Static_assert(__alignof__(buffer) >= (item_bytes), #buffer " is not aligned to its DMA items"); \
+    _Static_assert(sizeof(buffer) % (item_bytes) == 0, #buffer " is not a whole number of DMA items"); \
+    _Static_assert(sizeof(buffer) / (item_bytes) <= DMA_BUFFER_MAX_ITEMS, #buffer " is longer than one DMA run")
+
+#ifdef __cplusplus
+}
+#endif
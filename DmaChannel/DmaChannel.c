@@ -0,0 +1,113 @@
+#include "DmaChannel.h"
+#include <stdio.h>
+
+/**
+ * @file DmaChannel.c
+ * @brief Implementation of the DMA channel ownership table
+ *
+ * Slots 0-6 are DMA1 channels 1-7, slots 7-13 DMA2's. Claims are made from
+ * thread context during set-up, so the table needs no locking.
+ */
+
+#define DMACHANNEL_MAX_REFUSED 4   ///< Refused claims remembered for the report
+
+typedef struct {
+    const void* owner;
+    const char* name;
+    uint8_t request;
+} Claim_t;
+
+static Claim_t claims[DMACHANNEL_COUNT];
+static Claim_t refused[DMACHANNEL_MAX_REFUSED];
+static uint8_t refused_slot[DMACHANNEL_MAX_REFUSED];
+static uint8_t refused_count = 0;
+
+static uint32_t slot_of(const DMA_Channel_TypeDef* channel)
+{
+    return ((DmaChannel_Controller(channel) == DMA2) ? 7u : 0u) + DmaChannel_Index(channel);
+}
+
+static void print_slot(uint32_t slot, const Claim_t* claim)
+{
+    printf("  DMA%u_Channel%u  request %u  %s\n", (unsigned)(slot / 7u + 1u), (unsigned)(slot % 7u + 1u),
+           (unsigned)claim->request, claim->name);
+}
+
+IRQn_Type DmaChannel_IRQn(const DMA_Channel_TypeDef* channel)
+{
+    static const IRQn_Type irqs[DMACHANNEL_COUNT] = {
+        DMA1_Channel1_IRQn, DMA1_Channel2_IRQn, DMA1_Channel3_IRQn, DMA1_Channel4_IRQn,
+        DMA1_Channel5_IRQn, DMA1_Channel6_IRQn, DMA1_Channel7_IRQn,
+        DMA2_Channel1_IRQn, DMA2_Channel2_IRQn, DMA2_Channel3_IRQn, DMA2_Channel4_IRQn,
+        DMA2_Channel5_IRQn, DMA2_Channel6_IRQn, DMA2_Channel7_IRQn
+    };
+    return irqs[slot_of(channel)];
+}
+
+DmaChannel_Status_t DmaChannel_Claim(DMA_Channel_TypeDef* channel, uint8_t request, const void* owner,
+                                     const char* name)
+{
+    const uint32_t slot = slot_of(channel);
+    Claim_t* claim = &claims[slot];
+    if (claim->owner != NULL && claim->owner != owner) {
+        if (refused_count < DMACHANNEL_MAX_REFUSED) {
+            refused[refused_count] = (Claim_t){.owner = owner, .name = name, .request = request};
+            refused_slot[refused_count] = (uint8_t)slot;
+        }
+        if (refused_count < UINT8_MAX) {
+            refused_count++;
+        }
+        return DMACHANNEL_BUSY;
+    }
+    claim->owner = owner;
+    claim->name = name;
+    claim->request = request;
+
+    const uint8_t on_dma2 = (DmaChannel_Controller(channel) == DMA2);
+    RCC->AHB1ENR |= on_dma2 ? RCC_AHB1ENR_DMA2EN : RCC_AHB1ENR_DMA1EN;
+    (void)RCC->AHB1ENR;   // The clock has to be on before the controller's registers are written
+    DMA_Request_TypeDef* cselr = on_dma2 ? DMA2_CSELR : DMA1_CSELR;
+    const uint32_t shift = DmaChannel_Flag_Shift(channel);
+    cselr->CSELR = (cselr->CSELR & ~(0xFu << shift)) | ((uint32_t)(request & 0xFu) << shift);
+    return DMACHANNEL_OK;
+}
+
+void DmaChannel_Release(DMA_Channel_TypeDef* channel, const void* owner)
+{
+    Claim_t* claim = &claims[slot_of(channel)];
+    if (claim->owner != owner) {
+        return;
+    }
+    channel->CCR = 0;
+    DmaChannel_Clear_Flags(channel);
+    claim->owner = NULL;
+    claim->name = NULL;
+}
+
+const char* DmaChannel_Owner(const DMA_Channel_TypeDef* channel)
+{
+    const Claim_t* claim = &claims[slot_of(channel)];
+    return (claim->owner != NULL) ? claim->name : NULL;
+}
+
+uint8_t DmaChannel_Conflicts(void)
+{
+    return refused_count;
+}
+
+void DmaChannel_Report(void)
+{
+    printf("DMA channels:\n");
+    for (uint32_t slot = 0; slot < DMACHANNEL_COUNT; slot++) {
+        if (claims[slot].owner != NULL) {
+            print_slot(slot, &claims[slot]);
+        }
+    }
+    if (refused_count == 0) {
+        return;
+    }
+    printf("Refused (channel taken), %u in all:\n", (unsigned)refused_count);
+    for (uint8_t i = 0; i < refused_count && i < DMACHANNEL_MAX_REFUSED; i++) {
+        print_slot(refused_slot[i], &refused[i]);
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file DmaChannel.h
+ * @brief Who owns each DMA channel, and the per-channel flag and request helpers
+ *
+ * The game runs a DMA channel for each of the LCD, the joystick's ADC scan,
+ * the UART log, the console and link receivers, the buzzer and the LED
+ * patterns, most of them on DMA1. They only coexist if each touches nothing
+ * but its own channel: its 4 bits of ISR/IFCR (GIF, TCIF, HTIF, TEIF) and of
+ * CSELR (the request routed to it). The helpers here work those out from the
+ * channel pointer, so no module clears another's flags or request.
+ *
+ * DmaChannel_Claim() records the owner of a channel as it routes the request,
+ * so two modules configured onto the same channel are caught at start-up
+ * rather than as a transfer that ends in the wrong interrupt. Claiming it again
+ * for the same owner (a module re-arming its transfer) just reroutes it. A
+ * refused claim is remembered and listed by DmaChannel_Report().
+ *
+ * Example usage:
+ * @code
+ * if (DmaChannel_Claim(DMA1_Channel7, 2, &uart_log, "UartLog") != DMACHANNEL_OK) {
+ *     return;   // Taken by something else
+ * }
+ * DmaChannel_Clear_Flags(DMA1_Channel7);
+ *
+ * // In its interrupt:
+ * if (DmaChannel_Controller(channel)->ISR & (DMA_ISR_TCIF1 << DmaChannel_Flag_Shift(channel))) ...
+ *
+ * // At start-up, once everything is set up:
+ * if (DmaChannel_Conflicts()) {
+ *     DmaChannel_Report();
+ * }
+ * @endcode
+ */
+
+#define DMACHANNEL_COUNT 14   ///< 7 channels on each of DMA1 and DMA2
+
+/**
+ * @enum DmaChannel_Status_t
+ * @brief Result of DmaChannel_Claim()
+ */
+typedef enum {
+    DMACHANNEL_OK = 0,      ///< Claimed (or already ours); clock on, request routed
+    DMACHANNEL_BUSY         ///< Owned by someone else: nothing changed
+} DmaChannel_Status_t;
+
+/**
+ * @brief DMA controller of a channel
+ */
+static inline DMA_TypeDef* DmaChannel_Controller(const DMA_Channel_TypeDef* channel)
+{
+    return ((uint32_t)channel >= DMA2_Channel1_BASE) ? DMA2 : DMA1;
+}
+
+/**
+ * @brief Channel number on its controller, 0-6 (channel 1-7)
+ */
+static inline uint32_t DmaChannel_Index(const DMA_Channel_TypeDef* channel)
+{
+    const uint32_t first = ((uint32_t)channel >= DMA2_Channel1_BASE) ? DMA2_Channel1_BASE : DMA1_Channel1_BASE;
+    return ((uint32_t)channel - first) / (DMA1_Channel2_BASE - DMA1_Channel1_BASE);
+}
+
+/**
+ * @brief Shift of the channel's 4 bits in ISR/IFCR and CSELR (DMA_ISR_TCIF1 << shift is its TCIF)
+ */
+static inline uint32_t DmaChannel_Flag_Shift(const DMA_Channel_TypeDef* channel)
+{
+    return 4u * DmaChannel_Index(channel);
+}
+
+/**
+ * @brief Clear all four of the channel's interrupt flags, and no other channel's
+ */
+static inline void DmaChannel_Clear_Flags(const DMA_Channel_TypeDef* channel)
+{
+    DmaChannel_Controller(channel)->IFCR = 0xFu << DmaChannel_Flag_Shift(channel);
+}
+
+/**
+ * @brief The channel's interrupt
+ */
+IRQn_Type DmaChannel_IRQn(const DMA_Channel_TypeDef* channel);
+
+/**
+ * @brief Take a channel: turn its controller's clock on and route the request to it
+ *
+ * @param channel DMA channel
+ * @param request Request number for CSELR (RM0351 table 41), e.g. 2 for USART2_TX on DMA1_Channel7
+ * @param owner Any pointer unique to the user, normally its cfg
+ * @param name Shown by DmaChannel_Report()
+ * @return DMACHANNEL_OK, or DMACHANNEL_BUSY if another owner has it
+ */
+DmaChannel_Status_t DmaChannel_Claim(DMA_Channel_TypeDef* channel, uint8_t request, const void* owner,
+                                     const char* name);
+
+/**
+ * @brief Give a channel back (stops it too). Does nothing unless owner has it.
+ */
+void DmaChannel_Release(DMA_Channel_TypeDef* channel, const void* owner);
+
+/**
+ * @brief Name of the channel's owner, NULL if it is free
+ */
+const char* DmaChannel_Owner(const DMA_Channel_TypeDef* channel);
+
+/**
+ * @brief Claims refused since start-up
+ */
+uint8_t DmaChannel_Conflicts(void);
+
+/**
+ * @brief Print each claimed channel with its owner and request, and the refused claims (printf)
+ */
+void DmaChannel_Report(void);
+
+#ifdef __cplusplus
+}
+#endif
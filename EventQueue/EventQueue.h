@@ -0,0 +1,152 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file EventQueue.h
+ * @brief Lock-free single-producer, single-consumer event ring (header only)
+ *
+ * Passes small typed events from one context to another, typically from an
+ * interrupt (DMA done, ADC sample ready, timer step) to the main loop, without
+ * disabling interrupts. Only EventQueue_Push() moves head and only
+ * EventQueue_Pop() moves tail, each from a single context, as in the BuzzerSeq
+ * and UartLog rings. The indices run freely and wrap at 2^32, so all
+ * EVENTQUEUE_LEN slots can be used.
+ *
+ * Memory order: the producer writes the slot, then __DMB(), then publishes it
+ * by moving head. The consumer reads head, then __DMB() before reading the
+ * slot, and __DMB() again before handing the slot back by moving tail. On a
+ * single Cortex-M4 core the barriers mostly keep the compiler from reordering
+ * the slot and index accesses; they also order them against DMA.
+ *
+ * What an event means is up to the application: an enum of types, and a
+ * 16-bit and a 32-bit payload whose use depends on the type.
+ *
+ * Example usage:
+ * @code
+ * enum { EVENT_SAMPLE = 1, EVENT_FRAME_SENT };
+ * EventQueue_t events;
+ * EventQueue_Init(&events);
+ *
+ * // Interrupt (the only producer):
+ * EventQueue_Push(&events, EVENT_SAMPLE, channel, DWT->CYCCNT);
+ *
+ * // Main loop (the only consumer):
+ * Event_t event;
+ * while (EventQueue_Pop(&events, &event)) {
+ *     if (event.type == EVENT_SAMPLE) handle_sample(event.arg, event.data);
+ * }
+ * @endcode
+ */
+
+#ifndef EVENTQUEUE_LEN
+#define EVENTQUEUE_LEN 16  ///< Events a queue holds (power of 2)
+#endif
+#define EVENTQUEUE_MASK (EVENTQUEUE_LEN - 1u)
+
+#if (EVENTQUEUE_LEN & (EVENTQUEUE_LEN - 1)) != 0
+#error "EVENTQUEUE_LEN must be a power of 2"
+#endif
+
+/**
+ * @struct Event_t
+ * @brief One event: an application-defined type and its payload
+ */
+typedef struct {
+    uint16_t type;      ///< Application-defined (0 is free for "none")
+    uint16_t arg;       ///< Small payload, e.g. a channel, a row or a score
+    uint32_t data;      ///< Large payload, e.g. a DWT timestamp or a sample
+} Event_t;
+
+/**
+ * @struct EventQueue_t
+ * @brief A ring of events between one producer and one consumer
+ */
+typedef struct {
+    Event_t slots[EVENTQUEUE_LEN];  ///< Internal: the ring
+    volatile uint32_t head;         ///< Internal: events pushed (free-running), producer only
+    volatile uint32_t tail;         ///< Internal: events popped (free-running), consumer only
+    uint32_t dropped;               ///< Events pushed while the queue was full (producer only)
+} EventQueue_t;
+
+/**
+ * @brief Empty a queue
+ *
+ * @param queue Pointer to queue; call before either side uses it
+ */
+static inline void EventQueue_Init(EventQueue_t* queue)
+{
+    queue->head = 0;
+    queue->tail = 0;
+    queue->dropped = 0;
+}
+
+/**
+ * @brief Add an event (producer side)
+ *
+ * @param queue Pointer to queue
+ * @param type Event type
+ * @param arg Small payload
+ * @param data Large payload
+ * @return 1 if queued, 0 if the queue was full (the event is dropped and counted)
+ */
+static inline uint8_t EventQueue_Push(EventQueue_t* queue, uint16_t type, uint16_t arg, uint32_t data)
+{
+    uint32_t head = queue->head;
+    if (head - queue->tail >= EVENTQUEUE_LEN) {
+        queue->dropped++;
+        return 0;
+    }
+
+    Event_t* event = &queue->slots[head & EVENTQUEUE_MASK];
+    event->type = type;
+    event->arg = arg;
+    event->data = data;
+
+    // The event must be in memory before the consumer can see the new head
+    __DMB();
+    queue->head = head + 1;
+    return 1;
+}
+
+/**
+ * @brief Take the oldest event (consumer side)
+ *
+ * @param queue Pointer to queue
+ * @param event Filled in with the event
+ * @return 1 if there was one, 0 if the queue is empty (event unchanged)
+ */
+static inline uint8_t EventQueue_Pop(EventQueue_t* queue, Event_t* event)
+{
+    uint32_t tail = queue->tail;
+    if (queue->head == tail) {
+        return 0;
+    }
+
+    // Read the slot only after seeing the head that published it, and finish reading it
+    // before the producer can see it is free
+    __DMB();
+    *event = queue->slots[tail & EVENTQUEUE_MASK];
+    __DMB();
+    queue->tail = tail + 1;
+    return 1;
+}
+
+/**
+ * @brief Get the number of events waiting (either side)
+ *
+ * @param queue Pointer to queue
+ * @return Events pushed and not yet popped
+ */
+static inline uint32_t EventQueue_Count(const EventQueue_t* queue)
+{
+    return queue->head - queue->tail;
+}
+
+#ifdef __cplusplus
+}
+#endif
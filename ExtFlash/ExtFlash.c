@@ -0,0 +1,286 @@
+#include "ExtFlash.h"
+#include "DmaChannel.h"
+
+/**
+ * @file ExtFlash.c
+ * @brief Implementation of the external SPI NOR flash driver
+ *
+ * Commands, addresses and status reads are exchanged a byte at a time by the
+ * CPU; only read data moves by DMA. The SPI is in 8-bit mode with FRXTH set,
+ * so RXNE (and the RX DMA request) comes for every byte received. Both DMA
+ * channels are armed before TXDMAEN, as RM0351 asks, so no request is missed.
+ */
+
+#define CMD_WRITE_ENABLE 0x06u
+#define CMD_READ_STATUS  0x05u
+#define CMD_PAGE_PROGRAM 0x02u
+#define CMD_FAST_READ    0x0Bu
+#define CMD_SECTOR_ERASE 0x20u
+#define CMD_JEDEC_ID     0x9Fu
+#define CMD_WAKE_UP      0xABu
+#define STATUS_BUSY      0x01u
+
+#define EXTFLASH_SCK_PIN  5u
+#define EXTFLASH_MISO_PIN 6u
+#define EXTFLASH_MOSI_PIN 7u
+#define EXTFLASH_AF 5u
+
+// Clocked out while the data comes in: MOSI is don't-care during a read
+static const uint8_t filler = 0xFF;
+
+static void cs_low(ExtFlash_cfg_t* cfg)
+{
+    cfg->cs_port->BSRR = (uint32_t)cfg->cs_pin << 16;
+}
+
+static void cs_high(ExtFlash_cfg_t* cfg)
+{
+    // The last byte has to be out before the flash is deselected
+    while (cfg->spi->SR & SPI_SR_BSY) {
+    }
+    cfg->cs_port->BSRR = cfg->cs_pin;
+}
+
+// Sends a byte and returns the one received with it
+static uint8_t exchange(SPI_TypeDef* spi, uint8_t byte)
+{
+    while (!(spi->SR & SPI_SR_TXE)) {
+    }
+    *(volatile uint8_t*)&spi->DR = byte;
+    while (!(spi->SR & SPI_SR_RXNE)) {
+    }
+    return *(volatile uint8_t*)&spi->DR;
+}
+
+static void send_command(ExtFlash_cfg_t* cfg, uint8_t command, uint32_t address, uint8_t with_address)
+{
+    exchange(cfg->spi, command);
+    if (with_address) {
+        exchange(cfg->spi, (uint8_t)(address >> 16));
+        exchange(cfg->spi, (uint8_t)(address >> 8));
+        exchange(cfg->spi, (uint8_t)address);
+    }
+}
+
+static void write_enable(ExtFlash_cfg_t* cfg)
+{
+    cs_low(cfg);
+    exchange(cfg->spi, CMD_WRITE_ENABLE);
+    cs_high(cfg);
+}
+
+static void wait_ready(ExtFlash_cfg_t* cfg)
+{
+    cs_low(cfg);
+    exchange(cfg->spi, CMD_READ_STATUS);
+    while (exchange(cfg->spi, 0xFF) & STATUS_BUSY) {
+    }
+    cs_high(cfg);
+}
+
+// Ends the read in flight: both channels and the SPI's DMA requests off, the flash deselected
+static void end_read(ExtFlash_cfg_t* cfg, uint8_t ok)
+{
+    cfg->rx_channel->CCR = 0;
+    cfg->tx_channel->CCR = 0;
+    DmaChannel_Clear_Flags(cfg->rx_channel);
+    DmaChannel_Clear_Flags(cfg->tx_channel);
+    CLEAR_BIT(cfg->spi->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+    cs_high(cfg);
+    if (ok) {
+        cfg->bytes_read += cfg->length;
+    } else {
+        cfg->errors++;
+    }
+
+    ExtFlash_Callback_t done = cfg->done;
+    cfg->busy = 0;
+    if (done != NULL) {
+        done(cfg->context, ok);
+    }
+}
+
+uint8_t ExtFlash_Init(ExtFlash_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return 1;
+    }
+    if (DmaChannel_Claim(cfg->rx_channel, cfg->dma_request, cfg, "ExtFlash RX") != DMACHANNEL_OK ||
+        DmaChannel_Claim(cfg->tx_channel, cfg->dma_request, cfg, "ExtFlash TX") != DMACHANNEL_OK) {
+        return 0;
+    }
+    cfg->busy = 0;
+    cfg->bytes_read = 0;
+    cfg->errors = 0;
+
+    RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
+    RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;
+    (void)RCC->APB2ENR;  // the clock has to be on before the registers are written
+
+    // Chip select high (a plain output) before the pins start driving the bus
+    cfg->cs_port->BSRR = cfg->cs_pin;
+    const uint32_t cs = (uint32_t)__builtin_ctz(cfg->cs_pin);
+    cfg->cs_port->MODER = (cfg->cs_port->MODER & ~(3u << (2u * cs))) | (1u << (2u * cs));
+
+    // SCK, MISO and MOSI alternate function 5, very high speed
+    const uint32_t pins = (1u << EXTFLASH_SCK_PIN) | (1u << EXTFLASH_MISO_PIN) | (1u << EXTFLASH_MOSI_PIN);
+    for (uint32_t pin = 0; pin < 8u; pin++) {
+        if (pins & (1u << pin)) {
+            GPIOA->MODER = (GPIOA->MODER & ~(3u << (2u * pin))) | (2u << (2u * pin));
+            GPIOA->OSPEEDR |= 3u << (2u * pin);
+            GPIOA->AFR[0] = (GPIOA->AFR[0] & ~(0xFu << (4u * pin))) | (EXTFLASH_AF << (4u * pin));
+        }
+    }
+
+    // Master, mode 0, software chip select; 8-bit frames, RXNE at every byte
+    cfg->spi->CR1 = 0;
+    cfg->spi->CR2 = (7u << SPI_CR2_DS_Pos) | SPI_CR2_FRXTH;
+    cfg->spi->CR1 = SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | ((cfg->baud_div & 7u) << SPI_CR1_BR_Pos);
+    cfg->spi->CR1 |= SPI_CR1_SPE;
+
+    // A flash left in deep power-down only answers the wake-up command
+    cs_low(cfg);
+    exchange(cfg->spi, CMD_WAKE_UP);
+    cs_high(cfg);
+    HAL_Delay(1);  // tRES1 is 3us
+
+    cs_low(cfg);
+    exchange(cfg->spi, CMD_JEDEC_ID);
+    uint32_t id = 0;
+    for (int i = 0; i < 3; i++) {
+        id = (id << 8) | exchange(cfg->spi, 0xFF);
+    }
+    cs_high(cfg);
+    cfg->jedec_id = id;
+    if (id == 0 || id == 0xFFFFFFu) {
+        return 0;  // MISO floating or held: nothing there
+    }
+
+    // Below the LCD's DMA (priority 1), like the other background transfers
+    NVIC_SetPriority(DmaChannel_IRQn(cfg->rx_channel), 3);
+    NVIC_EnableIRQ(DmaChannel_IRQn(cfg->rx_channel));
+
+    cfg->setup_done = 1;
+    return 1;
+}
+
+uint8_t ExtFlash_Read_Start(ExtFlash_cfg_t* cfg, uint32_t address, void* buffer, uint16_t length,
+                            ExtFlash_Callback_t done, void* context)
+{
+    if (!cfg->setup_done || cfg->busy || length == 0) {
+        return 0;
+    }
+    cfg->busy = 1;
+    cfg->done = done;
+    cfg->context = context;
+    cfg->length = length;
+
+    cs_low(cfg);
+    send_command(cfg, CMD_FAST_READ, address, 1);
+    exchange(cfg->spi, 0xFF);  // Dummy byte
+
+    // RX: peripheral to memory, increment memory, interrupt at the end or on an error
+    DMA_Channel_TypeDef* rx = cfg->rx_channel;
+    DMA_Channel_TypeDef* tx = cfg->tx_channel;
+    DmaChannel_Clear_Flags(rx);
+    DmaChannel_Clear_Flags(tx);
+    SET_BIT(cfg->spi->CR2, SPI_CR2_RXDMAEN);
+    rx->CCR = 0;
+    rx->CPAR = (uint32_t)&cfg->spi->DR;
+    rx->CMAR = (uint32_t)buffer;
+    rx->CNDTR = length;
+    rx->CCR = DMA_CCR_PL_0 | DMA_CCR_MINC | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_EN;
+
+    // TX: the same filler byte over and over, clocking the data in
+    tx->CCR = 0;
+    tx->CPAR = (uint32_t)&cfg->spi->DR;
+    tx->CMAR = (uint32_t)&filler;
+    tx->CNDTR = length;
+    tx->CCR = DMA_CCR_DIR | DMA_CCR_EN;
+    SET_BIT(cfg->spi->CR2, SPI_CR2_TXDMAEN);
+    return 1;
+}
+
+uint8_t ExtFlash_Read(ExtFlash_cfg_t* cfg, uint32_t address, void* buffer, uint32_t length)
+{
+    if (!cfg->setup_done) {
+        return 0;
+    }
+    uint8_t* out = (uint8_t*)buffer;
+    while (length > 0) {
+        const uint16_t piece = (length > EXTFLASH_MAX_READ) ? (uint16_t)EXTFLASH_MAX_READ : (uint16_t)length;
+        while (cfg->busy) {
+        }
+        const uint32_t errors = cfg->errors;
+        ExtFlash_Read_Start(cfg, address, out, piece, NULL, NULL);
+        while (cfg->busy) {
+        }
+        if (cfg->errors != errors) {
+            return 0;
+        }
+        address += piece;
+        out += piece;
+        length -= piece;
+    }
+    return 1;
+}
+
+uint8_t ExtFlash_Busy(const ExtFlash_cfg_t* cfg)
+{
+    return cfg->busy;
+}
+
+uint8_t ExtFlash_Erase_Sector(ExtFlash_cfg_t* cfg, uint32_t address)
+{
+    if (!cfg->setup_done) {
+        return 0;
+    }
+    while (cfg->busy) {
+    }
+    write_enable(cfg);
+    cs_low(cfg);
+    send_command(cfg, CMD_SECTOR_ERASE, address & ~(EXTFLASH_SECTOR_BYTES - 1u), 1);
+    cs_high(cfg);
+    wait_ready(cfg);
+    return 1;
+}
+
+uint8_t ExtFlash_Program(ExtFlash_cfg_t* cfg, uint32_t address, const uint8_t* data, uint32_t length)
+{
+    if (!cfg->setup_done) {
+        return 0;
+    }
+    while (cfg->busy) {
+    }
+    while (length > 0) {
+        // A page program wraps round within its page, so stop at the page's end
+        uint32_t piece = EXTFLASH_PAGE_BYTES - (address & (EXTFLASH_PAGE_BYTES - 1u));
+        if (piece > length) {
+            piece = length;
+        }
+        write_enable(cfg);
+        cs_low(cfg);
+        send_command(cfg, CMD_PAGE_PROGRAM, address, 1);
+        for (uint32_t i = 0; i < piece; i++) {
+            exchange(cfg->spi, data[i]);
+        }
+        cs_high(cfg);
+        wait_ready(cfg);
+        address += piece;
+        data += piece;
+        length -= piece;
+    }
+    return 1;
+}
+
+void ExtFlash_DMA_IRQHandler(ExtFlash_cfg_t* cfg)
+{
+    DMA_Channel_TypeDef* rx = cfg->rx_channel;
+    DMA_TypeDef* dma = DmaChannel_Controller(rx);
+    const uint32_t shift = DmaChannel_Flag_Shift(rx);
+    if (dma->ISR & (DMA_ISR_TEIF1 << shift)) {
+        end_read(cfg, 0);
+    } else if (dma->ISR & (DMA_ISR_TCIF1 << shift)) {
+        end_read(cfg, 1);
+    }
+}
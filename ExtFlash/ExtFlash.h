@@ -0,0 +1,163 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file ExtFlash.h
+ * @brief External SPI NOR flash (W25Q-style), read by DMA, set up at register level
+ *
+ * Holds asset packs too big for the internal flash (AssetPack_Open_Flash()).
+ * Reads are FAST_READ (0x0B) transfers: the command, address and dummy byte
+ * go out by the CPU, then the SPI's RX DMA moves the data straight into the
+ * caller's buffer while its TX DMA clocks out 0xFF filler, so a read of any
+ * size costs the CPU five bytes. ExtFlash_Read_Start() returns at once and
+ * calls back from the RX channel's interrupt; ExtFlash_Read() waits for it.
+ * A read can go into an LCD line buffer or a buzzer table while the LCD DMA
+ * sends the previous row on its own SPI.
+ *
+ * The pins are set up for SPI1 on PA5 (SCK), PA6 (MISO) and PA7 (MOSI), AF5:
+ * the Arduino D13, D12 and D11 header pins. D13 is the Nucleo's LD2 too,
+ * which flickers while the flash is read. Chip select is any output pin.
+ * SPI1's DMA requests are on DMA2_Channel3 (RX) and DMA2_Channel4 (TX),
+ * request 4; DMA1_Channel2/3 also can, but the buzzer and the link have them.
+ *
+ * Erasing and programming are polled and slow (a sector erase is tens of
+ * milliseconds): they are for putting a pack on the flash, not for game time.
+ *
+ * Example usage:
+ * @code
+ * ExtFlash_cfg_t ext_flash = {
+ *     .spi = SPI1,
+ *     .cs_port = GPIOA,
+ *     .cs_pin = GPIO_PIN_9,            // Arduino D8
+ *     .rx_channel = DMA2_Channel3,     // SPI1_RX
+ *     .tx_channel = DMA2_Channel4,     // SPI1_TX
+ *     .dma_request = 4,
+ *     .baud_div = 1,                   // 20MHz from the 80MHz APB2 clock
+ *     .setup_done = 0
+ * };
+ *
+ * if (ExtFlash_Init(&ext_flash)) {
+ *     ExtFlash_Read(&ext_flash, 0x1000, buffer, sizeof(buffer));
+ *     ExtFlash_Read_Start(&ext_flash, 0x2000, rows, sizeof(rows), rows_ready, NULL);
+ * }
+ *
+ * // In DMA2_Channel3_IRQHandler():
+ * ExtFlash_DMA_IRQHandler(&ext_flash);
+ * @endcode
+ */
+
+#define EXTFLASH_PAGE_BYTES 256u     ///< Most bytes one program command writes
+#define EXTFLASH_SECTOR_BYTES 4096u  ///< Smallest erasable block
+#define EXTFLASH_MAX_READ 65535u     ///< Most bytes one read moves (one DMA run)
+
+/**
+ * @brief Called from the DMA interrupt when a read has finished
+ *
+ * @param context As given to ExtFlash_Read_Start()
+ * @param ok 1 if the data is in the buffer, 0 if the DMA failed
+ */
+typedef void (*ExtFlash_Callback_t)(void* context, uint8_t ok);
+
+/**
+ * @struct ExtFlash_cfg_t
+ * @brief Configuration and state of an external flash
+ */
+typedef struct {
+    SPI_TypeDef* spi;                  ///< SPI to use (SPI1; pins are set up for it on PA5-PA7)
+    GPIO_TypeDef* cs_port;             ///< Chip select port
+    uint16_t cs_pin;                   ///< Chip select pin mask (GPIO_PIN_x), driven low for each command
+    DMA_Channel_TypeDef* rx_channel;   ///< DMA channel of the SPI's RX request (SPI1_RX: DMA2_Channel3)
+    DMA_Channel_TypeDef* tx_channel;   ///< DMA channel of the SPI's TX request (SPI1_TX: DMA2_Channel4)
+    uint8_t dma_request;               ///< DMA request number of both (CSELR), 4 for SPI1 on DMA2
+    uint8_t baud_div;                  ///< SCLK = APB2 clock / 2^(baud_div+1), 0 (/2) to 7 (/256)
+    uint8_t setup_done;                ///< Internal flag: 1 if initialized and a flash answered
+    uint32_t jedec_id;                 ///< Internal: manufacturer, type and capacity bytes (0x9F)
+    volatile uint8_t busy;             ///< Internal: 1 while a read is in flight
+    ExtFlash_Callback_t done;          ///< Internal: callback of the read in flight
+    void* context;                     ///< Internal: its context
+    uint16_t length;                   ///< Internal: its length in bytes
+    uint32_t bytes_read;               ///< Internal: bytes read since ExtFlash_Init()
+    uint32_t errors;                   ///< Internal: reads lost to a DMA transfer error
+} ExtFlash_cfg_t;
+
+/**
+ * @brief Set up the pins, the SPI and its DMA channels, wake the flash and read its ID
+ *
+ * @param cfg Pointer to flash configuration struct
+ * @return 1 if a flash answered, 0 if not (nothing on the pins, or a DMA channel taken)
+ */
+uint8_t ExtFlash_Init(ExtFlash_cfg_t* cfg);
+
+/**
+ * @brief Start reading into memory, and return at once
+ *
+ * @param cfg Pointer to flash configuration struct
+ * @param address First byte to read
+ * @param buffer Where the bytes go; it must stay untouched until done is called
+ * @param length Bytes to read, 1 to EXTFLASH_MAX_READ
+ * @param done Called from the DMA interrupt when the read has finished (may be NULL)
+ * @param context Passed to done
+ * @return 1 if started, 0 if not (not set up, a read in flight, or a bad length)
+ */
+uint8_t ExtFlash_Read_Start(ExtFlash_cfg_t* cfg, uint32_t address, void* buffer, uint16_t length,
+                            ExtFlash_Callback_t done, void* context);
+
+/**
+ * @brief Read into memory, waiting for the data (any length)
+ *
+ * @param cfg Pointer to flash configuration struct
+ * @param address First byte to read
+ * @param buffer Where the bytes go
+ * @param length Bytes to read
+ * @return 1 if read, 0 if not set up or the DMA failed
+ */
+uint8_t ExtFlash_Read(ExtFlash_cfg_t* cfg, uint32_t address, void* buffer, uint32_t length);
+
+/**
+ * @brief Check whether a read is in flight
+ *
+ * @param cfg Pointer to flash configuration struct
+ * @return 1 until the read's callback has run
+ */
+uint8_t ExtFlash_Busy(const ExtFlash_cfg_t* cfg);
+
+/**
+ * @brief Erase the 4KB sector holding address to 0xFF, waiting for it (tens of ms)
+ *
+ * @param cfg Pointer to flash configuration struct
+ * @param address Any byte of the sector
+ * @return 1 if erased, 0 if not set up
+ */
+uint8_t ExtFlash_Erase_Sector(ExtFlash_cfg_t* cfg, uint32_t address);
+
+/**
+ * @brief Program erased bytes, waiting for each page (about 1ms per 256 bytes)
+ *
+ * Split into page program commands at the 256-byte page boundaries. Programming
+ * only clears bits: erase the sectors first.
+ *
+ * @param cfg Pointer to flash configuration struct
+ * @param address First byte to program
+ * @param data Bytes to program
+ * @param length Number of bytes
+ * @return 1 if programmed, 0 if not set up
+ */
+uint8_t ExtFlash_Program(ExtFlash_cfg_t* cfg, uint32_t address, const uint8_t* data, uint32_t length);
+
+/**
+ * @brief RX DMA interrupt handler (ends the read and runs its callback)
+ *
+ * Call from the IRQ handler of cfg->rx_channel.
+ *
+ * @param cfg Pointer to flash configuration struct
+ */
+void ExtFlash_DMA_IRQHandler(ExtFlash_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,306 @@
+/**
+ * @file FlashStore.c
+ * @brief Log-structured flash store implementation
+ *
+ * Page layout: a header double-word (magic, sequence number), then records
+ * from offset 8, each a header double-word and the value padded to whole
+ * double-words:
+ *
+ *     bytes 0-1  CRC-16 (Telemetry_CRC16()) of byte 2 to the end of the value
+ *     byte  2    FLASHSTORE_RECORD_TAG
+ *     byte  3    key
+ *     byte  4    value length
+ *     bytes 5-7  0
+ *
+ * Erased flash reads 0xFF, so the first all-0xFF double-word ends the log.
+ * A record cut short by a reset fails its CRC and is passed over.
+ */
+
+#include "FlashStore.h"
+#include "Telemetry.h"
+#include <string.h>
+
+#define FLASHSTORE_PAGE_MAGIC 0x53465350u  // "PSFS"
+#define FLASHSTORE_RECORD_TAG 0xA5u
+
+// Bank 2 of the 1MB part starts at 0x08080000: the store has to be there, away from the code
+#if FLASHSTORE_BASE < 0x08080000u
+#error "FLASHSTORE_BASE must be in bank 2"
+#endif
+#if FLASHSTORE_MAX_LENGTH > 240
+#error "FLASHSTORE_MAX_LENGTH must fit a record in 255 bytes"
+#endif
+
+// Bytes a record with a value of length bytes takes
+static inline uint16_t record_bytes(uint8_t length) {
+    return (uint16_t)(8u + ((length + 7u) & ~7u));
+}
+
+static inline uint32_t page_address(uint8_t page) {
+    return FLASHSTORE_BASE + (uint32_t)page * FLASH_PAGE_SIZE;
+}
+
+static inline const uint8_t* page_bytes(uint8_t page) {
+    return (const uint8_t*)page_address(page);
+}
+
+// Page number within bank 2, as HAL_FLASHEx_Erase_IT() counts them
+static inline uint32_t bank2_page(uint8_t page) {
+    return (page_address(page) - (FLASH_BASE + FLASH_BANK_SIZE)) / FLASH_PAGE_SIZE;
+}
+
+static uint8_t record_valid(const uint8_t* record) {
+    uint16_t crc = (uint16_t)(record[0] | (record[1] << 8));
+    return Telemetry_CRC16(record + 2, (uint16_t)(6u + record[4])) == crc;
+}
+
+static uint8_t page_valid(uint8_t page, uint32_t* sequence) {
+    uint32_t header[2];
+    memcpy(header, page_bytes(page), sizeof(header));
+    *sequence = header[1];
+    return header[0] == FLASHSTORE_PAGE_MAGIC;
+}
+
+// Newest valid record of each key in the active page, and where the log ends. A damaged
+// header leaves the rest of the page unusable: the next write moves to the other page.
+static void scan(FlashStore_t* store) {
+    for (uint8_t k = 0; k < FLASHSTORE_MAX_KEYS; k++) {
+        store->newest[k] = 0;
+    }
+    if (store->sequence == 0) {
+        store->write_offset = FLASH_PAGE_SIZE;
+        return;
+    }
+    const uint8_t* page = page_bytes(store->active);
+    uint16_t offset = 8;
+    while (offset + 8u <= FLASH_PAGE_SIZE) {
+        const uint8_t* record = page + offset;
+        static const uint8_t erased[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+        if (memcmp(record, erased, 8) == 0) {
+            break;
+        }
+        if (record[2] != FLASHSTORE_RECORD_TAG || record[3] >= FLASHSTORE_MAX_KEYS ||
+            record[4] > FLASHSTORE_MAX_LENGTH || offset + record_bytes(record[4]) > FLASH_PAGE_SIZE) {
+            offset = FLASH_PAGE_SIZE;
+            break;
+        }
+        if (record_valid(record)) {
+            store->newest[record[3]] = offset;
+        }
+        offset += record_bytes(record[4]);
+    }
+    store->write_offset = offset;
+}
+
+void FlashStore_Init(FlashStore_t* store) {
+    store->state = FLASHSTORE_IDLE;
+    store->pending = 0;
+    store->unlocked = 0;
+    store->writes = 0;
+    store->erases = 0;
+    store->errors = 0;
+
+    uint32_t sequence[2];
+    uint8_t valid0 = page_valid(0, &sequence[0]);
+    uint8_t valid1 = page_valid(1, &sequence[1]);
+    if (valid0 && (!valid1 || sequence[0] > sequence[1])) {
+        store->active = 0;
+    } else if (valid1) {
+        store->active = 1;
+    } else {
+        store->active = 0;
+        sequence[0] = 0;  // Blank: the first write sets up page 1
+    }
+    store->sequence = sequence[store->active];
+    scan(store);
+
+    // Operations finish in HAL_FLASH_IRQHandler(); below the LCD's DMA (priority 1)
+    NVIC_SetPriority(FLASH_IRQn, 3);
+    NVIC_EnableIRQ(FLASH_IRQn);
+}
+
+uint8_t FlashStore_Read(FlashStore_t* store, uint8_t key, uint8_t* out, uint8_t max) {
+    if (key >= FLASHSTORE_MAX_KEYS) {
+        return 0;
+    }
+    const uint8_t* record;
+    if (store->pending && store->pending_key == key) {
+        record = store->pending_record;
+    } else if (store->newest[key] != 0) {
+        record = page_bytes(store->active) + store->newest[key];
+    } else {
+        return 0;
+    }
+    uint8_t length = (record[4] < max) ? record[4] : max;
+    memcpy(out, record + 8, length);
+    return length;
+}
+
+uint8_t FlashStore_Write(FlashStore_t* store, uint8_t key, const uint8_t* data, uint8_t length) {
+    if (store->pending || key >= FLASHSTORE_MAX_KEYS || length == 0 || length > FLASHSTORE_MAX_LENGTH) {
+        return 0;
+    }
+    uint8_t* record = store->pending_record;
+    record[2] = FLASHSTORE_RECORD_TAG;
+    record[3] = key;
+    record[4] = length;
+    record[5] = record[6] = record[7] = 0;
+    memcpy(record + 8, data, length);
+    memset(record + 8 + length, 0, record_bytes(length) - 8u - length);
+    uint16_t crc = Telemetry_CRC16(record + 2, (uint16_t)(6u + length));
+    record[0] = (uint8_t)crc;
+    record[1] = (uint8_t)(crc >> 8);
+    store->pending_key = key;
+    store->pending_length = length;
+    store->pending = 1;
+    return 1;
+}
+
+// Starts programming one double-word of the target page
+static uint8_t program(FlashStore_t* store, uint16_t offset, const uint8_t* data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return HAL_FLASH_Program_IT(FLASH_TYPEPROGRAM_DOUBLEWORD, page_address(store->target) + offset, value) == HAL_OK;
+}
+
+// Gives up on the write in progress and reads the log again as it is
+static void fail(FlashStore_t* store) {
+    store->errors++;
+    store->pending = 0;
+    store->state = FLASHSTORE_IDLE;
+    HAL_FLASH_Lock();
+    store->unlocked = 0;
+    scan(store);
+}
+
+// Starts copying the next double-word across when moving; 0 once every key is across
+static uint8_t copy_step(FlashStore_t* store) {
+    while (store->copy_key < FLASHSTORE_MAX_KEYS &&
+           (store->newest[store->copy_key] == 0 || (store->pending && store->copy_key == store->pending_key))) {
+        store->moved[store->copy_key++] = 0;
+    }
+    if (store->copy_key == FLASHSTORE_MAX_KEYS) {
+        return 0;
+    }
+    const uint8_t* record = page_bytes(store->active) + store->newest[store->copy_key];
+    const uint16_t bytes = record_bytes(record[4]);
+    if (!program(store, store->write_offset + store->word * 8u, record + store->word * 8u)) {
+        fail(store);
+        return 1;
+    }
+    if (++store->word * 8u == bytes) {
+        store->moved[store->copy_key++] = store->write_offset;
+        store->write_offset += bytes;
+        store->word = 0;
+    }
+    return 1;
+}
+
+void FlashStore_Poll(FlashStore_t* store) {
+    if (store->state == FLASHSTORE_IDLE && !store->pending && !store->unlocked) {
+        return;
+    }
+    // The last operation is still running, or has just failed
+    if (pFlash.ProcedureOnGoing != FLASH_PROC_NONE) {
+        return;
+    }
+    if (store->unlocked && HAL_FLASH_GetError() != HAL_FLASH_ERROR_NONE) {
+        fail(store);
+        return;
+    }
+
+    switch (store->state) {
+    case FLASHSTORE_IDLE:
+        if (!store->pending) {
+            HAL_FLASH_Lock();
+            store->unlocked = 0;
+            return;
+        }
+        HAL_FLASH_Unlock();
+        __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+        store->unlocked = 1;
+        store->word = 0;
+        if (store->sequence != 0 && store->write_offset + record_bytes(store->pending_length) <= FLASH_PAGE_SIZE) {
+            store->target = store->active;
+            store->state = FLASHSTORE_PROGRAM;
+            break;
+        }
+        // Full (or blank): start over in the other page
+        {
+            FLASH_EraseInitTypeDef erase = {
+                .TypeErase = FLASH_TYPEERASE_PAGES,
+                .Banks = FLASH_BANK_2,
+                .Page = bank2_page(store->active ^ 1u),
+                .NbPages = 1
+            };
+            store->target = store->active ^ 1u;
+            if (HAL_FLASHEx_Erase_IT(&erase) != HAL_OK) {
+                fail(store);
+                return;
+            }
+            store->erases++;
+            store->state = FLASHSTORE_ERASE;
+        }
+        return;
+
+    case FLASHSTORE_ERASE:
+        store->write_offset = 8;
+        store->copy_key = 0;
+        store->state = FLASHSTORE_COPY;
+        // fall through
+    case FLASHSTORE_COPY:
+        if (copy_step(store)) {
+            return;
+        }
+        store->state = FLASHSTORE_PROGRAM;
+        break;
+
+    case FLASHSTORE_PROGRAM:
+    case FLASHSTORE_COMMIT:
+        break;
+    }
+
+    if (store->state == FLASHSTORE_PROGRAM) {
+        const uint16_t bytes = record_bytes(store->pending_length);
+        if (store->word * 8u < bytes) {
+            if (!program(store, store->write_offset + store->word * 8u, store->pending_record + store->word * 8u)) {
+                fail(store);
+                return;
+            }
+            store->word++;
+            return;
+        }
+        // All of it is in the flash
+        uint16_t* offsets = (store->target == store->active) ? store->newest : store->moved;
+        offsets[store->pending_key] = store->write_offset;
+        store->write_offset += bytes;
+        store->pending = 0;
+        store->writes++;
+        store->word = 0;
+        if (store->target == store->active) {
+            store->state = FLASHSTORE_IDLE;
+            return;  // Locked again by the next call
+        }
+        store->state = FLASHSTORE_COMMIT;
+    }
+
+    // FLASHSTORE_COMMIT
+    if (store->word == 0) {
+        const uint32_t header[2] = {FLASHSTORE_PAGE_MAGIC, store->sequence + 1u};
+        if (!program(store, 0, (const uint8_t*)header)) {
+            fail(store);
+            return;
+        }
+        store->word = 1;
+        return;
+    }
+    // The other page is the active one from now on
+    store->active = store->target;
+    store->sequence++;
+    memcpy(store->newest, store->moved, sizeof(store->newest));
+    store->state = FLASHSTORE_IDLE;
+}
+
+uint8_t FlashStore_Is_Idle(FlashStore_t* store) {
+    return store->state == FLASHSTORE_IDLE && !store->pending && !store->unlocked;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file FlashStore.h
+ * @brief High scores and settings kept in internal flash, written without stalling a frame
+ *
+ * A log of records across the last two 2KB pages of flash (bank 2 pages 254
+ * and 255, kept out of the program by the linker script). Each record is a
+ * key, up to FLASHSTORE_MAX_LENGTH bytes of value and a CRC-16; a key's
+ * value is its newest record with a good CRC. Records are only ever
+ * appended, so each page is erased once per fill rather than once per save:
+ *
+ * - A page starts with a header (magic and a sequence number); the valid
+ *   page with the highest sequence number is the active one.
+ * - When a record does not fit in the active page, the other page is erased
+ *   and the newest record of every key is copied across, then the new one is
+ *   written, and last of all the header. Until the header is there the old
+ *   page stays the active one, so a reset part way loses nothing.
+ *
+ * Nothing waits for the flash. FlashStore_Write() only copies the value;
+ * FlashStore_Poll(), called once a frame, starts the next erase or
+ * double-word program with the HAL's interrupt-driven calls and returns. The
+ * code runs from bank 1 while bank 2 is programmed, so the CPU is not stalled
+ * (read-while-write) as long as the program stays under 512KB; a record takes
+ * one frame per 8 bytes.
+ *
+ * Example usage:
+ * @code
+ * FlashStore_t store;
+ * FlashStore_Init(&store);
+ *
+ * uint8_t n = FlashStore_Read(&store, KEY_HIGH_SCORES, table, sizeof(table));
+ * FlashStore_Write(&store, KEY_HIGH_SCORES, table, sizeof(table));
+ *
+ * // Once a frame:
+ * FlashStore_Poll(&store);
+ *
+ * // In FLASH_IRQHandler():
+ * HAL_FLASH_IRQHandler();
+ * @endcode
+ */
+
+#ifndef FLASHSTORE_H
+#define FLASHSTORE_H
+
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+// First of the two pages (bank 2); the linker script keeps FLASHSTORE_BYTES from here free
+#define FLASHSTORE_BASE  0x080FF000u
+#define FLASHSTORE_BYTES (2u * FLASH_PAGE_SIZE)
+
+// Longest value a record holds
+#ifndef FLASHSTORE_MAX_LENGTH
+#define FLASHSTORE_MAX_LENGTH 64
+#endif
+
+// Keys are 0 to FLASHSTORE_MAX_KEYS - 1
+#define FLASHSTORE_MAX_KEYS 16
+
+/**
+ * @enum FlashStore_State_t
+ * @brief What FlashStore_Poll() is doing
+ */
+typedef enum {
+    FLASHSTORE_IDLE = 0,    ///< Nothing to write
+    FLASHSTORE_ERASE,       ///< Erasing the other page to move records across
+    FLASHSTORE_COPY,        ///< Copying the newest record of each key to it
+    FLASHSTORE_PROGRAM,     ///< Writing the pending record
+    FLASHSTORE_COMMIT       ///< Writing the header that makes the new page the active one
+} FlashStore_State_t;
+
+/**
+ * @struct FlashStore_t
+ * @brief Where the log is and the write in progress
+ */
+typedef struct {
+    FlashStore_State_t state;
+    uint8_t active;             // Page reads come from (0 or 1)
+    uint8_t target;             // Page being written (the active one, or the other when moving)
+    uint32_t sequence;          // Sequence number of the active page (0: no valid page yet)
+    uint16_t newest[FLASHSTORE_MAX_KEYS];  // Offset of each key's newest record in the active page (0: none)
+    uint16_t moved[FLASHSTORE_MAX_KEYS];   // ...and in the page being moved to
+    uint16_t write_offset;      // Next free byte in the target page
+    uint8_t copy_key;           // Next key to copy across when moving
+    uint8_t word;               // Double-words of the current record or header started
+    uint8_t unlocked;           // The flash is unlocked for an operation
+    // The value waiting to be written
+    uint8_t pending;            // A value is waiting
+    uint8_t pending_key;
+    uint8_t pending_length;
+    uint8_t pending_record[8 + ((FLASHSTORE_MAX_LENGTH + 7) & ~7)];  // Header and padded value: a whole record
+    // Statistics
+    uint32_t writes;            // Records written
+    uint32_t erases;            // Pages erased
+    uint32_t errors;            // Flash operations that failed (the write is dropped)
+} FlashStore_t;
+
+/**
+ * @brief Find the active page
+ *
+ * Reads only: a blank or damaged store gets set up by the first write.
+ *
+ * @param store Pointer to store
+ */
+void FlashStore_Init(FlashStore_t* store);
+
+/**
+ * @brief Get a key's value
+ *
+ * A value still waiting to be written is returned as if it had been. The
+ * log is read straight from flash: during a page erase (when FlashStore_Poll()
+ * moves to the other page) that waits for the erase, about 20ms. Read at
+ * start-up, or when FlashStore_Is_Idle().
+ *
+ * @param store Pointer to store
+ * @param key Key (0 to FLASHSTORE_MAX_KEYS - 1)
+ * @param out Buffer for the value
+ * @param max Size of out; a longer value is cut short
+ * @return Bytes of the value (0 if the key has none)
+ */
+uint8_t FlashStore_Read(FlashStore_t* store, uint8_t key, uint8_t* out, uint8_t max);
+
+/**
+ * @brief Set a key's value
+ *
+ * Copied at once and written by later FlashStore_Poll() calls.
+ *
+ * @param store Pointer to store
+ * @param key Key (0 to FLASHSTORE_MAX_KEYS - 1)
+ * @param data Value
+ * @param length Bytes of value (1 to FLASHSTORE_MAX_LENGTH)
+ * @return 1 if taken, 0 if another write is still going on (try again later) or the value is too long
+ */
+uint8_t FlashStore_Write(FlashStore_t* store, uint8_t key, const uint8_t* data, uint8_t length);
+
+/**
+ * @brief Move the write on by one flash operation, if the last one has finished
+ *
+ * Call once a frame. Never waits.
+ *
+ * @param store Pointer to store
+ */
+void FlashStore_Poll(FlashStore_t* store);
+
+/**
+ * @brief Check whether everything written has reached the flash
+ *
+ * Before a reset or STOP2 (which halts the flash interface), poll until it is.
+ *
+ * @param store Pointer to store
+ * @return 1 if nothing is left to write
+ */
+uint8_t FlashStore_Is_Idle(FlashStore_t* store);
+
+#endif // FLASHSTORE_H
@@ -0,0 +1,57 @@
+#include "Fmt.h"
+
+/**
+ * @file Fmt.c
+ * @brief Implementation of the integer formatting
+ *
+ * Digits are made least significant first into a small local array and then
+ * copied out in order. Dividing by the constant 10 compiles to a multiply and
+ * a shift on the Cortex-M4, so a 5-digit number takes a few dozen cycles.
+ */
+
+// Writes magnitude in decimal, returns the number of digits
+static uint8_t put_digits(char* out, uint32_t magnitude)
+{
+    char digits[10];
+    uint8_t n = 0;
+    do {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    uint8_t len = 0;
+    while (n) {
+        out[len++] = digits[--n];
+    }
+    out[len] = '\0';
+    return len;
+}
+
+uint8_t Fmt_U16(char* out, uint16_t value)
+{
+    return put_digits(out, value);
+}
+
+uint8_t Fmt_I32(char* out, int32_t value)
+{
+    if (value < 0) {
+        out[0] = '-';
+        return 1 + put_digits(out + 1, -(uint32_t)value);
+    }
+    return put_digits(out, (uint32_t)value);
+}
+
+uint8_t Fmt_Label_Int(char* out, uint8_t size, const char* label, int32_t value)
+{
+    if (size < FMT_I32_CHARS) {
+        if (size) {
+            out[0] = '\0';
+        }
+        return 0;
+    }
+    uint8_t len = 0;
+    while (label && *label && len < size - FMT_I32_CHARS) {
+        out[len++] = *label++;
+    }
+    return len + Fmt_I32(out + len, value);
+}
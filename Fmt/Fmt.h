@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Fmt.h
+ * @brief Small integer to text formatting for HUD and log text
+ *
+ * A few hundred bytes of code instead of sprintf: the build links newlib's
+ * float printf support (-u _printf_float), so every sprintf/printf goes
+ * through the full vfprintf, which takes several microseconds for a short
+ * number and allocates its buffers from the heap on first use.
+ *
+ * Every function writes into the caller's buffer, followed by a '\0', and
+ * returns the number of characters written (not counting the '\0'). There
+ * is no static or heap state, so they can be called from interrupts and the
+ * main loop at once.
+ *
+ * Example usage:
+ * @code
+ * char text[16];
+ * Fmt_Label_Int(text, sizeof(text), "Score: ", score);   // "Score: 12"
+ * LCD_printString(text, 20, 30, 1, 2);
+ *
+ * uint8_t len = Fmt_U16(text, duty / 10);                 // "12.5%"
+ * text[len++] = '.';
+ * len += Fmt_U16(text + len, duty % 10);
+ * @endcode
+ */
+
+/**
+ * @brief Characters Fmt_U16() writes at most, '\0' included
+ */
+#define FMT_U16_CHARS 6
+
+/**
+ * @brief Characters Fmt_I32() writes at most, '\0' included ("-2147483648")
+ */
+#define FMT_I32_CHARS 12
+
+/**
+ * @brief Write a number in decimal
+ *
+ * @param out At least FMT_U16_CHARS characters
+ * @param value Number to write
+ * @return Digits written, 1 to 5
+ */
+uint8_t Fmt_U16(char* out, uint16_t value);
+
+/**
+ * @brief Write a signed number in decimal, with a '-' if negative
+ *
+ * @param out At least FMT_I32_CHARS characters
+ * @param value Number to write
+ * @return Characters written, 1 to 11
+ */
+uint8_t Fmt_I32(char* out, int32_t value);
+
+/**
+ * @brief Write a label followed by a number, e.g. "Lives: 3"
+ *
+ * @details The number is always written whole: if the two do not fit in
+ *          size, the label is cut short. Nothing is written if size is
+ *          less than FMT_I32_CHARS.
+ *
+ * @param out Buffer of size characters
+ * @param size Size of out, '\0' included
+ * @param label Text before the number (NULL for none)
+ * @param value Number to write
+ * @return Characters written
+ */
+uint8_t Fmt_Label_Int(char* out, uint8_t size, const char* label, int32_t value);
+
+#ifdef __cplusplus
+}
+#endif
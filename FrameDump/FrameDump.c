@@ -0,0 +1,120 @@
+/**
+ * @file FrameDump.c
+ * @brief Frame dump encoding implementation
+ */
+
+#include "FrameDump.h"
+
+static uint8_t* put_u16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint8_t* put_u32(uint8_t* p, uint32_t value) {
+    p = put_u16(p, (uint16_t)value);
+    return put_u16(p, (uint16_t)(value >> 16));
+}
+
+void FrameDump_Begin(FrameDump_t* dump, uint16_t width, uint16_t height, const uint16_t* palette,
+                     uint8_t colours) {
+    if (colours > FRAMEDUMP_MAX_COLOURS) {
+        colours = FRAMEDUMP_MAX_COLOURS;
+    }
+    dump->state = FRAMEDUMP_CAPTURING;
+    dump->colours = colours;
+    dump->number++;
+    dump->width = width;
+    dump->height = height;
+    dump->rows = 0;
+    for (uint8_t i = 0; i < colours; i++) {
+        dump->palette[i] = palette[i];
+    }
+    dump->length = 0;
+    dump->sent = 0;
+    dump->header_sent = 0;
+    dump->crc = 0xFFFF;
+}
+
+uint8_t FrameDump_Add_Row(FrameDump_t* dump, const uint8_t* pixels) {
+    if (dump->state != FRAMEDUMP_CAPTURING) {
+        return 0;
+    }
+    uint32_t n = dump->length;
+    uint16_t x = 0;
+    while (x < dump->width) {
+        const uint8_t colour = pixels[x] & 0x0F;
+        uint16_t run = 1;
+        while (x + run < dump->width && run < 256 && (pixels[x + run] & 0x0F) == colour) {
+            run++;
+        }
+        // Short runs in one byte, long ones in two
+        const uint32_t bytes = (run < 16) ? 1u : 2u;
+        if (n + bytes > FRAMEDUMP_BUFFER_BYTES) {
+            dump->state = FRAMEDUMP_OVERFLOWED;
+            return 0;
+        }
+        if (run < 16) {
+            dump->data[n++] = (uint8_t)((run << 4) | colour);
+        } else {
+            dump->data[n++] = colour;
+            dump->data[n++] = (uint8_t)(run - 1);
+        }
+        x += run;
+    }
+    dump->crc = Telemetry_CRC16_Update(dump->crc, &dump->data[dump->length], (uint16_t)(n - dump->length));
+    dump->length = n;
+    if (++dump->rows == dump->height) {
+        dump->state = FRAMEDUMP_SENDING;
+    }
+    return 1;
+}
+
+uint16_t FrameDump_Packet(FrameDump_t* dump, uint8_t* out) {
+    if (dump->state != FRAMEDUMP_SENDING) {
+        return 0;
+    }
+    uint8_t payload[FRAMEDUMP_MAX_PAYLOAD];
+    uint8_t* p = payload;
+    *p++ = 'D';
+    if (!dump->header_sent) {
+        *p++ = 'H';
+        p = put_u16(p, dump->number);
+        p = put_u16(p, dump->width);
+        p = put_u16(p, dump->height);
+        *p++ = 4;
+        *p++ = dump->colours;
+        p = put_u32(p, dump->length);
+        for (uint8_t i = 0; i < dump->colours; i++) {
+            p = put_u16(p, dump->palette[i]);
+        }
+    } else if (dump->sent < dump->length) {
+        const uint32_t left = dump->length - dump->sent;
+        const uint16_t chunk = (left < FRAMEDUMP_CHUNK_BYTES) ? (uint16_t)left : FRAMEDUMP_CHUNK_BYTES;
+        *p++ = 'R';
+        p = put_u16(p, dump->number);
+        p = put_u32(p, dump->sent);
+        for (uint16_t i = 0; i < chunk; i++) {
+            *p++ = dump->data[dump->sent + i];
+        }
+    } else {
+        *p++ = 'E';
+        p = put_u16(p, dump->number);
+        p = put_u16(p, dump->crc);
+    }
+    return Telemetry_Encode_Packet(payload, (uint16_t)(p - payload), out);
+}
+
+void FrameDump_Packet_Sent(FrameDump_t* dump) {
+    if (dump->state != FRAMEDUMP_SENDING) {
+        return;
+    }
+    if (!dump->header_sent) {
+        dump->header_sent = 1;
+    } else if (dump->sent < dump->length) {
+        const uint32_t left = dump->length - dump->sent;
+        dump->sent += (left < FRAMEDUMP_CHUNK_BYTES) ? left : FRAMEDUMP_CHUNK_BYTES;
+    } else {
+        dump->state = FRAMEDUMP_IDLE;
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * @file FrameDump.h
+ * @brief A drawn frame, run-length encoded and sent over the UART a packet at a time
+ *
+ * For looking at what the board really drew, at full speed: a frame is
+ * captured whole between two frames, so it is never torn, and then leaves
+ * in small packets, as many a frame as the log's ring takes, so the game
+ * never waits for the UART. At 115200 baud an empty court is gone in under
+ * a tenth of a second, a busy frame in half a second or so.
+ *
+ * FrameDump keeps no hardware state. The caller hands it the palette and
+ * each row of colour indices (LCD_Get_Row()), and writes out the packets
+ * (UartLog_Write()), so it builds on a PC too.
+ *
+ * **Pixels** are run-length encoded a row at a time, runs never crossing a
+ * row. Each run is one byte, colour in the low nibble and length in the high
+ * one (1-15 pixels), or a byte with a zero length followed by one of
+ * length - 1 (1-256 pixels).
+ *
+ * **Packets** go out in Telemetry_Encode_Packet()'s framing (CRC, COBS and
+ * 0x00 delimiters), so printf text and telemetry can share the line. Each
+ * payload starts with 'D', a kind and the dump's number (little-endian):
+ * | Kind | Payload after the kind and number |
+ * |------|-----------------------------------|
+ * | 'H'  | width (2), height (2), bits per pixel (1), colours (1), encoded bytes (4), palette (2 each, RGB565) |
+ * | 'R'  | offset into the encoded bytes (4), up to FRAMEDUMP_CHUNK_BYTES of them |
+ * | 'E'  | CRC-16/CCITT-FALSE of all the encoded bytes (2) |
+ *
+ * FrameDump/frame_dump_to_png.py turns the stream into PNG files, and
+ * compares them with a PPM of the host renderer if asked.
+ *
+ * Example usage:
+ * @code
+ * static FrameDump_t dump;
+ * uint16_t palette[16];
+ * uint8_t row[ST7789V2_WIDTH];
+ *
+ * // Between drawing a frame and sending it to the panel:
+ * FrameDump_Begin(&dump, ST7789V2_WIDTH, ST7789V2_HEIGHT, palette, 16);
+ * for (uint16_t y = 0; y < ST7789V2_HEIGHT; y++) {
+ *     LCD_Get_Row(y, 0, ST7789V2_WIDTH - 1, row);
+ *     FrameDump_Add_Row(&dump, row);
+ * }
+ *
+ * // Then once a frame, until it is all sent:
+ * uint8_t packet[FRAMEDUMP_PACKET_BYTES];
+ * uint16_t n;
+ * while ((n = FrameDump_Packet(&dump, packet)) > 0 &&
+ *        UartLog_Write(&uart_log, (const char*)packet, n) > 0) {
+ *     FrameDump_Packet_Sent(&dump);
+ * }
+ * @endcode
+ */
+
+#ifndef FRAMEDUMP_H
+#define FRAMEDUMP_H
+
+#include <stdint.h>
+#include "Telemetry.h"
+
+// Encoded bytes one frame can take: an empty 240x240 frame is 480, one
+// full of small shapes a few KB. A frame that does not fit is not sent
+#ifndef FRAMEDUMP_BUFFER_BYTES
+#define FRAMEDUMP_BUFFER_BYTES 8192
+#endif
+
+// Encoded bytes per 'R' packet: small enough to slip in beside the log's other writes
+#ifndef FRAMEDUMP_CHUNK_BYTES
+#define FRAMEDUMP_CHUNK_BYTES 128
+#endif
+
+// Most colours the palette of a dump can have
+#define FRAMEDUMP_MAX_COLOURS 16
+
+// 'H' is the longest payload with the most colours, 'R' with a whole chunk
+#define FRAMEDUMP_HEADER_PAYLOAD (14 + 2 * FRAMEDUMP_MAX_COLOURS)
+#define FRAMEDUMP_CHUNK_PAYLOAD (8 + FRAMEDUMP_CHUNK_BYTES)
+#define FRAMEDUMP_MAX_PAYLOAD \
+    ((FRAMEDUMP_CHUNK_PAYLOAD > FRAMEDUMP_HEADER_PAYLOAD) ? FRAMEDUMP_CHUNK_PAYLOAD : FRAMEDUMP_HEADER_PAYLOAD)
+
+// Buffer FrameDump_Packet() needs
+#define FRAMEDUMP_PACKET_BYTES TELEMETRY_PACKET_BYTES(FRAMEDUMP_MAX_PAYLOAD)
+
+#if FRAMEDUMP_CHUNK_PAYLOAD > TELEMETRY_MAX_PACKET_PAYLOAD
+#error "FRAMEDUMP_CHUNK_BYTES is too long for one packet"
+#endif
+
+/**
+ * @enum FrameDump_State_t
+ * @brief Where a dump is
+ */
+typedef enum {
+    FRAMEDUMP_IDLE = 0,     // Nothing to send
+    FRAMEDUMP_CAPTURING,    // Between FrameDump_Begin() and the last row
+    FRAMEDUMP_SENDING,      // Captured, packets going out
+    FRAMEDUMP_OVERFLOWED    // Did not fit in FRAMEDUMP_BUFFER_BYTES: nothing is sent
+} FrameDump_State_t;
+
+/**
+ * @struct FrameDump_t
+ * @brief One captured frame and how much of it has gone
+ */
+typedef struct {
+    uint8_t state;                              // FrameDump_State_t
+    uint8_t colours;                            // Palette entries
+    uint16_t number;                            // Dumps begun, so the host can tell them apart
+    uint16_t width;
+    uint16_t height;
+    uint16_t rows;                              // Rows added so far
+    uint16_t palette[FRAMEDUMP_MAX_COLOURS];    // RGB565, not byte-swapped
+    uint32_t length;                            // Encoded bytes in data
+    uint32_t sent;                              // Of those, sent in 'R' packets
+    uint8_t header_sent;                        // 'H' gone
+    uint16_t crc;                               // Of data so far
+    uint8_t data[FRAMEDUMP_BUFFER_BYTES];       // Encoded rows
+} FrameDump_t;
+
+/**
+ * @brief Start capturing a frame, dropping any dump not yet sent
+ *
+ * @param dump Dump
+ * @param width Pixels in a row
+ * @param height Rows FrameDump_Add_Row() will be given
+ * @param palette RGB565 colour of each index (not byte-swapped), copied
+ * @param colours Entries in palette (at most FRAMEDUMP_MAX_COLOURS)
+ */
+void FrameDump_Begin(FrameDump_t* dump, uint16_t width, uint16_t height, const uint16_t* palette,
+                     uint8_t colours);
+
+/**
+ * @brief Encode the next row
+ *
+ * The last of the height rows starts the sending.
+ *
+ * @param dump Dump being captured
+ * @param pixels width colour indices, one a byte
+ * @return 1, or 0 if the frame no longer fits (the dump is dropped) or is not being captured
+ */
+uint8_t FrameDump_Add_Row(FrameDump_t* dump, const uint8_t* pixels);
+
+/**
+ * @brief Build the next packet to send, ready for the UART
+ *
+ * Calling it again before FrameDump_Packet_Sent() builds the same packet, so
+ * one the UART had no room for is tried again later.
+ *
+ * @param dump Dump
+ * @param out Buffer of at least FRAMEDUMP_PACKET_BYTES
+ * @return Bytes written to out, 0 when there is nothing (more) to send
+ */
+uint16_t FrameDump_Packet(FrameDump_t* dump, uint8_t* out);
+
+/**
+ * @brief Move on from the packet FrameDump_Packet() last built
+ *
+ * After the 'E' packet the dump is idle again.
+ *
+ * @param dump Dump
+ */
+void FrameDump_Packet_Sent(FrameDump_t* dump);
+
+/**
+ * @brief Find out where a dump is
+ *
+ * @param dump Dump
+ * @return FrameDump_State_t
+ */
+static inline FrameDump_State_t FrameDump_Get_State(const FrameDump_t* dump) {
+    return (FrameDump_State_t)dump->state;
+}
+
+#endif /* FRAMEDUMP_H */
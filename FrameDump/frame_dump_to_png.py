@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""Save the frames dumped by the console's "dump" command (see FrameDump.h) as PNG.
+
+Reads from a serial port (needs pyserial) or from a capture file / stdin:
+
+    python3 frame_dump_to_png.py /dev/ttyACM0                 # live, 115200 baud
+    python3 frame_dump_to_png.py capture.bin --out shots
+    python3 frame_dump_to_png.py capture.bin --golden golden.ppm
+
+Each complete dump is written as dump_<n>.png. With --golden, each is also
+compared with a PPM saved by the host renderer (ST7789V2_Host_Write_PPM()),
+and the pixels that differ are counted. Segments between 0x00 delimiters
+that are not dump packets (printf text, telemetry) are skipped.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as Telemetry_CRC16()."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_packet(segment):
+    """The payload of a dump packet, or None."""
+    raw = cobs_decode(segment)
+    if raw is None or len(raw) < 6:
+        return None
+    payload, crc = raw[:-2], (raw[-2] << 8) | raw[-1]
+    if crc16(payload) != crc or payload[0] != ord("D"):
+        return None
+    return payload
+
+
+def rgb565_to_rgb(colour):
+    """8-bit channels, expanded as the host renderer does."""
+    r, g, b = (colour >> 11) & 0x1F, (colour >> 5) & 0x3F, colour & 0x1F
+    return ((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2))
+
+
+def decode_rle(data, width, height):
+    """Rows of colour indices from the run bytes."""
+    rows = []
+    i = 0
+    for _ in range(height):
+        row = bytearray()
+        while len(row) < width:
+            if i >= len(data):
+                raise ValueError("pixel data ends early")
+            byte = data[i]
+            i += 1
+            run = byte >> 4
+            if run == 0:
+                run = data[i] + 1
+                i += 1
+            row += bytes([byte & 0x0F]) * run
+        if len(row) != width:
+            raise ValueError("a run crosses the end of a row")
+        rows.append(row)
+    return rows
+
+
+def write_png(path, rows, palette):
+    """8-bit RGB PNG, no libraries needed."""
+    width, height = len(rows[0]), len(rows)
+    lines = bytearray()
+    for row in rows:
+        lines.append(0)  # no filter
+        for index in row:
+            lines += bytes(palette[index])
+
+    def chunk(kind, body):
+        return struct.pack(">I", len(body)) + kind + body + struct.pack(">I", zlib.crc32(kind + body))
+
+    with open(path, "wb") as png:
+        png.write(b"\x89PNG\r\n\x1a\n")
+        png.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        png.write(chunk(b"IDAT", zlib.compress(bytes(lines), 9)))
+        png.write(chunk(b"IEND", b""))
+
+
+def read_ppm(path):
+    """Width, height and RGB bytes of a binary (P6) PPM."""
+    with open(path, "rb") as ppm:
+        data = ppm.read()
+    fields = []
+    i = 0
+    while len(fields) < 4:
+        while data[i:i + 1].isspace():
+            i += 1
+        if data[i:i + 1] == b"#":
+            i = data.index(b"\n", i) + 1
+            continue
+        start = i
+        while not data[i:i + 1].isspace():
+            i += 1
+        fields.append(data[start:i])
+    if fields[0] != b"P6" or int(fields[3]) != 255:
+        raise ValueError(f"{path}: not an 8-bit P6 PPM")
+    width, height = int(fields[1]), int(fields[2])
+    return width, height, data[i + 1:i + 1 + width * height * 3]
+
+
+def compare(rows, palette, golden):
+    """Pixels that differ from the golden image, or None if the sizes differ."""
+    width, height, rgb = golden
+    if width != len(rows[0]) or height != len(rows):
+        return None
+    differ = 0
+    for y, row in enumerate(rows):
+        for x, index in enumerate(row):
+            at = (y * width + x) * 3
+            if tuple(rgb[at:at + 3]) != palette[index]:
+                differ += 1
+    return differ
+
+
+class Dump:
+    def __init__(self, header):
+        width, height, bits, colours, length = struct.unpack_from("<HHBBI", header)
+        if bits != 4:
+            raise ValueError(f"{bits} bits per pixel is not supported")
+        self.width, self.height, self.length = width, height, length
+        colours565 = struct.unpack_from(f"<{colours}H", header, 10)
+        self.palette = [rgb565_to_rgb(c) for c in colours565]
+        self.data = bytearray(length)
+        self.received = 0
+
+    def add(self, offset, chunk):
+        if offset != self.received or offset + len(chunk) > self.length:
+            raise ValueError("packet lost")
+        self.data[offset:offset + len(chunk)] = chunk
+        self.received += len(chunk)
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial
+        return serial.Serial(path, baud, timeout=1)
+    return open(path, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="serial port, capture file, or - for stdin")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--out", default=".", help="directory to write the PNGs to")
+    parser.add_argument("--golden", help="PPM from the host renderer to compare each dump with")
+    args = parser.parse_args()
+
+    golden = read_ppm(args.golden) if args.golden else None
+    os.makedirs(args.out, exist_ok=True)
+    stream = open_input(args.input, args.baud)
+    dumps = {}
+    segment = bytearray()
+    saved = failed = 0
+    try:
+        while True:
+            chunk = stream.read(256)
+            if not chunk:
+                if not hasattr(stream, "baudrate"):
+                    break
+                continue
+            for byte in chunk:
+                if byte != 0:
+                    segment.append(byte)
+                    continue
+                payload = decode_packet(segment) if segment else None
+                segment.clear()
+                if payload is None:
+                    continue
+                kind, number = chr(payload[1]), struct.unpack_from("<H", payload, 2)[0]
+                try:
+                    if kind == "H":
+                        dumps[number] = Dump(payload[4:])
+                    elif kind == "R" and number in dumps:
+                        offset = struct.unpack_from("<I", payload, 4)[0]
+                        dumps[number].add(offset, payload[8:])
+                    elif kind == "E" and number in dumps:
+                        dump = dumps.pop(number)
+                        expected = struct.unpack_from("<H", payload, 4)[0]
+                        if dump.received != dump.length or crc16(dump.data) != expected:
+                            raise ValueError("pixel data incomplete or corrupt")
+                        rows = decode_rle(dump.data, dump.width, dump.height)
+                        path = os.path.join(args.out, f"dump_{number}.png")
+                        write_png(path, rows, dump.palette)
+                        saved += 1
+                        report = f"{path}: {dump.width}x{dump.height}, {dump.length} bytes"
+                        if golden is not None:
+                            differ = compare(rows, dump.palette, golden)
+                            report += (", size differs from the golden image" if differ is None
+                                       else f", {differ} pixels differ from the golden image")
+                        print(report, flush=True)
+                except (ValueError, struct.error) as error:
+                    dumps.pop(number, None)
+                    failed += 1
+                    print(f"dump {number}: {error}", file=sys.stderr)
+    except KeyboardInterrupt:
+        pass
+    print(f"dumps saved: {saved}, failed: {failed}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
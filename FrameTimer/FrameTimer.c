@@ -0,0 +1,169 @@
+#include "FrameTimer.h"
+#include "stm32l4xx_hal.h"
+#include "ClockProfile.h"
+
+/**
+ * @file FrameTimer.c
+ * @brief Implementation of the timer-driven frame scheduler
+ *
+ * The auto-reload register is preloaded, so the value written in the update
+ * interrupt is the period of the frame after the one that has just started.
+ * Spreading the remainder of tick_freq_hz / fps over the frames keeps the
+ * average period exact with no drift.
+ *
+ * Time asleep is measured in the same timer ticks, as whole frame periods plus
+ * the counter. The fractional tick of each period is left out, which is well
+ * under 0.1% at 1MHz.
+ */
+
+// Auto-reload value for the next frame, carrying the fractional tick forward
+static uint32_t next_reload(FrameTimer_cfg_t* cfg)
+{
+    uint32_t ticks = cfg->period_ticks;
+    cfg->remainder_acc += cfg->period_remainder;
+    if (cfg->remainder_acc >= cfg->fps) {
+        cfg->remainder_acc -= cfg->fps;
+        ticks++;
+    }
+    return ticks - 1;
+}
+
+// Ticks since FrameTimer_Init(), wrapping at 2^32. Call with interrupts masked: a
+// period that ended since they were is still pending and counted here.
+static uint32_t ticks_now(FrameTimer_cfg_t* cfg)
+{
+    uint32_t count = __HAL_TIM_GET_COUNTER(cfg->htim);
+    uint32_t frames = cfg->frame_count;
+    if (__HAL_TIM_GET_FLAG(cfg->htim, TIM_FLAG_UPDATE) && count < cfg->period_ticks / 2) {
+        frames++;
+    }
+    return frames * cfg->period_ticks + count;
+}
+
+void FrameTimer_Init(FrameTimer_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+
+    cfg->period_ticks = cfg->tick_freq_hz / cfg->fps;
+    cfg->period_remainder = cfg->tick_freq_hz % cfg->fps;
+    cfg->remainder_acc = 0;
+    cfg->frame_count = 0;
+    cfg->consumed = 0;
+    cfg->overruns = 0;
+    cfg->sleep_ticks = 0;
+    cfg->window_start = 0;
+    if (cfg->max_catch_up == 0) {
+        cfg->max_catch_up = 1;
+    }
+
+    HAL_TIM_Base_Stop_IT(cfg->htim);
+    __HAL_TIM_SET_PRESCALER(cfg->htim, (ClockProfile_Timer_Hz(cfg->htim->Instance) / cfg->tick_freq_hz) - 1);
+    __HAL_TIM_SET_AUTORELOAD(cfg->htim, next_reload(cfg));
+    __HAL_TIM_SET_COUNTER(cfg->htim, 0);
+
+    // Force an update so the prescaler and first period take effect now, then
+    // preload the second period and drop the update flag the UG event raised
+    cfg->htim->Instance->EGR = TIM_EGR_UG;
+    __HAL_TIM_SET_AUTORELOAD(cfg->htim, next_reload(cfg));
+    __HAL_TIM_CLEAR_FLAG(cfg->htim, TIM_FLAG_UPDATE);
+
+    cfg->setup_done = 1;
+    HAL_TIM_Base_Start_IT(cfg->htim);
+}
+
+void FrameTimer_IRQHandler(FrameTimer_cfg_t* cfg)
+{
+    // The period just loaded is already running; queue the one after it
+    __HAL_TIM_SET_AUTORELOAD(cfg->htim, next_reload(cfg));
+    cfg->frame_count++;
+}
+
+// Steps to run for the frame ticks pending (at least one), by the overrun policy
+static uint32_t steps_for(FrameTimer_cfg_t* cfg, uint32_t pending)
+{
+    uint32_t steps = 1;
+    if (pending > 1) {
+        cfg->overruns += pending - 1;
+        if (cfg->overrun_policy == FRAMETIMER_OVERRUN_CATCH_UP) {
+            steps = (pending < cfg->max_catch_up) ? pending : cfg->max_catch_up;
+        }
+    }
+    return steps;
+}
+
+uint32_t FrameTimer_Wait(FrameTimer_cfg_t* cfg)
+{
+    // Interrupts are masked around the check so a tick landing between the test
+    // and WFI still wakes the core (WFI returns on a pending IRQ even when masked)
+    __disable_irq();
+    if (cfg->frame_count == cfg->consumed) {
+        const uint32_t start = ticks_now(cfg);
+        while (cfg->frame_count == cfg->consumed) {
+            __WFI();
+            __enable_irq();
+            __disable_irq();
+        }
+        cfg->sleep_ticks += ticks_now(cfg) - start;
+    }
+    uint32_t pending = cfg->frame_count - cfg->consumed;
+    cfg->consumed = cfg->frame_count;
+    __enable_irq();
+    return steps_for(cfg, pending);
+}
+
+uint32_t FrameTimer_Take_Steps(FrameTimer_cfg_t* cfg)
+{
+    __disable_irq();
+    uint32_t pending = cfg->frame_count - cfg->consumed;
+    cfg->consumed = cfg->frame_count;
+    __enable_irq();
+    return pending ? steps_for(cfg, pending) : 0;
+}
+
+void FrameTimer_Pause(FrameTimer_cfg_t* cfg)
+{
+    HAL_TIM_Base_Stop_IT(cfg->htim);
+}
+
+void FrameTimer_Resume(FrameTimer_cfg_t* cfg)
+{
+    __disable_irq();
+    cfg->consumed = cfg->frame_count;
+    __enable_irq();
+    HAL_TIM_Base_Start_IT(cfg->htim);
+}
+
+uint16_t FrameTimer_Get_Phase(FrameTimer_cfg_t* cfg)
+{
+    if (cfg->frame_count != cfg->consumed) {
+        return 256;
+    }
+    // ARR already holds the next period, which is within a tick of the current one
+    uint32_t count = __HAL_TIM_GET_COUNTER(cfg->htim);
+    uint32_t period = __HAL_TIM_GET_AUTORELOAD(cfg->htim) + 1;
+    uint32_t phase = (count * 256) / period;
+    return (uint16_t)((phase > 256) ? 256 : phase);
+}
+
+uint16_t FrameTimer_Take_Duty_Cycle(FrameTimer_cfg_t* cfg)
+{
+    __disable_irq();
+    uint32_t now = ticks_now(cfg);
+    uint32_t window = now - cfg->window_start;
+    uint32_t asleep = cfg->sleep_ticks;
+    cfg->window_start = now;
+    cfg->sleep_ticks = 0;
+    __enable_irq();
+
+    if (window == 0 || asleep >= window) {
+        return 0;
+    }
+    return (uint16_t)(((uint64_t)(window - asleep) * 1000) / window);
+}
+
+uint32_t FrameTimer_Get_Overruns(FrameTimer_cfg_t* cfg)
+{
+    return cfg->overruns;
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file FrameTimer.h
+ * @brief Timer-driven fixed-timestep frame scheduler for STM32L4
+ *
+ * Uses the update interrupt of a basic timer (TIM6/TIM7) as the frame clock,
+ * following the same configuration struct pattern as the Buzzer and PWM libraries.
+ *
+ * Features:
+ * - Exact average frame period, even when the tick rate is not a multiple of the
+ *   frame rate (e.g. 60 FPS from a 1MHz tick alternates 16667/16667/16666 ticks)
+ * - CPU sleeps (WFI) between frames instead of busy-polling HAL_GetTick()
+ * - Overrun detection, with a configurable drop or catch-up policy
+ * - Duty cycle: the share of time the CPU was awake, measured with the frame timer itself
+ *
+ * Example usage:
+ * @code
+ * FrameTimer_cfg_t frame_timer = {
+ *     .htim = &htim6,
+ *     .tick_freq_hz = 1000000,   // 1MHz timer clock after prescaler
+ *     .fps = 60,
+ *     .overrun_policy = FRAMETIMER_OVERRUN_CATCH_UP,
+ *     .max_catch_up = 3,
+ *     .setup_done = 0
+ * };
+ *
+ * FrameTimer_Init(&frame_timer);
+ * while (1) {
+ *     uint32_t steps = FrameTimer_Wait(&frame_timer);  // sleeps until the next frame
+ *     while (steps--) update();
+ *     render();
+ * }
+ *
+ * // In HAL_TIM_PeriodElapsedCallback():
+ * if (htim == frame_timer.htim) FrameTimer_IRQHandler(&frame_timer);
+ * @endcode
+ */
+
+/**
+ * @enum FrameTimer_Overrun_t
+ * @brief What FrameTimer_Wait() does when one or more frame ticks were missed
+ */
+typedef enum {
+    FRAMETIMER_OVERRUN_DROP = 0,    ///< Run a single step and drop the missed frames (game slows down)
+    FRAMETIMER_OVERRUN_CATCH_UP     ///< Run one step per missed frame, up to max_catch_up (game time stays real time)
+} FrameTimer_Overrun_t;
+
+/**
+ * @struct FrameTimer_cfg_t
+ * @brief Configuration for a frame timer instance
+ *
+ * @details The timer's prescaler and auto-reload are reprogrammed by FrameTimer_Init(),
+ * so only the CubeMX base init (clock and NVIC) is required. tick_freq_hz / fps must
+ * fit the 16-bit auto-reload register (at 1MHz, anything above 15 FPS).
+ */
+typedef struct {
+    TIM_HandleTypeDef* htim;                ///< Pointer to timer handle (e.g., &htim6)
+    uint32_t tick_freq_hz;                  ///< Timer tick frequency after prescaler (Hz)
+    uint32_t fps;                           ///< Frame rate (Hz)
+    FrameTimer_Overrun_t overrun_policy;    ///< Missed frame handling
+    uint8_t max_catch_up;                   ///< Most steps returned per frame with FRAMETIMER_OVERRUN_CATCH_UP
+    uint8_t setup_done;                     ///< Internal flag: 1 if initialized, 0 otherwise
+    uint32_t period_ticks;                  ///< Internal: whole ticks per frame
+    uint32_t period_remainder;              ///< Internal: leftover ticks per frame, in 1/fps units
+    uint32_t remainder_acc;                 ///< Internal: accumulated leftover ticks
+    volatile uint32_t frame_count;          ///< Internal: frame ticks raised by the interrupt
+    uint32_t consumed;                      ///< Internal: frame ticks handed out by FrameTimer_Wait()
+    uint32_t overruns;                      ///< Internal: total frame ticks missed
+    uint32_t sleep_ticks;                   ///< Internal: ticks spent asleep in FrameTimer_Wait() this duty cycle window
+    uint32_t window_start;                  ///< Internal: tick the duty cycle window started at
+} FrameTimer_cfg_t;
+
+/**
+ * @brief Initialize and start the frame timer
+ *
+ * @param cfg Pointer to frame timer configuration struct
+ *
+ * @details Sets the prescaler for tick_freq_hz, loads the first frame period and
+ * starts the update interrupt.
+ *
+ * @note The timer must be initialized by CubeMX (MX_TIMx_Init) first
+ */
+void FrameTimer_Init(FrameTimer_cfg_t* cfg);
+
+/**
+ * @brief Sleep until the next frame is due
+ *
+ * Returns immediately if a frame tick is already pending (the last frame overran).
+ *
+ * @param cfg Pointer to frame timer configuration struct
+ * @return Number of fixed-timestep updates to run this frame (1 unless catching up)
+ */
+uint32_t FrameTimer_Wait(FrameTimer_cfg_t* cfg);
+
+/**
+ * @brief Take the frame ticks raised so far, without sleeping
+ *
+ * For callers that wait in some other way, e.g. an RTOS task woken from the timer
+ * interrupt. Time spent waiting is not seen, so FrameTimer_Take_Duty_Cycle() then
+ * counts all of it as awake.
+ *
+ * @param cfg Pointer to frame timer configuration struct
+ * @return Number of fixed-timestep updates to run (0 if no tick is pending)
+ */
+uint32_t FrameTimer_Take_Steps(FrameTimer_cfg_t* cfg);
+
+/**
+ * @brief Frame timer update interrupt handler
+ *
+ * Call from HAL_TIM_PeriodElapsedCallback() when htim matches cfg->htim.
+ *
+ * @param cfg Pointer to frame timer configuration struct
+ */
+void FrameTimer_IRQHandler(FrameTimer_cfg_t* cfg);
+
+/**
+ * @brief Stop the frame ticks, e.g. while the game is paused
+ *
+ * Nothing wakes the CPU from the timer until FrameTimer_Resume().
+ *
+ * @param cfg Pointer to frame timer configuration struct
+ */
+void FrameTimer_Pause(FrameTimer_cfg_t* cfg);
+
+/**
+ * @brief Start the frame ticks again after FrameTimer_Pause()
+ *
+ * A tick still pending from before the pause is dropped, so no steps are run
+ * for the time paused; the period that was cut short runs on from where it stopped.
+ *
+ * @param cfg Pointer to frame timer configuration struct
+ */
+void FrameTimer_Resume(FrameTimer_cfg_t* cfg);
+
+/**
+ * @brief Get how far the current frame period has run
+ *
+ * @param cfg Pointer to frame timer configuration struct
+ * @return Elapsed fraction of the period, 0 to 256 (256 if a tick is already pending)
+ */
+uint16_t FrameTimer_Get_Phase(FrameTimer_cfg_t* cfg);
+
+/**
+ * @brief Get the CPU duty cycle and start a new measurement window
+ *
+ * The duty cycle is the share of the time since the last call (or FrameTimer_Init())
+ * that the CPU was not asleep in FrameTimer_Wait(). Lower is better for battery life;
+ * 1000 means the frame work fills every frame period.
+ *
+ * @param cfg Pointer to frame timer configuration struct
+ * @return Time awake in per mille (0 to 1000)
+ *
+ * @note Call at least once per 2^32 timer ticks (71 minutes at 1MHz)
+ */
+uint16_t FrameTimer_Take_Duty_Cycle(FrameTimer_cfg_t* cfg);
+
+/**
+ * @brief Get the number of frame ticks missed since FrameTimer_Init()
+ *
+ * @param cfg Pointer to frame timer configuration struct
+ * @return Total missed frames (whether dropped or caught up)
+ */
+uint32_t FrameTimer_Get_Overruns(FrameTimer_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif
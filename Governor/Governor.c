@@ -0,0 +1,54 @@
+#include "Governor.h"
+
+/**
+ * @file Governor.c
+ * @brief Implementation of the frame-budget governor
+ *
+ * Both runs are cleared when the level changes, so each shed or restore has
+ * to be earned again at the new level.
+ */
+
+void Governor_Init(Governor_t* governor)
+{
+    governor->level = 0;
+    governor->over = 0;
+    governor->under = 0;
+    governor->last_cycles = 0;
+    governor->sheds = 0;
+}
+
+uint8_t Governor_Frame(Governor_t* governor, uint32_t cycles)
+{
+    const uint8_t shed_after = governor->shed_after ? governor->shed_after : 1;
+    const uint8_t restore_after = governor->restore_after ? governor->restore_after : 1;
+    governor->last_cycles = cycles;
+
+    if (cycles > governor->budget_cycles) {
+        governor->under = 0;
+        if (governor->level < governor->max_level && ++governor->over >= shed_after) {
+            governor->level++;
+            governor->sheds++;
+            governor->over = 0;
+        }
+    } else if (cycles < governor->budget_cycles - governor->budget_cycles / 4) {
+        governor->over = 0;
+        if (governor->level > 0 && ++governor->under >= restore_after) {
+            governor->level--;
+            governor->under = 0;
+        }
+    } else {
+        // Close to the budget: hold the level
+        governor->over = 0;
+        governor->under = 0;
+    }
+    return governor->level;
+}
+
+uint8_t Governor_Get_Load(const Governor_t* governor)
+{
+    if (governor->budget_cycles == 0) {
+        return 255;
+    }
+    const uint64_t percent = ((uint64_t)governor->last_cycles * 100u) / governor->budget_cycles;
+    return (uint8_t)((percent > 255u) ? 255u : percent);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Governor.h
+ * @brief Frame-budget governor: sheds optional drawing work while frames run over budget
+ *
+ * The caller times each frame (DWT cycles, say) and hands the cost to
+ * Governor_Frame(), which returns the level of work to shed: 0 draws
+ * everything, each level above leaves out a little more. What a level leaves
+ * out is up to the caller, least noticeable first.
+ *
+ * A level is shed after shed_after frames in a row over budget, and given
+ * back after restore_after frames in a row under three quarters of it. The
+ * gap between the two limits, and a restore that waits much longer than a
+ * shed, keep the level from flickering when the cost sits near the budget.
+ *
+ * Physics does not go through the governor: it keeps real time by catching up
+ * missed steps (FrameTimer), and shedding only ever saves drawing time.
+ *
+ * Example usage:
+ * @code
+ * Governor_t governor = {
+ *     .budget_cycles = SystemCoreClock / 60 * 3 / 4,  // 3/4 of a 60Hz frame
+ *     .max_level = 3,
+ *     .shed_after = 3,
+ *     .restore_after = 120
+ * };
+ * Governor_Init(&governor);
+ *
+ * // Every frame:
+ * uint32_t start = DWT->CYCCNT;
+ * draw(level);
+ * level = Governor_Frame(&governor, DWT->CYCCNT - start);
+ * @endcode
+ */
+
+/**
+ * @struct Governor_t
+ * @brief Frame budget, limits and the current level; fill in the first four fields
+ */
+typedef struct {
+    uint32_t budget_cycles;     ///< Cost a frame may have
+    uint8_t max_level;          ///< Most levels that can be shed
+    uint8_t shed_after;         ///< Frames in a row over budget before a level is shed (0 counts as 1)
+    uint8_t restore_after;      ///< Frames in a row under 3/4 of the budget before one is given back (0 counts as 1)
+    uint8_t level;              ///< Current level, 0 = nothing shed
+    uint8_t over;               ///< Internal: frames in a row over budget
+    uint8_t under;              ///< Internal: frames in a row well under budget
+    uint32_t last_cycles;       ///< Cost of the latest frame
+    uint32_t sheds;             ///< Times a level was shed since Governor_Init()
+} Governor_t;
+
+/**
+ * @brief Start at level 0 with the counts cleared
+ *
+ * @param governor Pointer to governor
+ */
+void Governor_Init(Governor_t* governor);
+
+/**
+ * @brief Account for a frame and get the level the next one should draw at
+ *
+ * @param governor Pointer to governor
+ * @param cycles Cost of the frame just drawn
+ * @return Level to shed, 0 to max_level
+ */
+uint8_t Governor_Frame(Governor_t* governor, uint32_t cycles);
+
+/**
+ * @brief Get the latest frame's cost as a share of the budget
+ *
+ * @param governor Pointer to governor
+ * @return Percent of budget_cycles, capped at 255
+ */
+uint8_t Governor_Get_Load(const Governor_t* governor);
+
+#ifdef __cplusplus
+}
+#endif
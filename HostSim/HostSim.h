@@ -0,0 +1,79 @@
+/**
+ * @file HostSim.h
+ * @brief What the host tools share: the engine they play and the stick that plays it
+ *
+ * Built with PONG_HEADLESS=1 (see CMakeLists.txt here), so nothing is drawn
+ * or heard and the game is seeded with Random_Seed() alone.
+ */
+
+#ifndef HOSTSIM_H
+#define HOSTSIM_H
+
+#include <stdint.h>
+#include "PongEngine.h"
+
+/**
+ * @brief Start a game as main.c's new_game() does, from a seed
+ *
+ * @param engine Engine to set up
+ * @param seed Random_Seed() value: the same seed plays the same game
+ */
+static inline void HostSim_New_Game(PongEngine_t* engine, uint32_t seed) {
+    Random_Seed(seed);
+    PongEngine_Init(engine, 10, 100, 4, 40, 6, 8.0f);
+}
+
+/**
+ * @brief The tools' own random bits (xorshift32), apart from Random_U32()
+ *
+ * @param state Any non-zero value to start with, updated
+ * @return Next 32 bits
+ */
+static inline uint32_t HostSim_Noise(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief A stick that follows the nearest ball coming in, full deflection or none
+ *
+ * Misses now and then, as the paddle is slower than a fast ball, so games end
+ * and every rule gets exercised: hits, goals, lives and the serve.
+ *
+ * @param engine Engine being played
+ * @param noise Random bits, from HostSim_Noise() so the game's own random
+ *              stream is left alone: 1 in 8 steps the stick is pushed the
+ *              other way instead
+ * @return Input for the next PongEngine_Update()
+ */
+static inline UserInput HostSim_Track_Ball(const PongEngine_t* engine, uint32_t noise) {
+    UserInput input = {CENTRE, 0.0f, -1.0f};
+    const BallSet_t* balls = &engine->balls;
+    if (balls->count == 0) {
+        return input;
+    }
+    uint8_t nearest = 0;
+    for (uint8_t i = 1; i < balls->count; i++) {
+        if (balls->x[i] < balls->x[nearest]) {
+            nearest = i;
+        }
+    }
+    const int16_t ball_y = Fixed_ToInt(balls->y[nearest]) + balls->size[nearest] / 2;
+    const int16_t paddle_y = engine->paddle.y + engine->paddle.height / 2;
+    int8_t dir = (ball_y < paddle_y - 2) ? -1 : (ball_y > paddle_y + 2) ? 1 : 0;
+    if ((noise & 7u) == 0) {
+        dir = (int8_t)-dir;
+    }
+    if (dir != 0) {
+        input.direction = (dir < 0) ? N : S;
+        input.magnitude = 1.0f;
+        input.angle = (dir < 0) ? 0.0f : 180.0f;
+    }
+    return input;
+}
+
+#endif // HOSTSIM_H
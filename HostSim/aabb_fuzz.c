@@ -0,0 +1,209 @@
+/**
+ * @file aabb_fuzz.c
+ * @brief Property fuzz of the AABB tests against a reference model
+ *
+ * aabb_fuzz [cases] [seed]: random box pairs, sweeps and box lists, one in
+ * four with coordinates and sizes anywhere in the int16 range, each checked
+ * against a model worked in 64-bit integers and long double that cannot overflow:
+ * - AABB_Collides() must agree with the model exactly;
+ * - AABB_Sweep() must agree on hit / no hit, and on the contact time to a few
+ *   Q16.16 steps, except where the model's times are within a few steps of a
+ *   boundary (touching, or contact at the very start or end of the move), where
+ *   rounding decides either way;
+ * - AABB_CollidesMany() against up to FUZZ_MANY_MAX boxes must set the same mask
+ *   bits, and return the same count, as AABB_Collides() box by box.
+ * Prints the first few mismatches and the totals. Exits with status 1 if any.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Utils.h"
+
+#define FUZZ_REPORT_FIRST 5              // Mismatches printed in full
+#define FUZZ_TIME_SLACK (4.0L / FIXED_ONE)  // Q16.16 rounding allowed in a contact time
+#define FUZZ_MANY_MAX 70                 // Boxes per AABB_CollidesMany() case: three mask words
+#define FUZZ_MANY_EVERY 8                // One AABB_CollidesMany() case in this many
+
+static uint64_t fuzz_state;
+
+// xorshift64: independent of the game's PCG32 so the engine's sequence is untouched
+static uint64_t fuzz_next(void) {
+    fuzz_state ^= fuzz_state << 13;
+    fuzz_state ^= fuzz_state >> 7;
+    fuzz_state ^= fuzz_state << 17;
+    return fuzz_state;
+}
+
+// A coordinate near the court, or anywhere in int16 for a large case
+static int16_t fuzz_coord(uint8_t large) {
+    return large ? (int16_t)fuzz_next() : (int16_t)((int32_t)(fuzz_next() % 400u) - 100);
+}
+
+// A size up to the court's, or up to INT16_MAX for a large case
+static int16_t fuzz_size(uint8_t large, uint32_t small_max) {
+    return (int16_t)(fuzz_next() % (large ? 32768u : small_max));
+}
+
+static AABB fuzz_box(uint8_t large) {
+    AABB box;
+    box.x = fuzz_coord(large);
+    box.y = fuzz_coord(large);
+    box.width = fuzz_size(large, 60u);
+    box.height = fuzz_size(large, 60u);
+    return box;
+}
+
+static uint8_t model_collides(const AABB* a, const AABB* b) {
+    return (int64_t)a->x < (int64_t)b->x + b->width &&
+           (int64_t)a->x + a->width > b->x &&
+           (int64_t)a->y < (int64_t)b->y + b->height &&
+           (int64_t)a->y + a->height > b->y;
+}
+
+// Entry and exit fraction on one axis, as in sweep_axis() but in long double
+static uint8_t model_axis(long double pos, long double size, long double move,
+                          long double lo, long double hi, long double* entry, long double* exit) {
+    if (move == 0) {
+        if (pos < hi && pos + size > lo) {
+            *entry = -INFINITY;
+            *exit = INFINITY;
+            return 1;
+        }
+        return 0;
+    }
+    const long double near = (move > 0) ? lo - (pos + size) : hi - pos;
+    const long double far = (move > 0) ? hi - pos : lo - (pos + size);
+    *entry = near / move;
+    *exit = far / move;
+    return 1;
+}
+
+// A start position in Q16.16: near the court with a fractional part, or a whole pixel anywhere
+static Fixed16 fuzz_position(uint8_t large) {
+    if (large) {
+        return Fixed_FromInt(fuzz_coord(1));
+    }
+    return Fixed_FromInt(fuzz_coord(0)) + (Fixed16)(fuzz_next() % FIXED_ONE);
+}
+
+// A move of up to 20 px each way, a few Q16.16 steps, or none at all on one axis
+static FixedVector2D fuzz_move(void) {
+    const uint32_t mode = (uint32_t)(fuzz_next() % 4u);
+    const uint32_t span = 40u << FIXED_SHIFT;
+    FixedVector2D move;
+    move.x = (mode == 0) ? 0 :
+             (mode == 1) ? (Fixed16)(fuzz_next() % 7u) - 3 :
+             (Fixed16)(fuzz_next() % span) - (Fixed16)(span / 2u);
+    move.y = (mode == 3) ? 0 : (Fixed16)(fuzz_next() % span) - (Fixed16)(span / 2u);
+    return move;
+}
+
+// AABB_CollidesMany() of one box against n others, against AABB_Collides() of each in turn
+static uint8_t check_many(AABB* box, uint8_t large, uint8_t n) {
+    int16_t x[FUZZ_MANY_MAX], y[FUZZ_MANY_MAX], width[FUZZ_MANY_MAX], height[FUZZ_MANY_MAX];
+    for (uint8_t i = 0; i < n; i++) {
+        AABB other = fuzz_box(large);
+        x[i] = other.x;
+        y[i] = other.y;
+        width[i] = other.width;
+        height[i] = other.height;
+    }
+    const AABB_SoA boxes = {x, y, width, height};
+
+    // Words past (n + 31) / 32 must be left alone, so they start poisoned
+    uint32_t mask[(FUZZ_MANY_MAX + 31) / 32 + 1];
+    for (uint8_t w = 0; w < sizeof(mask) / sizeof(mask[0]); w++) {
+        mask[w] = 0xA5A5A5A5u;
+    }
+    const uint8_t hits = AABB_CollidesMany(box, &boxes, n, mask);
+
+    uint8_t expected = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        AABB other = {x[i], y[i], width[i], height[i]};
+        const uint8_t collides = AABB_Collides(box, &other);
+        expected += collides;
+        if (collides != ((mask[i / 32] >> (i % 32)) & 1u)) {
+            return 1;
+        }
+    }
+    // Bits past n in the last word must be clear
+    if (n % 32 && (mask[n / 32] >> (n % 32)) != 0) {
+        return 1;
+    }
+    return hits != expected || mask[(n + 31) / 32] != 0xA5A5A5A5u;
+}
+
+int main(int argc, char** argv) {
+    const uint32_t cases = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 20000000u;
+    const uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1u;
+    fuzz_state = 0x9E3779B97F4A7C15ULL ^ seed;
+
+    uint32_t collide_bad = 0, sweep_bad = 0, sweep_checked = 0, many_bad = 0, many_checked = 0;
+
+    for (uint32_t n = 0; n < cases; n++) {
+        const uint8_t large = (n % 4u) == 0;
+
+        AABB a = fuzz_box(large);
+        AABB b = fuzz_box(large);
+        if (AABB_Collides(&a, &b) != model_collides(&a, &b) && collide_bad++ < FUZZ_REPORT_FIRST) {
+            printf("AABB_Collides case %lu: (%d,%d %dx%d) (%d,%d %dx%d) gave %u\n",
+                   (unsigned long)n, a.x, a.y, a.width, a.height, b.x, b.y, b.width, b.height,
+                   AABB_Collides(&a, &b));
+        }
+
+        if (n % FUZZ_MANY_EVERY == 0) {
+            const uint8_t count = (uint8_t)(fuzz_next() % (FUZZ_MANY_MAX + 1u));
+            many_checked++;
+            if (check_many(&a, large, count) && many_bad++ < FUZZ_REPORT_FIRST) {
+                printf("AABB_CollidesMany case %lu: %u boxes against (%d,%d %dx%d)\n",
+                       (unsigned long)n, count, a.x, a.y, a.width, a.height);
+            }
+        }
+
+        const Fixed16 x = fuzz_position(large);
+        const Fixed16 y = fuzz_position(0);
+        const int16_t width = (int16_t)(1 + fuzz_next() % 10u);
+        const int16_t height = (int16_t)(1 + fuzz_next() % 10u);
+        const FixedVector2D move = fuzz_move();
+        const AABB_SweepResult got = AABB_Sweep(x, y, width, height, move, &b);
+
+        long double entry_x, exit_x, entry_y, exit_y;
+        const uint8_t can_hit =
+            model_axis((long double)x / FIXED_ONE, width, (long double)move.x / FIXED_ONE,
+                       b.x, (long double)b.x + b.width, &entry_x, &exit_x) &&
+            model_axis((long double)y / FIXED_ONE, height, (long double)move.y / FIXED_ONE,
+                       b.y, (long double)b.y + b.height, &entry_y, &exit_y);
+        uint8_t bad = 0;
+        long double entry = 0, exit = 0;
+        if (!can_hit) {
+            bad = got.hit;
+        } else {
+            entry = fmaxl(entry_x, entry_y);
+            exit = fminl(exit_x, exit_y);
+            if (fabsl(entry - exit) < FUZZ_TIME_SLACK || fabsl(exit) < FUZZ_TIME_SLACK ||
+                fabsl(entry - 1) < FUZZ_TIME_SLACK) {
+                continue;  // On a boundary: either answer is right
+            }
+            const uint8_t hit = entry < exit && exit > 0 && entry <= 1;
+            const long double time = (entry > 0) ? entry : 0;
+            bad = hit != got.hit ||
+                  (hit && fabsl(time - (long double)got.time / FIXED_ONE) > FUZZ_TIME_SLACK);
+        }
+        sweep_checked++;
+        if (bad && sweep_bad++ < FUZZ_REPORT_FIRST) {
+            printf("AABB_Sweep case %lu: %dx%d at (%ld,%ld) moving (%ld,%ld) to (%d,%d %dx%d): "
+                   "hit %u time %ld, model entry %Lf exit %Lf\n",
+                   (unsigned long)n, width, height, (long)x, (long)y, (long)move.x, (long)move.y,
+                   b.x, b.y, b.width, b.height, got.hit, (long)got.time, entry, exit);
+        }
+    }
+
+    printf("%lu cases, seed %lu\n", (unsigned long)cases, (unsigned long)seed);
+    printf("  AABB_Collides     %lu mismatches\n", (unsigned long)collide_bad);
+    printf("  AABB_Sweep        %lu mismatches in %lu checked\n",
+           (unsigned long)sweep_bad, (unsigned long)sweep_checked);
+    printf("  AABB_CollidesMany %lu mismatches in %lu checked\n",
+           (unsigned long)many_bad, (unsigned long)many_checked);
+    return (collide_bad || sweep_bad || many_bad) ? 1 : 0;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file pong_sim.c
+ * @brief Steps the headless engine flat out and reports its speed and the games played
+ *
+ * pong_sim [steps] [seed]: plays games back to back with HostSim_Track_Ball()
+ * on the stick, a new one from the next seed at each game over, and prints
+ * the steps/s, the games and their best score. The same steps and seed give
+ * the same output on any machine but for the speed, so a change to the
+ * physics that should play the same game can be checked by it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "HostSim.h"
+
+int main(int argc, char** argv) {
+    const uint32_t steps = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 10000000u;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1u;
+
+    static PongEngine_t engine;
+    HostSim_New_Game(&engine, seed);
+    uint32_t noise = seed | 1u;
+    uint32_t games = 1;
+    uint32_t total_score = 0;
+    uint16_t best = 0;
+
+    const clock_t start = clock();
+    for (uint32_t n = 0; n < steps; n++) {
+        if (PongEngine_Update(&engine, HostSim_Track_Ball(&engine, HostSim_Noise(&noise))) == 0) {
+            const uint16_t score = PongEngine_GetScore(&engine);
+            total_score += score;
+            best = (score > best) ? score : best;
+            HostSim_New_Game(&engine, ++seed);
+            games++;
+        }
+    }
+    const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%lu steps, %lu games (%lu finished, best score %u, total %lu)\n", (unsigned long)steps,
+           (unsigned long)games, (unsigned long)(games - 1), (unsigned)best, (unsigned long)total_score);
+    printf("%.0f steps/s\n", (seconds > 0.0) ? steps / seconds : 0.0);
+    return 0;
+}
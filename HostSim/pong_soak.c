@@ -0,0 +1,86 @@
+/**
+ * @file pong_soak.c
+ * @brief Soak run: millions of steps, each checked by PongEngine_Check()
+ *
+ * pong_soak [steps] [seed]: plays games back to back, every other one with the
+ * ball-tracking stick and the rest with a stick pushed at random, and checks
+ * the rules every step (PONG_CHECK_x). Prints how many steps broke each rule,
+ * the first few with their step and seed, and the steps/s. Exits with status 1
+ * if any step broke one, so the run can gate a change to the physics.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "HostSim.h"
+
+#define SOAK_REPORT_FIRST 10  // Broken steps printed in full
+
+static const char* const rule_names[] = {"ball out", "in paddle", "ball speed", "lives", "score"};
+#define RULE_COUNT (sizeof(rule_names) / sizeof(rule_names[0]))
+
+// A stick pushed up, down or left centred at random, held for a few steps at a time
+static UserInput random_stick(uint32_t noise) {
+    static const Direction directions[] = {N, S, CENTRE, NE, SW};
+    UserInput input = {CENTRE, 0.0f, -1.0f};
+    input.direction = directions[noise % 5u];
+    if (input.direction != CENTRE) {
+        input.magnitude = (float)((noise >> 8) & 0xFFu) / 255.0f;
+        input.angle = (input.direction == S || input.direction == SW) ? 180.0f : 0.0f;
+    }
+    return input;
+}
+
+int main(int argc, char** argv) {
+    const uint32_t steps = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 10000000u;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1u;
+
+    static PongEngine_t engine;
+    HostSim_New_Game(&engine, seed);
+    uint32_t noise = seed | 1u;
+    uint32_t games = 1;
+    uint32_t broken_steps = 0;
+    uint32_t broken[RULE_COUNT] = {0};
+    UserInput held = {CENTRE, 0.0f, -1.0f};
+
+    const clock_t start = clock();
+    for (uint32_t n = 0; n < steps; n++) {
+        const uint32_t bits = HostSim_Noise(&noise);
+        UserInput input;
+        if (games & 1u) {
+            input = HostSim_Track_Ball(&engine, bits);
+        } else {
+            if ((bits >> 24) < 32u) {  // A new push about every 8 steps
+                held = random_stick(bits);
+            }
+            input = held;
+        }
+
+        PongEngine_Watch_t watch;
+        PongEngine_Watch(&engine, &watch);
+        const uint8_t lives = PongEngine_Update(&engine, input);
+        const uint8_t flags = PongEngine_Check(&engine, &watch);
+        if (flags) {
+            if (broken_steps < SOAK_REPORT_FIRST) {
+                printf("step %lu (game seed %lu) broke 0x%02X\n", (unsigned long)n, (unsigned long)seed, flags);
+            }
+            broken_steps++;
+            for (uint8_t rule = 0; rule < RULE_COUNT; rule++) {
+                broken[rule] += (flags >> rule) & 1u;
+            }
+        }
+        if (lives == 0) {
+            HostSim_New_Game(&engine, ++seed);
+            games++;
+        }
+    }
+    const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%lu steps, %lu games, %lu broke a rule\n", (unsigned long)steps, (unsigned long)games,
+           (unsigned long)broken_steps);
+    for (uint8_t rule = 0; rule < RULE_COUNT; rule++) {
+        printf("  %-10s %lu\n", rule_names[rule], (unsigned long)broken[rule]);
+    }
+    printf("%.0f steps/s\n", (seconds > 0.0) ? steps / seconds : 0.0);
+    return broken_steps ? 1 : 0;
+}
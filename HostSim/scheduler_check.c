@@ -0,0 +1,105 @@
+/**
+ * @file scheduler_check.c
+ * @brief Host check of the stage rates Scheduler_Run() gives
+ *
+ * scheduler_check: registers stages at a spread of rates on a 1kHz tick,
+ * including rate 0 ("every tick") and rates that don't divide the tick, runs
+ * 10 seconds of ticks one or a few at a time, and checks each stage was given
+ * exactly its rate's periods, and none later than the ticks one Scheduler_Run()
+ * hands over. A rate-0 stage must run on every tick. The same again after
+ * Scheduler_Set_Rate() moves each stage to another rate.
+ * Exits with status 1 if any stage is off.
+ */
+
+#include <stdio.h>
+#include "Scheduler.h"
+
+#define CHECK_TICK_HZ 1000u
+#define CHECK_SECONDS 10u
+#define CHECK_STAGES 6
+#define CHECK_MAX_STEP 3u    // Most ticks handed to one Scheduler_Run()
+
+static const uint32_t first_rates[CHECK_STAGES] = {0, 1000, 240, 60, 7, 1};
+static const uint32_t second_rates[CHECK_STAGES] = {120, 0, 1000, 45, 0, 333};
+
+static Scheduler_t scheduler;
+static Scheduler_Stage_t stages[CHECK_STAGES];
+static uint32_t periods[CHECK_STAGES];  // Periods handed to each stage
+static uint32_t now;                    // Ticks run so far
+static uint32_t late[CHECK_STAGES];     // Ticks a period started after it was due, at most
+
+// Counts stage i's periods, and how many ticks after its ideal start the latest one ran
+static uint8_t stage_ran(uint8_t i, uint32_t n) {
+    periods[i] += n;
+    const uint32_t rate = stages[i].rate_hz ? stages[i].rate_hz : CHECK_TICK_HZ;
+    const uint64_t due = ((uint64_t)periods[i] * CHECK_TICK_HZ + rate - 1) / rate;
+    if (now + 1 > due && now + 1 - due > late[i]) {
+        late[i] = (uint32_t)(now + 1 - due);
+    }
+    return 1;
+}
+
+static uint8_t run_0(uint32_t n) { return stage_ran(0, n); }
+static uint8_t run_1(uint32_t n) { return stage_ran(1, n); }
+static uint8_t run_2(uint32_t n) { return stage_ran(2, n); }
+static uint8_t run_3(uint32_t n) { return stage_ran(3, n); }
+static uint8_t run_4(uint32_t n) { return stage_ran(4, n); }
+static uint8_t run_5(uint32_t n) { return stage_ran(5, n); }
+static const Scheduler_Fn_t runs[CHECK_STAGES] = {run_0, run_1, run_2, run_3, run_4, run_5};
+
+// Runs CHECK_SECONDS of ticks, and checks each stage got its periods; returns the stages off
+static uint8_t check_rates(const char* pass) {
+    for (uint8_t i = 0; i < CHECK_STAGES; i++) {
+        periods[i] = 0;
+        late[i] = 0;
+    }
+    now = 0;
+    const uint32_t ticks = CHECK_TICK_HZ * CHECK_SECONDS;
+    uint32_t noise = 1;
+    while (now < ticks) {
+        // Mostly one tick at a time, now and then a few at once (a long frame)
+        noise ^= noise << 13; noise ^= noise >> 17; noise ^= noise << 5;
+        uint32_t step = (noise % 16u == 0) ? 1u + (noise >> 4) % CHECK_MAX_STEP : 1u;
+        if (step > ticks - now) {
+            step = ticks - now;
+        }
+        Scheduler_Run(&scheduler, step);
+        now += step;
+    }
+
+    uint8_t off = 0;
+    for (uint8_t i = 0; i < CHECK_STAGES; i++) {
+        const uint32_t rate = stages[i].rate_hz ? stages[i].rate_hz : CHECK_TICK_HZ;
+        const uint32_t expected = rate * CHECK_SECONDS;
+        // A period due on the last tick may still be a tick away
+        const uint8_t ok = (periods[i] == expected || periods[i] + 1 == expected) && late[i] <= CHECK_MAX_STEP;
+        printf("%s %-8s %4lu Hz: %6lu periods of %6lu, up to %lu ticks late %s\n", pass, stages[i].name,
+               (unsigned long)stages[i].rate_hz, (unsigned long)periods[i], (unsigned long)expected,
+               (unsigned long)late[i], ok ? "ok" : "WRONG");
+        off += !ok;
+    }
+    return off;
+}
+
+int main(void) {
+    static const char* const names[CHECK_STAGES] = {"a", "b", "c", "d", "e", "f"};
+    Scheduler_Init(&scheduler, CHECK_TICK_HZ);
+    for (uint8_t i = 0; i < CHECK_STAGES; i++) {
+        stages[i].name = names[i];
+        stages[i].run = runs[i];
+        stages[i].rate_hz = first_rates[i];
+        stages[i].priority = i;
+        stages[i].max_catch_up = 8;
+        if (!Scheduler_Register(&scheduler, &stages[i])) {
+            printf("stage %s not registered\n", names[i]);
+            return 1;
+        }
+    }
+    uint8_t off = check_rates("registered");
+
+    for (uint8_t i = 0; i < CHECK_STAGES; i++) {
+        Scheduler_Set_Rate(&scheduler, &stages[i], second_rates[i]);
+    }
+    off += check_rates("set rate  ");
+    return off ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+#include "Jitter.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @file Jitter.c
+ * @brief Implementation of the rolling percentiles
+ *
+ * Bin b >= 16 holds the samples whose top bit is bit b / 8 + 2 and whose
+ * next three bits are b % 8; its lowest sample is (8 + b % 8) << (b / 8 - 1).
+ */
+
+#if JITTER_WINDOW < 1 || JITTER_WINDOW > 65535
+#error "JITTER_WINDOW must be 1-65535"
+#endif
+
+// Smallest sample that lands in a bin
+static uint32_t bin_bottom(uint8_t bin)
+{
+    if (bin < 16u) {
+        return bin;
+    }
+    return (8u + (bin & 7u)) << (bin / 8u - 1u);
+}
+
+// Largest sample that lands in a bin
+static uint32_t bin_top(uint8_t bin)
+{
+    return (bin == JITTER_BINS - 1u) ? UINT32_MAX : bin_bottom(bin + 1u) - 1u;
+}
+
+static uint32_t capped(uint32_t cycles, uint32_t peak)
+{
+    return (cycles > peak) ? peak : cycles;
+}
+
+void Jitter_Reset(Jitter_t* jitter)
+{
+    memset(jitter, 0, sizeof(*jitter));
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+}
+
+void Jitter_Summarize(const Jitter_t* jitter, Jitter_Summary_t* summary)
+{
+    memset(summary, 0, sizeof(*summary));
+    const uint32_t n = jitter->count;
+    summary->count = (uint16_t)n;
+    if (n == 0) {
+        return;
+    }
+
+    // Percentile p is the first bin where the samples so far reach p% of n (rounded up)
+    const uint32_t rank50 = (n * 50u + 99u) / 100u;
+    const uint32_t rank95 = (n * 95u + 99u) / 100u;
+    const uint32_t rank99 = (n * 99u + 99u) / 100u;
+    uint32_t seen = 0;
+    for (uint8_t bin = 0; bin < JITTER_BINS; bin++) {
+        if (jitter->bins[bin] == 0) {
+            continue;
+        }
+        const uint32_t before = seen;
+        seen += jitter->bins[bin];
+        const uint32_t bottom = bin_bottom(bin);
+        const uint32_t middle = capped(bottom + (bin_top(bin) - bottom) / 2u, jitter->peak);
+        if (before < rank50 && seen >= rank50) {
+            summary->p50 = middle;
+        }
+        if (before < rank95 && seen >= rank95) {
+            summary->p95 = middle;
+        }
+        if (before < rank99 && seen >= rank99) {
+            summary->p99 = middle;
+        }
+        summary->max = capped(bin_top(bin), jitter->peak);
+    }
+}
+
+void Jitter_Report(const char* name, const Jitter_t* jitter)
+{
+    Jitter_Summary_t summary;
+    Jitter_Summarize(jitter, &summary);
+    const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    printf("%-8s p50 %6lu  p95 %6lu  p99 %6lu  max %6lu us over %u, peak %lu us\n", name,
+           (unsigned long)(summary.p50 / cycles_per_us), (unsigned long)(summary.p95 / cycles_per_us),
+           (unsigned long)(summary.p99 / cycles_per_us), (unsigned long)(summary.max / cycles_per_us),
+           (unsigned)summary.count, (unsigned long)(jitter->peak / cycles_per_us));
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Jitter.h
+ * @brief Percentiles of frame intervals and stage costs over a rolling window
+ *
+ * An average frame rate hides stutter: one 50ms frame in a second of 16ms
+ * ones barely moves it. A Jitter_t keeps a histogram of the last
+ * JITTER_WINDOW samples (DWT cycles), from which p50/p95/p99/max are read at
+ * any time, so a hitch shows up in p99 and max for as long as it is in the
+ * window.
+ *
+ * The bins are log-linear: eight per power of two, each up to 12.5% wide,
+ * from 16 cycles up to the 32-bit limit (below 16, one per value), so the
+ * bin of a sample is a CLZ and a shift. The window is a ring of bin numbers:
+ * adding a sample takes the oldest one's bin out of the histogram and puts
+ * the new one in. That is a dozen or so instructions, inlined, so the stats
+ * can stay on in a release build. Reading the percentiles walks the 240 bins
+ * once.
+ *
+ * Percentiles are the middle of the bin they fall in, so within about 6%;
+ * max is the top of the highest bin. Both are capped at peak, which is exact.
+ * A Jitter_t belongs to one thread: add and read it from the same context.
+ *
+ * Example usage:
+ * @code
+ * Jitter_t frame_interval, render_cost;
+ * Jitter_Reset(&frame_interval);
+ * Jitter_Reset(&render_cost);
+ *
+ * // Once a frame:
+ * Jitter_Mark(&frame_interval);                  // time since the last mark
+ * uint32_t start = DWT->CYCCNT;
+ * draw();
+ * Jitter_Add(&render_cost, DWT->CYCCNT - start);
+ *
+ * // On demand:
+ * Jitter_Report("interval", &frame_interval);   // printf in microseconds
+ * @endcode
+ */
+
+/**
+ * @brief Samples in the rolling window (1-65535)
+ *
+ * 256 frames is about 4 seconds at 60fps; p99 then rests on the worst 3.
+ */
+#ifndef JITTER_WINDOW
+#define JITTER_WINDOW 256
+#endif
+
+#define JITTER_BINS 240   ///< Log-linear bins covering 0 to 2^32 - 1 cycles
+
+/**
+ * @struct Jitter_t
+ * @brief Rolling histogram of one measurement
+ */
+typedef struct {
+    uint16_t bins[JITTER_BINS];     ///< Samples in the window that fall in each bin
+    uint8_t ring[JITTER_WINDOW];    ///< Internal: bin of each sample in the window
+    uint16_t head;                  ///< Internal: ring slot the next sample goes in
+    uint16_t count;                 ///< Samples in the window, up to JITTER_WINDOW
+    uint32_t peak;                  ///< Largest sample since Jitter_Reset(), cycles (exact)
+    uint32_t last_mark;             ///< Internal: DWT->CYCCNT at the last Jitter_Mark()
+    uint8_t marked;                 ///< Internal: 1 once last_mark holds a mark
+} Jitter_t;
+
+/**
+ * @struct Jitter_Summary_t
+ * @brief Percentiles of the window, in cycles
+ */
+typedef struct {
+    uint32_t p50;
+    uint32_t p95;
+    uint32_t p99;
+    uint32_t max;       ///< Largest sample in the window (its bin's top, capped at peak)
+    uint16_t count;     ///< Samples they were taken over (0: all zero)
+} Jitter_Summary_t;
+
+/**
+ * @brief Histogram bin of a sample
+ *
+ * 0-15 have a bin each; above that, eight bins per power of two.
+ */
+static inline uint8_t Jitter_Bin(uint32_t cycles)
+{
+    if (cycles < 16u) {
+        return (uint8_t)cycles;
+    }
+    const uint32_t msb = 31u - __CLZ(cycles);
+    return (uint8_t)(msb * 8u + ((cycles >> (msb - 3u)) & 7u) - 16u);
+}
+
+/**
+ * @brief Add a sample to the window, pushing out the oldest once it is full
+ *
+ * @param jitter Pointer to the histogram
+ * @param cycles Sample, e.g. a stage's DWT cycles
+ */
+static inline void Jitter_Add(Jitter_t* jitter, uint32_t cycles)
+{
+    const uint8_t bin = Jitter_Bin(cycles);
+    if (jitter->count == JITTER_WINDOW) {
+        jitter->bins[jitter->ring[jitter->head]]--;
+    } else {
+        jitter->count++;
+    }
+    jitter->ring[jitter->head] = bin;
+    jitter->bins[bin]++;
+    jitter->head = (jitter->head + 1u == JITTER_WINDOW) ? 0 : jitter->head + 1u;
+    if (cycles > jitter->peak) {
+        jitter->peak = cycles;
+    }
+}
+
+/**
+ * @brief Add the time since the previous mark (the first mark only starts the clock)
+ *
+ * @param jitter Pointer to the histogram of intervals
+ */
+static inline void Jitter_Mark(Jitter_t* jitter)
+{
+    const uint32_t now = DWT->CYCCNT;
+    if (jitter->marked) {
+        Jitter_Add(jitter, now - jitter->last_mark);
+    }
+    jitter->last_mark = now;
+    jitter->marked = 1;
+}
+
+/**
+ * @brief Forget the last mark, so a deliberate gap (e.g. a pause) isn't counted as an interval
+ *
+ * @param jitter Pointer to the histogram of intervals
+ */
+static inline void Jitter_Break(Jitter_t* jitter)
+{
+    jitter->marked = 0;
+}
+
+/**
+ * @brief Empty the window and clear peak
+ *
+ * Starts the DWT cycle counter too, if it isn't running yet.
+ *
+ * @param jitter Pointer to the histogram
+ */
+void Jitter_Reset(Jitter_t* jitter);
+
+/**
+ * @brief Read the percentiles of the window
+ *
+ * @param jitter Pointer to the histogram
+ * @param summary Filled in, in cycles
+ */
+void Jitter_Summarize(const Jitter_t* jitter, Jitter_Summary_t* summary);
+
+/**
+ * @brief Print the window's p50/p95/p99/max and the peak in microseconds (printf)
+ *
+ * @param name Label at the start of the line
+ * @param jitter Pointer to the histogram
+ */
+void Jitter_Report(const char* name, const Jitter_t* jitter);
+
+#ifdef __cplusplus
+}
+#endif
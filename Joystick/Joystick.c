@@ -1,5 +1,8 @@
 #include "Joystick.h"
+#include "DmaChannel.h"
+#include "DmaBuffer.h"
 #include <stdlib.h>
+#include "Joystick_Tables.h"
 #include <math.h>
 
 /**
@@ -18,6 +21,10 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+// 16-bit conversions from the ADC's DR, written by a circular DMA run
+DMA_BUFFER_CHECK(((Joystick_cfg_t*)0)->dma_samples, 2);
+DMA_BUFFER_CHECK(((Joystick_Scan_t*)0)->samples, 2);
+
 /**
  * @brief Conversion factor from radians to degrees
  * 
@@ -32,31 +39,667 @@
  */
 #define JOYSTICK_ADC_RANGE 4095.0f
 
+/**
+ * @brief Integer fast path scaling: full deflection = 4096 (Q12)
+ * 
+ * tan²(22.5°) = 0.17157 ≈ 11244/65536 is the (squared) slope between a cardinal
+ * direction and a diagonal. 5% deflection, squared in Q32, is the CENTRE threshold.
+ */
+#define JOYSTICK_FAST_ONE 4096
+#define JOYSTICK_FAST_TAN2_22_5_Q16 11244
+#define JOYSTICK_FAST_CENTRE_SQ_Q32 (((int64_t)1 << 32) / 400)
+
+/**
+ * @brief Normalize a processed value to Q12 (-4096 to 4096), clamped
+ */
+static int32_t Joystick_NormaliseFast(int16_t value, uint16_t center)
+{
+    int32_t n = ((int32_t)value * JOYSTICK_FAST_ONE) / (center ? center : 1);
+    if (n > JOYSTICK_FAST_ONE) n = JOYSTICK_FAST_ONE;
+    if (n < -JOYSTICK_FAST_ONE) n = -JOYSTICK_FAST_ONE;
+    return n;
+}
+
+/**
+ * @brief Approximate vector length, max + 3/8 min (within about 7%), clamped to full deflection
+ */
+static int32_t Joystick_MagnitudeFast(int32_t ax, int32_t ay)
+{
+    int32_t hi = (ax > ay) ? ax : ay;
+    int32_t lo = (ax > ay) ? ay : ax;
+    int32_t mag = hi + ((3 * lo) >> 3);
+    return (mag > JOYSTICK_FAST_ONE) ? JOYSTICK_FAST_ONE : mag;
+}
+
+/**
+ * @brief Sample of a Joystick_Tables.h table at t (0 to 1), interpolated linearly
+ */
+static inline float Joystick_TableLookup(const float* table, float t)
+{
+    float position = t * JOYSTICK_TABLE_SEGMENTS;
+    int32_t i = (int32_t)position;
+    if (i >= JOYSTICK_TABLE_SEGMENTS) i = JOYSTICK_TABLE_SEGMENTS - 1;
+    return table[i] + (table[i + 1] - table[i]) * (position - (float)i);
+}
+
+/**
+ * @brief Background center tracking (cfg->auto_center)
+ * 
+ * Variance is taken about a fast moving mean (time constant 4 reads). 64 ADC units²
+ * is well above the noise after oversampling, well below any deliberate movement.
+ */
+#define JOYSTICK_CENTER_SHIFT 6
+#define JOYSTICK_REST_VARIANCE 64
+
+/**
+ * @brief Follow the rest position while the stick is steady near the center
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * @param x Filtered X sample
+ * @param y Filtered Y sample
+ */
+static void Joystick_TrackCenter(Joystick_cfg_t* cfg, uint16_t x, uint16_t y)
+{
+    const int32_t sample[2] = {x, y};
+    uint16_t* center[2] = {&cfg->center_x, &cfg->center_y};
+    uint8_t settled = (cfg->center_count >= (1u << JOYSTICK_CENTER_SHIFT));
+    int32_t window = settled ? cfg->deadzone : 4 * cfg->deadzone;
+    uint8_t at_rest = 1;
+
+    for (int axis = 0; axis < 2; axis++) {
+        int32_t s = sample[axis] << 8;
+        if (!cfg->rest_primed) {
+            cfg->rest_mean[axis] = s;
+            cfg->rest_var[axis] = 4 * JOYSTICK_REST_VARIANCE;  // Counts as moving until proven steady
+        }
+        int32_t d = (s - cfg->rest_mean[axis]) >> 8;
+        cfg->rest_mean[axis] += (s - cfg->rest_mean[axis]) >> 2;
+        cfg->rest_var[axis] += (d * d - cfg->rest_var[axis]) >> 2;
+
+        if (cfg->rest_var[axis] > JOYSTICK_REST_VARIANCE || abs(sample[axis] - *center[axis]) >= window) {
+            at_rest = 0;
+        }
+    }
+    cfg->rest_primed = 1;
+    if (!at_rest) {
+        return;
+    }
+
+    // Even average of the first reads (1/n weights), then a fixed-rate EMA
+    if (!settled) {
+        cfg->center_count++;
+    }
+    for (int axis = 0; axis < 2; axis++) {
+        int32_t step = (sample[axis] << 8) - cfg->center_acc[axis];
+        cfg->center_acc[axis] += settled ? (step >> JOYSTICK_CENTER_SHIFT) : (step / cfg->center_count);
+        *center[axis] = (uint16_t)((cfg->center_acc[axis] + 128) >> 8);
+    }
+}
+
+// DMA request line of ADC1 on both the channels that can serve it (DMA1 Ch1, DMA2 Ch3)
+#define JOYSTICK_DMA_REQUEST_ADC1 0x0
+
+// Regular sequence ranks in order (the HAL's rank values are register offsets, not 1, 2, ...)
+static const uint32_t joystick_ranks[2 * JOYSTICK_SCAN_MAX_STICKS] = {
+    ADC_REGULAR_RANK_1, ADC_REGULAR_RANK_2,
+#if JOYSTICK_SCAN_MAX_STICKS > 1
+    ADC_REGULAR_RANK_3, ADC_REGULAR_RANK_4,
+#endif
+#if JOYSTICK_SCAN_MAX_STICKS > 2
+    ADC_REGULAR_RANK_5, ADC_REGULAR_RANK_6,
+#endif
+#if JOYSTICK_SCAN_MAX_STICKS > 3
+    ADC_REGULAR_RANK_7, ADC_REGULAR_RANK_8,
+#endif
+#if JOYSTICK_SCAN_MAX_STICKS > 4
+    ADC_REGULAR_RANK_9, ADC_REGULAR_RANK_10,
+#endif
+#if JOYSTICK_SCAN_MAX_STICKS > 5
+    ADC_REGULAR_RANK_11, ADC_REGULAR_RANK_12,
+#endif
+#if JOYSTICK_SCAN_MAX_STICKS > 6
+    ADC_REGULAR_RANK_13, ADC_REGULAR_RANK_14,
+#endif
+#if JOYSTICK_SCAN_MAX_STICKS > 7
+    ADC_REGULAR_RANK_15, ADC_REGULAR_RANK_16,
+#endif
+};
+
+/**
+ * @brief Reconfigure the ADC for oversampling and/or continuous DMA scanning
+ * 
+ * @param adc ADC handle
+ * @param oversampling Hardware oversampling ratio (0 or 1 for none)
+ * @param conversions Length of the scanned sequence, or 0 for one conversion at a time (polled)
+ */
+static void Joystick_InitADC(ADC_HandleTypeDef* adc, uint16_t oversampling, uint8_t conversions)
+{
+    if (conversions > 0) {
+        // Scan the sequence (X then Y of each stick) over and over
+        adc->Init.ScanConvMode = ADC_SCAN_ENABLE;
+        adc->Init.NbrOfConversion = conversions;
+        adc->Init.ContinuousConvMode = ENABLE;
+        adc->Init.EOCSelection = ADC_EOC_SEQ_CONV;
+        adc->Init.DMAContinuousRequests = ENABLE;       // DMA circular mode
+        adc->Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;   // Never stall on a late DMA
+    }
+
+    // Oversampling: ratio 2^n conversions summed, shifted right n = 12-bit average
+    uint32_t log2_ratio = 0;
+    while (log2_ratio < 8 && (2u << log2_ratio) <= oversampling) {
+        log2_ratio++;
+    }
+    if (log2_ratio > 0) {
+        adc->Init.OversamplingMode = ENABLE;
+        adc->Init.Oversampling.Ratio = (log2_ratio - 1) << ADC_CFGR2_OVSR_Pos;
+        adc->Init.Oversampling.RightBitShift = log2_ratio << ADC_CFGR2_OVSS_Pos;
+        adc->Init.Oversampling.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
+        adc->Init.Oversampling.OversamplingStopReset = ADC_REGOVERSAMPLING_CONTINUED_MODE;
+    } else {
+        adc->Init.OversamplingMode = DISABLE;
+    }
+    HAL_ADC_Init(adc);
+}
+
+/**
+ * @brief Run the configured filter stages on one axis sample
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * @param axis 0 = X, 1 = Y
+ * @param sample Raw sample
+ * @return Filtered sample (same 0-4095 range)
+ */
+static uint16_t Joystick_Filter(Joystick_cfg_t* cfg, uint8_t axis, uint16_t sample)
+{
+    if (cfg->filter & JOYSTICK_FILTER_MEDIAN) {
+        uint16_t* h = cfg->filter_history[axis];
+        h[0] = h[1];
+        h[1] = h[2];
+        h[2] = sample;
+        if (cfg->filter_count >= 3) {
+            // Median of three without sorting
+            uint16_t lo = (h[0] < h[1]) ? h[0] : h[1];
+            uint16_t hi = (h[0] < h[1]) ? h[1] : h[0];
+            sample = (h[2] < lo) ? lo : (h[2] > hi) ? hi : h[2];
+        }
+    }
+
+    if (cfg->filter & JOYSTICK_FILTER_IIR) {
+        int32_t* acc = &cfg->filter_acc[axis];
+        if (cfg->filter_count == 0) {
+            *acc = (int32_t)sample << 8;  // Start at the first sample, not at 0
+        } else {
+            *acc += (((int32_t)sample << 8) - *acc) >> cfg->filter_strength;
+        }
+        sample = (uint16_t)((*acc + 128) >> 8);
+    }
+    return sample;
+}
+
+/**
+ * @brief Whether a stick needs the DMA transfer-complete interrupt for its own use
+ */
+static uint8_t Joystick_StickIRQ(const Joystick_cfg_t* cfg)
+{
+    return cfg->sample_timestamps || cfg->events != NULL;
+}
+
+/**
+ * @brief Whether each pass of the sequence needs the DMA transfer-complete interrupt
+ * 
+ * @details In a scan, if any of its sticks needs it.
+ */
+static uint8_t Joystick_SampleIRQ(const Joystick_cfg_t* cfg)
+{
+    if (cfg->scan == NULL) {
+        return Joystick_StickIRQ(cfg);
+    }
+    for (uint8_t i = 0; i < cfg->scan->count; i++) {
+        if (Joystick_StickIRQ(cfg->scan->sticks[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief The latest X and Y conversions of a stick sampled by DMA
+ */
+static volatile uint16_t* Joystick_Samples(Joystick_cfg_t* cfg)
+{
+    return (cfg->scan != NULL) ? &cfg->scan->samples[cfg->scan_slot] : cfg->dma_samples;
+}
+
+/**
+ * @brief Number of conversions in a pass of the sequence a stick is sampled in
+ */
+static uint16_t Joystick_SequenceLength(const Joystick_cfg_t* cfg)
+{
+    return (cfg->scan != NULL) ? (uint16_t)(2u * cfg->scan->count) : 2u;
+}
+
+/**
+ * @brief Point the DMA channel at the ADC data register, circular into a buffer
+ * 
+ * @param adc ADC handle
+ * @param channel DMA channel, claimed with the ADC1 request routed to it
+ * @param buffer One halfword per conversion in the sequence
+ * @param length Number of conversions in the sequence
+ * @param tcie 1 to interrupt after each pass of the sequence
+ */
+static void Joystick_StartDMA(ADC_HandleTypeDef* adc, DMA_Channel_TypeDef* channel,
+                              volatile uint16_t* buffer, uint16_t length, uint8_t tcie)
+{
+    channel->CCR = 0;
+    channel->CPAR = (uint32_t)&adc->Instance->DR;
+    channel->CMAR = (uint32_t)buffer;
+    channel->CNDTR = length;
+    // 16-bit peripheral to memory, increment memory, wrap back to the first X after the last Y
+    channel->CCR = DMA_CCR_PL_0 | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 | DMA_CCR_MINC | DMA_CCR_CIRC |
+                   (tcie ? DMA_CCR_TCIE : 0) | DMA_CCR_EN;
+    if (tcie) {
+        // Below the LCD's DMA (priority 1): a late timestamp only costs a few cycles of accuracy
+        IRQn_Type irqn = DmaChannel_IRQn(channel);
+        NVIC_SetPriority(irqn, 3);
+        NVIC_EnableIRQ(irqn);
+    }
+
+    // HAL_ADC_Init() set circular DMA requests (DMACFG); enable them and start converting
+    SET_BIT(adc->Instance->CFGR, ADC_CFGR_DMAEN);
+    HAL_ADC_Start(adc);
+}
+
+/**
+ * @brief Classify the latest DMA pair and queue the events it causes
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * @param cycles DWT cycle count the pair completed at
+ */
+static void Joystick_QueueEvents(Joystick_cfg_t* cfg, uint32_t cycles)
+{
+    volatile uint16_t* samples = Joystick_Samples(cfg);
+    int16_t x = (int16_t)(samples[0] - cfg->center_x);
+    int16_t y = (int16_t)(samples[1] - cfg->center_y);
+    if (abs(x) < cfg->deadzone) {
+        x = 0;
+    }
+    if (abs(y) < cfg->deadzone) {
+        y = 0;
+    }
+    const Direction direction = Joystick_GetDirectionFast(x, y, cfg->center_x, cfg->center_y);
+
+    // A change is reported once it has held for JOYSTICK_EVENT_SAMPLES pairs, stamped
+    // with the first of them
+    if (direction == cfg->event_direction) {
+        cfg->event_candidate_count = 0;
+    } else {
+        if (direction != cfg->event_candidate || cfg->event_candidate_count == 0) {
+            cfg->event_candidate = direction;
+            cfg->event_candidate_count = 0;
+            cfg->event_candidate_cycles = cycles;
+        }
+        if (++cfg->event_candidate_count >= JOYSTICK_EVENT_SAMPLES) {
+            EventQueue_Push(cfg->events, JOYSTICK_EVENT_LEAVE, cfg->event_direction, cfg->event_candidate_cycles);
+            EventQueue_Push(cfg->events, JOYSTICK_EVENT_ENTER, direction, cfg->event_candidate_cycles);
+            cfg->event_direction = direction;
+            cfg->event_candidate_count = 0;
+        }
+    }
+
+    if (cfg->event_threshold == 0) {
+        return;
+    }
+    uint16_t magnitude = 0;
+    if (direction != CENTRE) {
+        const int32_t ax = abs(Joystick_NormaliseFast(x, cfg->center_x));
+        const int32_t ay = abs(Joystick_NormaliseFast(y, cfg->center_y));
+        magnitude = (uint16_t)Joystick_MagnitudeFast(ax, ay);
+    }
+    // Released 1/8 below the threshold, so a stick held at the threshold doesn't chatter
+    if (!cfg->event_pushed) {
+        if (magnitude >= cfg->event_threshold) {
+            cfg->event_pushed = 1;
+            cfg->event_peak = magnitude;
+            EventQueue_Push(cfg->events, JOYSTICK_EVENT_PUSH, magnitude, cycles);
+        }
+    } else if (magnitude < cfg->event_threshold - cfg->event_threshold / 8u) {
+        cfg->event_pushed = 0;
+        EventQueue_Push(cfg->events, JOYSTICK_EVENT_RELEASE, cfg->event_peak, cycles);
+    } else if (magnitude > cfg->event_peak) {
+        cfg->event_peak = magnitude;
+    }
+}
+
+void Joystick_DMA_IRQHandler(Joystick_cfg_t* cfg)
+{
+    DMA_Channel_TypeDef* channel = cfg->dma_channel;
+    DmaChannel_Controller(channel)->IFCR = DMA_IFCR_CGIF1 << DmaChannel_Flag_Shift(channel);
+    const uint32_t cycles = DWT->CYCCNT;
+    cfg->sample_cycles = cycles;
+    if (cfg->events != NULL) {
+        Joystick_QueueEvents(cfg, cycles);
+    }
+}
+
+void Joystick_Scan_DMA_IRQHandler(Joystick_Scan_t* scan)
+{
+    DMA_Channel_TypeDef* channel = scan->dma_channel;
+    DmaChannel_Controller(channel)->IFCR = DMA_IFCR_CGIF1 << DmaChannel_Flag_Shift(channel);
+    const uint32_t cycles = DWT->CYCCNT;
+    for (uint8_t i = 0; i < scan->count; i++) {
+        Joystick_cfg_t* cfg = scan->sticks[i];
+        cfg->sample_cycles = cycles;
+        if (cfg->events != NULL) {
+            Joystick_QueueEvents(cfg, cycles);
+        }
+    }
+}
+
+/**
+ * @brief Stop regular conversions and wait until the ADC has stopped
+ */
+static void Joystick_StopADC(ADC_TypeDef* adc)
+{
+    if (LL_ADC_REG_IsConversionOngoing(adc)) {
+        LL_ADC_REG_StopConversion(adc);
+        while (LL_ADC_REG_IsConversionOngoing(adc)) {
+        }
+    }
+}
+
+/**
+ * @brief Rewind the circular DMA to the first X (the scan restarts there after a stop)
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * @param tcie 1 to enable the transfer-complete interrupt
+ */
+static void Joystick_RestartDMA(Joystick_cfg_t* cfg, uint8_t tcie)
+{
+    DMA_Channel_TypeDef* channel = cfg->dma_channel;
+    channel->CCR &= ~DMA_CCR_EN;
+    channel->CNDTR = Joystick_SequenceLength(cfg);
+    channel->CCR = (channel->CCR & ~DMA_CCR_TCIE) | (tcie ? DMA_CCR_TCIE : 0) | DMA_CCR_EN;
+}
+
+/**
+ * @brief Analog watchdog 2/3 threshold register for center ± deadzone
+ * 
+ * @param center Center in ADC units
+ * @param deadzone Deadzone in ADC units
+ * @param scale Watchdog value = sample << scale >> 4 (see Joystick_Wait_For_Input())
+ * @return TR2/TR3 value: 8-bit high threshold in [23:16], low threshold in [7:0]
+ */
+static uint32_t Joystick_WakeupWindow(int32_t center, int32_t deadzone, uint32_t scale)
+{
+    // The 8-bit thresholds are compared with the top 8 bits of the 12-bit watchdog value
+    int32_t low = ((center - deadzone) << scale) >> 8;
+    int32_t high = ((center + deadzone) << scale) >> 8;
+    if (low < 0) low = 0;
+    if (high > 255) high = 255;
+    return ((uint32_t)high << ADC_TR2_HT2_Pos) | (uint32_t)low;
+}
+
+void Joystick_Wait_For_Input(Joystick_cfg_t* cfg)
+{
+    if (cfg->dma_channel == NULL) {
+        Joystick_t data;
+        do {
+            __WFI();
+            Joystick_Read(cfg, &data);
+        } while (data.x_processed == 0 && data.y_processed == 0);
+        return;
+    }
+
+    ADC_TypeDef* adc = cfg->adc->Instance;
+    Joystick_StopADC(adc);
+
+    // With oversampling on, the watchdog compares DR[15:4] whatever the shift, so the
+    // average has to sit in the top bits: shift the sum to 16 bits (ratio 16 and up),
+    // or not at all (smaller ratios, where the sum is narrower than 16 bits)
+    uint32_t cfgr2 = adc->CFGR2;
+    uint32_t scale = 4;
+    if (cfgr2 & ADC_CFGR2_ROVSE) {
+        uint32_t log2_ratio = ((cfgr2 & ADC_CFGR2_OVSR) >> ADC_CFGR2_OVSR_Pos) + 1;
+        scale = (log2_ratio < 4) ? log2_ratio : 4;
+        adc->CFGR2 = (cfgr2 & ~ADC_CFGR2_OVSS) | ((log2_ratio - scale) << ADC_CFGR2_OVSS_Pos);
+    }
+    adc->TR2 = Joystick_WakeupWindow(cfg->center_x, cfg->deadzone, scale);
+    adc->TR3 = Joystick_WakeupWindow(cfg->center_y, cfg->deadzone, scale);
+    adc->AWD2CR = 1u << __LL_ADC_CHANNEL_TO_DECIMAL_NB(cfg->x_channel);
+    adc->AWD3CR = 1u << __LL_ADC_CHANNEL_TO_DECIMAL_NB(cfg->y_channel);
+    adc->ISR = ADC_ISR_AWD2 | ADC_ISR_AWD3;
+    cfg->wakeup = 0;
+    adc->IER |= ADC_IER_AWD2IE | ADC_IER_AWD3IE;
+
+    IRQn_Type irqn = (adc == ADC3) ? ADC3_IRQn : ADC1_2_IRQn;
+    NVIC_SetPriority(irqn, 3);
+    NVIC_EnableIRQ(irqn);
+
+    // No timestamp interrupts while asleep, they would wake the core on every sample
+    Joystick_RestartDMA(cfg, 0);
+    LL_ADC_REG_StartConversion(adc);
+
+    // Interrupts are masked around the check so a wake-up landing between the test
+    // and WFI still wakes the core (as in FrameTimer_Wait())
+    HAL_SuspendTick();
+    __disable_irq();
+    while (!cfg->wakeup) {
+        __WFI();
+        __enable_irq();
+        __disable_irq();
+    }
+    __enable_irq();
+    HAL_ResumeTick();
+
+    // Back to normal sampling. The samples taken while waiting were scaled
+    // differently, so read as centered until the next pair arrives
+    Joystick_StopADC(adc);
+    adc->CFGR2 = cfgr2;
+    adc->AWD2CR = 0;
+    adc->AWD3CR = 0;
+    Joystick_Resume(cfg);
+}
+
+void Joystick_Pause(Joystick_cfg_t* cfg)
+{
+    if (cfg->dma_channel != NULL) {
+        Joystick_StopADC(cfg->adc->Instance);
+    }
+}
+
+void Joystick_Resume(Joystick_cfg_t* cfg)
+{
+    if (cfg->dma_channel == NULL) {
+        return;
+    }
+    // Read as centered until the first new pair arrives; a scan restarts every stick in it
+    const uint8_t count = (cfg->scan != NULL) ? cfg->scan->count : 1;
+    for (uint8_t i = 0; i < count; i++) {
+        Joystick_cfg_t* stick = (cfg->scan != NULL) ? cfg->scan->sticks[i] : cfg;
+        volatile uint16_t* samples = Joystick_Samples(stick);
+        samples[0] = stick->center_x;
+        samples[1] = stick->center_y;
+        stick->filter_count = 0;
+        stick->rest_primed = 0;
+    }
+    Joystick_RestartDMA(cfg, Joystick_SampleIRQ(cfg));
+    LL_ADC_REG_StartConversion(cfg->adc->Instance);
+}
+
+void Joystick_ADC_IRQHandler(Joystick_cfg_t* cfg)
+{
+    ADC_TypeDef* adc = cfg->adc->Instance;
+    if (adc->ISR & (ADC_ISR_AWD2 | ADC_ISR_AWD3)) {
+        // One wake-up per wait: the stick stays out of the window for many conversions
+        adc->IER &= ~(ADC_IER_AWD2IE | ADC_IER_AWD3IE);
+        adc->ISR = ADC_ISR_AWD2 | ADC_ISR_AWD3;
+        cfg->wakeup = 1;
+    }
+}
+
+/**
+ * @brief Get one raw X and Y reading
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * @param x Set to the raw X value
+ * @param y Set to the raw Y value
+ */
+static void Joystick_ReadRaw(Joystick_cfg_t* cfg, uint16_t* x, uint16_t* y)
+{
+    if (cfg->dma_channel != NULL) {
+        // Continuous mode: latest samples, no waiting
+        volatile uint16_t* samples = Joystick_Samples(cfg);
+        *x = samples[0];
+        *y = samples[1];
+        return;
+    }
+
+    // Read X channel (use cached config, only change channel)
+    cfg->adc_config.Channel = cfg->x_channel;
+    HAL_ADC_ConfigChannel(cfg->adc, &cfg->adc_config);
+    
+    HAL_ADC_Start(cfg->adc);
+    HAL_ADC_PollForConversion(cfg->adc, HAL_MAX_DELAY);
+    *x = HAL_ADC_GetValue(cfg->adc);
+    HAL_ADC_Stop(cfg->adc);
+    
+    // Read Y channel (use cached config, only change channel)
+    cfg->adc_config.Channel = cfg->y_channel;
+    HAL_ADC_ConfigChannel(cfg->adc, &cfg->adc_config);
+    
+    HAL_ADC_Start(cfg->adc);
+    HAL_ADC_PollForConversion(cfg->adc, HAL_MAX_DELAY);
+    *y = HAL_ADC_GetValue(cfg->adc);
+    HAL_ADC_Stop(cfg->adc);
+}
+
+/**
+ * @brief Start a stick's filters, center tracking and events afresh
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ */
+static void Joystick_ResetState(Joystick_cfg_t* cfg)
+{
+    cfg->filter_count = 0;
+    cfg->rest_primed = 0;
+    cfg->center_count = 0;
+    cfg->center_acc[0] = (int32_t)cfg->center_x << 8;
+    cfg->center_acc[1] = (int32_t)cfg->center_y << 8;
+    cfg->event_direction = CENTRE;
+    cfg->event_candidate_count = 0;
+    cfg->event_pushed = 0;
+}
+
+/**
+ * @brief Fill in the cached ADC channel configuration (the fields that never change)
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ */
+static void Joystick_InitChannelConfig(Joystick_cfg_t* cfg)
+{
+    cfg->adc_config.Rank = ADC_REGULAR_RANK_1;
+    cfg->adc_config.SamplingTime = cfg->sampling_time;
+    cfg->adc_config.SingleDiff = ADC_SINGLE_ENDED;
+    cfg->adc_config.OffsetNumber = ADC_OFFSET_NONE;
+    cfg->adc_config.Offset = 0;
+}
+
 void Joystick_Init(Joystick_cfg_t* cfg)
 {
     // Initialize ADC if not already done
     if (!cfg->setup_done) {
+        // Sampled by polling instead if the channel is taken
+        if (cfg->dma_channel != NULL &&
+            DmaChannel_Claim(cfg->dma_channel, JOYSTICK_DMA_REQUEST_ADC1, cfg, "Joystick ADC") != DMACHANNEL_OK) {
+            cfg->dma_channel = NULL;
+        }
+        if (cfg->dma_channel != NULL || cfg->oversampling > 1) {
+            Joystick_InitADC(cfg->adc, cfg->oversampling, (cfg->dma_channel != NULL) ? 2 : 0);
+        }
+        cfg->scan = NULL;
+        Joystick_ResetState(cfg);
+        
         // Perform ADC calibration
         HAL_ADCEx_Calibration_Start(cfg->adc, ADC_SINGLE_ENDED);
         
         // Initialize cached ADC configuration (set fields that never change)
-        cfg->adc_config.Rank = ADC_REGULAR_RANK_1;
-        cfg->adc_config.SamplingTime = cfg->sampling_time;
-        cfg->adc_config.SingleDiff = ADC_SINGLE_ENDED;
-        cfg->adc_config.OffsetNumber = ADC_OFFSET_NONE;
-        cfg->adc_config.Offset = 0;
+        Joystick_InitChannelConfig(cfg);
         
         // Configure both channels with the same settings
         cfg->adc_config.Channel = cfg->x_channel;
         HAL_ADC_ConfigChannel(cfg->adc, &cfg->adc_config);
         
+        // In continuous mode Y is the second conversion of the scan
         cfg->adc_config.Channel = cfg->y_channel;
+        if (cfg->dma_channel != NULL) {
+            cfg->adc_config.Rank = ADC_REGULAR_RANK_2;
+        }
         HAL_ADC_ConfigChannel(cfg->adc, &cfg->adc_config);
+        cfg->adc_config.Rank = ADC_REGULAR_RANK_1;
+        
+        if (cfg->dma_channel != NULL) {
+            cfg->dma_samples[0] = JOYSTICK_DEFAULT_CENTER_X;
+            cfg->dma_samples[1] = JOYSTICK_DEFAULT_CENTER_Y;
+            Joystick_StartDMA(cfg->adc, cfg->dma_channel, cfg->dma_samples, 2, Joystick_SampleIRQ(cfg));
+        }
         
         cfg->setup_done = 1;
     }
 }
 
+void Joystick_Scan_Init(Joystick_Scan_t* scan)
+{
+    if (scan->setup_done || scan->count == 0 || scan->count > JOYSTICK_SCAN_MAX_STICKS) {
+        return;
+    }
+    for (uint8_t i = 0; i < scan->count; i++) {
+        Joystick_cfg_t* cfg = scan->sticks[i];
+        cfg->adc = scan->adc;
+        cfg->sampling_time = scan->sampling_time;
+        cfg->oversampling = scan->oversampling;
+        cfg->dma_channel = NULL;
+    }
+
+    // Each stick polls the shared ADC in turn instead if the channel is taken
+    if (scan->dma_channel == NULL ||
+        DmaChannel_Claim(scan->dma_channel, JOYSTICK_DMA_REQUEST_ADC1, scan, "Joystick scan") != DMACHANNEL_OK) {
+        for (uint8_t i = 0; i < scan->count; i++) {
+            Joystick_Init(scan->sticks[i]);
+        }
+        scan->setup_done = 1;
+        return;
+    }
+
+    Joystick_InitADC(scan->adc, scan->oversampling, (uint8_t)(2u * scan->count));
+    HAL_ADCEx_Calibration_Start(scan->adc, ADC_SINGLE_ENDED);
+
+    // X then Y of each stick, in the order of sticks[]
+    for (uint8_t i = 0; i < scan->count; i++) {
+        Joystick_cfg_t* cfg = scan->sticks[i];
+        cfg->scan = scan;
+        cfg->scan_slot = (uint8_t)(2u * i);
+        cfg->dma_channel = scan->dma_channel;
+        Joystick_ResetState(cfg);
+        Joystick_InitChannelConfig(cfg);
+
+        cfg->adc_config.Channel = cfg->x_channel;
+        cfg->adc_config.Rank = joystick_ranks[cfg->scan_slot];
+        HAL_ADC_ConfigChannel(scan->adc, &cfg->adc_config);
+        cfg->adc_config.Channel = cfg->y_channel;
+        cfg->adc_config.Rank = joystick_ranks[cfg->scan_slot + 1];
+        HAL_ADC_ConfigChannel(scan->adc, &cfg->adc_config);
+        cfg->adc_config.Rank = ADC_REGULAR_RANK_1;
+
+        scan->samples[cfg->scan_slot] = JOYSTICK_DEFAULT_CENTER_X;
+        scan->samples[cfg->scan_slot + 1] = JOYSTICK_DEFAULT_CENTER_Y;
+        cfg->setup_done = 1;
+    }
+
+    Joystick_StartDMA(scan->adc, scan->dma_channel, scan->samples, (uint16_t)(2u * scan->count),
+                      Joystick_SampleIRQ(scan->sticks[0]));
+    scan->setup_done = 1;
+}
+
 void Joystick_Calibrate(Joystick_cfg_t* cfg)
 {
     // Take multiple readings and average them to find center position
@@ -64,23 +707,10 @@ void Joystick_Calibrate(Joystick_cfg_t* cfg)
     const int calibration_samples = 50;
     
     for (int i = 0; i < calibration_samples; i++) {
-        // Read X channel (use cached config, only change channel)
-        cfg->adc_config.Channel = cfg->x_channel;
-        HAL_ADC_ConfigChannel(cfg->adc, &cfg->adc_config);
-        
-        HAL_ADC_Start(cfg->adc);
-        HAL_ADC_PollForConversion(cfg->adc, HAL_MAX_DELAY);
-        x_sum += HAL_ADC_GetValue(cfg->adc);
-        HAL_ADC_Stop(cfg->adc);
-        
-        // Read Y channel (use cached config, only change channel)
-        cfg->adc_config.Channel = cfg->y_channel;
-        HAL_ADC_ConfigChannel(cfg->adc, &cfg->adc_config);
-        
-        HAL_ADC_Start(cfg->adc);
-        HAL_ADC_PollForConversion(cfg->adc, HAL_MAX_DELAY);
-        y_sum += HAL_ADC_GetValue(cfg->adc);
-        HAL_ADC_Stop(cfg->adc);
+        uint16_t x, y;
+        Joystick_ReadRaw(cfg, &x, &y);
+        x_sum += x;
+        y_sum += y;
         
         HAL_Delay(10);  // Small delay between samples
     }
@@ -92,27 +722,27 @@ void Joystick_Calibrate(Joystick_cfg_t* cfg)
 
 void Joystick_Read(Joystick_cfg_t* cfg, Joystick_t* data)
 {
-    // Read X-axis value (use cached config, only change channel)
-    cfg->adc_config.Channel = cfg->x_channel;
-    HAL_ADC_ConfigChannel(cfg->adc, &cfg->adc_config);
-    
-    HAL_ADC_Start(cfg->adc);
-    HAL_ADC_PollForConversion(cfg->adc, HAL_MAX_DELAY);
-    data->x_raw = HAL_ADC_GetValue(cfg->adc);
-    HAL_ADC_Stop(cfg->adc);
+    data->sample_cycles = cfg->sample_cycles;
+    Joystick_ReadRaw(cfg, &data->x_raw, &data->y_raw);
     
-    // Read Y-axis value (use cached config, only change channel)
-    cfg->adc_config.Channel = cfg->y_channel;
-    HAL_ADC_ConfigChannel(cfg->adc, &cfg->adc_config);
+    // Filter ahead of everything else, so the deadzone sees a steady value
+    uint16_t x = data->x_raw;
+    uint16_t y = data->y_raw;
+    if (cfg->filter != JOYSTICK_FILTER_NONE) {
+        x = Joystick_Filter(cfg, 0, x);
+        y = Joystick_Filter(cfg, 1, y);
+        if (cfg->filter_count < 3) {
+            cfg->filter_count++;
+        }
+    }
     
-    HAL_ADC_Start(cfg->adc);
-    HAL_ADC_PollForConversion(cfg->adc, HAL_MAX_DELAY);
-    data->y_raw = HAL_ADC_GetValue(cfg->adc);
-    HAL_ADC_Stop(cfg->adc);
+    if (cfg->auto_center) {
+        Joystick_TrackCenter(cfg, x, y);
+    }
     
-    // Process raw values using calibrated center from config
-    data->x_processed = data->x_raw - cfg->center_x;
-    data->y_processed = data->y_raw - cfg->center_y;
+    // Process filtered values using calibrated center from config
+    data->x_processed = x - cfg->center_x;
+    data->y_processed = y - cfg->center_y;
     
     // Apply deadzone from config
     if (abs(data->x_processed) < cfg->deadzone) {
@@ -122,6 +752,21 @@ void Joystick_Read(Joystick_cfg_t* cfg, Joystick_t* data)
         data->y_processed = 0;
     }
     
+    if (cfg->direction_only) {
+        // Integer fast path: the direction is all most games need
+        data->direction = Joystick_GetDirectionFast(data->x_processed, data->y_processed,
+                                                    cfg->center_x, cfg->center_y);
+        int32_t ax = abs(Joystick_NormaliseFast(data->x_processed, cfg->center_x));
+        int32_t ay = abs(Joystick_NormaliseFast(data->y_processed, cfg->center_y));
+        data->magnitude = (data->direction == CENTRE) ? 0.0f
+                        : (float)Joystick_MagnitudeFast(ax, ay) / JOYSTICK_FAST_ONE;
+        // N = 1, NE = 2, ... clockwise in 45 degree steps
+        data->angle = (data->direction == CENTRE) ? -1.0f : 45.0f * (data->direction - N);
+        data->coord.x = data->coord.y = 0.0f;
+        data->coord_mapped = data->coord;
+        return;
+    }
+    
     // Get raw cartesian coordinates (normalized -1.0 to 1.0)
     data->coord = Joystick_GetCoord(data->x_processed, data->y_processed, cfg->center_x, cfg->center_y);
     
@@ -165,6 +810,38 @@ Direction Joystick_GetDirection(float angle, float magnitude)
     else return NW;
 }
 
+Direction Joystick_GetDirectionFast(int16_t x, int16_t y, uint16_t center_x, uint16_t center_y)
+{
+    // Same axes as Joystick_GetCoord(): +X is East, ADC Y is inverted so -Y is North
+    int32_t east = Joystick_NormaliseFast(x, center_x);
+    int32_t north = -Joystick_NormaliseFast(y, center_y);
+
+    // Squared circle mapping, as Joystick_MapToCircle() but without the sqrt:
+    // x'^2 = x^2 * (1 - y^2/2), y'^2 = y^2 * (1 - x^2/2)   (Q24 * Q24 = Q48)
+    int64_t x2 = (int64_t)east * east;
+    int64_t y2 = (int64_t)north * north;
+    const int64_t one2 = (int64_t)JOYSTICK_FAST_ONE * JOYSTICK_FAST_ONE;
+    int64_t mx2 = (x2 * (one2 - y2 / 2)) >> 16;   // Q32
+    int64_t my2 = (y2 * (one2 - x2 / 2)) >> 16;
+
+    // Below 5% deflection: |v'|^2 < 0.05^2
+    if (mx2 + my2 < JOYSTICK_FAST_CENTRE_SQ_Q32) {
+        return CENTRE;
+    }
+
+    // Within 22.5 degrees of an axis: minor^2 < tan^2(22.5) * major^2
+    if ((mx2 << 16) < my2 * JOYSTICK_FAST_TAN2_22_5_Q16) {
+        return (north > 0) ? N : S;
+    }
+    if ((my2 << 16) < mx2 * JOYSTICK_FAST_TAN2_22_5_Q16) {
+        return (east > 0) ? E : W;
+    }
+    if (north > 0) {
+        return (east > 0) ? NE : NW;
+    }
+    return (east > 0) ? SE : SW;
+}
+
 // Convert processed ADC values to cartesian coordinates in range -1.0 to 1.0
 // Direction (x,y)
 // North     (0,1)
@@ -234,8 +911,13 @@ Vector2D Joystick_GetCoord(int16_t x, int16_t y, uint16_t center_x, uint16_t cen
  */
 Vector2D Joystick_MapToCircle(Vector2D coord)
 {
+#if JOYSTICK_FAST_MATH
+    float x = coord.x * Joystick_TableLookup(joystick_circle_scale, coord.y * coord.y);
+    float y = coord.y * Joystick_TableLookup(joystick_circle_scale, coord.x * coord.x);
+#else
     float x = coord.x * sqrtf(1.0f - (coord.y * coord.y) / 2.0f);
     float y = coord.y * sqrtf(1.0f - (coord.x * coord.x) / 2.0f);
+#endif
     
     Vector2D mapped = {x, y};
     return mapped;
@@ -285,6 +967,10 @@ Polar Joystick_GetPolar(Joystick_t* data)
     float x = data->coord_mapped.y;
     float y = data->coord_mapped.x;
     
+#if JOYSTICK_FAST_MATH
+    float mag = Joystick_Hypot(x, y);
+    float angle = Joystick_Atan2Deg(y, x);  // already 0 to 360
+#else
     float mag = sqrtf(x * x + y * y);  // Pythagorean theorem
     float angle = RAD2DEG * atan2f(y, x);
     
@@ -292,6 +978,7 @@ Polar Joystick_GetPolar(Joystick_t* data)
     if (angle < 0.0f) {
         angle += 360.0f;
     }
+#endif
     
     // If centered (deadzone already applied), mark angle as invalid
     if (mag < 0.01f) {  // Near-zero check for floating point
@@ -303,3 +990,32 @@ Polar Joystick_GetPolar(Joystick_t* data)
     return p;
 }
 
+float Joystick_Atan2Deg(float y, float x)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float hi = (ax > ay) ? ax : ay;
+    if (hi == 0.0f) {
+        return 0.0f;
+    }
+    float lo = (ax > ay) ? ay : ax;
+    
+    // First octant from the slope, then reflected out to the quadrant and the half plane
+    float angle = Joystick_TableLookup(joystick_atan_deg, lo / hi);
+    if (ay > ax) angle = 90.0f - angle;
+    if (x < 0.0f) angle = 180.0f - angle;
+    if (y < 0.0f) angle = 360.0f - angle;
+    return (angle >= 360.0f) ? 0.0f : angle;
+}
+
+float Joystick_Hypot(float x, float y)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float hi = (ax > ay) ? ax : ay;
+    if (hi == 0.0f) {
+        return 0.0f;
+    }
+    float lo = (ax > ay) ? ay : ax;
+    return hi * Joystick_TableLookup(joystick_secant, lo / hi);
+}
@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "main.h"
+#include "Joystick_Types.h"
+#include "EventQueue.h"
+#include "DmaBuffer.h"
 
 /**
  * @file joystick.h
@@ -31,6 +34,11 @@
  *     .center_x = JOYSTICK_DEFAULT_CENTER_X,
  *     .center_y = JOYSTICK_DEFAULT_CENTER_Y,
  *     .deadzone = JOYSTICK_DEADZONE,
+ *     .dma_channel = DMA1_Channel1,   // continuous sampling, or NULL to poll in Joystick_Read()
+ *     .oversampling = 256,            // average 256 conversions in hardware per sample
+ *     .filter = JOYSTICK_FILTER_MEDIAN | JOYSTICK_FILTER_IIR,
+ *     .filter_strength = 2,
+ *     .auto_center = 1,               // keep center_x/center_y calibrated while at rest
  *     .setup_done = 0
  * };
  * 
@@ -45,54 +53,16 @@
  * @endcode
  */
 
-// Inline types previously in pong_utils.h
-typedef enum {
-    CENTRE = 0,
-    N,
-    NE,
-    E,
-    SE,
-    S,
-    SW,
-    W,
-    NW
-} Direction;
-
-/**
- * @struct UserInput
- * @brief High-level joystick input representation for game/application logic
- * 
- * @details Convenient struct for getting the most commonly used joystick values:
- * - direction: 8-way discrete output for game controls (N, NE, E, SE, S, SW, W, NW, CENTRE)
- * - magnitude: 0.0->1.0 continuous value for speed/intensity control
- * - angle: 0-360° for applications needing fine directional control (or -1 if centered)
- */
-typedef struct {
-    Direction direction;    ///< 8-direction enum (N, NE, E, SE, S, SW, W, NW, CENTRE)
-    float magnitude;        ///< Magnitude 0.0 -> 1.0 (from circle-mapped coordinates)
-    float angle;            ///< Raw angle 0-360° for finer control (from circle-mapped coordinates), or -1 if centered
-} UserInput;
-
-// Cartesian coordinates (x, y in range -1.0 to 1.0)
-// Direction mapping: North=(0,1), East=(1,0), South=(0,-1), West=(-1,0)
-/**
- * @struct Vector2D
- * @brief Cartesian coordinates for joystick position
- */
-typedef struct {
-    float x;    ///< X-axis coordinate (-1.0 left to +1.0 right)
-    float y;    ///< Y-axis coordinate (-1.0 down to +1.0 up)
-} Vector2D;
-
-// Polar coordinates (magnitude and angle from circle-mapped coordinates)
+// Software filter stages, applied to the raw samples before centering (combine with |)
 /**
- * @struct Polar
- * @brief Polar coordinates from circle-mapped joystick position
+ * @enum Joystick_Filter_t
+ * @brief Filters run on each raw axis sample in Joystick_Read()
  */
-typedef struct {
-    float mag;      ///< Magnitude 0.0 -> 1.0 (from circle-mapped coordinates), or 0 if centered
-    float angle;    ///< Angle 0-360° (compass: 0°=North, 90°=East), or -1 if centered
-} Polar;
+typedef enum {
+    JOYSTICK_FILTER_NONE = 0,       ///< Use samples as converted
+    JOYSTICK_FILTER_MEDIAN = 1,     ///< Median of the last 3 samples (removes single-sample spikes)
+    JOYSTICK_FILTER_IIR = 2         ///< First-order low-pass, new = old + (sample - old) / 2^filter_strength
+} Joystick_Filter_t;
 
 // Joystick configuration defaults
 /**
@@ -104,10 +74,47 @@ typedef struct {
 #define JOYSTICK_DEFAULT_CENTER_Y 2048  ///< Default center position for Y-axis (12-bit ADC: 0-4095, midpoint=2048)
 #define JOYSTICK_DEADZONE 200           ///< Default deadzone radius around center (in ADC units, ~5% of max range)
 #define JOYSTICK_MAX_VALUE 4095         ///< Maximum 12-bit ADC value (used for normalization)
+#define JOYSTICK_MAX_OVERSAMPLING 256   ///< Largest hardware oversampling ratio
 /**
  * @}
  */
 
+// Input events, queued by Joystick_DMA_IRQHandler() when cfg->events is set
+/**
+ * @enum Joystick_Event_t
+ * @brief Event_t types the joystick pushes; data is always the DWT cycle count of the sample
+ */
+typedef enum {
+    JOYSTICK_EVENT_ENTER = 1,   ///< Stick moved into a direction (arg: Direction, CENTRE included)
+    JOYSTICK_EVENT_LEAVE,       ///< Stick moved out of a direction (arg: Direction), just before the next ENTER
+    JOYSTICK_EVENT_PUSH,        ///< Magnitude reached event_threshold (arg: magnitude, Q12)
+    JOYSTICK_EVENT_RELEASE      ///< Magnitude fell back below 7/8 of event_threshold (arg: peak magnitude while pushed, Q12)
+} Joystick_Event_t;
+
+#define JOYSTICK_EVENT_ONE 4096     ///< Full deflection in event magnitudes (Q12)
+
+// Samples in a row a new direction has to be seen in before it is reported, so noise
+// at a sector edge doesn't report a flurry of changes (one sample is ~1ms at 256x oversampling)
+#ifndef JOYSTICK_EVENT_SAMPLES
+#define JOYSTICK_EVENT_SAMPLES 3
+#endif
+
+// Square roots and the arctangent in Joystick_MapToCircle() and Joystick_GetPolar() from
+// interpolated tables (Joystick_Tables.h, see make_joystick_tables.py) instead of libm
+#ifndef JOYSTICK_FAST_MATH
+#define JOYSTICK_FAST_MATH 0
+#endif
+
+// Most sticks one Joystick_Scan_t samples: the ADC's regular sequence is 16 conversions long
+#ifndef JOYSTICK_SCAN_MAX_STICKS
+#define JOYSTICK_SCAN_MAX_STICKS 4
+#endif
+#if JOYSTICK_SCAN_MAX_STICKS > 8
+#error "JOYSTICK_SCAN_MAX_STICKS: an ADC sequence has room for 8 X/Y pairs"
+#endif
+
+struct Joystick_Scan;
+
 // Joystick configuration structure
 /**
  * @struct Joystick_cfg_t
@@ -124,10 +131,58 @@ typedef struct {
     uint16_t center_x;                  ///< Calibrated center ADC value for X (typically ~2048 for 12-bit)
     uint16_t center_y;                  ///< Calibrated center ADC value for Y (typically ~2048 for 12-bit)
     uint16_t deadzone;                  ///< Deadzone around center in ADC units (e.g., 200)
+    DMA_Channel_TypeDef* dma_channel;   ///< DMA channel for continuous sampling (ADC1: DMA1_Channel1 or DMA2_Channel3), or NULL to poll
+    uint16_t oversampling;              ///< Hardware oversampling ratio: 2 to 256 (power of 2), 0 or 1 for none
+    uint8_t filter;                     ///< Joystick_Filter_t stages to run (e.g. JOYSTICK_FILTER_MEDIAN | JOYSTICK_FILTER_IIR)
+    uint8_t filter_strength;            ///< IIR smoothing: 1 (light) to 4 (heavy); time constant is 2^n reads
+    uint8_t direction_only;             ///< 1: integer fast path, only direction/magnitude/angle are filled (see Joystick_GetDirectionFast())
+    uint8_t sample_timestamps;          ///< 1: DMA interrupt per X/Y pair records its DWT cycle count (continuous mode only)
+    uint8_t auto_center;                ///< 1: Joystick_Read() tracks center_x/center_y while the stick is at rest
+    EventQueue_t* events;               ///< Queue for direction and threshold events from the DMA interrupt, or NULL (continuous mode only)
+    uint16_t event_threshold;           ///< Magnitude for PUSH/RELEASE events (Q12, JOYSTICK_EVENT_ONE = full), 0 for none
     uint8_t setup_done;                 ///< Internal flag: 1 if initialized, 0 otherwise
     ADC_ChannelConfTypeDef adc_config;  ///< Cached ADC channel configuration (set during Init)
+    volatile uint16_t dma_samples[2] DMA_ALIGNED;   ///< Internal: latest X and Y conversions, written by DMA
+    struct Joystick_Scan* scan;         ///< Internal: scan this stick is sampled in (Joystick_Scan_Init()), or NULL
+    uint8_t scan_slot;                  ///< Internal: index of this stick's X in scan->samples, Y is next
+    volatile uint32_t sample_cycles;    ///< Internal: DWT->CYCCNT when the latest pair completed (sample_timestamps)
+    volatile uint8_t wakeup;            ///< Internal: set by Joystick_ADC_IRQHandler() when the stick leaves the deadzone
+    uint16_t filter_history[2][3];      ///< Internal: last 3 raw samples per axis (median filter)
+    int32_t filter_acc[2];              ///< Internal: IIR output per axis (Q8)
+    uint8_t filter_count;               ///< Internal: samples seen since Init, up to 3 (primes the filters)
+    int32_t rest_mean[2];               ///< Internal: short-term mean per axis (Q8), for the at-rest test
+    int32_t rest_var[2];                ///< Internal: short-term variance per axis (ADC units²)
+    int32_t center_acc[2];              ///< Internal: running center per axis (Q8)
+    uint8_t center_count;               ///< Internal: at-rest reads averaged so far, up to 2^JOYSTICK_CENTER_SHIFT
+    uint8_t rest_primed;                ///< Internal: 1 once rest_mean/rest_var hold a sample
+    uint8_t event_direction;            ///< Internal: last direction reported by an ENTER event
+    uint8_t event_candidate;            ///< Internal: direction seen in the latest samples, not yet reported
+    uint8_t event_candidate_count;      ///< Internal: samples in a row event_candidate has been seen
+    uint8_t event_pushed;               ///< Internal: 1 between a PUSH and its RELEASE
+    uint16_t event_peak;                ///< Internal: largest magnitude since the PUSH (Q12)
+    uint32_t event_candidate_cycles;    ///< Internal: DWT->CYCCNT of the first sample in event_candidate
 } Joystick_cfg_t;
 
+/**
+ * @struct Joystick_Scan_t
+ * @brief Several joysticks sampled by one ADC scan and one DMA channel
+ * 
+ * @details The X and Y channels of every stick are converted in one regular
+ * sequence, over and over, and the DMA writes each pass into samples. Each
+ * stick's Joystick_Read() picks its pair out of the buffer, so a stick costs
+ * two conversions in the sequence and nothing on the CPU.
+ */
+typedef struct Joystick_Scan {
+    ADC_HandleTypeDef* adc;                             ///< ADC all the sticks' channels are on (e.g., &hadc1)
+    DMA_Channel_TypeDef* dma_channel;                   ///< DMA channel serving the ADC (ADC1: DMA1_Channel1 or DMA2_Channel3)
+    uint32_t sampling_time;                             ///< ADC sampling time for every channel
+    uint16_t oversampling;                              ///< Hardware oversampling ratio, as Joystick_cfg_t
+    Joystick_cfg_t* sticks[JOYSTICK_SCAN_MAX_STICKS];   ///< Sticks in the scan, in sequence order
+    uint8_t count;                                      ///< Number of sticks (1 to JOYSTICK_SCAN_MAX_STICKS)
+    uint8_t setup_done;                                 ///< Internal flag: 1 if initialized, 0 otherwise
+    volatile uint16_t samples[2 * JOYSTICK_SCAN_MAX_STICKS] DMA_ALIGNED;  ///< Internal: X then Y of each stick, written by DMA
+} Joystick_Scan_t;
+
 // Joystick data structure - populated by Joystick_Read()
 /**
  * @struct Joystick_t
@@ -146,6 +201,7 @@ typedef struct {
     float angle;            ///< Angle 0-360° from circle-mapped coords (compass: 0°=North, 90°=East), or -1 if centered
     Direction direction;    ///< Discrete 8-direction output (N, NE, E, SE, S, SW, W, NW, CENTRE)
     float magnitude;        ///< Magnitude 0.0->1.0 from circle-mapped coords
+    uint32_t sample_cycles; ///< DWT cycle count when the ADC finished this sample (with cfg->sample_timestamps)
 } Joystick_t;
 
 // Function prototypes
@@ -161,13 +217,69 @@ typedef struct {
  * - Builds and caches ADC configuration struct for efficient channel switching
  * - Sets setup_done flag to prevent duplicate initialization
  * 
+ * With oversampling set, the ADC adds up that many conversions per sample and
+ * shifts the sum back to 12 bits: an average with no CPU cost. In polled mode
+ * each read then takes that many times longer.
+ * 
+ * With a dma_channel set, the ADC is instead set up to convert X and Y over
+ * and over as a two-channel scan, with the DMA writing each result into
+ * dma_samples in a circular buffer. No interrupts are used, unless
+ * sample_timestamps or events asks for one per pair. Use oversampling
+ * here too (256 keeps the DMA to a few thousand transfers a second instead of
+ * one a microsecond). The ADC then belongs to the joystick: other channels
+ * can no longer be converted on it.
+ * 
  * Call this once during system initialization before using Joystick_Read().
- * After Init, use Joystick_Calibrate() to find center position.
+ * After Init, use Joystick_Calibrate() to find center position, or set
+ * auto_center to have Joystick_Read() find it without blocking.
  * 
  * @note Must be called exactly once per joystick configuration
  */
 void Joystick_Init(Joystick_cfg_t* cfg);
 
+/**
+ * @brief Initialize several joysticks to be sampled by one background ADC scan
+ * 
+ * @param scan Pointer to scan configuration, with sticks[] and count filled in
+ * 
+ * @details Replaces Joystick_Init() for the sticks in the scan. Each stick's
+ * channels, center, deadzone, filters and the rest are set in its own
+ * Joystick_cfg_t as usual; its adc, dma_channel, sampling_time and
+ * oversampling are taken from the scan. The ADC is set up to convert X then Y
+ * of sticks[0], then of sticks[1], and so on in one regular sequence of
+ * 2 * count conversions, with the DMA writing each pass into scan->samples in
+ * a circular buffer. Joystick_Read() on any of the sticks then reads its pair
+ * from there without waiting.
+ * 
+ * Adding a stick adds two conversions to the pass (at 256x oversampling a
+ * pair takes about 1ms), so all sticks are sampled less often, not more
+ * expensively.
+ * 
+ * Joystick_Pause(), Joystick_Resume() and Joystick_Wait_For_Input() on a
+ * stick in the scan stop and restart the whole scan; Joystick_Resume()
+ * restarts the filters of every stick. The watchdog window of
+ * Joystick_Wait_For_Input() is that stick's: the others don't wake it.
+ * 
+ * If the DMA channel is already claimed each stick is polled instead, as
+ * Joystick_Init() does without a dma_channel.
+ * 
+ * @note With sample_timestamps or events on any stick, call
+ *       Joystick_Scan_DMA_IRQHandler() (not Joystick_DMA_IRQHandler()) from
+ *       the channel's IRQ handler.
+ */
+void Joystick_Scan_Init(Joystick_Scan_t* scan);
+
+/**
+ * @brief Joystick scan DMA interrupt handler (sample timestamps and input events)
+ * 
+ * @param scan Pointer to scan configuration
+ * 
+ * @details Raised once per pass of the sequence. Every stick's sample_cycles
+ * is set to the same cycle count, and each stick with events set has its pair
+ * classified, as Joystick_DMA_IRQHandler() does for one stick.
+ */
+void Joystick_Scan_DMA_IRQHandler(Joystick_Scan_t* scan);
+
 /**
  * @brief Calibrate joystick center position
  * 
@@ -179,7 +291,8 @@ void Joystick_Init(Joystick_cfg_t* cfg);
  * Should be called after Joystick_Init() while joystick is held in neutral position.
  * This calibration compensates for manufacturing variations and slight mechanical offsets.
  * 
- * @note Blocking operation (~500ms for 50 samples)
+ * @note Blocking operation (~500ms for 50 samples). For a calibration that
+ *       does not hold up start-up and follows drift, set cfg->auto_center instead.
  */
 void Joystick_Calibrate(Joystick_cfg_t* cfg);
 
@@ -191,19 +304,114 @@ void Joystick_Calibrate(Joystick_cfg_t* cfg);
  * 
  * @details Performs complete joystick processing:
  * - Reads raw ADC values for both X and Y axes
+ * - Runs the configured filter stages (median of 3, then IIR low-pass)
  * - Applies deadzone around center (values within deadzone → 0)
  * - Normalizes to Cartesian coordinates (-1.0 to 1.0)
  * - Applies circle mapping for uniform control feel
  * - Calculates polar coordinates (magnitude, angle)
  * - Determines 8-direction discrete output
  * 
+ * With cfg->auto_center set, each read whose short-term variance is low
+ * (the stick is not being moved) and which lies within the deadzone also moves
+ * the center toward it. The first 2^JOYSTICK_CENTER_SHIFT such reads are
+ * averaged evenly, so the center settles within about a second of boot. After
+ * that the center is an exponential moving average that follows slow drift.
+ * While settling, reads up to 4 deadzones away count, so a center that starts
+ * well off the default is still found.
+ * 
  * All fields in data struct are populated. Call this in your main loop
  * to update joystick state before reading individual fields.
  * 
- * @note Non-blocking operation (~200μs for two ADC conversions)
+ * With cfg->direction_only set, the float steps (normalising, circle mapping,
+ * sqrt and atan2) are skipped: direction comes from Joystick_GetDirectionFast(),
+ * angle is that direction's compass heading, magnitude is an integer estimate,
+ * and coord/coord_mapped are left at 0.
+ * 
+ * @note Polled mode waits for two ADC conversions (~200μs). With a dma_channel
+ *       the latest samples are already in memory, so there is no wait at all.
  */
 void Joystick_Read(Joystick_cfg_t* cfg, Joystick_t* data);
 
+/**
+ * @brief Joystick DMA interrupt handler (sample timestamps and input events)
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * 
+ * @details With cfg->sample_timestamps or cfg->events set, the DMA channel
+ * raises a transfer-complete interrupt each time it has written a new X/Y
+ * pair. Call this from that channel's IRQ handler: it records the DWT cycle
+ * counter in cfg->sample_cycles, for latency measurement. The DWT counter must
+ * already be running (CoreDebug TRCENA and DWT CYCCNTENA set).
+ * 
+ * With cfg->events set, it also classifies every pair (centre, deadzone and
+ * Joystick_GetDirectionFast(), no filters) and pushes a Joystick_Event_t when
+ * the direction or the threshold crossing changes. Joystick_Read() only sees
+ * the latest pair once a frame, so a flick that goes out and back between two
+ * reads is lost there but still queued here, stamped with the cycle count of
+ * the sample it started on. A direction change pushes LEAVE (old) then ENTER
+ * (new), after JOYSTICK_EVENT_SAMPLES pairs in a row agree on it. The
+ * interrupt is the queue's one producer: drain it from one place in the main
+ * loop. Events are dropped while the queue is full.
+ */
+void Joystick_DMA_IRQHandler(Joystick_cfg_t* cfg);
+
+/**
+ * @brief Sleep until the joystick is moved out of the deadzone
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * 
+ * @details For idle screens (paused, game over) where nothing else needs the CPU.
+ * With a dma_channel, the ADC's analog watchdogs 2 and 3 are armed on the X and
+ * Y channels with a window of center ± deadzone, and the core sleeps (WFI, with
+ * SysTick suspended) until a conversion lands outside the window and the ADC
+ * interrupt fires. The background scan keeps running, but the CPU is no longer
+ * woken every millisecond to poll it. The window has 8-bit resolution (16 ADC
+ * units), so the wake-up point is within 16 units of the deadzone edge.
+ * 
+ * Without a dma_channel nothing converts in the background, so the joystick is
+ * read on each SysTick wake-up instead.
+ * 
+ * Returns at once if the stick is already outside the deadzone. The filters
+ * restart afterwards (as after Joystick_Init()), and the sample timestamp
+ * interrupt is masked while waiting.
+ * 
+ * @note The ADC does not run in Stop modes, so this cannot go lower than Sleep.
+ * @note Requires Joystick_ADC_IRQHandler() in the ADC interrupt handler
+ *       (ADC1_2_IRQHandler for ADC1/ADC2, ADC3_IRQHandler for ADC3)
+ */
+void Joystick_Wait_For_Input(Joystick_cfg_t* cfg);
+
+/**
+ * @brief Stop the background conversions, e.g. while the ADC clock changes
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * 
+ * @details Waits for the conversion in progress to finish. Joystick_Read() keeps
+ * returning the last samples until Joystick_Resume(). Does nothing without a
+ * dma_channel (nothing converts in the background).
+ */
+void Joystick_Pause(Joystick_cfg_t* cfg);
+
+/**
+ * @brief Restart the background conversions stopped by Joystick_Pause()
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * 
+ * @details The scan starts again at X, and the filters restart (as after
+ * Joystick_Init()).
+ */
+void Joystick_Resume(Joystick_cfg_t* cfg);
+
+/**
+ * @brief Joystick ADC interrupt handler (analog watchdog wake-up)
+ * 
+ * @param cfg Pointer to joystick configuration struct
+ * 
+ * @details Sets cfg->wakeup and disarms the watchdog interrupts when either axis
+ * has left the deadzone. Call from the ADC's IRQ handler.
+ */
+void Joystick_ADC_IRQHandler(Joystick_cfg_t* cfg);
+
 // Data retrieval functions
 
 /**
@@ -280,4 +488,47 @@ Vector2D Joystick_MapToCircle(Vector2D coord);
  */
 Direction Joystick_GetDirection(float angle, float magnitude);
 
+/**
+ * @brief Get 8-direction output from processed values, integer maths only
+ * 
+ * @param x Processed X value (centered, deadzone applied)
+ * @param y Processed Y value (centered, deadzone applied)
+ * @param center_x Calibrated center position for X (scales X like Joystick_GetCoord())
+ * @param center_y Calibrated center position for Y
+ * @return Direction enum (N, NE, E, SE, S, SW, W, NW, or CENTRE)
+ * 
+ * @details Same result as Joystick_GetDirection() on the full pipeline, without
+ * trig, sqrt or float. The circle mapping is applied squared (x'^2, y'^2 need
+ * no sqrt), then the octant comes from comparing the squared slope against
+ * tan²(22.5°) cross-multiplied (no division), and the signs pick the quadrant.
+ * Returns CENTRE below 5% deflection, as Joystick_GetDirection() does.
+ */
+Direction Joystick_GetDirectionFast(int16_t x, int16_t y, uint16_t center_x, uint16_t center_y);
+
+/**
+ * @brief atan2(y, x) in degrees, 0-360, from the JOYSTICK_FAST_MATH tables
+ * 
+ * @param y Y component
+ * @param x X component
+ * @return Angle anticlockwise from +X in degrees (0 <= angle < 360), 0 for (0, 0)
+ * 
+ * @details The angle within the first octant is looked up from min(|x|,|y|)/max(|x|,|y|)
+ * and folded out by the signs and which component is larger. Within about 0.0012°
+ * of RAD2DEG * atan2f() at the default 64 segments (make_joystick_tables.py --check).
+ * Built whatever JOYSTICK_FAST_MATH is, so the two can be compared on the board.
+ */
+float Joystick_Atan2Deg(float y, float x);
+
+/**
+ * @brief sqrt(x² + y²) from the JOYSTICK_FAST_MATH tables
+ * 
+ * @param x X component
+ * @param y Y component
+ * @return Length of (x, y), within about 0.003% of sqrtf(x*x + y*y)
+ * 
+ * @details max(|x|,|y|) * sqrt(1 + (min/max)²), the square root looked up: one
+ * division and no sqrtf.
+ */
+float Joystick_Hypot(float x, float y);
+
 #endif /* JOYSTICK_H */
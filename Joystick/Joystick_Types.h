@@ -0,0 +1,60 @@
+#ifndef JOYSTICK_TYPES_H
+#define JOYSTICK_TYPES_H
+
+/**
+ * @file Joystick_Types.h
+ * @brief Joystick input types shared with the game logic
+ * 
+ * Kept apart from Joystick.h (which needs the STM32 HAL for the ADC) so code
+ * that only consumes input, like the game engine, builds without the HAL.
+ */
+
+typedef enum {
+    CENTRE = 0,
+    N,
+    NE,
+    E,
+    SE,
+    S,
+    SW,
+    W,
+    NW
+} Direction;
+
+/**
+ * @struct UserInput
+ * @brief High-level joystick input representation for game/application logic
+ * 
+ * @details Convenient struct for getting the most commonly used joystick values:
+ * - direction: 8-way discrete output for game controls (N, NE, E, SE, S, SW, W, NW, CENTRE)
+ * - magnitude: 0.0->1.0 continuous value for speed/intensity control
+ * - angle: 0-360° for applications needing fine directional control (or -1 if centered)
+ */
+typedef struct {
+    Direction direction;    ///< 8-direction enum (N, NE, E, SE, S, SW, W, NW, CENTRE)
+    float magnitude;        ///< Magnitude 0.0 -> 1.0 (from circle-mapped coordinates)
+    float angle;            ///< Raw angle 0-360° for finer control (from circle-mapped coordinates), or -1 if centered
+} UserInput;
+
+// Cartesian coordinates (x, y in range -1.0 to 1.0)
+// Direction mapping: North=(0,1), East=(1,0), South=(0,-1), West=(-1,0)
+/**
+ * @struct Vector2D
+ * @brief Cartesian coordinates for joystick position
+ */
+typedef struct {
+    float x;    ///< X-axis coordinate (-1.0 left to +1.0 right)
+    float y;    ///< Y-axis coordinate (-1.0 down to +1.0 up)
+} Vector2D;
+
+// Polar coordinates (magnitude and angle from circle-mapped coordinates)
+/**
+ * @struct Polar
+ * @brief Polar coordinates from circle-mapped joystick position
+ */
+typedef struct {
+    float mag;      ///< Magnitude 0.0 -> 1.0 (from circle-mapped coordinates), or 0 if centered
+    float angle;    ///< Angle 0-360° (compass: 0°=North, 90°=East), or -1 if centered
+} Polar;
+
+#endif // JOYSTICK_TYPES_H
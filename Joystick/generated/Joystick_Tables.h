@@ -0,0 +1,77 @@
+/**
+ * @file Joystick_Tables.h
+ * @brief Lookup tables for JOYSTICK_FAST_MATH (generated, do not edit)
+ *
+ * Written by make_joystick_tables.py --segments 64. Each table holds
+ * JOYSTICK_TABLE_SEGMENTS + 1 samples of [0, 1], interpolated linearly.
+ */
+
+#ifndef JOYSTICK_TABLES_H
+#define JOYSTICK_TABLES_H
+
+#define JOYSTICK_TABLE_SEGMENTS 64
+
+// atan(t) in degrees, t = min/max of |x|, |y|
+static const float joystick_atan_deg[JOYSTICK_TABLE_SEGMENTS + 1] = {
+    0.0f, 0.89517371f, 1.78991061f, 2.68377516f,
+    3.57633437f, 4.46715906f, 5.35582504f, 6.24191435f,
+    7.12501635f, 8.00472886f, 8.88065915f, 9.75242494f,
+    10.6196553f, 11.4819914f, 12.3390873f, 13.1906107f,
+    14.0362435f, 14.875682f, 15.7086378f, 16.5348379f,
+    17.3540246f, 18.1659565f, 18.9704078f, 19.7671687f,
+    20.5560452f, 21.3368593f, 22.1094483f, 22.8736652f,
+    23.6293777f, 24.3764686f, 25.1148349f, 25.8443876f,
+    26.5650512f, 27.2767634f, 27.9794744f, 28.6731465f,
+    29.3577535f, 30.0332804f, 30.6997226f, 31.3570852f,
+    32.0053832f, 32.6446401f, 33.274888f, 33.8961666f,
+    34.508523f, 35.1120112f, 35.7066914f, 36.2926297f,
+    36.8698976f, 37.4385716f, 37.9987324f, 38.5504653f,
+    39.0938589f, 39.6290053f, 40.1559996f, 40.6749396f,
+    41.1859252f, 41.6890585f, 42.1844433f, 42.6721849f,
+    43.1523897f, 43.6251652f, 44.0906196f, 44.5488615f,
+    45.0f,
+};
+
+// sqrt(1 + t^2): |(x, y)| = max * joystick_secant(min/max)
+static const float joystick_secant[JOYSTICK_TABLE_SEGMENTS + 1] = {
+    1.0f, 1.00012206f, 1.00048816f, 1.00109803f,
+    1.00195122f, 1.00304712f, 1.00438492f, 1.00596366f,
+    1.00778222f, 1.00983929f, 1.01213342f, 1.01466301f,
+    1.01742629f, 1.02042137f, 1.02364621f, 1.02709865f,
+    1.03077641f, 1.03467707f, 1.03879813f, 1.04313698f,
+    1.04769091f, 1.05245713f, 1.05743277f, 1.06261488f,
+    1.06800047f, 1.07358646f, 1.07936975f, 1.08534719f,
+    1.09151557f, 1.0978717f, 1.10441232f, 1.11113417f,
+    1.11803399f, 1.1251085f, 1.13235443f, 1.13976851f,
+    1.14734748f, 1.1550881f, 1.16298713f, 1.17104137f,
+    1.17924764f, 1.18760279f, 1.1961037f, 1.20474728f,
+    1.21353049f, 1.22245031f, 1.23150378f, 1.24068797f,
+    1.25f, 1.25943703f, 1.26899628f, 1.278675f,
+    1.28847051f, 1.29838015f, 1.30840134f, 1.31853153f,
+    1.32876823f, 1.33910899f, 1.34955143f, 1.3600932f,
+    1.37073201f, 1.38146562f, 1.39229184f, 1.40320852f,
+    1.41421356f,
+};
+
+// sqrt(1 - u/2), u = the other axis squared
+static const float joystick_circle_scale[JOYSTICK_TABLE_SEGMENTS + 1] = {
+    1.0f, 0.996086091f, 0.992156742f, 0.988211769f,
+    0.984250984f, 0.980274196f, 0.976281209f, 0.972271824f,
+    0.968245837f, 0.964203039f, 0.960143218f, 0.956066159f,
+    0.951971638f, 0.947859431f, 0.943729304f, 0.939581024f,
+    0.935414347f, 0.931229027f, 0.927024811f, 0.922801441f,
+    0.918558654f, 0.914296177f, 0.910013736f, 0.905711047f,
+    0.901387819f, 0.897043756f, 0.892678554f, 0.8882919f,
+    0.883883476f, 0.879452955f, 0.875f, 0.870524267f,
+    0.866025404f, 0.861503047f, 0.856956825f, 0.852386356f,
+    0.847791248f, 0.843171098f, 0.838525492f, 0.833854004f,
+    0.829156198f, 0.824431622f, 0.819679816f, 0.814900301f,
+    0.810092587f, 0.80525617f, 0.80039053f, 0.795495129f,
+    0.790569415f, 0.785612818f, 0.78062475f, 0.775604603f,
+    0.77055175f, 0.765465545f, 0.760345316f, 0.755190373f,
+    0.75f, 0.744773455f, 0.739509973f, 0.734208758f,
+    0.728868987f, 0.723489806f, 0.718070331f, 0.712609641f,
+    0.707106781f,
+};
+
+#endif /* JOYSTICK_TABLES_H */
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Generate Joystick_Tables.h, the lookup tables behind JOYSTICK_FAST_MATH.
+
+Joystick_MapToCircle() and Joystick_GetPolar() take their square roots and
+arctangent from three tables sampled at JOYSTICK_TABLE_SEGMENTS + 1 evenly
+spaced points of [0, 1] and interpolated linearly in between:
+
+    atan(t) in degrees          the angle within the first octant (t = min/max)
+    sqrt(1 + t * t)             so that |(x, y)| = max * sqrt(1 + (min/max)^2)
+    sqrt(1 - u / 2)             the circle mapping's scale, u = x^2 or y^2
+
+All three are smooth over [0, 1], which is what lets a short table with
+straight lines between its points stay close to libm: sqrt(u) itself is not
+(its slope is unbounded at 0), so the magnitude goes through the octant ratio
+rather than through x^2 + y^2.
+
+    python3 make_joystick_tables.py -o generated/Joystick_Tables.h
+    python3 make_joystick_tables.py --segments 128 -o generated/Joystick_Tables.h
+    python3 make_joystick_tables.py --check
+
+The build runs it (see CMakeLists.txt) when Python is found, at the
+JOYSTICK_TABLE_SEGMENTS cache variable, and builds without Python use the
+copy checked in at generated/Joystick_Tables.h. --check prints the
+largest error of the interpolated tables against Python's math module over a
+fine sweep, without writing anything.
+"""
+
+import argparse
+import math
+import sys
+
+DEFAULT_SEGMENTS = 64
+CHECK_SAMPLES = 100000
+
+TABLES = (
+    ("joystick_atan_deg", "atan(t) in degrees, t = min/max of |x|, |y|",
+     lambda t: math.degrees(math.atan(t))),
+    ("joystick_secant", "sqrt(1 + t^2): |(x, y)| = max * joystick_secant(min/max)",
+     lambda t: math.sqrt(1.0 + t * t)),
+    ("joystick_circle_scale", "sqrt(1 - u/2), u = the other axis squared",
+     lambda u: math.sqrt(1.0 - u / 2.0)),
+)
+
+
+def sample(function, segments):
+    return [function(i / segments) for i in range(segments + 1)]
+
+
+def lookup(table, t):
+    """The interpolation Joystick.c does, for t in [0, 1]."""
+    segments = len(table) - 1
+    position = t * segments
+    i = min(int(position), segments - 1)
+    return table[i] + (table[i + 1] - table[i]) * (position - i)
+
+
+def check(segments):
+    """Print the largest error of each table and of the angle/magnitude they make."""
+    tables = [sample(function, segments) for _, _, function in TABLES]
+    for (name, _, function), table in zip(TABLES, tables):
+        worst = max(abs(lookup(table, k / CHECK_SAMPLES) - function(k / CHECK_SAMPLES))
+                    for k in range(CHECK_SAMPLES + 1))
+        print("%-22s max error %.3g" % (name, worst))
+
+    # Angle and magnitude of points around the unit circle, against atan2 and hypot
+    worst_angle = worst_mag = 0.0
+    for k in range(CHECK_SAMPLES):
+        theta = 2.0 * math.pi * k / CHECK_SAMPLES
+        x, y = math.cos(theta), math.sin(theta)
+        hi, lo = max(abs(x), abs(y)), min(abs(x), abs(y))
+        ratio = lo / hi
+        mag = hi * lookup(tables[1], ratio)
+        angle = lookup(tables[0], ratio)
+        if abs(y) > abs(x):
+            angle = 90.0 - angle
+        if x < 0:
+            angle = 180.0 - angle
+        if y < 0:
+            angle = 360.0 - angle
+        expected = math.degrees(math.atan2(y, x)) % 360.0
+        error = abs(angle - expected)
+        worst_angle = max(worst_angle, min(error, 360.0 - error))
+        worst_mag = max(worst_mag, abs(mag - 1.0))
+    print("%-22s max error %.3g degrees" % ("angle", worst_angle))
+    print("%-22s max error %.3g" % ("magnitude", worst_mag))
+
+
+def c_float(value):
+    """A float literal that reads back as the same single-precision value."""
+    text = "%.9g" % value
+    if "." not in text and "e" not in text:
+        text += ".0"
+    return text + "f"
+
+
+def write_header(out, segments):
+    out.write("/**\n")
+    out.write(" * @file Joystick_Tables.h\n")
+    out.write(" * @brief Lookup tables for JOYSTICK_FAST_MATH (generated, do not edit)\n")
+    out.write(" *\n")
+    out.write(" * Written by make_joystick_tables.py --segments %d. Each table holds\n" % segments)
+    out.write(" * JOYSTICK_TABLE_SEGMENTS + 1 samples of [0, 1], interpolated linearly.\n")
+    out.write(" */\n\n")
+    out.write("#ifndef JOYSTICK_TABLES_H\n#define JOYSTICK_TABLES_H\n\n")
+    out.write("#define JOYSTICK_TABLE_SEGMENTS %d\n" % segments)
+    for name, comment, function in TABLES:
+        values = sample(function, segments)
+        out.write("\n// %s\n" % comment)
+        out.write("static const float %s[JOYSTICK_TABLE_SEGMENTS + 1] = {\n" % name)
+        for start in range(0, len(values), 4):
+            row = ", ".join(c_float(v) for v in values[start:start + 4])
+            out.write("    %s,\n" % row)
+        out.write("};\n")
+    out.write("\n#endif /* JOYSTICK_TABLES_H */\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", help="header to write (default: standard output)")
+    parser.add_argument("--segments", type=int, default=DEFAULT_SEGMENTS,
+                        help="straight lines each table is made of (default %d)" % DEFAULT_SEGMENTS)
+    parser.add_argument("--check", action="store_true", help="print the tables' accuracy against libm instead")
+    args = parser.parse_args()
+    if args.segments < 1:
+        parser.error("--segments must be at least 1")
+
+    if args.check:
+        check(args.segments)
+    elif args.output:
+        with open(args.output, "w", newline="\n") as out:
+            write_header(out, args.segments)
+    else:
+        write_header(sys.stdout, args.segments)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,388 @@
+#include "LCDBench.h"
+#include "PongEngine.h"
+#include "Fmt.h"
+#include "Joystick.h"
+#include "LCDBench_Sessions.h"
+#include "stm32l4xx_hal.h"
+#include <stdio.h>
+#include <math.h>
+
+/**
+ * @file LCDBench.c
+ * @brief Implementation of the LCD micro-benchmarks
+ *
+ * Each case runs its call LCDBENCH_ITERATIONS times and reports min/avg/max
+ * cycles per call. Drawing cases alternate between two colours, so every
+ * call really changes pixels, and the frame is refreshed before each case
+ * so earlier ones do not leave dirty rows behind for later ones.
+ *
+ * The banner names the compiler and optimisation level, so captures from the
+ * gcc-arm-none-eabi and starm-clang builds can be lined up by bench_compare.py.
+ *
+ * The recorded sessions run one frame a step, each step's update, draw and
+ * refresh timed apart, so their cases are per-frame costs over a real game
+ * rather than over one repeated call.
+ */
+
+#if defined(__clang__)
+#define LCDBENCH_COMPILER "clang " __clang_version__
+#elif defined(__GNUC__)
+#define LCDBENCH_COMPILER "gcc " __VERSION__
+#else
+#define LCDBENCH_COMPILER "unknown compiler"
+#endif
+
+#if defined(__OPTIMIZE_SIZE__)
+#define LCDBENCH_OPTIMISE "size"
+#elif defined(__OPTIMIZE__)
+#define LCDBENCH_OPTIMISE "speed"
+#else
+#define LCDBENCH_OPTIMISE "none"
+#endif
+
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t count;
+} LCDBench_Stat_t;
+
+// Engine the physics and drawing cases run on, set up like the game's in main.c
+static PongEngine_t bench_engine;
+
+// Journal the recorded sessions are played back from
+static Replay_t bench_replay;
+
+// 16x16 two-colour checkerboard with a transparent corner, filled in by LCDBench_Run()
+static uint8_t bench_sprite[16 * 16];
+
+static void stat_clear(LCDBench_Stat_t* stat)
+{
+    stat->min = UINT32_MAX;
+    stat->max = 0;
+    stat->total = 0;
+    stat->count = 0;
+}
+
+static void stat_add(LCDBench_Stat_t* stat, uint32_t cycles)
+{
+    if (cycles < stat->min) stat->min = cycles;
+    if (cycles > stat->max) stat->max = cycles;
+    stat->total += cycles;
+    stat->count++;
+}
+
+static void stat_print(const char* name, const LCDBench_Stat_t* stat)
+{
+    const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    uint32_t avg = (uint32_t)(stat->total / stat->count);
+    printf("%-24s %4lu %9lu %9lu %9lu %7lu\n", name, (unsigned long)stat->count,
+           (unsigned long)stat->min, (unsigned long)avg, (unsigned long)stat->max,
+           (unsigned long)(avg / cycles_per_us));
+}
+
+// Colour for iteration i, so consecutive calls draw different pixels
+static uint8_t bench_colour(uint32_t i)
+{
+    return (i & 1) ? 2 : 3;
+}
+
+static void bench_rect(ST7789V2_cfg_t* cfg, const char* name, uint16_t width, uint16_t height, uint8_t fill)
+{
+    LCDBench_Stat_t stat;
+    stat_clear(&stat);
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS; i++) {
+        uint32_t start = DWT->CYCCNT;
+        LCD_Draw_Rect(40, 40, width, height, bench_colour(i), fill);
+        stat_add(&stat, DWT->CYCCNT - start);
+    }
+    stat_print(name, &stat);
+    LCD_Refresh(cfg);
+}
+
+static void bench_circle(ST7789V2_cfg_t* cfg, const char* name, uint16_t radius, uint8_t fill)
+{
+    LCDBench_Stat_t stat;
+    stat_clear(&stat);
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS; i++) {
+        uint32_t start = DWT->CYCCNT;
+        LCD_Draw_Circle(120, 120, radius, bench_colour(i), fill);
+        stat_add(&stat, DWT->CYCCNT - start);
+    }
+    stat_print(name, &stat);
+    LCD_Refresh(cfg);
+}
+
+static void bench_string(ST7789V2_cfg_t* cfg, const char* name, uint8_t font_size)
+{
+    LCDBench_Stat_t stat;
+    stat_clear(&stat);
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS; i++) {
+        uint32_t start = DWT->CYCCNT;
+        LCD_printString("Score: 1234", 10, 100, bench_colour(i), font_size);
+        stat_add(&stat, DWT->CYCCNT - start);
+    }
+    stat_print(name, &stat);
+    LCD_Refresh(cfg);
+}
+
+static void bench_sprite_draw(ST7789V2_cfg_t* cfg)
+{
+    LCDBench_Stat_t stat;
+    stat_clear(&stat);
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS; i++) {
+        uint32_t start = DWT->CYCCNT;
+        LCD_Draw_Sprite(100 + (i & 1), 100, 16, 16, bench_sprite);
+        stat_add(&stat, DWT->CYCCNT - start);
+    }
+    stat_print("Draw_Sprite 16x16", &stat);
+    LCD_Refresh(cfg);
+}
+
+static void bench_fill(ST7789V2_cfg_t* cfg)
+{
+    LCDBench_Stat_t stat;
+    stat_clear(&stat);
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS; i++) {
+        uint32_t start = DWT->CYCCNT;
+        LCD_Fill_Buffer(bench_colour(i));
+        stat_add(&stat, DWT->CYCCNT - start);
+    }
+    stat_print("Fill_Buffer", &stat);
+    LCD_Refresh(cfg);
+}
+
+// Refresh with dirty_percent of the rows changed across their full width
+static void bench_refresh(ST7789V2_cfg_t* cfg, uint8_t dirty_percent)
+{
+    const uint16_t rows = (uint16_t)((ST7789V2_HEIGHT * dirty_percent + 99) / 100);
+    LCDBench_Stat_t stat;
+    stat_clear(&stat);
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS / 4; i++) {
+        // Spread the dirty rows over the screen, as moving objects would be
+        for (uint16_t r = 0; r < rows; r++) {
+            uint16_t y = (uint16_t)(((uint32_t)r * ST7789V2_HEIGHT) / (rows ? rows : 1));
+            LCD_Fill_Span(y, 0, ST7789V2_WIDTH - 1, bench_colour(i));
+        }
+        uint32_t start = DWT->CYCCNT;
+        LCD_Refresh(cfg);
+        stat_add(&stat, DWT->CYCCNT - start);
+    }
+    char name[24];
+    snprintf(name, sizeof(name), "Refresh %3u%% dirty", dirty_percent);
+    stat_print(name, &stat);
+}
+
+static void bench_engine_reset(void)
+{
+    PongEngine_Init(&bench_engine, 10, 100, 4, 40, 6, 8.0f);
+}
+
+// Physics steps with balls in play; the paddle sweeps up and down so it moves and hits
+static void bench_engine_update(ST7789V2_cfg_t* cfg, const char* name, uint8_t balls)
+{
+    LCDBench_Stat_t stat;
+    stat_clear(&stat);
+    bench_engine_reset();
+    while (PongEngine_GetBallCount(&bench_engine) < balls && PongEngine_SpawnBall(&bench_engine)) {
+    }
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS; i++) {
+        UserInput input = { .direction = ((i / 16) & 1) ? S : N, .magnitude = 1.0f, .angle = ((i / 16) & 1) ? 180.0f : 0.0f };
+        uint32_t start = DWT->CYCCNT;
+        uint8_t lives = PongEngine_Update(&bench_engine, input);
+        stat_add(&stat, DWT->CYCCNT - start);
+        if (lives == 0) {
+            bench_engine_reset();
+        }
+    }
+    stat_print(name, &stat);
+    LCD_Refresh(cfg);
+}
+
+static void bench_engine_draw(ST7789V2_cfg_t* cfg)
+{
+    static const UserInput centre = { .direction = CENTRE, .magnitude = 0.0f, .angle = -1.0f };
+    LCDBench_Stat_t stat;
+    stat_clear(&stat);
+    bench_engine_reset();
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS; i++) {
+        if (PongEngine_Update(&bench_engine, centre) == 0) {
+            bench_engine_reset();
+        }
+        LCD_Fill_Buffer(0);
+        uint32_t start = DWT->CYCCNT;
+        PongEngine_Draw(&bench_engine);
+        stat_add(&stat, DWT->CYCCNT - start);
+    }
+    stat_print("PongEngine_Draw", &stat);
+    LCD_Refresh(cfg);
+}
+
+// A recorded game played back from the start, one frame a step as the game draws it:
+// cleared to the background, drawn, then refreshed
+static void bench_session(ST7789V2_cfg_t* cfg, const LCDBench_Session_t* session)
+{
+    static const UserInput idle = { .direction = CENTRE, .magnitude = 0.0f, .angle = -1.0f };
+    LCDBench_Stat_t update, draw, refresh;
+    stat_clear(&update);
+    stat_clear(&draw);
+    stat_clear(&refresh);
+    bench_engine_reset();
+    Replay_Load(&bench_replay, session->journal, session->length);
+    PongEngine_SetReplay(&bench_engine, &bench_replay);
+    LCD_Fill_Buffer(0);
+    LCD_Refresh(cfg);
+    for (uint16_t n = 0; n < session->steps; n++) {
+        uint32_t start = DWT->CYCCNT;
+        const uint8_t lives = PongEngine_Update(&bench_engine, idle);   // The journal's input
+        stat_add(&update, DWT->CYCCNT - start);
+        start = DWT->CYCCNT;
+        LCD_Clear_Background(0);
+        PongEngine_Draw(&bench_engine);
+        stat_add(&draw, DWT->CYCCNT - start);
+        start = DWT->CYCCNT;
+        LCD_Refresh(cfg);
+        stat_add(&refresh, DWT->CYCCNT - start);
+        if (lives == 0) {
+            break;
+        }
+    }
+    PongEngine_SetReplay(&bench_engine, NULL);
+
+    char name[24];
+    snprintf(name, sizeof(name), "%s update", session->name);
+    stat_print(name, &update);
+    snprintf(name, sizeof(name), "%s draw", session->name);
+    stat_print(name, &draw);
+    snprintf(name, sizeof(name), "%s refresh", session->name);
+    stat_print(name, &refresh);
+    // Recorded at other game options, or the engine no longer plays it the same: the
+    // times are of some other game
+    if (bench_replay.desync || !Replay_IsFinished(&bench_replay) || update.count != session->steps) {
+        printf("session %s: desync\n", session->name);
+    }
+}
+
+// HUD text, "Score: " and a changing value, with newlib's sprintf and with Fmt
+static void bench_format(void)
+{
+    LCDBench_Stat_t with_sprintf, with_fmt;
+    stat_clear(&with_sprintf);
+    stat_clear(&with_fmt);
+    char text[24];
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS; i++) {
+        int32_t value = (int32_t)(i * 37u);
+        uint32_t start = DWT->CYCCNT;
+        sprintf(text, "Score: %ld", (long)value);
+        stat_add(&with_sprintf, DWT->CYCCNT - start);
+        start = DWT->CYCCNT;
+        Fmt_Label_Int(text, sizeof(text), "Score: ", value);
+        stat_add(&with_fmt, DWT->CYCCNT - start);
+    }
+    stat_print("sprintf label + int", &with_sprintf);
+    stat_print("Fmt_Label_Int", &with_fmt);
+}
+
+// Stick positions over the square, a different one each iteration
+static Vector2D bench_stick(uint32_t i)
+{
+    Vector2D v = { (float)((int32_t)((i * 37u) % 201u) - 100) / 100.0f,
+                   (float)((int32_t)((i * 91u) % 201u) - 100) / 100.0f };
+    return v;
+}
+
+// Polar conversion with libm and with the JOYSTICK_FAST_MATH tables, then the tables' worst error
+static void bench_joystick_math(void)
+{
+    volatile float sink;
+    LCDBench_Stat_t with_libm, with_tables, pipeline;
+    stat_clear(&with_libm);
+    stat_clear(&with_tables);
+    stat_clear(&pipeline);
+    for (uint32_t i = 0; i < LCDBENCH_ITERATIONS; i++) {
+        Vector2D v = bench_stick(i);
+        uint32_t start = DWT->CYCCNT;
+        sink = sqrtf(v.x * v.x + v.y * v.y) + atan2f(v.y, v.x);
+        stat_add(&with_libm, DWT->CYCCNT - start);
+        start = DWT->CYCCNT;
+        sink = Joystick_Hypot(v.x, v.y) + Joystick_Atan2Deg(v.y, v.x);
+        stat_add(&with_tables, DWT->CYCCNT - start);
+
+        // What Joystick_Read() does per sample, at this build's JOYSTICK_FAST_MATH
+        Joystick_t data;
+        start = DWT->CYCCNT;
+        data.coord_mapped = Joystick_MapToCircle(v);
+        Polar p = Joystick_GetPolar(&data);
+        stat_add(&pipeline, DWT->CYCCNT - start);
+        sink = p.angle;
+    }
+    (void)sink;
+    stat_print("atan2f + sqrtf", &with_libm);
+    stat_print("Joystick_Atan2Deg+Hypot", &with_tables);
+    stat_print(JOYSTICK_FAST_MATH ? "MapToCircle+Polar table" : "MapToCircle+Polar libm", &pipeline);
+
+    // Worst difference from libm over a 101x101 grid of the square
+    float worst_angle = 0.0f, worst_mag = 0.0f;
+    for (int32_t j = -50; j <= 50; j++) {
+        for (int32_t k = -50; k <= 50; k++) {
+            float x = (float)k / 50.0f, y = (float)j / 50.0f;
+            if (j == 0 && k == 0) {
+                continue;
+            }
+            float expected = 57.2957795131f * atan2f(y, x);
+            if (expected < 0.0f) expected += 360.0f;
+            float error = fabsf(Joystick_Atan2Deg(y, x) - expected);
+            if (error > 180.0f) error = 360.0f - error;
+            if (error > worst_angle) worst_angle = error;
+            float length = sqrtf(x * x + y * y);
+            error = fabsf(Joystick_Hypot(x, y) - length) / length;
+            if (error > worst_mag) worst_mag = error;
+        }
+    }
+    printf("joystick tables: worst angle error %lu udeg, magnitude %lu ppm\n",
+           (unsigned long)(worst_angle * 1e6f), (unsigned long)(worst_mag * 1e6f));
+}
+
+void LCDBench_Run(ST7789V2_cfg_t* cfg)
+{
+    static const uint8_t dirty_percents[] = {0, 5, 25, 50, 100};
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    for (uint16_t i = 0; i < sizeof(bench_sprite); i++) {
+        uint8_t row = (uint8_t)(i / 16), col = (uint8_t)(i % 16);
+        bench_sprite[i] = (row + col < 3) ? 255 : (((row ^ col) & 2) ? 1 : 6);
+    }
+
+    LCD_Fill_Buffer(0);
+    LCD_Refresh(cfg);
+
+    printf("LCD bench (%lu MHz, cycles per call)\n", (unsigned long)(SystemCoreClock / 1000000));
+    printf("compiler: %s, optimised for %s\n", LCDBENCH_COMPILER, LCDBENCH_OPTIMISE);
+    printf("%-24s %4s %9s %9s %9s %7s\n", "case", "n", "min", "avg", "max", "avg_us");
+    bench_fill(cfg);
+    bench_rect(cfg, "Draw_Rect 40x40 fill", 40, 40, 1);
+    bench_rect(cfg, "Draw_Rect 40x40 outline", 40, 40, 0);
+    bench_rect(cfg, "Draw_Rect 4x40 fill", 4, 40, 1);
+    bench_circle(cfg, "Draw_Circle r3 fill", 3, 1);
+    bench_circle(cfg, "Draw_Circle r40 fill", 40, 1);
+    bench_circle(cfg, "Draw_Circle r40 outline", 40, 0);
+    bench_string(cfg, "printString size 1", 1);
+    bench_string(cfg, "printString size 2", 2);
+    bench_format();
+    bench_sprite_draw(cfg);
+    for (uint8_t k = 0; k < sizeof(dirty_percents); k++) {
+        bench_refresh(cfg, dirty_percents[k]);
+    }
+    bench_engine_update(cfg, "PongEngine_Update 1 ball", 1);
+    bench_engine_update(cfg, "PongEngine_Update 8balls", 8);
+    bench_engine_draw(cfg);
+    for (uint8_t k = 0; k < LCDBENCH_SESSION_COUNT; k++) {
+        bench_session(cfg, &lcdbench_sessions[k]);
+    }
+    bench_joystick_math();
+
+    LCD_Fill_Buffer(0);
+    LCD_Refresh(cfg);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include "LCD.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file LCDBench.h
+ * @brief On-target micro-benchmarks of the LCD drawing primitives
+ *
+ * Times LCD_Fill_Buffer, LCD_Draw_Rect, LCD_Draw_Circle, LCD_printString,
+ * HUD text formatting (sprintf against Fmt_Label_Int), LCD_Draw_Sprite and
+ * LCD_Refresh (at several fractions of dirty rows) with
+ * the DWT cycle counter, followed by the engine's physics step
+ * (PongEngine_Update) and PongEngine_Draw and the joystick's polar
+ * conversion (libm against the JOYSTICK_FAST_MATH tables, with the tables'
+ * worst error over a grid of the stick's square), and prints a table over UART
+ * (printf). Run it on a build with PONG_LCD_BENCH=1 before and after a
+ * rendering change, at the same LCD_* options, to see what the change bought.
+ *
+ * Then each recorded session of generated/LCDBench_Sessions.h (replay
+ * journals, see make_bench_sessions.py) is played back from the start, one
+ * frame a step, with the update, draw and refresh of every frame timed: the
+ * cycles a real game costs per frame. A session the engine no longer plays
+ * the same way is reported as desynced.
+ *
+ * The Bench and BenchClang presets build it with gcc-arm-none-eabi and
+ * starm-clang; LCDBench/bench_compare.py puts the two captures side by side,
+ * and LCDBench/bench_gate.py passes or fails a capture against the cycles of
+ * a checked-in baseline:
+ * @code
+ * python3 LCDBench/bench_compare.py gcc.txt clang.txt
+ * python3 LCDBench/bench_gate.py gcc.txt
+ * @endcode
+ *
+ * Example usage:
+ * @code
+ * LCD_init(&cfg0);
+ * LCDBench_Run(&cfg0);   // leaves the screen cleared
+ * @endcode
+ */
+
+// Calls timed per drawing primitive (refreshes run a quarter as many)
+#ifndef LCDBENCH_ITERATIONS
+#define LCDBENCH_ITERATIONS 64
+#endif
+
+/**
+ * @brief Run every benchmark and print the results
+ *
+ * @param cfg LCD configuration (already initialised with LCD_init())
+ *
+ * @note Draws over the whole screen, then clears it.
+ */
+void LCDBench_Run(ST7789V2_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif
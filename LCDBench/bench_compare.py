@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Put two or more LCD bench captures (see LCDBench.h) side by side.
+
+Each capture is the UART text of a PONG_LCD_BENCH=1 build, for example one
+from the Bench preset (gcc-arm-none-eabi) and one from BenchClang (starm-clang):
+
+    python3 bench_compare.py gcc.txt clang.txt
+    python3 bench_compare.py --stat min gcc.txt clang.txt
+
+Prints the chosen statistic (avg cycles per call by default) of every case
+for each capture, and each capture's ratio to the first one (below 1.00 is
+faster). Cases missing from a capture are shown as "-".
+"""
+
+import argparse
+import sys
+
+NAME_WIDTH = 24
+STATS = ("n", "min", "avg", "max", "avg_us")
+
+
+def read_capture(path):
+    """Return (label, {case: {stat: value}}, [case order]) for one capture."""
+    label = path
+    cases = {}
+    order = []
+    in_table = False
+    with open(path, errors="replace") as capture:
+        for line in capture:
+            line = line.rstrip("\r\n")
+            if line.startswith("compiler: "):
+                label = line[len("compiler: "):]
+            elif line.startswith("case"):
+                in_table = True
+            elif in_table and len(line) > NAME_WIDTH:
+                # From the right: a name longer than its column pushes the numbers along
+                fields = line.split()
+                if len(fields) <= len(STATS) or not all(f.isdigit() for f in fields[-len(STATS):]):
+                    continue
+                name = " ".join(fields[:-len(STATS)])
+                if name not in cases:
+                    order.append(name)
+                cases[name] = dict(zip(STATS, map(int, fields[-len(STATS):])))
+    return label, cases, order
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("captures", nargs="+", help="bench output files, the first is the baseline")
+    parser.add_argument("--stat", choices=STATS, default="avg", help="statistic to compare")
+    args = parser.parse_args()
+
+    captures = [read_capture(path) for path in args.captures]
+    order = []
+    for _, _, case_order in captures:
+        order += [name for name in case_order if name not in order]
+    if not order:
+        sys.exit("no bench table found")
+
+    for index, (label, _, _) in enumerate(captures):
+        print("[%d] %s" % (index, label))
+    header = "%-*s" % (NAME_WIDTH, "case") + "".join("%12s" % ("[%d]" % i) for i in range(len(captures)))
+    header += "".join("%8s" % ("[%d]/[0]" % i) for i in range(1, len(captures)))
+    print(header)
+
+    for name in order:
+        values = [cases.get(name, {}).get(args.stat) for _, cases, _ in captures]
+        row = "%-*s" % (NAME_WIDTH, name)
+        row += "".join("%12s" % ("-" if v is None else v) for v in values)
+        for value in values[1:]:
+            if value is None or not values[0]:
+                row += "%8s" % "-"
+            else:
+                row += "%8.2f" % (value / values[0])
+        print(row)
+
+
+if __name__ == "__main__":
+    main()
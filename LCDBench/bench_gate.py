@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Pass or fail a bench capture (see LCDBench.h) against a checked-in baseline.
+
+The baseline lists the cases to hold, each with a statistic of the bench
+table, its cycles and how many percent slower it may get:
+
+    # compiler: gcc 13.3.1 20240614, optimised for speed
+    rally update             avg     41230   5
+    rally draw               max     98120  10
+
+Write one from a capture of the board the gate runs on, then keep it in git:
+
+    python3 bench_gate.py --write-baseline bench.txt > bench_baseline.txt
+    python3 bench_gate.py bench.txt                   # against bench_baseline.txt
+    python3 bench_gate.py bench.txt --baseline other.txt
+
+Prints each case against its limit and exits with status 1 if any case is
+over its limit or missing from the capture, or if a recorded session
+desynced (its times are then of another game). Cases have to be faster than
+their baseline by more than their tolerance to be reported as such, as a hint
+to write the baseline again.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+from bench_compare import STATS, read_capture
+
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bench_baseline.txt")
+NAME_WIDTH = 24
+
+
+def read_baseline(path):
+    """Return (compiler or None, [(case, stat, cycles, tolerance percent)])."""
+    compiler = None
+    limits = []
+    with open(path) as baseline:
+        for number, line in enumerate(baseline, 1):
+            line = line.strip()
+            if line.startswith("# compiler: "):
+                compiler = line[len("# compiler: "):]
+            if not line or line.startswith("#"):
+                continue
+            fields = line.split()
+            if len(fields) < 4 or fields[-3] not in STATS or not fields[-2].isdigit():
+                sys.exit("%s:%d: expected <case> <stat> <cycles> <tolerance %%>" % (path, number))
+            limits.append((" ".join(fields[:-3]), fields[-3], int(fields[-2]), float(fields[-1])))
+    return compiler, limits
+
+
+def desynced_sessions(path):
+    with open(path, errors="replace") as capture:
+        return [m.group(1) for m in (re.match(r"session (\S+): desync", line) for line in capture) if m]
+
+
+def write_baseline(capture, tolerance):
+    label, cases, order = read_capture(capture)
+    if not order:
+        sys.exit("no bench table found")
+    print("# LCDBench baseline: case, statistic, cycles, allowed slowdown in percent")
+    print("# compiler: %s" % label)
+    for name in order:
+        print("%-*s %-4s %9d %4g" % (NAME_WIDTH, name, "avg", cases[name]["avg"], tolerance))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="bench output (UART text)")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE, help="baseline to hold the capture to")
+    parser.add_argument("--write-baseline", action="store_true",
+                        help="print a baseline of every case's avg from the capture instead")
+    parser.add_argument("--tolerance", type=float, default=5.0,
+                        help="allowed slowdown in percent, for --write-baseline (default 5)")
+    args = parser.parse_args()
+
+    if args.write_baseline:
+        write_baseline(args.capture, args.tolerance)
+        return
+
+    if not os.path.exists(args.baseline):
+        sys.exit("%s: no baseline yet, write one from a capture with --write-baseline" % args.baseline)
+    compiler, limits = read_baseline(args.baseline)
+    label, cases, _ = read_capture(args.capture)
+    if not limits:
+        sys.exit("%s: no cases" % args.baseline)
+    if compiler is not None and compiler != label:
+        print("note: baseline from %s, capture from %s" % (compiler, label))
+
+    failed = 0
+    print("%-*s %-4s %9s %9s %7s %7s" % (NAME_WIDTH, "case", "stat", "baseline", "now", "change", "limit"))
+    for name, stat, cycles, tolerance in limits:
+        if name not in cases:
+            print("%-*s %-4s %9d %9s %7s %6g%%  FAIL (missing)" % (NAME_WIDTH, name, stat, cycles, "-", "-", tolerance))
+            failed += 1
+            continue
+        now = cases[name][stat]
+        change = 100.0 * (now - cycles) / cycles if cycles else 0.0
+        if change > tolerance:
+            verdict = "FAIL"
+            failed += 1
+        elif change < -tolerance:
+            verdict = "ok (faster)"
+        else:
+            verdict = "ok"
+        print("%-*s %-4s %9d %9d %+6.1f%% %6g%%  %s" % (NAME_WIDTH, name, stat, cycles, now, change, tolerance, verdict))
+
+    for session in desynced_sessions(args.capture):
+        print("session %s desynced: FAIL" % session)
+        failed += 1
+
+    print("PASS" if failed == 0 else "FAIL: %d of the checks" % failed)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
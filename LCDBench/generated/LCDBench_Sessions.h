@@ -0,0 +1,114 @@
+/**
+ * @file LCDBench_Sessions.h
+ * @brief Replay journals of the games LCDBench plays back (generated, do not edit)
+ *
+ * Written by make_bench_sessions.py from sessions/rally.txt, sessions/misses.txt.
+ */
+
+#ifndef LCDBENCH_SESSIONS_H
+#define LCDBENCH_SESSIONS_H
+
+#include <stdint.h>
+
+// rally: 1800 steps, 1201 bytes
+static const uint8_t lcdbench_session_rally[1201] = {
+    0xF0, 0x28, 0x08, 0x2F, 0x01, 0xE0, 0x00, 0xF0, 0x2F, 0x04, 0x0D, 0x28, 0x0B, 0xE0, 0x01, 0xF0,
+    0x09, 0xE0, 0x00, 0xF0, 0x0A, 0xE0, 0x00, 0xF0, 0x0F, 0x04, 0xE0, 0x00, 0xF0, 0x0D, 0x84, 0xA7,
+    0x2B, 0xE0, 0x00, 0xF0, 0x29, 0xE0, 0x00, 0xF0, 0x2C, 0xE0, 0x00, 0xF0, 0x2F, 0x06, 0x0B, 0x28,
+    0x0F, 0x0A, 0xE0, 0x00, 0xF0, 0x0F, 0x02, 0x28, 0x08, 0x28, 0x0B, 0xE0, 0x00, 0xF0, 0x0F, 0x03,
+    0x28, 0x08, 0x29, 0x08, 0x29, 0x08, 0xE0, 0x00, 0xF0, 0x29, 0x08, 0xE0, 0x00, 0xF0, 0x2A, 0x08,
+    0xE0, 0x00, 0xF0, 0x29, 0x08, 0xE0, 0x00, 0xF0, 0x2A, 0x08, 0x29, 0x08, 0x29, 0xE0, 0x01, 0xF0,
+    0x28, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x2A, 0x08, 0x29, 0x08, 0x29, 0x08,
+    0x29, 0x08, 0x29, 0x08, 0x29, 0xE0, 0x00, 0xF0, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x2A,
+    0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0xE0, 0x00, 0xF0, 0x08, 0x29, 0x08, 0x29, 0x08, 0x2F, 0x01,
+    0xE0, 0x00, 0xF0, 0x0B, 0x28, 0x0C, 0x28, 0x0A, 0xE0, 0x02, 0xF0, 0x08, 0xE0, 0x00, 0xF0, 0x0A,
+    0xE0, 0x01, 0xF0, 0x0F, 0x02, 0x28, 0x0B, 0xE0, 0x00, 0xF0, 0x0A, 0x28, 0x0A, 0xE0, 0x01, 0xF0,
+    0x0E, 0x29, 0xE0, 0x00, 0xF0, 0x2F, 0x06, 0xE0, 0x00, 0xF0, 0x2F, 0x09, 0x0B, 0xE0, 0x00, 0xF0,
+    0x08, 0xE0, 0x00, 0xF0, 0x08, 0xE0, 0x00, 0xF0, 0x09, 0xE0, 0x00, 0xF0, 0x0B, 0xE0, 0x00, 0xF0,
+    0x0B, 0xE0, 0x00, 0xF0, 0x0F, 0x06, 0x2B, 0xE0, 0x00, 0xF0, 0x2A, 0xE0, 0x00, 0xF0, 0x2F, 0x03,
+    0xE0, 0x00, 0xF0, 0x2F, 0x02, 0xE0, 0x00, 0xF0, 0x0F, 0x00, 0x28, 0x0C, 0x28, 0x0C, 0x28, 0x0C,
+    0x28, 0x08, 0xE0, 0x00, 0xF0, 0x0D, 0xE0, 0x01, 0xF0, 0x09, 0xE0, 0x00, 0xF0, 0x0F, 0x04, 0x29,
+    0x08, 0x2C, 0x08, 0x28, 0xE0, 0x00, 0xF0, 0x29, 0xE0, 0x00, 0xF0, 0x2B, 0x08, 0x29, 0x08, 0x28,
+    0xE0, 0x00, 0xF0, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0xE0, 0x00, 0xF0, 0x29, 0x08,
+    0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0xE0, 0x00, 0xF0, 0x28, 0xE0, 0x00, 0xF0, 0x28, 0x08,
+    0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x09, 0x28, 0x09, 0x28, 0x09,
+    0x28, 0x09, 0x28, 0xE0, 0x00, 0xF0, 0x09, 0xE0, 0x00, 0xF0, 0x08, 0x28, 0x09, 0x28, 0x09, 0x28,
+    0x09, 0x28, 0x09, 0xE0, 0x00, 0xF0, 0x08, 0x28, 0x09, 0x28, 0x09, 0x28, 0xE0, 0x01, 0xF0, 0x0A,
+    0x28, 0x09, 0x28, 0x09, 0x28, 0xE0, 0x00, 0xF0, 0x0A, 0x28, 0x09, 0x29, 0xE0, 0x00, 0xF0, 0x28,
+    0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0xE0, 0x00, 0xF0, 0x29, 0x08, 0x29, 0x08,
+    0x29, 0x08, 0x29, 0x08, 0x2A, 0x08, 0x29, 0x08, 0xE0, 0x00, 0xF0, 0x29, 0x08, 0x29, 0x08, 0xE0,
+    0x00, 0xF0, 0x2A, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x09, 0xE0, 0x00, 0xF0, 0x28, 0x0A, 0x28,
+    0x09, 0x28, 0xE0, 0x00, 0xF0, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x08,
+    0xE0, 0x00, 0xF0, 0x09, 0x28, 0x09, 0xE0, 0x02, 0xF0, 0x08, 0xE0, 0x00, 0xF0, 0x08, 0x28, 0xE0,
+    0x00, 0xF0, 0x0A, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x29, 0x08, 0x29, 0x08, 0x29,
+    0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x28, 0xE0, 0x00, 0xF0, 0x29, 0x08, 0x29,
+    0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0xE0, 0x00, 0xF0,
+    0x28, 0xE0, 0x00, 0xF0, 0x28, 0xE0, 0x00, 0xF0, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08,
+    0x2F, 0x01, 0xE0, 0x00, 0xF0, 0x2F, 0x00, 0xE0, 0x00, 0xF0, 0x08, 0xE0, 0x00, 0xF0, 0x08, 0x28,
+    0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28,
+    0x08, 0xE0, 0x00, 0xF0, 0x0B, 0xE0, 0x00, 0xF0, 0x09, 0x28, 0x09, 0xE0, 0x00, 0xF0, 0x08, 0xE0,
+    0x00, 0xF0, 0x0D, 0x28, 0xE0, 0x00, 0xF0, 0x0E, 0x28, 0x08, 0xE0, 0x00, 0xF0, 0x0F, 0x01, 0xE0,
+    0x00, 0xF0, 0x08, 0xE0, 0x00, 0xF0, 0x2A, 0xE0, 0x00, 0xF0, 0x29, 0x08, 0x2C, 0x08, 0xE0, 0x00,
+    0xF0, 0x29, 0xE0, 0x00, 0xF0, 0x2C, 0x08, 0x29, 0x08, 0x29, 0x08, 0xE0, 0x00, 0xF0, 0x2A, 0x08,
+    0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0xE0, 0x00, 0xF0, 0x28, 0x08, 0x29, 0x08, 0x29, 0x08,
+    0x29, 0x08, 0x29, 0x08, 0x28, 0xE0, 0x00, 0xF0, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08, 0x29, 0x08,
+    0x28, 0xE0, 0x00, 0xF0, 0x2F, 0x08, 0x08, 0x28, 0x09, 0x28, 0x09, 0x28, 0xE0, 0x00, 0xF0, 0x09,
+    0xE0, 0x00, 0xF0, 0x08, 0x28, 0x08, 0xE0, 0x00, 0xF0, 0x08, 0x28, 0x09, 0x28, 0x09, 0x28, 0x08,
+    0xE0, 0x00, 0xF0, 0x09, 0x28, 0xE0, 0x00, 0xF0, 0x0A, 0x28, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28,
+    0xE0, 0x00, 0xF0, 0x09, 0xE0, 0x00, 0xF0, 0x08, 0x28, 0x09, 0x28, 0x09, 0x28, 0xE0, 0x00, 0xF0,
+    0x0A, 0x28, 0x09, 0x28, 0xE0, 0x00, 0xF0, 0x09, 0x28, 0x09, 0x28, 0x09, 0x28, 0x08, 0xE0, 0x00,
+    0xF0, 0x09, 0x28, 0xE0, 0x00, 0xF0, 0x0A, 0x28, 0x09, 0x28, 0xE0, 0x00, 0xF0, 0x09, 0x28, 0x09,
+    0x28, 0x09, 0x28, 0x0B, 0xE0, 0x00, 0xF0, 0x0D, 0x28, 0xE0, 0x00, 0xF0, 0x2A, 0xE0, 0x00, 0xF0,
+    0x29, 0x08, 0xE0, 0x00, 0xF0, 0x2D, 0xE0, 0x00, 0xF0, 0x2A, 0x08, 0x29, 0xE0, 0x00, 0xF0, 0x2C,
+    0x08, 0xE0, 0x00, 0xF0, 0x2E, 0x08, 0x2B, 0xE0, 0x00, 0xF0, 0x2A, 0x08, 0x2C, 0xE0, 0x00, 0xF0,
+    0x2C, 0xE0, 0x00, 0xF0, 0x2A, 0x09, 0xE0, 0x00, 0xF0, 0x09, 0x28, 0x0C, 0x28, 0xE0, 0x00, 0xF0,
+    0x09, 0xE0, 0x00, 0xF0, 0x0D, 0xE0, 0x00, 0xF0, 0x0A, 0x28, 0x0C, 0x28, 0x0A, 0xE0, 0x00, 0xF0,
+    0x0B, 0x28, 0x0A, 0xE0, 0x00, 0xF0, 0x0C, 0xE0, 0x00, 0xF0, 0x0F, 0x04, 0x29, 0x08, 0x29, 0xE0,
+    0x00, 0xF0, 0x2B, 0xE0, 0x01, 0xF0, 0x2B, 0xE0, 0x00, 0xF0, 0x2A, 0xE0, 0x00, 0xF0, 0x29, 0x08,
+    0x28, 0xE0, 0x01, 0xF0, 0x29, 0xE0, 0x00, 0xF0, 0x28, 0xE0, 0x00, 0xF0, 0x2E, 0xE0, 0x00, 0xF0,
+    0x2B, 0x08, 0x2F, 0x0A, 0xE0, 0x00, 0xF0, 0x0A, 0xE0, 0x00, 0xF0, 0x0A, 0x28, 0x0C, 0x28, 0x08,
+    0xE0, 0x00, 0xF0, 0x09, 0xE0, 0x00, 0xF0, 0x09, 0xE0, 0x00, 0xF0, 0x0D, 0x28, 0x0C, 0x28, 0xE0,
+    0x00, 0xF0, 0x0B, 0xE0, 0x00, 0xF0, 0x0C, 0x28, 0x0E, 0xE0, 0x00, 0xF0, 0x09, 0xE0, 0x00, 0xF0,
+    0x08, 0xE0, 0x00, 0xF0, 0x0A, 0x29, 0xE0, 0x00, 0xF0, 0x29, 0xE0, 0x01, 0xF0, 0x2B, 0x08, 0x2C,
+    0x08, 0x2C, 0x08, 0x28, 0xE0, 0x00, 0xF0, 0x2D, 0x08, 0x28, 0xE0, 0x00, 0xF0, 0x2D, 0x08, 0x2C,
+    0xE0, 0x00, 0xF0, 0x2F, 0x03, 0xE0, 0x00, 0xF0, 0x2A, 0x09, 0x28, 0x0C, 0x28, 0x0A, 0xE0, 0x00,
+    0xF0, 0x0B, 0x28, 0x09, 0xE0, 0x01, 0xF0, 0x0E, 0x28, 0x0C, 0x28, 0x09, 0xE0, 0x00, 0xF0, 0x0C,
+    0x28, 0x08, 0xE0, 0x00, 0xF0, 0x0C, 0xE0, 0x00, 0xF0, 0x08, 0xE0, 0x00, 0xF0, 0x0F, 0x00, 0xE0,
+    0x01, 0xF0, 0x2B, 0x08, 0xE0, 0x00, 0xF0, 0x2E, 0x08, 0x2C, 0x08, 0xE0, 0x00, 0xF0, 0x29, 0xE0,
+    0x00, 0xF0, 0x28, 0xE0, 0x00, 0xF0, 0x2F, 0x00, 0x08, 0x2C, 0xE0, 0x00, 0xF0, 0x29, 0x08, 0x2E,
+    0xE0, 0x00, 0xF0, 0x2F, 0x02, 0x09, 0xE0, 0x00, 0xF0, 0x09, 0xE0, 0x00, 0xF0, 0x09, 0x28, 0x0C,
+    0x28, 0xE0, 0x00, 0xF0, 0x0E, 0x28, 0x09, 0xE0, 0x00, 0xF0, 0x0C, 0x28, 0x0C, 0x28, 0x0C, 0x28,
+    0x0F, 0x03, 0xE0, 0x00, 0xF0, 0x0C, 0xE0, 0x00, 0xF0, 0x08, 0x29, 0x08, 0x2C, 0x08, 0x2C, 0x08,
+    0xE0, 0x00, 0xF0, 0x2B, 0xE0, 0x00, 0xF0, 0x2A, 0xE0, 0x00, 0xF0, 0x2B, 0x08, 0x2C, 0x08, 0x2A,
+    0xE0, 0x00, 0xF0, 0x2B, 0x08, 0x2F, 0x0A, 0x09, 0x28, 0x0C, 0xE0, 0x00, 0xF0, 0x09, 0x28, 0x08,
+    0xE0, 0x00, 0xF0, 0x0D, 0x28, 0xE0, 0x00, 0xF0, 0x08, 0xE0, 0x01, 0xF0, 0x09, 0xE0, 0x01, 0xF0,
+    0x08, 0xE0, 0x01, 0xF0, 0x0F, 0x02, 0xE0, 0x00, 0xF0, 0x0F, 0x05, 0xE0, 0x00, 0xF0, 0x0B, 0xE0,
+    0x00, 0xF0, 0x09, 0x29, 0x08, 0x2B, 0xE0, 0x00, 0xF0, 0x2A, 0x08, 0x2C, 0xE0, 0x00, 0xF0, 0x28,
+    0xE0, 0x00, 0xF0, 0x2A, 0x08, 0x2A, 0xE0, 0x00, 0xF0, 0x2B, 0x08, 0x2C, 0x08, 0x2C, 0x08, 0x2C,
+    0xE0, 0x00, 0xF0, 0x2C, 0xE0, 0x00, 0xF0, 0x2D, 0x09, 0x28, 0x0C, 0x28, 0x0C, 0x28, 0xE0, 0x00,
+    0xF0, 0x0C, 0xE0, 0x00, 0xF0, 0x09, 0xE0, 0x00, 0xF0, 0x0A, 0xE0, 0x01, 0xF0, 0x0C, 0x28, 0x0C,
+    0x28,
+};
+
+// misses: 429 steps, 41 bytes
+static const uint8_t lcdbench_session_misses[41] = {
+    0xF0, 0x0F, 0x25, 0xE0, 0x07, 0x25, 0xF0, 0x2F, 0x15, 0x83, 0x9C, 0x2F, 0x08, 0x0F, 0x25, 0xE0,
+    0x07, 0x25, 0xF0, 0x2F, 0x0F, 0x88, 0x84, 0x2F, 0x0E, 0x0F, 0x25, 0xE0, 0x07, 0x25, 0xF0, 0x2F,
+    0x01, 0xA3, 0x88, 0x2F, 0x1C, 0x0F, 0x10, 0x80, 0xA7,
+};
+
+typedef struct {
+    const char* name;
+    const uint8_t* journal;
+    uint16_t length;
+    uint16_t steps;
+} LCDBench_Session_t;
+
+#define LCDBENCH_SESSION_COUNT 2
+
+static const LCDBench_Session_t lcdbench_sessions[LCDBENCH_SESSION_COUNT] = {
+    {"rally", lcdbench_session_rally, 1201, 1800},
+    {"misses", lcdbench_session_misses, 41, 429},
+};
+
+#endif /* LCDBENCH_SESSIONS_H */
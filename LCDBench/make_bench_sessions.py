@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Generate LCDBench_Sessions.h, the recorded games the bench plays back.
+
+Each session is a replay journal as a PONG_REPLAY_RECORD build dumps it over
+the UART at game over: a "Replay: <n> steps" line, then the journal in hex,
+32 bytes a line. Save that part of a capture as sessions/<name>.txt and run
+
+    python3 make_bench_sessions.py sessions/*.txt -o generated/LCDBench_Sessions.h
+
+The session is named after the file. LCDBench plays each one from
+PongEngine_Init() and times every step's update, draw and refresh. The
+journal only replays the same game on a build with the game options it was
+recorded at (the defaults for the sessions checked in): on any other, the
+bench reports the session as desynced.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+REPLAY_BUFFER_BYTES = 4096
+NAME_WIDTH = 24
+LONGEST_CASE = " refresh"
+
+
+def read_session(path):
+    """Return (steps, journal bytes) from a dump."""
+    steps = None
+    data = bytearray()
+    with open(path, errors="replace") as dump:
+        for line in dump:
+            line = line.strip()
+            match = re.match(r"Replay: (\d+) steps( \(truncated\))?$", line)
+            if match:
+                if match.group(2):
+                    sys.exit("%s: the journal was truncated, record a shorter game" % path)
+                steps = int(match.group(1))
+            elif steps is not None and re.fullmatch(r"(?:[0-9A-Fa-f]{2})+", line):
+                data += bytes.fromhex(line)
+            elif steps is not None and data:
+                break
+    if steps is None or not data:
+        sys.exit("%s: no replay dump found" % path)
+    if len(data) > REPLAY_BUFFER_BYTES:
+        sys.exit("%s: %d bytes is more than the REPLAY_BUFFER_BYTES (%d) Replay_Load() takes"
+                 % (path, len(data), REPLAY_BUFFER_BYTES))
+    return steps, bytes(data)
+
+
+def write_header(out, sessions):
+    out.write("/**\n")
+    out.write(" * @file LCDBench_Sessions.h\n")
+    out.write(" * @brief Replay journals of the games LCDBench plays back (generated, do not edit)\n")
+    out.write(" *\n")
+    out.write(" * Written by make_bench_sessions.py from %s.\n" % ", ".join(
+        "sessions/%s.txt" % name for name, _, _ in sessions))
+    out.write(" */\n\n")
+    out.write("#ifndef LCDBENCH_SESSIONS_H\n#define LCDBENCH_SESSIONS_H\n\n")
+    out.write("#include <stdint.h>\n")
+    for name, steps, data in sessions:
+        out.write("\n// %s: %d steps, %d bytes\n" % (name, steps, len(data)))
+        out.write("static const uint8_t lcdbench_session_%s[%d] = {\n" % (name, len(data)))
+        for start in range(0, len(data), 16):
+            out.write("    %s,\n" % ", ".join("0x%02X" % b for b in data[start:start + 16]))
+        out.write("};\n")
+    out.write("\ntypedef struct {\n")
+    out.write("    const char* name;\n")
+    out.write("    const uint8_t* journal;\n")
+    out.write("    uint16_t length;\n")
+    out.write("    uint16_t steps;\n")
+    out.write("} LCDBench_Session_t;\n\n")
+    out.write("#define LCDBENCH_SESSION_COUNT %d\n\n" % len(sessions))
+    out.write("static const LCDBench_Session_t lcdbench_sessions[LCDBENCH_SESSION_COUNT] = {\n")
+    for name, steps, data in sessions:
+        out.write("    {\"%s\", lcdbench_session_%s, %d, %d},\n" % (name, name, len(data), steps))
+    out.write("};\n")
+    out.write("\n#endif /* LCDBENCH_SESSIONS_H */\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dumps", nargs="+", help="replay dumps, one session each")
+    parser.add_argument("-o", "--output", help="header to write (default: standard output)")
+    args = parser.parse_args()
+
+    sessions = []
+    for path in args.dumps:
+        name = os.path.splitext(os.path.basename(path))[0]
+        if not re.fullmatch(r"[a-z][a-z0-9_]*", name):
+            sys.exit("%s: a session name must be a lower-case C identifier" % path)
+        if len(name) + len(LONGEST_CASE) > NAME_WIDTH:
+            sys.exit("%s: name too long for the bench table" % path)
+        steps, data = read_session(path)
+        if steps > 0xFFFF:
+            sys.exit("%s: more than 65535 steps" % path)
+        sessions.append((name, steps, data))
+
+    if args.output:
+        with open(args.output, "w", newline="\n") as out:
+            write_header(out, sessions)
+    else:
+        write_header(sys.stdout, sessions)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+#include "Latency.h"
+#include <stdio.h>
+
+/**
+ * @file Latency.c
+ * @brief Implementation of the input-to-photon latency measurement
+ *
+ * All times are DWT->CYCCNT values. Differences are taken as unsigned 32-bit
+ * subtractions, so they stay correct across the counter wrapping (every
+ * 53 seconds at 80MHz) as long as each latency is shorter than that.
+ */
+
+static void stat_clear(Latency_Stat_t* stat)
+{
+    stat->min = UINT32_MAX;
+    stat->max = 0;
+    stat->total = 0;
+    stat->count = 0;
+}
+
+static void stat_add(Latency_Stat_t* stat, uint32_t cycles)
+{
+    if (cycles < stat->min) stat->min = cycles;
+    if (cycles > stat->max) stat->max = cycles;
+    stat->total += cycles;
+    stat->count++;
+}
+
+static void stat_print(const char* name, const Latency_Stat_t* stat, uint32_t cycles_per_us)
+{
+    if (stat->count == 0) {
+        printf("  %-16s no frames\n", name);
+        return;
+    }
+    printf("  %-16s min %5lu  avg %5lu  max %5lu us\n", name,
+           (unsigned long)(stat->min / cycles_per_us),
+           (unsigned long)((stat->total / stat->count) / cycles_per_us),
+           (unsigned long)(stat->max / cycles_per_us));
+}
+
+void Latency_Init(Latency_t* latency)
+{
+    // Not reset: other timings (the boot phases, the profiler) may be reading it already
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    stat_clear(&latency->sample_to_update);
+    stat_clear(&latency->update_to_shown);
+    stat_clear(&latency->sample_to_shown);
+    stat_clear(&latency->tick_to_step);
+    latency->tick_cycles = DWT->CYCCNT;
+    latency->sample_cycles = 0;
+    latency->update_cycles = 0;
+    latency->frame_pending = 0;
+}
+
+void Latency_Mark_Update(Latency_t* latency, uint32_t sample_cycles)
+{
+    latency->sample_cycles = sample_cycles;
+    latency->update_cycles = DWT->CYCCNT;
+}
+
+void Latency_Mark_Tick(Latency_t* latency)
+{
+    latency->tick_cycles = DWT->CYCCNT;
+}
+
+void Latency_Mark_Step(Latency_t* latency)
+{
+    stat_add(&latency->tick_to_step, DWT->CYCCNT - latency->tick_cycles);
+}
+
+void Latency_Mark_Frame(Latency_t* latency)
+{
+    // The previous frame is finished with (LCD_Swap() waits for it), so the slot is free
+    latency->frame_pending = 0;
+    latency->frame_sample = latency->sample_cycles;
+    latency->frame_update = latency->update_cycles;
+    latency->frame_pending = 1;
+}
+
+void Latency_Mark_Shown(Latency_t* latency)
+{
+    if (!latency->frame_pending) {
+        return;
+    }
+    uint32_t now = DWT->CYCCNT;
+    latency->frame_pending = 0;
+    stat_add(&latency->sample_to_update, latency->frame_update - latency->frame_sample);
+    stat_add(&latency->update_to_shown, now - latency->frame_update);
+    stat_add(&latency->sample_to_shown, now - latency->frame_sample);
+}
+
+void Latency_Report(Latency_t* latency)
+{
+    // Snapshot and clear with the DMA interrupt held off, then print at leisure
+    __disable_irq();
+    Latency_Stat_t sample_to_update = latency->sample_to_update;
+    Latency_Stat_t update_to_shown = latency->update_to_shown;
+    Latency_Stat_t sample_to_shown = latency->sample_to_shown;
+    Latency_Stat_t tick_to_step = latency->tick_to_step;
+    stat_clear(&latency->sample_to_update);
+    stat_clear(&latency->update_to_shown);
+    stat_clear(&latency->sample_to_shown);
+    stat_clear(&latency->tick_to_step);
+    __enable_irq();
+
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    printf("Latency over %lu frames:\n", (unsigned long)sample_to_shown.count);
+    stat_print("sample->update", &sample_to_update, cycles_per_us);
+    stat_print("update->screen", &update_to_shown, cycles_per_us);
+    stat_print("sample->screen", &sample_to_shown, cycles_per_us);
+    stat_print("tick->step", &tick_to_step, cycles_per_us);
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Latency.h
+ * @brief Input-to-photon latency measurement with the DWT cycle counter
+ *
+ * Timestamps three points of the path from a stick movement to pixels on the panel:
+ * 1. The ADC finishing the joystick sample (Joystick_cfg_t.sample_timestamps)
+ * 2. The game engine consuming that input (Latency_Mark_Update())
+ * 3. The DMA finishing the panel rows that show the result (LCD_Set_Row_Watch())
+ *
+ * and keeps min/avg/max of each stage over the frames that reached the screen.
+ *
+ * Example usage:
+ * @code
+ * Latency_t latency;
+ * Latency_Init(&latency);
+ *
+ * // Each time the engine steps with a fresh input:
+ * Latency_Mark_Update(&latency, joystick_data.sample_cycles);
+ *
+ * // Before starting a refresh, watch the rows the paddle was drawn on:
+ * Latency_Mark_Frame(&latency);
+ * LCD_Set_Row_Watch(paddle_y, paddle_y + paddle_height - 1, on_paddle_sent);
+ * LCD_Swap(&cfg0);
+ *
+ * void on_paddle_sent(void) { Latency_Mark_Shown(&latency); }   // DMA interrupt
+ *
+ * // Now and then:
+ * Latency_Report(&latency);   // printf, then start over
+ * @endcode
+ */
+
+/**
+ * @struct Latency_Stat_t
+ * @brief Min/avg/max of one latency, in CPU cycles
+ */
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;     ///< Sum, for the average
+    uint32_t count;
+} Latency_Stat_t;
+
+/**
+ * @struct Latency_t
+ * @brief Latency statistics and the timestamps of the frame in flight
+ */
+typedef struct {
+    Latency_Stat_t sample_to_update;    ///< ADC sample -> engine step
+    Latency_Stat_t update_to_shown;     ///< Engine step -> rows sent to the panel
+    Latency_Stat_t sample_to_shown;     ///< ADC sample -> rows sent (input-to-photon)
+    Latency_Stat_t tick_to_step;        ///< Frame timer interrupt -> engine step starting (wake-up jitter)
+    volatile uint32_t tick_cycles;      ///< Internal: when the latest frame timer tick was raised
+    uint32_t sample_cycles;             ///< Internal: sample time of the latest input consumed
+    uint32_t update_cycles;             ///< Internal: when the latest input was consumed
+    volatile uint32_t frame_sample;     ///< Internal: sample time of the input the frame in flight shows
+    volatile uint32_t frame_update;     ///< Internal: update time of the input the frame in flight shows
+    volatile uint8_t frame_pending;     ///< Internal: 1 while a frame is waiting for Latency_Mark_Shown()
+} Latency_t;
+
+/**
+ * @brief Start the DWT cycle counter and clear the statistics
+ *
+ * A counter already running is left to count on: only differences are taken.
+ *
+ * @param latency Pointer to latency state
+ */
+void Latency_Init(Latency_t* latency);
+
+/**
+ * @brief Timestamp the engine consuming an input
+ *
+ * @param latency Pointer to latency state
+ * @param sample_cycles DWT cycle count when the input was sampled (Joystick_t.sample_cycles)
+ */
+void Latency_Mark_Update(Latency_t* latency, uint32_t sample_cycles);
+
+/**
+ * @brief Timestamp a frame timer tick
+ *
+ * Call from the frame timer interrupt.
+ *
+ * @param latency Pointer to latency state
+ */
+void Latency_Mark_Tick(Latency_t* latency);
+
+/**
+ * @brief Timestamp the engine starting the steps of the latest tick
+ *
+ * The spread of tick->step (max - min) is the wake-up jitter of the game loop.
+ *
+ * @param latency Pointer to latency state
+ */
+void Latency_Mark_Step(Latency_t* latency);
+
+/**
+ * @brief Tie the latest consumed input to the frame about to be sent
+ *
+ * @param latency Pointer to latency state
+ */
+void Latency_Mark_Frame(Latency_t* latency);
+
+/**
+ * @brief Timestamp the frame's watched rows reaching the panel
+ *
+ * Call from the LCD_Set_Row_Watch() callback (DMA interrupt context).
+ *
+ * @param latency Pointer to latency state
+ */
+void Latency_Mark_Shown(Latency_t* latency);
+
+/**
+ * @brief Print min/avg/max of each stage in microseconds over UART (printf), then clear them
+ *
+ * @param latency Pointer to latency state
+ */
+void Latency_Report(Latency_t* latency);
+
+#ifdef __cplusplus
+}
+#endif
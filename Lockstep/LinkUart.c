@@ -0,0 +1,159 @@
+#include "LinkUart.h"
+#include "stm32l4xx_hal.h"
+#include "DmaChannel.h"
+#include "DmaBuffer.h"
+#include <string.h>
+
+/**
+ * @file LinkUart.c
+ * @brief Implementation of the board-to-board UART
+ *
+ * The RX DMA runs in circular mode and is never stopped, so nothing is lost
+ * between reads: the write position is the ring size minus CNDTR. Overrun
+ * detection is turned off (CR3 OVRDIS), as a byte the DMA missed only costs
+ * a packet the CRC throws away, where an overrun would stop reception.
+ */
+
+#if (LINKUART_RX_BYTES & (LINKUART_RX_BYTES - 1)) != 0
+#error "LINKUART_RX_BYTES must be a power of 2"
+#endif
+#if (LINKUART_TX_BYTES & (LINKUART_TX_BYTES - 1)) != 0
+#error "LINKUART_TX_BYTES must be a power of 2"
+#endif
+// The RX ring is a single circular run, CNDTR counting down from LINKUART_RX_BYTES
+DMA_BUFFER_CHECK(((LinkUart_cfg_t*)0)->rx_buf, 1);
+
+#define LINKUART_TX_MASK (LINKUART_TX_BYTES - 1u)
+
+// PC4 = USART3_TX, PC5 = USART3_RX
+#define LINKUART_TX_PIN 4u
+#define LINKUART_RX_PIN 5u
+#define LINKUART_AF 7u
+
+static void set_baud(LinkUart_cfg_t* cfg)
+{
+    // 16x oversampling: BRR = kernel clock (PCLK1, the reset choice in CCIPR) / baud, rounded
+    cfg->uart->BRR = (HAL_RCC_GetPCLK1Freq() + cfg->baud / 2) / cfg->baud;
+}
+
+void LinkUart_Init(LinkUart_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+    if (DmaChannel_Claim(cfg->dma_channel, cfg->dma_request, cfg, "LinkUart") != DMACHANNEL_OK) {
+        return;  // Not set up: the link never connects
+    }
+
+    cfg->rx_tail = 0;
+    cfg->tx_head = 0;
+    cfg->tx_tail = 0;
+    cfg->dropped = 0;
+
+    RCC->AHB2ENR |= RCC_AHB2ENR_GPIOCEN;
+    RCC->APB1ENR1 |= RCC_APB1ENR1_USART3EN;
+    (void)RCC->APB1ENR1;  // the clock has to be on before the registers are written
+
+    // Both pins alternate function 7, RX pulled up so an unconnected link reads idle
+    GPIOC->MODER = (GPIOC->MODER & ~((3u << (2u * LINKUART_TX_PIN)) | (3u << (2u * LINKUART_RX_PIN))))
+                 | (2u << (2u * LINKUART_TX_PIN)) | (2u << (2u * LINKUART_RX_PIN));
+    GPIOC->AFR[0] = (GPIOC->AFR[0] & ~((0xFu << (4u * LINKUART_TX_PIN)) | (0xFu << (4u * LINKUART_RX_PIN))))
+                  | (LINKUART_AF << (4u * LINKUART_TX_PIN)) | (LINKUART_AF << (4u * LINKUART_RX_PIN));
+    GPIOC->PUPDR = (GPIOC->PUPDR & ~(3u << (2u * LINKUART_RX_PIN))) | (1u << (2u * LINKUART_RX_PIN));
+
+    // 8N1, no flow control
+    cfg->uart->CR1 = 0;
+    set_baud(cfg);
+    cfg->uart->CR2 = 0;
+    cfg->uart->CR3 = USART_CR3_OVRDIS | USART_CR3_DMAR;
+
+    // RX DMA: peripheral to memory, 8-bit, increment memory, circular, no interrupts
+    cfg->dma_channel->CCR = 0;
+    cfg->dma_channel->CPAR = (uint32_t)&cfg->uart->RDR;
+    cfg->dma_channel->CMAR = (uint32_t)cfg->rx_buf;
+    cfg->dma_channel->CNDTR = LINKUART_RX_BYTES;
+    cfg->dma_channel->CCR = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_EN;
+
+    cfg->uart->CR1 = USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    // Below the LCD's DMA (priority 1): a byte sent a little late costs nothing
+    NVIC_SetPriority(USART3_IRQn, 3);
+    NVIC_EnableIRQ(USART3_IRQn);
+
+    cfg->setup_done = 1;
+}
+
+uint16_t LinkUart_Read(LinkUart_cfg_t* cfg, uint8_t* out, uint16_t max)
+{
+    if (!cfg->setup_done) {
+        return 0;
+    }
+    uint32_t head = (LINKUART_RX_BYTES - cfg->dma_channel->CNDTR) & (LINKUART_RX_BYTES - 1u);
+    uint16_t n = 0;
+    while (cfg->rx_tail != head && n < max) {
+        out[n++] = cfg->rx_buf[cfg->rx_tail];
+        cfg->rx_tail = (cfg->rx_tail + 1u) & (LINKUART_RX_BYTES - 1u);
+    }
+    return n;
+}
+
+uint16_t LinkUart_Send(LinkUart_cfg_t* cfg, const uint8_t* data, uint16_t length)
+{
+    if (!cfg->setup_done || length == 0) {
+        return 0;
+    }
+
+    uint32_t head = cfg->tx_head;
+    if (length > LINKUART_TX_BYTES - (head - cfg->tx_tail)) {
+        cfg->dropped++;
+        return 0;
+    }
+
+    // Copy in up to two pieces around the end of the ring
+    uint32_t start = head & LINKUART_TX_MASK;
+    uint32_t first = LINKUART_TX_BYTES - start;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(&cfg->tx_buf[start], data, first);
+    memcpy(&cfg->tx_buf[0], data + first, length - first);
+
+    // The bytes must be in memory before the interrupt can see the new head
+    __DMB();
+    cfg->tx_head = head + length;
+    SET_BIT(cfg->uart->CR1, USART_CR1_TXEIE);
+    return length;
+}
+
+void LinkUart_Clock_Changed(LinkUart_cfg_t* cfg)
+{
+    if (!cfg->setup_done) {
+        return;
+    }
+    while (cfg->tx_tail != cfg->tx_head) {
+    }
+    while (!(cfg->uart->ISR & USART_ISR_TC)) {
+    }
+    CLEAR_BIT(cfg->uart->CR1, USART_CR1_UE);
+    set_baud(cfg);
+    SET_BIT(cfg->uart->CR1, USART_CR1_UE);
+}
+
+uint32_t LinkUart_Get_Dropped(LinkUart_cfg_t* cfg)
+{
+    return cfg->dropped;
+}
+
+void LinkUart_IRQHandler(LinkUart_cfg_t* cfg)
+{
+    if (!(cfg->uart->ISR & USART_ISR_TXE)) {
+        return;
+    }
+    uint32_t tail = cfg->tx_tail;
+    if (tail == cfg->tx_head) {
+        CLEAR_BIT(cfg->uart->CR1, USART_CR1_TXEIE);
+        return;
+    }
+    cfg->uart->TDR = cfg->tx_buf[tail & LINKUART_TX_MASK];
+    cfg->tx_tail = tail + 1u;
+}
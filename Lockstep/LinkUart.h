@@ -0,0 +1,139 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file LinkUart.h
+ * @brief Board-to-board serial link for PONG_LINK_PLAY, set up at register level
+ *
+ * A full-duplex UART between two boards that never waits: received bytes are
+ * collected by a circular DMA in the background and picked up with
+ * LinkUart_Read() once a frame, and LinkUart_Send() copies a packet into a
+ * ring that the UART's TXE interrupt empties a byte at a time. Lockstep
+ * packets are 10-20 bytes, so one interrupt per byte costs less than setting
+ * up a DMA transfer for each.
+ *
+ * The UART is not one CubeMX set up: USART2 is the log, and this sets up
+ * USART3 on PC4 (TX) and PC5 (RX), AF7, on the Nucleo's morpho header. Wire
+ * PC4 to the other board's PC5 and PC5 to its PC4, and join the grounds. RX
+ * uses DMA1_Channel3 (USART3_RX, request 2), which the second LCD also can
+ * (SPI1_TX): a second panel with link play goes on SPI3 and DMA2_Channel2.
+ *
+ * The TX ring is single-producer, single-consumer, as in UartLog: only
+ * LinkUart_Send() moves head and only the interrupt moves tail.
+ *
+ * Example usage:
+ * @code
+ * LinkUart_cfg_t link_uart = {
+ *     .uart = USART3,
+ *     .dma_channel = DMA1_Channel3,   // USART3_RX
+ *     .dma_request = 2,
+ *     .baud = 115200,
+ *     .setup_done = 0
+ * };
+ *
+ * LinkUart_Init(&link_uart);
+ * LinkUart_Send(&link_uart, packet, length);
+ * uint16_t n = LinkUart_Read(&link_uart, bytes, sizeof(bytes));
+ *
+ * // In USART3_IRQHandler():
+ * LinkUart_IRQHandler(&link_uart);
+ * @endcode
+ */
+
+/**
+ * @brief Receive ring size in bytes (power of 2)
+ *
+ * At 115200 baud about 192 bytes arrive per 60Hz frame at most, so this is
+ * over two frames' worth before unread bytes are overwritten.
+ */
+#ifndef LINKUART_RX_BYTES
+#define LINKUART_RX_BYTES 512
+#endif
+
+/**
+ * @brief Send ring size in bytes (power of 2)
+ */
+#ifndef LINKUART_TX_BYTES
+#define LINKUART_TX_BYTES 256
+#endif
+
+/**
+ * @struct LinkUart_cfg_t
+ * @brief Configuration and rings for a board-to-board UART
+ */
+typedef struct {
+    USART_TypeDef* uart;                ///< UART to use (USART3; pins are set up for it on PC4/PC5)
+    DMA_Channel_TypeDef* dma_channel;   ///< DMA channel of the UART's RX request (USART3_RX: DMA1_Channel3)
+    uint8_t dma_request;                ///< DMA request number for that channel (CSELR), 2 for USART3_RX
+    uint32_t baud;                      ///< Baud rate, the same on both boards (e.g. 115200)
+    uint8_t setup_done;                 ///< Internal flag: 1 if initialized, 0 otherwise
+    uint8_t rx_buf[LINKUART_RX_BYTES];  ///< Internal: receive ring, written by the DMA
+    uint32_t rx_tail;                   ///< Internal: next ring index LinkUart_Read() returns
+    uint8_t tx_buf[LINKUART_TX_BYTES];  ///< Internal: send ring
+    volatile uint32_t tx_head;          ///< Internal: bytes queued (free-running), LinkUart_Send() only
+    volatile uint32_t tx_tail;          ///< Internal: bytes sent (free-running), interrupt only
+    uint32_t dropped;                   ///< Internal: packets dropped because the send ring was full
+} LinkUart_cfg_t;
+
+/**
+ * @brief Set up the pins, the UART and its RX DMA, and start receiving
+ *
+ * @param cfg Pointer to link configuration struct
+ */
+void LinkUart_Init(LinkUart_cfg_t* cfg);
+
+/**
+ * @brief Take the bytes received since the last call
+ *
+ * @param cfg Pointer to link configuration struct
+ * @param out Buffer for the bytes
+ * @param max Size of out; what does not fit is returned by the next call
+ * @return Number of bytes copied to out
+ */
+uint16_t LinkUart_Read(LinkUart_cfg_t* cfg, uint8_t* out, uint16_t max);
+
+/**
+ * @brief Queue a packet for sending
+ *
+ * @param cfg Pointer to link configuration struct
+ * @param data Bytes to send
+ * @param length Number of bytes
+ * @return length if queued, 0 if the packet was dropped (send ring full)
+ */
+uint16_t LinkUart_Send(LinkUart_cfg_t* cfg, const uint8_t* data, uint16_t length);
+
+/**
+ * @brief Keep the baud rate after the core clock changed (e.g. ClockProfile_Set())
+ *
+ * Waits for what is queued to go out, then works the baud rate register out
+ * again from the new APB1 clock.
+ *
+ * @param cfg Pointer to link configuration struct
+ */
+void LinkUart_Clock_Changed(LinkUart_cfg_t* cfg);
+
+/**
+ * @brief Get the number of packets dropped since LinkUart_Init()
+ *
+ * @param cfg Pointer to link configuration struct
+ * @return Dropped packet count
+ */
+uint32_t LinkUart_Get_Dropped(LinkUart_cfg_t* cfg);
+
+/**
+ * @brief UART interrupt handler (sends the next queued byte)
+ *
+ * Call from the UART's IRQ handler.
+ *
+ * @param cfg Pointer to link configuration struct
+ */
+void LinkUart_IRQHandler(LinkUart_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif
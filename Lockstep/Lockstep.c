@@ -0,0 +1,387 @@
+/**
+ * @file Lockstep.c
+ * @brief Lockstep input exchange and rollback implementation
+ */
+
+#include "Lockstep.h"
+#include "Telemetry.h"
+#include <stddef.h>
+
+#define LOCKSTEP_MASK (LOCKSTEP_WINDOW - 1u)
+
+#define PACKET_HELLO 0x01
+#define PACKET_INPUT 0x02
+#define HELLO_BYTES 8
+#define INPUT_HEADER_BYTES 6
+#define HELLO_SEEN 0x01
+
+// Inputs: direction * 17 + magnitude in 1/16ths (0-16), so 0 is the centred stick
+#define INPUT_LEVELS (REPLAY_MAGNITUDE_STEPS + 1)
+#define INPUT_CENTRE 0
+#define INPUT_MAX ((NW + 1) * INPUT_LEVELS - 1)  // 152; bytes above repeat the last input
+
+static uint8_t encode_input(UserInput input) {
+    uint8_t level = 0;
+    if (input.magnitude >= 1.0f) {
+        level = REPLAY_MAGNITUDE_STEPS;
+    } else if (input.magnitude > 0.0f) {
+        level = (uint8_t)(input.magnitude * REPLAY_MAGNITUDE_STEPS + 0.5f);
+    }
+    return (uint8_t)(input.direction * INPUT_LEVELS + level);
+}
+
+static UserInput decode_input(uint8_t code) {
+    UserInput input;
+    input.direction = (Direction)(code / INPUT_LEVELS);
+    input.magnitude = (float)(code % INPUT_LEVELS) / REPLAY_MAGNITUDE_STEPS;
+    input.angle = -1.0f;  // Not sent: the paddles only use direction and magnitude
+    return input;
+}
+
+// Full step number of the 16-bit one sent, taken as the nearest to a step known to be close
+static uint32_t unwrap(uint32_t near, uint16_t sent) {
+    return near + (uint32_t)(int32_t)(int16_t)(uint16_t)(sent - (uint16_t)near);
+}
+
+static uint8_t* put_u16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void Lockstep_Init(Lockstep_t* ls, uint32_t nonce, uint8_t input_delay) {
+    if (input_delay > LOCKSTEP_MAX_DELAY) {
+        input_delay = LOCKSTEP_MAX_DELAY;
+    }
+    ls->status = LOCKSTEP_CONNECTING;
+    ls->nonce = nonce;
+    ls->peer_nonce = 0;
+    ls->peer_seen = 0;
+    ls->side = 0;
+    ls->input_delay = input_delay;
+    ls->peer_delay = 0;
+    ls->frame = 0;
+    ls->local_count = 0;
+    ls->remote_count = 0;
+    ls->peer_ack = 0;
+    ls->saved = 0;
+    ls->rollback = 0;
+    ls->snapshot_frame = 0;
+    ls->ticks = 0;
+    ls->peer_frame = 0;
+    ls->peer_frame_tick = 0;
+    ls->advantage = 0;
+    ls->peer_advantage = 0;
+    ls->last_heard_tick = 0;
+    ls->send_countdown = 0;
+    ls->rx_length = 0;
+    ls->rollbacks = 0;
+    ls->resimulated = 0;
+    ls->stalls = 0;
+    ls->bad_packets = 0;
+    ls->bytes_sent = 0;
+}
+
+// Both boards know the HELLOs: pick sides and start at step 0. The steps before each
+// board's input delay have no input read for them, so they are the centred stick.
+static void start(Lockstep_t* ls) {
+    ls->status = LOCKSTEP_RUNNING;
+    ls->side = (ls->nonce > ls->peer_nonce) ? 0 : 1;
+    for (uint8_t f = 0; f < ls->input_delay; f++) {
+        ls->local_input[f] = INPUT_CENTRE;
+    }
+    ls->local_count = ls->input_delay;
+    for (uint8_t f = 0; f < ls->peer_delay; f++) {
+        ls->remote_input[f] = INPUT_CENTRE;
+    }
+    ls->remote_count = ls->peer_delay;
+    ls->peer_ack = ls->input_delay;
+    ls->send_countdown = 0;  // Tell the other board at once, it may be waiting for this
+}
+
+static void receive_hello(Lockstep_t* ls, const uint8_t* p) {
+    if (p[1] != LOCKSTEP_VERSION) {
+        ls->bad_packets++;
+        return;
+    }
+    uint32_t nonce = (uint32_t)get_u16(p + 4) | ((uint32_t)get_u16(p + 6) << 16);
+    if (ls->status != LOCKSTEP_CONNECTING) {
+        // The other board missed our first INPUT packet: send one again now
+        ls->send_countdown = 0;
+        return;
+    }
+    if (nonce == ls->nonce) {
+        // Either our own HELLO echoed back, or both boards picked the same number: the
+        // sides could not be told apart, so pick again
+        ls->nonce = ls->nonce * 1664525u + 1013904223u;
+        ls->peer_seen = 0;
+        return;
+    }
+    ls->peer_nonce = nonce;
+    ls->peer_delay = (p[3] > LOCKSTEP_MAX_DELAY) ? LOCKSTEP_MAX_DELAY : p[3];
+    ls->peer_seen = 1;
+    if (p[2] & HELLO_SEEN) {
+        start(ls);
+    }
+}
+
+static void receive_input(Lockstep_t* ls, const uint8_t* p, uint16_t length) {
+    if (ls->status == LOCKSTEP_LOST) {
+        return;
+    }
+    if (ls->status != LOCKSTEP_RUNNING) {
+        if (!ls->peer_seen) {
+            return;  // Not our game (the other board saw a HELLO we have not): wait for one
+        }
+        start(ls);  // Our HELLO got through, theirs said so in a packet we lost
+    }
+
+    uint32_t ack = unwrap(ls->peer_ack, get_u16(p + 1));
+    if (ack > ls->peer_ack && ack <= ls->local_count) {
+        ls->peer_ack = ack;
+    }
+
+    // Store the inputs we did not have, as far as the ring has room
+    uint32_t f = unwrap(ls->remote_count, get_u16(p + 3));
+    const uint32_t base = ls->saved ? ls->snapshot_frame : ls->frame;
+    uint8_t last = INPUT_CENTRE;
+    for (uint16_t i = INPUT_HEADER_BYTES; i < length; i++) {
+        uint8_t code = p[i];
+        uint8_t count = 1;
+        if (code > INPUT_MAX) {
+            if (i == INPUT_HEADER_BYTES) {
+                ls->bad_packets++;
+                return;
+            }
+            count = (uint8_t)(code - INPUT_MAX);
+            code = last;
+        }
+        last = code;
+        for (; count; count--, f++) {
+            if (f != ls->remote_count || f >= base + LOCKSTEP_WINDOW) {
+                continue;  // Had it already, or no room yet (it comes again in the next packet)
+            }
+            ls->remote_input[f & LOCKSTEP_MASK] = code;
+            if (f < ls->frame && ls->predicted[f & LOCKSTEP_MASK] != code) {
+                ls->rollback = 1;
+            }
+            ls->remote_count++;
+        }
+    }
+    // The packet ends at the last input the other board has, input_delay steps ahead of its game
+    ls->peer_frame = f - ls->peer_delay;
+    ls->peer_frame_tick = ls->ticks;
+    ls->peer_advantage = (int8_t)p[5];
+
+    // Every predicted step turned out right: nothing left to roll back to
+    if (ls->saved && !ls->rollback && ls->remote_count >= ls->frame) {
+        ls->saved = 0;
+    }
+}
+
+// One whole packet (COBS frame without its delimiter) has arrived
+static void receive_packet(Lockstep_t* ls) {
+    uint8_t raw[LOCKSTEP_PACKET_BYTES];
+    uint16_t n = 0;
+    uint16_t i = 0;
+    while (i < ls->rx_length) {
+        uint8_t code = ls->rx[i++];
+        for (uint8_t k = 1; k < code; k++) {
+            if (i >= ls->rx_length) {
+                ls->bad_packets++;
+                return;
+            }
+            raw[n++] = ls->rx[i++];
+        }
+        if (code != 0xFF && i < ls->rx_length) {
+            raw[n++] = 0;
+        }
+    }
+    if (n < 3 || Telemetry_CRC16(raw, n - 2) != (uint16_t)((raw[n - 2] << 8) | raw[n - 1])) {
+        ls->bad_packets++;
+        return;
+    }
+    n -= 2;
+
+    if (raw[0] == PACKET_HELLO && n == HELLO_BYTES) {
+        receive_hello(ls, raw);
+    } else if (raw[0] == PACKET_INPUT && n >= INPUT_HEADER_BYTES) {
+        receive_input(ls, raw, n);
+    } else {
+        ls->bad_packets++;
+        return;
+    }
+    ls->last_heard_tick = ls->ticks;
+}
+
+void Lockstep_Receive(Lockstep_t* ls, const uint8_t* data, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+        if (data[i] == 0x00) {
+            if (ls->rx_length > 0 && ls->rx_length <= LOCKSTEP_PACKET_BYTES) {
+                receive_packet(ls);
+            }
+            ls->rx_length = 0;
+        } else if (ls->rx_length < LOCKSTEP_PACKET_BYTES) {
+            ls->rx[ls->rx_length++] = data[i];
+        } else {
+            ls->rx_length = LOCKSTEP_PACKET_BYTES + 1;  // Too long to be ours: skip to the next 0
+        }
+    }
+}
+
+uint16_t Lockstep_Take_Packet(Lockstep_t* ls, uint8_t* out) {
+    uint8_t raw[LOCKSTEP_PACKET_BYTES];
+    uint16_t n = 0;
+    if (ls->status == LOCKSTEP_CONNECTING) {
+        raw[n++] = PACKET_HELLO;
+        raw[n++] = LOCKSTEP_VERSION;
+        raw[n++] = ls->peer_seen ? HELLO_SEEN : 0;
+        raw[n++] = ls->input_delay;
+        put_u16(raw + n, (uint16_t)ls->nonce);
+        put_u16(raw + n + 2, (uint16_t)(ls->nonce >> 16));
+        n += 4;
+    } else if (ls->status == LOCKSTEP_RUNNING && ls->send_countdown == 0) {
+        raw[n++] = PACKET_INPUT;
+        put_u16(raw + n, (uint16_t)ls->remote_count);
+        put_u16(raw + n + 2, (uint16_t)ls->peer_ack);
+        raw[n + 4] = (uint8_t)ls->advantage;
+        n += 5;
+        // Every input the other board has not acknowledged, repeats as one count byte
+        uint8_t last = 0;
+        uint8_t repeats = 0;
+        for (uint32_t f = ls->peer_ack; f < ls->local_count; f++) {
+            uint8_t code = ls->local_input[f & LOCKSTEP_MASK];
+            if (f > ls->peer_ack && code == last && repeats < 255 - INPUT_MAX) {
+                repeats++;
+                continue;
+            }
+            if (repeats) {
+                raw[n++] = (uint8_t)(INPUT_MAX + repeats);
+                repeats = 0;
+            }
+            raw[n++] = code;
+            last = code;
+        }
+        if (repeats) {
+            raw[n++] = (uint8_t)(INPUT_MAX + repeats);
+        }
+        ls->send_countdown = LOCKSTEP_SEND_INTERVAL;
+    } else {
+        return 0;
+    }
+    n = Telemetry_Encode_Packet_Body(raw, n, out);
+    ls->bytes_sent += n;
+    return n;
+}
+
+// Runs step ls->frame, on a predicted remote input if it has not arrived yet
+static void run_step(Lockstep_t* ls, PongEngine_t* engine) {
+    const uint32_t f = ls->frame;
+    uint8_t remote;
+    if (f < ls->remote_count) {
+        remote = ls->remote_input[f & LOCKSTEP_MASK];
+    } else {
+        if (!ls->saved) {
+            PongEngine_Save(engine, &ls->snapshot);
+            ls->saved = 1;
+            ls->snapshot_frame = f;
+        }
+        // The other player most likely still holds the stick where it last was
+        remote = ls->remote_input[(ls->remote_count - 1) & LOCKSTEP_MASK];
+        ls->predicted[f & LOCKSTEP_MASK] = remote;
+    }
+    UserInput local = decode_input(ls->local_input[f & LOCKSTEP_MASK]);
+    if (ls->side == 0) {
+        PongEngine_UpdateVersus(engine, local, decode_input(remote));
+    } else {
+        PongEngine_UpdateVersus(engine, decode_input(remote), local);
+    }
+    ls->frame++;
+}
+
+// Goes back to the snapshot and runs the steps since again with the inputs known now,
+// stopping early if the game ends on the way
+static void resimulate(Lockstep_t* ls, PongEngine_t* engine) {
+    const uint32_t end = ls->frame;
+    PongEngine_Restore(engine, &ls->snapshot);
+    ls->frame = ls->snapshot_frame;
+    ls->saved = 0;
+    ls->rollback = 0;
+    ls->rollbacks++;
+    ls->resimulated += end - ls->frame;
+    engine->quiet = 1;
+    while (ls->frame < end && engine->lives > 0) {
+        run_step(ls, engine);
+    }
+    engine->quiet = 0;
+}
+
+uint8_t Lockstep_Step(Lockstep_t* ls, PongEngine_t* engine, UserInput local) {
+    if (ls->status != LOCKSTEP_RUNNING) {
+        return 0;
+    }
+    ls->ticks++;
+    if (ls->ticks - ls->last_heard_tick > LOCKSTEP_TIMEOUT_STEPS) {
+        ls->status = LOCKSTEP_LOST;
+        return 0;
+    }
+    if (ls->send_countdown) {
+        ls->send_countdown--;
+    }
+
+    // A wrong prediction, or predictions that have all come true up to a point but run
+    // so long that the window is full: run them again, which also moves the snapshot
+    // up to the first step still unconfirmed
+    if (ls->rollback ||
+        (ls->saved && ls->frame - ls->snapshot_frame >= LOCKSTEP_MAX_ROLLBACK &&
+         ls->remote_count > ls->snapshot_frame)) {
+        resimulate(ls, engine);
+    }
+
+    // The game is over, on this board at least: keep the link going (and rolling back,
+    // should that turn out to be wrong) without running steps past it
+    if (engine->lives == 0) {
+        return 0;
+    }
+
+    // How far ahead of the other board we seem to be. Its last report is late by the time
+    // the packet took, which makes both boards seem ahead by as much: half the difference
+    // of the two boards' views is how far ahead this one really is.
+    int32_t advantage = (int32_t)(ls->frame - (ls->peer_frame + (ls->ticks - ls->peer_frame_tick)));
+    advantage = (advantage > 127) ? 127 : (advantage < -127) ? -127 : advantage;
+    ls->advantage = (int8_t)advantage;
+
+    // Wait for the other board: if it is well behind in time, if nothing has come from it
+    // for LOCKSTEP_MAX_ROLLBACK steps, or if it has not acknowledged a window of our inputs
+    if ((advantage - ls->peer_advantage) / 2 > LOCKSTEP_MAX_ADVANTAGE ||
+        (ls->saved && ls->frame - ls->snapshot_frame >= LOCKSTEP_MAX_ROLLBACK) ||
+        ls->local_count - ls->peer_ack >= LOCKSTEP_WINDOW) {
+        ls->stalls++;
+        return 0;
+    }
+
+    ls->local_input[ls->local_count & LOCKSTEP_MASK] = encode_input(local);
+    ls->local_count++;
+    run_step(ls, engine);
+    return 1;
+}
+
+uint8_t Lockstep_Is_Confirmed(Lockstep_t* ls) {
+    return ls->status == LOCKSTEP_RUNNING && !ls->saved;
+}
+
+Lockstep_Status_t Lockstep_Get_Status(Lockstep_t* ls) {
+    return ls->status;
+}
+
+uint8_t Lockstep_Get_Side(Lockstep_t* ls) {
+    return ls->side;
+}
+
+uint32_t Lockstep_Get_Seed(Lockstep_t* ls) {
+    return ls->nonce ^ ls->peer_nonce;
+}
@@ -0,0 +1,252 @@
+/**
+ * @file Lockstep.h
+ * @brief Two-board Pong over a serial link: lockstep input exchange with rollback
+ *
+ * Both boards run the same PongEngine from the same seed and feed it the same
+ * two inputs every step, so they stay bit-identical without ever sending game
+ * state. Only each player's joystick goes over the link, one byte per step
+ * (direction and magnitude in 1/16ths, as Replay journals it), tagged with the
+ * step it is for.
+ *
+ * - **Input delay**: the local input read at step f is used at step
+ *   f + input_delay on both boards. That is how long the other board has to
+ *   receive it before it is needed, so with a delay longer than the link takes
+ *   neither board ever has to guess.
+ * - **Rollback**: if the other player's input for a step has not arrived yet,
+ *   the step runs with a prediction (their last input) and the engine state
+ *   from before it is saved (PongEngine_Save()). When the real input arrives
+ *   and differs, the state is restored and the steps since run again, silently,
+ *   in the same call. At most LOCKSTEP_MAX_ROLLBACK steps are predicted; after
+ *   that the engine waits for the other board (Lockstep_Step() returns 0 and
+ *   the caller just draws the same frame again).
+ * - **Time sync**: each packet tells the other board how far its game is,
+ *   and how far ahead of it the sender seems to be. A board more than
+ *   LOCKSTEP_MAX_ADVANTAGE steps ahead of the other skips a step, so two
+ *   clocks a little apart do not drift into constant rollbacks.
+ *
+ * Nothing here waits for the link. Received bytes are handed to
+ * Lockstep_Receive() and packets to send come out of Lockstep_Take_Packet(),
+ * so the transport (LinkUart.h on the board, anything on a PC) stays separate
+ * and this file builds with PONG_HEADLESS.
+ *
+ * **Packets** (little-endian), each followed by its CRC-16 (Telemetry_CRC16()),
+ * COBS encoded and ended by a 0x00 by Telemetry_Encode_Packet_Body():
+ * - HELLO: type, version, flags (bit 0: your HELLO was received), input
+ *   delay, nonce (4 bytes). Sent while connecting; the board with the larger
+ *   nonce plays the left paddle, and both seed the game from the two nonces.
+ * - INPUT: type, ack (2 bytes: the sender has the receiver's inputs for all
+ *   steps before this), first step (2 bytes), how many steps the sender seems
+ *   to be ahead (signed), then the sender's inputs from that step on.
+ *   Inputs are 0-152; a byte of 153 or more repeats the one before
+ *   (byte - 152) more times, so a held stick costs one byte whatever the
+ *   count. Only the low 16 bits of step numbers are sent.
+ *
+ * An INPUT packet every LOCKSTEP_SEND_INTERVAL steps carries every input the
+ * other board has not acknowledged yet, so a lost or corrupted packet costs
+ * nothing but the wait for the next one. In play that is 12-13 bytes 20
+ * times a second at 60Hz, some 250 bytes/s.
+ *
+ * Example usage (see main.c for the board's version):
+ * @code
+ * Lockstep_Init(&lockstep, Random_U32(), LOCKSTEP_INPUT_DELAY);
+ * while (Lockstep_Get_Status(&lockstep) == LOCKSTEP_CONNECTING) {
+ *     // pass bytes both ways, every 50ms or so
+ * }
+ * Random_Seed(Lockstep_Get_Seed(&lockstep));
+ * PongEngine_Init(&engine, ...);
+ *
+ * // Every physics step:
+ * Lockstep_Step(&lockstep, &engine, Joystick_GetInput(&joystick_data));
+ * @endcode
+ */
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <stdint.h>
+#include "PongEngine.h"
+
+// Default steps between reading a local input and using it (3 = 50ms at 60Hz). More hides a
+// slower link; less is more responsive but needs more rollbacks.
+#ifndef LOCKSTEP_INPUT_DELAY
+#define LOCKSTEP_INPUT_DELAY 3
+#endif
+
+// Most steps run on a predicted input before waiting for the other board. Also the most
+// steps a rollback runs again in one call.
+#ifndef LOCKSTEP_MAX_ROLLBACK
+#define LOCKSTEP_MAX_ROLLBACK 8
+#endif
+
+// Steps between INPUT packets (3 = 20 packets/s at 60Hz)
+#ifndef LOCKSTEP_SEND_INTERVAL
+#define LOCKSTEP_SEND_INTERVAL 3
+#endif
+
+// Steps a board may be ahead of the other before it skips one
+#ifndef LOCKSTEP_MAX_ADVANTAGE
+#define LOCKSTEP_MAX_ADVANTAGE 2
+#endif
+
+// Steps without a packet from the other board before the link counts as lost (3s at 60Hz)
+#ifndef LOCKSTEP_TIMEOUT_STEPS
+#define LOCKSTEP_TIMEOUT_STEPS (3 * PONG_PHYSICS_HZ)
+#endif
+
+// Steps of input kept for each side (power of 2)
+#define LOCKSTEP_WINDOW 64
+#define LOCKSTEP_MAX_DELAY 16
+
+#define LOCKSTEP_VERSION 1
+
+// Largest packet on the wire: an INPUT header, a window of distinct inputs and the CRC,
+// plus the COBS code byte and the delimiter
+#define LOCKSTEP_PACKET_BYTES (6 + LOCKSTEP_WINDOW + 2 + 2)
+
+#if (LOCKSTEP_WINDOW & (LOCKSTEP_WINDOW - 1)) != 0
+#error "LOCKSTEP_WINDOW must be a power of 2"
+#endif
+#if LOCKSTEP_MAX_ROLLBACK + 2 * LOCKSTEP_MAX_DELAY >= LOCKSTEP_WINDOW
+#error "LOCKSTEP_MAX_ROLLBACK is too large for LOCKSTEP_WINDOW"
+#endif
+
+/**
+ * @enum Lockstep_Status_t
+ * @brief State of the link
+ */
+typedef enum {
+    LOCKSTEP_CONNECTING = 0,    ///< Looking for the other board (HELLO packets)
+    LOCKSTEP_RUNNING,           ///< Both boards have the seed and sides: play
+    LOCKSTEP_LOST               ///< Nothing heard for LOCKSTEP_TIMEOUT_STEPS
+} Lockstep_Status_t;
+
+/**
+ * @struct Lockstep_t
+ * @brief Link state, input history and rollback snapshot
+ *
+ * Step numbers are counted from the start of the game. Inputs live in rings
+ * of LOCKSTEP_WINDOW steps, indexed by step number.
+ */
+typedef struct {
+    Lockstep_Status_t status;
+    uint32_t nonce;                 // Ours, chosen at Lockstep_Init()
+    uint32_t peer_nonce;            // The other board's, from its HELLO
+    uint8_t peer_seen;              // The other board's HELLO has been received
+    uint8_t side;                   // Paddle played here: 0 = left, 1 = right
+    uint8_t input_delay;            // Steps between reading and using a local input
+    uint8_t peer_delay;             // The other board's input delay
+    uint32_t frame;                 // Next step the engine runs
+    uint32_t local_count;           // Local inputs known: steps before this
+    uint32_t remote_count;          // Remote inputs received: steps before this
+    uint32_t peer_ack;              // Local inputs the other board has: steps before this
+    uint8_t local_input[LOCKSTEP_WINDOW];
+    uint8_t remote_input[LOCKSTEP_WINDOW];
+    uint8_t predicted[LOCKSTEP_WINDOW];  // Remote input guessed for steps from remote_count on
+    uint8_t saved;                  // snapshot holds the state before step snapshot_frame
+    uint8_t rollback;               // A remote input arrived that differs from its prediction
+    uint32_t snapshot_frame;        // First step run on a predicted input
+    PongEngine_Snapshot_t snapshot;
+    uint32_t ticks;                 // Lockstep_Step() calls while running
+    uint32_t peer_frame;            // The other board's next step when it last sent...
+    uint32_t peer_frame_tick;       // ...and ticks then
+    int8_t advantage;               // Steps we seem to be ahead of the other board
+    int8_t peer_advantage;          // Steps the other board seems to be ahead of us, as it sent
+    uint32_t last_heard_tick;       // ticks when a packet last arrived
+    uint8_t send_countdown;         // Steps until the next INPUT packet is due
+    uint8_t rx[LOCKSTEP_PACKET_BYTES];  // Packet being received (still COBS encoded)
+    uint8_t rx_length;              // Bytes in rx; above LOCKSTEP_PACKET_BYTES: skip to the next 0
+    // Statistics
+    uint32_t rollbacks;             // Times the state was restored
+    uint32_t resimulated;           // Steps run again after a restore
+    uint32_t stalls;                // Steps skipped waiting for the other board or to let it catch up
+    uint32_t bad_packets;           // Packets dropped for a bad CRC, length or type
+    uint32_t bytes_sent;            // Bytes handed out by Lockstep_Take_Packet()
+} Lockstep_t;
+
+/**
+ * @brief Start looking for the other board
+ *
+ * @param ls Pointer to link state
+ * @param nonce Random number, different on each board (e.g. from the hardware RNG)
+ * @param input_delay Steps between reading and using a local input (up to LOCKSTEP_MAX_DELAY)
+ */
+void Lockstep_Init(Lockstep_t* ls, uint32_t nonce, uint8_t input_delay);
+
+/**
+ * @brief Hand over bytes received from the other board
+ *
+ * Any amount at a time, split anywhere; damaged packets are dropped.
+ *
+ * @param ls Pointer to link state
+ * @param data Bytes received
+ * @param length Number of bytes
+ */
+void Lockstep_Receive(Lockstep_t* ls, const uint8_t* data, uint16_t length);
+
+/**
+ * @brief Get the next packet to send, if one is due
+ *
+ * While connecting there is a HELLO every call, so call it at the rate HELLOs
+ * should go out. While running there is an INPUT packet every
+ * LOCKSTEP_SEND_INTERVAL steps, and straight away after connecting.
+ *
+ * @param ls Pointer to link state
+ * @param out Buffer of at least LOCKSTEP_PACKET_BYTES
+ * @return Bytes to send (0 if nothing is due)
+ */
+uint16_t Lockstep_Take_Packet(Lockstep_t* ls, uint8_t* out);
+
+/**
+ * @brief Run one physics step of the linked game
+ *
+ * Call every physics step instead of PongEngine_Update() (the engine must have
+ * been set up with PongEngine_Init() after seeding with Lockstep_Get_Seed()).
+ * Schedules the local input for step frame + input_delay, rolls back if a
+ * remote input proved a prediction wrong, then runs the next step, unless the
+ * other board is too far behind. Once the game is over (no lives) no more
+ * steps run, but keep calling it until Lockstep_Is_Confirmed(), and for a
+ * moment after so the other board gets the last inputs too.
+ *
+ * @param ls Pointer to link state
+ * @param engine Pointer to game engine
+ * @param local This board's joystick input
+ * @return 1 if the engine ran a step, 0 if it waited (or the link is not running)
+ */
+uint8_t Lockstep_Step(Lockstep_t* ls, PongEngine_t* engine, UserInput local);
+
+/**
+ * @brief Check whether every step the engine has run used real inputs only
+ *
+ * Anything seen on a step that ran on a prediction (a point, game over) may
+ * still be undone by a rollback.
+ *
+ * @param ls Pointer to link state
+ * @return 1 if no step is waiting for the other board's input, 0 otherwise
+ */
+uint8_t Lockstep_Is_Confirmed(Lockstep_t* ls);
+
+/**
+ * @brief Get the state of the link
+ *
+ * @param ls Pointer to link state
+ * @return Connecting, running or lost
+ */
+Lockstep_Status_t Lockstep_Get_Status(Lockstep_t* ls);
+
+/**
+ * @brief Get the paddle this board plays
+ *
+ * @param ls Pointer to link state
+ * @return 0 for the left paddle, 1 for the right (valid once running)
+ */
+uint8_t Lockstep_Get_Side(Lockstep_t* ls);
+
+/**
+ * @brief Get the random seed both boards start the game from
+ *
+ * @param ls Pointer to link state
+ * @return Seed for Random_Seed() (valid once running)
+ */
+uint32_t Lockstep_Get_Seed(Lockstep_t* ls);
+
+#endif // LOCKSTEP_H
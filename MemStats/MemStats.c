@@ -0,0 +1,72 @@
+#include "MemStats.h"
+#include <stdio.h>
+
+/**
+ * @file MemStats.c
+ * @brief Implementation of the stack painting and heap peak queries
+ *
+ * Painting starts at the highest the heap has reached, not at _end, and so
+ * does the scan: words the heap has taken are never mistaken for stack. The
+ * heap can grow into painted RAM afterwards, the scan then starts above it.
+ */
+
+// Symbols defined in the linker script
+extern uint8_t _end;
+extern uint8_t _estack;
+extern uint32_t _Min_Stack_Size;
+
+// Highest heap end _sbrk() has handed out (sysmem.c), NULL until the first allocation
+extern uint8_t* __sbrk_heap_peak;
+
+// Words left unpainted below the stack pointer when painting, for the painting call itself
+#define PAINT_MARGIN_WORDS 8
+
+static uint32_t* heap_top(void)
+{
+    uintptr_t top = (uintptr_t)(__sbrk_heap_peak ? __sbrk_heap_peak : &_end);
+    return (uint32_t*)((top + 3u) & ~(uintptr_t)3u);
+}
+
+void MemStats_Paint_Stack(void)
+{
+    volatile uint32_t* word = heap_top();
+    volatile uint32_t* stop = (uint32_t*)(__get_MSP() & ~3u) - PAINT_MARGIN_WORDS;
+
+    while (word < stop) {
+        *word++ = MEMSTATS_STACK_PAINT;
+    }
+}
+
+uint32_t MemStats_Get_Stack_Used(void)
+{
+    const uint32_t* word = heap_top();
+    const uint32_t* top = (const uint32_t*)&_estack;
+
+    while (word < top && *word == MEMSTATS_STACK_PAINT) {
+        word++;
+    }
+    return (uint32_t)((uintptr_t)top - (uintptr_t)word);
+}
+
+uint32_t MemStats_Get_Stack_Reserved(void)
+{
+    return (uint32_t)(uintptr_t)&_Min_Stack_Size;
+}
+
+uint32_t MemStats_Get_Heap_Peak(void)
+{
+    return __sbrk_heap_peak ? (uint32_t)(__sbrk_heap_peak - &_end) : 0;
+}
+
+void MemStats_Report(void)
+{
+    uint32_t stack_used = MemStats_Get_Stack_Used();
+    uint32_t stack_reserved = MemStats_Get_Stack_Reserved();
+    uint32_t gap = (uint32_t)((uintptr_t)&_estack - (uintptr_t)heap_top());
+
+    printf("Stack: %lu of %lu bytes reserved%s, heap peak: %lu bytes, unused RAM: %lu bytes\n",
+           (unsigned long)stack_used, (unsigned long)stack_reserved,
+           stack_used > stack_reserved ? " (OVER)" : "",
+           (unsigned long)MemStats_Get_Heap_Peak(),
+           (unsigned long)(gap - stack_used));
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file MemStats.h
+ * @brief Run-time stack high-water mark and peak heap use
+ *
+ * The stack grows down from _estack into the RAM the linker leaves after
+ * .bss and the heap (see sysmem.c). MemStats_Paint_Stack() fills the unused
+ * part of that gap with a known word, and MemStats_Get_Stack_Used() later
+ * scans up from the heap end for the first word that was overwritten, so it
+ * reports the deepest the stack has been since painting, interrupts included.
+ *
+ * The static part of the budget (.data, .bss, the image buffer, line buffers,
+ * fonts, ...) is reported per module after every build by
+ * MemStats/mem_report.py from the linker map file.
+ *
+ * Example usage:
+ * @code
+ * int main(void) {
+ *     MemStats_Paint_Stack();   // first thing, before anything deep is called
+ *     ...
+ *     // Now and then:
+ *     MemStats_Report();        // printf
+ * }
+ * @endcode
+ */
+
+/**
+ * @brief Word left in unused stack
+ */
+#define MEMSTATS_STACK_PAINT 0xC5C5C5C5u
+
+/**
+ * @brief Fill the free RAM between the heap end and the stack pointer
+ *
+ * @details Stops a few words below the current stack pointer, so the
+ *          caller's own frame is kept. Call once, early in main().
+ */
+void MemStats_Paint_Stack(void);
+
+/**
+ * @brief Deepest the stack has been since MemStats_Paint_Stack()
+ *
+ * @return Bytes between _estack and the lowest overwritten word
+ */
+uint32_t MemStats_Get_Stack_Used(void);
+
+/**
+ * @brief Stack the linker reserves (_Min_Stack_Size)
+ *
+ * @note The heap stops short of this, but the stack is not stopped from
+ *       growing past it into the heap. Used above reserved means it did.
+ */
+uint32_t MemStats_Get_Stack_Reserved(void);
+
+/**
+ * @brief Highest the heap has grown, in bytes above _end
+ *
+ * @details Tracked by _sbrk() in sysmem.c. newlib-nano's printf allocates
+ *          on first use (and more with float support), so this is usually
+ *          a few hundred bytes rather than 0.
+ */
+uint32_t MemStats_Get_Heap_Peak(void);
+
+/**
+ * @brief printf the stack high-water mark and the peak heap use
+ */
+void MemStats_Report(void);
+
+#ifdef __cplusplus
+}
+#endif
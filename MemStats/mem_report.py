@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+"""Print the RAM each module takes, from the GNU ld map file of a build.
+
+Run after every build by CMakeLists.txt, or by hand:
+
+    python3 mem_report.py build/Debug/Unit_4_1_Pong.map
+    python3 mem_report.py --top 20 --members build/Debug/Unit_4_1_Pong.map
+
+A missing map, or one in another linker's layout (lld's, from the BenchClang
+preset), gets a warning and no report, and never fails the build.
+
+Every output section placed in a writable memory region (.data, .bss,
+.sram1, .sram2, ...) gets a column, and every object file a row with the
+bytes it puts in each. Then the largest single variables (the compiler puts
+each one in its own section with -fdata-sections, so image_buffer, the line
+buffers and font5x7_ show up by name), the heap and stack the linker
+reserves, and how full each RAM region is.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+HEX = r"0x[0-9a-fA-F]+"
+REGION_RE = re.compile(r"^(\S+)\s+(%s)\s+(%s)\s*(\S*)$" % (HEX, HEX))
+SECTION_RE = re.compile(r"^(\S+)(?:\s+(%s)\s+(%s))?" % (HEX, HEX))
+WRAPPED_RE = re.compile(r"^\s+(%s)\s+(%s)(?:\s+(\S.*))?$" % (HEX, HEX))
+INPUT_RE = re.compile(r"^ (\S+)(?:\s+(%s)\s+(%s)(?:\s+(\S.*))?)?$" % (HEX, HEX))
+SYMBOL_RE = re.compile(r"^\s+(%s)\s+([A-Za-z_][\w.$]*)$" % HEX)
+ASSIGN_RE = re.compile(r"^\s+%s\s+(_Min_Heap_Size|_Min_Stack_Size)\s*=\s*(%s)" % (HEX, HEX))
+NAME_WIDTH = 28
+
+# Reserved by the linker script for the heap and the stack rather than by a module
+HEAP_STACK_SECTION = "._user_heap_stack"
+
+
+def module_name(path, members):
+    """Object file name without its directory and extension, or its archive."""
+    match = re.match(r"^(.*\.a)\((.*)\)$", path)
+    if match:
+        archive = os.path.basename(match.group(1))
+        return "%s(%s)" % (archive, match.group(2)) if members else archive
+    name = os.path.basename(path)
+    for ext in (".obj", ".o"):
+        if name.endswith(ext):
+            name = name[: -len(ext)]
+    return name
+
+
+def read_map(path):
+    """Return (regions, output sections, input sections, linker symbols) of a map file.
+
+    regions: [(name, origin, length, attributes)]
+    output sections: [(name, address, size)]
+    input sections: [(output section, input section, address, size, file, [(address, symbol)])]
+    """
+    regions = []
+    outputs = []
+    inputs = []
+    symbols = {}
+    part = None
+    pending = None  # (kind, name) of a section whose address and size wrapped to the next line
+    current = None
+
+    with open(path, errors="replace") as map_file:
+        for line in map_file:
+            line = line.rstrip("\r\n")
+            if line.startswith("Memory Configuration"):
+                part = "regions"
+                continue
+            if line.startswith("Linker script and memory map"):
+                part = "map"
+                continue
+            if part == "regions":
+                match = REGION_RE.match(line)
+                if match and match.group(1) != "*default*":
+                    regions.append((match.group(1), int(match.group(2), 16),
+                                    int(match.group(3), 16), match.group(4)))
+                continue
+            if part != "map":
+                continue
+
+            match = ASSIGN_RE.match(line)
+            if match:
+                symbols[match.group(1)] = int(match.group(2), 16)
+                continue
+
+            if pending:
+                kind, name = pending
+                pending = None
+                match = WRAPPED_RE.match(line)
+                if match:
+                    address, size = int(match.group(1), 16), int(match.group(2), 16)
+                    if kind == "output":
+                        current = name
+                        outputs.append((name, address, size))
+                    elif current and size:
+                        inputs.append((current, name, address, size, match.group(3) or "", []))
+                    continue
+
+            if line and not line[0].isspace():
+                match = SECTION_RE.match(line)
+                if match and match.group(1).startswith("."):
+                    if match.group(2) is None:
+                        pending = ("output", match.group(1))
+                    else:
+                        current = match.group(1)
+                        outputs.append((current, int(match.group(2), 16), int(match.group(3), 16)))
+                else:
+                    current = None
+                continue
+
+            match = INPUT_RE.match(line)
+            if match and current:
+                name = match.group(1)
+                if match.group(2) is None:
+                    if not name.startswith("*(") and not name.startswith("*"):
+                        pending = ("input", name)
+                    continue
+                size = int(match.group(3), 16)
+                if size:
+                    inputs.append((current, name, int(match.group(2), 16), size, match.group(4) or "", []))
+                continue
+
+            match = SYMBOL_RE.match(line)
+            if match and inputs and inputs[-1][0] == current:
+                inputs[-1][5].append((int(match.group(1), 16), match.group(2)))
+
+    return regions, outputs, inputs, symbols
+
+
+def region_of(regions, address):
+    for region in regions:
+        if region[1] <= address < region[1] + region[2]:
+            return region
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="linker map file (-Wl,-Map=...)")
+    parser.add_argument("--top", type=int, default=10, help="largest variables to list (0 for none)")
+    parser.add_argument("--members", action="store_true", help="split library archives into their objects")
+    args = parser.parse_args()
+
+    if not os.path.isfile(args.map):
+        print("mem_report.py: no map file %s, no RAM report" % args.map, file=sys.stderr)
+        return
+    regions, outputs, inputs, symbols = read_map(args.map)
+    if not outputs:
+        print("mem_report.py: no GNU ld memory map in %s, no RAM report" % args.map, file=sys.stderr)
+        return
+
+    ram_regions = [r for r in regions if "w" in r[3].lower()] or regions
+    ram_sections = []
+    for name, address, size in outputs:
+        if size and region_of(ram_regions, address) and name not in ram_sections:
+            ram_sections.append(name)
+    columns = [name for name in ram_sections if name != HEAP_STACK_SECTION]
+
+    modules = {}
+    variables = []
+    for section, input_section, address, size, path, section_symbols in inputs:
+        if section not in columns:
+            continue
+        module = "(padding)" if input_section == "*fill*" else module_name(path, args.members)
+        row = modules.setdefault(module, dict.fromkeys(columns, 0))
+        row[section] += size
+        # .bss.image_buffer -> image_buffer
+        prefix = section + "."
+        if input_section.startswith(prefix) and input_section != prefix:
+            variables.append((size, input_section[len(prefix):], module))
+        elif section_symbols:
+            # Several variables share a section (.sram1, .sram2): each runs to the next one
+            ends = [a for a, _ in section_symbols[1:]] + [address + size]
+            for (start, name), end in zip(section_symbols, ends):
+                variables.append((end - start, name, module))
+        elif input_section != "*fill*":
+            # Static variables are not listed by name
+            variables.append((size, input_section, module))
+
+    print("RAM by module (bytes)")
+    print("%-*s" % (NAME_WIDTH, "module") + "".join("%9s" % c for c in columns) + "%9s" % "total")
+    totals = dict.fromkeys(columns, 0)
+    for module, row in sorted(modules.items(), key=lambda item: -sum(item[1].values())):
+        print("%-*s" % (NAME_WIDTH, module[:NAME_WIDTH])
+              + "".join("%9d" % row[c] for c in columns) + "%9d" % sum(row.values()))
+        for c in columns:
+            totals[c] += row[c]
+    print("%-*s" % (NAME_WIDTH, "total") + "".join("%9d" % totals[c] for c in columns)
+          + "%9d" % sum(totals.values()))
+
+    if args.top and variables:
+        print("\nLargest variables")
+        for size, name, module in sorted(variables, reverse=True)[: args.top]:
+            print("%9d  %-32s %s" % (size, name, module))
+
+    if "_Min_Heap_Size" in symbols or "_Min_Stack_Size" in symbols:
+        print("\nReserved: heap %d, stack %d bytes (the stack can grow into any RAM left over)"
+              % (symbols.get("_Min_Heap_Size", 0), symbols.get("_Min_Stack_Size", 0)))
+
+    print("\nRAM regions")
+    for region in ram_regions:
+        used = sum(size for _, address, size in outputs
+                   if size and region_of([region], address))
+        print("%-8s %7d of %7d bytes used (%5.1f%%), %7d free"
+              % (region[0], used, region[2], 100.0 * used / region[2] if region[2] else 0, region[2] - used))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,271 @@
+#include "Mixer.h"
+#include "DmaChannel.h"
+#include "DmaBuffer.h"
+#include "ClockProfile.h"
+#include <stddef.h>
+
+/**
+ * @file Mixer.c
+ * @brief Implementation of the buzzer mixer
+ *
+ * Each voice is added into the block in turn, over the samples it sounds in:
+ * a sound that starts or ends within the block covers only part of it. The
+ * sum is clamped to the timer period only when the voices' amplitudes could
+ * add up past it. A block with nothing playing is written as 0 (output low)
+ * twice, once into each half, and then left alone.
+ *
+ * Mixer_Play() never touches the voices. It publishes the sound in the ring,
+ * and the interrupt moves it onto a voice at the start of its next block.
+ */
+
+#define MIXER_QUEUE_MASK (MIXER_QUEUE_LEN - 1)
+
+// 16-bit samples into the 32-bit CCR, the whole buffer one circular run
+DMA_BUFFER_CHECK(((Mixer_cfg_t*)0)->buffer, 2);
+
+// The buzzer channel's CCR (TIM_CHANNEL_1 = 0x0 .. TIM_CHANNEL_4 = 0xC)
+static volatile uint32_t* channel_ccr(Buzzer_cfg_t* buzzer)
+{
+    return &buzzer->htim->Instance->CCR1 + (buzzer->channel >> 2);
+}
+
+// Timer period for the sample rate at the timer's current clock
+static uint32_t sample_period(Mixer_cfg_t* cfg)
+{
+    uint32_t period = ClockProfile_Timer_Hz(cfg->buzzer->htim->Instance) / cfg->sample_rate_hz;
+    // Kept to 14 bits so that MIXER_VOICES half-periods still add up within a uint16_t sample
+    if (period < 2u) period = 2u;
+    if (period > 0x4000u) period = 0x4000u;
+    return period;
+}
+
+// Samples in a length of time at the sample rate
+static uint32_t ms_to_samples(Mixer_cfg_t* cfg, uint32_t ms)
+{
+    return (ms * cfg->sample_rate_hz) / 1000u;
+}
+
+void Mixer_Init(Mixer_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+    Buzzer_cfg_t* buzzer = cfg->buzzer;
+    DMA_Channel_TypeDef* channel = buzzer->dma_channel;
+    if (channel == NULL || DmaChannel_Claim(channel, buzzer->dma_request, cfg, "Mixer") != DMACHANNEL_OK) {
+        return;
+    }
+
+    cfg->head = 0;
+    cfg->tail = 0;
+    cfg->active = 0;
+    cfg->dropped = 0;
+    cfg->stolen = 0;
+    cfg->peak_cycles = 0;
+    cfg->silent_halves = 2;
+    for (uint32_t i = 0; i < MIXER_VOICES; i++) {
+        cfg->voices[i].remaining = 0;
+    }
+    for (uint32_t i = 0; i < 2u * MIXER_BLOCK_SAMPLES; i++) {
+        cfg->buffer[i] = 0;
+    }
+
+    // One PWM period per sample, the period and duty preloaded so each is played whole
+    TIM_TypeDef* tim = buzzer->htim->Instance;
+    const uint32_t index = buzzer->channel >> 2;
+    volatile uint32_t* ccmr = (index < 2u) ? &tim->CCMR1 : &tim->CCMR2;
+    *ccmr |= TIM_CCMR1_OC1PE << (8u * (index & 1u));
+    const uint32_t period = sample_period(cfg);
+    cfg->range = (uint16_t)period;
+    tim->CR1 |= TIM_CR1_ARPE;
+    tim->PSC = 0;
+    tim->ARR = period - 1u;
+    *channel_ccr(buzzer) = 0;
+    tim->CNT = 0;
+    tim->EGR = TIM_EGR_UG;
+
+    // Circular, 16-bit samples into the 32-bit CCR, an interrupt at each half
+    channel->CCR = 0;
+    DmaChannel_Clear_Flags(channel);
+    channel->CPAR = (uint32_t)channel_ccr(buzzer);
+    channel->CMAR = (uint32_t)cfg->buffer;
+    channel->CNDTR = 2u * MIXER_BLOCK_SAMPLES;
+    channel->CCR = DMA_CCR_PL_0 | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_1 | DMA_CCR_MINC | DMA_CCR_CIRC |
+                   DMA_CCR_DIR | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
+    IRQn_Type irqn = DmaChannel_IRQn(channel);
+    NVIC_SetPriority(irqn, 3);
+    NVIC_EnableIRQ(irqn);
+
+    __HAL_TIM_CLEAR_FLAG(buzzer->htim, TIM_FLAG_UPDATE);
+    __HAL_TIM_ENABLE_DMA(buzzer->htim, TIM_DMA_UPDATE);
+    if (!buzzer->pwm_started) {
+        HAL_TIM_PWM_Start(buzzer->htim, buzzer->channel);
+        buzzer->pwm_started = 1;
+    }
+    cfg->setup_done = 1;
+}
+
+uint8_t Mixer_Play(Mixer_cfg_t* cfg, uint16_t freq_hz, uint8_t volume_percent, uint16_t duration_ms,
+                   uint16_t delay_ms)
+{
+    if (!cfg->setup_done) {
+        cfg->dropped++;
+        return 0;
+    }
+    uint8_t head = cfg->head;
+    if ((uint8_t)(head - cfg->tail) >= MIXER_QUEUE_LEN) {
+        cfg->dropped++;
+        return 0;
+    }
+
+    // The division is done here, once, rather than in the interrupt
+    if (freq_hz > cfg->sample_rate_hz / 2u) {
+        freq_hz = (uint16_t)(cfg->sample_rate_hz / 2u);
+    }
+    Mixer_Sound_t* sound = &cfg->queue[head & MIXER_QUEUE_MASK];
+    sound->step = (uint32_t)(((uint64_t)freq_hz << 32) / cfg->sample_rate_hz);
+    sound->delay = ms_to_samples(cfg, delay_ms);
+    sound->length = (freq_hz == 0) ? 0u : ms_to_samples(cfg, duration_ms);
+    sound->volume_percent = (volume_percent > 100u) ? 100u : volume_percent;
+
+    // The sound must be in memory before the interrupt can see the new head
+    __DMB();
+    cfg->head = head + 1;
+    return 1;
+}
+
+uint8_t Mixer_Is_Idle(Mixer_cfg_t* cfg)
+{
+    return (cfg->head == cfg->tail && !cfg->active) ? 1u : 0u;
+}
+
+void Mixer_Clock_Changed(Mixer_cfg_t* cfg)
+{
+    if (!cfg->setup_done) {
+        return;
+    }
+    // Preloaded: taken at the next update. Samples already mixed for the old period are at
+    // most one block, and clamped by the timer to a full-on period at worst
+    const uint32_t period = sample_period(cfg);
+    cfg->buzzer->htim->Instance->ARR = period - 1u;
+    cfg->range = (uint16_t)period;
+}
+
+// Moves the queued sounds onto voices: a free one, or else the one with the least left
+static void start_sounds(Mixer_cfg_t* cfg)
+{
+    uint8_t tail = cfg->tail;
+    while (tail != cfg->head) {
+        const Mixer_Sound_t* sound = &cfg->queue[tail & MIXER_QUEUE_MASK];
+        if (sound->length > 0 && sound->volume_percent > 0) {
+            Mixer_Voice_t* voice = &cfg->voices[0];
+            for (uint32_t i = 1; i < MIXER_VOICES && voice->remaining > 0; i++) {
+                if (cfg->voices[i].remaining < voice->remaining) {
+                    voice = &cfg->voices[i];
+                }
+            }
+            if (voice->remaining > 0) {
+                cfg->stolen++;
+            }
+            voice->phase = 0;
+            voice->step = sound->step;
+            voice->delay = sound->delay;
+            voice->remaining = sound->length;
+            voice->volume_percent = sound->volume_percent;
+        }
+        tail++;
+    }
+    __DMB();
+    cfg->tail = tail;
+}
+
+// Mixes the next MIXER_BLOCK_SAMPLES samples into out
+static void mix_block(Mixer_cfg_t* cfg, uint16_t* out)
+{
+    start_sounds(cfg);
+
+    // Amplitude of each voice when high: 100% on its own is a 50% duty, as buzzer_tone()
+    const uint32_t full = cfg->range - 1u;
+    uint32_t total = 0;
+    uint8_t active = 0;
+    for (uint32_t i = 0; i < MIXER_VOICES; i++) {
+        if (cfg->voices[i].remaining > 0) {
+            total += (cfg->range / 2u) * cfg->voices[i].volume_percent / 100u;
+            active++;
+        }
+    }
+    cfg->active = active;
+    if (active == 0) {
+        if (cfg->silent_halves < 2u) {
+            for (uint32_t s = 0; s < MIXER_BLOCK_SAMPLES; s++) {
+                out[s] = 0;
+            }
+            cfg->silent_halves++;
+        }
+        return;
+    }
+    cfg->silent_halves = 0;
+
+    for (uint32_t s = 0; s < MIXER_BLOCK_SAMPLES; s++) {
+        out[s] = 0;
+    }
+    for (uint32_t i = 0; i < MIXER_VOICES; i++) {
+        Mixer_Voice_t* voice = &cfg->voices[i];
+        if (voice->remaining == 0) {
+            continue;
+        }
+        // Waiting to start: the part of the block before the start is left as it is
+        uint32_t first = 0;
+        if (voice->delay > 0) {
+            first = (voice->delay < MIXER_BLOCK_SAMPLES) ? voice->delay : MIXER_BLOCK_SAMPLES;
+            voice->delay -= first;
+        }
+        uint32_t last = MIXER_BLOCK_SAMPLES;
+        if (voice->remaining < last - first) {
+            last = first + voice->remaining;
+        }
+        voice->remaining -= last - first;
+
+        const uint16_t amplitude = (uint16_t)((cfg->range / 2u) * voice->volume_percent / 100u);
+        uint32_t phase = voice->phase;
+        const uint32_t step = voice->step;
+        for (uint32_t s = first; s < last; s++) {
+            phase += step;
+            if (phase & 0x80000000u) {
+                out[s] += amplitude;
+            }
+        }
+        voice->phase = phase;
+    }
+
+    // Only when the voices could together go past a full period
+    if (total > full) {
+        for (uint32_t s = 0; s < MIXER_BLOCK_SAMPLES; s++) {
+            if (out[s] > full) {
+                out[s] = (uint16_t)full;
+            }
+        }
+    }
+}
+
+void Mixer_DMA_IRQHandler(Mixer_cfg_t* cfg)
+{
+    DMA_Channel_TypeDef* channel = cfg->buzzer->dma_channel;
+    DMA_TypeDef* dma = DmaChannel_Controller(channel);
+    const uint32_t shift = DmaChannel_Flag_Shift(channel);
+    const uint32_t isr = dma->ISR;
+    dma->IFCR = (DMA_IFCR_CHTIF1 | DMA_IFCR_CTCIF1 | DMA_IFCR_CGIF1) << shift;
+
+    const uint32_t start = DWT->CYCCNT;
+    // Half way, the DMA has gone on to the second half: the first is free, and the other way round
+    if (isr & (DMA_ISR_HTIF1 << shift)) {
+        mix_block(cfg, &cfg->buffer[0]);
+    }
+    if (isr & (DMA_ISR_TCIF1 << shift)) {
+        mix_block(cfg, &cfg->buffer[MIXER_BLOCK_SAMPLES]);
+    }
+    const uint32_t cycles = DWT->CYCCNT - start;
+    if (cycles > cfg->peak_cycles) {
+        cfg->peak_cycles = cycles;
+    }
+}
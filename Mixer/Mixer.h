@@ -0,0 +1,182 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+#include "Buzzer.h"
+#include "DmaBuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Mixer.h
+ * @brief Polyphonic buzzer sounds: voices mixed into PWM samples streamed by DMA
+ *
+ * A Buzzer library instance plays one square wave, so a sound started while
+ * another is playing cuts it off. The mixer drives the same timer channel as
+ * a PWM DAC instead. The timer runs at the sample rate (16 to 32kHz, above
+ * hearing), and the update DMA request writes one sample into the channel's
+ * CCR every period from a circular buffer of two halves. The half-transfer
+ * and transfer-complete interrupts mix the half just played afresh, so the
+ * CPU works once per MIXER_BLOCK_SAMPLES samples (4ms at 32kHz), not per sample.
+ *
+ * Each of the MIXER_VOICES voices is a square wave from a 32-bit phase
+ * accumulator, with its own pitch, volume, length and start delay. A voice
+ * adds its amplitude to the samples where its wave is high, so overlapping
+ * sounds add up rather than cut each other off. It is all integer maths: a
+ * voice costs an add, a test and a conditional add per sample. A block's cost
+ * is bounded by MIXER_VOICES * MIXER_BLOCK_SAMPLES of those, whatever is queued.
+ *
+ * Mixer_Play() only queues the sound (a single-producer, single-consumer ring,
+ * as in BuzzerSeq). The interrupt starts it at its next block, on a free
+ * voice, or on the one with the least left to play if all are in use.
+ *
+ * Example usage:
+ * @code
+ * Mixer_cfg_t mixer = {
+ *     .buzzer = &buzzer_cfg,        // TIM2 CH3, with .dma_channel = DMA1_Channel2 (TIM2_UP)
+ *     .sample_rate_hz = 32000,
+ *     .setup_done = 0
+ * };
+ *
+ * Mixer_Init(&mixer);
+ * Mixer_Play(&mixer, 880, 50, 40, 0);        // wall beep
+ * Mixer_Play(&mixer, 440, 50, 40, 0);        // paddle beep on top of it
+ * Mixer_Play(&mixer, NOTE_G4, 50, 120, 120); // starts 120ms from now
+ *
+ * // In the DMA channel's IRQ handler (DMA1_Channel2_IRQHandler):
+ * Mixer_DMA_IRQHandler(&mixer);
+ * @endcode
+ */
+
+// Sounds that can play at once
+#ifndef MIXER_VOICES
+#define MIXER_VOICES 4
+#endif
+#if MIXER_VOICES < 1 || MIXER_VOICES > 8
+#error "MIXER_VOICES must be 1..8 (their sum is kept within a 16-bit sample)"
+#endif
+
+// Samples mixed per interrupt, half of the DMA buffer (4ms at 32kHz, 8ms at 16kHz)
+#ifndef MIXER_BLOCK_SAMPLES
+#define MIXER_BLOCK_SAMPLES 128
+#endif
+
+#define MIXER_QUEUE_LEN 8  ///< Sounds that can wait for the next block (power of 2)
+
+/**
+ * @struct Mixer_Voice_t
+ * @brief One sound being played (or waiting to start)
+ */
+typedef struct {
+    uint32_t phase;         ///< Square wave phase, high while the top bit is set
+    uint32_t step;          ///< Phase added per sample: freq * 2^32 / sample rate
+    uint32_t delay;         ///< Samples before the sound starts
+    uint32_t remaining;     ///< Samples left to play (0: voice free)
+    uint8_t volume_percent; ///< 0..100
+} Mixer_Voice_t;
+
+/**
+ * @struct Mixer_Sound_t
+ * @brief A queued sound, in samples
+ */
+typedef struct {
+    uint32_t step;          ///< As Mixer_Voice_t
+    uint32_t delay;         ///< As Mixer_Voice_t
+    uint32_t length;        ///< Samples to play
+    uint8_t volume_percent; ///< 0..100
+} Mixer_Sound_t;
+
+/**
+ * @struct Mixer_cfg_t
+ * @brief Configuration, voices and DMA buffer for a mixer instance
+ *
+ * @details The buzzer's timer is reprogrammed by Mixer_Init() (no prescaler,
+ * its period one sample) and its dma_channel/dma_request carry the samples,
+ * so the buzzer_*() calls and BuzzerSeq must not be used on it afterwards.
+ * The duty of a sample has the resolution of the timer period: 2500 steps at
+ * 32kHz from an 80MHz timer clock.
+ */
+typedef struct {
+    Buzzer_cfg_t* buzzer;                                   ///< Buzzer whose timer channel is the output (owned by the mixer after Init)
+    uint32_t sample_rate_hz;                                ///< Samples per second, the PWM frequency (16000 to 32000)
+    uint8_t setup_done;                                     ///< Internal flag: 1 if initialized, 0 otherwise
+    uint16_t range;                                         ///< Internal: timer period in ticks (ARR + 1), the duty of a full sample
+    uint16_t buffer[2 * MIXER_BLOCK_SAMPLES] DMA_ALIGNED;   ///< Internal: CCR values, the DMA plays one half while the other is mixed
+    uint8_t silent_halves;                                  ///< Internal: halves of buffer already all 0, up to 2
+    Mixer_Voice_t voices[MIXER_VOICES];                     ///< Internal: voices, mixed by the interrupt only
+    Mixer_Sound_t queue[MIXER_QUEUE_LEN];                   ///< Internal: sound ring
+    volatile uint8_t head;                                  ///< Internal: next free slot, written by Mixer_Play() only
+    volatile uint8_t tail;                                  ///< Internal: next sound to start, written by the interrupt only
+    volatile uint8_t active;                                ///< Internal: voices sounding or waiting after the last block
+    uint32_t dropped;                                       ///< Sounds not queued because the ring was full
+    uint32_t stolen;                                        ///< Sounds cut short to free a voice for a newer one
+    uint32_t peak_cycles;                                   ///< Longest block mix in DWT cycles (0 unless the cycle counter runs)
+} Mixer_cfg_t;
+
+/**
+ * @brief Take over the buzzer's timer channel and start streaming silence
+ *
+ * @param cfg Pointer to mixer configuration struct
+ *
+ * @details Sets the timer's period to one sample (no prescaler), claims the
+ * buzzer's DMA channel and starts the circular transfer into the channel's
+ * CCR, with its interrupt at priority 3 (below the LCD's DMA). Does nothing
+ * if the buzzer has no dma_channel or another module holds it: Mixer_Play()
+ * then drops every sound.
+ *
+ * @note The timer must be initialized by CubeMX (MX_TIMx_Init) and the buzzer
+ *       by buzzer_init() first
+ */
+void Mixer_Init(Mixer_cfg_t* cfg);
+
+/**
+ * @brief Queue a square-wave sound
+ *
+ * Starts at the next block (within MIXER_BLOCK_SAMPLES samples) plus delay_ms,
+ * over whatever is already playing. Never blocks.
+ *
+ * @param cfg Pointer to mixer configuration struct
+ * @param freq_hz Frequency in Hz (up to half the sample rate), or 0 for nothing
+ * @param volume_percent 0..100, as buzzer_tone(): 100 is a 50% duty on its own
+ * @param duration_ms Length in ms
+ * @param delay_ms Time from now to the start in ms (e.g. for the notes of a jingle)
+ * @return 1 if queued, 0 if the queue was full or the mixer is not running (the sound is dropped)
+ */
+uint8_t Mixer_Play(Mixer_cfg_t* cfg, uint16_t freq_hz, uint8_t volume_percent, uint16_t duration_ms,
+                   uint16_t delay_ms);
+
+/**
+ * @brief Check whether anything is playing, waiting to start or queued
+ *
+ * @param cfg Pointer to mixer configuration struct
+ * @return 1 if all is quiet (up to one block of the last sound may still be in the buffer)
+ */
+uint8_t Mixer_Is_Idle(Mixer_cfg_t* cfg);
+
+/**
+ * @brief Keep sample_rate_hz after the core clock changed (e.g. ClockProfile_Set())
+ *
+ * Sets the timer period for the sample rate from the timer's new kernel clock
+ * (preloaded, so the period running finishes first). Pitches and lengths are
+ * in samples, so sounds carry on unchanged; the duty resolution follows the
+ * clock (500 steps at 32kHz from 16MHz).
+ *
+ * @param cfg Pointer to mixer configuration struct
+ */
+void Mixer_Clock_Changed(Mixer_cfg_t* cfg);
+
+/**
+ * @brief Mixer DMA interrupt handler
+ *
+ * Call from the DMA channel's IRQ handler. Mixes the half of the buffer the
+ * DMA has just finished with, which it comes back to in MIXER_BLOCK_SAMPLES
+ * samples' time.
+ *
+ * @param cfg Pointer to mixer configuration struct
+ */
+void Mixer_DMA_IRQHandler(Mixer_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif
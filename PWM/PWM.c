@@ -1,5 +1,7 @@
 #include "PWM.h"
 #include "stm32l4xx_hal.h"
+#include "DmaChannel.h"
+#include "ClockProfile.h"
 
 /**
  * @file PWM.c
@@ -28,10 +30,58 @@ void PWM_Init(PWM_cfg_t* cfg)
         // This just marks the PWM as ready to use
         cfg->pwm_started = 0;
         cfg->last_duty = 0;
+        cfg->pattern_running = 0;
+        cfg->ccr_reg = &cfg->htim->Instance->CCR1 + (cfg->channel >> 2);
         cfg->setup_done = 1;
     }
 }
 
+// Timer DMA request that steps patterns. A capture/compare trigger comes from a
+// spare channel, with its CCR at 0 so it fires once per period like the update
+static uint32_t pattern_trigger(PWM_cfg_t* cfg)
+{
+    return cfg->dma_trigger ? cfg->dma_trigger : TIM_DMA_UPDATE;
+}
+
+// Prescaler stepping a pattern at pattern_step_hz with ARR = PWM_PATTERN_LEVELS - 1.
+// The timer clock is tick_freq_hz times the prescaler the timer was set up with
+static uint32_t pattern_prescaler(PWM_cfg_t* cfg)
+{
+    uint32_t step_hz = cfg->pattern_step_hz ? cfg->pattern_step_hz : PWM_PATTERN_DEFAULT_STEP_HZ;
+    uint32_t timer_clock = cfg->tick_freq_hz * (cfg->saved_psc + 1u);
+    return clamp_u32(timer_clock / (step_hz * PWM_PATTERN_LEVELS), 1u, 65536u) - 1u;
+}
+
+// Stop the pattern DMA and put the timer back to the frequency set before it (duty untouched)
+static void pattern_release(PWM_cfg_t* cfg)
+{
+    if (!cfg->pattern_running) {
+        return;
+    }
+    __HAL_TIM_DISABLE_DMA(cfg->htim, pattern_trigger(cfg));
+    cfg->dma_channel->CCR &= ~DMA_CCR_EN;
+    __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, 0);  // Pattern levels mean nothing at the old ARR
+    cfg->htim->Instance->PSC = cfg->saved_psc;
+    __HAL_TIM_SET_AUTORELOAD(cfg->htim, cfg->saved_arr);
+    __HAL_TIM_SET_COUNTER(cfg->htim, 0);
+    HAL_TIM_GenerateEvent(cfg->htim, TIM_EVENTSOURCE_UPDATE);
+    cfg->pattern_running = 0;
+}
+
+void PWM_Clock_Changed(PWM_cfg_t* cfg)
+{
+    if (!cfg->setup_done) {
+        return;  // The timer is set up later, for the clock as it is then
+    }
+    uint32_t psc = (ClockProfile_Timer_Hz(cfg->htim->Instance) / cfg->tick_freq_hz) - 1u;
+    if (cfg->pattern_running) {
+        cfg->saved_psc = psc;
+        cfg->htim->Instance->PSC = pattern_prescaler(cfg);
+    } else {
+        cfg->htim->Instance->PSC = psc;
+    }
+}
+
 uint8_t PWM_IsRunning(PWM_cfg_t* cfg)
 {
     return cfg->pwm_started ? 1u : 0u;
@@ -39,6 +89,7 @@ uint8_t PWM_IsRunning(PWM_cfg_t* cfg)
 
 void PWM_Off(PWM_cfg_t* cfg)
 {
+    pattern_release(cfg);
     if (cfg->pwm_started) {
         // Make sure duty is zero first, then stop PWM fully
         __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, 0);
@@ -48,10 +99,9 @@ void PWM_Off(PWM_cfg_t* cfg)
     cfg->last_duty = 0;
 }
 
-static void apply_duty_at_current_frequency(PWM_cfg_t* cfg, uint8_t duty_percent)
+// CCR for a duty at a period
+static uint32_t duty_ccr(uint32_t arr, uint8_t duty_percent)
 {
-    // Get current ARR (set by PWM_SetFreq)
-    uint32_t arr = __HAL_TIM_GET_AUTORELOAD(cfg->htim);
     uint32_t top = arr + 1u;
 
     duty_percent = (uint8_t)clamp_u32(duty_percent, 0u, 100u);
@@ -59,8 +109,33 @@ static void apply_duty_at_current_frequency(PWM_cfg_t* cfg, uint8_t duty_percent
 
     // Clamp CCR to [0..ARR]
     if (ccr > arr) ccr = arr;
+    return ccr;
+}
 
-    __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, ccr);
+// ARR for a frequency, clamped to the configured range and the 16-bit register
+static uint32_t freq_arr(PWM_cfg_t* cfg, uint32_t freq_hz)
+{
+    freq_hz = clamp_u32(freq_hz, cfg->min_freq_hz, cfg->max_freq_hz);
+    return clamp_u32((cfg->tick_freq_hz / freq_hz) - 1u, 1u, 65535u);
+}
+
+static void apply_duty_at_current_frequency(PWM_cfg_t* cfg, uint8_t duty_percent)
+{
+    // Get current ARR (set by PWM_SetFreq)
+    uint32_t arr = __HAL_TIM_GET_AUTORELOAD(cfg->htim);
+    __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, duty_ccr(arr, duty_percent));
+}
+
+uint32_t PWM_DutyTicks(PWM_cfg_t* cfg, uint8_t duty_percent)
+{
+    return duty_ccr(__HAL_TIM_GET_AUTORELOAD(cfg->htim), duty_percent);
+}
+
+void PWM_Ticks(PWM_cfg_t* cfg, uint32_t freq_hz, uint8_t duty_percent, PWM_Ticks_t* ticks)
+{
+    uint32_t arr = freq_arr(cfg, freq_hz);
+    ticks->arr = (uint16_t)arr;
+    ticks->ccr = (uint16_t)duty_ccr(arr, duty_percent);
 }
 
 void PWM_SetFreq(PWM_cfg_t* cfg, uint32_t freq_hz)
@@ -69,19 +144,15 @@ void PWM_SetFreq(PWM_cfg_t* cfg, uint32_t freq_hz)
     if (!cfg->setup_done) {
         PWM_Init(cfg);
     }
+    pattern_release(cfg);
 
     // ============ FREQUENCY CONTROL ============
     // The timer generates a PWM signal at frequency f_pwm = timer_tick_freq / (ARR + 1)
     // To play a desired frequency, we calculate: ARR = (timer_tick_freq / freq_hz) - 1
     
-    // Clamp to configured range
-    freq_hz = clamp_u32(freq_hz, cfg->min_freq_hz, cfg->max_freq_hz);
-
-    // Calculate ARR for desired frequency
-    uint32_t arr = (cfg->tick_freq_hz / freq_hz) - 1u;
-
-    // ARR must fit in timer register (typically 16-bit for TIM4: max 65535)
-    arr = clamp_u32(arr, 1u, 65535u);
+    // Calculate ARR for desired frequency, clamped to the configured range. ARR must fit
+    // in the timer register (typically 16-bit for TIM4: max 65535)
+    uint32_t arr = freq_arr(cfg, freq_hz);
 
     // Update ARR and reset counter for clean phase start
     __HAL_TIM_SET_AUTORELOAD(cfg->htim, arr);
@@ -102,6 +173,7 @@ void PWM_SetDuty(PWM_cfg_t* cfg, uint8_t duty_percent)
     if (!cfg->setup_done) {
         PWM_Init(cfg);
     }
+    pattern_release(cfg);
 
     // ============ DUTY CYCLE / BRIGHTNESS CONTROL ============
     // Duty cycle = CCR / (ARR + 1)
@@ -144,6 +216,7 @@ void PWM_SetTicks(PWM_cfg_t* cfg, uint32_t on_ticks, uint32_t off_ticks)
     if (!cfg->setup_done) {
         PWM_Init(cfg);
     }
+    pattern_release(cfg);
 
     // ============ DIRECT TICK CONTROL ============
     // This provides low-level control by directly setting:
@@ -191,4 +264,135 @@ void PWM_SetTicks(PWM_cfg_t* cfg, uint32_t on_ticks, uint32_t off_ticks)
 
     // Force registers reload immediately (safe with ARPE enabled)
     HAL_TIM_GenerateEvent(cfg->htim, TIM_EVENTSOURCE_UPDATE);
-}
\ No newline at end of file
+}
+// Gamma-2 brightness for a linear position x in 0..span: level 0..255
+static uint8_t pattern_level(uint32_t x, uint32_t span)
+{
+    if (span == 0) {
+        return 255;
+    }
+    return (uint8_t)((255u * x * x) / (span * span));
+}
+
+uint16_t PWM_Pattern_Build(PWM_cfg_t* cfg, PWM_Pattern_t pattern, uint16_t period_ms, uint8_t count,
+                           uint8_t* table, uint16_t max_steps)
+{
+    uint32_t step_hz = cfg->pattern_step_hz ? cfg->pattern_step_hz : PWM_PATTERN_DEFAULT_STEP_HZ;
+    uint32_t period = ((uint32_t)period_ms * step_hz) / 1000u;
+    if (period < 2) {
+        period = 2;
+    }
+    uint32_t repeats = (pattern == PWM_PATTERN_FADE_IN || pattern == PWM_PATTERN_FADE_OUT) ? 1u : count;
+    uint32_t steps = 0;
+
+    for (uint32_t r = 0; r < repeats; r++) {
+        for (uint32_t i = 0; i < period && steps < max_steps; i++, steps++) {
+            uint8_t level;
+            switch (pattern) {
+                case PWM_PATTERN_PULSE: {
+                    // Up over the first half, down over the second
+                    uint32_t half = period / 2u;
+                    level = (i < half) ? pattern_level(i, half) : pattern_level(period - 1u - i, period - 1u - half);
+                    break;
+                }
+                case PWM_PATTERN_FADE_IN:
+                    level = pattern_level(i, period - 1u);
+                    break;
+                case PWM_PATTERN_FADE_OUT:
+                    level = pattern_level(period - 1u - i, period - 1u);
+                    break;
+                case PWM_PATTERN_BLINK:
+                default:
+                    level = (i < period / 2u) ? 255u : 0u;
+                    break;
+            }
+            table[steps] = level;
+        }
+    }
+    return (uint16_t)steps;
+}
+
+void PWM_Pattern_Play(PWM_cfg_t* cfg, const uint8_t* table, uint16_t steps, uint8_t loop)
+{
+    if (cfg->dma_channel == NULL || steps == 0) {
+        return;
+    }
+    // Routes the request too; no pattern if another module has the channel
+    if (DmaChannel_Claim(cfg->dma_channel, cfg->dma_request, cfg, "PWM") != DMACHANNEL_OK) {
+        return;
+    }
+    if (!cfg->setup_done) {
+        PWM_Init(cfg);
+    }
+
+    TIM_TypeDef* tim = cfg->htim->Instance;
+    if (!cfg->pattern_running) {
+        cfg->saved_psc = tim->PSC;
+        cfg->saved_arr = __HAL_TIM_GET_AUTORELOAD(cfg->htim);
+    } else {
+        // Replacing a pattern: keep the frequency saved by the first one
+        __HAL_TIM_DISABLE_DMA(cfg->htim, pattern_trigger(cfg));
+        cfg->dma_channel->CCR &= ~DMA_CCR_EN;
+    }
+
+    DMA_Channel_TypeDef* channel = cfg->dma_channel;
+
+    // ARR = 255 so table entries are CCR values; the prescaler sets the step rate
+    tim->PSC = pattern_prescaler(cfg);
+    __HAL_TIM_SET_AUTORELOAD(cfg->htim, PWM_PATTERN_LEVELS - 1u);
+    __HAL_TIM_SET_COMPARE(cfg->htim, cfg->channel, table[0]);
+    __HAL_TIM_SET_COUNTER(cfg->htim, 0);
+    HAL_TIM_GenerateEvent(cfg->htim, TIM_EVENTSOURCE_UPDATE);
+    if (!cfg->pwm_started) {
+        HAL_TIM_PWM_Start(cfg->htim, cfg->channel);
+        cfg->pwm_started = 1;
+    }
+    cfg->pattern_running = 1;
+
+    // From the end of the first period, each trigger loads the next entry
+    // into the CCR preload register (8-bit memory, zero-extended to 32 bits)
+    volatile uint32_t* ccr = &tim->CCR1 + (cfg->channel >> 2);
+    uint32_t trigger = pattern_trigger(cfg);
+    uint32_t trigger_flag = TIM_FLAG_UPDATE;
+    if (trigger != TIM_DMA_UPDATE) {
+        // TIM_DMA_CCx and TIM_FLAG_CCx both move up one bit per channel
+        uint32_t trigger_index = 0;
+        while ((TIM_DMA_CC1 << trigger_index) != trigger) {
+            trigger_index++;
+        }
+        (&tim->CCR1)[trigger_index] = 0;
+        trigger_flag = TIM_FLAG_CC1 << trigger_index;
+    }
+    channel->CCR = 0;
+    channel->CPAR = (uint32_t)ccr;
+    channel->CMAR = (uint32_t)table;
+    channel->CNDTR = steps;
+    channel->CCR = DMA_CCR_PL_0 | DMA_CCR_PSIZE_1 | DMA_CCR_MINC | DMA_CCR_DIR |
+                   (loop ? DMA_CCR_CIRC : 0) | DMA_CCR_EN;
+    __HAL_TIM_CLEAR_FLAG(cfg->htim, trigger_flag);
+    __HAL_TIM_ENABLE_DMA(cfg->htim, trigger);
+}
+
+void PWM_Pattern_Stop(PWM_cfg_t* cfg)
+{
+    if (!cfg->pattern_running) {
+        return;
+    }
+    pattern_release(cfg);
+    if (cfg->last_duty > 0) {
+        apply_duty_at_current_frequency(cfg, cfg->last_duty);
+    } else {
+        PWM_Off(cfg);
+    }
+}
+
+uint8_t PWM_Pattern_Busy(PWM_cfg_t* cfg)
+{
+    if (!cfg->pattern_running) {
+        return 0;
+    }
+    if (cfg->dma_channel->CCR & DMA_CCR_CIRC) {
+        return 1;
+    }
+    return (cfg->dma_channel->CNDTR != 0) ? 1u : 0u;
+}
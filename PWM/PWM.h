@@ -33,9 +33,31 @@ extern "C" {
  * PWM_SetFreq(&pwm_cfg, 1000);   // 1kHz for LED
  * PWM_SetDuty(&pwm_cfg, 50);     // 50% brightness
  * PWM_SetDuty(&pwm_cfg, 100);    // Full brightness (frequency unchanged)
+ * 
+ * // Patterns (needs .dma_channel/.dma_request, e.g. TIM4_UP = DMA1_Channel7, request 6,
+ * // or .dma_trigger = TIM_DMA_CC2 with TIM4_CH2 = DMA1_Channel4, request 6):
+ * static uint8_t breathe[250];
+ * uint16_t steps = PWM_Pattern_Build(&pwm_cfg, PWM_PATTERN_PULSE, 1000, 1, breathe, 250);
+ * PWM_Pattern_Play(&pwm_cfg, breathe, steps, 1);  // loops by DMA, no CPU from here on
  * @endcode
  */
 
+/**
+ * @enum PWM_Pattern_t
+ * @brief Duty patterns for PWM_Pattern_Build()
+ * 
+ * Brightness ramps are squared (gamma 2), so they look even to the eye.
+ */
+typedef enum {
+    PWM_PATTERN_PULSE = 0,      ///< Fade up then down, count times
+    PWM_PATTERN_FADE_IN,        ///< Fade from off to full, then stay on
+    PWM_PATTERN_FADE_OUT,       ///< Fade from full to off
+    PWM_PATTERN_BLINK           ///< On for half the period then off, count times
+} PWM_Pattern_t;
+
+#define PWM_PATTERN_LEVELS 256          ///< Duty steps in a pattern (8-bit table entries, ARR = 255)
+#define PWM_PATTERN_DEFAULT_STEP_HZ 250 ///< Pattern step rate (and PWM frequency) if pattern_step_hz is 0
+
 /**
  * @struct PWM_cfg_t
  * @brief Configuration for a PWM instance
@@ -49,11 +71,28 @@ typedef struct {
     uint32_t tick_freq_hz;      ///< Timer tick frequency after prescaler (Hz)
     uint32_t min_freq_hz;       ///< Minimum frequency limit (Hz)
     uint32_t max_freq_hz;       ///< Maximum frequency limit (Hz)
+    DMA_Channel_TypeDef* dma_channel;   ///< DMA channel of the pattern trigger's request, or NULL
+    uint8_t dma_request;        ///< DMA request number for that channel (CSELR), e.g. 6 for TIM4_UP on DMA1_Channel7
+    uint32_t dma_trigger;       ///< Timer DMA request that steps patterns: TIM_DMA_UPDATE (or 0), or TIM_DMA_CCx of an unused channel
+    uint16_t pattern_step_hz;   ///< Pattern steps per second, which is also the PWM frequency while one plays
     uint8_t setup_done;         ///< Internal flag: 1 if initialised, 0 otherwise
     uint8_t pwm_started;        ///< Internal flag: 1 if PWM is running, 0 otherwise
     uint8_t last_duty;          ///< Last set duty cycle for frequency changes
+    uint8_t pattern_running;    ///< Internal flag: 1 while a pattern owns the timer
+    uint32_t saved_psc;         ///< Internal: prescaler to restore after a pattern
+    uint32_t saved_arr;         ///< Internal: auto-reload to restore after a pattern
+    volatile uint32_t* ccr_reg; ///< Internal: the channel's CCR (set by PWM_Init()), for the fast setters
 } PWM_cfg_t;
 
+/**
+ * @struct PWM_Ticks_t
+ * @brief Timer values of a frequency and duty, worked out ahead by PWM_Ticks() for PWM_SetTicksFast()
+ */
+typedef struct {
+    uint16_t arr;               ///< Auto-reload: period in ticks - 1
+    uint16_t ccr;               ///< Compare: on time in ticks
+} PWM_Ticks_t;
+
 /**
  * @brief Initialise PWM timer
  * 
@@ -121,6 +160,66 @@ void PWM_Set(PWM_cfg_t* cfg, uint32_t freq_hz, uint8_t duty_percent);
  */
 void PWM_SetTicks(PWM_cfg_t* cfg, uint32_t on_ticks, uint32_t off_ticks);
 
+/**
+ * @brief Work out the timer values of a frequency and duty, for PWM_SetTicksFast()
+ * 
+ * Clamps and divides as PWM_SetFreq() and PWM_SetDuty() do, once, so that
+ * the values can be applied later (or from a table) with no arithmetic.
+ * 
+ * @param cfg Pointer to PWM configuration struct
+ * @param freq_hz Frequency in Hz (clamped to min/max range)
+ * @param duty_percent Duty cycle 0..100
+ * @param ticks Filled in with ARR and CCR for tick_freq_hz
+ */
+void PWM_Ticks(PWM_cfg_t* cfg, uint32_t freq_hz, uint8_t duty_percent, PWM_Ticks_t* ticks);
+
+/**
+ * @brief Compare value of a duty at the frequency set now, for PWM_SetDutyFast()
+ * 
+ * @param cfg Pointer to PWM configuration struct
+ * @param duty_percent Duty cycle 0..100
+ * @return CCR value, 0 to ARR
+ */
+uint32_t PWM_DutyTicks(PWM_cfg_t* cfg, uint8_t duty_percent);
+
+/**
+ * @brief Set the compare value directly: one register write
+ * 
+ * For interrupts changing the duty at kHz rates, e.g. from a table of
+ * PWM_DutyTicks() values. The CCR is preloaded, so the change is taken at
+ * the end of the period playing. No clamping (ccr above ARR is full on).
+ * 
+ * @param cfg Pointer to PWM configuration struct
+ * @param ccr Compare value in ticks
+ * 
+ * @note The PWM must be running already (PWM_SetDuty() or PWM_Set() with a
+ *       non-zero duty), with no pattern playing. last_duty is not updated,
+ *       so a later PWM_SetFreq() puts back the last duty the safe API set.
+ */
+static inline void PWM_SetDutyFast(PWM_cfg_t* cfg, uint32_t ccr)
+{
+    *cfg->ccr_reg = ccr;
+}
+
+/**
+ * @brief Set the period and compare value directly: two register writes
+ * 
+ * As PWM_SetDutyFast(), for a frequency change too. Both registers are
+ * preloaded, so they are taken together at the end of the period playing:
+ * there is never a period with the new CCR and the old ARR, and no counter
+ * reset or forced update.
+ * 
+ * @param cfg Pointer to PWM configuration struct
+ * @param ticks Timer values from PWM_Ticks()
+ * 
+ * @note Same conditions as PWM_SetDutyFast()
+ */
+static inline void PWM_SetTicksFast(PWM_cfg_t* cfg, const PWM_Ticks_t* ticks)
+{
+    cfg->htim->Instance->ARR = ticks->arr;
+    *cfg->ccr_reg = ticks->ccr;
+}
+
 /**
  * @brief Stop PWM (output disabled)
  * 
@@ -136,6 +235,69 @@ void PWM_Off(PWM_cfg_t* cfg);
  */
 uint8_t PWM_IsRunning(PWM_cfg_t* cfg);
 
+/**
+ * @brief Keep tick_freq_hz after the core clock changed (e.g. ClockProfile_Set())
+ * 
+ * @param cfg Pointer to PWM configuration struct
+ * 
+ * @details Sets the prescaler for tick_freq_hz from the timer's new kernel clock, so
+ * the PWM frequency and duty stay the same. A pattern that is playing keeps its step
+ * rate, and PWM_Pattern_Stop() goes back to the new prescaler.
+ */
+void PWM_Clock_Changed(PWM_cfg_t* cfg);
+
+/**
+ * @brief Fill a duty table with a pattern
+ * 
+ * @param cfg Pointer to PWM configuration struct
+ * @param pattern Shape to build
+ * @param period_ms Length of one pulse/blink, or of the whole fade
+ * @param count Pulses or blinks (ignored for fades)
+ * @param table Output table, one 8-bit duty level (0..255) per step
+ * @param max_steps Size of table
+ * @return Number of steps written (pass to PWM_Pattern_Play())
+ * 
+ * @details There are pattern_step_hz steps per second, so a 1s pulse at the
+ * default 250Hz is 250 bytes. Patterns that do not fit are cut short.
+ */
+uint16_t PWM_Pattern_Build(PWM_cfg_t* cfg, PWM_Pattern_t pattern, uint16_t period_ms, uint8_t count,
+                           uint8_t* table, uint16_t max_steps);
+
+/**
+ * @brief Start playing a duty table in the background
+ * 
+ * @param cfg Pointer to PWM configuration struct
+ * @param table Duty table, e.g. from PWM_Pattern_Build() (must stay valid while playing)
+ * @param steps Number of entries
+ * @param loop 1 to repeat forever (circular DMA), 0 to play once and hold the last level
+ * 
+ * @details The timer is switched to ARR = 255 at pattern_step_hz, so each
+ * table entry is a CCR value and lasts exactly one PWM period. The timer's
+ * update DMA request writes the next entry into the CCR preload register at
+ * the end of every period. No interrupts and no main loop calls are needed.
+ * 
+ * PWM_SetFreq(), PWM_SetDuty(), PWM_SetTicks() and PWM_Off() stop the pattern
+ * and give back the frequency that was set before it.
+ * 
+ * @note Requires cfg->dma_channel; does nothing without it
+ */
+void PWM_Pattern_Play(PWM_cfg_t* cfg, const uint8_t* table, uint16_t steps, uint8_t loop);
+
+/**
+ * @brief Stop a pattern and restore the previous frequency and duty
+ * 
+ * @param cfg Pointer to PWM configuration struct
+ */
+void PWM_Pattern_Stop(PWM_cfg_t* cfg);
+
+/**
+ * @brief Check whether a pattern is still playing
+ * 
+ * @param cfg Pointer to PWM configuration struct
+ * @return 1 while a looping pattern runs or a one-shot pattern has steps left
+ */
+uint8_t PWM_Pattern_Busy(PWM_cfg_t* cfg);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -4,28 +4,85 @@
  */
 
 #include "Paddle.h"
+#include "Renderer.h"
+#include <stddef.h>
+#if !PONG_HEADLESS
 #include "LCD.h"
+#endif
 
-// Screen dimensions (ST7789V2 display)
-#define SCREEN_HEIGHT 240
+// Response curves: fraction of full speed (1/256ths) at each 1/16th of deflection,
+// precomputed so Paddle_Update() only does a lookup and a linear blend
+static const uint16_t paddle_curves[][PADDLE_CURVE_STEPS + 1] = {
+    // PADDLE_RESPONSE_LINEAR: x
+    {0, 16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 256},
+    // PADDLE_RESPONSE_EXPO: 0.25x + 0.75x^3
+    {0, 4, 8, 13, 19, 26, 34, 44, 56, 70, 87, 106, 129, 155, 185, 218, 256},
+};
+
+/**
+ * @brief Look up the response curve at a deflection
+ * 
+ * @param response PADDLE_RESPONSE_LINEAR or PADDLE_RESPONSE_EXPO
+ * @param magnitude Deflection 0.0 to 1.0
+ * @return Fraction of full speed, 0 to 256
+ */
+static uint16_t Paddle_Curve(uint8_t response, float magnitude) {
+    const uint16_t* curve = paddle_curves[response - PADDLE_RESPONSE_LINEAR];
+    if (magnitude <= 0.0f) {
+        return 0;
+    }
+    if (magnitude >= 1.0f) {
+        return curve[PADDLE_CURVE_STEPS];
+    }
+    // Position along the table in 1/256ths of a step
+    uint32_t pos = (uint32_t)(magnitude * (PADDLE_CURVE_STEPS * 256));
+    uint32_t i = pos >> 8;
+    uint32_t t = pos & 0xFF;
+    return (uint16_t)((curve[i] * (256 - t) + curve[i + 1] * t) >> 8);
+}
 
 void Paddle_Init(Paddle_t* paddle, int16_t x, int16_t y, int16_t width, int16_t height, int16_t speed) {
     paddle->x = x;
     paddle->y = y;
+    paddle->prev_y = y;
     paddle->width = width;
     paddle->height = height;
     paddle->speed = speed;
+    paddle->y_frac = 0;
+    paddle->response = PADDLE_RESPONSE_DIGITAL;
     paddle->score = 0;
 }
 
+void Paddle_SetSprites(Paddle_t* paddle, const struct LCD_Sprite_Anim* sprites) {
+    paddle->sprites = sprites;
+    paddle->anim_tick = 0;
+    paddle->drawn_frame = -2;  // Neither the rectangle nor a frame: the next draw redraws it
+}
+
+void Paddle_SetResponse(Paddle_t* paddle, Paddle_Response_t response) {
+    paddle->response = (uint8_t)response;
+    paddle->y_frac = 0;
+}
+
 void Paddle_Update(Paddle_t* paddle, UserInput input) {
+    paddle->prev_y = paddle->y;
+
     // Move paddle based on joystick direction (N/S for up/down)
+    int8_t dir = 0;
     if (input.direction == N || input.direction == NE || input.direction == NW) {
-        // Move up
-        paddle->y -= paddle->speed;
+        dir = -1;   // Move up
     } else if (input.direction == S || input.direction == SE || input.direction == SW) {
-        // Move down
-        paddle->y += paddle->speed;
+        dir = 1;    // Move down
+    }
+    
+    if (paddle->response == PADDLE_RESPONSE_DIGITAL) {
+        paddle->y += dir * paddle->speed;
+    } else {
+        // Proportional: scaled speed in 1/256ths of a pixel, keeping the leftover fraction
+        int32_t pos = ((int32_t)paddle->y << 8) + paddle->y_frac;
+        pos += dir * (int32_t)paddle->speed * Paddle_Curve(paddle->response, input.magnitude);
+        paddle->y = (int16_t)(pos >> 8);
+        paddle->y_frac = (uint8_t)(pos & 0xFF);
     }
     
     // IMPORTANT: Apply boundary constraints AFTER movement
@@ -34,6 +91,7 @@ void Paddle_Update(Paddle_t* paddle, UserInput input) {
     // TOP BOUNDARY: Paddle's top edge (y) must be >= 0
     if (paddle->y < 0) {
         paddle->y = 0;
+        paddle->y_frac = 0;
     }
     
     // BOTTOM BOUNDARY: Paddle's bottom edge (y + height) must be <= SCREEN_HEIGHT
@@ -41,20 +99,91 @@ void Paddle_Update(Paddle_t* paddle, UserInput input) {
     int16_t paddle_bottom = paddle->y + paddle->height;
     if (paddle_bottom > SCREEN_HEIGHT) {
         paddle->y = SCREEN_HEIGHT - paddle->height;
+        paddle->y_frac = 0;
+    }
+}
+
+// Erase the part of the last drawn rectangle that the paddle drawn at panel (x, y, width,
+// height) no longer covers
+static void Paddle_EraseOld(Paddle_t* paddle, int16_t x, int16_t y, int16_t width, int16_t height) {
+    const LCD_Retained_Area* old = &paddle->drawn;
+    if (old->width == 0) {
+        return;  // Never drawn
+    }
+    if (old->x != x || old->width != width || old->height != height) {
+        Renderer_Fill_Rect(old->x, old->y, old->width, old->height, 0);
+        return;
+    }
+    const int16_t old_top = (int16_t)old->y;
+    const int16_t old_bottom = old_top + old->height;
+    const int16_t top = (y > old_top) ? y : old_top;
+    const int16_t bottom = (y + height < old_bottom) ? y + height : old_bottom;
+    if (top >= bottom) {
+        Renderer_Fill_Rect(old->x, old->y, old->width, old->height, 0);  // No overlap
+    } else if (y > old_top) {
+        Renderer_Fill_Rect(old->x, old_top, old->width, y - old_top, 0);  // Moved down
+    } else if (bottom < old_bottom) {
+        Renderer_Fill_Rect(old->x, bottom, old->width, old_bottom - bottom, 0);  // Moved up
     }
 }
 
+// Draw the paddle with its top edge at court y
+static void Paddle_DrawAt(Paddle_t* paddle, int16_t y) {
+    // Where it goes on the panel; the retained area is kept in panel co-ordinates too
+    const int16_t px = PLAYFIELD_X(paddle->x);
+    const int16_t py = PLAYFIELD_Y(y);
+    const int16_t width = PLAYFIELD_LEN(paddle->x, paddle->width);
+    const int16_t height = PLAYFIELD_LEN(y, paddle->height);
+    // The frame of the animation this draw shows (-1 without one)
+    int16_t frame = -1;
+    const struct LCD_Sprite* sprite = NULL;
+#if !PONG_HEADLESS
+    if (paddle->sprites != NULL) {
+        sprite = LCD_Sprite_Anim_Frame(paddle->sprites, paddle->anim_tick++);
+        frame = (int16_t)(sprite - paddle->sprites->frames);
+    }
+#endif
+    LCD_Retained_Area* area = &paddle->drawn;
+    const uint8_t stale = Renderer_Retained_Begin(area);
+    const uint8_t moved = area->x != px || area->y != py || area->width != width || area->height != height;
+    if (stale || moved || frame != paddle->drawn_frame) {
+        // (A frame that starts out empty, as the display list's, has nothing to erase)
+        if (Renderer_Erases()) {
+            if (moved) {
+                Paddle_EraseOld(paddle, px, py, width, height);
+            } else if (!stale && sprite != NULL) {
+                // A new frame in the same place: its transparent pixels must not show the last one
+                Renderer_Fill_Rect(px, py, width, height, 0);
+            }
+        }
+        if (sprite != NULL) {
+            Renderer_Blit(px, py, sprite);
+        } else {
+            // Draw paddle as a filled rectangle
+            // Color: white (15 in 4-bit color)
+            Renderer_Fill_Rect(
+                px,
+                py,
+                width,
+                height,
+                15         // white color
+            );
+        }
+        paddle->drawn_frame = frame;
+        area->x = (uint16_t)px;
+        area->y = (uint16_t)py;
+        area->width = (uint16_t)width;
+        area->height = (uint16_t)height;
+    }
+    Renderer_Retained_End();
+}
+
 void Paddle_Draw(Paddle_t* paddle) {
-    // Draw paddle as a filled rectangle
-    // Color: white (15 in 4-bit color), filled (1)
-    LCD_Draw_Rect(
-        paddle->x,
-        paddle->y,
-        paddle->width,
-        paddle->height,
-        15,        // white color
-        1          // filled
-    );
+    Paddle_DrawAt(paddle, paddle->y);
+}
+
+void Paddle_DrawInterpolated(Paddle_t* paddle, uint16_t alpha) {
+    Paddle_DrawAt(paddle, Lerp_I16(paddle->prev_y, paddle->y, alpha));
 }
 
 AABB Paddle_GetAABB(Paddle_t* paddle) {
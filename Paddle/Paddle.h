@@ -11,7 +11,25 @@
 
 #include <stdint.h>
 #include "Utils.h"
-#include "Joystick.h"
+#include "Joystick_Types.h"
+#if !PONG_HEADLESS
+#include "LCD.h"
+#endif
+
+struct LCD_Sprite_Anim;  // LCD.h
+
+// Magnitude steps in the response curves (0, 1/16, ... 16/16 of full deflection)
+#define PADDLE_CURVE_STEPS 16
+
+/**
+ * @enum Paddle_Response_t
+ * @brief How joystick deflection maps to paddle speed
+ */
+typedef enum {
+    PADDLE_RESPONSE_DIGITAL = 0,    ///< Full speed whenever the stick points up/down (original behaviour)
+    PADDLE_RESPONSE_LINEAR,         ///< Speed proportional to deflection
+    PADDLE_RESPONSE_EXPO            ///< 0.25x + 0.75x^3: fine control near centre, full speed at full deflection
+} Paddle_Response_t;
 
 /**
  * @struct Paddle_t
@@ -20,10 +38,17 @@
 typedef struct {
     int16_t x;        // Paddle X position (left edge)
     int16_t y;        // Paddle Y position (top edge)
+    int16_t prev_y;   // Y position before the last update (for interpolated drawing)
     int16_t width;    // Paddle width
     int16_t height;   // Paddle height
-    int16_t speed;    // Movement speed (pixels per frame)
+    int16_t speed;    // Movement speed (pixels per frame, at full deflection)
+    uint8_t y_frac;   // Fraction of a pixel moved (1/256ths, proportional modes)
+    uint8_t response; // Paddle_Response_t
     uint16_t score;   // Game score (incremented on successful hit)
+    LCD_Retained_Area drawn;  // Where on the panel it was last drawn (retained, see Paddle_Draw())
+    const struct LCD_Sprite_Anim* sprites;  // Frames to draw instead of the rectangle, or NULL
+    uint16_t anim_tick;       // Draws so far, picks the frame
+    int16_t drawn_frame;      // Frame last drawn (-1: the rectangle)
 } Paddle_t;
 
 /**
@@ -35,15 +60,42 @@ typedef struct {
  * @param width Paddle width in pixels
  * @param height Paddle height in pixels
  * @param speed Movement speed in pixels/frame
+ * @note The paddle must start zeroed (e.g. a global or static), as Paddle_Init()
+ *       leaves its retained drawn area and its sprites alone
  */
 void Paddle_Init(Paddle_t* paddle, int16_t x, int16_t y, int16_t width, int16_t height, int16_t speed);
 
+/**
+ * @brief Set how joystick deflection maps to paddle speed
+ * 
+ * @param paddle Pointer to paddle object
+ * @param response PADDLE_RESPONSE_DIGITAL (default), LINEAR or EXPO
+ */
+void Paddle_SetResponse(Paddle_t* paddle, Paddle_Response_t response);
+
+/**
+ * @brief Draw the paddle as sprite frames instead of a rectangle
+ * 
+ * Only changes how the paddle looks: the frames are drawn from its top-left
+ * corner and should be its size, which still sets the collision box. It stays
+ * retained while it is still and the frame has not changed, so a frame shown
+ * for n draws (ticks_per_frame) sends the paddle's rows once per n frames.
+ * 
+ * @param paddle Pointer to paddle object
+ * @param sprites Frames (kept, not copied), or NULL for the rectangle
+ */
+void Paddle_SetSprites(Paddle_t* paddle, const struct LCD_Sprite_Anim* sprites);
+
 /**
  * @brief Update paddle position based on joystick input
  * 
  * Moves paddle up/down based on joystick Y direction.
  * Constrains paddle to stay within screen bounds.
  * 
+ * In the LINEAR and EXPO modes the distance moved is speed scaled by the
+ * response curve at input.magnitude, read from a precomputed table (no
+ * powf per frame), with fractions of a pixel carried over between updates.
+ * 
  * @param paddle Pointer to paddle object
  * @param input Joystick input
  */
@@ -54,10 +106,24 @@ void Paddle_Update(Paddle_t* paddle, UserInput input);
  * 
  * Draws the paddle as a filled rectangle at its current position.
  * 
+ * The paddle is retained LCD content: it remembers the rectangle it was last
+ * drawn at, and while it stays there (and nothing erased part of it) it is
+ * neither erased nor redrawn, so its rows are not sent again. When it moves,
+ * only the strip it left is erased. Draw paddles before the balls, so erasing
+ * that strip cannot cut into a ball drawn over it this frame.
+ * 
  * @param paddle Pointer to paddle object
  */
 void Paddle_Draw(Paddle_t* paddle);
 
+/**
+ * @brief Draw paddle between its previous and current position
+ * 
+ * @param paddle Pointer to paddle object
+ * @param alpha Fraction of a physics step since the last update (0 to LERP_ONE)
+ */
+void Paddle_DrawInterpolated(Paddle_t* paddle, uint16_t alpha);
+
 /**
  * @brief Get paddle bounding box for collision detection
  * 
@@ -0,0 +1,116 @@
+/**
+ * @file Particles.c
+ * @brief Particle burst implementation
+ */
+
+#include "Particles.h"
+#if !PONG_HEADLESS
+#include "LCD.h"
+#endif
+
+// Screen dimensions in Q8.8
+#define SCREEN_WIDTH_Q8  ((uint32_t)SCREEN_WIDTH << 8)
+#define SCREEN_HEIGHT_Q8 ((uint32_t)SCREEN_HEIGHT << 8)
+
+#define DIRECTIONS 16
+
+// Unit vectors 22.5 degrees apart, in Q8.8 (cos, sin * 256)
+static const int16_t direction_x[DIRECTIONS] = {
+    256, 237, 181, 98, 0, -98, -181, -237, -256, -237, -181, -98, 0, 98, 181, 237
+};
+static const int16_t direction_y[DIRECTIONS] = {
+    0, 98, 181, 237, 256, 237, 181, 98, 0, -98, -181, -237, -256, -237, -181, -98
+};
+
+// Speeds of successive particles of a burst, in eighths of the burst speed
+static const uint8_t eighths[4] = {4, 6, 5, 8};
+
+void Particles_Clear(ParticleSet_t* set) {
+    set->count = 0;
+}
+
+// Makes the sign of v match facing (1 or -1); 0 leaves it as it is
+static inline int16_t face(int16_t v, int8_t facing) {
+    if ((facing > 0 && v < 0) || (facing < 0 && v > 0)) {
+        return -v;
+    }
+    return v;
+}
+
+uint16_t Particles_Burst(ParticleSet_t* set, int16_t x, int16_t y, uint16_t count,
+                         uint16_t speed, uint8_t life, uint8_t colour,
+                         int8_t facing_x, int8_t facing_y) {
+    if (x < 0 || y < 0 || (uint32_t)x << 8 >= SCREEN_WIDTH_Q8 || (uint32_t)y << 8 >= SCREEN_HEIGHT_Q8 || life == 0) {
+        return 0;
+    }
+    if (count > PARTICLE_MAX_COUNT - set->count) {
+        count = PARTICLE_MAX_COUNT - set->count;
+    }
+    for (uint16_t k = 0; k < count; k++) {
+        uint16_t i = set->count + k;
+        // Odd steps through the table visit every direction before repeating,
+        // and the speed cycles through 1/2, 3/4, 5/8 and all of speed
+        uint8_t d = (uint8_t)(set->spin + k * 7) & (DIRECTIONS - 1);
+        int32_t s = (int32_t)speed * eighths[k & 3] / 8;
+        set->x[i] = (uint16_t)(x << 8);
+        set->y[i] = (uint16_t)(y << 8);
+        set->vx[i] = face((int16_t)(direction_x[d] * s / 256), facing_x);
+        set->vy[i] = face((int16_t)(direction_y[d] * s / 256), facing_y);
+        // Staggered lifetimes, so a burst thins out rather than vanishing at once
+        set->life[i] = life - (uint8_t)((k & 3) * life / 8);
+        set->colour[i] = colour;
+        set->px[i] = (uint8_t)PLAYFIELD_SCALE(x);
+        set->py[i] = (uint8_t)PLAYFIELD_SCALE(y);
+    }
+    set->count += count;
+    set->spin += 5;
+    return count;
+}
+
+void Particles_Update(ParticleSet_t* set) {
+    uint16_t n = set->count;
+    uint16_t i = 0;
+    while (i < n) {
+        // Q8.8 adds in 32 bits: off the left or top wraps to a huge value, so one unsigned
+        // compare per axis catches both edges
+        uint32_t x = (uint32_t)((int32_t)set->x[i] + set->vx[i]);
+        uint32_t y = (uint32_t)((int32_t)set->y[i] + set->vy[i]);
+        if (--set->life[i] == 0 || x >= SCREEN_WIDTH_Q8 || y >= SCREEN_HEIGHT_Q8) {
+            // Dead: move the last one in, and update that one in this slot
+            n--;
+            set->x[i] = set->x[n];
+            set->y[i] = set->y[n];
+            set->vx[i] = set->vx[n];
+            set->vy[i] = set->vy[n];
+            set->life[i] = set->life[n];
+            set->colour[i] = set->colour[n];
+            continue;
+        }
+        set->x[i] = (uint16_t)x;
+        set->y[i] = (uint16_t)y;
+        set->vy[i] += PARTICLE_GRAVITY;
+        set->px[i] = (uint8_t)PLAYFIELD_SCALE(x >> 8);
+        set->py[i] = (uint8_t)PLAYFIELD_SCALE(y >> 8);
+        i++;
+    }
+    set->count = n;
+}
+
+void Particles_Draw(const ParticleSet_t* set) {
+    Particles_DrawSome(set, set->count);
+}
+
+void Particles_DrawSome(const ParticleSet_t* set, uint16_t max) {
+#if !PONG_HEADLESS
+#if PLAYFIELD_LETTERBOXED
+    // The pixels are kept from the court's corner: one origin for them all keeps them in bytes
+    LCD_Push_Viewport(PLAYFIELD_X0, PLAYFIELD_Y0, PLAYFIELD_PANEL_WIDTH, PLAYFIELD_PANEL_HEIGHT);
+#endif
+    LCD_Set_Pixels(set->px, set->py, set->colour, (max < set->count) ? max : set->count);
+#if PLAYFIELD_LETTERBOXED
+    LCD_Pop_Viewport();
+#endif
+#else
+    (void)set; (void)max;
+#endif
+}
@@ -0,0 +1,109 @@
+/**
+ * @file Particles.h
+ * @brief Particle bursts for collision effects
+ *
+ * Short-lived single-pixel sparks thrown out where a ball hits something.
+ * Like BallSet_t, particles are stored as a structure of arrays, so the
+ * update is one tight loop of integer adds over contiguous memory:
+ *
+ * - Positions are unsigned Q8.8 pixels (0 to 255.996), velocities signed
+ *   Q8.8 pixels per step, with a little gravity added every step.
+ * - A particle dies when its lifetime runs out or it leaves the screen. The
+ *   last particle is moved into its slot, so the live ones stay packed.
+ * - The update also keeps each particle's whole-pixel position in byte
+ *   arrays, which Particles_Draw() hands to LCD_Set_Pixels() in one call.
+ *   That call marks the rows it draws on dirty, as any drawing does.
+ *
+ * Bursts spread over a fixed table of directions rather than drawing random
+ * numbers, so they do not change the engine's random sequence (or replays).
+ *
+ * 256 particles take 3KB of RAM and a few thousand cycles a step to update.
+ */
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdint.h>
+#include "Utils.h"
+
+// Most particles alive at once
+#ifndef PARTICLE_MAX_COUNT
+#define PARTICLE_MAX_COUNT 256
+#endif
+
+// Downward acceleration in Q8.8 pixels per step per step
+#ifndef PARTICLE_GRAVITY
+#define PARTICLE_GRAVITY 8
+#endif
+
+/**
+ * @struct ParticleSet_t
+ * @brief Live particles, structure of arrays
+ *
+ * Particles 0..count-1 are live.
+ */
+typedef struct {
+    uint16_t x[PARTICLE_MAX_COUNT];     // X positions (Q8.8 pixels)
+    uint16_t y[PARTICLE_MAX_COUNT];     // Y positions (Q8.8 pixels)
+    int16_t vx[PARTICLE_MAX_COUNT];     // X velocities (Q8.8 pixels/step)
+    int16_t vy[PARTICLE_MAX_COUNT];     // Y velocities (Q8.8 pixels/step)
+    uint8_t life[PARTICLE_MAX_COUNT];   // Steps left to live
+    uint8_t colour[PARTICLE_MAX_COUNT]; // Palette index
+    uint8_t px[PARTICLE_MAX_COUNT];     // Whole-pixel X, as drawn (scaled, from the court's corner)
+    uint8_t py[PARTICLE_MAX_COUNT];     // Whole-pixel Y, as drawn
+    uint16_t count;                     // Number of live particles
+    uint8_t spin;                       // Direction table offset of the next burst
+} ParticleSet_t;
+
+/**
+ * @brief Remove all particles
+ *
+ * @param set Pointer to particle set
+ */
+void Particles_Clear(ParticleSet_t* set);
+
+/**
+ * @brief Throw out a burst of particles from a point
+ *
+ * The particles fan out in all directions, at between half and the full
+ * speed. A non-zero facing keeps them on one side, e.g. facing_x = 1 for a
+ * hit on the front of the left paddle. Adds fewer if the set fills up.
+ *
+ * @param set Pointer to particle set
+ * @param x Start X in whole pixels
+ * @param y Start Y in whole pixels
+ * @param count Particles to add
+ * @param speed Fastest particle speed in Q8.8 pixels/step
+ * @param life Steps the particles live (1-255)
+ * @param colour Palette index
+ * @param facing_x 1 = only rightwards, -1 = only leftwards, 0 = either
+ * @param facing_y 1 = only downwards, -1 = only upwards, 0 = either
+ * @return Particles added
+ */
+uint16_t Particles_Burst(ParticleSet_t* set, int16_t x, int16_t y, uint16_t count,
+                         uint16_t speed, uint8_t life, uint8_t colour,
+                         int8_t facing_x, int8_t facing_y);
+
+/**
+ * @brief Move every particle one step and remove the dead ones
+ *
+ * @param set Pointer to particle set
+ */
+void Particles_Update(ParticleSet_t* set);
+
+/**
+ * @brief Draw every particle as one pixel
+ *
+ * @param set Pointer to particle set
+ */
+void Particles_Draw(const ParticleSet_t* set);
+
+/**
+ * @brief Draw only the first particles, to save drawing time
+ *
+ * @param set Pointer to particle set
+ * @param max Most particles to draw
+ */
+void Particles_DrawSome(const ParticleSet_t* set, uint16_t max);
+
+#endif // PARTICLES_H
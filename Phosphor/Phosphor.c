@@ -0,0 +1,149 @@
+/**
+ * @file Phosphor.c
+ * @brief Phosphor persistence implementation
+ */
+
+#include "Phosphor.h"
+#if !PONG_HEADLESS
+#include "LCD.h"
+
+// The whole court: trail pixels are drawn as retained drawing so that clears leave them be.
+// Whether the LCD finds it stale doesn't matter, every run is painted again each frame.
+static LCD_Retained_Area trail_area = {.x = PLAYFIELD_X0, .y = PLAYFIELD_Y0,
+                                       .width = PLAYFIELD_PANEL_WIDTH, .height = PLAYFIELD_PANEL_HEIGHT};
+#endif
+
+#if !PONG_HEADLESS
+static inline void begin_paint(void) {
+    (void)LCD_Retained_Begin(&trail_area);
+}
+
+static inline void end_paint(void) {
+    LCD_Retained_End();
+}
+#else
+static inline void begin_paint(void) {
+}
+
+static inline void end_paint(void) {
+}
+#endif
+
+// Writes a run (court co-ordinates) in the colour of its level; only its rows are marked dirty
+static inline void paint(const Phosphor_t* phosphor, const Phosphor_Span_t* span) {
+#if !PONG_HEADLESS
+    const uint8_t colour = span->level ? phosphor->ramp[span->level - 1] : phosphor->background;
+#if PLAYFIELD_SCALED
+    // The panel rows and columns the court's cover: none for a row scaled down into the next
+    const int16_t x0 = PLAYFIELD_X(span->x0);
+    const int16_t x1 = PLAYFIELD_X(span->x1 + 1) - 1;
+    for (int16_t y = PLAYFIELD_Y(span->y); y < PLAYFIELD_Y(span->y + 1) && x0 <= x1; y++) {
+        LCD_Fill_Span((uint16_t)y, (uint16_t)x0, (uint16_t)x1, colour);
+    }
+#else
+    LCD_Fill_Span(PLAYFIELD_Y(span->y), PLAYFIELD_X(span->x0), PLAYFIELD_X(span->x1), colour);
+#endif
+#else
+    (void)phosphor; (void)span;
+#endif
+}
+
+// The i-th run from the oldest
+static inline Phosphor_Span_t* at(Phosphor_t* phosphor, uint16_t i) {
+    return &phosphor->spans[(phosphor->tail + i) % PHOSPHOR_MAX_SPANS];
+}
+
+static inline void retire_oldest(Phosphor_t* phosphor) {
+    phosphor->tail = (uint16_t)((phosphor->tail + 1) % PHOSPHOR_MAX_SPANS);
+    phosphor->count--;
+}
+
+void Phosphor_Clear(Phosphor_t* phosphor) {
+    phosphor->tail = 0;
+    phosphor->count = 0;
+}
+
+void Phosphor_SetRamp(Phosphor_t* phosphor, const uint8_t* ramp, uint8_t levels, uint8_t background) {
+    if (levels > PHOSPHOR_MAX_LEVELS) {
+        levels = PHOSPHOR_MAX_LEVELS;
+    }
+    for (uint8_t i = 0; i < levels; i++) {
+        phosphor->ramp[i] = ramp[i];
+    }
+    phosphor->levels = levels;
+    phosphor->background = background;
+
+    // Lower levels keep the oldest runs the dimmest; with no levels left they fade out next
+    const uint8_t top = levels ? levels : 1;
+    for (uint16_t i = 0; i < phosphor->count; i++) {
+        Phosphor_Span_t* span = at(phosphor, i);
+        if (span->level > top) {
+            span->level = top;
+        }
+    }
+}
+
+void Phosphor_StampSpan(Phosphor_t* phosphor, int16_t y, int16_t x0, int16_t x1) {
+    if (phosphor->levels == 0 || y < 0 || y >= SCREEN_HEIGHT) {
+        return;
+    }
+    x0 = (x0 < 0) ? 0 : x0;
+    x1 = (x1 >= SCREEN_WIDTH) ? SCREEN_WIDTH - 1 : x1;
+    if (x0 > x1) {
+        return;
+    }
+
+    begin_paint();
+    if (phosphor->count == PHOSPHOR_MAX_SPANS) {
+        // Full: the oldest run goes now rather than when it would have faded out
+        Phosphor_Span_t* oldest = at(phosphor, 0);
+        oldest->level = 0;
+        paint(phosphor, oldest);
+        retire_oldest(phosphor);
+        phosphor->dropped++;
+    }
+    Phosphor_Span_t* span = at(phosphor, phosphor->count);
+    span->y = (uint8_t)y;
+    span->x0 = (uint8_t)x0;
+    span->x1 = (uint8_t)x1;
+    span->level = phosphor->levels;
+    phosphor->count++;
+    paint(phosphor, span);
+    end_paint();
+}
+
+void Phosphor_StampCircle(Phosphor_t* phosphor, int16_t cx, int16_t cy, int16_t radius) {
+    // Half-width of each row: the widest dx with dx^2 + dy^2 <= r^2, narrowing as |dy| grows
+    const int32_t r2 = (int32_t)radius * radius;
+    int16_t dx = radius;
+    for (int16_t dy = 0; dy <= radius; dy++) {
+        while ((int32_t)dx * dx + (int32_t)dy * dy > r2) {
+            dx--;
+        }
+        Phosphor_StampSpan(phosphor, (int16_t)(cy - dy), (int16_t)(cx - dx), (int16_t)(cx + dx));
+        if (dy != 0) {
+            Phosphor_StampSpan(phosphor, (int16_t)(cy + dy), (int16_t)(cx - dx), (int16_t)(cx + dx));
+        }
+    }
+}
+
+void Phosphor_Decay(Phosphor_t* phosphor) {
+    if (phosphor->count == 0) {
+        return;
+    }
+    begin_paint();
+    // Oldest first, so that newer runs are painted over older ones where they overlap
+    for (uint16_t i = 0; i < phosphor->count; i++) {
+        Phosphor_Span_t* span = at(phosphor, i);
+        if (span->level > 0) {
+            span->level--;
+        }
+        paint(phosphor, span);
+    }
+    end_paint();
+
+    // The runs that have faded out are the oldest ones
+    while (phosphor->count > 0 && at(phosphor, 0)->level == 0) {
+        retire_oldest(phosphor);
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file Phosphor.h
+ * @brief Phosphor persistence: trails that fade out a palette level a frame
+ *
+ * A ball leaves a glowing copy of itself wherever it has been, which dims
+ * frame by frame the way an old CRT's phosphor does. Nothing of the trail is
+ * drawn again from its history: each stamp is kept as the runs of pixels it
+ * covers (one per row), and a decay pass steps every run down one level of a
+ * colour ramp and rewrites just those pixels.
+ *
+ * - The runs live in a ring of PHOSPHOR_MAX_SPANS, oldest first. All runs
+ *   stamped in a frame have the same level and every run loses one a frame,
+ *   so the oldest are always the dimmest: runs that reach level 0 are painted
+ *   background once and leave from the oldest end of the ring.
+ * - Runs are painted oldest first, so where stamps overlap the newer,
+ *   brighter one ends up on top.
+ * - Trail pixels are retained drawing (see LCD_Retained_Begin()), so
+ *   LCD_Clear_Background() leaves them alone and only the rows the decay pass
+ *   writes are marked dirty. Anything drawn over a trail and cleared again
+ *   punches a hole in it, but every run is rewritten each frame anyway, so the
+ *   hole is filled on the next pass.
+ * - A stamp that finds the ring full first retires the oldest runs early
+ *   (painted background at once) and counts them in dropped.
+ *
+ * Runs are 4 bytes (the screen is 240 pixels across): 256 take 1KB of RAM.
+ * The trails are drawn on one display only.
+ */
+
+#ifndef PHOSPHOR_H
+#define PHOSPHOR_H
+
+#include <stdint.h>
+#include "Utils.h"
+
+// Most pixel runs on the screen at once: a ball stamps one per row it covers, every frame
+#ifndef PHOSPHOR_MAX_SPANS
+#define PHOSPHOR_MAX_SPANS 256
+#endif
+
+// Most levels a trail fades through, which is how many frames it lasts
+#define PHOSPHOR_MAX_LEVELS 15
+
+/**
+ * @struct Phosphor_Span_t
+ * @brief One row of a stamp, and its brightness
+ */
+typedef struct {
+    uint8_t y;      // Row
+    uint8_t x0;     // First pixel
+    uint8_t x1;     // Last pixel (inclusive)
+    uint8_t level;  // 1 (dimmest) to levels; 0 once painted background
+} Phosphor_Span_t;
+
+/**
+ * @struct Phosphor_t
+ * @brief Trail runs and the colours they fade through
+ */
+typedef struct {
+    Phosphor_Span_t spans[PHOSPHOR_MAX_SPANS]; // Ring of runs, oldest at tail
+    uint16_t tail;                       // Oldest run
+    uint16_t count;                      // Runs in the ring
+    uint8_t ramp[PHOSPHOR_MAX_LEVELS];   // Palette colour at each level, ramp[0] the dimmest
+    uint8_t levels;                      // Levels in the ramp (0: no trails)
+    uint8_t background;                  // Colour a run is painted when it has faded out
+    uint32_t dropped;                    // Runs retired early because the ring was full
+} Phosphor_t;
+
+/**
+ * @brief Forget every run, without drawing (e.g. after the screen has been filled)
+ *
+ * @param phosphor Pointer to trails
+ */
+void Phosphor_Clear(Phosphor_t* phosphor);
+
+/**
+ * @brief Set the colours trails fade through
+ *
+ * Runs already on the screen brighter than the new top level go down to it.
+ *
+ * @param phosphor Pointer to trails
+ * @param ramp Palette colours from the dimmest to the brightest (copied)
+ * @param levels Number of colours, up to PHOSPHOR_MAX_LEVELS (0 to stop stamping)
+ * @param background Colour of a faded-out pixel, that of LCD_Clear_Background()
+ */
+void Phosphor_SetRamp(Phosphor_t* phosphor, const uint8_t* ramp, uint8_t levels, uint8_t background);
+
+/**
+ * @brief Add a run at the brightest level, and paint it
+ *
+ * Clipped to the screen; a run wholly off it is not kept.
+ *
+ * @param phosphor Pointer to trails
+ * @param y Row
+ * @param x0 First pixel
+ * @param x1 Last pixel (inclusive)
+ */
+void Phosphor_StampSpan(Phosphor_t* phosphor, int16_t y, int16_t x0, int16_t x1);
+
+/**
+ * @brief Add a filled circle at the brightest level, one run per row, and paint it
+ *
+ * @param phosphor Pointer to trails
+ * @param cx Centre X
+ * @param cy Centre Y
+ * @param radius Radius in pixels, as LCD_Draw_Circle()
+ */
+void Phosphor_StampCircle(Phosphor_t* phosphor, int16_t cx, int16_t cy, int16_t radius);
+
+/**
+ * @brief Step every run down one level and paint it, retiring the ones that fade out
+ *
+ * Call once a frame, after LCD_Clear_Background() and before the new stamps
+ * and whatever is drawn over the trails.
+ *
+ * @param phosphor Pointer to trails
+ */
+void Phosphor_Decay(Phosphor_t* phosphor);
+
+#endif // PHOSPHOR_H
@@ -0,0 +1,116 @@
+/**
+ * @file PongAI.c
+ * @brief CPU opponent implementation
+ */
+
+#include "PongAI.h"
+
+void PongAI_Init(PongAI_t* ai, uint8_t reaction_steps, int16_t start_y) {
+    ai->reaction_steps = reaction_steps;
+    ai->target_y = start_y;
+    ai->planned_y = start_y;
+    ai->delay = 0;
+}
+
+int16_t PongAI_PredictY(Fixed16 x, Fixed16 y, Fixed16 vx, Fixed16 vy, int16_t size,
+                        int16_t line_x, int16_t court_height) {
+    if (vx <= 0) {
+        return Fixed_ToInt(y);
+    }
+    // Steps until the leading edge reaches the line (Q16.16), then the unbounced Y there
+    Fixed16 dx = Fixed_FromInt(line_x - size) - x;
+    if (dx < 0) {
+        dx = 0;
+    }
+    int64_t steps = ((int64_t)dx * FIXED_ONE) / vx;
+    int64_t y_end = y + (((int64_t)vy * steps) >> FIXED_SHIFT);
+
+    // Fold into the court: the ball's top-left moves between 0 and range
+    const int64_t range = Fixed_FromInt(court_height - size);
+    if (range <= 0) {
+        return 0;
+    }
+    int64_t m = y_end % (2 * range);
+    if (m < 0) {
+        m += 2 * range;
+    }
+    if (m > range) {
+        m = 2 * range - m;
+    }
+    return Fixed_ToInt((Fixed16)m);
+}
+
+void PongAI_Plan(PongAI_t* ai, const BallSet_t* balls, Paddle_t* paddle, int16_t court_height) {
+    int16_t best_y = court_height / 2;
+    int64_t best_steps = INT64_MAX;
+
+    for (uint8_t i = 0; i < balls->count; i++) {
+        if (balls->vx[i] <= 0) {
+            continue;  // Moving away
+        }
+        Fixed16 dx = Fixed_FromInt(paddle->x - balls->size[i]) - balls->x[i];
+        if (dx < 0) {
+            continue;  // Already past the paddle
+        }
+        int64_t steps = ((int64_t)dx * FIXED_ONE) / balls->vx[i];
+        if (steps < best_steps) {
+            best_steps = steps;
+            best_y = PongAI_PredictY(balls->x[i], balls->y[i], balls->vx[i], balls->vy[i],
+                                     balls->size[i], paddle->x, court_height)
+                     + balls->size[i] / 2;
+        }
+    }
+
+    ai->planned_y = best_y;
+    ai->delay = ai->reaction_steps;
+}
+
+void PongAI_PlanLeft(PongAI_t* ai, const BallSet_t* balls, Paddle_t* paddle,
+                     int16_t court_width, int16_t court_height) {
+    int16_t best_y = court_height / 2;
+    int64_t best_steps = INT64_MAX;
+    // Mirrored, the paddle's front face is a line at court_width - (x + width) that the
+    // ball's left edge (mirrored to its leading edge) moves towards
+    const int16_t line_x = court_width - (paddle->x + paddle->width);
+
+    for (uint8_t i = 0; i < balls->count; i++) {
+        if (balls->vx[i] >= 0) {
+            continue;  // Moving away
+        }
+        const Fixed16 x = Fixed_FromInt(court_width - balls->size[i]) - balls->x[i];
+        Fixed16 dx = Fixed_FromInt(line_x - balls->size[i]) - x;
+        if (dx < 0) {
+            continue;  // Already past the paddle
+        }
+        int64_t steps = ((int64_t)dx * FIXED_ONE) / -balls->vx[i];
+        if (steps < best_steps) {
+            best_steps = steps;
+            best_y = PongAI_PredictY(x, balls->y[i], -balls->vx[i], balls->vy[i],
+                                     balls->size[i], line_x, court_height)
+                     + balls->size[i] / 2;
+        }
+    }
+
+    ai->planned_y = best_y;
+    ai->delay = ai->reaction_steps;
+}
+
+UserInput PongAI_GetInput(PongAI_t* ai, Paddle_t* paddle) {
+    if (ai->delay) {
+        ai->delay--;
+    } else {
+        ai->target_y = ai->planned_y;
+    }
+
+    UserInput input = {0};
+    input.direction = CENTRE;
+    input.magnitude = 1.0f;     // Full deflection: top speed in any paddle response mode
+    int16_t centre = paddle->y + paddle->height / 2;
+    // Dead band of one step's travel stops the paddle jittering around the target
+    if (ai->target_y < centre - paddle->speed) {
+        input.direction = N;
+    } else if (ai->target_y > centre + paddle->speed) {
+        input.direction = S;
+    }
+    return input;
+}
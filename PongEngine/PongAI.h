@@ -0,0 +1,99 @@
+/**
+ * @file PongAI.h
+ * @brief CPU opponent for Pong
+ * 
+ * Drives a paddle towards the point where the ball will cross it. The
+ * intercept is solved analytically, folding the ball's straight-line path
+ * back into the court at each top/bottom wall bounce, so it costs a few
+ * multiplies and is only worked out again when a ball changes direction
+ * (a paddle hit or a serve), not every step.
+ * 
+ * Difficulty is the reaction time: a new intercept only takes effect
+ * after reaction_steps physics steps.
+ */
+
+#ifndef PONGAI_H
+#define PONGAI_H
+
+#include <stdint.h>
+#include "Ball.h"
+#include "Paddle.h"
+#include "Utils.h"
+
+/**
+ * @struct PongAI_t
+ * @brief CPU opponent state
+ */
+typedef struct {
+    int16_t target_y;        // Y the paddle centre is heading for
+    int16_t planned_y;       // Newest intercept, waiting for the reaction delay
+    uint8_t reaction_steps;  // Steps between planning an intercept and acting on it
+    uint8_t delay;           // Steps left before planned_y becomes target_y
+} PongAI_t;
+
+/**
+ * @brief Initialize the CPU opponent
+ * 
+ * @param ai Pointer to AI state
+ * @param reaction_steps Reaction latency in physics steps (0 = instant, higher = easier)
+ * @param start_y Y the paddle centre starts at
+ */
+void PongAI_Init(PongAI_t* ai, uint8_t reaction_steps, int16_t start_y);
+
+/**
+ * @brief Predict where a ball will cross a vertical line
+ * 
+ * Projects the ball along its velocity to the line, then folds the Y position
+ * back into [0, court_height - size] for every top/bottom wall bounce (the path
+ * of a ball bouncing between two walls is a triangle wave of the unbounced one).
+ * 
+ * @param x Ball X (Q16.16, top-left)
+ * @param y Ball Y (Q16.16, top-left)
+ * @param vx Ball X velocity (Q16.16 pixels/step, moving towards the line)
+ * @param vy Ball Y velocity (Q16.16 pixels/step)
+ * @param size Ball size in pixels
+ * @param line_x X the ball's leading edge must reach
+ * @param court_height Height of the court in pixels
+ * @return Ball Y (top-left) when it reaches the line
+ */
+int16_t PongAI_PredictY(Fixed16 x, Fixed16 y, Fixed16 vx, Fixed16 vy, int16_t size,
+                        int16_t line_x, int16_t court_height);
+
+/**
+ * @brief Plan a new intercept (call when a ball changes direction)
+ * 
+ * Aims for whichever ball moving towards the paddle will reach it first, or
+ * the middle of the court if every ball is moving away.
+ * 
+ * @param ai Pointer to AI state
+ * @param balls Balls in play
+ * @param paddle The CPU paddle (on the right, facing left)
+ * @param court_height Height of the court in pixels
+ */
+void PongAI_Plan(PongAI_t* ai, const BallSet_t* balls, Paddle_t* paddle, int16_t court_height);
+
+/**
+ * @brief Plan a new intercept for a paddle on the left, facing right
+ * 
+ * PongAI_Plan() for the other side of the court: the court is mirrored left
+ * to right, so the balls moving left are the ones coming.
+ * 
+ * @param ai Pointer to AI state
+ * @param balls Balls in play
+ * @param paddle The CPU paddle (on the left, facing right)
+ * @param court_width Width of the court in pixels
+ * @param court_height Height of the court in pixels
+ */
+void PongAI_PlanLeft(PongAI_t* ai, const BallSet_t* balls, Paddle_t* paddle,
+                     int16_t court_width, int16_t court_height);
+
+/**
+ * @brief Get this step's joystick-style input for the CPU paddle
+ * 
+ * @param ai Pointer to AI state
+ * @param paddle The CPU paddle
+ * @return Input to pass to Paddle_Update()
+ */
+UserInput PongAI_GetInput(PongAI_t* ai, Paddle_t* paddle);
+
+#endif // PONGAI_H
@@ -6,20 +6,69 @@
  */
 
 #include "PongEngine.h"
-#include "Buzzer.h"
+#include <stddef.h>
+#include <string.h>
+#if !PONG_HEADLESS && PONG_AUDIO_MIXER
+#include "Mixer.h"
+#elif !PONG_HEADLESS
+#include "BuzzerSeq.h"
+#endif
+#if PONG_TRACE && !PONG_HEADLESS
+#include "Trace.h"
+#endif
 
-// Screen dimensions (ST7789V2 display)
-#define SCREEN_WIDTH  240
-#define SCREEN_HEIGHT 240
 #define BALL_RESET_OFFSET 20
+// Brick wall layout: 4 columns x 10 rows of 12x18px bricks with a 2px gap, 8px in from the right
+#define BRICK_WALL_Y 30
+#define BRICK_WALL_COLS 4
+#define BRICK_WALL_ROWS 10
+#define BRICK_WALL_PITCH_X 14
+#define BRICK_WALL_X (SCREEN_WIDTH - BRICK_WALL_COLS * BRICK_WALL_PITCH_X - 8)
+#define BRICK_WALL_PITCH_Y 20
+#define BRICK_WALL_GAP 2
+#define BRICK_WALL_COLOUR 5
 #define BUZZER_WALL_FREQ_HZ 1200
 #define BUZZER_PADDLE_FREQ_HZ 800
 #define BUZZER_VOLUME 50
 #define BUZZER_BEEP_MS 40
+// Sound effects (Sfx.h): a paddle hit cuts a wall beep off, and neither is started again
+// within a couple of beeps' time of the last, however often the ball bounces
+#define SFX_WALL 0
+#define SFX_PADDLE 1
+// Collision sparks (PONG_PARTICLES): particles per hit, fastest speed (Q8.8 pixels/step),
+// lifetime in steps and colour of each kind of hit
+#define SPARK_COUNT 12
+#define SPARK_SPEED 640
+#define SPARK_LIFE 24
+#define SPARK_WALL_COLOUR 6
+#define SPARK_PADDLE_COLOUR 14
+#define SPARK_BRICK_COLOUR BRICK_WALL_COLOUR
+// Paddle bounce: the front face is cut into segments, top to bottom, each sending the ball
+// off at its own angle (unit vectors, Q16.16; Y negative is up). A ball at 45 degrees moves
+// BALL_DIAGONAL along each axis per pixel/step of speed.
+#define PADDLE_BOUNCE_SEGMENTS 8
+#define BALL_DIAGONAL FIXED_FROM_FLOAT(0.707f)
+static const FixedVector2D paddle_bounce[PADDLE_BOUNCE_SEGMENTS] = {
+    {FIXED_FROM_FLOAT(0.500f), FIXED_FROM_FLOAT(-0.866f)},  // -60 degrees
+    {FIXED_FROM_FLOAT(0.707f), FIXED_FROM_FLOAT(-0.707f)},  // -45
+    {FIXED_FROM_FLOAT(0.866f), FIXED_FROM_FLOAT(-0.500f)},  // -30
+    {FIXED_FROM_FLOAT(0.966f), FIXED_FROM_FLOAT(-0.259f)},  // -15
+    {FIXED_FROM_FLOAT(0.966f), FIXED_FROM_FLOAT(0.259f)},   // 15
+    {FIXED_FROM_FLOAT(0.866f), FIXED_FROM_FLOAT(0.500f)},   // 30
+    {FIXED_FROM_FLOAT(0.707f), FIXED_FROM_FLOAT(0.707f)},   // 45
+    {FIXED_FROM_FLOAT(0.500f), FIXED_FROM_FLOAT(0.866f)},   // 60
+};
 
-extern Buzzer_cfg_t buzzer_cfg;
+static const Sfx_Effect_t pong_effects[] = {
+    {BUZZER_WALL_FREQ_HZ, BUZZER_VOLUME, BUZZER_BEEP_MS, 1, 2 * BUZZER_BEEP_MS},    // SFX_WALL (and bricks)
+    {BUZZER_PADDLE_FREQ_HZ, BUZZER_VOLUME, BUZZER_BEEP_MS, 2, 3 * BUZZER_BEEP_MS / 2}, // SFX_PADDLE
+};
 
-static uint32_t buzzer_stop_tick = 0;
+#if !PONG_HEADLESS && PONG_AUDIO_MIXER
+extern Mixer_cfg_t mixer;
+#elif !PONG_HEADLESS
+extern BuzzerSeq_cfg_t buzzer_seq;
+#endif
 
 /**
  * @brief Play a short buzzer beep for collisions
@@ -30,133 +79,640 @@ static uint32_t buzzer_stop_tick = 0;
  * internally. This practice is called "encapsulation" - we hide complexity
  * from the user and only expose what they need.
  *
- * @param freq_hz Tone frequency in Hz
+ * The effect's priority and retrigger time (engine->sfx) decide first
+ * whether it is heard at all, so a ball rattling in a corner makes a beep
+ * every few steps rather than one every step. A beep that is played goes to
+ * the buzzer sequencer, cutting off the one sounding, and the sequencer
+ * starts and stops it from its timer interrupt: the engine never has to come
+ * back to end it. With PONG_AUDIO_MIXER it is queued on the mixer instead,
+ * over whatever else is sounding. Steps simulated again after a rollback
+ * (engine->quiet) have been heard already.
+ *
+ * @param engine Pointer to game engine
+ * @param effect SFX_WALL or SFX_PADDLE
  */
-static void PongEngine_Beep(uint32_t freq_hz)
+static void PongEngine_Beep(PongEngine_t* engine, uint8_t effect)
 {
-    buzzer_tone(&buzzer_cfg, freq_hz, BUZZER_VOLUME);
-    buzzer_stop_tick = HAL_GetTick() + BUZZER_BEEP_MS;
+#if !PONG_HEADLESS
+    if (engine->quiet || Sfx_Request(&engine->sfx, effect, HAL_GetTick()) == SFX_NONE) {
+        return;
+    }
+    const Sfx_Effect_t* sound = Sfx_Get(&engine->sfx, effect);
+#if PONG_AUDIO_MIXER
+    Mixer_Play(&mixer, sound->freq_hz, sound->volume_percent, sound->duration_ms, 0);
+#else
+    BuzzerSeq_Play_Now(&buzzer_seq, sound->freq_hz, sound->volume_percent, sound->duration_ms);
+#endif
+#else
+    (void)engine; (void)effect;
+#endif
 }
 
 /**
- * @brief Update buzzer timing and stop the beep when done
+ * @brief Queue an event of this step
+ *
+ * With the queue full, the oldest event unread by the application makes
+ * room: the ones of the step being run are always there for
+ * PongEngine_HandleEvents(), unless the step itself has more than
+ * PONG_EVENT_QUEUE_LEN.
  *
- * This is kept as a static (internal) helper because it is part of the
- * internal timing mechanism of PongEngine. The public API is just
- * PongEngine_Update() - callers don't need to know about buzzer timing.
- * This demonstrates good encapsulation: hide the details, expose only
- * the essential interface.
+ * A step run quiet (a rollback, PongEngine_UpdateN()) never makes room: its
+ * events are taken back off the queue straight after, and the unread ones of
+ * the real steps before it must still be there for the application. An event
+ * with no room is not queued, so at worst it makes no sparks and goes
+ * uncounted in the summary.
+ *
+ * @param engine Pointer to game engine
+ * @param event Event to queue
  */
-static void PongEngine_UpdateBuzzer(void)
-{
-    if (buzzer_stop_tick != 0 && (int32_t)(HAL_GetTick() - buzzer_stop_tick) >= 0) {
-        buzzer_off(&buzzer_cfg);
-        buzzer_stop_tick = 0;
+static void PongEngine_Push(PongEngine_t* engine, const PongEngine_Event_t* event) {
+    if (engine->event_head - engine->event_tail >= PONG_EVENT_QUEUE_LEN) {
+        if (engine->quiet) {
+            return;
+        }
+        engine->event_tail++;
+        engine->events_dropped++;
+    }
+    engine->events[engine->event_head++ & (PONG_EVENT_QUEUE_LEN - 1)] = *event;
+}
+
+/**
+ * @brief Queue a ball's hit, from its middle where it is now
+ *
+ * @param engine Pointer to game engine
+ * @param i Ball index
+ * @param facing_x Side the ball bounced to (the sparks fly out to it, see Particles_Burst())
+ * @param facing_y Side the ball bounced to
+ * @param type PONG_EVENT_WALL_HIT, _PADDLE_HIT or _BRICK_HIT
+ * @param side PONG_SIDE_x of the paddle hit (PONG_SIDE_LEFT otherwise)
+ */
+static void PongEngine_Hit(PongEngine_t* engine, uint8_t i, int8_t facing_x, int8_t facing_y, uint8_t type, uint8_t side) {
+    const BallSet_t* balls = &engine->balls;
+    const PongEngine_Event_t event = {
+        .type = type, .side = side, .facing_x = facing_x, .facing_y = facing_y,
+        .x = (int16_t)(Fixed_ToInt(balls->x[i]) + balls->size[i] / 2),
+        .y = (int16_t)(Fixed_ToInt(balls->y[i]) + balls->size[i] / 2),
+    };
+    PongEngine_Push(engine, &event);
+}
+
+/**
+ * @brief Queue an event with no position: a goal, a score or a life
+ */
+static void PongEngine_Note(PongEngine_t* engine, uint8_t type, uint8_t side, uint16_t value) {
+    const PongEngine_Event_t event = {.type = type, .side = side, .value = value};
+    PongEngine_Push(engine, &event);
+}
+
+/**
+ * @brief Add a point to a side, and queue the new score
+ */
+static void PongEngine_AddScore(PongEngine_t* engine, uint8_t side) {
+    Paddle_t* paddle = (side == PONG_SIDE_LEFT) ? &engine->paddle : &engine->opponent;
+    Paddle_AddScore(paddle);
+    PongEngine_Note(engine, PONG_EVENT_SCORE_CHANGED, side, Paddle_GetScore(paddle));
+}
+
+/**
+ * @brief Act on the events of a step once it is done
+ *
+ * Every hit bursts collision sparks from the ball's middle (PONG_PARTICLES)
+ * and is traced (PONG_TRACE). The sparks take no random numbers, so they
+ * leave the game (and replays) exactly as they are. Then one beep asks for
+ * the whole step: the paddle's if a paddle was hit, else the wall's, as the
+ * paddle's would cut a wall beep off anyway.
+ *
+ * A step simulated again after a rollback (engine->quiet) has been heard and
+ * traced already: it only makes its sparks, which are game state, and its
+ * events are taken back off the queue before the application sees them.
+ * That is also how PongEngine_UpdateN() runs steps, counting the events in
+ * its summary as they are taken back.
+ *
+ * @param engine Pointer to game engine
+ * @param first engine->event_head before the step
+ * @param summary Summary to count the events in, or NULL
+ */
+static void PongEngine_HandleEvents(PongEngine_t* engine, uint32_t first, PongEngine_Summary_t* summary) {
+    uint8_t beep = 0;   // 1 << SFX_x
+    for (uint32_t n = first; n != engine->event_head; n++) {
+        const PongEngine_Event_t* event = &engine->events[n & (PONG_EVENT_QUEUE_LEN - 1)];
+        if (summary) {
+            switch (event->type) {
+            case PONG_EVENT_WALL_HIT:   summary->wall_hits++; break;
+            case PONG_EVENT_PADDLE_HIT: summary->paddle_hits[event->side]++; break;
+            case PONG_EVENT_BRICK_HIT:  summary->brick_hits++; break;
+            case PONG_EVENT_GOAL:       summary->goals[event->side]++; break;
+            case PONG_EVENT_LIFE_LOST:  summary->lives_lost++; break;
+            default: break;
+            }
+        }
+        if (event->type > PONG_EVENT_BRICK_HIT) {
+            continue;
+        }
+        // Hits in Trace.h's TRACE_HIT_x order
+        const uint8_t hit = (uint8_t)(event->type - PONG_EVENT_WALL_HIT);
+#if PONG_PARTICLES
+        static const uint8_t spark_colour[] = {SPARK_WALL_COLOUR, SPARK_PADDLE_COLOUR, SPARK_BRICK_COLOUR};
+        Particles_Burst(&engine->particles, event->x, event->y, SPARK_COUNT, SPARK_SPEED, SPARK_LIFE,
+                        spark_colour[hit], event->facing_x, event->facing_y);
+#endif
+#if PONG_TRACE && !PONG_HEADLESS
+        if (!engine->quiet) {
+            Trace_Event(TRACE_PORT_COLLISION, hit);
+        }
+#endif
+        beep |= (uint8_t)(1u << ((event->type == PONG_EVENT_PADDLE_HIT) ? SFX_PADDLE : SFX_WALL));
+        (void)hit;
+    }
+
+    if (engine->quiet) {
+        engine->event_head = first;
+        return;
+    }
+    if (beep & (1u << SFX_PADDLE)) {
+        PongEngine_Beep(engine, SFX_PADDLE);
+    } else if (beep) {
+        PongEngine_Beep(engine, SFX_WALL);
+    }
+}
+
+/**
+ * @brief Draw a random number, through the replay journal if there is one
+ * 
+ * @param engine Pointer to game engine
+ * @param max Exclusive upper bound
+ * @return Random value in [0, max)
+ */
+static uint16_t PongEngine_Random(PongEngine_t* engine, uint16_t max) {
+    if (engine->replay) {
+        return Replay_Random(engine->replay, max);
     }
+    return Random_U16(max);
 }
 
 /**
- * @brief Handle ball collision with screen walls
+ * @brief Ball speed for the score so far, given to a ball at its serve and each paddle hit
  * 
- * Bounces ball off top, bottom, and right edges of screen.
- * Left edge is handled by goal logic (missed paddle).
+ * Worked out from the score, so a restored or unpacked state is at its own speed.
  * 
  * @param engine Pointer to game engine
+ * @return Speed, pixels/step (Q16.16)
  */
-static void PongEngine_CheckWallCollision(PongEngine_t* engine) {
-    Ball_t* ball = &engine->ball;
-    Vector2D vel = Ball_GetVelocity(ball);
-    
-    // Top wall collision - reverse Y velocity
-    if (ball->y <= 0) {
-        ball->y = 2;
-        Ball_SetVelocity(ball, vel.x, -vel.y);
-        PongEngine_Beep(BUZZER_WALL_FREQ_HZ);
+static Fixed16 PongEngine_Speed(PongEngine_t* engine) {
+#if PONG_SPEED_RAMP_HITS
+    const uint32_t levels = Paddle_GetScore(&engine->paddle) / PONG_SPEED_RAMP_HITS;
+    const Fixed16 max = FIXED_FROM_FLOAT(PONG_BALL_MAX_SPEED);
+    const uint32_t speed = (uint32_t)engine->serve_speed + levels * (uint32_t)FIXED_FROM_FLOAT(PONG_SPEED_RAMP_STEP);
+    return (speed > (uint32_t)max) ? max : (Fixed16)speed;
+#else
+    return engine->serve_speed;
+#endif
+}
+
+/**
+ * @brief Substeps this step needs: the fewest (a power of 2) that keep every ball's move
+ * within PONG_SUBSTEP_MAX_PX per axis, up to PONG_MAX_SUBSTEPS
+ * 
+ * @param balls Ball set
+ * @return Log2 of the substeps
+ */
+static uint8_t PongEngine_SubstepShift(const BallSet_t* balls) {
+    Fixed16 fastest = 0;
+    for (uint8_t i = 0; i < balls->count; i++) {
+        const Fixed16 ax = (balls->vx[i] < 0) ? -balls->vx[i] : balls->vx[i];
+        const Fixed16 ay = (balls->vy[i] < 0) ? -balls->vy[i] : balls->vy[i];
+        if (ax > fastest) fastest = ax;
+        if (ay > fastest) fastest = ay;
     }
-    // Bottom wall collision - reverse Y velocity
-    else if (ball->y + ball->size >= SCREEN_HEIGHT) {
-        ball->y = SCREEN_HEIGHT - ball->size - 2;
-        Ball_SetVelocity(ball, vel.x, -vel.y);
-        PongEngine_Beep(BUZZER_WALL_FREQ_HZ);
+    uint8_t shift = 0;
+    while ((1u << shift) < PONG_MAX_SUBSTEPS && (fastest >> shift) > Fixed_FromInt(PONG_SUBSTEP_MAX_PX)) {
+        shift++;
+    }
+    return shift;
+}
+
+/**
+ * @brief Reset a ball near the center with a random offset
+ * 
+ * @param engine Pointer to game engine
+ * @param i Ball index
+ * @param direction_x Direction to serve in: 1 = right, -1 = left
+ */
+static void PongEngine_ResetBall(PongEngine_t* engine, uint8_t i, int8_t direction_x) {
+    BallSet_t* balls = &engine->balls;
+    Position2D center_pos;
+    center_pos.x = (SCREEN_WIDTH - balls->size[i]) / 2;
+    center_pos.y = (SCREEN_HEIGHT - balls->size[i]) / 2;
+
+    // Add a small random offset in range [-BALL_RESET_OFFSET, BALL_RESET_OFFSET] to vary the reset position
+    int16_t dx = (int16_t)PongEngine_Random(engine, (uint16_t)(2 * BALL_RESET_OFFSET + 1)) - BALL_RESET_OFFSET;
+    int16_t dy = (int16_t)PongEngine_Random(engine, (uint16_t)(2 * BALL_RESET_OFFSET + 1)) - BALL_RESET_OFFSET;
+
+    center_pos.x += dx;
+    center_pos.y += dy;
+
+    balls->x[i] = balls->prev_x[i] = Fixed_FromInt(center_pos.x);
+    balls->y[i] = balls->prev_y[i] = Fixed_FromInt(center_pos.y);
+
+    // Reset velocity to initial direction (diagonally down, served left or right)
+    const Fixed16 speed = Fixed_Mul(PongEngine_Speed(engine), BALL_DIAGONAL);
+    balls->vx[i] = direction_x * speed;
+    balls->vy[i] = speed;
+}
+
+/**
+ * @brief Handle ball collisions with screen walls
+ * 
+ * Bounces balls off top, bottom, and right edges of screen.
+ * Left edge is handled by goal logic (missed paddle), and so is the right
+ * edge when the CPU or a second player is defending it.
+ * 
+ * The walls are infinite planes, so the bounce is exact at any speed: the
+ * distance a ball travelled past a wall is mirrored back in front of it,
+ * which is where it would be had it bounced at the moment of contact.
+ * 
+ * @param engine Pointer to game engine
+ * @return Number of bounces
+ */
+static uint8_t PongEngine_CheckWallCollision(PongEngine_t* engine) {
+    BallSet_t* balls = &engine->balls;
+    uint8_t bounces = 0;
+    
+    for (uint8_t i = 0; i < balls->count; i++) {
+        const Fixed16 max_y = Fixed_FromInt(SCREEN_HEIGHT - balls->size[i]);
+        // Top wall collision - reverse Y velocity
+        if (balls->y[i] < 0) {
+            balls->y[i] = -balls->y[i];
+            balls->vy[i] = -balls->vy[i];
+            PongEngine_Hit(engine, i, 0, 1, PONG_EVENT_WALL_HIT, PONG_SIDE_LEFT);
+            bounces++;
+        }
+        // Bottom wall collision - reverse Y velocity
+        else if (balls->y[i] > max_y) {
+            balls->y[i] = 2 * max_y - balls->y[i];
+            balls->vy[i] = -balls->vy[i];
+            PongEngine_Hit(engine, i, 0, -1, PONG_EVENT_WALL_HIT, PONG_SIDE_LEFT);
+            bounces++;
+        }
     }
     
-    // Right wall collision - reverse X velocity
-    if (ball->x + ball->size >= SCREEN_WIDTH) {
-        ball->x = SCREEN_WIDTH - ball->size - 2;
-        Ball_SetVelocity(ball, -vel.x, vel.y);
-        PongEngine_Beep(BUZZER_WALL_FREQ_HZ);
+#if !PONG_RIGHT_PADDLE
+    for (uint8_t i = 0; i < balls->count; i++) {
+        const Fixed16 max_x = Fixed_FromInt(SCREEN_WIDTH - balls->size[i]);
+        // Right wall collision - reverse X velocity
+        if (balls->x[i] > max_x) {
+            balls->x[i] = 2 * max_x - balls->x[i];
+            balls->vx[i] = -balls->vx[i];
+            PongEngine_Hit(engine, i, -1, 0, PONG_EVENT_WALL_HIT, PONG_SIDE_LEFT);
+            bounces++;
+        }
     }
+#endif
+    return bounces;
 }
 
 /**
- * @brief Handle ball collision with paddle using AABB
+ * @brief Rebuild the broad-phase grid from this step's ball moves
  * 
- * Uses AABB (Axis-Aligned Bounding Box) collision detection:
- * - Gets bounding boxes for both ball and paddle
- * - Checks if they overlap using AABB_Collides()
- * - If collision detected, reverses ball X velocity and increments score
+ * Each ball is listed in every grid cell its swept box (start to end of the
+ * step) touches. Colliders then only run the narrow phase on balls listed in
+ * the cells they overlap.
  * 
- * **How AABB Collision Works:**
- * Two boxes collide if they overlap in BOTH X and Y axes:
- * - X-axis overlap: box_a.x < box_b.x+box_b.width AND box_a.x+box_a.width > box_b.x
- * - Y-axis overlap: box_a.y < box_b.y+box_b.height AND box_a.y+box_a.height > box_b.y
+ * @param engine Pointer to game engine
+ */
+static void PongEngine_BuildGrid(PongEngine_t* engine) {
+    BallSet_t* balls = &engine->balls;
+    SpatialGrid_Clear(&engine->grid);
+    for (uint8_t i = 0; i < balls->count; i++) {
+        AABB swept = BallSet_GetSweptAABB(balls, i);
+        SpatialGrid_Insert(&engine->grid, i, &swept);
+    }
+}
+
+/**
+ * @brief Find the balls that may touch a box this step
  * 
  * @param engine Pointer to game engine
+ * @param box Collider bounding box
+ * @param out Filled with ball indices (BALL_MAX_COUNT entries)
+ * @return Number of candidate balls
  */
-static void PongEngine_CheckPaddleCollision(PongEngine_t* engine) {
-    Ball_t* ball = &engine->ball;
-    Paddle_t* paddle = &engine->paddle;
-    Vector2D vel = Ball_GetVelocity(ball);
-    
-    // Get bounding boxes for collision detection
-    AABB ball_box = Ball_GetAABB(ball);
+static uint8_t PongEngine_QueryBalls(PongEngine_t* engine, const AABB* box, uint8_t* out) {
+    if (engine->grid.overflow) {
+        // A crowded cell dropped some balls (e.g. a split that has not spread out yet),
+        // so the grid is incomplete: fall back to checking every ball
+        const uint8_t count = (engine->balls.count < BALL_MAX_COUNT) ? engine->balls.count : BALL_MAX_COUNT;
+        for (uint8_t i = 0; i < count; i++) {
+            out[i] = i;
+        }
+        return count;
+    }
+    return SpatialGrid_Query(&engine->grid, box, out, BALL_MAX_COUNT);
+}
+
+/**
+ * @brief Bounce a ball off the face of a box it hit during this step
+ * 
+ * The ball has already moved its full (sub)step (BallSet_UpdatePart()), so the part of
+ * the move past the face is mirrored back in front of it, and the velocity
+ * component along the face normal is reversed.
+ * 
+ * @param balls Ball set
+ * @param i Ball index
+ * @param contact Contact found by AABB_Sweep()
+ * @param box Box that was hit
+ */
+static void PongEngine_Reflect(BallSet_t* balls, uint8_t i, const AABB_SweepResult* contact, const AABB* box) {
+    if (contact->normal_x != 0) {
+        // Left or right face: mirror the X overshoot about the face
+        Fixed16 face_x = (contact->normal_x > 0) ? Fixed_FromInt(box->x + box->width)
+                                                 : Fixed_FromInt(box->x - balls->size[i]);
+        balls->x[i] = 2 * face_x - balls->x[i];
+        balls->vx[i] = -balls->vx[i];
+    } else {
+        // Top or bottom face: mirror the Y overshoot
+        Fixed16 face_y = (contact->normal_y > 0) ? Fixed_FromInt(box->y + box->height)
+                                                 : Fixed_FromInt(box->y - balls->size[i]);
+        balls->y[i] = 2 * face_y - balls->y[i];
+        balls->vy[i] = -balls->vy[i];
+    }
+}
+
+/**
+ * @brief Send a ball off a paddle's front face at the angle of the segment it hit
+ * 
+ * The middle of the paddle returns the ball nearly flat and the ends send it off
+ * steeply (paddle_bounce), at the full speed of the score whatever the angle.
+ * 
+ * @param engine Pointer to game engine
+ * @param i Ball index
+ * @param paddle_box Paddle that was hit
+ * @param facing Side the front face is on: 1 = right, -1 = left
+ */
+static void PongEngine_PaddleBounce(PongEngine_t* engine, uint8_t i, const AABB* paddle_box, int8_t facing) {
+    BallSet_t* balls = &engine->balls;
+    int16_t offset = Fixed_ToInt(balls->y[i]) + balls->size[i] / 2 - paddle_box->y;
+    if (offset < 0) {
+        offset = 0;
+    } else if (offset >= paddle_box->height) {
+        offset = paddle_box->height - 1;
+    }
+    const FixedVector2D* dir = &paddle_bounce[(offset * PADDLE_BOUNCE_SEGMENTS) / paddle_box->height];
+    const Fixed16 speed = PongEngine_Speed(engine);
+    balls->vx[i] = facing * Fixed_Mul(speed, dir->x);
+    balls->vy[i] = Fixed_Mul(speed, dir->y);
+}
+
+/**
+ * @brief Bounce balls off a paddle (swept AABB)
+ * 
+ * Runs after BallSet_UpdatePart() and PongEngine_BuildGrid(), so each ball's
+ * previous position is where its substep started. Uses continuous collision detection instead of checking where
+ * the ball ends up: AABB_Sweep() finds the fraction of the step at which the
+ * ball first touches the paddle and which face it hit. A fast ball can
+ * otherwise jump over the 4px paddle between two steps.
+ * 
+ * - No contact: the ball keeps its full move
+ * - Contact with a top, bottom or back face: the ball is reflected off it, and
+ *   the rest of the step is mirrored back in front of that face
+ * - Contact with the front face: the ball leaves at the angle of where it hit
+ *   (PongEngine_PaddleBounce()) and goes the rest of the step that way from
+ *   the contact point, so no distance is lost or gained in the bounce
+ * - Already overlapping (the paddle moved onto the ball): the ball is pushed
+ *   out in front of the paddle and sent back across the court the same way
+ * 
+ * The settle pass runs after the bricks and walls: a ball one of them has
+ * just bounced back into the paddle (near its ends) is handled then and there
+ * rather than a step later. A bounce mirrors the move, so the path the ball
+ * took after it is the straight one that ends where the ball is now, at its
+ * new velocity: that path is swept instead, and the ball bounces off the
+ * paddle where it first touched it. Only a ball the sweep finds overlapping
+ * from the start is pushed out.
+ * 
+ * The pinch pass runs after the walls have had the last word on the settle
+ * pass: a ball still overlapping a paddle is caught between one of its ends
+ * and a wall, in a gap too narrow for it to bounce in, and is pushed out of
+ * the front face straight away.
+ * 
+ * @param engine Pointer to game engine
+ * @param paddle Paddle to test
+ * @param facing Side the paddle's front face is on: 1 = right (player), -1 = left (CPU)
+ * @param settle 1 for the settle pass (overlaps only, every ball), 2 for the pinch pass
+ *               (overlaps pushed out), 0 for the sweep
+ * @return Number of balls that hit the paddle
+ */
+static uint8_t PongEngine_CheckPaddleCollision(PongEngine_t* engine, Paddle_t* paddle, int8_t facing, uint8_t settle) {
+    BallSet_t* balls = &engine->balls;
     AABB paddle_box = Paddle_GetAABB(paddle);
-    
-    // Check if ball and paddle AABBs collide
-    if (AABB_Collides(&ball_box, &paddle_box)) {
-        // Collision detected! Reverse ball X velocity
-        Ball_SetVelocity(ball, -vel.x, vel.y);
-        
-        // Move ball to prevent getting stuck in paddle
-        ball->x = paddle_box.x + paddle_box.width;
-        
-        // Increment paddle score
-        Paddle_AddScore(paddle);
+    uint8_t hits = 0;
 
-        PongEngine_Beep(BUZZER_PADDLE_FREQ_HZ);
+    // Broad phase: only balls that swept through the paddle's grid cells. The settle pass
+    // tests every ball in one batch instead, as a wall bounce can have moved one out of
+    // the cells listed: the ones overlapping the paddle are the candidates
+    uint8_t candidates[BALL_MAX_COUNT];
+    uint8_t n;
+    if (settle) {
+        int16_t ball_x[BALL_MAX_COUNT], ball_y[BALL_MAX_COUNT];
+        for (uint8_t i = 0; i < balls->count; i++) {
+            ball_x[i] = Fixed_ToInt(balls->x[i]);
+            ball_y[i] = Fixed_ToInt(balls->y[i]);
+        }
+        const AABB_SoA boxes = {ball_x, ball_y, balls->size, balls->size};
+        uint32_t overlapping[(BALL_MAX_COUNT + 31) / 32];
+        n = 0;
+        if (AABB_CollidesMany(&paddle_box, &boxes, balls->count, overlapping)) {
+            for (uint8_t i = 0; i < balls->count; i++) {
+                if (overlapping[i / 32] & (1u << (i % 32))) {
+                    candidates[n++] = i;
+                }
+            }
+        }
+    } else {
+        n = PongEngine_QueryBalls(engine, &paddle_box, candidates);
     }
+
+    for (uint8_t k = 0; k < n; k++) {
+        uint8_t i = candidates[k];
+        const FixedVector2D move = {balls->vx[i] >> engine->substep_shift, balls->vy[i] >> engine->substep_shift};
+        Fixed16 start_x = balls->prev_x[i];
+        Fixed16 start_y = balls->prev_y[i];
+        if (settle) {
+            start_x = balls->x[i] - move.x;
+            start_y = balls->y[i] - move.y;
+        }
+        AABB_SweepResult contact = {1, 0, 0, 0};  // Pinched: pushed out as at time 0
+        if (settle < 2) {
+            contact = AABB_Sweep(start_x, start_y, balls->size[i], balls->size[i], move, &paddle_box);
+        }
+        if (!contact.hit) {
+            if (!settle) {
+                continue;
+            }
+            contact.hit = 1;    // Overlapping, but not on that path (rounding): pushed out as at time 0
+            contact.time = 0;
+        }
+
+        if (contact.time == 0) {
+            // Paddle moved onto the ball: push it out of the front face
+            if (facing > 0) {
+                balls->x[i] = Fixed_FromInt(paddle_box.x + paddle_box.width);
+            } else {
+                balls->x[i] = Fixed_FromInt(paddle_box.x - balls->size[i]);
+            }
+            PongEngine_PaddleBounce(engine, i, &paddle_box, facing);
+        } else if (contact.normal_x == facing) {
+            // Off the front face at a new angle: from the contact point, the rest of the move
+            // goes the new way at the new speed
+            balls->x[i] = (facing > 0) ? Fixed_FromInt(paddle_box.x + paddle_box.width)
+                                       : Fixed_FromInt(paddle_box.x - balls->size[i]);
+            balls->y[i] = start_y + Fixed_Mul(move.y, contact.time);
+            PongEngine_PaddleBounce(engine, i, &paddle_box, facing);
+            const Fixed16 rest = FIXED_ONE - contact.time;
+            balls->x[i] += Fixed_Mul(balls->vx[i] >> engine->substep_shift, rest);
+            balls->y[i] += Fixed_Mul(balls->vy[i] >> engine->substep_shift, rest);
+        } else {
+            PongEngine_Reflect(balls, i, &contact, &paddle_box);
+        }
+        PongEngine_Hit(engine, i, facing, 0, PONG_EVENT_PADDLE_HIT, (facing > 0) ? PONG_SIDE_LEFT : PONG_SIDE_RIGHT);
+        hits++;
+    }
+
+    if (hits) {
+        engine->ai_replan = 1;
+    }
+    return hits;
 }
 
 /**
- * @brief Check if ball has left the play area (missed paddle)
+ * @brief Bounce balls off the player's paddle, and the right one if in play
  * 
- * If ball goes beyond left edge, decrement lives and reset ball to center.
+ * Left player hits score a point (and feed the multi-ball power-up); right
+ * paddle hits only beep.
  * 
  * @param engine Pointer to game engine
+ * @param settle 1 for the pass after the walls, 2 for the pinch pass after that
+ *               (see PongEngine_CheckPaddleCollision())
+ * @return Number of balls that hit either paddle
  */
-static void PongEngine_CheckGoal(PongEngine_t* engine) {
-    Ball_t* ball = &engine->ball;
-    
-    // Ball left the left edge (missed by paddle)
-    if (ball->x < 0) {
-        engine->lives--;
+static uint8_t PongEngine_CheckPaddles(PongEngine_t* engine, uint8_t settle) {
+    uint8_t hits = PongEngine_CheckPaddleCollision(engine, &engine->paddle, 1, settle);
+    const uint8_t total = hits;
 
-        // Reset ball near center with random offset
-        Position2D center_pos;
-        center_pos.x = (SCREEN_WIDTH - ball->size) / 2;
-        center_pos.y = (SCREEN_HEIGHT - ball->size) / 2;
+    while (hits--) {
+        // Increment paddle score
+        PongEngine_AddScore(engine, PONG_SIDE_LEFT);
+#if PONG_MULTIBALL_HITS
+        if (Paddle_GetScore(&engine->paddle) % PONG_MULTIBALL_HITS == 0) {
+            PongEngine_SpawnBall(engine);
+        }
+#endif
+    }
+
+#if PONG_RIGHT_PADDLE
+    return total + PongEngine_CheckPaddleCollision(engine, &engine->opponent, -1, settle);
+#else
+    return total;
+#endif
+}
+
+#if PONG_AI_OPPONENT
+/**
+ * @brief Move the CPU paddle
+ * 
+ * A new intercept is only planned when a ball has changed X direction since
+ * the last step; between those the trajectory (wall bounces included) is
+ * already accounted for, so the CPU just keeps heading for its target.
+ * 
+ * @param engine Pointer to game engine
+ */
+static void PongEngine_UpdateOpponent(PongEngine_t* engine) {
+    if (engine->ai_replan) {
+        PongAI_Plan(&engine->ai, &engine->balls, &engine->opponent, SCREEN_HEIGHT);
+        engine->ai_replan = 0;
+    }
+    Paddle_Update(&engine->opponent, PongAI_GetInput(&engine->ai, &engine->opponent));
+}
+#endif
+
+/**
+ * @brief Bounce balls off the brick wall, knocking bricks down
+ * 
+ * Broad phase: balls whose move touched the wall's grid cells. Bricks_Hit()
+ * then only tests the bricks in the rows/columns each move covers. Each brick
+ * scores a point, and a fresh wall goes up when the last one falls.
+ * 
+ * @param engine Pointer to game engine
+ */
+static void PongEngine_CheckBrickCollision(PongEngine_t* engine) {
+    BrickField_t* bricks = &engine->bricks;
+    if (bricks->rows == 0) {
+        return;  // Brick mode off
+    }
+    BallSet_t* balls = &engine->balls;
+    AABB wall_box = Bricks_GetAABB(bricks);
+    uint8_t hits = 0;
 
-        // Add a small random offset in range [-BALL_RESET_OFFSET, BALL_RESET_OFFSET] to vary the reset position
-        int16_t dx = (int16_t)Random_U16((uint16_t)(2 * BALL_RESET_OFFSET + 1)) - BALL_RESET_OFFSET;
-        int16_t dy = (int16_t)Random_U16((uint16_t)(2 * BALL_RESET_OFFSET + 1)) - BALL_RESET_OFFSET;
+    uint8_t candidates[BALL_MAX_COUNT];
+    uint8_t n = PongEngine_QueryBalls(engine, &wall_box, candidates);
 
-        center_pos.x += dx;
-        center_pos.y += dy;
+    for (uint8_t k = 0; k < n; k++) {
+        uint8_t i = candidates[k];
+        FixedVector2D move = {balls->vx[i] >> engine->substep_shift, balls->vy[i] >> engine->substep_shift};
+        AABB_SweepResult contact;
+        AABB brick;
+        if (Bricks_Hit(bricks, balls->prev_x[i], balls->prev_y[i], balls->size[i], move, &contact, &brick)) {
+            PongEngine_Reflect(balls, i, &contact, &brick);
+            PongEngine_Hit(engine, i, -1, 0, PONG_EVENT_BRICK_HIT, PONG_SIDE_LEFT);
+            PongEngine_AddScore(engine, PONG_SIDE_LEFT);
+            hits++;
+        }
+    }
 
-        Ball_SetPos(ball, center_pos);
+    if (hits) {
+        if (Bricks_GetRemaining(bricks) == 0) {
+            Bricks_Reset(bricks);
+        }
+    }
+}
 
-        // Reset velocity to initial direction (move right)
-        Ball_SetVelocity(ball, 8.0f * 0.707f, 8.0f * 0.707f);
+/**
+ * @brief Check if balls have left the play area (missed paddle)
+ * 
+ * A ball beyond the left edge is removed while others are still in play.
+ * When the last ball goes out, decrement lives and reset it to center.
+ * With the CPU opponent, a ball beyond the right edge is the player's point
+ * and the CPU's miss; the last ball is then served back towards the player.
+ * 
+ * @param engine Pointer to game engine
+ */
+static void PongEngine_CheckGoal(PongEngine_t* engine) {
+    BallSet_t* balls = &engine->balls;
+    
+    // Walk backwards so removing a ball (which moves the last one into its slot) is safe
+    for (uint8_t i = balls->count; i-- > 0;) {
+        // Ball left the left edge (missed by paddle)
+        uint8_t missed = (balls->x[i] < 0);
+#if PONG_RIGHT_PADDLE
+        // Ball left the right edge (missed by the CPU or the right player)
+        uint8_t won = (balls->x[i] > Fixed_FromInt(SCREEN_WIDTH - balls->size[i]));
+#else
+        uint8_t won = 0;
+#endif
+        if (!missed && !won) {
+            continue;
+        }
+        PongEngine_Note(engine, PONG_EVENT_GOAL, missed ? PONG_SIDE_LEFT : PONG_SIDE_RIGHT, 0);
+        PongEngine_AddScore(engine, missed ? PONG_SIDE_RIGHT : PONG_SIDE_LEFT);
+        engine->ai_replan = 1;
+        if (balls->count > 1) {
+            BallSet_Remove(balls, i);
+        } else {
+            if (missed) {
+                engine->lives--;
+                PongEngine_Note(engine, PONG_EVENT_LIFE_LOST, PONG_SIDE_LEFT, engine->lives);
+            }
+            PongEngine_ResetBall(engine, i, won ? -1 : 1);
+        }
     }
 }
 
@@ -165,42 +721,509 @@ void PongEngine_Init(PongEngine_t* engine,
                      int16_t paddle_width, int16_t paddle_height,
                      int16_t ball_size, float ball_speed) {
     // Initialize ball at center
-    Ball_Init(&engine->ball, ball_size, ball_speed);
+    Ball_t ball;
+    Ball_Init(&ball, ball_size, ball_speed);
+    engine->serve_speed = FIXED_FROM_FLOAT(ball_speed);
+    engine->substep_shift = 0;
+    engine->max_substeps = 1;
+    BallSet_Clear(&engine->balls);
+    BallSet_Add(&engine->balls, &ball);
     
     // Initialize paddle with faster movement for responsiveness
     Paddle_Init(&engine->paddle, paddle_x, paddle_y, 
                 paddle_width, paddle_height, 6);  // speed = 6 pixels/frame (increased from 3)
+    Paddle_SetResponse(&engine->paddle, PONG_PADDLE_RESPONSE);
+    
+    // Right paddle mirrors the player's (drawn and played only with PONG_RIGHT_PADDLE)
+    Paddle_Init(&engine->opponent, SCREEN_WIDTH - paddle_x - paddle_width, paddle_y,
+                paddle_width, paddle_height, 6);
+    PongAI_Init(&engine->ai, PONG_AI_REACTION_STEPS, paddle_y + paddle_height / 2);
+    PongAI_Init(&engine->demo_ai, PONG_AI_REACTION_STEPS / 4, paddle_y + paddle_height / 2);  // The serve is half a court away
+    engine->ai_replan = 1;
+    
+    // Brick wall on the right, below the score (or an empty field when brick mode is off)
+    Bricks_Init(&engine->bricks, BRICK_WALL_X, BRICK_WALL_Y,
+                PONG_BRICK_MODE ? BRICK_WALL_COLS : 0, PONG_BRICK_MODE ? BRICK_WALL_ROWS : 0,
+                BRICK_WALL_PITCH_X, BRICK_WALL_PITCH_Y, BRICK_WALL_GAP, BRICK_WALL_COLOUR);
+    
+    engine->replay = NULL;
+    engine->quiet = 0;
+    engine->event_head = 0;
+    engine->event_tail = 0;
+    engine->events_dropped = 0;
+    Sfx_Init(&engine->sfx, pong_effects, sizeof(pong_effects) / sizeof(pong_effects[0]));
+#if PONG_PARTICLES
+    Particles_Clear(&engine->particles);
+#endif
+#if PONG_PHOSPHOR_TRAILS
+    Phosphor_Clear(&engine->phosphor);  // The screen is drawn afresh for a new game
+#endif
+    
+    // Empty the per-game arena (set up on the first call, after which the high-water mark is
+    // kept so it covers every game)
+    if (engine->round_arena.memory == (uint8_t*)engine->round_memory) {
+        Arena_Reset(&engine->round_arena);
+    } else {
+        Arena_Init(&engine->round_arena, engine->round_memory, sizeof(engine->round_memory));
+    }
     
     // Initialize lives
     engine->lives = 4;  // Give player 4 lives
 }
 
-uint8_t PongEngine_Update(PongEngine_t* engine, UserInput input) {
+/**
+ * @brief One physics step
+ * 
+ * @param engine Pointer to game engine
+ * @param input Input for the left paddle
+ * @param right Input for the right paddle, or NULL for the CPU (PONG_AI_OPPONENT)
+ * @param summary Summary of a PongEngine_UpdateN() to count the step's events in, or NULL
+ * @return Remaining lives
+ */
+static uint8_t PongEngine_Step(PongEngine_t* engine, UserInput input, const UserInput* right,
+                               PongEngine_Summary_t* summary) {
+    const uint32_t first_event = engine->event_head;
+
+    // Journal this step's input, or swap in the recorded one when replaying
+    if (engine->replay) {
+        Replay_Step(engine->replay, &input);
+    }
+    
     // Step 1: Update paddle based on input
     Paddle_Update(&engine->paddle, input);
+    if (right) {
+        Paddle_Update(&engine->opponent, *right);
+    }
+#if PONG_AI_OPPONENT
+    else {
+        PongEngine_UpdateOpponent(engine);
+    }
+#endif
     
-    // Step 2: Update ball position
-    Ball_Update(&engine->ball);
+    // Steps 2 and 3, once per substep: move the balls, then check collisions
+    BallSet_t* balls = &engine->balls;
+    const uint8_t shift = PongEngine_SubstepShift(balls);
+    const uint8_t substeps = (uint8_t)(1u << shift);
+    engine->substep_shift = shift;
+    if (substeps > engine->max_substeps) {
+        engine->max_substeps = substeps;
+    }
+    for (uint8_t s = 0; s < substeps; s++) {
+        BallSet_UpdatePart(balls, shift);
+        PongEngine_BuildGrid(engine);
+        PongEngine_CheckPaddles(engine, 0);         // Hit paddles (swept AABB)
+        PongEngine_CheckBrickCollision(engine);     // Knock down bricks (brick mode)
+        PongEngine_CheckWallCollision(engine);      // Bounce off top/bottom/right
+        if (PongEngine_CheckPaddles(engine, 1) &&   // Walls bounced into a paddle,
+            PongEngine_CheckWallCollision(engine)) { // ...and its end back past a wall:
+            PongEngine_CheckPaddles(engine, 2);     // caught between the two, pushed out
+        }
+        PongEngine_CheckGoal(engine);               // Check if ball left play area
+    }
+    if (shift) {
+        // Drawing goes from the previous position to this one: stretch the last substep's
+        // move back over the whole step (a ball just served has none, and stays put)
+        for (uint8_t i = 0; i < balls->count; i++) {
+            balls->prev_x[i] = balls->x[i] - (balls->x[i] - balls->prev_x[i]) * substeps;
+            balls->prev_y[i] = balls->y[i] - (balls->y[i] - balls->prev_y[i]) * substeps;
+        }
+    }
+    // Step 4: sparks, beeps and traces for what happened, then the sparks fly on and fade
+    PongEngine_HandleEvents(engine, first_event, summary);
+#if PONG_PARTICLES
+    Particles_Update(&engine->particles);
+#endif
+
+    return engine->lives;
+}
+
+uint8_t PongEngine_Update(PongEngine_t* engine, UserInput input) {
+    return PongEngine_Step(engine, input, NULL, NULL);
+}
+
+uint8_t PongEngine_UpdateVersus(PongEngine_t* engine, UserInput left, UserInput right) {
+    return PongEngine_Step(engine, left, &right, NULL);
+}
+
+uint8_t PongEngine_UpdateN(PongEngine_t* engine, const UserInput* inputs, uint32_t n,
+                           PongEngine_Summary_t* summary) {
+    static const UserInput centred = {CENTRE, 0.0f, -1.0f};
+    if (summary) {
+        memset(summary, 0, sizeof(*summary));
+    }
+    // Kept, for a rollback that looks ahead while it runs quiet already
+    const uint8_t quiet = engine->quiet;
+    engine->quiet = 1;
+    uint32_t steps = 0;
+    while (steps < n && engine->lives > 0) {
+        PongEngine_Step(engine, inputs ? inputs[steps] : centred, NULL, summary);
+        steps++;
+    }
+    engine->quiet = quiet;
+    if (summary) {
+        summary->steps = steps;
+    }
+    return engine->lives;
+}
+
+#if PONG_AI_OPPONENT
+uint8_t PongEngine_UpdateDemo(PongEngine_t* engine) {
+    // Planned before the step, which clears ai_replan once the right paddle has planned too
+    if (engine->ai_replan) {
+        PongAI_PlanLeft(&engine->demo_ai, &engine->balls, &engine->paddle, SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+    return PongEngine_Step(engine, PongAI_GetInput(&engine->demo_ai, &engine->paddle), NULL, NULL);
+}
+#endif
+
+void PongEngine_Save(const PongEngine_t* engine, PongEngine_Snapshot_t* snapshot) {
+    snapshot->balls = engine->balls;
+    snapshot->paddle = engine->paddle;
+    snapshot->opponent = engine->opponent;
+    snapshot->ai = engine->ai;
+    snapshot->ai_replan = engine->ai_replan;
+    snapshot->bricks = engine->bricks;
+#if PONG_PARTICLES
+    snapshot->particles = engine->particles;
+#endif
+    snapshot->lives = engine->lives;
+    snapshot->round_used = engine->round_arena.used;
+    memcpy(snapshot->round_memory, engine->round_memory, engine->round_arena.used);
+    snapshot->random_state = random_state;
+}
+
+/**
+ * @brief Restore a paddle, keeping where it is drawn on the screen
+ */
+static void PongEngine_RestorePaddle(Paddle_t* paddle, const Paddle_t* saved) {
+    LCD_Retained_Area drawn = paddle->drawn;
+    *paddle = *saved;
+    paddle->drawn = drawn;
+}
+
+/**
+ * @brief Set which bricks stand, keeping track of what the screen shows
+ * 
+ * The screen shows the bricks as they are now: the ones alive has knocked
+ * down are erased, and a row is redrawn in full where it has any standing again.
+ */
+static void PongEngine_RestoreBricks(BrickField_t* bricks, const uint16_t* alive) {
+    uint16_t remaining = 0;
+    for (uint8_t r = 0; r < bricks->rows; r++) {
+        uint16_t shown = bricks->alive[r] | bricks->erase_pending[r];
+        if (alive[r] & ~shown) {
+            bricks->row_area[r].stale = 1;
+        }
+        bricks->erase_pending[r] = shown & ~alive[r];
+        bricks->alive[r] = alive[r];
+        remaining += (uint16_t)__builtin_popcount(alive[r]);
+    }
+    bricks->remaining = remaining;
+}
+
+void PongEngine_Restore(PongEngine_t* engine, const PongEngine_Snapshot_t* snapshot) {
+    engine->balls = snapshot->balls;
+    PongEngine_RestorePaddle(&engine->paddle, &snapshot->paddle);
+    PongEngine_RestorePaddle(&engine->opponent, &snapshot->opponent);
+    engine->ai = snapshot->ai;
+    engine->ai_replan = snapshot->ai_replan;
+    PongEngine_RestoreBricks(&engine->bricks, snapshot->bricks.alive);
     
-    // Step 3: Check collisions
-    PongEngine_CheckWallCollision(engine);      // Bounce off top/bottom
-    PongEngine_CheckPaddleCollision(engine);    // Hit paddle (with AABB)
-    PongEngine_CheckGoal(engine);               // Check if ball left play area
+#if PONG_PARTICLES
+    engine->particles = snapshot->particles;
+#endif
+    engine->lives = snapshot->lives;
+    engine->round_arena.used = snapshot->round_used;
+    memcpy(engine->round_memory, snapshot->round_memory, snapshot->round_used);
+    random_state = snapshot->random_state;
+}
+
+// Packed fields are in the board's own byte order (little-endian). memcpy() of a constant
+// size is a single unaligned load or store on the Cortex-M4, and safe on any host.
+static inline uint8_t* PongEngine_Put16(uint8_t* p, uint16_t v) { memcpy(p, &v, 2); return p + 2; }
+static inline uint8_t* PongEngine_Put32(uint8_t* p, uint32_t v) { memcpy(p, &v, 4); return p + 4; }
+static inline uint16_t PongEngine_Get16(const uint8_t* p) { uint16_t v; memcpy(&v, p, 2); return v; }
+static inline uint32_t PongEngine_Get32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+#define PONG_PACKED_MAGIC 0x50  // 'P'
+
+static uint8_t* PongEngine_PackPaddle(uint8_t* p, const Paddle_t* paddle) {
+    p = PongEngine_Put16(p, (uint16_t)paddle->y);
+    *p++ = paddle->y_frac;
+    return PongEngine_Put16(p, paddle->score);
+}
+
+static const uint8_t* PongEngine_UnpackPaddle(const uint8_t* p, Paddle_t* paddle) {
+    paddle->y = paddle->prev_y = (int16_t)PongEngine_Get16(p);
+    paddle->y_frac = p[2];
+    paddle->score = PongEngine_Get16(p + 3);
+    return p + 5;
+}
+
+uint16_t PongEngine_Pack(const PongEngine_t* engine, uint8_t* out, uint16_t size) {
+    const BallSet_t* balls = &engine->balls;
+    const BrickField_t* bricks = &engine->bricks;
+    const uint16_t length = PONG_PACKED_BYTES(balls->count, bricks->rows);
+    if (length > size) {
+        return 0;
+    }
     
-    PongEngine_UpdateBuzzer();
+    uint8_t* p = out;
+    *p++ = PONG_PACKED_MAGIC;
+    *p++ = PONG_PACKED_VERSION;
+    *p++ = balls->count;
+    *p++ = bricks->rows;
+    p = PongEngine_Put32(p, (uint32_t)random_state);
+    p = PongEngine_Put32(p, (uint32_t)(random_state >> 32));
+    *p++ = engine->lives;
+    *p++ = engine->ai_replan;
+    p = PongEngine_PackPaddle(p, &engine->paddle);
+    p = PongEngine_PackPaddle(p, &engine->opponent);
+    p = PongEngine_Put16(p, (uint16_t)engine->ai.target_y);
+    p = PongEngine_Put16(p, (uint16_t)engine->ai.planned_y);
+    *p++ = engine->ai.delay;
+    for (uint8_t i = 0; i < balls->count; i++) {
+        p = PongEngine_Put32(p, (uint32_t)balls->x[i]);
+        p = PongEngine_Put32(p, (uint32_t)balls->y[i]);
+        p = PongEngine_Put32(p, (uint32_t)balls->vx[i]);
+        p = PongEngine_Put32(p, (uint32_t)balls->vy[i]);
+        *p++ = (uint8_t)balls->size[i];
+    }
+    for (uint8_t r = 0; r < bricks->rows; r++) {
+        p = PongEngine_Put16(p, bricks->alive[r]);
+    }
+    return length;
+}
 
-    return engine->lives;
+uint8_t PongEngine_Unpack(PongEngine_t* engine, const uint8_t* data, uint16_t length) {
+    if (length < PONG_PACKED_BYTES(0, 0) || data[0] != PONG_PACKED_MAGIC ||
+        data[1] != PONG_PACKED_VERSION || data[2] == 0 || data[2] > BALL_MAX_COUNT ||
+        data[3] != engine->bricks.rows || length != PONG_PACKED_BYTES(data[2], data[3])) {
+        return 0;
+    }
+    
+    const uint8_t* p = data + 4;
+    random_state = PongEngine_Get32(p) | ((uint64_t)PongEngine_Get32(p + 4) << 32);
+    p += 8;
+    engine->lives = *p++;
+    engine->ai_replan = *p++;
+    p = PongEngine_UnpackPaddle(p, &engine->paddle);
+    p = PongEngine_UnpackPaddle(p, &engine->opponent);
+    engine->ai.target_y = (int16_t)PongEngine_Get16(p);
+    engine->ai.planned_y = (int16_t)PongEngine_Get16(p + 2);
+    engine->ai.delay = p[4];
+    p += 5;
+    
+    BallSet_t* balls = &engine->balls;
+    balls->count = data[2];
+    for (uint8_t i = 0; i < balls->count; i++) {
+        balls->x[i] = balls->prev_x[i] = (Fixed16)PongEngine_Get32(p);
+        balls->y[i] = balls->prev_y[i] = (Fixed16)PongEngine_Get32(p + 4);
+        balls->vx[i] = (Fixed16)PongEngine_Get32(p + 8);
+        balls->vy[i] = (Fixed16)PongEngine_Get32(p + 12);
+        balls->size[i] = p[16];
+        p += 17;
+    }
+    
+    uint16_t alive[BRICK_MAX_ROWS];
+    for (uint8_t r = 0; r < engine->bricks.rows; r++) {
+        alive[r] = PongEngine_Get16(p);
+        p += 2;
+    }
+    PongEngine_RestoreBricks(&engine->bricks, alive);
+#if PONG_PARTICLES
+    Particles_Clear(&engine->particles);
+#endif
+    return 1;
+}
+
+// Particles and balls at the engine's detail level
+static void draw_detail(PongEngine_t* engine, uint16_t alpha) {
+#if PONG_PARTICLES
+    // Drawn where they are: sparks move too fast to notice
+    if (engine->detail == PONG_DETAIL_FULL) {
+        Particles_Draw(&engine->particles);
+    } else if (engine->detail == PONG_DETAIL_FEWER_SPARKS) {
+        Particles_DrawSome(&engine->particles, (uint16_t)(engine->particles.count / 2));
+    }
+#endif
+    if (engine->detail == PONG_DETAIL_MINIMAL) {
+        BallSet_DrawInterpolatedSquares(&engine->balls, alpha);
+    } else {
+#if PONG_BALL_TRAILS
+        if (engine->detail == PONG_DETAIL_FULL && engine->trail_table != NULL) {
+            BallSet_DrawTrails(&engine->balls, alpha, engine->trail_colour, engine->trail_table);
+        }
+#endif
+        BallSet_DrawInterpolated(&engine->balls, alpha);
+    }
 }
 
+#if PONG_PHOSPHOR_TRAILS
+// Fades the trails and stamps each ball where it is drawn now. First of all, as trail pixels
+// are painted over whatever is under them.
+static void draw_phosphor(PongEngine_t* engine, uint16_t alpha) {
+    Phosphor_Decay(&engine->phosphor);
+    if (engine->detail != PONG_DETAIL_FULL) {
+        return;
+    }
+    const BallSet_t* balls = &engine->balls;
+    for (uint8_t i = 0; i < balls->count; i++) {
+        const int16_t radius = balls->size[i] / 2;
+        Phosphor_StampCircle(&engine->phosphor,
+                             Fixed_ToInt(Fixed_Lerp(balls->prev_x[i], balls->x[i], alpha)) + radius,
+                             Fixed_ToInt(Fixed_Lerp(balls->prev_y[i], balls->y[i], alpha)) + radius,
+                             radius);
+    }
+}
+#endif
+
 void PongEngine_Draw(PongEngine_t* engine) {
-    Ball_Draw(&engine->ball);
+#if PONG_PHOSPHOR_TRAILS
+    draw_phosphor(engine, LERP_ONE);
+#endif
+    // Paddles before balls: a moving paddle erases the strip it left (see Paddle_Draw())
+    Bricks_Draw(&engine->bricks);
     Paddle_Draw(&engine->paddle);
+#if PONG_RIGHT_PADDLE
+    Paddle_Draw(&engine->opponent);
+#endif
+    draw_detail(engine, LERP_ONE);
+}
+
+void PongEngine_DrawInterpolated(PongEngine_t* engine, uint16_t alpha) {
+#if PONG_PHOSPHOR_TRAILS
+    draw_phosphor(engine, alpha);
+#endif
+    Bricks_Draw(&engine->bricks);
+    Paddle_DrawInterpolated(&engine->paddle, alpha);
+#if PONG_RIGHT_PADDLE
+    Paddle_DrawInterpolated(&engine->opponent, alpha);
+#endif
+    draw_detail(engine, alpha);
+}
+
+void PongEngine_SetDetail(PongEngine_t* engine, PongEngine_Detail_t detail) {
+    engine->detail = (uint8_t)detail;
+}
+
+#if PONG_BALL_TRAILS
+void PongEngine_SetTrails(PongEngine_t* engine, uint8_t colour, const struct LCD_Blend_Table* table) {
+    engine->trail_colour = colour;
+    engine->trail_table = table;
+}
+#endif
+
+#if PONG_PHOSPHOR_TRAILS
+void PongEngine_SetPhosphor(PongEngine_t* engine, const uint8_t* ramp, uint8_t levels) {
+    Phosphor_SetRamp(&engine->phosphor, ramp, levels, 0);
+}
+#endif
+
+void* PongEngine_RoundAlloc(PongEngine_t* engine, uint16_t size) {
+    return Arena_Alloc(&engine->round_arena, size);
+}
+
+uint8_t PongEngine_SpawnBall(PongEngine_t* engine) {
+    BallSet_t* balls = &engine->balls;
+    if (balls->count == 0) {
+        return 0;
+    }
+    Ball_t ball;
+    BallSet_Get(balls, 0, &ball);
+    ball.velocity.y = -ball.velocity.y;
+    engine->ai_replan = 1;
+    return (BallSet_Add(balls, &ball) >= 0) ? 1 : 0;
+}
+
+void PongEngine_Watch(PongEngine_t* engine, PongEngine_Watch_t* watch) {
+    watch->score = Paddle_GetScore(&engine->paddle);
+    watch->lives = engine->lives;
+    watch->balls = engine->balls.count;
+}
+
+uint8_t PongEngine_Check(PongEngine_t* engine, const PongEngine_Watch_t* before) {
+    const BallSet_t* balls = &engine->balls;
+    uint8_t broken = 0;
+
+    // Speeds a ball can have, squared (Q32): anything from the serve to the top of the ramp,
+    // with 1% for the rounding of the bounce table
+#if PONG_SPEED_RAMP_HITS
+    const int64_t top = FIXED_FROM_FLOAT(PONG_BALL_MAX_SPEED);
+#else
+    const int64_t top = engine->serve_speed;
+#endif
+    const int64_t low = (int64_t)engine->serve_speed * engine->serve_speed;
+    const int64_t slowest = low - low / 50;
+    const int64_t fastest = top * top + (top * top) / 50;
+
+    AABB paddle_box = Paddle_GetAABB(&engine->paddle);
+#if PONG_RIGHT_PADDLE
+    AABB opponent_box = Paddle_GetAABB(&engine->opponent);
+#endif
+    for (uint8_t i = 0; i < balls->count; i++) {
+        const int16_t size = balls->size[i];
+        if (balls->x[i] < 0 || balls->x[i] > Fixed_FromInt(SCREEN_WIDTH - size) ||
+            balls->y[i] < 0 || balls->y[i] > Fixed_FromInt(SCREEN_HEIGHT - size)) {
+            broken |= PONG_CHECK_BALL_OUT;
+        }
+        AABB box = BallSet_GetAABB(balls, i);
+        if (AABB_Collides(&box, &paddle_box)) {
+            broken |= PONG_CHECK_IN_PADDLE;
+        }
+#if PONG_RIGHT_PADDLE
+        if (AABB_Collides(&box, &opponent_box)) {
+            broken |= PONG_CHECK_IN_PADDLE;
+        }
+#endif
+        const int64_t speed = (int64_t)balls->vx[i] * balls->vx[i] + (int64_t)balls->vy[i] * balls->vy[i];
+        if (speed < slowest || speed > fastest) {
+            broken |= PONG_CHECK_BALL_SPEED;
+        }
+    }
+
+    if (engine->lives > before->lives || engine->lives + 1 < before->lives) {
+        broken |= PONG_CHECK_LIVES;
+    }
+    const uint16_t score = Paddle_GetScore(&engine->paddle);
+    // Each ball (counting any the step split off) can hit a paddle three times a substep:
+    // the sweep, again after a wall (the settle pass) and when caught by a wall (the pinch)
+    const uint8_t in_play = (balls->count > before->balls) ? balls->count : before->balls;
+    const uint32_t most = ((uint32_t)in_play * 3u) << engine->substep_shift;
+    if (score < before->score || (uint32_t)(score - before->score) > most) {
+        broken |= PONG_CHECK_SCORE;
+    }
+    return broken;
+}
+
+uint8_t PongEngine_GetBallCount(PongEngine_t* engine) {
+    return engine->balls.count;
+}
+
+void PongEngine_SetReplay(PongEngine_t* engine, Replay_t* replay) {
+    engine->replay = replay;
+}
+
+void PongEngine_SetAIReaction(PongEngine_t* engine, uint8_t reaction_steps) {
+    engine->ai.reaction_steps = reaction_steps;
+}
+
+uint16_t PongEngine_GetOpponentScore(PongEngine_t* engine) {
+    return Paddle_GetScore(&engine->opponent);
 }
 
 uint8_t PongEngine_GetLives(PongEngine_t* engine) {
     return engine->lives;
 }
 
+uint8_t PongEngine_PollEvent(PongEngine_t* engine, PongEngine_Event_t* event) {
+    if (engine->event_tail == engine->event_head) {
+        return 0;
+    }
+    *event = engine->events[engine->event_tail++ & (PONG_EVENT_QUEUE_LEN - 1)];
+    return 1;
+}
+
 uint16_t PongEngine_GetScore(PongEngine_t* engine) {
     return Paddle_GetScore(&engine->paddle);
 }
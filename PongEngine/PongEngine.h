@@ -13,21 +13,283 @@
 #include "Ball.h"
 #include "Paddle.h"
 #include "Utils.h"
+#include "SpatialGrid.h"
+#include "Bricks.h"
+#include "PongAI.h"
+#include "Replay.h"
+#include "Pool.h"
+#include "Particles.h"
+#include "Phosphor.h"
+#include "Sfx.h"
+
+// Physics steps per second. PongEngine_Update() is one step; speeds are in pixels per step,
+// so changing this changes game speed. The display rate is independent (see main.c).
+#ifndef PONG_PHYSICS_HZ
+#define PONG_PHYSICS_HZ 60
+#endif
+
+// Multi-ball power-up: every this many paddle hits splits a ball in two, up to
+// BALL_MAX_COUNT. 0 turns the power-up off (classic single-ball game).
+#ifndef PONG_MULTIBALL_HITS
+#define PONG_MULTIBALL_HITS 0
+#endif
+
+// Set to 1 for brick wall mode: a Breakout-style wall on the right scores a point per brick
+#ifndef PONG_BRICK_MODE
+#define PONG_BRICK_MODE 0
+#endif
+
+// Set to 1 for a CPU opponent: a second paddle on the right replaces the right wall.
+// A ball past it scores for the player; a ball past the player's paddle costs a life.
+#ifndef PONG_AI_OPPONENT
+#define PONG_AI_OPPONENT 0
+#endif
+
+// CPU reaction time in physics steps: how long after a ball changes direction the
+// opponent starts moving to meet it. Lower is harder (0 = perfect play at paddle speed).
+#ifndef PONG_AI_REACTION_STEPS
+#define PONG_AI_REACTION_STEPS 12
+#endif
+
+// Player paddle response to joystick deflection: PADDLE_RESPONSE_DIGITAL (full speed
+// whenever pushed), PADDLE_RESPONSE_LINEAR or PADDLE_RESPONSE_EXPO (proportional)
+#ifndef PONG_PADDLE_RESPONSE
+#define PONG_PADDLE_RESPONSE PADDLE_RESPONSE_DIGITAL
+#endif
+
+// Set to 1 for spark bursts where a ball hits a wall, paddle or brick (3KB of RAM for
+// PARTICLE_MAX_COUNT particles)
+#ifndef PONG_PARTICLES
+#define PONG_PARTICLES 0
+#endif
+
+// Set to 1 to draw each ball with a translucent trail a step behind it, blended into what is
+// under it by the table given to PongEngine_SetTrails() (none until then)
+#ifndef PONG_BALL_TRAILS
+#define PONG_BALL_TRAILS 0
+#endif
+
+// Set to 1 for phosphor trails instead: each ball leaves a copy of itself that fades out through
+// the colours given to PongEngine_SetPhosphor(), a level a frame (1KB of RAM, see Phosphor.h)
+#ifndef PONG_PHOSPHOR_TRAILS
+#define PONG_PHOSPHOR_TRAILS 0
+#endif
+#if PONG_PHOSPHOR_TRAILS && PONG_BALL_TRAILS
+#error "PONG_PHOSPHOR_TRAILS and PONG_BALL_TRAILS are two kinds of trail, choose one"
+#endif
+
+// Bytes of the per-game arena (PongEngine_RoundAlloc()), for entities that live until the
+// game ends. Emptied by PongEngine_Init().
+#ifndef PONG_ROUND_ARENA_BYTES
+#define PONG_ROUND_ARENA_BYTES 256
+#endif
+
+// Set to 1 for two players on two boards linked by a UART (see Lockstep.h): the right paddle
+// replaces the right wall, as with PONG_AI_OPPONENT, and is moved by the other board's joystick
+#ifndef PONG_LINK_PLAY
+#define PONG_LINK_PLAY 0
+#endif
+
+// Set to 1 for two players on one board: the right paddle replaces the right wall, as with
+// PONG_AI_OPPONENT, and is moved by a second joystick sampled in the same ADC scan as the first
+#ifndef PONG_TWO_STICKS
+#define PONG_TWO_STICKS 0
+#endif
+
+// Set to 1 to play the beeps through the buzzer mixer (see Mixer.h) instead of the sequencer:
+// a beep starting while another plays is mixed with it rather than cutting it off
+#ifndef PONG_AUDIO_MIXER
+#define PONG_AUDIO_MIXER 0
+#endif
+
+// Difficulty ramp: every PONG_SPEED_RAMP_HITS points the ball gets PONG_SPEED_RAMP_STEP
+// pixels/step faster, up to PONG_BALL_MAX_SPEED, from its next serve or paddle hit.
+// 0 keeps the serve speed all game.
+#ifndef PONG_SPEED_RAMP_HITS
+#define PONG_SPEED_RAMP_HITS 0
+#endif
+#ifndef PONG_SPEED_RAMP_STEP
+#define PONG_SPEED_RAMP_STEP 0.5f
+#endif
+#ifndef PONG_BALL_MAX_SPEED
+#define PONG_BALL_MAX_SPEED 20.0f
+#endif
+
+// A fast ball's step is split into substeps (1, 2 or 4, the fewest that will do) that move
+// it no more than PONG_SUBSTEP_MAX_PX along either axis. The paddle and brick sweeps catch
+// whatever a move passes through, but each move gets one bounce: shorter moves keep a ball
+// from bouncing off a wall and into the paddle (or out of the court) unseen in one step.
+// At most PONG_MAX_SUBSTEPS, so a step never costs more than that many collision passes.
+#ifndef PONG_SUBSTEP_MAX_PX
+#define PONG_SUBSTEP_MAX_PX 8
+#endif
+#define PONG_MAX_SUBSTEPS 4
+
+// Engine events (PongEngine_PollEvent()) kept for the application between its reads, a power
+// of 2. An application that falls further behind loses the oldest.
+#ifndef PONG_EVENT_QUEUE_LEN
+#define PONG_EVENT_QUEUE_LEN 32
+#endif
+#if (PONG_EVENT_QUEUE_LEN & (PONG_EVENT_QUEUE_LEN - 1)) != 0
+#error "PONG_EVENT_QUEUE_LEN must be a power of 2"
+#endif
+
+#if PONG_AI_OPPONENT && PONG_BRICK_MODE
+#error "PONG_AI_OPPONENT and PONG_BRICK_MODE both use the right of the court"
+#endif
+#if PONG_LINK_PLAY && (PONG_AI_OPPONENT || PONG_BRICK_MODE)
+#error "PONG_LINK_PLAY uses the right of the court for the second player"
+#endif
+#if PONG_TWO_STICKS && (PONG_AI_OPPONENT || PONG_BRICK_MODE || PONG_LINK_PLAY)
+#error "PONG_TWO_STICKS uses the right of the court for the second player"
+#endif
+
+// Court with a paddle on the right instead of a wall
+#define PONG_RIGHT_PADDLE (PONG_AI_OPPONENT || PONG_LINK_PLAY || PONG_TWO_STICKS)
+
+/**
+ * @enum PongEngine_Detail_t
+ * @brief How much optional drawing PongEngine_Draw() does (the game plays the same at each)
+ */
+typedef enum {
+    PONG_DETAIL_FULL = 0,       ///< Everything
+    PONG_DETAIL_FEWER_SPARKS,   ///< Only every other particle drawn
+    PONG_DETAIL_MINIMAL         ///< No particles, balls drawn as squares
+} PongEngine_Detail_t;
+
+/**
+ * @enum PongEngine_EventType_t
+ * @brief What a PongEngine_Event_t reports
+ */
+typedef enum {
+    PONG_EVENT_WALL_HIT = 1,    ///< A ball bounced off a wall
+    PONG_EVENT_PADDLE_HIT,      ///< A ball bounced off side's paddle
+    PONG_EVENT_BRICK_HIT,       ///< A ball knocked a brick down
+    PONG_EVENT_GOAL,            ///< A ball went out past side's paddle
+    PONG_EVENT_SCORE_CHANGED,   ///< side's score went up; value: the new score
+    PONG_EVENT_LIFE_LOST        ///< The last ball went out on the left; value: lives left
+} PongEngine_EventType_t;
+
+#define PONG_SIDE_LEFT 0        ///< The player's paddle (PongEngine_GetScore())
+#define PONG_SIDE_RIGHT 1       ///< The CPU's or second player's (PongEngine_GetOpponentScore())
+
+/**
+ * @struct PongEngine_Event_t
+ * @brief Something that happened in a step
+ */
+typedef struct {
+    uint8_t type;       // PongEngine_EventType_t
+    uint8_t side;       // PONG_SIDE_x of the paddle hit, the goal or the score
+    int8_t facing_x;    // Hits: side the ball bounced to (-1, 0 or 1)
+    int8_t facing_y;
+    int16_t x;          // Hits: middle of the ball at the hit, pixels
+    int16_t y;
+    uint16_t value;     // Scores and lives: see the type
+} PongEngine_Event_t;
+
+/**
+ * @struct PongEngine_Summary_t
+ * @brief What happened over the steps of a PongEngine_UpdateN(), in place of its events
+ */
+typedef struct {
+    uint32_t steps;             // Steps run: all of them, or fewer if the game ended
+    uint32_t wall_hits;
+    uint32_t paddle_hits[2];    // By PONG_SIDE_x of the paddle
+    uint32_t brick_hits;
+    uint32_t goals[2];          // By PONG_SIDE_x the ball went out past
+    uint32_t lives_lost;
+} PongEngine_Summary_t;
 
 /**
  * @struct PongEngine_t
  * @brief Main game engine object
  */
 typedef struct {
-    Ball_t ball;         // Ball object
+    BallSet_t balls;     // All balls in play (ball 0 is the first ball)
     Paddle_t paddle;     // Paddle object
+    Paddle_t opponent;   // Right paddle (only in play with PONG_RIGHT_PADDLE)
+    PongAI_t ai;         // CPU opponent state
+    PongAI_t demo_ai;    // CPU on the left paddle in the attract demo (PongEngine_UpdateDemo())
+    uint8_t ai_replan;   // Set when a ball changes X direction, so the CPU plans a new intercept
+    BrickField_t bricks; // Brick wall (no rows unless PONG_BRICK_MODE)
+    SpatialGrid_t grid;  // Broad phase: which cells each ball swept through this step
+    Replay_t* replay;    // Input/RNG journal being recorded or played (NULL for none)
+#if PONG_PARTICLES
+    ParticleSet_t particles; // Collision sparks
+#endif
     uint8_t lives;       // Remaining lives (game over when 0)
+    uint8_t quiet;       // Set while steps are simulated again (rollback): no beeps
+    Sfx_t sfx;           // Which beeps are heard (not saved: nothing in the game depends on it)
+    uint8_t detail;      // PongEngine_Detail_t, drawing only (kept by PongEngine_Init())
+#if PONG_BALL_TRAILS
+    const struct LCD_Blend_Table* trail_table;  // Trail opacity (PONG_BALL_TRAILS), kept by PongEngine_Init()
+    uint8_t trail_colour;
+#endif
+#if PONG_PHOSPHOR_TRAILS
+    Phosphor_t phosphor; // Fading ball trails (drawing only, not saved); the ramp is kept by PongEngine_Init()
+#endif
+    Fixed16 serve_speed; // Ball speed at the serve, pixels/step (the ball_speed of PongEngine_Init())
+    uint8_t substep_shift; // Log2 of the substeps in the current step
+    uint8_t max_substeps;  // Most substeps a step has taken since PongEngine_Init()
+    PongEngine_Event_t events[PONG_EVENT_QUEUE_LEN]; // Events of the steps not yet read (a ring, not saved)
+    uint32_t event_head;   // Events pushed (free-running)
+    uint32_t event_tail;   // Events read or dropped (free-running)
+    uint32_t events_dropped; // Events dropped unread to make room, since PongEngine_Init()
+    Arena_t round_arena; // Per-game allocations, in round_memory
+    uint64_t round_memory[(PONG_ROUND_ARENA_BYTES + 7) / 8];
 } PongEngine_t;
 
+/**
+ * @struct PongEngine_Snapshot_t
+ * @brief Game state saved by PongEngine_Save(), to go back to with PongEngine_Restore()
+ * 
+ * Everything the next steps depend on, random generator included, and
+ * nothing that is drawing state or rebuilt every step (the broad-phase grid).
+ */
+typedef struct {
+    BallSet_t balls;
+    Paddle_t paddle;
+    Paddle_t opponent;
+    PongAI_t ai;
+    uint8_t ai_replan;
+    BrickField_t bricks;
+#if PONG_PARTICLES
+    ParticleSet_t particles;
+#endif
+    uint8_t lives;
+    uint16_t round_used;                // Arena bytes allocated, and their contents
+    uint64_t round_memory[(PONG_ROUND_ARENA_BYTES + 7) / 8];
+    uint64_t random_state;
+} PongEngine_Snapshot_t;
+
+// Packed game state (PongEngine_Pack()): format version, and bytes for a number of balls and
+// brick rows (a 29-byte header, 17 bytes a ball, 2 a brick row)
+#define PONG_PACKED_VERSION 1
+#define PONG_PACKED_BYTES(balls, brick_rows) (29 + 17 * (balls) + 2 * (brick_rows))
+#define PONG_PACKED_MAX_BYTES PONG_PACKED_BYTES(BALL_MAX_COUNT, BRICK_MAX_ROWS)
+
+// Rules PongEngine_Check() found broken by a step (bit flags)
+#define PONG_CHECK_BALL_OUT     0x01    // A ball is outside the court
+#define PONG_CHECK_IN_PADDLE    0x02    // A ball is inside a paddle (went through its front face)
+#define PONG_CHECK_BALL_SPEED   0x04    // A ball's speed is not one the serve and speed ramp give
+#define PONG_CHECK_LIVES        0x08    // Lives went up, or down by more than one
+#define PONG_CHECK_SCORE        0x10    // Score went down, or up by more than the balls could hit
+
+/**
+ * @struct PongEngine_Watch_t
+ * @brief What PongEngine_Check() compares a step's result with, from PongEngine_Watch()
+ */
+typedef struct {
+    uint16_t score;
+    uint8_t lives;
+    uint8_t balls;
+} PongEngine_Watch_t;
+
 /**
  * @brief Initialize the Pong game engine
  * 
- * Sets up the ball, paddle, and initial game state.
+ * Sets up the ball, paddle, and initial game state. With PONG_AI_OPPONENT or
+ * PONG_LINK_PLAY the right paddle is the mirror image of the player's.
  * 
  * @param engine Pointer to game engine
  * @param paddle_x Initial paddle X position
@@ -35,7 +297,8 @@ typedef struct {
  * @param paddle_width Paddle width
  * @param paddle_height Paddle height
  * @param ball_size Ball diameter
- * @param ball_speed Initial ball speed
+ * @param ball_speed Initial ball speed, in pixels/step (also the serve speed after a miss,
+ *                   raised with the score by PONG_SPEED_RAMP_HITS)
  */
 void PongEngine_Init(PongEngine_t* engine, 
                      int16_t paddle_x, int16_t paddle_y,
@@ -45,11 +308,15 @@ void PongEngine_Init(PongEngine_t* engine,
 /**
  * @brief Update game state (input + physics + collisions)
  * 
- * This is called every frame:
- * 1. Updates paddle based on joystick input
- * 2. Updates ball position
- * 3. Checks collisions (walls and paddle)
- * 4. Decrements lives if ball leaves play area
+ * This is called once per physics step (PONG_PHYSICS_HZ times a second):
+ * 1. Updates paddle based on joystick input (and the CPU paddle, if enabled)
+ * 2. Updates all ball positions
+ * 3. Checks collisions (walls and paddles)
+ *    (2 and 3 run once per substep, up to PONG_MAX_SUBSTEPS for a fast ball)
+ * 4. Removes balls that leave the play area; decrements lives when the last one
+ *    goes out on the left (or scores a point when it goes past the CPU paddle)
+ * 5. Makes the sparks and beeps of the step's events, which are then left
+ *    for PongEngine_PollEvent()
  * 
  * @param engine Pointer to game engine
  * @param input Joystick input for this frame
@@ -57,10 +324,155 @@ void PongEngine_Init(PongEngine_t* engine,
  */
 uint8_t PongEngine_Update(PongEngine_t* engine, UserInput input);
 
+/**
+ * @brief Update game state with both paddles moved by players
+ * 
+ * Same step as PongEngine_Update(), with the right paddle following right
+ * instead of the CPU. Needs the court of PONG_LINK_PLAY or PONG_TWO_STICKS (or PONG_AI_OPPONENT);
+ * the replay journal, if any, records the left input only.
+ * 
+ * @param engine Pointer to game engine
+ * @param left Input for the left paddle
+ * @param right Input for the right paddle
+ * @return Remaining lives of the left player (0 = game over)
+ */
+uint8_t PongEngine_UpdateVersus(PongEngine_t* engine, UserInput left, UserInput right);
+
+/**
+ * @brief Run many steps at once, e.g. to look ahead, seek in a replay or benchmark
+ * 
+ * The same steps as PongEngine_Update() with one input each, in a loop,
+ * stopping early at game over. They run quiet (engine->quiet): no beeps, no
+ * traces and no events queued for the application, which are counted in
+ * summary instead. Sparks are game state and still fly. Nothing is drawn:
+ * the next PongEngine_Draw() moves the picture on from the last step's
+ * previous positions, so call PongEngine_Restore() or draw the whole court
+ * afresh after a jump.
+ * 
+ * @param engine Pointer to game engine
+ * @param inputs One input a step, or NULL for the stick left centred
+ * @param n Steps to run
+ * @param summary Filled in with the steps run and what happened in them (or NULL)
+ * @return Remaining lives (0 = game over)
+ */
+uint8_t PongEngine_UpdateN(PongEngine_t* engine, const UserInput* inputs, uint32_t n,
+                           PongEngine_Summary_t* summary);
+
+#if PONG_AI_OPPONENT
+/**
+ * @brief Update game state with the CPU on both paddles (an attract-mode demo)
+ * 
+ * Same step as PongEngine_Update(), with the left paddle steered by a second
+ * CPU player that plans its intercepts at the same moments as the right one.
+ * Set engine->quiet for a demo without beeps, and leave the replay journal
+ * out of it (PongEngine_SetReplay(engine, NULL)).
+ * 
+ * @param engine Pointer to game engine
+ * @return Remaining lives of the left paddle (0 = the demo game is over)
+ */
+uint8_t PongEngine_UpdateDemo(PongEngine_t* engine);
+#endif
+
+/**
+ * @brief Take the oldest event of the steps run since the last call
+ * 
+ * Each step queues what happened in it (hits, goals, score and lives
+ * changes) as it goes. The engine handles them itself once the step is
+ * done: sparks (PONG_PARTICLES), beeps and trace events. They are then kept
+ * for the application to read in a batch after its update, e.g. to pulse
+ * the LED on a point, so nothing needs polling. Steps simulated again after
+ * a rollback (engine->quiet) queue none for the application, and never
+ * drop the ones still unread.
+ * 
+ * Only PONG_EVENT_QUEUE_LEN are kept: with more unread, the oldest are
+ * dropped (and counted in engine->events_dropped). PongEngine_Init() empties
+ * the queue.
+ * 
+ * @param engine Pointer to game engine
+ * @param event Filled in with the event
+ * @return 1 if there was one, 0 if all have been read
+ */
+uint8_t PongEngine_PollEvent(PongEngine_t* engine, PongEngine_Event_t* event);
+
+/**
+ * @brief Save the game state, e.g. before steps run on predicted input
+ * 
+ * @param engine Pointer to game engine
+ * @param snapshot Filled with the state
+ */
+void PongEngine_Save(const PongEngine_t* engine, PongEngine_Snapshot_t* snapshot);
+
+/**
+ * @brief Go back to a saved game state
+ * 
+ * The snapshot must come from the same engine. What is on the screen is
+ * kept track of: bricks the snapshot has standing again are redrawn on the
+ * next PongEngine_Draw(), and those it has knocked down are erased.
+ * 
+ * @param engine Pointer to game engine
+ * @param snapshot State from PongEngine_Save()
+ */
+void PongEngine_Restore(PongEngine_t* engine, const PongEngine_Snapshot_t* snapshot);
+
+/**
+ * @brief Write the game state compactly, e.g. to keep one for every step
+ * 
+ * Balls, paddles, lives, the CPU's plan, the bricks standing and the random
+ * generator, in a versioned little-endian format of
+ * PONG_PACKED_BYTES(balls, brick rows) bytes: 46 for one ball and no bricks.
+ * Left out are what only shows on the screen (previous positions, sparks)
+ * and the round arena. Packing is a few dozen word stores.
+ * 
+ * @param engine Pointer to game engine
+ * @param out Buffer for the state
+ * @param size Size of out
+ * @return Bytes written, or 0 if they would not fit in size
+ */
+uint16_t PongEngine_Pack(const PongEngine_t* engine, uint8_t* out, uint16_t size);
+
+/**
+ * @brief Go back to a state written by PongEngine_Pack()
+ * 
+ * The engine must have been set up by PongEngine_Init() with the same
+ * parameters and build options as the one packed (paddle sizes and the brick
+ * layout are not in the state). The screen is kept track of as by
+ * PongEngine_Restore(); sparks are cleared.
+ * 
+ * @param engine Pointer to game engine
+ * @param data Packed state
+ * @param length Bytes of data
+ * @return 1 if restored, 0 if data is not a state of this version and build (engine unchanged)
+ */
+uint8_t PongEngine_Unpack(PongEngine_t* engine, const uint8_t* data, uint16_t length);
+
+/**
+ * @brief Note the score, lives and balls before a step, for PongEngine_Check()
+ * 
+ * @param engine Pointer to game engine
+ * @param watch Filled in
+ */
+void PongEngine_Watch(PongEngine_t* engine, PongEngine_Watch_t* watch);
+
+/**
+ * @brief Check the rules every step has to keep, after PongEngine_Update()
+ * 
+ * For soak runs that step the engine millions of times (on a PC, or on the
+ * board with PONG_CHECK_INVARIANTS) to catch physics regressions: every ball
+ * inside the court, none inside a paddle, every ball's speed within 1% of one
+ * the game gives, lives never back up and lost one at a time, score never
+ * down and up by no more than three a ball each substep. Costs about as much
+ * as a step with no collisions.
+ * 
+ * @param engine Pointer to game engine
+ * @param before From PongEngine_Watch() just before the step
+ * @return PONG_CHECK_x flags of the rules broken, 0 if none
+ */
+uint8_t PongEngine_Check(PongEngine_t* engine, const PongEngine_Watch_t* before);
+
 /**
  * @brief Draw all game objects
  * 
- * Draws the ball and paddle to the LCD buffer.
+ * Draws the balls, paddle and brick wall to the LCD buffer.
  * Note: does NOT call LCD_clear() or LCD_Refresh() - 
  *       those are the caller's responsibility.
  * 
@@ -68,6 +480,114 @@ uint8_t PongEngine_Update(PongEngine_t* engine, UserInput input);
  */
 void PongEngine_Draw(PongEngine_t* engine);
 
+/**
+ * @brief Draw all game objects between the last two physics steps
+ * 
+ * Same as PongEngine_Draw(), but positions are interpolated so motion stays
+ * smooth when the display rate differs from PONG_PHYSICS_HZ.
+ * 
+ * @param engine Pointer to game engine
+ * @param alpha Fraction of a physics step since the last update (0 to LERP_ONE)
+ */
+void PongEngine_DrawInterpolated(PongEngine_t* engine, uint16_t alpha);
+
+/**
+ * @brief Set how much optional drawing PongEngine_Draw() and PongEngine_DrawInterpolated() do
+ *
+ * Only the drawing changes, never the simulation, so replays and link play are
+ * unaffected. Used to shed drawing work when frames run over budget.
+ *
+ * @param engine Pointer to game engine
+ * @param detail PONG_DETAIL_FULL (the default) or less
+ */
+void PongEngine_SetDetail(PongEngine_t* engine, PongEngine_Detail_t detail);
+
+#if PONG_BALL_TRAILS
+/**
+ * @brief Set how the ball trails are drawn (PONG_BALL_TRAILS)
+ *
+ * Trails are drawn at PONG_DETAIL_FULL only.
+ *
+ * @param engine Pointer to game engine
+ * @param colour Palette colour of the trails
+ * @param table Blend table for the active palette (kept, not copied), NULL for no trails
+ */
+void PongEngine_SetTrails(PongEngine_t* engine, uint8_t colour, const struct LCD_Blend_Table* table);
+#endif
+
+#if PONG_PHOSPHOR_TRAILS
+/**
+ * @brief Set the colours the phosphor trails fade through (PONG_PHOSPHOR_TRAILS)
+ *
+ * Balls stamp trails at PONG_DETAIL_FULL only; at lower detail the trails
+ * already on the screen still fade out. Faded pixels go back to colour 0,
+ * the background the game is cleared to.
+ *
+ * @param engine Pointer to game engine
+ * @param ramp Palette colours from the dimmest to the brightest (copied)
+ * @param levels Number of colours, which is how many frames a trail lasts (0 for no trails)
+ */
+void PongEngine_SetPhosphor(PongEngine_t* engine, const uint8_t* ramp, uint8_t levels);
+#endif
+
+/**
+ * @brief Add another ball to play (multi-ball power-up)
+ * 
+ * The new ball starts where ball 0 is, moving the same speed but with its
+ * vertical direction flipped, so the two split apart.
+ * 
+ * @param engine Pointer to game engine
+ * @return 1 if a ball was added, 0 if BALL_MAX_COUNT are already in play
+ */
+uint8_t PongEngine_SpawnBall(PongEngine_t* engine);
+
+/**
+ * @brief Allocate memory that lasts until the next PongEngine_Init()
+ * For entities added during a game (power-ups, effects), instead of malloc.
+ * The arena's high-water mark (engine->round_arena.high_water) is kept over
+ * games, to size PONG_ROUND_ARENA_BYTES.
+ * @param engine Pointer to game engine
+ * @param size Bytes wanted
+ * @return The memory (not zeroed), or NULL once PONG_ROUND_ARENA_BYTES are used
+ */
+void* PongEngine_RoundAlloc(PongEngine_t* engine, uint16_t size);
+
+/**
+ * @brief Get number of balls in play
+ * 
+ * @param engine Pointer to game engine
+ * @return Ball count (at least 1 while the game is running)
+ */
+uint8_t PongEngine_GetBallCount(PongEngine_t* engine);
+
+/**
+ * @brief Record or replay this game through an input/RNG journal
+ * 
+ * Call straight after PongEngine_Init(). Every step's joystick direction and
+ * every random draw then goes through the journal, so a recorded game replays
+ * bit-exactly from a fresh PongEngine_Init() with the same arguments.
+ * 
+ * @param engine Pointer to game engine
+ * @param replay Journal set up with Replay_Init() or Replay_Load(), or NULL to stop
+ */
+void PongEngine_SetReplay(PongEngine_t* engine, Replay_t* replay);
+
+/**
+ * @brief Set the CPU opponent's reaction time (difficulty)
+ * 
+ * @param engine Pointer to game engine
+ * @param reaction_steps Physics steps before the CPU reacts to a new ball direction
+ */
+void PongEngine_SetAIReaction(PongEngine_t* engine, uint8_t reaction_steps);
+
+/**
+ * @brief Get the CPU opponent's score
+ * 
+ * @param engine Pointer to game engine
+ * @return Points the CPU has won (balls the player missed)
+ */
+uint16_t PongEngine_GetOpponentScore(PongEngine_t* engine);
+
 /**
  * @brief Get current lives remaining
  * 
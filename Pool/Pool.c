@@ -0,0 +1,77 @@
+/**
+ * @file Pool.c
+ * @brief Fixed-size block pool and bump arena implementation
+ */
+
+#include "Pool.h"
+#include <stddef.h>
+
+void Pool_Init(Pool_t* pool, void* memory, uint16_t block_size, uint16_t capacity) {
+    pool->memory = (uint8_t*)memory;
+    pool->block_size = block_size;
+    pool->capacity = capacity;
+    pool->high_water = 0;
+    pool->failed = 0;
+    Pool_Reset(pool);
+}
+
+void* Pool_Alloc(Pool_t* pool) {
+    void* block;
+    if (pool->free_list) {
+        block = pool->free_list;
+        pool->free_list = pool->free_list->next;
+    } else if (pool->untouched < pool->capacity) {
+        block = pool->memory + (uint32_t)pool->untouched * pool->block_size;
+        pool->untouched++;
+    } else {
+        pool->failed++;
+        return NULL;
+    }
+    pool->used++;
+    if (pool->used > pool->high_water) {
+        pool->high_water = pool->used;
+    }
+    return block;
+}
+
+void Pool_Free(Pool_t* pool, void* block) {
+    if (block == NULL) {
+        return;
+    }
+    Pool_Node* node = (Pool_Node*)block;
+    node->next = pool->free_list;
+    pool->free_list = node;
+    pool->used--;
+}
+
+void Pool_Reset(Pool_t* pool) {
+    pool->free_list = NULL;
+    pool->untouched = 0;
+    pool->used = 0;
+}
+
+void Arena_Init(Arena_t* arena, void* memory, uint16_t capacity) {
+    arena->memory = (uint8_t*)memory;
+    arena->capacity = capacity;
+    arena->used = 0;
+    arena->high_water = 0;
+    arena->failed = 0;
+}
+
+void* Arena_Alloc(Arena_t* arena, uint16_t size) {
+    uint32_t rounded = ((uint32_t)size + POOL_ALIGN - 1) & ~(uint32_t)(POOL_ALIGN - 1);
+    if (rounded > (uint32_t)(arena->capacity - arena->used)) {
+        arena->failed++;
+        return NULL;
+    }
+    void* block = arena->memory + arena->used;
+    arena->used += (uint16_t)rounded;
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+    return block;
+}
+
+void Arena_Reset(Arena_t* arena) {
+    arena->used = 0;
+}
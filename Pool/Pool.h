@@ -0,0 +1,143 @@
+/**
+ * @file Pool.h
+ * @brief Fixed-capacity allocators for game entities, with no malloc
+ *
+ * Two allocators over memory the caller provides (static, or inside
+ * PongEngine_t), so nothing ever reaches _sbrk() and the RAM they take shows
+ * up in the build's memory report like any other variable:
+ *
+ * - **Pool_t**: blocks of one size (one entity type, e.g. a particle or a
+ *   power-up), allocated and freed in any order in O(1). A freed block holds
+ *   the link to the next free one (an intrusive free list), so there is no
+ *   per-block overhead. Blocks never handed out yet are taken in order from
+ *   the end of the used part, so set-up and Pool_Reset() are O(1) too.
+ * - **Arena_t**: bump allocation of any size, freed all at once by
+ *   Arena_Reset(). PongEngine_t has one for each game (reset by
+ *   PongEngine_Init()), for anything that lives until the game ends.
+ *
+ * Both keep a high-water mark that survives Pool_Reset()/Arena_Reset(), to
+ * size the capacity from real play. Neither is safe to use from an interrupt
+ * while the main loop uses the same pool or arena.
+ *
+ * Example usage:
+ * @code
+ * static uint64_t spark_memory[POOL_STORAGE_WORDS(Spark_t, 32)];
+ * static Pool_t sparks;
+ *
+ * Pool_Init(&sparks, spark_memory, POOL_BLOCK_SIZE(Spark_t), 32);
+ * Spark_t* spark = Pool_Alloc(&sparks);    // NULL when all 32 are in use
+ * ...
+ * Pool_Free(&sparks, spark);
+ * @endcode
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+
+// Alignment of every block and arena allocation (enough for int64_t and double)
+#define POOL_ALIGN 8
+
+// Bytes a block of a type takes: its size rounded up to POOL_ALIGN (so also big enough
+// for the free-list link)
+#define POOL_BLOCK_SIZE(type) \
+    ((uint16_t)((sizeof(type) + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN))
+
+// uint64_t words of storage for count blocks of a type (uint64_t for the alignment)
+#define POOL_STORAGE_WORDS(type, count) (POOL_BLOCK_SIZE(type) / 8 * (count))
+
+/**
+ * @struct Pool_Node
+ * @brief What a free block holds: the next free block
+ */
+typedef struct Pool_Node {
+    struct Pool_Node* next;
+} Pool_Node;
+
+/**
+ * @struct Pool_t
+ * @brief Fixed-size block pool
+ */
+typedef struct {
+    uint8_t* memory;        // capacity blocks of block_size bytes
+    uint16_t block_size;    // Bytes per block, a multiple of POOL_ALIGN
+    uint16_t capacity;      // Blocks in memory
+    uint16_t untouched;     // Blocks from here on have never been handed out
+    uint16_t used;          // Blocks allocated now
+    uint16_t high_water;    // Most blocks allocated at once since Pool_Init()
+    uint16_t failed;        // Pool_Alloc() calls that found the pool full
+    Pool_Node* free_list;   // Freed blocks, most recently freed first
+} Pool_t;
+
+/**
+ * @struct Arena_t
+ * @brief Bump allocator, freed all at once
+ */
+typedef struct {
+    uint8_t* memory;        // capacity bytes
+    uint16_t capacity;      // Bytes in memory
+    uint16_t used;          // Bytes allocated since the last reset
+    uint16_t high_water;    // Most bytes allocated between resets since Arena_Init()
+    uint16_t failed;        // Arena_Alloc() calls that did not fit
+} Arena_t;
+
+/**
+ * @brief Set up an empty pool
+ *
+ * @param pool Pointer to pool
+ * @param memory Storage for the blocks, POOL_ALIGN aligned (see POOL_STORAGE_WORDS)
+ * @param block_size Bytes per block, from POOL_BLOCK_SIZE()
+ * @param capacity Number of blocks memory holds
+ */
+void Pool_Init(Pool_t* pool, void* memory, uint16_t block_size, uint16_t capacity);
+
+/**
+ * @brief Take a block from a pool
+ *
+ * @param pool Pointer to pool
+ * @return The block (contents undefined), or NULL if all are in use
+ */
+void* Pool_Alloc(Pool_t* pool);
+
+/**
+ * @brief Give a block back to its pool
+ *
+ * @param pool Pointer to pool the block came from
+ * @param block Block from Pool_Alloc() (NULL is ignored)
+ */
+void Pool_Free(Pool_t* pool, void* block);
+
+/**
+ * @brief Free every block of a pool at once
+ *
+ * @param pool Pointer to pool
+ */
+void Pool_Reset(Pool_t* pool);
+
+/**
+ * @brief Set up an empty arena
+ *
+ * @param arena Pointer to arena
+ * @param memory Storage, POOL_ALIGN aligned
+ * @param capacity Bytes in memory
+ */
+void Arena_Init(Arena_t* arena, void* memory, uint16_t capacity);
+
+/**
+ * @brief Allocate from an arena
+ *
+ * @param arena Pointer to arena
+ * @param size Bytes wanted (rounded up to POOL_ALIGN)
+ * @return The memory (contents undefined), or NULL if it does not fit
+ */
+void* Arena_Alloc(Arena_t* arena, uint16_t size);
+
+/**
+ * @brief Free everything allocated from an arena
+ *
+ * @param arena Pointer to arena
+ */
+void Arena_Reset(Arena_t* arena);
+
+#endif // POOL_H
@@ -0,0 +1,101 @@
+#include "Profiler.h"
+#include "LCD.h"
+
+/**
+ * @file Profiler.c
+ * @brief Implementation of the per-stage frame-time profiler
+ *
+ * Durations are unsigned 32-bit CYCCNT differences, so they are correct
+ * across the counter wrapping (every 53 seconds at 80MHz).
+ */
+
+Profiler_t profiler;
+
+// Bar colour of each stage (palette index), in Profiler_Stage_t order
+static const uint8_t stage_colour[PROF_STAGE_COUNT] = {3, 2, 4, 6, 5};
+#define PROFILER_TRACK_COLOUR 13
+#define PROFILER_MAX_COLOUR 1
+
+static void window_clear(void)
+{
+    for (int s = 0; s < PROFILER_CHANNELS; s++) {
+        profiler.window_min[s] = UINT32_MAX;
+        profiler.window_max[s] = 0;
+        profiler.window_total[s] = 0;
+    }
+    profiler.window_frames = 0;
+}
+
+void Profiler_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    for (int s = 0; s < PROFILER_CHANNELS; s++) {
+        profiler.frame[s] = 0;
+        profiler.result[s] = (Profiler_Result_t){0, 0, 0};
+    }
+    window_clear();
+}
+
+uint8_t Profiler_Frame_End(void)
+{
+    for (int s = 0; s < PROFILER_CHANNELS; s++) {
+        uint32_t cycles = profiler.frame[s];
+        if (cycles < profiler.window_min[s]) profiler.window_min[s] = cycles;
+        if (cycles > profiler.window_max[s]) profiler.window_max[s] = cycles;
+        profiler.window_total[s] += cycles;
+        profiler.frame[s] = 0;
+    }
+    if (++profiler.window_frames < PROFILER_WINDOW_FRAMES) {
+        return 0;
+    }
+    for (int s = 0; s < PROFILER_CHANNELS; s++) {
+        profiler.result[s].min = profiler.window_min[s];
+        profiler.result[s].avg = profiler.window_total[s] / PROFILER_WINDOW_FRAMES;
+        profiler.result[s].max = profiler.window_max[s];
+    }
+    window_clear();
+    return 1;
+}
+
+const Profiler_Result_t* Profiler_Get(Profiler_Stage_t stage)
+{
+    return &profiler.result[stage];
+}
+
+const Profiler_Result_t* Profiler_Get_Count(Profiler_Counter_t counter)
+{
+    return &profiler.result[PROF_STAGE_COUNT + counter];
+}
+
+// Bar length in pixels for a cycle count, clipped to the track
+static uint16_t bar_length(uint32_t cycles, uint32_t budget_cycles)
+{
+    uint64_t length = ((uint64_t)cycles * PROFILER_BAR_WIDTH) / budget_cycles;
+    return (length > PROFILER_BAR_WIDTH) ? PROFILER_BAR_WIDTH : (uint16_t)length;
+}
+
+void Profiler_Draw_Overlay(uint16_t x, uint16_t y, uint32_t budget_cycles)
+{
+    if (budget_cycles == 0) {
+        return;
+    }
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        const Profiler_Result_t* result = &profiler.result[s];
+        uint16_t avg = bar_length(result->avg, budget_cycles);
+        uint16_t max = bar_length(result->max, budget_cycles);
+        uint16_t row = y + 4 * s;
+        for (uint16_t line = row; line < row + 3; line++) {
+            if (avg > 0) {
+                LCD_Fill_Span(line, x, x + avg - 1, stage_colour[s]);
+            }
+            if (avg < PROFILER_BAR_WIDTH) {
+                LCD_Fill_Span(line, x + avg, x + PROFILER_BAR_WIDTH - 1, PROFILER_TRACK_COLOUR);
+            }
+        }
+        if (max > 0) {
+            LCD_Fill_Span(row + 1, x + max - 1, x + max - 1, PROFILER_MAX_COLOUR);
+        }
+    }
+}
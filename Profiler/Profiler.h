@@ -0,0 +1,162 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Profiler.h
+ * @brief Per-stage frame-time profiler on the DWT cycle counter
+ *
+ * PROF_BEGIN(stage) / PROF_END(stage) bracket the parts of a frame. A stage
+ * may be entered several times per frame (e.g. one physics update per step);
+ * its cycles add up until Profiler_Frame_End(). Every PROFILER_WINDOW_FRAMES
+ * frames the min/avg/max per frame of each stage are published, and
+ * Profiler_Draw_Overlay() shows them as bars in a corner of the framebuffer.
+ *
+ * Each macro is a DWT->CYCCNT read and a store, and compiles to nothing
+ * unless PONG_PROFILER is 1.
+ *
+ * PROF_COUNT(counter, n) adds to a per-frame count instead (e.g. the bytes
+ * sent to the LCD), which gets the same min/avg/max per window.
+ *
+ * Example usage:
+ * @code
+ * Profiler_Init();
+ * while (1) {
+ *     PROF_BEGIN(PROF_INPUT);
+ *     Joystick_Read(&joystick_cfg, &joystick_data);
+ *     PROF_END(PROF_INPUT);
+ *     ...
+ *     Profiler_Draw_Overlay(4, 200, SystemCoreClock / 60);  // bars scaled to a 60 FPS frame
+ *     LCD_Swap(&cfg0);
+ *     Profiler_Frame_End();
+ * }
+ * @endcode
+ */
+
+// Set to 1 to compile the PROF_BEGIN/PROF_END instrumentation in
+#ifndef PONG_PROFILER
+#define PONG_PROFILER 0
+#endif
+
+// Frames per published min/avg/max
+#ifndef PROFILER_WINDOW_FRAMES
+#define PROFILER_WINDOW_FRAMES 60
+#endif
+
+/**
+ * @enum Profiler_Stage_t
+ * @brief Profiled parts of a frame
+ */
+typedef enum {
+    PROF_INPUT = 0,     ///< Joystick_Read()
+    PROF_UPDATE,        ///< PongEngine_Update(), all steps of the frame
+    PROF_DRAW,          ///< Background clear and PongEngine_Draw()
+    PROF_HUD,           ///< Score/lives text and the profiler overlay
+    PROF_REFRESH,       ///< Waiting for the draw buffer and starting the LCD refresh
+    PROF_STAGE_COUNT
+} Profiler_Stage_t;
+
+/**
+ * @enum Profiler_Counter_t
+ * @brief Counts added up per frame, from the LCD driver's ST7789V2_BUS_STATS
+ */
+typedef enum {
+    PROF_COUNT_PIXEL_BYTES = 0, ///< Pixel bytes sent to the panel
+    PROF_COUNT_COMMAND_BYTES,   ///< Command and parameter bytes sent
+    PROF_COUNT_WINDOWS,         ///< Address windows set
+    PROF_COUNT_BUSY_CYCLES,     ///< Cycles spent waiting for the SPI to go idle
+    PROF_COUNTER_COUNT
+} Profiler_Counter_t;
+
+// Stages, then counters, share the window arrays
+#define PROFILER_CHANNELS (PROF_STAGE_COUNT + PROF_COUNTER_COUNT)
+
+/**
+ * @struct Profiler_Result_t
+ * @brief Cycles per frame spent in a stage, over the last complete window
+ */
+typedef struct {
+    uint32_t min;
+    uint32_t avg;
+    uint32_t max;
+} Profiler_Result_t;
+
+/**
+ * @struct Profiler_t
+ * @brief Profiler state (one instance, profiler, used by the macros)
+ */
+typedef struct {
+    uint32_t start[PROF_STAGE_COUNT];       ///< Internal: CYCCNT at PROF_BEGIN
+    uint32_t frame[PROFILER_CHANNELS];      ///< Internal: cycles (or counts) so far this frame
+    uint32_t window_min[PROFILER_CHANNELS]; ///< Internal: window being collected
+    uint32_t window_max[PROFILER_CHANNELS];
+    uint32_t window_total[PROFILER_CHANNELS];
+    uint16_t window_frames;
+    Profiler_Result_t result[PROFILER_CHANNELS];  ///< Last complete window
+} Profiler_t;
+
+extern Profiler_t profiler;
+
+#if PONG_PROFILER
+#define PROF_BEGIN(stage) (profiler.start[(stage)] = DWT->CYCCNT)
+#define PROF_END(stage) (profiler.frame[(stage)] += DWT->CYCCNT - profiler.start[(stage)])
+#define PROF_COUNT(counter, n) (profiler.frame[PROF_STAGE_COUNT + (counter)] += (n))
+#else
+#define PROF_BEGIN(stage) ((void)0)
+#define PROF_END(stage) ((void)0)
+#define PROF_COUNT(counter, n) ((void)0)
+#endif
+
+/**
+ * @brief Start the DWT cycle counter and clear the statistics
+ */
+void Profiler_Init(void);
+
+/**
+ * @brief Fold this frame's stage times into the window, and publish the window when full
+ *
+ * Call once per main loop iteration, after the last PROF_END.
+ *
+ * @return 1 if this frame completed a window (new results), 0 otherwise
+ */
+uint8_t Profiler_Frame_End(void);
+
+/**
+ * @brief Get a stage's min/avg/max cycles per frame over the last complete window
+ *
+ * @param stage Stage to read
+ * @return Pointer to the result (all zero until the first window completes)
+ */
+const Profiler_Result_t* Profiler_Get(Profiler_Stage_t stage);
+
+/**
+ * @brief Get a counter's min/avg/max per frame over the last complete window
+ *
+ * @param counter Counter to read
+ * @return Pointer to the result (all zero until the first window completes)
+ */
+const Profiler_Result_t* Profiler_Get_Count(Profiler_Counter_t counter);
+
+/**
+ * @brief Draw one bar per stage into the framebuffer
+ *
+ * Each row is PROFILER_BAR_WIDTH pixels for budget_cycles: a solid bar to
+ * the average and a tick at the max, over a grey track. The overlay is
+ * 5 rows of 3 pixels plus gaps (PROFILER_OVERLAY_HEIGHT).
+ *
+ * @param x Left edge
+ * @param y Top edge
+ * @param budget_cycles Cycles the full width stands for (e.g. one frame)
+ */
+void Profiler_Draw_Overlay(uint16_t x, uint16_t y, uint32_t budget_cycles);
+
+#define PROFILER_BAR_WIDTH 64
+#define PROFILER_OVERLAY_HEIGHT (PROF_STAGE_COUNT * 4 - 1)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,92 @@
+/**
+ * @file Renderer.c
+ * @brief The LCD.c and no-op drawing backends
+ */
+
+#include "Renderer.h"
+#include <stddef.h>
+#if !PONG_HEADLESS
+#include "LCD.h"
+
+static void lcd_fill_rect(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t colour) {
+    LCD_Draw_Rect((uint16_t)x, (uint16_t)y, (uint16_t)width, (uint16_t)height, colour, 1);
+}
+
+static void lcd_fill_circle(int16_t cx, int16_t cy, int16_t radius, uint8_t colour) {
+    LCD_Draw_Circle((uint16_t)cx, (uint16_t)cy, (uint16_t)radius, colour, 1);
+}
+
+static void lcd_blend_circle(int16_t cx, int16_t cy, int16_t radius, uint8_t colour,
+                             const struct LCD_Blend_Table* table) {
+    LCD_Blend_Circle((uint16_t)cx, (uint16_t)cy, (uint16_t)radius, colour, table);
+}
+
+static void lcd_blit(int16_t x, int16_t y, const struct LCD_Sprite* sprite) {
+    LCD_Draw_Baked_Sprite((uint16_t)x, (uint16_t)y, sprite);
+}
+
+static void lcd_text(const char* text, int16_t x, int16_t y, uint8_t colour, uint8_t size) {
+    LCD_printString(text, (uint16_t)x, (uint16_t)y, colour, size);
+}
+
+const Renderer_t Renderer_LCD = {
+    .fill_rect = lcd_fill_rect,
+    .fill_circle = lcd_fill_circle,
+    .blend_circle = lcd_blend_circle,
+    .blit = lcd_blit,
+    .text = lcd_text,
+    .retained_begin = LCD_Retained_Begin,
+    .retained_end = LCD_Retained_End,
+    .erases = !LCD_DISPLAY_LIST,  // The display list starts every frame empty
+};
+#define RENDERER_DEFAULT (&Renderer_LCD)
+#else
+#define RENDERER_DEFAULT NULL
+#endif
+
+static void null_fill_rect(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t colour) {
+    (void)x; (void)y; (void)width; (void)height; (void)colour;
+}
+
+static void null_fill_circle(int16_t cx, int16_t cy, int16_t radius, uint8_t colour) {
+    (void)cx; (void)cy; (void)radius; (void)colour;
+}
+
+static void null_blend_circle(int16_t cx, int16_t cy, int16_t radius, uint8_t colour,
+                              const struct LCD_Blend_Table* table) {
+    (void)cx; (void)cy; (void)radius; (void)colour; (void)table;
+}
+
+static void null_blit(int16_t x, int16_t y, const struct LCD_Sprite* sprite) {
+    (void)x; (void)y; (void)sprite;
+}
+
+static void null_text(const char* text, int16_t x, int16_t y, uint8_t colour, uint8_t size) {
+    (void)text; (void)x; (void)y; (void)colour; (void)size;
+}
+
+// Every area stale, so objects go through all of their drawing every frame
+static uint8_t null_retained_begin(LCD_Retained_Area* area) {
+    (void)area;
+    return 1;
+}
+
+static void null_retained_end(void) {
+}
+
+const Renderer_t Renderer_Null = {
+    .fill_rect = null_fill_rect,
+    .fill_circle = null_fill_circle,
+    .blend_circle = null_blend_circle,
+    .blit = null_blit,
+    .text = null_text,
+    .retained_begin = null_retained_begin,
+    .retained_end = null_retained_end,
+    .erases = 1,
+};
+
+const Renderer_t* renderer_active = RENDERER_DEFAULT;
+
+void Renderer_Set(const Renderer_t* renderer) {
+    renderer_active = (renderer != NULL) ? renderer : RENDERER_DEFAULT;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file Renderer.h
+ * @brief The drawing calls game objects make, through a swappable backend
+ *
+ * Ball and Paddle draw with Renderer_Fill_Rect() and friends instead of
+ * calling LCD.c themselves. Each goes through the active Renderer_t, a table
+ * of functions: Renderer_LCD (the default on the board) hands them to LCD.c,
+ * however LCD.c is built (image buffer, display list, or the host panel).
+ * Another backend, set with Renderer_Set(), takes them instead without the
+ * game code changing, e.g. one that records the calls for a test or
+ * Renderer_Null to time the game's own share of a draw.
+ *
+ * Co-ordinates are panel pixels and colours palette indices, as for LCD.c.
+ * Headless builds (PONG_HEADLESS) have no LCD.c and no default backend:
+ * objects draw nothing until one is set, and sprites are left out.
+ *
+ * Example usage:
+ * @code
+ * static uint32_t rects;
+ * static void count_rect(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t colour) {
+ *     rects++;
+ * }
+ * Renderer_t counting = Renderer_Null;
+ * counting.fill_rect = count_rect;
+ * Renderer_Set(&counting);
+ * PongEngine_Draw(&engine);      // rects: the paddles and erased strips drawn
+ * Renderer_Set(NULL);            // Back to the default
+ * @endcode
+ */
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stdint.h>
+#include "Utils.h"
+#if !PONG_HEADLESS
+#include "LCD.h"
+#endif
+
+struct LCD_Sprite;       // LCD.h (not needed by headless builds)
+struct LCD_Blend_Table;
+
+/**
+ * @struct Renderer_t
+ * @brief A drawing backend: every function must be set (Renderer_Null's do nothing)
+ */
+typedef struct {
+    void (*fill_rect)(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t colour);
+    void (*fill_circle)(int16_t cx, int16_t cy, int16_t radius, uint8_t colour);
+    // A circle mixed into what is under it, through a table from LCD_Build_Blend_Table()
+    void (*blend_circle)(int16_t cx, int16_t cy, int16_t radius, uint8_t colour,
+                         const struct LCD_Blend_Table* table);
+    // A sprite from LCD_Bake_Sprite(), top-left corner at (x, y)
+    void (*blit)(int16_t x, int16_t y, const struct LCD_Sprite* sprite);
+    void (*text)(const char* text, int16_t x, int16_t y, uint8_t colour, uint8_t size);
+    // Drawing between these is retained, as LCD_Retained_Begin() and LCD_Retained_End();
+    // retained_begin returns 1 if all of the area has to be drawn again
+    uint8_t (*retained_begin)(LCD_Retained_Area* area);
+    void (*retained_end)(void);
+    // 1 if drawing stays in the frame until drawn over, so objects erase where they were
+    // (0 for a frame that starts out empty, as with LCD_DISPLAY_LIST)
+    uint8_t erases;
+} Renderer_t;
+
+#if !PONG_HEADLESS
+extern const Renderer_t Renderer_LCD;   ///< Draws with LCD.c
+#endif
+extern const Renderer_t Renderer_Null;  ///< Draws nothing, and has every retained area redrawn
+
+/// The backend drawing goes through (NULL draws nothing)
+extern const Renderer_t* renderer_active;
+
+/**
+ * @brief Set the backend objects draw through
+ *
+ * @param renderer Backend (kept, not copied), or NULL for the default: Renderer_LCD, or
+ *                 none in a headless build
+ */
+void Renderer_Set(const Renderer_t* renderer);
+
+static inline void Renderer_Fill_Rect(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t colour) {
+    if (renderer_active) {
+        renderer_active->fill_rect(x, y, width, height, colour);
+    }
+}
+
+static inline void Renderer_Fill_Circle(int16_t cx, int16_t cy, int16_t radius, uint8_t colour) {
+    if (renderer_active) {
+        renderer_active->fill_circle(cx, cy, radius, colour);
+    }
+}
+
+static inline void Renderer_Blend_Circle(int16_t cx, int16_t cy, int16_t radius, uint8_t colour,
+                                         const struct LCD_Blend_Table* table) {
+    if (renderer_active) {
+        renderer_active->blend_circle(cx, cy, radius, colour, table);
+    }
+}
+
+static inline void Renderer_Blit(int16_t x, int16_t y, const struct LCD_Sprite* sprite) {
+    if (renderer_active) {
+        renderer_active->blit(x, y, sprite);
+    }
+}
+
+static inline void Renderer_Text(const char* text, int16_t x, int16_t y, uint8_t colour, uint8_t size) {
+    if (renderer_active) {
+        renderer_active->text(text, x, y, colour, size);
+    }
+}
+
+static inline uint8_t Renderer_Retained_Begin(LCD_Retained_Area* area) {
+    return renderer_active ? renderer_active->retained_begin(area) : 0;
+}
+
+static inline void Renderer_Retained_End(void) {
+    if (renderer_active) {
+        renderer_active->retained_end();
+    }
+}
+
+static inline uint8_t Renderer_Erases(void) {
+    return renderer_active ? renderer_active->erases : 0;
+}
+
+#endif // RENDERER_H
@@ -0,0 +1,206 @@
+/**
+ * @file Replay.c
+ * @brief Input and RNG journal implementation
+ */
+
+#include "Replay.h"
+#include "Utils.h"
+
+#define REPLAY_RUN_SHORT_MAX 7                          // Longest run without an extension byte
+#define REPLAY_RUN_MAX (REPLAY_RUN_SHORT_MAX + 1 + 255) // 263 steps
+#define REPLAY_RANDOM_TAG 0x80
+#define REPLAY_RANDOM_SHORT_MAX 95                      // Largest value stored in the tag byte
+#define REPLAY_MAGNITUDE_TAG 0xE0                       // + level 0-16
+#define REPLAY_RANDOM_LONG 0xFF
+
+// Append a whole record, or stop recording if it does not fit
+static void put_record(Replay_t* replay, const uint8_t* bytes, uint8_t length) {
+    if (replay->overflow) {
+        return;
+    }
+    if (REPLAY_BUFFER_BYTES - replay->used < length) {
+        replay->overflow = 1;
+        return;
+    }
+    for (uint8_t k = 0; k < length; k++) {
+        replay->buf[replay->head] = bytes[k];
+        replay->head = (uint16_t)((replay->head + 1) % REPLAY_BUFFER_BYTES);
+    }
+    replay->used += length;
+}
+
+static int16_t peek_byte(Replay_t* replay) {
+    return replay->used ? replay->buf[replay->tail] : -1;
+}
+
+static uint8_t get_byte(Replay_t* replay) {
+    uint8_t b = replay->buf[replay->tail];
+    replay->tail = (uint16_t)((replay->tail + 1) % REPLAY_BUFFER_BYTES);
+    replay->used--;
+    return b;
+}
+
+// Write out the open input run
+static void flush_run(Replay_t* replay) {
+    if (replay->run_steps == 0) {
+        return;
+    }
+    uint8_t record[2];
+    uint8_t length = 1;
+    if (replay->run_steps <= REPLAY_RUN_SHORT_MAX) {
+        record[0] = (uint8_t)((replay->run_direction << 3) | (replay->run_steps - 1));
+    } else {
+        record[0] = (uint8_t)((replay->run_direction << 3) | REPLAY_RUN_SHORT_MAX);
+        record[1] = (uint8_t)(replay->run_steps - (REPLAY_RUN_SHORT_MAX + 1));
+        length = 2;
+    }
+    put_record(replay, record, length);
+    replay->run_steps = 0;
+}
+
+void Replay_Init(Replay_t* replay, Replay_Mode_t mode) {
+    replay->mode = mode;
+    replay->head = 0;
+    replay->tail = 0;
+    replay->used = 0;
+    replay->run_direction = CENTRE;
+    replay->run_steps = 0;
+    replay->magnitude_level = 0;
+    replay->overflow = 0;
+    replay->desync = 0;
+    replay->steps = 0;
+}
+
+void Replay_Load(Replay_t* replay, const uint8_t* data, uint16_t length) {
+    Replay_Init(replay, REPLAY_PLAY);
+    if (length > REPLAY_BUFFER_BYTES) {
+        length = REPLAY_BUFFER_BYTES;
+    }
+    for (uint16_t k = 0; k < length; k++) {
+        replay->buf[k] = data[k];
+    }
+    replay->used = length;
+    replay->head = (uint16_t)(length % REPLAY_BUFFER_BYTES);
+}
+
+// Joystick magnitude rounded to the journalled steps
+static uint8_t magnitude_level(float magnitude) {
+    if (magnitude <= 0.0f) {
+        return 0;
+    }
+    if (magnitude >= 1.0f) {
+        return REPLAY_MAGNITUDE_STEPS;
+    }
+    return (uint8_t)(magnitude * REPLAY_MAGNITUDE_STEPS + 0.5f);
+}
+
+void Replay_Step(Replay_t* replay, UserInput* input) {
+    if (replay->mode == REPLAY_RECORD) {
+        uint8_t level = magnitude_level(input->magnitude);
+        if (replay->run_steps && (replay->run_direction != input->direction ||
+                                  replay->magnitude_level != level ||
+                                  replay->run_steps == REPLAY_RUN_MAX)) {
+            flush_run(replay);
+        }
+        if (level != replay->magnitude_level) {
+            uint8_t record = (uint8_t)(REPLAY_MAGNITUDE_TAG + level);
+            put_record(replay, &record, 1);
+            replay->magnitude_level = level;
+        }
+        replay->run_direction = (uint8_t)input->direction;
+        replay->run_steps++;
+        replay->steps++;
+        input->magnitude = (float)level / REPLAY_MAGNITUDE_STEPS;
+        return;
+    }
+
+    if (replay->mode != REPLAY_PLAY) {
+        return;
+    }
+    if (replay->run_steps == 0) {
+        int16_t b = peek_byte(replay);
+        // Magnitude changes come just before the run they apply to
+        while (b >= REPLAY_MAGNITUDE_TAG && b <= REPLAY_MAGNITUDE_TAG + REPLAY_MAGNITUDE_STEPS) {
+            get_byte(replay);
+            replay->magnitude_level = (uint8_t)(b - REPLAY_MAGNITUDE_TAG);
+            b = peek_byte(replay);
+        }
+        if (b < 0) {
+            return;  // Journal finished, carry on live
+        }
+        if (b & REPLAY_RANDOM_TAG) {
+            // A draw the engine did not make: it no longer matches the recording
+            replay->desync = 1;
+            return;
+        }
+        get_byte(replay);
+        replay->run_direction = (uint8_t)(b >> 3);
+        replay->run_steps = (uint16_t)((b & REPLAY_RUN_SHORT_MAX) + 1);
+        if (replay->run_steps > REPLAY_RUN_SHORT_MAX && replay->used) {
+            replay->run_steps += get_byte(replay);
+        }
+    }
+    replay->run_steps--;
+    replay->steps++;
+    input->direction = (Direction)replay->run_direction;
+    input->magnitude = (float)replay->magnitude_level / REPLAY_MAGNITUDE_STEPS;
+}
+
+uint16_t Replay_Random(Replay_t* replay, uint16_t max) {
+    if (replay->mode == REPLAY_RECORD) {
+        uint16_t value = Random_U16(max);
+        // Close the run so playback meets this draw at the same step
+        flush_run(replay);
+        uint8_t record[3];
+        if (value <= REPLAY_RANDOM_SHORT_MAX) {
+            record[0] = (uint8_t)(REPLAY_RANDOM_TAG | value);
+            put_record(replay, record, 1);
+        } else {
+            record[0] = REPLAY_RANDOM_LONG;
+            record[1] = (uint8_t)(value & 0xFF);
+            record[2] = (uint8_t)(value >> 8);
+            put_record(replay, record, 3);
+        }
+        return value;
+    }
+
+    if (replay->mode == REPLAY_PLAY) {
+        int16_t b = peek_byte(replay);
+        uint8_t is_draw = (b >= REPLAY_RANDOM_TAG && b <= REPLAY_RANDOM_TAG + REPLAY_RANDOM_SHORT_MAX)
+                          || b == REPLAY_RANDOM_LONG;
+        if (replay->run_steps == 0 && is_draw) {
+            get_byte(replay);
+            uint16_t value = (uint16_t)(b & ~REPLAY_RANDOM_TAG);
+            if (b == REPLAY_RANDOM_LONG) {
+                if (replay->used < 2) {
+                    replay->desync = 1;
+                    return Random_U16(max);
+                }
+                value = get_byte(replay);
+                value |= (uint16_t)(get_byte(replay) << 8);
+            }
+            if (value < max) {
+                return value;
+            }
+        }
+        if (b >= 0) {
+            replay->desync = 1;
+        }
+    }
+    return Random_U16(max);
+}
+
+uint16_t Replay_Read(Replay_t* replay, uint8_t* out, uint16_t max) {
+    if (replay->mode == REPLAY_RECORD) {
+        flush_run(replay);
+    }
+    uint16_t n = 0;
+    while (n < max && replay->used) {
+        out[n++] = get_byte(replay);
+    }
+    return n;
+}
+
+uint8_t Replay_IsFinished(Replay_t* replay) {
+    return (replay->mode != REPLAY_PLAY) || (replay->used == 0 && replay->run_steps == 0);
+}
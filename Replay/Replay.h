@@ -0,0 +1,135 @@
+/**
+ * @file Replay.h
+ * @brief Input and RNG journal for deterministic Pong replays
+ * 
+ * The engine is deterministic apart from two inputs: the joystick direction
+ * (and, for proportional paddle control, deflection) each physics step and
+ * the random numbers drawn for ball resets. Recording
+ * both lets a session be played back bit-exactly from PongEngine_Init(),
+ * e.g. to reproduce a reported glitch or to run engine changes on the same
+ * workload.
+ * 
+ * **Encoding** (one byte per record, most records):
+ * - 0x00-0x7F: input run, bits 6-3 = direction, bits 2-0 = steps - 1.
+ *   A count of 7 means one more byte follows holding steps - 8, so a held
+ *   direction costs 2 bytes per 263 steps
+ * - 0x80-0xDF: random draw of 0-95
+ * - 0xE0-0xF0: joystick magnitude from here on, in 1/16ths (0-16)
+ * - 0xFF, lo, hi: random draw of 96 or more
+ * 
+ * Only direction or magnitude changes start a new run (the delta), so an idle
+ * joystick costs almost nothing. The magnitude is journalled in 1/16ths (the
+ * steps of the paddle response curves) and handed to the engine quantized
+ * the same way when recording, so recording and playback see equal values.
+ * Random values have no useful delta and go in as-is.
+ * 
+ * Records go through a fixed-size byte ring (no malloc): the recorder writes
+ * at the head, Replay_Read() drains from the tail (e.g. to the UART while
+ * the game runs), and playback consumes from the tail too. When the ring is
+ * full, recording stops and Replay_t.overflow is set, so what was recorded
+ * is still a valid prefix of the session.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include "Joystick_Types.h"
+
+// Journal size in bytes (a constant direction costs 2 bytes per 263 steps,
+// a ball reset 2 bytes)
+#ifndef REPLAY_BUFFER_BYTES
+#define REPLAY_BUFFER_BYTES 4096
+#endif
+
+// Journalled joystick magnitude steps (1/16ths, matching PADDLE_CURVE_STEPS)
+#define REPLAY_MAGNITUDE_STEPS 16
+
+/**
+ * @enum Replay_Mode_t
+ * @brief What the journal is doing
+ */
+typedef enum {
+    REPLAY_OFF = 0,     ///< Pass everything through (live play)
+    REPLAY_RECORD,      ///< Journal every step's input and every random draw
+    REPLAY_PLAY         ///< Feed journalled inputs and draws back to the engine
+} Replay_Mode_t;
+
+/**
+ * @struct Replay_t
+ * @brief Journal state and ring buffer
+ */
+typedef struct {
+    Replay_Mode_t mode;
+    uint8_t buf[REPLAY_BUFFER_BYTES];   // Byte ring
+    uint16_t head;                      // Next byte to write
+    uint16_t tail;                      // Next byte to read
+    uint16_t used;                      // Bytes in the ring
+    uint8_t run_direction;              // Open input run (recording) or current run (playback)
+    uint16_t run_steps;                 // Steps in the open run / steps left in the current run
+    uint8_t magnitude_level;            // Joystick magnitude of the run, in 1/REPLAY_MAGNITUDE_STEPS
+    uint8_t overflow;                   // Recording: ring filled up and recording stopped
+    uint8_t desync;                     // Playback: journal ran out or did not match the engine
+    uint32_t steps;                     // Steps recorded or played
+} Replay_t;
+
+/**
+ * @brief Start an empty journal
+ * 
+ * @param replay Pointer to journal
+ * @param mode REPLAY_RECORD to record, REPLAY_OFF to pass through
+ */
+void Replay_Init(Replay_t* replay, Replay_Mode_t mode);
+
+/**
+ * @brief Load a recorded journal and start playing it back
+ * 
+ * @param replay Pointer to journal
+ * @param data Journal bytes (as drained by Replay_Read())
+ * @param length Number of bytes (at most REPLAY_BUFFER_BYTES are used)
+ */
+void Replay_Load(Replay_t* replay, const uint8_t* data, uint16_t length);
+
+/**
+ * @brief Journal or replay one physics step's input
+ * 
+ * Call at the start of every step. Recording: the direction and magnitude
+ * are journalled, and the magnitude is rounded to the 1/16th that was stored.
+ * Playback: both are replaced with the recorded ones (the live input is used
+ * once the journal runs out). The angle is not journalled.
+ * 
+ * @param replay Pointer to journal
+ * @param input Live joystick input, updated in place with what the engine should use
+ */
+void Replay_Step(Replay_t* replay, UserInput* input);
+
+/**
+ * @brief Journal or replay a random draw
+ * 
+ * @param replay Pointer to journal
+ * @param max Exclusive upper bound
+ * @return Random value in [0, max): fresh when recording or off, journalled when playing
+ */
+uint16_t Replay_Random(Replay_t* replay, uint16_t max);
+
+/**
+ * @brief Drain journal bytes (recording) for storage or transmission
+ * 
+ * Closes the open input run first, so everything recorded so far is included.
+ * 
+ * @param replay Pointer to journal
+ * @param out Buffer for the bytes
+ * @param max Size of out
+ * @return Number of bytes copied
+ */
+uint16_t Replay_Read(Replay_t* replay, uint8_t* out, uint16_t max);
+
+/**
+ * @brief Check whether playback has used up the journal
+ * 
+ * @param replay Pointer to journal
+ * @return 1 if the journal is exhausted (or not playing), 0 while playing
+ */
+uint8_t Replay_IsFinished(Replay_t* replay);
+
+#endif // REPLAY_H
@@ -10,6 +10,7 @@ Written by Aeron Jarvis and James Avery
 #define LCD_h
 
 #include "ST7789V2_Driver.h"
+#include "LCD_Image.h"
 #include <stdlib.h>
 
 // ========== Colour definitions ==========
@@ -20,6 +21,7 @@ Written by Aeron Jarvis and James Avery
 //
 // However before use here they need to be byte-swapped for ST7789V2 little-endian format.
 // i.e. Red is 0xF800 (big endian) but byte swapped to 0x00F8 (little endian) here.
+// (LCD_Refresh swaps palette colours back once, when the palette is set, and sends 16-bit pixels.)
 
 // Basic colours - either chosen for ease of use or high contrast
 // some based on https://sashamaps.net/docs/resources/20-colors/ 
@@ -120,7 +122,193 @@ Written by Aeron Jarvis and James Avery
 
 
 // ========== Buffer Configuration ==========
-#define BUFFER_LENGTH ST7789V2_HEIGHT*ST7789V2_WIDTH/2  // 4 pixels per byte (2 bits per pixel)
+// Bits per pixel of the image buffer: 4 (16 palette colours, 28.8KB) or 8 (256 palette
+// colours, 57.6KB). With 8, indices 0-15 are the selected palette as usual and 16-255 start
+// as a 6x6x6 colour cube and a grey ramp, which LCD_Set_Palette_Entry() can change.
+#ifndef LCD_BITS_PER_PIXEL
+#define LCD_BITS_PER_PIXEL 4
+#endif
+#if LCD_BITS_PER_PIXEL != 4 && LCD_BITS_PER_PIXEL != 8
+#error "LCD_BITS_PER_PIXEL must be 4 or 8"
+#endif
+#define LCD_PIXELS_PER_BYTE (8 / LCD_BITS_PER_PIXEL)
+#define LCD_PALETTE_SIZE (1 << LCD_BITS_PER_PIXEL)
+#define LCD_COLOUR_MASK (LCD_PALETTE_SIZE - 1)
+
+#define BUFFER_LENGTH ST7789V2_HEIGHT*ST7789V2_WIDTH/LCD_PIXELS_PER_BYTE
+
+// Set to 1 to add a second image buffer (another 28.8KB of RAM). Drawing then goes to the
+// back buffer while DMA sends the front one, see LCD_Swap().
+#ifndef LCD_DOUBLE_BUFFER
+#define LCD_DOUBLE_BUFFER 0
+#endif
+#if LCD_DOUBLE_BUFFER && LCD_BITS_PER_PIXEL == 8
+#error "Two 8bpp image buffers (115.2KB) don't fit in RAM, use LCD_DOUBLE_BUFFER with 4bpp"
+#endif
+
+// Number of panels driven at once, each wired to its own SPI with its own DMA channel (e.g. SPI2
+// on DMA1 Channel5 and SPI1 on DMA1 Channel3, or SPI3 on DMA2 Channel2). Each display has its
+// own image buffer, dirty tracking, palette, line buffers and background refresh, so both can be
+// refreshed at the same time. LCD_init()/LCD_Init_Start() bind a display to its cfg, drawing
+// goes to the one chosen by LCD_Select_Display(). A second 4bpp image buffer is all that fits.
+#ifndef LCD_MAX_DISPLAYS
+#define LCD_MAX_DISPLAYS 1
+#endif
+#if LCD_MAX_DISPLAYS < 1 || LCD_MAX_DISPLAYS > 2
+#error "LCD_MAX_DISPLAYS must be 1 or 2"
+#endif
+#if LCD_MAX_DISPLAYS > 1 && (LCD_DOUBLE_BUFFER || LCD_BITS_PER_PIXEL == 8)
+#error "Two displays only fit in RAM with one 4bpp image buffer each"
+#endif
+
+// Set to 1 to have LCD_init() try each SPI divider from cfg->spi_baud_div down to /256,
+// writing and reading back a test pattern, and keep the fastest that works reliably.
+#ifndef LCD_SPI_SELF_TEST
+#define LCD_SPI_SELF_TEST 0
+#endif
+
+// Set to 1 to have LCD_Refresh hash each dirty row (CRC peripheral) and skip rows whose
+// pixels are the same as what the panel already shows. Costs 1.2KB of RAM.
+#ifndef LCD_FRAME_DIFF
+#define LCD_FRAME_DIFF 0
+#endif
+
+// Number of pre-rasterised characters (per character, size and colour) LCD_printString keeps,
+// so repeated text is drawn with masked byte copies. Each takes about 160 bytes with the
+// default max size. Set to 0 to disable. Larger font sizes are drawn pixel by pixel.
+#ifndef LCD_GLYPH_CACHE_ENTRIES
+#define LCD_GLYPH_CACHE_ENTRIES 24
+#endif
+#ifndef LCD_GLYPH_CACHE_MAX_SIZE
+#define LCD_GLYPH_CACHE_MAX_SIZE 4
+#endif
+
+// Placement of the image buffer(s) and the DMA line buffers. By default the single image buffer
+// goes in SRAM2 (.sram2 in the linker script) and the line buffers in SRAM1, so the CPU drawing
+// and the DMA sending use different memories. Two image buffers don't fit in SRAM2, so with
+// LCD_DOUBLE_BUFFER they stay in SRAM1, as does an 8bpp buffer or one over SRAM2's 32KB (a
+// 240x320 panel). Either attribute can be overridden.
+// A second display's image buffer (LCD_MAX_DISPLAYS) goes in SRAM1, see LCD_FRAMEBUFFER1_ATTR.
+#ifndef LCD_FRAMEBUFFER_IN_SRAM2
+#define LCD_FRAMEBUFFER_IN_SRAM2 (!LCD_DOUBLE_BUFFER && LCD_BITS_PER_PIXEL == 4 && (BUFFER_LENGTH) <= 32768)
+#endif
+#ifndef LCD_FRAMEBUFFER_ATTR
+#if LCD_FRAMEBUFFER_IN_SRAM2
+#define LCD_FRAMEBUFFER_ATTR __attribute__((section(".sram2")))
+#else
+#define LCD_FRAMEBUFFER_ATTR
+#endif
+#endif
+#ifndef LCD_FRAMEBUFFER1_ATTR
+#define LCD_FRAMEBUFFER1_ATTR
+#endif
+#ifndef LCD_LINE_BUFFER_ATTR
+#define LCD_LINE_BUFFER_ATTR __attribute__((section(".sram1")))
+#endif
+
+// Milliseconds a wait for a background refresh sleeps through without the refresh moving
+// on before it gives up: the refresh is dropped and ST7789V2_FAULT_STALLED recorded, see
+// LCD_Recover(). Timed with the DWT cycle counter, so however often other interrupts wake
+// the core; at most 53000 (the counter's wrap at 80MHz).
+#ifndef LCD_REFRESH_STALL_MS
+#define LCD_REFRESH_STALL_MS 500
+#endif
+#if LCD_REFRESH_STALL_MS < 1 || LCD_REFRESH_STALL_MS > 53000
+#error "LCD_REFRESH_STALL_MS must be 1-53000"
+#endif
+
+// Maximum number of contiguous dirty rows LCD_Refresh sends with one address window and
+// one DMA transfer. Sets the size of the two line buffers (2 * 480 bytes per row).
+// Must be at most 136 so a batch fits in a single 65535-byte DMA transfer.
+#ifndef LCD_MAX_LINES_PER_BATCH
+#define LCD_MAX_LINES_PER_BATCH 8
+#endif
+
+// Set to 1 to drop the image buffer and record drawing in a display list instead (see
+// LCD_List.h), about 7KB rather than 28.8KB. The refresh rasterises each batch of rows
+// straight from the list and only sends rows whose commands changed since the last frame.
+// Each frame must start with LCD_Clear_Background() or LCD_Fill_Buffer(), which empty the list.
+#ifndef LCD_DISPLAY_LIST
+#define LCD_DISPLAY_LIST 0
+#endif
+#if LCD_DISPLAY_LIST && (LCD_DOUBLE_BUFFER || LCD_FRAME_DIFF)
+#error "LCD_DISPLAY_LIST replaces the image buffer, it can't be combined with LCD_DOUBLE_BUFFER or LCD_FRAME_DIFF"
+#endif
+#if LCD_DISPLAY_LIST && LCD_MAX_DISPLAYS > 1
+#error "LCD_DISPLAY_LIST keeps a single list, it can't be combined with LCD_MAX_DISPLAYS > 1"
+#endif
+
+// Set to 1 to keep, for each row, which palette colours the panel shows on it, worked out as
+// the rows are sent. Palette changes (LCD_Set_Palette_Colour(), LCD_Cycle_Palette(), and
+// LCD_Set_Palette() to a palette that shares colours) then only resend the rows showing a
+// colour that changed, not every row. Costs 480 bytes of RAM per display and a few cycles per
+// byte sent. With 8bpp, colours are grouped by their low 4 bits.
+#ifndef LCD_PALETTE_ROW_MASKS
+#define LCD_PALETTE_ROW_MASKS 0
+#endif
+#if LCD_PALETTE_ROW_MASKS && LCD_DISPLAY_LIST
+#error "LCD_PALETTE_ROW_MASKS reads the image buffer as it is sent, there is none with LCD_DISPLAY_LIST"
+#endif
+
+// Set to a number of rows to keep that many rows already expanded to RGB565 (about 500 bytes
+// each, in SRAM1 with the line buffers), keyed by a hash of their pixels (CRC peripheral) and
+// the palette. A dirty row found in the cache is sent straight from it instead of being
+// expanded again. A row goes in the second time running it is sent with the same pixels,
+// e.g. a band of bricks or text resent because of a redraw next to it, in place of the least
+// recently used one. Costs a hash of each dirty row and 960 bytes of RAM besides the cache.
+// LCD_FRAME_DIFF already skips rows sent with the same pixels as before, so isn't combined.
+#ifndef LCD_ROW_CACHE_ROWS
+#define LCD_ROW_CACHE_ROWS 0
+#endif
+#if LCD_ROW_CACHE_ROWS == 1
+#error "LCD_ROW_CACHE_ROWS must be 0 or at least 2, as the row being sent can't make room for the next"
+#endif
+#if LCD_ROW_CACHE_ROWS && (LCD_FRAME_DIFF || LCD_DISPLAY_LIST)
+#error "LCD_ROW_CACHE_ROWS caches rows of the image buffer LCD_FRAME_DIFF would skip, and there is none with LCD_DISPLAY_LIST"
+#endif
+
+// Viewports LCD_Push_Viewport() can nest (20 bytes each per display)
+#ifndef LCD_VIEWPORT_DEPTH
+#define LCD_VIEWPORT_DEPTH 4
+#endif
+
+// Set to 1 to have LCD_Fill_Buffer() start a DMA2 memory-to-memory transfer that clears the
+// image buffer and return straight away, so input and physics run while it clears. The next
+// call that draws into (or refreshes from) the image buffer waits for it to finish first.
+// LCD_DMA_CLEAR_CHANNEL must be a DMA2 channel nothing else uses.
+#ifndef LCD_DMA_CLEAR
+#define LCD_DMA_CLEAR 0
+#endif
+#ifndef LCD_DMA_CLEAR_CHANNEL
+#define LCD_DMA_CLEAR_CHANNEL DMA2_Channel1
+#endif
+
+// Set to 1 to have text widgets (LCD_Text_Widget) composited into the line buffers as their
+// rows are sent, from a 1bpp strip of the text, rather than drawn into the image buffer. A new
+// value then costs no image buffer writes or erasing, just a resend of the rows under the old
+// and new text, and the text is not in what LCD_Get_Pixel() reads or a frame dump shows.
+// Costs about 140 bytes per widget, and the pixels it covers are checked on every row sent.
+#ifndef LCD_TEXT_OVERLAY
+#define LCD_TEXT_OVERLAY 0
+#endif
+
+// Set to 1 to check what the refreshes send, for trying out a faster SPI clock or changes to
+// the expansion. LCD_Refresh() and LCD_Refresh_Region() hash each row of a batch with the CRC
+// peripheral while the DMA sends it, and compare that with the hash of the row worked out
+// pixel by pixel from the palette. LCD_init() (or LCD_Init_Poll()) also runs LCD_Self_Test(),
+// lowering the SPI divider until the panel reads back what it was sent. Mismatches are
+// counted in the refresh stats and passed to LCD_Set_Check_Callback()'s callback. Background
+// refreshes are not checked.
+#ifndef LCD_REFRESH_CHECK
+#define LCD_REFRESH_CHECK 0
+#endif
+#if LCD_REFRESH_CHECK && LCD_DISPLAY_LIST
+#error "LCD_REFRESH_CHECK compares with the image buffer, there is none with LCD_DISPLAY_LIST"
+#endif
+// LCD_Self_Test() reads back every this many rows: each takes about 9ms at the read divider
+#ifndef LCD_SELF_TEST_ROW_STEP
+#define LCD_SELF_TEST_ROW_STEP 16
+#endif
 
 // ========== Function Prototypes ==========
 
@@ -140,11 +328,88 @@ typedef enum {
 *   @param palette - The palette to activate (PALETTE_DEFAULT, PALETTE_GREYSCALE, PALETTE_VINTAGE, PALETTE_CUSTOM)*/
 void LCD_Set_Palette(LCD_Palette palette);
 
+/* Set Palette Colours
+*   Like LCD_Set_Palette, with 16 colours of your own (e.g. an asset pack's, AssetPack.h).
+*   They are used where they are, not copied, so must stay there until the palette changes.
+*   @param colours - 16 RGB565 colours, byte-swapped like the RGB565_* definitions*/
+void LCD_Set_Palette_Colours(const uint16_t* colours);
+
+// Gamma for LCD_Load_Palette_RGB888() and LCD_RGB888_To_RGB565(), in Q8 (e.g. LCD_GAMMA(2.2))
+#define LCD_GAMMA(g) ((uint16_t)((g) * 256.0 + 0.5))
+
+/* Load Palette RGB888
+*   Like LCD_Set_Palette_Colours, with the 16 colours given as 0xRRGGBB and a gamma applied to
+*   each channel (255 * (c / 255)^gamma): above 1.0 darkens the mid tones, below brightens them.
+*   They are converted to RGB565 once, in fixed point, and the refresh's expansion table is
+*   rebuilt from them, so pixels cost the same as with a built-in palette. The colours are
+*   copied, so the array can be reused.
+*   @param colours - 16 colours, 0xRRGGBB
+*   @param gamma - LCD_GAMMA(1.0) to use the colours as they are*/
+void LCD_Load_Palette_RGB888(const uint32_t* colours, const uint16_t gamma);
+
+/* RGB888 to RGB565
+*   Converts one colour as LCD_Load_Palette_RGB888 does, e.g. for LCD_Set_Palette_Colour.
+*   @param rgb - 0xRRGGBB
+*   @param gamma - LCD_GAMMA(1.0) to leave it as it is
+*   @return RGB565 colour, byte-swapped like the RGB565_* definitions*/
+uint16_t LCD_RGB888_To_RGB565(const uint32_t rgb, const uint16_t gamma);
+
+/* Set Palette Colour
+*   Changes one of the 16 colours of the active palette, for palette effects such as a screen
+*   flash: nothing is redrawn, the image buffer keeps its colour indices. A constant palette
+*   is first copied to RAM, and later changes go to the copy until the palette is set again.
+*   The next refresh resends the rows showing that colour (every row without
+*   LCD_PALETTE_ROW_MASKS).
+*   @param  index - Colour index 0-15
+*   @param  colour - RGB565 colour, byte-swapped like the RGB565_* definitions*/
+void LCD_Set_Palette_Colour(const uint8_t index, const uint16_t colour);
+
+/* Get Palette Colour
+*   @param  index - Colour index 0-15
+*   @return The colour of the active palette, byte-swapped like the RGB565_* definitions*/
+uint16_t LCD_Get_Palette_Colour(const uint8_t index);
+
+/* Cycle Palette
+*   Moves colours first to first + count - 1 of the active palette one place up, the last one
+*   round to first, for colour-cycling animation (call it every few frames). As
+*   LCD_Set_Palette_Colour, only the rows showing those colours are resent.
+*   @param  first - First colour index of the run
+*   @param  count - Colours in the run (2 or more, ending at 15 at most)*/
+void LCD_Cycle_Palette(const uint8_t first, const uint8_t count);
+
+#if LCD_BITS_PER_PIXEL == 8
+/* Set Palette Entry
+*   Sets one of the 256 colours of the 8bpp palette. Entries 0-15 are reloaded from the
+*   selected palette by LCD_Set_Palette(), the others keep their colour.
+*   @param index - Colour index 0-255
+*   @param colour - RGB565 colour, byte-swapped like the RGB565_* definitions*/
+void LCD_Set_Palette_Entry(const uint8_t index, const uint16_t colour);
+#endif
+
 /* Initialise display
 *   Powers up the display and turns on backlight.
-*   Sets the display up in horizontal addressing mode and with normal video mode.*/
+*   Sets the display up in horizontal addressing mode and with normal video mode.
+*   The SPI clock divider comes from cfg->spi_baud_div. With LCD_SPI_SELF_TEST, that is the
+*   fastest divider tried and the one found to work is written back to it.*/
 void LCD_init(ST7789V2_cfg_t* cfg);
 
+/* Initialise display without blocking
+*   As LCD_init, but the panel's power-up waits (about 300ms) are left to run while the caller
+*   gets on with other set-up. LCD_Init_Start() starts the power-up and readies the image
+*   buffer, which can be drawn to straight away. LCD_Init_Poll() moves the power-up on and
+*   returns 1 once the display is ready; call it until then, and don't refresh before.
+*   @param  now_ms - a millisecond clock, e.g. HAL_GetTick()*/
+void LCD_Init_Start(ST7789V2_cfg_t* cfg, const uint32_t now_ms);
+uint8_t LCD_Init_Poll(ST7789V2_cfg_t* cfg, const uint32_t now_ms);
+
+/* Select display
+*   With LCD_MAX_DISPLAYS > 1, makes the display bound to cfg (by LCD_init()/LCD_Init_Start(),
+*   which also select it) the one the drawing functions, the palette, row watch, lines per batch,
+*   LCD_Refresh_Wait(), LCD_Refresh_Busy() and LCD_Get_TE_Count() work on. The refresh, scroll
+*   and power profile functions always use the display bound to the cfg they are given, so one
+*   display can be drawn while the other is refreshing. Does nothing with one display.*/
+void LCD_Select_Display(ST7789V2_cfg_t* cfg);
+
 /* Turn off
 *   Powers down the display and turns off the backlight.*/
 void LCD_turnOff(ST7789V2_cfg_t* cfg);
@@ -165,6 +430,41 @@ void LCD_normalMode(ST7789V2_cfg_t* cfg);
 *   Turn on inverse video mode */
 void LCD_inverseMode(ST7789V2_cfg_t* cfg);
 
+/* Set Scroll Area
+*   Sets up hardware vertical scrolling: the top_fixed rows at the top and bottom_fixed rows at
+*   the bottom of the screen stay where they are, the rows between them scroll (see LCD_Scroll()).
+*   Resets the scroll offset to 0. LCD_Set_Scroll_Area(cfg, 0, 0) scrolls the whole screen.
+*   @param  top_fixed - rows at the top that don't scroll
+*   @param  bottom_fixed - rows at the bottom that don't scroll*/
+void LCD_Set_Scroll_Area(ST7789V2_cfg_t* cfg, const uint16_t top_fixed, const uint16_t bottom_fixed);
+
+/* Scroll
+*   Moves the scroll area up by offset rows, wrapping the rows that leave the top round to the
+*   bottom. Only a command is sent: the panel memory and the image buffer stay as they are, so
+*   buffer row top_fixed + offset is now at the top of the scroll area. Drawing and refreshing
+*   carry on in buffer rows, e.g. to draw the rows about to scroll into view.
+*   @param  offset - rows to scroll by, taken modulo the scroll area height*/
+void LCD_Scroll(ST7789V2_cfg_t* cfg, const uint16_t offset);
+
+/* Power Profiles
+*   Trade display quality for panel power on static screens. The 8-colour modes show only the
+*   top bit of each of red, green and blue (black, white, red, green, blue, cyan, magenta, yellow).*/
+typedef enum {
+    LCD_POWER_NORMAL = 0,       // Whole panel, full colour (the default)
+    LCD_POWER_IDLE = 1,         // Whole panel, 8 colours
+    LCD_POWER_PARTIAL = 2,      // Only rows y0..y1 are driven, the rest is black. Full colour
+    LCD_POWER_PARTIAL_IDLE = 3  // Only rows y0..y1, 8 colours
+} LCD_Power_Profile;
+
+/* Set Power Profile
+*   Switches the panel between the power profiles, which takes effect at once. In the partial
+*   profiles refreshes only send rows y0..y1; changes outside them are kept and sent once back
+*   in LCD_POWER_NORMAL or LCD_POWER_IDLE. Ends any hardware scrolling (LCD_Scroll()).
+*   @param  profile - LCD_POWER_NORMAL, LCD_POWER_IDLE, LCD_POWER_PARTIAL or LCD_POWER_PARTIAL_IDLE
+*   @param  y0 - first row shown in the partial profiles (ignored by the others)
+*   @param  y1 - last row shown in the partial profiles (ignored by the others)*/
+void LCD_Set_Power_Profile(ST7789V2_cfg_t* cfg, const LCD_Power_Profile profile, const uint16_t y0, const uint16_t y1);
+
 /* Print String
 *   Prints a string of characters to the screen buffer. String is cut-off after the 83rd pixel.
 *   @param  x - the x position (top-left)
@@ -173,6 +473,38 @@ void LCD_inverseMode(ST7789V2_cfg_t* cfg);
 *   @param  font_size - Value to scale up font by, 1 = 1x scale, 2 = 2x scale, 3 = 3x scale, etc...*/
 void LCD_printString(char const *str, const uint16_t x, const uint16_t y, uint8_t colour, uint8_t font_size);
 
+// Which part of a string LCD_printString_Aligned puts at x
+typedef enum {
+  LCD_ALIGN_LEFT = 0,     // Left edge
+  LCD_ALIGN_CENTRE = 1,   // Middle (a half pixel left of it for an odd width)
+  LCD_ALIGN_RIGHT = 2     // Right edge: the last column drawn is x - 1
+} LCD_Align;
+
+/* Measure String
+*   @param  str - the string
+*   @param  font_size - scale, as for LCD_printString
+*   @returns - width in pixels LCD_printString draws the string across, from the left of its
+*              first character to the right of its last (no gap after it); 0 for ""*/
+uint16_t LCD_Measure_String(char const *str, uint8_t font_size);
+
+/* Print String Aligned
+*   As LCD_printString, with x the left edge, the middle or the right edge of the string, e.g.
+*   LCD_printString_Aligned("PONG", ST7789V2_WIDTH / 2, 50, 1, 4, LCD_ALIGN_CENTRE) to centre it
+*   on the screen. Text past the edges is clipped.
+*   @param  align - LCD_ALIGN_LEFT, LCD_ALIGN_CENTRE or LCD_ALIGN_RIGHT*/
+void LCD_printString_Aligned(char const *str, const uint16_t x, const uint16_t y, uint8_t colour, uint8_t font_size, const LCD_Align align);
+
+/* Set Font
+*   Switches the font of LCD_printString/LCD_printChar (e.g. to an asset pack's, AssetPack.h).
+*   Used where it is, not copied, so it must stay there until the font changes.
+*   @param font - 96 characters (32-127) of 5 column bytes, bit 0 the top row, as font5x7_;
+*                 NULL for font5x7_*/
+void LCD_Set_Font(const unsigned char* font);
+
+/* Get Font
+*   @return The font set by LCD_Set_Font (font5x7_ if none)*/
+const unsigned char* LCD_Get_Font(void);
+
 /* Print Character
 *   Sends a character to the screen buffer.  Printed at the specified location. Character is cut-off after the 83rd pixel.
 *   @param  c - the character to print. Can print ASCII as so printChar('C').
@@ -185,20 +517,264 @@ void LCD_printChar(char const c, const uint16_t x, const uint16_t y, uint8_t col
 * @param x      The x co-ordinate of the pixel (0 to 239)
 * @param y      The y co-ordinate of the pixel (0 to 279)
 * @param colour The colour of the pixel
-* @details This function sets the colour of a pixel in the screen buffer.*/
+* @details This function sets the colour of a pixel in the screen buffer, if it is inside
+*          the clip rectangle.*/
 void LCD_Set_Pixel(const uint16_t x, const uint16_t y, uint8_t colour);
 
+/* Set Pixels
+* @param xs      The x co-ordinates of the pixels
+* @param ys      The y co-ordinates of the pixels
+* @param colours The colour of each pixel
+* @param count   Number of pixels
+* @details Sets many scattered pixels in one call, e.g. particles kept as arrays of
+*          co-ordinates. Does the same as LCD_Set_Pixel for each, with the per-call work
+*          done once. Pixels outside the clip rectangle are skipped. With LCD_DISPLAY_LIST each pixel
+*          takes one command of the list.*/
+void LCD_Set_Pixels(const uint8_t* xs, const uint8_t* ys, const uint8_t* colours, const uint16_t count);
+
+/* Fill a Span
+* @param y      The y co-ordinate of the span (0 to 239)
+* @param x0     The x co-ordinate of one end of the span
+* @param x1     The x co-ordinate of the other end of the span (inclusive)
+* @param colour The colour of the pixels
+* @details This function sets a horizontal run of pixels in the screen buffer. It writes whole
+*          bytes (two pixels at a time) and clips the span to the clip rectangle, so it is much
+*          faster than calling LCD_Set_Pixel for each pixel.*/
+void LCD_Fill_Span(const uint16_t y, uint16_t x0, uint16_t x1, uint8_t colour);
+
 /* Get a Pixel
-*   This function gets the status of a pixel in the screen buffer.
-*   @param  x - the x co-ordinate of the pixel (0 to 83)
-*   @param  y - the y co-ordinate of the pixel (0 to 47)
-*   @returns - colour of pixel*/
+*   This function gets the status of a pixel in the screen buffer. Unlike drawing, reading
+*   takes screen co-ordinates whatever the viewport.
+*   @param  x - the x co-ordinate of the pixel (0 to 239)
+*   @param  y - the y co-ordinate of the pixel (0 to 239)
+*   @returns - colour of pixel (0-15), or 0 if it is off the screen*/
 uint8_t LCD_Get_Pixel(const uint16_t x, const uint16_t y);
 
+/* Get a Row
+*   Reads a run of pixels of one row of the screen buffer, one colour (0-15) per byte.
+*   The run is clipped to the screen.
+*   @param  y - the y co-ordinate of the row (0 to 239)
+*   @param  x0 - x co-ordinate of the first pixel
+*   @param  x1 - x co-ordinate of the last pixel (inclusive, >= x0)
+*   @param  out - buffer for the colours, at least x1 - x0 + 1 bytes
+*   @returns - number of pixels written to out*/
+uint16_t LCD_Get_Row(const uint16_t y, uint16_t x0, uint16_t x1, uint8_t* out);
+
+// ========== Clipping and viewports ==========
+// Every drawing function clips what it draws to the clip rectangle (the whole screen until
+// one is set), once per shape, and takes co-ordinates relative to the current viewport.
+// Co-ordinates may be negative, cast to uint16_t (e.g. (uint16_t)-3): a shape partly off the
+// left or top edge is clipped there. LCD_Fill_Buffer() and LCD_Clear_Background() always act
+// on the whole buffer, and text widgets and retained areas use screen co-ordinates.
+
+/* Set Clip Rectangle
+*   Limits drawing to a rectangle of the current viewport; pixels outside it are left as
+*   they are. The rectangle is cut down to the viewport.
+*   @param  x0 - x-coordinate of the top-left corner
+*   @param  y0 - y-coordinate of the top-left corner
+*   @param  width - width in pixels (0 clips everything away)
+*   @param  height - height in pixels*/
+void LCD_Set_Clip(const int16_t x0, const int16_t y0, const uint16_t width, const uint16_t height);
+
+/* Reset Clip Rectangle
+*   Lets drawing reach the whole of the current viewport again.*/
+void LCD_Reset_Clip(void);
+
+/* Push Viewport
+*   Moves the origin to x0, y0 of the current viewport and limits drawing to a width x height
+*   rectangle from there (and to the clip rectangle already set), until LCD_Pop_Viewport().
+*   The same drawing code can then draw e.g. a panel or a mini-map anywhere on the screen.
+*   @param  x0 - x-coordinate of the new origin
+*   @param  y0 - y-coordinate of the new origin
+*   @param  width - width of the viewport
+*   @param  height - height of the viewport
+*   @returns - 1, or 0 if LCD_VIEWPORT_DEPTH viewports are pushed already (nothing changes)*/
+uint8_t LCD_Push_Viewport(const int16_t x0, const int16_t y0, const uint16_t width, const uint16_t height);
+
+/* Pop Viewport
+*   Goes back to the origin and clip rectangle in use before the matching LCD_Push_Viewport().*/
+void LCD_Pop_Viewport(void);
+
 /* Refresh display
-*   This functions sends the screen buffer to the display.*/
+*   This functions sends the screen buffer to the display.
+*   Only the changed span (leftmost to rightmost changed pixel) of each changed row is sent.
+*   With LCD_DOUBLE_BUFFER this presents the back buffer (see LCD_Swap()) and waits for it to be sent.*/
 void LCD_Refresh(ST7789V2_cfg_t* cfg);
 
+/* Refresh region
+*   Sends the rectangle x0..x1, y0..y1 (inclusive) of the screen buffer and nothing else, changed
+*   or not, with one address window, e.g. for a HUD or paddle whose area is known. It comes off
+*   the rows' changes, so a later LCD_Refresh only sends what changed outside it (changes on
+*   both sides of it on the same row are sent in full). Like LCD_Refresh, this presents the
+*   frame drawn so far first.
+*   @param  x0 - left column
+*   @param  y0 - top row
+*   @param  x1 - right column
+*   @param  y1 - bottom row*/
+void LCD_Refresh_Region(ST7789V2_cfg_t* cfg, const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1);
+
+/* Show Image
+*   Sends a compressed full-colour image (LCD_Image.h) straight to the panel, decoding it a batch
+*   of rows at a time into the line buffers while the one before goes out by DMA. It never goes
+*   through the image buffer, so it costs no RAM and is not limited to the palette, but it stays
+*   on the panel only until the rows under it are sent again: drawing over it replaces what it
+*   covers, and LCD_Fill_Buffer or LCD_Clear_Background remove it (with LCD_DISPLAY_LIST, a
+*   change to the commands on its rows). Waits for any refresh first and, like LCD_Refresh, returns
+*   once the last batch is on its way.
+*   @param  x0 - x-coordinate of origin (top-left); the image must fit across the screen
+*   @param  y0 - y-coordinate of origin (top-left); rows below the screen are left out
+*   @param  image - compressed image, read where it is (e.g. flash)
+*   @param  length - bytes of it
+*   @returns - 1 if shown, 0 if it does not fit or is damaged (what was decoded before the damage
+*              is shown, the rest of it black)*/
+uint8_t LCD_Show_Image(ST7789V2_cfg_t* cfg, const uint16_t x0, const uint16_t y0, const uint8_t* image, const uint32_t length);
+
+/* Show Image Stream
+*   As LCD_Show_Image, for an image that is not in the address space (e.g. an asset pack on an
+*   external flash, AssetPack_Stream_Read()). Before each row is decoded, reader tops up window
+*   with the next bytes; a flash read on its own SPI there overlaps the LCD DMA sending the
+*   batch before.
+*   @param  x0 - x-coordinate of origin (top-left); the image must fit across the screen
+*   @param  y0 - y-coordinate of origin (top-left); rows below the screen are left out
+*   @param  reader - gives the image's bytes in order (LCD_Image.h)
+*   @param  context - passed to reader
+*   @param  window - RAM to decode from, LCD_IMAGE_WINDOW_BYTES(image width) is enough
+*   @param  window_bytes - its size
+*   @returns - 1 if shown, 0 if it does not fit, the window is too small or it is damaged or cut
+*              short (the rest of it then black)*/
+uint8_t LCD_Show_Image_Stream(ST7789V2_cfg_t* cfg, const uint16_t x0, const uint16_t y0, LCD_Image_Reader reader,
+                              void* context, uint8_t* window, const uint32_t window_bytes);
+
+/* Set Lines per Batch
+*   Sets how many contiguous dirty rows LCD_Refresh merges into one transfer. Larger batches
+*   send fewer CASET/RASET/RAMWR command sequences, but every row of a batch is sent with
+*   the union of the rows' changed spans.
+*   @param  lines - rows per batch, clamped to 1 to LCD_MAX_LINES_PER_BATCH (the default)*/
+void LCD_Set_Lines_Per_Batch(const uint16_t lines);
+
+/* Refresh completion callback
+*   Called from the DMA interrupt once LCD_RefreshAsync() has sent its last row.*/
+typedef void (*LCD_Refresh_Callback)(void);
+
+/* Refresh display in the background
+*   Starts sending the changed rows of the screen buffer and returns straight away. Each row
+*   transfer ends with a DMA transfer-complete interrupt that starts the next one, so the CPU
+*   is free while the frame goes out. The screen buffer must not be drawn to until the
+*   refresh has finished (see LCD_Refresh_Busy() / LCD_Refresh_Wait()).
+*   The DMA channel's IRQ handler must call LCD_DMA_IRQHandler().
+*   @param  cfg - LCD Config struct
+*   @param  callback - Function called when the refresh completes, or NULL*/
+void LCD_RefreshAsync(ST7789V2_cfg_t* cfg, LCD_Refresh_Callback callback);
+
+/* Watch rows
+*   Sets a function to be called from the DMA interrupt, during a background refresh, as
+*   soon as every changed row in y0 to y1 has been sent to the panel. Used to timestamp when
+*   something drawn (e.g. a sprite) actually reaches the screen. Rows that did not change are
+*   not sent, so the callback does not run if none of the watched rows changed.
+*   @param  y0 - first watched row
+*   @param  y1 - last watched row
+*   @param  callback - Function to call, or NULL to stop watching*/
+void LCD_Set_Row_Watch(const int16_t y0, const int16_t y1, LCD_Refresh_Callback callback);
+
+/* Swap buffers
+*   Presents the frame drawn so far and starts sending it in the background, like
+*   LCD_RefreshAsync(). With LCD_DOUBLE_BUFFER the image buffers are page-flipped: the
+*   finished frame becomes the front buffer being sent, and drawing continues straight away
+*   in the back buffer, which already holds a copy of the presented frame. Without
+*   LCD_DOUBLE_BUFFER, the buffer must not be drawn to until the refresh has finished.
+*   Waits for the previous refresh to finish before flipping.
+*   @param  cfg - LCD Config struct*/
+void LCD_Swap(ST7789V2_cfg_t* cfg);
+
+/* Wait for draw buffer
+*   Blocks until the buffer drawing functions write to can be modified. Returns straight
+*   away with LCD_DOUBLE_BUFFER, otherwise waits for any background refresh to finish.*/
+void LCD_Wait_Draw_Buffer(void);
+
+/* Refresh busy
+*   @returns - 1 while a background refresh started by LCD_RefreshAsync() is still running*/
+uint8_t LCD_Refresh_Busy(void);
+
+/* Wait for refresh
+*   Blocks until any background refresh has finished, with the core asleep (WFI) in between
+*   the transfer interrupts. A refresh that stops moving for LCD_REFRESH_STALL_MS is
+*   dropped and recorded as a fault (see LCD_Get_Fault()).*/
+void LCD_Refresh_Wait(void);
+
+/* Get fault
+*   @returns - the ST7789V2_FAULT_x bits recorded for cfg's display since it was last
+*              recovered, 0 if all is well. A DMA transfer error or SPI timeout cuts the
+*              refresh short and waits give up at once from then on, so nothing hangs but
+*              nothing new is shown either until LCD_Recover().*/
+uint8_t LCD_Get_Fault(ST7789V2_cfg_t* cfg);
+
+/* Recover
+*   Stops whatever cfg's display was sending, resets the SPI, powers the panel up again
+*   (blocking, about 300ms) and marks the whole screen for the next refresh, which then
+*   redraws it. The drawing buffers and palette are kept; the panel comes back unscrolled and
+*   in LCD_POWER_NORMAL, so set those up again if they were in use.*/
+void LCD_Recover(ST7789V2_cfg_t* cfg);
+
+/* DMA interrupt handler
+*   Chains the rows of a background refresh, and the chunks of a transfer longer than one DMA
+*   run (ST7789V2_Transfer_Start(), e.g. a fill of more than 65535 pixels). Call from the IRQ
+*   handler of the LCD DMA channel
+*   (of each display's channel with LCD_MAX_DISPLAYS > 1; it checks which have finished).*/
+void LCD_DMA_IRQHandler(void);
+
+/* TE interrupt handler
+*   When cfg->TE is connected, background refreshes (LCD_RefreshAsync(), LCD_Swap()) wait for
+*   the panel's tearing effect pulse and start at its vertical blank, so frames don't tear.
+*   Call from the EXTI IRQ handler of the TE pin.*/
+void LCD_TE_IRQHandler(void);
+
+/* TE pulse count
+*   Returns the number of panel refreshes (TE pulses) seen so far. It can be used to pace a
+*   game loop to the panel's refresh rate. Stays at 0 if TE is not connected.*/
+uint32_t LCD_Get_TE_Count(void);
+
+// Counts of what the refreshes of a display have sent since LCD_Reset_Refresh_Stats(). Rows
+// are those sent by LCD_Refresh() and LCD_RefreshAsync(); bytes also count
+// LCD_Refresh_Region() and LCD_Show_Image(), as 2 bytes (RGB565) per pixel on the bus.
+typedef struct {
+  uint32_t refreshes;  // LCD_Refresh() and LCD_RefreshAsync() (LCD_Swap()) calls
+  uint32_t rows_sent;  // Rows those refreshes sent; refreshes * ST7789V2_HEIGHT - rows_sent were skipped
+  uint32_t bytes_sent; // Pixel bytes sent
+  uint32_t waits;      // Times drawing or a new refresh had to wait for a background refresh
+  uint32_t faults;     // Background refreshes cut short by a DMA error, SPI timeout or stall
+  uint32_t recoveries; // LCD_Recover() calls
+  uint32_t rows_cached;      // Of rows_sent, those sent from the LCD_ROW_CACHE_ROWS cache
+  uint32_t check_rows;       // Rows checked with LCD_REFRESH_CHECK, sent or read back
+  uint32_t check_mismatches; // Those that didn't match the image buffer
+} LCD_Refresh_Stats;
+
+/* Refresh statistics
+*   Copies the counts of the selected display (see LCD_Select_Display()) into stats. They
+*   are updated by the DMA interrupt too, so a count may be a batch behind the others.*/
+void LCD_Get_Refresh_Stats(LCD_Refresh_Stats* stats);
+
+/* Reset refresh statistics
+*   Sets the selected display's counts back to 0.*/
+void LCD_Reset_Refresh_Stats(void);
+
+#if LCD_REFRESH_CHECK
+/* Check callback
+*   Called from LCD_Refresh(), LCD_Refresh_Region() and LCD_Self_Test() for each row that
+*   LCD_REFRESH_CHECK finds wrong: its y, the CRC-32 of the pixels sent (or read back from the
+*   panel, when read_back is 1) and of those the image buffer expands to. NULL for none.*/
+typedef void (*LCD_Check_Callback)(uint16_t y, uint32_t crc, uint32_t expected, uint8_t read_back);
+void LCD_Set_Check_Callback(LCD_Check_Callback callback);
+
+/* Self test
+*   Draws a test pattern on cfg's panel with LCD_Refresh(), checking every row as it is sent,
+*   then reads every LCD_SELF_TEST_ROW_STEP-th row back from the panel memory and checks those
+*   too. The image buffer is then cleared to colour 0, so the next refresh replaces the
+*   pattern. A refresh of the panel still running is waited for first.
+*   @param  cfg - LCD Config struct
+*   @return Rows that failed the check (0: the panel shows what it was sent)*/
+uint16_t LCD_Self_Test(ST7789V2_cfg_t* cfg);
+#endif
+
 /* Randomise buffer
 *   This function fills the buffer with random data.  Can be used to test the display.
 *   A call to refresh() must be made to update the display to reflect the change in pixels.
@@ -224,7 +800,8 @@ void LCD_plotArray(float const array[], const uint8_t colour);
 void LCD_Draw_Circle(const uint16_t x0, const uint16_t y0, const uint16_t radius, const uint8_t colour, const uint8_t fill);
 
 /* Draw Line
-*   This function draws a line between the specified points using linear interpolation.
+*   This function draws a line between the specified points (Bresenham's algorithm, stepping
+*   along the longer axis). Horizontal and vertical lines are filled as one run of pixels.
 *   @param  x0 - x-coordinate of first point
 *   @param  y0 - y-coordinate of first point
 *   @param  x1 - x-coordinate of last point
@@ -282,11 +859,271 @@ void LCD_Draw_Sprite_Scaled(const uint16_t x0, const uint16_t y0, const uint16_t
 *   @param  scale - integer scale factor (1=original size, 2=double size, 3=triple, etc.)*/
 void LCD_Draw_Sprite_Colour_Scaled(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint8_t colour, const uint8_t scale);
 
+// A sprite baked into the image buffer's own format (4bpp, two pixels per byte) with a 1bpp
+// transparency mask, stored twice: once for even and once, pre-shifted by a pixel, for odd x.
+// Drawing it is a mask-and-or of whole bytes. Create with LCD_Bake_Sprite().
+// With 8bpp each pixel is a byte, so there is only the one copy and the mask picks bytes.
+typedef struct LCD_Sprite {
+  uint16_t nrows, ncols;
+  uint16_t stride;       // Pixel bytes per row
+  uint16_t mask_stride;  // Mask bytes per row, 1 bit per pixel
+  const uint8_t* data;   // [x parity][row] pixel bytes then mask bytes (only read when drawing)
+} LCD_Sprite;
+
+// Bytes of storage LCD_Bake_Sprite() needs for a sprite of nrows x ncols
+#if LCD_BITS_PER_PIXEL == 8
+#define LCD_SPRITE_PHASES 1
+#define LCD_SPRITE_STRIDE(ncols) (ncols)
+#else
+#define LCD_SPRITE_PHASES 2
+#define LCD_SPRITE_STRIDE(ncols) (((ncols) + 2) / 2)
+#endif
+#define LCD_SPRITE_MASK_STRIDE(ncols) ((LCD_PIXELS_PER_BYTE * LCD_SPRITE_STRIDE(ncols) + 7) / 8)
+#define LCD_SPRITE_BAKED_SIZE(nrows, ncols) \
+  (LCD_SPRITE_PHASES * (nrows) * (LCD_SPRITE_STRIDE(ncols) + LCD_SPRITE_MASK_STRIDE(ncols)))
+
+/* Bake Sprite
+*   Converts a sprite in the LCD_Draw_Sprite format into a packed LCD_Sprite, for speed
+*   when the same sprite is drawn every frame.
+*   @param  baked - sprite to fill in
+*   @param  storage - LCD_SPRITE_BAKED_SIZE(nrows, ncols) bytes, kept for as long as the sprite is used
+*   @param  nrows - number of rows in sprite
+*   @param  ncols - number of columns in sprite
+*   @param  sprite - 2D array (255=transparent, 0=LCD_COLOUR_0/black, 1=LCD_COLOUR_1/white, etc.)*/
+void LCD_Bake_Sprite(LCD_Sprite* baked, uint8_t* storage, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite);
+
+/* Draw Baked Sprite
+*   Draws a sprite made by LCD_Bake_Sprite(). Sprites partly outside the clip rectangle are
+*   clipped, pixel by pixel. Each row is marked for the refresh from its first to its last
+*   opaque pixel only, so the transparent corners of a round sprite are not sent.
+*   @param  x0 - x-coordinate of origin (top-left)
+*   @param  y0 - y-coordinate of origin (top-left)
+*   @param  sprite - baked sprite*/
+void LCD_Draw_Baked_Sprite(const uint16_t x0, const uint16_t y0, const LCD_Sprite* sprite);
+
+// Frames of an animation, e.g. an asset pack's "ball0", "ball1"... (Ball_SetSprites(),
+// Paddle_SetSprites()). The frames are baked sprites, normally all the same size.
+typedef struct LCD_Sprite_Anim {
+  const LCD_Sprite* frames;
+  uint8_t count;            // Frames (at least 1)
+  uint8_t ticks_per_frame;  // Draws each frame is shown for (0 counts as 1)
+} LCD_Sprite_Anim;
+
+/* Sprite Animation Frame
+*   Picks the frame of an animation to draw.
+*   @param  anim - animation
+*   @param  tick - draws so far (wraps round through the frames)
+*   @returns - the frame*/
+const LCD_Sprite* LCD_Sprite_Anim_Frame(const LCD_Sprite_Anim* anim, const uint16_t tick);
+
+// ========== Blending and dithering ==========
+// With 16 colours a shadow or trail can't be a colour of its own: it has to be whichever
+// palette colour is nearest to the one under it tinted. A blend table works those out once for
+// a palette and an opacity, so blending costs a table lookup per pixel. Ordered dithering
+// mixes two colours by a fixed pattern instead, at no cost beyond the pixels it sets.
+// Both read the image buffer, so with LCD_DISPLAY_LIST they draw nothing.
+
+#define LCD_BLEND_OPAQUE 16  // Opacity (alpha) of colour that fully covers what is under it
+
+// index[over][under]: the palette colour nearest to over laid at the table's opacity on under
+typedef struct LCD_Blend_Table {
+  uint8_t index[16][16];
+} LCD_Blend_Table;
+
+/* Build Blend Table
+*   Works out a blend table for the active palette. Build it again after changing the palette
+*   (4096 colour comparisons, well under a millisecond).
+*   @param  table - table to fill in (256 bytes)
+*   @param  alpha - opacity of the colour laid over, 0 (invisible) to LCD_BLEND_OPAQUE*/
+void LCD_Build_Blend_Table(LCD_Blend_Table* table, const uint8_t alpha);
+
+/* Blend Rectangle / Circle
+*   Lays colour over a filled rectangle or circle at the table's opacity: each pixel under it
+*   becomes table->index[colour][pixel]. With 8 bits per pixel, pixels of colours 16-255 are
+*   left as they are.
+*   @param  x0, y0 - top-left of the rectangle, centre of the circle
+*   @param  width, height / radius - size
+*   @param  colour - Value from 0-15 referring to the colour map colour
+*   @param  table - from LCD_Build_Blend_Table()*/
+void LCD_Blend_Rect(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const uint8_t colour, const LCD_Blend_Table* table);
+void LCD_Blend_Circle(const uint16_t x0, const uint16_t y0, const uint16_t radius, const uint8_t colour, const LCD_Blend_Table* table);
+
+/* Dither Rectangle
+*   Sets level of every 16 pixels of a filled rectangle to colour, in a 4x4 ordered (Bayer)
+*   pattern, leaving the others as they are: a screen-door blend, or a gradient when drawn in
+*   bands of rising level. The pattern is fixed to the screen, so neighbouring rectangles of
+*   the same level join up seamlessly.
+*   @param  x0 - x-coordinate of origin (top-left)
+*   @param  y0 - y-coordinate of origin (top-left)
+*   @param  width - width of rectangle
+*   @param  height - height of rectangle
+*   @param  colour - Value from 0-15 referring to the colour map colour
+*   @param  level - pixels set in 16, 0 (none) to 16 (all)*/
+void LCD_Dither_Rect(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const uint8_t colour, const uint8_t level);
+
+// ========== Atlas fonts ==========
+// Proportional fonts rendered on the PC from an outline (TrueType) font at one pixel size, into
+// a glyph atlas that stays in flash (an asset pack's, make_asset_pack.py --atlas), for text too
+// big to look right as font5x7_ scaled up in blocks. Each glyph pixel is a 4-bit coverage, 0
+// (outside) to 15 (inside), and each glyph row starts on a byte, low nibble first like the 4bpp
+// image buffer. Runs of solid pixels are drawn as whole-byte fills; the edge pixels between are
+// blended into what is under them by a set of font shades, or without shades drawn solid from
+// half coverage up.
+
+// Opacities between outside and inside that edge pixels are drawn at (a 256-byte table each)
+#ifndef LCD_FONT_SHADES
+#define LCD_FONT_SHADES 3
+#endif
+
+// One glyph of an atlas font, 8 bytes as stored in the atlas
+typedef struct LCD_Font_Glyph {
+  uint16_t offset;    // First byte of its bitmap in the font's bitmaps
+  uint8_t width;      // Columns of the bitmap, (width + 1) / 2 bytes a row (0: nothing drawn)
+  uint8_t rows;       // Rows of the bitmap
+  int8_t x_offset;    // Columns from the pen position to the bitmap's left edge
+  uint8_t y_offset;   // Rows from the top of the line to the bitmap's top
+  uint8_t advance;    // Columns from the pen position to the next glyph's
+  uint8_t reserved;
+} LCD_Font_Glyph;
+
+typedef struct LCD_Font {
+  uint8_t first;                // Code of the first character
+  uint8_t count;                // Characters from first on; others are skipped
+  uint8_t height;               // Line height in pixels
+  const LCD_Font_Glyph* glyphs; // count glyphs
+  const uint8_t* bitmaps;       // Their bitmaps
+} LCD_Font;
+
+typedef struct LCD_Font_Shades {
+  LCD_Blend_Table table[LCD_FONT_SHADES];  // Opacity (i + 1) / (LCD_FONT_SHADES + 1)
+} LCD_Font_Shades;
+
+/* Build Font Shades
+*   Works out the edge shades for the active palette. Build them again after changing it.
+*   @param  shades - shades to fill in (LCD_FONT_SHADES blend tables)*/
+void LCD_Build_Font_Shades(LCD_Font_Shades* shades);
+
+/* Font Text Width
+*   @param  str - text
+*   @param  font - atlas font
+*   @returns - columns LCD_Print_Font would advance the pen by, e.g. to centre the text*/
+uint16_t LCD_Font_Width(char const *str, const LCD_Font* font);
+
+/* Print String in an Atlas Font
+*   Draws text with each character as wide as its glyph. Clipped to the clip rectangle. With
+*   LCD_DISPLAY_LIST each solid run of pixels takes one command of the list, and edges are not
+*   blended, so only short text at small sizes fits.
+*   @param  str - text
+*   @param  x - pen position of the first character
+*   @param  y - top of the line
+*   @param  colour - Value from 0-15 referring to the colour map colour
+*   @param  font - atlas font, e.g. from AssetPack_Atlas()
+*   @param  shades - from LCD_Build_Font_Shades() for smooth edges, NULL for hard edges
+*   @returns - columns the pen moved, as LCD_Font_Width*/
+uint16_t LCD_Print_Font(char const *str, const uint16_t x, const uint16_t y, const uint8_t colour, const LCD_Font* font, const LCD_Font_Shades* shades);
+
+#if LCD_DISPLAY_LIST
+// ========== Full colour drawing (LCD_DISPLAY_LIST only) ==========
+// Without an image buffer nothing limits pixels to the 16 palette colours. These take an
+// RGB565 colour, byte-swapped like the RGB565_* definitions (e.g. RGB565_SKY_BLUE).
+
+/* Draw Rectangle / Circle / String in RGB565
+*   As LCD_Draw_Rect, LCD_Draw_Circle and LCD_printString, with an RGB565 colour.*/
+void LCD_Draw_Rect_RGB565(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const uint16_t colour, const uint8_t fill);
+void LCD_Draw_Circle_RGB565(const uint16_t x0, const uint16_t y0, const uint16_t radius, const uint16_t colour, const uint8_t fill);
+void LCD_printString_RGB565(char const *str, const uint16_t x, const uint16_t y, const uint16_t colour, uint8_t font_size);
+
+/* Draw Image
+*   Draws an opaque image of RGB565 pixels, row by row. The pixels are read when the frame is
+*   refreshed, so they must not change before then.
+*   @param  x0 - x-coordinate of origin (top-left)
+*   @param  y0 - y-coordinate of origin (top-left)
+*   @param  nrows - number of rows in image
+*   @param  ncols - number of columns in image
+*   @param  pixels - nrows * ncols RGB565 colours, byte-swapped like the RGB565_* definitions*/
+void LCD_Draw_Image_RGB565(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint16_t *pixels);
+#endif
+
 /* Fill Buffer
 *   This function fills the image buffer with the desired colour
 *   @param  colour - Value from 0-15 referring to the colour map colour*/
 void LCD_Fill_Buffer(const uint8_t colour);
 
+// Longest label + value text a LCD_Text_Widget holds
+#ifndef LCD_WIDGET_TEXT_LENGTH
+#define LCD_WIDGET_TEXT_LENGTH 24
+#endif
+#if LCD_TEXT_OVERLAY
+// Words in one row of a widget's text strip: a bit per font column, 6 to a character
+#define LCD_WIDGET_STRIP_WORDS ((6 * LCD_WIDGET_TEXT_LENGTH + 31) / 32)
+#endif
+
+// A retained line of text showing a label and a number, e.g. "Score: 12". It is only redrawn
+// when the value changes or something cleared it, and survives LCD_Clear_Background. With
+// LCD_TEXT_OVERLAY it is laid over the image buffer as the rows are sent, on top of whatever is
+// drawn there.
+// Set x, y, colour, font_size and label, leave the rest zeroed.
+typedef struct LCD_Text_Widget {
+  uint16_t x, y;            // Top-left position
+  uint8_t colour;           // Value from 0-15 referring to the colour map colour
+  uint8_t font_size;        // Font scale, as for LCD_printString
+  const char* label;        // Text printed before the value
+  // Managed by the LCD
+  int32_t value;
+  uint8_t registered, stale;
+  uint16_t width, height;   // Area covered by the text on the screen
+  char text[LCD_WIDGET_TEXT_LENGTH];
+#if LCD_TEXT_OVERLAY
+  uint32_t strip[7][LCD_WIDGET_STRIP_WORDS];  // A bit per font pixel of the text, row by row
+#endif
+  struct LCD_Text_Widget* next;
+} LCD_Text_Widget;
+
+/* Clear to Background
+*   Clears the image buffer to a background colour, like LCD_Fill_Buffer(), but only erases
+*   what has been drawn since the buffer was last cleared to that colour. Only those parts
+*   are sent on the next refresh, and rows left empty are sent as a solid colour fill.
+*   Use it to clear at the start of each frame.
+*   @param  colour - Value from 0-15 referring to the colour map colour*/
+void LCD_Clear_Background(const uint8_t colour);
+
+/* Set Text Widget Value
+*   Shows label + value at the widget's position. The text is only formatted and drawn
+*   when the value changes, or when it has been cleared (LCD_Fill_Buffer, or a
+*   LCD_Clear_Background erasing something drawn over it), so it can be called every frame.
+*   With LCD_TEXT_OVERLAY, nothing is drawn: the text is rasterised (in the current font) into
+*   the widget's strip and the rows under it are marked for sending. A background refresh reads
+*   the strips, so a new value first waits for one that is running to finish.
+*   The widget must stay valid (e.g. static) once used.
+*   @param  widget - Text widget
+*   @param  value - Number to show after the label*/
+void LCD_Text_Widget_Set_Value(LCD_Text_Widget* widget, int32_t value);
+
+// A rectangle of retained drawing, e.g. a wall of bricks that only changes now and then.
+// Like a text widget it survives LCD_Clear_Background, and is marked stale when a clear
+// erases part of it. Set x, y, width and height, leave the rest zeroed.
+typedef struct LCD_Retained_Area {
+  uint16_t x, y;            // Top-left position
+  uint16_t width, height;   // Area covered on the screen
+  // Managed by the LCD
+  uint8_t registered, stale;
+  struct LCD_Retained_Area* next;
+} LCD_Retained_Area;
+
+/* Begin Retained Drawing
+*   Drawing until LCD_Retained_End() is retained: LCD_Clear_Background does not erase it,
+*   and only the pixels actually drawn are sent on the next refresh. Erase retained content
+*   by drawing background colour over it between Begin and End.
+*   The area must stay valid (e.g. static) once used.
+*   @param  area - Retained area about to be drawn in
+*   @returns - 1 if the area has been (partly) cleared since it was last drawn, or has never
+*              been drawn, so all of its content must be redrawn now*/
+uint8_t LCD_Retained_Begin(LCD_Retained_Area* area);
+
+/* End Retained Drawing
+*   Drawing after this is cleared by LCD_Clear_Background as normal.*/
+void LCD_Retained_End(void);
+
 /* Fill Screen
 *   This function directly writes to the LCD filling in a rectangle with a solid colour
 *   x0 must be < x1 and y0 must be < y1, function does no parameter checking
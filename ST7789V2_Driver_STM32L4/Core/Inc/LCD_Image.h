@@ -0,0 +1,91 @@
+/*
+Compressed full-colour images, decoded a row at a time.
+A 240x240 RGB565 image is 115KB, more than the RAM. Compressed, it is read from flash and
+decoded by LCD_Show_Image() (LCD.h) straight into the line buffers the refresh sends from,
+so it never needs an image buffer. Images are made from PNGs by Assets/make_asset_pack.py
+(--image), which can also put them in an asset pack.
+
+Format (little-endian): a header of magic (LCD_IMAGE_MAGIC), width, height and 0, 2 bytes
+each, then the rows top to bottom. Each row is a series of packets covering exactly its width.
+A packet is a byte, kind in the top two bits and count - 1 (1-64 pixels) in the rest:
+  LCD_IMAGE_LITERAL  count native RGB565 pixels follow, 2 bytes each
+  LCD_IMAGE_RUN      one native RGB565 pixel follows, repeated count times
+  LCD_IMAGE_UP       the count pixels above, unchanged (not on the first row)
+  LCD_IMAGE_DELTA    count bytes follow, each a pixel as a small change from the one before it
+                     in the row: red -4..3 in bits 7-5, green -4..3 in bits 4-2 and blue
+                     -2..1 in bits 1-0, each stored + 4, + 4 and + 2 (not first in a row)
+Runs of one colour and rows repeating the row above cost a byte per 64 pixels, and the
+smooth gradients of splash art about a byte a pixel.
+
+An image that is not in the address space (an asset pack on an external flash) is decoded from
+a window of RAM that a reader function keeps topped up (LCD_Image_Open_Stream()): before each
+row, the bytes not yet decoded move to the front and the reader fills the rest. A row is at most
+LCD_IMAGE_MAX_ROW_BYTES(width), so a window of two of them always holds the next whole row and
+each read is at least a row long.
+*/
+
+#ifndef LCD_Image_h
+#define LCD_Image_h
+
+#include <stdint.h>
+
+#define LCD_IMAGE_MAGIC 0x3149u  // "I1"
+#define LCD_IMAGE_HEADER_BYTES 8
+
+// Packet kinds, in the top two bits of the packet byte
+#define LCD_IMAGE_LITERAL 0x00u
+#define LCD_IMAGE_RUN     0x40u
+#define LCD_IMAGE_UP      0x80u
+#define LCD_IMAGE_DELTA   0xC0u
+#define LCD_IMAGE_MAX_COUNT 64
+
+// Most bytes a row of width pixels compresses to (all LITERAL packets), and the window for it
+#define LCD_IMAGE_MAX_ROW_BYTES(width) (2u * (width) + ((width) + LCD_IMAGE_MAX_COUNT - 1u) / LCD_IMAGE_MAX_COUNT)
+#define LCD_IMAGE_WINDOW_BYTES(width) (2u * LCD_IMAGE_MAX_ROW_BYTES(width))
+
+// Reads up to max more bytes of a compressed image into buffer; returns how many, 0 at the end
+typedef uint32_t (*LCD_Image_Reader)(void* context, uint8_t* buffer, uint32_t max);
+
+// Where decoding is up to
+typedef struct {
+  const uint8_t* data;
+  uint32_t length;
+  uint32_t pos;     // Next byte to read
+  uint16_t width, height;
+  uint16_t row;     // Next row to decode
+  LCD_Image_Reader reader;  // Streamed images: refills the window (data), NULL if all in memory
+  void* context;
+  uint8_t* window;
+  uint32_t window_bytes;
+} LCD_Image_Decoder;
+
+/* Open
+*   Checks the header and gets ready to decode the first row.
+*   @param  decoder - decoder to set up
+*   @param  image - compressed image
+*   @param  length - bytes of it
+*   @return 1 if the header is good, 0 if not*/
+uint8_t LCD_Image_Open(LCD_Image_Decoder* decoder, const uint8_t* image, const uint32_t length);
+
+/* Open Stream
+*   As LCD_Image_Open, for an image read a piece at a time by a reader function into a window.
+*   @param  decoder - decoder to set up
+*   @param  reader - gives the image's bytes in order, from the header on
+*   @param  context - passed to reader
+*   @param  window - RAM the image is decoded from; it must stay untouched until the last row
+*   @param  window_bytes - its size, at least LCD_IMAGE_MAX_ROW_BYTES(width) (better
+*                          LCD_IMAGE_WINDOW_BYTES(width))
+*   @return 1 if the header is good and the window big enough, 0 if not*/
+uint8_t LCD_Image_Open_Stream(LCD_Image_Decoder* decoder, LCD_Image_Reader reader, void* context,
+                              uint8_t* window, const uint32_t window_bytes);
+
+/* Decode Row
+*   Decodes the next row as native RGB565, ready to be sent to the panel.
+*   @param  decoder - decoder from LCD_Image_Open
+*   @param  out - width pixels
+*   @param  above - the row decoded before it (NULL for the first row)
+*   @return 1 if decoded, 0 if the data is damaged or cut short (out is then filled with black)
+*           or all rows have been decoded*/
+uint8_t LCD_Image_Decode_Row(LCD_Image_Decoder* decoder, uint16_t* out, const uint16_t* above);
+
+#endif
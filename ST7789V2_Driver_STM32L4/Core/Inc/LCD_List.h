@@ -0,0 +1,88 @@
+/*
+Display list used by LCD.c when LCD_DISPLAY_LIST is set.
+Drawing calls are recorded as commands (rect, circle, line, text, sprite) with a bounding box,
+and the refresh rasterises them a batch of rows at a time straight into the RGB565 line
+buffers, so no image buffer is needed and colours are not limited to the palette.
+The game keeps using the normal LCD_Draw_* functions; these are called by LCD.c.
+*/
+
+#ifndef LCD_List_h
+#define LCD_List_h
+
+#include "LCD.h"
+
+// Commands one frame can hold. Drawing past this is dropped (see LCD_List_Get_Dropped()).
+// Each command takes 24 bytes.
+#ifndef LCD_LIST_MAX_COMMANDS
+#define LCD_LIST_MAX_COMMANDS 160
+#endif
+#if LCD_LIST_MAX_COMMANDS > 255
+#error "LCD_LIST_MAX_COMMANDS must be at most 255"
+#endif
+
+// Characters of text one frame can hold, shared by all the text commands
+#ifndef LCD_LIST_TEXT_BYTES
+#define LCD_LIST_TEXT_BYTES 256
+#endif
+
+// Sprite colour meaning "use the sprite's own colours" rather than an override
+// (above any palette index, so every colour can still be an override)
+#define LCD_LIST_SPRITE_COLOURS 0x100
+
+// Colour of a command: a palette index (0-15, 0-255 with 8bpp), or LCD_LIST_RGB | an RGB565 colour
+// (byte-swapped like the RGB565_* definitions), which is drawn as is whatever the palette
+typedef uint32_t LCD_List_Colour;
+#define LCD_LIST_RGB 0x10000u
+
+/* Reset
+*   Empties the list, the frame then is plain background colour.
+*   @param  background - Palette index of the colour map colour*/
+void LCD_List_Reset(const uint8_t background);
+
+/* Set Clip
+*   Commands added from now on only draw inside x0..x1, y0..y1 (screen co-ordinates,
+*   inclusive; nothing if x0 > x1 or y0 > y1). Set by LCD.c from the clip rectangle.*/
+void LCD_List_Set_Clip(const int16_t x0, const int16_t y0, const int16_t x1, const int16_t y1);
+
+/* Add Commands
+*   Record one drawing call each, taking the same arguments as the LCD_Draw_* function
+*   and drawing the same pixels.
+*   Sprite and image data (and baked sprites) is referenced, not copied, so it must not change
+*   until the frame has been refreshed. Text is copied.*/
+void LCD_List_Add_Rect(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const LCD_List_Colour colour, const uint8_t fill);
+void LCD_List_Add_Circle(const uint16_t x0, const uint16_t y0, const uint16_t radius, const LCD_List_Colour colour, const uint8_t fill);
+void LCD_List_Add_Line(const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1, const LCD_List_Colour colour);
+void LCD_List_Add_Text(char const *str, const uint16_t x, const uint16_t y, const LCD_List_Colour colour, const uint8_t font_size);
+void LCD_List_Add_Sprite(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint16_t colour, const uint8_t scale);
+void LCD_List_Add_Baked_Sprite(const uint16_t x0, const uint16_t y0, const LCD_Sprite* sprite);
+void LCD_List_Add_Image(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint16_t *pixels);
+
+// Called by LCD_List_Present() for each row that has to be sent: columns x0..x1 changed,
+// and empty is 1 if the row is now plain background
+typedef void (*LCD_List_Row_Changed)(const uint16_t y, const uint8_t x0, const uint8_t x1, const uint8_t empty);
+
+/* Present
+*   Compares the commands covering each row with those of the frame last presented, and
+*   reports the rows that differ. A row only changes if a command on it was added, removed,
+*   moved or altered, or the background colour changed.
+*   @param  changed - Called for every row that changed*/
+void LCD_List_Present(LCD_List_Row_Changed changed);
+
+/* Render Rows
+*   Rasterises columns x0..x1 of rows y..y+rows-1 as native RGB565, one row after another,
+*   ready to be sent to the panel.
+*   @param  palette - The LCD_PALETTE_SIZE palette colours as native RGB565
+*   @param  out - rows * (x1 - x0 + 1) pixels*/
+void LCD_List_Render_Rows(const uint16_t y, const uint16_t rows, const uint16_t x0, const uint16_t x1, const uint16_t* palette, uint16_t* out);
+
+/* Get Count / Get Dropped
+*   Commands recorded this frame, and commands dropped since start-up because the list
+*   (or its text storage) was full.*/
+uint16_t LCD_List_Get_Count(void);
+uint32_t LCD_List_Get_Dropped(void);
+
+// Half-widths of each row of the small filled circles, defined in LCD.c so both draw them alike
+#define LCD_CIRCLE_TABLE_MAX_RADIUS 8
+extern const uint8_t circle_half_widths[LCD_CIRCLE_TABLE_MAX_RADIUS + 1][LCD_CIRCLE_TABLE_MAX_RADIUS + 1];
+
+#endif
@@ -34,8 +34,14 @@ Written by Aeron Jarvis with extremely minor modifications by James Avery
 #define ST7789_RAMRD   0x2E
 
 #define ST7789_PTLAR   0x30
+#define ST7789_VSCRDEF 0x33
+#define ST7789_TEOFF   0x34
+#define ST7789_TEON    0x35
 #define ST7789_COLMOD  0x3A
 #define ST7789_MADCTL  0x36
+#define ST7789_VSCSAD  0x37
+#define ST7789_IDMOFF  0x38
+#define ST7789_IDMON   0x39
 /**
  * Memory Data Access Control Register (0x36H)
  * MAP:     D7  D6  D5  D4  D3  D2  D1  D0
@@ -65,9 +71,74 @@ Written by Aeron Jarvis with extremely minor modifications by James Avery
 
 #define ST7789_ROTATION 2	
 
+// Visible panel size, which LCD.c and the game's court (Geometry.h) are sized from.
+// Can be set on the command line for another panel of the same controller.
+#ifndef ST7789V2_WIDTH
 #define ST7789V2_WIDTH 240
+#endif
 
+#ifndef ST7789V2_HEIGHT
 #define ST7789V2_HEIGHT 240
+#endif
+
+// Rows of panel frame memory. The glass shows the first ST7789V2_HEIGHT, the rest are never seen.
+#define ST7789V2_GRAM_HEIGHT 320
+
+// Set to 1 when linking the host backend (Host/ST7789V2_Host.c) instead of ST7789V2_Driver.c,
+// to run the LCD drawing layer on a PC against a software panel. LCD.c then touches no
+// peripherals of its own.
+#ifndef ST7789V2_HOST
+#define ST7789V2_HOST 0
+#endif
+
+// Set to 1 to run the hot drawing, refresh and SPI functions from RAM (the .RamFunc section,
+// copied from flash with .data at startup), avoiding flash wait states and cache misses.
+#ifndef ST7789V2_USE_RAMFUNC
+#define ST7789V2_USE_RAMFUNC 0
+#endif
+#if ST7789V2_USE_RAMFUNC
+#define ST7789V2_RAMFUNC __attribute__((section(".RamFunc"), noinline))
+#else
+#define ST7789V2_RAMFUNC
+#endif
+
+// Set to 1 to count what the driver sends in cfg->bus_stats: pixel and command bytes, address
+// windows, and the DWT cycles spent waiting for the SPI to go idle (a few adds per transfer)
+#ifndef ST7789V2_BUS_STATS
+#define ST7789V2_BUS_STATS 0
+#endif
+
+// Polls of an SPI or DMA status flag before a wait gives up and records
+// ST7789V2_FAULT_SPI_TIMEOUT, at the fastest divider; doubled for each slower one. A poll is a few
+// cycles and the SPI clock scales with the core's, so the default (about 0.2s at /2) is several
+// times the longest transfer, a 65535-pixel fill, at any divider and clock profile.
+#ifndef ST7789V2_SPIN_LIMIT
+#define ST7789V2_SPIN_LIMIT (1u << 21)
+#endif
+
+// Most items one DMA run can send (CNDTR is 16 bits). ST7789V2_Transfer_Start() sends longer
+// transfers as chunks of this many, each started from the previous one's transfer-complete
+// interrupt.
+#define ST7789V2_DMA_MAX_ITEMS 65535u
+
+// What ST7789V2_Transfer_Start() sends from its data
+#define ST7789V2_XFER_BYTES  0  // Bytes, one 8-bit frame each
+#define ST7789V2_XFER_PIXELS 1  // RGB565 pixels, one 16-bit frame each
+#define ST7789V2_XFER_FILL   2  // The pixel at data, over and over
+
+// Faults recorded in cfg->fault, until ST7789V2_Recover() clears them
+#define ST7789V2_FAULT_SPI_TIMEOUT 0x01  // A wait for the SPI or DMA ran out of polls
+#define ST7789V2_FAULT_DMA_ERROR   0x02  // The DMA channel flagged a transfer error (TEIF)
+#define ST7789V2_FAULT_STALLED     0x04  // A background refresh stopped moving (set by LCD.c)
+
+// SPI baud-rate divider settings (SCLK = APB1 clock / 2^(div+1)), see spi_baud_div
+#define ST7789V2_BAUD_DIV_2   0
+#define ST7789V2_BAUD_DIV_256 7
+
+// Divider used when reading back from the panel, its read cycle is much slower than writes
+#ifndef ST7789V2_READ_BAUD_DIV
+#define ST7789V2_READ_BAUD_DIV 6
+#endif
 
 #define GPIO_SET_LSB 0
 
@@ -95,36 +166,166 @@ typedef struct DMA_Channel_Struct {
    DMA_Channel_TypeDef *channel;
 } DMA_Channel_t;
 
+// Totals of what went to the panel since start-up (ST7789V2_BUS_STATS). They wrap, so take
+// differences between two reads for a frame's worth.
+typedef struct {
+   uint32_t pixel_bytes;      // Data bytes sent by DMA: pixels, fills and data blocks
+   uint32_t command_bytes;    // Command and parameter bytes, written by the CPU
+   uint32_t windows;          // ST7789V2_Set_Address_Window() calls
+   uint32_t window_commands;  // CASET/RASET those sent; the others were unchanged and skipped
+   uint32_t busy_cycles;      // DWT cycles spent waiting for the SPI to finish a transfer
+} ST7789V2_Bus_Stats_t;
+
+struct ST7789V2_cfg_struct;
+
+// Called from the DMA interrupt once the last chunk of a transfer has gone to the SPI (it may
+// still be shifting out the last frames). It may start the next transfer.
+typedef void (*ST7789V2_Transfer_Done)(struct ST7789V2_cfg_struct* cfg, void* context);
+
+// A transfer of more than one chunk, or with a completion callback, in flight (managed by the
+// driver)
+typedef struct {
+   const uint8_t* next;          // Data of the next chunk (the pixel itself for a fill)
+   volatile uint32_t remaining;  // Items in the chunks not started yet
+   uint8_t kind;                 // ST7789V2_XFER_x
+   volatile uint8_t busy;        // 1 from ST7789V2_Transfer_Start() until done is called
+   ST7789V2_Transfer_Done done;
+   void* context;
+} ST7789V2_Transfer_t;
+
 typedef struct ST7789V2_cfg_struct {
    uint8_t setup_done;
    SPI_TypeDef *spi;
    GPIO_Pin_t RST, BL, DC, CS, MOSI, SCLK;
+   GPIO_Pin_t TE;        // Optional tearing effect input, leave port NULL if not connected
    DMA_Channel_t dma;
+   uint8_t dma_tc_irq;   // 1 = raise the DMA transfer-complete interrupt at the end of each transfer
+   uint8_t spi_baud_div; // SCLK = APB1 clock / 2^(spi_baud_div+1), 0 (/2) to 7 (/256)
+   // Last address window sent, so unchanged CASET/RASET can be skipped (managed by the driver)
+   uint8_t window_valid;
+   uint16_t window_x0, window_y0, window_x1, window_y1;
+#if ST7789V2_BUS_STATS
+   ST7789V2_Bus_Stats_t bus_stats;  // Updated by the driver, from the LCD DMA interrupt too
+#endif
+   // ST7789V2_FAULT_x seen since the last recovery. Once set, waits give up at once, so drawing
+   // carries on (showing nothing new) until the caller sees it and calls ST7789V2_Recover().
+   volatile uint8_t fault;
+   ST7789V2_Transfer_t transfer;
+   // Progress through the power-up sequence (managed by the driver)
+   uint8_t init_step;
+   uint16_t init_wait_ms;
+   uint32_t init_wait_from;
 } ST7789V2_cfg_t;
 
+// Powers up and configures the panel, busy-waiting through the reset and sleep-out delays
+// (about 300ms).
 void ST7789V2_Init(ST7789V2_cfg_t* cfg);
 
+// The same power-up, without blocking: ST7789V2_Init_Start() sets up the pins and peripherals and
+// starts the reset, then ST7789V2_Init_Poll() sends each following step once the panel's wait
+// after the previous one is over, and returns 1 when the panel is ready. now_ms is any
+// millisecond clock, e.g. HAL_GetTick(). Nothing else may be sent to the panel until then.
+void ST7789V2_Init_Start(ST7789V2_cfg_t* cfg, uint32_t now_ms);
+uint8_t ST7789V2_Init_Poll(ST7789V2_cfg_t* cfg, uint32_t now_ms);
+
 void ST7789V2_Reset(ST7789V2_cfg_t* cfg);
 
 void ST7789V2_Send_Command(ST7789V2_cfg_t* cfg, uint8_t command);
 
+// Sends a command followed by its n parameter bytes as a single transaction (one CS assertion).
+void ST7789V2_Send_Command_With_Params(ST7789V2_cfg_t* cfg, uint8_t command, const uint8_t* params, uint8_t n);
+
 void ST7789V2_Send_Data(ST7789V2_cfg_t* cfg, uint8_t data);
 
 void ST7789V2_Send_Data_Block(ST7789V2_cfg_t* cfg, uint8_t* data, uint32_t length);
 
+// Sends RGB565 pixels using 16-bit SPI frames, so colours are in native (not byte-swapped) order.
+void ST7789V2_Send_Pixels(ST7789V2_cfg_t* cfg, uint16_t* pixels, uint16_t count);
+
 void ST7789V2_Set_Address_Window(ST7789V2_cfg_t* cfg, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
 
 void ST7789V2_BL_On(ST7789V2_cfg_t* cfg);
 
 void ST7789V2_BL_Off(ST7789V2_cfg_t* cfg);
 
+// Sends RAMWR, then the pixel at colour len times, in chunks if it is more than
+// ST7789V2_DMA_MAX_ITEMS. Returns once the first chunk has started.
 void ST7789V2_Fill(ST7789V2_cfg_t* cfg, uint16_t* colour, uint32_t len);
 
+// Sends count items of data (DC high, after a command such as RAMWR) by DMA and returns at once.
+// Beyond ST7789V2_DMA_MAX_ITEMS the transfer goes as several chunks, each started from the
+// interrupt at the end of the one before by ST7789V2_Transfer_Next(), with CS held low
+// throughout; the next driver call that sends anything waits for the last. done (if not NULL)
+// is called from that interrupt when the last chunk has gone, and not at all if the transfer
+// is aborted by a fault. data must stay unchanged until then. Both need the display's DMA
+// interrupt calling ST7789V2_Transfer_Next(), as LCD_DMA_IRQHandler() does.
+void ST7789V2_Transfer_Start(ST7789V2_cfg_t* cfg, const void* data, uint32_t count, uint8_t kind,
+                             ST7789V2_Transfer_Done done, void* context);
+
+// Call from the DMA interrupt once ST7789V2_DMA_TC_Clear() reports a transfer complete. Starts
+// the next chunk of a chunked transfer and returns 1, the interrupt is then the driver's alone.
+// Otherwise calls the transfer's done (if any) and returns 0: what was sent has all gone.
+uint8_t ST7789V2_Transfer_Next(ST7789V2_cfg_t* cfg);
+
+// Changes the SPI clock divider (0 to 7) and stores it in cfg->spi_baud_div.
+void ST7789V2_Set_Baud_Div(ST7789V2_cfg_t* cfg, uint8_t baud_div);
+
+// Writes a test pattern to the top-left pixels using the given divider, reads it back at
+// ST7789V2_READ_BAUD_DIV and returns 1 if it matched. Leaves the SPI at the given divider.
+uint8_t ST7789V2_Test_Baud(ST7789V2_cfg_t* cfg, uint8_t baud_div);
+
+// Reads the window x0, y0 to x1, y1 back from the panel memory (RAMRD) at
+// ST7789V2_READ_BAUD_DIV into pixels, one per pixel of the window, as the native RGB565 sent.
+// The panel keeps 18-bit colour, which is cut back to 5-6-5 bits. Blocks until all have been
+// read, then leaves the SPI at cfg->spi_baud_div.
+void ST7789V2_Read_Pixels(ST7789V2_cfg_t* cfg, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t* pixels);
+
+// Defines the vertical scroll area (VSCRDEF): top_fixed rows at the top and bottom_fixed at the
+// bottom of the screen stay put, the rows between scroll. The frame memory rows below the
+// glass are added to the bottom fixed area, so the scroll wraps within the visible rows.
+void ST7789V2_Set_Scroll_Area(ST7789V2_cfg_t* cfg, uint16_t top_fixed, uint16_t bottom_fixed);
+
+// Sets the frame memory row shown at the top of the scroll area (VSCSAD), from top_fixed to
+// top_fixed + scroll rows - 1. The rows after it follow, wrapping round the scroll area.
+void ST7789V2_Set_Scroll_Start(ST7789V2_cfg_t* cfg, uint16_t row);
+
+// Partial mode on (PTLAR with rows start..end, then PTLON) or off (NORON). In partial mode only
+// those rows are driven, the rest of the panel is black. Either way ends any vertical scrolling.
+void ST7789V2_Set_Partial_Mode(ST7789V2_cfg_t* cfg, uint8_t on, uint16_t start, uint16_t end);
+
+// Idle mode on (IDMON) or off (IDMOFF). In idle mode the panel shows 8 colours, the top bit of
+// each of red, green and blue, and draws less power.
+void ST7789V2_Set_Idle_Mode(ST7789V2_cfg_t* cfg, uint8_t on);
+
+// Checks and clears the transfer-complete flag of the display's DMA channel.
+// Returns 1 if a transfer had completed. Call from the channel's IRQ handler.
+uint8_t ST7789V2_DMA_TC_Clear(ST7789V2_cfg_t* cfg);
+
+// Checks for a transfer error on the display's DMA channel. If there was one, stops the channel,
+// records ST7789V2_FAULT_DMA_ERROR and returns 1. Call from the channel's IRQ handler, which
+// transfer errors always raise.
+uint8_t ST7789V2_DMA_Error_Clear(ST7789V2_cfg_t* cfg);
+
+// Stops the display's DMA channel, with its interrupts, and deasserts CS. The transfer in
+// flight is lost, with any chunks still to go.
+void ST7789V2_DMA_Abort(ST7789V2_cfg_t* cfg);
+
+// Gets a faulted display going again: stops the DMA, resets the SPI peripheral, clears
+// cfg->fault and runs the whole blocking power-up (ST7789V2_Init(), about 300ms). The panel comes
+// back blank, with no scroll area and in normal mode, and the SPI at cfg->spi_baud_div.
+void ST7789V2_Recover(ST7789V2_cfg_t* cfg);
+
+// Checks and clears the EXTI pending flag of the TE pin, which rises at the start of each
+// panel vertical blank. Returns 1 if it was set. Call from the pin's EXTI IRQ handler.
+uint8_t ST7789V2_TE_Clear(ST7789V2_cfg_t* cfg);
+
 
 void gpio_init(ST7789V2_cfg_t* cfg);
 void spi_init(ST7789V2_cfg_t* cfg);
 void dma_init(ST7789V2_cfg_t* cfg);
+void te_init(ST7789V2_cfg_t* cfg);
 void spi_transmit_byte(ST7789V2_cfg_t* cfg, uint8_t data);
+void spi_transmit_bytes(ST7789V2_cfg_t* cfg, const uint8_t* data, uint8_t len);
 void spi_transmit_dma_8bit(ST7789V2_cfg_t* cfg, uint8_t* data, uint16_t len);
 void spi_transmit_dma_16bit(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len);
 void spi_transmit_dma_16bit_noinc(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len);
@@ -0,0 +1,64 @@
+/*
+Transaction queue for the ST7789V2 driver, used by LCD.c for LCD_RefreshAsync().
+Commands, address windows and pixel transfers are queued in one go and then run back to back:
+every command and window ahead of a transfer is sent (DC low for the command byte, high for
+its parameters) and the transfer started, and the DMA transfer-complete interrupt moves on to
+the next, so the CPU only takes part once per transfer.
+Runs on top of the public driver functions, so it works the same with the host backend.
+*/
+
+#ifndef ST7789V2_Queue_h
+#define ST7789V2_Queue_h
+
+#include "ST7789V2_Driver.h"
+
+// Transactions a queue holds, a power of 2 of at most 128
+#ifndef ST7789V2_QUEUE_LENGTH
+#define ST7789V2_QUEUE_LENGTH 16
+#endif
+#if ST7789V2_QUEUE_LENGTH > 128 || (ST7789V2_QUEUE_LENGTH & (ST7789V2_QUEUE_LENGTH - 1))
+#error "ST7789V2_QUEUE_LENGTH must be a power of 2 of at most 128"
+#endif
+
+typedef enum {
+  ST7789V2_TXN_COMMAND,  // command, followed by n_params parameter bytes
+  ST7789V2_TXN_WINDOW,   // address window x0..x1, y0..y1 (CASET/RASET only if it changed)
+  ST7789V2_TXN_PIXELS,   // RAMWR, then count pixels from pixels by DMA
+  ST7789V2_TXN_FILL      // RAMWR, then pixels[0] count times by DMA
+} ST7789V2_Txn_Type;
+
+typedef struct {
+  uint8_t type;          // ST7789V2_Txn_Type
+  uint8_t command;
+  uint8_t n_params;
+  uint8_t params[4];
+  uint16_t x0, y0, x1, y1;
+  uint16_t* pixels;      // Must stay unchanged until the transfer has completed
+  uint16_t count;
+} ST7789V2_Transaction;
+
+typedef struct {
+  ST7789V2_Transaction entries[ST7789V2_QUEUE_LENGTH];
+  volatile uint8_t head;     // Next transaction to run (the one in flight while running)
+  volatile uint8_t tail;     // Where the next one is added
+  volatile uint8_t running;  // 1 while a pixel transfer is in flight
+} ST7789V2_Queue_t;
+
+// Adds a transaction to the end of the queue, returns 0 (and adds nothing) if it is full.
+// Only add from one context at a time: before ST7789V2_Queue_Run(), or from the interrupt
+// that calls ST7789V2_Queue_Transfer_Done().
+uint8_t ST7789V2_Queue_Push(ST7789V2_Queue_t* queue, const ST7789V2_Transaction* txn);
+
+// Number of transactions that can still be added
+uint8_t ST7789V2_Queue_Space(const ST7789V2_Queue_t* queue);
+
+// Sends the queued commands and windows up to the next pixel transfer and starts it, with the
+// transfer-complete interrupt enabled. Does nothing while a transfer is in flight.
+void ST7789V2_Queue_Run(ST7789V2_cfg_t* cfg, ST7789V2_Queue_t* queue);
+
+// Call from the DMA interrupt once ST7789V2_DMA_TC_Clear() reports the transfer in flight has
+// completed: drops it from the queue and runs on to the next. The interrupt is disabled again
+// once the queue is empty.
+void ST7789V2_Queue_Transfer_Done(ST7789V2_cfg_t* cfg, ST7789V2_Queue_t* queue);
+
+#endif
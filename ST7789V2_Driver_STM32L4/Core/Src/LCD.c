@@ -1,10 +1,140 @@
 #include "LCD.h"
+#include "LCD_List.h"
+#include "LCD_Image.h"
+#include "ST7789V2_Queue.h"
+#include <string.h>
 
 
-// Image buffer storing pixel data, 4 pixels per byte (2 bits per pixel)
-static uint8_t image_buffer[BUFFER_LENGTH];
-// Tracks which rows have changed and need to be refreshed, this speeds up LCD_Refresh by only sending data for those rows
-static uint8_t track_changes[ST7789V2_HEIGHT]; 
+#if LCD_DOUBLE_BUFFER
+#define LCD_NUM_BUFFERS 2
+#else
+#define LCD_NUM_BUFFERS 1
+#endif
+
+// Bytes of image buffer per row, and the byte holding pixel (x, y)
+#define ROW_BYTES (ST7789V2_WIDTH / LCD_PIXELS_PER_BYTE)
+#define PIXEL_BYTE(x, y) ((ST7789V2_WIDTH * (y) + (x)) >> (LCD_PIXELS_PER_BYTE - 1))
+
+// A byte of image buffer with every pixel in it set to colour
+#if LCD_BITS_PER_PIXEL == 8
+#define FILL_BYTE(colour) (colour)
+#else
+#define FILL_BYTE(colour) ((colour) | ((colour) << 4))
+#endif
+
+#if !LCD_DISPLAY_LIST
+// Image buffer storing pixel data, 2 pixels per byte (4 bits per pixel), or one per byte with 8bpp
+// With LCD_DOUBLE_BUFFER there are two: drawing goes to the back buffer (image_buffer)
+// while LCD_Refresh reads the front buffer (refresh_buffer).
+// With LCD_DISPLAY_LIST there is none, drawing is recorded by LCD_List.c instead.
+// A second display (LCD_MAX_DISPLAYS) has its own, placed by LCD_FRAMEBUFFER1_ATTR.
+static uint8_t image_buffers0[LCD_NUM_BUFFERS][BUFFER_LENGTH] LCD_FRAMEBUFFER_ATTR __attribute__((aligned(4)));
+#if LCD_MAX_DISPLAYS > 1
+static uint8_t image_buffers1[LCD_NUM_BUFFERS][BUFFER_LENGTH] LCD_FRAMEBUFFER1_ATTR __attribute__((aligned(4)));
+#endif
+// The DMA clears whole buffers a word at a time, so a back buffer has to start word aligned too
+_Static_assert((BUFFER_LENGTH) % 4 == 0, "image buffers must be a whole number of words");
+
+// memset for the image buffer. newlib-nano's memset is built for size and stores a byte at a
+// time; this stores the byte repeated in all four lanes of a word, four words per loop, with
+// byte stores only for the up to 3 bytes either side of the aligned middle.
+static ST7789V2_RAMFUNC void fill_bytes(uint8_t* dst, const uint8_t value, uint32_t length) {
+  // Head: bytes up to the next word boundary (written out, so it is not turned back into memset)
+  if (length && ((uintptr_t)dst & 1)) { *dst++ = value; length--; }
+  if (length >= 2 && ((uintptr_t)dst & 2)) { dst[0] = value; dst[1] = value; dst += 2; length -= 2; }
+  const uint32_t word = value * 0x01010101u;
+  uint32_t* words = (uint32_t*)dst;
+  for (; length >= 16; length -= 16) {
+    words[0] = word;
+    words[1] = word;
+    words[2] = word;
+    words[3] = word;
+    words += 4;
+  }
+  for (; length >= 4; length -= 4) {
+    *words++ = word;
+  }
+  dst = (uint8_t*)words;
+  if (length & 2) { dst[0] = value; dst[1] = value; dst += 2; }
+  if (length & 1) { *dst = value; }
+}
+#endif
+
+#if LCD_DMA_CLEAR && !LCD_DISPLAY_LIST
+// LCD_Fill_Buffer's clear runs as a DMA2 memory-to-memory transfer of this word, read over
+// and over (no source increment) into the image buffer a word at a time
+static uint32_t clear_pattern;
+static volatile uint8_t clear_running = 0;
+#define CLEAR_FLAG_SHIFT (4u * (((uint32_t)LCD_DMA_CLEAR_CHANNEL - DMA2_Channel1_BASE) / (DMA2_Channel2_BASE - DMA2_Channel1_BASE)))
+
+// Waits for the clear to finish. Called before anything reads or writes the image buffer.
+static inline void clear_wait(void) {
+  if (!clear_running) {
+    return;
+  }
+#if !ST7789V2_HOST
+  while (!(DMA2->ISR & ((DMA_ISR_TCIF1 | DMA_ISR_TEIF1) << CLEAR_FLAG_SHIFT)));
+  LCD_DMA_CLEAR_CHANNEL->CCR = 0;
+  DMA2->IFCR = DMA_IFCR_CGIF1 << CLEAR_FLAG_SHIFT;
+#endif
+  clear_running = 0;
+}
+
+// Starts setting length bytes (a multiple of 4) at the word aligned dst to value
+static void clear_start(uint8_t* dst, const uint8_t value, const uint32_t length) {
+  clear_wait();
+#if ST7789V2_HOST
+  // No DMA on the host, clear straight away
+  fill_bytes(dst, value, length);
+#else
+  clear_pattern = value * 0x01010101u;
+  RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+  // With MEM2MEM and DIR clear, CPAR is the source and CMAR the destination
+  LCD_DMA_CLEAR_CHANNEL->CCR = 0;
+  LCD_DMA_CLEAR_CHANNEL->CPAR = (uint32_t)&clear_pattern;
+  LCD_DMA_CLEAR_CHANNEL->CMAR = (uint32_t)dst;
+  LCD_DMA_CLEAR_CHANNEL->CNDTR = length / 4;
+  LCD_DMA_CLEAR_CHANNEL->CCR = DMA_CCR_MEM2MEM | DMA_CCR_MINC | DMA_CCR_PSIZE_1 | DMA_CCR_MSIZE_1 | DMA_CCR_EN;
+  clear_running = 1;
+#endif
+}
+#else
+static inline void clear_wait(void) {
+}
+#endif
+
+// Tracks which part of each row has changed and needs to be refreshed. Each row stores the
+// leftmost (x0) and rightmost (x1) changed pixel, so LCD_Refresh only sends that span of the row.
+// A row with x0 > x1 is unchanged and is skipped entirely.
+// Drawing marks track_changes, LCD_Refresh consumes refresh_changes. These are the same
+// array unless LCD_DOUBLE_BUFFER is enabled, where each follows its image buffer.
+#if ST7789V2_WIDTH > 256
+#error "Row spans keep columns in bytes, so ST7789V2_WIDTH must be at most 256"
+#endif
+#if LCD_BITS_PER_PIXEL == 4 && (ST7789V2_WIDTH % 2) != 0
+#error "At 4bpp a row must be a whole number of bytes: an odd ST7789V2_WIDTH needs LCD_BITS_PER_PIXEL 8"
+#endif
+typedef struct {
+  uint8_t x0;
+  uint8_t x1;
+  // 1 + colour if the whole row is that background colour, otherwise 0
+#if LCD_BITS_PER_PIXEL == 8
+  uint16_t solid;
+#else
+  uint8_t solid;
+#endif
+} LCD_Dirty_Span;
+
+static inline void mark_span_clean(LCD_Dirty_Span* span) {
+  span->x0 = 0xFF;
+  span->x1 = 0;
+  span->solid = 0;
+}
+
+static inline void widen_span(LCD_Dirty_Span* span, const uint16_t x0, const uint16_t x1) {
+  if (x0 < span->x0) span->x0 = x0;
+  if (x1 > span->x1) span->x1 = x1;
+}
 
 // Define multiple palettes. These must be kept in sync with the LCD_Palette enum
 // and the LCD_Set_Palette function
@@ -33,15 +163,517 @@ static const uint16_t palette_vintage[16] = {
 static const uint16_t palette_custom[16] = {
     RGB565_BLACK, RGB565_MINT, RGB565_GREEN_BRIGHT, RGB565_LAVENDER,
     RGB565_APRICOT, RGB565_TEAL, RGB565_LIME_BRIGHT, RGB565_SKY_BLUE,
-    RGB565_BEIGE , RGB565_SKY_BLUE, RGB565_CYAN, RGB565_VINTAGE_6,
-    RGB565_PINK_BRIGHT, RGB565_CYAN_BRIGHT, RGB565_TEAL_BRIGHT, RGB565_CYAN_BRIGHT
+    RGB565_BEIGE, RGB565_BLUE_BRIGHT, RGB565_CYAN, RGB565_VINTAGE_6,
+    RGB565_PINK_BRIGHT, RGB565_CYAN_BRIGHT, RGB565_TEAL_BRIGHT, RGB565_MAGENTA_BRIGHT
+};
+
+// Two ping-pong line buffers per display, each big enough for a batch of LCD_MAX_LINES_PER_BATCH
+// rows. Word aligned, as the expansion stores two pixels at a time.
+static uint16_t line_buffers[LCD_MAX_DISPLAYS][2][LCD_MAX_LINES_PER_BATCH*ST7789V2_WIDTH] LCD_LINE_BUFFER_ATTR __attribute__((aligned(4))); // 240 * 2 Bytes * n rows
+_Static_assert((LCD_MAX_LINES_PER_BATCH * ST7789V2_WIDTH) % 2 == 0,
+               "an odd LCD_MAX_LINES_PER_BATCH * ST7789V2_WIDTH leaves the second line buffer unaligned");
+
+#if LCD_ROW_CACHE_ROWS
+// A whole row expanded to RGB565, and what it was expanded from
+typedef struct {
+  uint16_t pixels[ST7789V2_WIDTH];
+  uint32_t hash;             // row_crc() of the image buffer row
+  uint32_t palette;          // Palette generation of the display it was expanded with
+#if LCD_PALETTE_ROW_MASKS
+  uint16_t colours;          // Colours on the row, for shown_colours
+#endif
+  uint32_t used;             // When it was last sent, to find the least recently used
+  uint8_t valid;
+  volatile uint8_t sending;  // Queued batches sending from it, which it mustn't be replaced under
+} LCD_Cached_Row;
+
+static LCD_Cached_Row row_caches[LCD_MAX_DISPLAYS][LCD_ROW_CACHE_ROWS] LCD_LINE_BUFFER_ATTR __attribute__((aligned(4)));
+#endif
+
+// A batch of contiguous dirty rows that has been expanded into a line buffer and is
+// waiting to be sent with a single address window
+typedef struct {
+  int16_t y;             // First row of the batch, or -1 if there are no more dirty rows
+  uint16_t rows;         // Number of rows in the batch
+  uint16_t x0, x1;       // Column span sent for every row of the batch (whole bytes)
+  uint16_t* line_buffer; // Line buffer holding the RGB565 pixels
+  uint8_t solid;         // 1 if every pixel is line_buffer[0] and is sent as a fill
+  // Used by LCD_RefreshAsync(): the fill colour, kept here as the line buffer it was
+  // expanded into may be reused before the fill is sent, and the line buffer held (or -1)
+  uint16_t fill;
+  int8_t buffer;
+#if LCD_ROW_CACHE_ROWS
+  LCD_Cached_Row* cached;  // The cached row line_buffer points into, or NULL
+#endif
+} LCD_Pending_Batch;
+
+// Batches LCD_RefreshAsync() keeps queued. Pixel batches are limited by the two line buffers,
+// but any number of fills can be queued up behind them.
+#define ASYNC_BATCHES (ST7789V2_QUEUE_LENGTH / 2)
+
+// State of an LCD_RefreshAsync() transfer
+typedef struct {
+  ST7789V2_cfg_t* cfg;
+  LCD_Refresh_Callback callback;
+  LCD_Pending_Batch batches[ASYNC_BATCHES];  // Queued batches, oldest (the one sending) at first
+  uint8_t first;
+  uint8_t queued;
+  int16_t next_row;          // First row not looked at yet
+  uint8_t buffer_busy[2];    // Line buffers holding a queued batch
+  volatile uint8_t busy;
+  volatile uint8_t wait_te;  // 1 while the refresh is waiting for the next TE pulse to start
+} LCD_Async_Refresh;
+
+// Drawing origin and clip rectangle, in screen co-ordinates (inclusive, empty when x0 > x1)
+typedef struct {
+  int16_t origin_x, origin_y;     // Where the viewport's 0, 0 is on the screen
+  int16_t x0, y0, x1, y1;         // Viewport bounds, the clip rectangle stays inside them
+  int16_t clip_x0, clip_y0, clip_x1, clip_y1;
+} LCD_View;
+
+// The whole screen, no offset
+#define SCREEN_VIEW { 0, 0, 0, 0, ST7789V2_WIDTH - 1, ST7789V2_HEIGHT - 1, \
+                      0, 0, ST7789V2_WIDTH - 1, ST7789V2_HEIGHT - 1 }
+static const LCD_View screen_view = SCREEN_VIEW;
+
+// Everything kept for one panel. Displays are bound to their cfg by LCD_init()/LCD_Init_Start(),
+// drawing goes to the selected one and refreshes use the one bound to the cfg they are given,
+// so two panels on different SPIs and DMA channels can be refreshed at the same time.
+typedef struct {
+  ST7789V2_cfg_t* cfg;  // Panel the display is bound to, NULL until then
+#if !LCD_DISPLAY_LIST
+  uint8_t (*image_buffers)[BUFFER_LENGTH];  // LCD_NUM_BUFFERS of them
+  uint8_t* image_buffer;
+  uint8_t* refresh_buffer;
+#endif
+  LCD_Dirty_Span span_buffers[LCD_NUM_BUFFERS][ST7789V2_HEIGHT];
+  LCD_Dirty_Span* track_changes;
+  LCD_Dirty_Span* refresh_changes;
+
+  // Background colour of the draw buffer and, per row, the span drawn over it since it was
+  // last cleared by LCD_Fill_Buffer or LCD_Clear_Background. Everything outside these spans is
+  // background, so LCD_Clear_Background only has to erase (and resend) what was drawn.
+  uint8_t background;
+  LCD_Dirty_Span drawn[ST7789V2_HEIGHT];
+#if !LCD_DISPLAY_LIST
+  // Per row, 1 + the background colour if the draw buffer row holds nothing else outside its
+  // drawn span, 0 once retained drawing has touched it. A row that is then not drawn on is a
+  // single colour, and is sent as a fill however it was marked dirty.
+#if LCD_BITS_PER_PIXEL == 8
+  uint16_t row_colour[ST7789V2_HEIGHT];
+#else
+  uint8_t row_colour[ST7789V2_HEIGHT];
+#endif
+#endif
+
+  // Set while a text widget or retained area draws. Its pixels are retained: they are not
+  // recorded in drawn, so LCD_Clear_Background leaves them on the screen
+  uint8_t retained_drawing;
+
+  // Text widgets and retained areas that have been drawn, so clears that touch them can mark
+  // them for a redraw
+  LCD_Text_Widget* widgets;
+  LCD_Retained_Area* retained_areas;
+#if LCD_TEXT_OVERLAY
+  // A bit per row with a widget's text on it, composited in as the row is sent, so the row
+  // can't go as a fill
+  uint32_t overlay_rows[(ST7789V2_HEIGHT + 31) / 32];
+#endif
+
+  // Current viewport and clip rectangle, and those pushed below it
+  LCD_View view;
+  LCD_View view_stack[LCD_VIEWPORT_DEPTH];
+  uint8_t view_depth;
+
+#if LCD_FRAME_DIFF
+  // CRC of each row as the panel currently shows it, so dirty rows whose pixels came out the
+  // same as last time (e.g. cleared and redrawn in place) are not sent again
+  uint32_t shown_crc[ST7789V2_HEIGHT];
+  uint8_t shown_crc_valid[ST7789V2_HEIGHT];  // 0 until the row has been sent once
+#endif
+
+  // Active palette (defaults to palette_default), and the RAM copy it points to once a
+  // colour has been changed on its own (LCD_Set_Palette_Colour(), LCD_Cycle_Palette())
+  const uint16_t* colour_map;
+  uint16_t own_colours[16];
+#if LCD_PALETTE_ROW_MASKS
+  // Per row, a bit for each colour the panel may show on it (8bpp: by the low 4 bits), so a
+  // palette change only resends the rows using the colours it changed. Worked out as rows are
+  // sent; a row sent in part only gains colours.
+  uint16_t shown_colours[ST7789V2_HEIGHT];
+#endif
+#if LCD_DISPLAY_LIST || LCD_BITS_PER_PIXEL == 8
+  // Active palette as native RGB565, for expanding the colour indices the list rasterises or
+  // the 8bpp image buffer holds. Rebuilt whenever the palette changes, see build_pair_map().
+  uint16_t palette_native[LCD_PALETTE_SIZE];
+#else
+  // Active palette expanded to every possible byte of image_buffer: entry b holds the two RGB565
+  // pixels for byte b, low nibble (left pixel) in the low half, ready to store as one 32-bit word.
+  // Rebuilt whenever the palette changes, see build_pair_map().
+  uint32_t pair_map[256];
+#endif
+#if LCD_ROW_CACHE_ROWS
+  // Changed with every change of palette, so rows cached with the old one aren't used
+  uint32_t palette_generation;
+  // Rows kept expanded, the count of rows sent from it (the clock of their used stamps), and
+  // per row the hash of the pixels it was last sent with
+  LCD_Cached_Row* row_cache;
+  uint32_t row_cache_clock;
+  uint32_t sent_hash[ST7789V2_HEIGHT];
+#endif
+
+  // 1 if the panel's TE pin paces background refreshes, and the number of TE pulses (panel
+  // refreshes) seen
+  uint8_t te;
+  volatile uint32_t te_count;
+
+  // Started by LCD_Init_Start(), power-up not yet finished by LCD_Init_Poll()
+  uint8_t init_pending;
+
+  // Hardware scroll area set by LCD_Set_Scroll_Area(), the whole screen until then
+  uint16_t scroll_top;
+  uint16_t scroll_rows;
+
+  // Rows the panel drives, set by the partial power profiles. Refreshes skip the others.
+  uint16_t active_y0;
+  uint16_t active_y1;
+
+  uint16_t* line_buffers[2];
+  // Number of rows merged into one transfer, set by LCD_Set_Lines_Per_Batch()
+  uint16_t lines_per_batch;
+
+  // State of an LCD_RefreshAsync() transfer, shared with the DMA interrupt. Its batches are
+  // queued as transactions (window, then pixels or fill) in refresh_queue, and are sent in order.
+  LCD_Async_Refresh refresh_async;
+  ST7789V2_Queue_t refresh_queue;
+
+  // Rows watched by LCD_Set_Row_Watch(), shared with the DMA interrupt
+  struct {
+    int16_t y0, y1;
+    LCD_Refresh_Callback callback;
+    uint8_t seen;  // A batch covering the rows has been sent this refresh
+    uint8_t done;  // The callback has run this refresh
+  } row_watch;
+
+  // What the refreshes have sent, for LCD_Get_Refresh_Stats(); batches are counted as they
+  // are prepared, in the DMA interrupt for a background refresh
+  LCD_Refresh_Stats stats;
+} LCD_Display;
+
+#if LCD_DISPLAY_LIST
+#define DISPLAY_BUFFERS(n)
+#else
+#define DISPLAY_BUFFERS(n) \
+  .image_buffers = image_buffers##n, .image_buffer = image_buffers##n[0], .refresh_buffer = image_buffers##n[0],
+#endif
+#if LCD_ROW_CACHE_ROWS
+#define DISPLAY_ROW_CACHE(n) .row_cache = row_caches[n],
+#else
+#define DISPLAY_ROW_CACHE(n)
+#endif
+#define DISPLAY_DEFAULTS(n) { \
+  DISPLAY_BUFFERS(n) \
+  DISPLAY_ROW_CACHE(n) \
+  .track_changes = displays[n].span_buffers[0], .refresh_changes = displays[n].span_buffers[0], \
+  .colour_map = palette_default, \
+  .view = SCREEN_VIEW, \
+  .scroll_rows = ST7789V2_HEIGHT, .active_y1 = ST7789V2_HEIGHT - 1, \
+  .line_buffers = { line_buffers[n][0], line_buffers[n][1] }, \
+  .lines_per_batch = LCD_MAX_LINES_PER_BATCH }
+
+static LCD_Display displays[LCD_MAX_DISPLAYS] = {
+  DISPLAY_DEFAULTS(0),
+#if LCD_MAX_DISPLAYS > 1
+  DISPLAY_DEFAULTS(1),
+#endif
 };
 
-// Active palette pointer (defaults to palette_default)
-static const uint16_t *colour_map = palette_default;
+#if LCD_MAX_DISPLAYS > 1
+// Display the drawing functions draw into, set by LCD_Select_Display()
+static LCD_Display* selected = &displays[0];
+#else
+// The only display, a constant so drawing reaches its buffers at fixed addresses
+#define selected (&displays[0])
+#endif
+
+// The display bound to cfg. An unknown cfg is bound to the first free display, or shares the
+// last one if there is none.
+static LCD_Display* display_for(ST7789V2_cfg_t* cfg) {
+  for (int i = 0; i < LCD_MAX_DISPLAYS; i++) {
+    if (displays[i].cfg == cfg || displays[i].cfg == NULL) {
+      displays[i].cfg = cfg;
+      return &displays[i];
+    }
+  }
+  return &displays[LCD_MAX_DISPLAYS - 1];
+}
+
+static void refresh_wait(LCD_Display* display);
+
+static inline void mark_span_dirty(const uint16_t y, const uint16_t x0, const uint16_t x1) {
+  widen_span(&selected->track_changes[y], x0, x1);
+  selected->track_changes[y].solid = 0;
+  if (!selected->retained_drawing) {
+    widen_span(&selected->drawn[y], x0, x1);
+  }
+#if !LCD_DISPLAY_LIST
+  else {
+    selected->row_colour[y] = 0;
+  }
+#endif
+}
+
+#if !LCD_DISPLAY_LIST
+// Marks the widgets and retained areas overlapping the span x0..x1 of row y (all of them if
+// y is negative) as needing a redraw, as the span is about to be cleared
+static void widgets_cleared(const int16_t y, const uint16_t x0, const uint16_t x1) {
+#if !LCD_TEXT_OVERLAY  // Overlaid text is not in the image buffer, clears leave it be
+  for (LCD_Text_Widget* widget = selected->widgets; widget; widget = widget->next) {
+    if (y < 0 || (y >= widget->y && y < widget->y + widget->height &&
+                  x1 >= widget->x && x0 < widget->x + widget->width)) {
+      widget->stale = 1;
+    }
+  }
+#endif
+  for (LCD_Retained_Area* area = selected->retained_areas; area; area = area->next) {
+    if (y < 0 || (y >= area->y && y < area->y + area->height &&
+                  x1 >= area->x && x0 < area->x + area->width)) {
+      area->stale = 1;
+    }
+  }
+}
+#endif
+
+static void mark_all_dirty(LCD_Display* display) {
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    display->track_changes[y].x0 = 0;
+    display->track_changes[y].x1 = ST7789V2_WIDTH - 1;
+    display->track_changes[y].solid = 0;
+  }
+}
+
+#if LCD_FRAME_DIFF || LCD_ROW_CACHE_ROWS
+#if !ST7789V2_HOST
+// Hashes one row of an image buffer with the CRC peripheral (30 word writes, 60 with 8bpp)
+static uint32_t row_crc(const uint8_t* buffer, const uint16_t y) {
+  const uint32_t* words = (const uint32_t*)&buffer[PIXEL_BYTE(0, y)];
+  CRC->CR = CRC_CR_RESET;
+  for (int i = 0; i < ROW_BYTES / 4; i++) {
+    CRC->DR = words[i];
+  }
+  return CRC->DR;
+}
+#else
+// No CRC peripheral on the host: FNV-1a does the same job (only equality matters)
+static uint32_t row_crc(const uint8_t* buffer, const uint16_t y) {
+  const uint8_t* bytes = &buffer[PIXEL_BYTE(0, y)];
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < ROW_BYTES; i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+#endif
+#endif
+
+// Marks everything dirty and forgets what the panel shows, for when the panel contents no
+// longer match the buffers (power-up, palette change)
+static void force_full_refresh(LCD_Display* display) {
+  mark_all_dirty(display);
+#if LCD_FRAME_DIFF
+  memset(display->shown_crc_valid, 0, sizeof(display->shown_crc_valid));
+#endif
+#if LCD_PALETTE_ROW_MASKS
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    display->shown_colours[y] = 0xFFFF;
+  }
+#endif
+}
+
+// Marks the rows showing any of the colours (a bit per colour index) for resending, after
+// those colours changed. Without LCD_PALETTE_ROW_MASKS any row may show them.
+static void palette_changed(LCD_Display* display, const uint16_t colours) {
+#if LCD_PALETTE_ROW_MASKS
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    if (display->shown_colours[y] & colours) {
+      display->track_changes[y].x0 = 0;
+      display->track_changes[y].x1 = ST7789V2_WIDTH - 1;
+      display->track_changes[y].solid = 0;
+#if LCD_FRAME_DIFF
+      display->shown_crc_valid[y] = 0;  // Same indices, new colours
+#endif
+    }
+  }
+#else
+  if (colours) {
+    force_full_refresh(display);
+  }
+#endif
+}
+
+// Palette colours are byte-swapped for 8-bit SPI. The refresh sends 16-bit frames, so swap them
+// back to native RGB565 once here rather than per pixel
+static inline uint32_t native_colour(const uint16_t colour) {
+  return (uint16_t)((colour >> 8) | (colour << 8));
+}
+
+#if LCD_DISPLAY_LIST
+// Palette index of a native RGB565 pixel, for reading pixels back. Colours drawn in RGB565
+// that aren't in the palette read as 0.
+static uint8_t palette_index(const uint16_t pixel) {
+  for (int c = 0; c < LCD_PALETTE_SIZE; c++) {
+    if (selected->palette_native[c] == pixel) {
+      return c;
+    }
+  }
+  return 0;
+}
+#endif
+
+#if LCD_BITS_PER_PIXEL == 8
+// Fills 8bpp palette entries 16-255 with their defaults: a 6x6x6 colour cube (16 + 36r + 6g + b)
+// then a 24 step grey ramp, as on 256 colour terminals
+static void build_extended_palette(LCD_Display* display) {
+  for (int c = 0; c < 216; c++) {
+    const uint16_t r = (c / 36) * 31 / 5, g = ((c / 6) % 6) * 63 / 5, b = (c % 6) * 31 / 5;
+    display->palette_native[16 + c] = (r << 11) | (g << 5) | b;
+  }
+  for (int i = 0; i < 24; i++) {
+    const uint16_t level = 8 + 10 * i;
+    display->palette_native[232 + i] = ((level >> 3) << 11) | ((level >> 2) << 5) | (level >> 3);
+  }
+}
+
+void LCD_Set_Palette_Entry(const uint8_t index, const uint16_t colour) {
+  // Read by the refresh, as LCD_Set_Palette
+  LCD_Refresh_Wait();
+  selected->palette_native[index] = native_colour(colour);
+#if LCD_ROW_CACHE_ROWS
+  selected->palette_generation++;
+#endif
+  palette_changed(selected, 1u << (index & 0x0F));
+}
+#endif
+
+static void build_pair_map(LCD_Display* display) {
+#if LCD_ROW_CACHE_ROWS
+  display->palette_generation++;
+#endif
+#if LCD_DISPLAY_LIST || LCD_BITS_PER_PIXEL == 8
+  // Only the 16 colours of the selected palette, 8bpp entries above that are kept
+  for (int c = 0; c < 16; c++) {
+    display->palette_native[c] = native_colour(display->colour_map[c]);
+  }
+#else
+  const uint16_t* colour_map = display->colour_map;
+  for (int b = 0; b < 256; b++) {
+    display->pair_map[b] = native_colour(colour_map[b & 0x0F]) | (native_colour(colour_map[b >> 4]) << 16);
+  }
+#endif
+}
+
+// Sets up the drawing state, none of which needs the panel to be ready
+static void init_drawing(LCD_Display* display) {
+  display->te = display->cfg->TE.port != NULL;
+#if LCD_BITS_PER_PIXEL == 8
+  build_extended_palette(display);
+#endif
+  build_pair_map(display);
+  // Panel RAM holds random data after power-up, so the first refresh sends everything
+  for (int b = 0; b < LCD_NUM_BUFFERS; b++) {
+    for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+      mark_span_clean(&display->span_buffers[b][y]);
+    }
+  }
+#if LCD_DISPLAY_LIST
+  LCD_List_Reset(0);
+  LCD_List_Set_Clip(0, 0, ST7789V2_WIDTH - 1, ST7789V2_HEIGHT - 1);
+#else
+  // The buffers may be in a section the startup code doesn't zero
+  memset(display->image_buffers, 0, LCD_NUM_BUFFERS * BUFFER_LENGTH);
+#endif
+  // The zeroed buffer is all background colour 0
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    mark_span_clean(&display->drawn[y]);
+#if !LCD_DISPLAY_LIST
+    display->row_colour[y] = 1;
+#endif
+  }
+#if LCD_PALETTE_ROW_MASKS
+  // Not known until each row has been sent in full
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    display->shown_colours[y] = 0xFFFF;
+  }
+#endif
+  display->background = 0;
+  display->view = screen_view;
+  display->view_depth = 0;
+#if LCD_ROW_CACHE_ROWS
+  // In SRAM1, which the startup code doesn't zero
+  memset(display->row_cache, 0, LCD_ROW_CACHE_ROWS * sizeof(LCD_Cached_Row));
+#endif
+#if (LCD_FRAME_DIFF || LCD_REFRESH_CHECK || LCD_ROW_CACHE_ROWS) && !ST7789V2_HOST
+  RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+#endif
+}
+
+// The rest of the set-up, once the panel has powered up
+static void init_panel_ready(LCD_Display* display) {
+  ST7789V2_cfg_t* cfg = display->cfg;
+  (void)cfg;
+#if LCD_SPI_SELF_TEST
+  // Fastest divider first, fall back to the slowest if nothing passes
+  uint8_t baud_div = cfg->spi_baud_div;
+  while (baud_div < ST7789V2_BAUD_DIV_256 && !ST7789V2_Test_Baud(cfg, baud_div)) {
+    baud_div++;
+  }
+  ST7789V2_Set_Baud_Div(cfg, baud_div);
+#endif
+#if LCD_REFRESH_CHECK
+  // A whole frame, sent at the divider and read back: slow down until it comes back intact
+  while (LCD_Self_Test(cfg) && cfg->spi_baud_div < ST7789V2_BAUD_DIV_256) {
+    ST7789V2_Set_Baud_Div(cfg, cfg->spi_baud_div + 1);
+  }
+#endif
+  force_full_refresh(display);
+}
 
 void LCD_init(ST7789V2_cfg_t* cfg) {
+  LCD_Display* display = display_for(cfg);
   ST7789V2_Init(cfg);
+  init_drawing(display);
+  init_panel_ready(display);
+  LCD_Select_Display(cfg);
+}
+
+void LCD_Init_Start(ST7789V2_cfg_t* cfg, const uint32_t now_ms) {
+  LCD_Display* display = display_for(cfg);
+  ST7789V2_Init_Start(cfg, now_ms);
+  init_drawing(display);
+  display->init_pending = 1;
+  LCD_Select_Display(cfg);
+}
+
+uint8_t LCD_Init_Poll(ST7789V2_cfg_t* cfg, const uint32_t now_ms) {
+  if (!ST7789V2_Init_Poll(cfg, now_ms)) {
+    return 0;
+  }
+  LCD_Display* display = display_for(cfg);
+  if (display->init_pending) {
+    display->init_pending = 0;
+    init_panel_ready(display);
+  }
+  return 1;
+}
+
+void LCD_Select_Display(ST7789V2_cfg_t* cfg) {
+#if LCD_MAX_DISPLAYS > 1
+  // A fill may still be clearing the last display's buffer
+  clear_wait();
+  selected = display_for(cfg);
+#else
+  (void)cfg;
+#endif
 }
 
 void LCD_turnOff(ST7789V2_cfg_t* cfg) {
@@ -61,16 +693,68 @@ void LCD_turnOn(ST7789V2_cfg_t* cfg) {
 }
 
 void LCD_clear() {
-  // Writes zeroes to frame buffer 32 bits at a time
-  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
-    track_changes[y] = 1;
+  // Same as filling with colour 0, which also keeps the background tracking right
+  LCD_Fill_Buffer(0);
+}
+
+static void set_colour_map(const uint16_t* colour_map) {
+  // The pair map is read by the refresh, so don't change it under a running one
+  LCD_Refresh_Wait();
+  // Resend the rows showing colours that differ (all of them if the same colours may have
+  // been changed where they are)
+  uint16_t changed = 0xFFFF;
+  if (colour_map != selected->colour_map) {
+    changed = 0;
+    for (int c = 0; c < 16; c++) {
+      if (colour_map[c] != selected->colour_map[c]) {
+        changed |= 1u << c;
+      }
+    }
+  }
+  selected->colour_map = colour_map;
+  build_pair_map(selected);
+  palette_changed(selected, changed);
+}
+
+// The active palette, copied to the display's RAM first if it is someone else's
+static uint16_t* own_palette(LCD_Display* display) {
+  if (display->colour_map != display->own_colours) {
+    memcpy(display->own_colours, display->colour_map, sizeof(display->own_colours));
+    display->colour_map = display->own_colours;
+  }
+  return display->own_colours;
+}
+
+void LCD_Set_Palette_Colour(const uint8_t index, const uint16_t colour) {
+  const uint8_t c = index & 0x0F;
+  if (selected->colour_map[c] == colour) {
+    return;
   }
-  for (int i = 0; i < BUFFER_LENGTH >> 2; i++) {
-    ((uint32_t*)image_buffer)[i] = 0;
+  LCD_Refresh_Wait();
+  own_palette(selected)[c] = colour;
+  build_pair_map(selected);
+  palette_changed(selected, 1u << c);
+}
+
+uint16_t LCD_Get_Palette_Colour(const uint8_t index) {
+  return selected->colour_map[index & 0x0F];
+}
+
+void LCD_Cycle_Palette(const uint8_t first, const uint8_t count) {
+  if (count < 2 || first + count > 16) {
+    return;
   }
+  LCD_Refresh_Wait();
+  uint16_t* colours = own_palette(selected);
+  const uint16_t last = colours[first + count - 1];
+  memmove(&colours[first + 1], &colours[first], (count - 1) * sizeof(colours[0]));
+  colours[first] = last;
+  build_pair_map(selected);
+  palette_changed(selected, (uint16_t)(((1u << count) - 1) << first));
 }
 
 void LCD_Set_Palette(LCD_Palette palette) {
+  const uint16_t* colour_map;
   switch(palette) {
     case PALETTE_GREYSCALE:
       colour_map = palette_greyscale;
@@ -86,10 +770,79 @@ void LCD_Set_Palette(LCD_Palette palette) {
       colour_map = palette_default;
       break;
   }
-  // Mark all rows as changed to force a full refresh
-  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
-    track_changes[y] = 1;
+  set_colour_map(colour_map);
+}
+
+void LCD_Set_Palette_Colours(const uint16_t* colours) {
+  set_colour_map(colours);
+}
+
+// log2(x) in Q16 for x = 1..255: the whole part from the top bit, the fraction a bit at a time
+// by squaring the mantissa (Q15, so the square fits in 32 bits)
+static int32_t log2_q16(const uint8_t x) {
+  uint8_t msb = 7;
+  while (!(x >> msb)) {
+    msb--;
+  }
+  uint32_t mantissa = (uint32_t)x << (15 - msb);
+  int32_t result = msb << 16;
+  for (int32_t bit = 1 << 15; bit; bit >>= 1) {
+    mantissa = (mantissa * mantissa) >> 15;
+    if (mantissa >= (2u << 15)) {
+      mantissa >>= 1;
+      result += bit;
+    }
+  }
+  return result;
+}
+
+// 255 * (v / 255)^gamma, rounded, with gamma in Q8: 2^(gamma * log2(v / 255)), the fraction
+// of the power from a cubic that is within 0.01% of 2^f
+static uint8_t apply_gamma(const uint8_t v, const uint16_t gamma) {
+  if (v == 0 || v == 255 || gamma == LCD_GAMMA(1.0)) {
+    return v;
   }
+  const int64_t power = ((int64_t)(log2_q16(v) - log2_q16(255)) * gamma) >> 8;  // Q16, below 0
+  const int32_t whole = (int32_t)(power >> 16);                      // floor, 0 or below
+  const uint32_t f = (uint32_t)(power - ((int64_t)whole << 16));     // 0..65535
+  uint32_t p = (5108u * f) >> 16;
+  p = ((14847u + p) * f) >> 16;
+  p = ((45581u + p) * f) >> 16;
+  p += 65536u;                                                        // 2^f in Q16
+  if (-whole >= 24) {
+    return 0;
+  }
+  return (uint8_t)((255u * (p >> -whole) + 32768u) >> 16);
+}
+
+uint16_t LCD_RGB888_To_RGB565(const uint32_t rgb, const uint16_t gamma) {
+  const uint32_t r = apply_gamma((rgb >> 16) & 0xFF, gamma);
+  const uint32_t g = apply_gamma((rgb >> 8) & 0xFF, gamma);
+  const uint32_t b = apply_gamma(rgb & 0xFF, gamma);
+  const uint16_t colour = (uint16_t)((((r * 31 + 127) / 255) << 11) |
+                                     (((g * 63 + 127) / 255) << 5) |
+                                     ((b * 31 + 127) / 255));
+  // Byte-swapped like the RGB565_* definitions
+  return (uint16_t)((colour >> 8) | (colour << 8));
+}
+
+void LCD_Load_Palette_RGB888(const uint32_t* colours, const uint16_t gamma) {
+  // Converted before waiting, so a running refresh overlaps the maths
+  uint16_t converted[16];
+  for (int c = 0; c < 16; c++) {
+    converted[c] = LCD_RGB888_To_RGB565(colours[c], gamma);
+  }
+  LCD_Refresh_Wait();
+  uint16_t changed = 0;
+  for (int c = 0; c < 16; c++) {
+    if (converted[c] != selected->colour_map[c]) {
+      changed |= 1u << c;
+    }
+  }
+  memcpy(selected->own_colours, converted, sizeof(selected->own_colours));
+  selected->colour_map = selected->own_colours;
+  build_pair_map(selected);
+  palette_changed(selected, changed);
 }
 
 void LCD_normalMode(ST7789V2_cfg_t* cfg) {
@@ -100,316 +853,2416 @@ void LCD_inverseMode(ST7789V2_cfg_t* cfg) {
   ST7789V2_Send_Command(cfg, ST7789_INVOFF);
 }
 
-void LCD_printString(char const *str, const uint16_t x, const uint16_t y, uint8_t colour, uint8_t font_size) {
-  if (x < ST7789V2_WIDTH && y < ST7789V2_HEIGHT) {
-    int n = 0 ; // counter for number of characters in string
-    // loop through string and print character
-    while(*str) {
-      // writes the character bitmap data to the buffer, so that text and pixels can be displayed at the same time
-      for (int i = 0; i < 5 ; i++ ) {
-        int pixel_x = x+(i+n*6)*font_size;
-        if (pixel_x > ST7789V2_WIDTH-1) // ensure pixel isn't outside the buffer size (0 - 83)
-          break;
-        for (int j = 0; j < 7; j ++) {
-          if (font5x7_[(*str - 32)*5 + i] & (1u << j)) {
-            for (int l = 0; l < font_size; l++) {
-              for (int m = 0; m < font_size; m++) {
-                LCD_Set_Pixel(pixel_x+l, y+(j*font_size)+m, colour);
-              }
-            }
-            
-          }
-        }
-        // image_buffer[pixel_x + y * ST7789V2_HEIGHT] = font5x7[(*str - 32)*5 + i]; // array is offset by 32 relative to ASCII, each character is 5 pixels wide
-      }
-      str++; // go to next character in string
-      n++; // increment index
-    }
+void LCD_Set_Scroll_Area(ST7789V2_cfg_t* cfg, const uint16_t top_fixed, const uint16_t bottom_fixed) {
+  if (top_fixed + bottom_fixed >= ST7789V2_HEIGHT) {
+    return;  // Nothing left to scroll
   }
+  LCD_Display* display = display_for(cfg);
+  // Commands can't go out in the middle of a background refresh's pixels
+  refresh_wait(display);
+  display->scroll_top = top_fixed;
+  display->scroll_rows = ST7789V2_HEIGHT - top_fixed - bottom_fixed;
+  ST7789V2_Set_Scroll_Area(cfg, top_fixed, bottom_fixed);
+  ST7789V2_Set_Scroll_Start(cfg, display->scroll_top);
 }
 
-void LCD_printChar(char const c, const uint16_t x, const uint16_t y, uint8_t colour) {
-  if (x < ST7789V2_WIDTH && y < ST7789V2_HEIGHT) {
-    for (int i = 0; i < 5 ; i++ ) {
-      int pixel_x = x+i;
-      if (pixel_x > ST7789V2_WIDTH-1) // ensure pixel isn't outside the buffer size (0 - 83)
-        break;
-      for (int j = 0; j < 7; j++) {
-        if (font5x7_[(c - 32)*5 + i] & (1u << j)) {
-          LCD_Set_Pixel(pixel_x, y+j, colour);
-        }
-      }
-      // image_buffer[pixel_x + y * ST7789V2_HEIGHT] = font5x7[(c - 32)*5 + i]; // array is offset by 32 relative to ASCII, each character is 5 pixels wide
-    }
+void LCD_Scroll(ST7789V2_cfg_t* cfg, const uint16_t offset) {
+  LCD_Display* display = display_for(cfg);
+  refresh_wait(display);
+  ST7789V2_Set_Scroll_Start(cfg, display->scroll_top + offset % display->scroll_rows);
+}
+
+void LCD_Set_Power_Profile(ST7789V2_cfg_t* cfg, const LCD_Power_Profile profile, const uint16_t y0, const uint16_t y1) {
+  LCD_Display* display = display_for(cfg);
+  refresh_wait(display);
+  const uint8_t partial = (profile == LCD_POWER_PARTIAL || profile == LCD_POWER_PARTIAL_IDLE);
+  if (partial && y0 <= y1 && y1 < ST7789V2_HEIGHT) {
+    display->active_y0 = y0;
+    display->active_y1 = y1;
+    ST7789V2_Set_Partial_Mode(cfg, 1, y0, y1);
+  } else {
+    display->active_y0 = 0;
+    display->active_y1 = ST7789V2_HEIGHT - 1;
+    ST7789V2_Set_Partial_Mode(cfg, 0, 0, 0);
   }
+  ST7789V2_Set_Idle_Mode(cfg, profile == LCD_POWER_IDLE || profile == LCD_POWER_PARTIAL_IDLE);
 }
 
-void LCD_Set_Pixel(const uint16_t x, const uint16_t y, uint8_t colour) {
-  track_changes[y] = 1;
-  uint16_t index = (ST7789V2_WIDTH*y + x) >> 1;  // Bit shift instead of divide by 2
-  if (x < ST7789V2_WIDTH && y < ST7789V2_HEIGHT) {
-    if (x&1) {
-      image_buffer[index] = (colour << 4) | (image_buffer[index] & 0x0F);
-    }
-    else {
-      image_buffer[index] = colour | (image_buffer[index] & 0xF0);
+// Font of the text functions (LCD_Set_Font)
+static const unsigned char* current_font = font5x7_;
+
+// The glyph cache packs 4bpp nibbles, 8bpp text is drawn pixel by pixel
+#define USE_GLYPH_CACHE (LCD_GLYPH_CACHE_ENTRIES > 0 && !LCD_DISPLAY_LIST && LCD_BITS_PER_PIXEL == 4)
+
+#if USE_GLYPH_CACHE
+// Bytes of one cached glyph row: 5 * size pixels, plus a leading pixel when it starts on an odd x
+#define GLYPH_ROW_BYTES ((5 * LCD_GLYPH_CACHE_MAX_SIZE + 2) / 2)
+
+// A character pre-scaled and packed into image buffer bytes for one colour, size and x parity.
+// Each of the 7 font rows keeps its pixel bytes and a nibble mask of the lit pixels, so a blit
+// is a masked byte copy repeated size times down the screen.
+typedef struct {
+  char c;
+  uint8_t size;
+  uint8_t colour;
+  uint8_t phase;      // x & 1 of the glyph's left edge
+  uint8_t bytes;      // Bytes used per row
+  uint8_t lit_rows;   // Bit j set if font row j has any lit pixel
+  uint8_t lit_x0, lit_x1;  // Lit column range, relative to the glyph's left edge
+  uint8_t data[7][GLYPH_ROW_BYTES];
+  uint8_t mask[7][GLYPH_ROW_BYTES];
+} LCD_Glyph;
+
+static LCD_Glyph glyph_cache[LCD_GLYPH_CACHE_ENTRIES];
+static uint8_t glyph_cache_used = 0;
+static uint8_t glyph_cache_next = 0;  // Entry replaced next once the cache is full (round robin)
+
+static LCD_Glyph* find_glyph(char c, uint8_t size, uint8_t colour, uint8_t phase) {
+  for (int e = 0; e < glyph_cache_used; e++) {
+    LCD_Glyph* glyph = &glyph_cache[e];
+    if (glyph->c == c && glyph->size == size && glyph->colour == colour && glyph->phase == phase) {
+      return glyph;
     }
   }
-}
 
-uint8_t LCD_Get_Pixel(const uint16_t x, const uint16_t y) {
-  uint16_t pixel = x * y;
-  if (pixel & 0x1) {
-    return (image_buffer[pixel >> 1] & 0xF0) >> 4;
+  // Not cached, rasterise it into a free or the oldest entry
+  LCD_Glyph* glyph;
+  if (glyph_cache_used < LCD_GLYPH_CACHE_ENTRIES) {
+    glyph = &glyph_cache[glyph_cache_used++];
   }
   else {
-    return (image_buffer[pixel >> 1] & 0x0F);
+    glyph = &glyph_cache[glyph_cache_next];
+    glyph_cache_next = (glyph_cache_next + 1) % LCD_GLYPH_CACHE_ENTRIES;
   }
-}
+  memset(glyph, 0, sizeof(*glyph));
+  glyph->c = c;
+  glyph->size = size;
+  glyph->colour = colour;
+  glyph->phase = phase;
+  glyph->bytes = (phase + 5 * size + 1) >> 1;
+  glyph->lit_x0 = 0xFF;
 
-void LCD_Fill_Buffer(const uint8_t colour) {
-  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
-    track_changes[y] = 1;
-  }
-  for (int i = 0; i < BUFFER_LENGTH; i++) {
-    image_buffer[i] = colour | (colour << 4);
+  for (int i = 0; i < 5; i++) {
+    const uint8_t column = current_font[(c - 32)*5 + i];
+    for (int j = 0; j < 7; j++) {
+      if (column & (1u << j)) {
+        glyph->lit_rows |= 1u << j;
+        for (int l = 0; l < size; l++) {
+          const int px = phase + i * size + l;
+          const uint8_t shift = (px & 1) ? 4 : 0;
+          glyph->data[j][px >> 1] |= colour << shift;
+          glyph->mask[j][px >> 1] |= 0x0F << shift;
+        }
+        if (i * size < glyph->lit_x0) glyph->lit_x0 = i * size;
+        if (i * size + size - 1 > glyph->lit_x1) glyph->lit_x1 = i * size + size - 1;
+      }
+    }
   }
+  return glyph;
 }
+#endif
 
-#define lines_per_buffer 1
-// static const int lines_per_buffer = 1;
-static uint16_t line_buffer0[lines_per_buffer*240]; // 240 * 2 Bytes * n rows
-static uint16_t line_buffer1[lines_per_buffer*240]; // 240 * 2 Bytes * n rows
-
-void LCD_Refresh(ST7789V2_cfg_t* cfg) {
-  ST7789V2_Set_Address_Window(cfg, 0, 0, 239, 239); 
-  ST7789V2_Send_Command(cfg, 0x2C);
+void LCD_Set_Font(const unsigned char* font) {
+  current_font = (font != NULL) ? font : font5x7_;
+#if USE_GLYPH_CACHE
+  // Cached glyphs were rasterised from the old font
+  glyph_cache_used = 0;
+  glyph_cache_next = 0;
+#endif
+}
 
-  int buf = 0;
-  const int loop_count = 120;  // Pre-calculate (240/2)/lines_per_buffer = 120
-  const int pixels_per_line = 120 * lines_per_buffer;
-  
-  for (int i = 0; i < loop_count; i++) {
-    // First line buffer
-    if (track_changes[2*i]) {
-      if (!buf) {
-        while (cfg->spi->SR & SPI_SR_BSY);
-      }
-      buf = 0;
-      track_changes[2*i] = 0;
-      for (int j = 0; j < 120*lines_per_buffer; j++) {
-        uint8_t double_pixel = image_buffer[120 * (2*i*lines_per_buffer) + j];
-        line_buffer0[2*j] = colour_map[double_pixel & 0x0F];
-        line_buffer0[2*j+1] = colour_map[double_pixel >> 4];
-      }
-      
-      ST7789V2_Set_Address_Window(cfg, 0, 2*i, 239, 2*i); 
-      ST7789V2_Send_Command(cfg, 0x2C);
-      ST7789V2_Send_Data_Block(cfg, (uint8_t*) line_buffer0, 480*lines_per_buffer);
-    }
+const unsigned char* LCD_Get_Font(void) {
+  return current_font;
+}
 
-    // Second line buffer
-    if (track_changes[2*i + 1]) {
-      if (buf) {
-        while (cfg->spi->SR & SPI_SR_BSY);
-      }
-      buf = 1;
-      track_changes[2*i + 1] = 0;
-      
-      // Pre-calculate buffer offset to avoid repeated multiplication
-      const int buffer_offset = 120 * (2*i*lines_per_buffer + 1);
-      for (int j = 0; j < pixels_per_line; j++) {
-        uint8_t double_pixel = image_buffer[buffer_offset + j];
-        line_buffer1[2*j] = colour_map[double_pixel & 0x0F];
-        line_buffer1[2*j+1] = colour_map[double_pixel >> 4];
-      }
-      ST7789V2_Set_Address_Window(cfg, 0, 2*i+1, 239, 2*i+1); 
-      ST7789V2_Send_Command(cfg, 0x2C);
-      ST7789V2_Send_Data_Block(cfg, (uint8_t*) line_buffer1, 480*lines_per_buffer);
-    }
+#if !LCD_DISPLAY_LIST
+// Sets one pixel already known to be on the screen
+static inline void put_pixel(const uint16_t x, const uint16_t y, const uint8_t colour) {
+  uint16_t index = PIXEL_BYTE(x, y);  // Bit shift instead of divide by 2
+  mark_span_dirty(y, x, x);
+#if LCD_BITS_PER_PIXEL == 8
+  selected->image_buffer[index] = colour;
+#else
+  if (x&1) {
+    selected->image_buffer[index] = (colour << 4) | (selected->image_buffer[index] & 0x0F);
+  }
+  else {
+    selected->image_buffer[index] = colour | (selected->image_buffer[index] & 0xF0);
   }
+#endif
 }
 
-void LCD_randomiseBuffer() {
-  for(int i = 0; i < BUFFER_LENGTH; i++) {
-    image_buffer[i] = (uint8_t)rand();  // Cast truncates to byte, avoiding slow modulo
+// Sets pixels x0..x1 (x0 <= x1) of row y, already known to be on the screen
+static ST7789V2_RAMFUNC void fill_span(const uint16_t y, uint16_t x0, uint16_t x1, uint8_t colour) {
+  mark_span_dirty(y, x0, x1);
+
+#if LCD_BITS_PER_PIXEL == 8
+  fill_bytes(&selected->image_buffer[PIXEL_BYTE(x0, y)], colour, x1 - x0 + 1);
+#else
+  colour &= 0x0F;
+  uint8_t* row = &selected->image_buffer[(ST7789V2_WIDTH * y) >> 1];
+  // Odd x0 shares its byte with the pixel to its left, so only set the high nibble
+  if (x0 & 1) {
+    row[x0 >> 1] = (colour << 4) | (row[x0 >> 1] & 0x0F);
+    x0++;
+  }
+  if (x0 > x1) {
+    return;
   }
+  // Even x1 shares its byte with the pixel to its right, so only set the low nibble
+  if (!(x1 & 1)) {
+    row[x1 >> 1] = colour | (row[x1 >> 1] & 0xF0);
+    if (x1 == x0) {
+      return;
+    }
+    x1--;
+  }
+  // Everything left is whole bytes, x0 even and x1 odd
+  fill_bytes(&row[x0 >> 1], (colour << 4) | colour, (x1 - x0 + 1) >> 1);
+#endif
 }
 
-void LCD_plotArray(float const array[], const uint8_t colour) {
-  for (int i=0; i<ST7789V2_WIDTH; i++) {  // loop through array
-    // elements are normalised from 0.0 to 1.0, so multiply
-    // by 47 to convert to pixel range, and subtract from 47
-    // since top-left is 0,0 in the display geometry
-    LCD_Set_Pixel(i, ST7789V2_HEIGHT - (int)(array[i]*(float)ST7789V2_HEIGHT), colour);
+// Sets pixels y0..y1 (y0 <= y1) of column x, already known to be on the screen
+static ST7789V2_RAMFUNC void fill_column(const uint16_t x, const uint16_t y0, const uint16_t y1, const uint8_t colour) {
+  uint8_t* byte = &selected->image_buffer[PIXEL_BYTE(x, y0)];
+#if LCD_BITS_PER_PIXEL == 8
+  const uint8_t keep = 0x00;
+  const uint8_t set = colour;
+#else
+  // The same nibble of every byte down the column
+  const uint8_t keep = (x & 1) ? 0x0F : 0xF0;
+  const uint8_t set = (x & 1) ? (colour << 4) : (colour & 0x0F);
+#endif
+  for (uint16_t y = y0; y <= y1; y++) {
+    mark_span_dirty(y, x, x);
+    *byte = (*byte & keep) | set;
+    byte += ROW_BYTES;
   }
 }
+#endif
 
-void LCD_Draw_Circle(const uint16_t x0, const uint16_t y0, const uint16_t radius, const uint8_t colour, const uint8_t fill) {
-
-  // from http://en.wikipedia.org/wiki/Midpoint_circle_algorithm
-  int x = radius;
-  int y = 0;
-  int radiusError = 1-x;
+// Screen co-ordinates of a point of the current viewport. Co-ordinates past 32767 are taken
+// as negative, so shapes that start off the left or top edge are clipped rather than lost.
+static inline int view_x(const uint16_t x) {
+  return (int16_t)x + selected->view.origin_x;
+}
 
-  while(x >= y) {
+static inline int view_y(const uint16_t y) {
+  return (int16_t)y + selected->view.origin_y;
+}
 
-    // if transparent, just draw outline
-    if (!fill) {
-      LCD_Set_Pixel( x + x0,  y + y0, colour);
-      LCD_Set_Pixel(-x + x0,  y + y0, colour);
-      LCD_Set_Pixel( y + x0,  x + y0, colour);
-      LCD_Set_Pixel(-y + x0,  x + y0, colour);
-      LCD_Set_Pixel(-y + x0, -x + y0, colour);
-      LCD_Set_Pixel( y + x0, -x + y0, colour);
-      LCD_Set_Pixel( x + x0, -y + y0, colour);
-      LCD_Set_Pixel(-x + x0, -y + y0, colour);
-    } 
-    else {  
-      // drawing filled circle, so draw lines between points at same y value
-      LCD_Draw_Line(x+x0,y+y0, -x+x0,y+y0, colour);
-      LCD_Draw_Line(y+x0,x+y0, -y+x0,x+y0, colour);
-      LCD_Draw_Line(y+x0,-x+y0, -y+x0,-x+y0, colour);
-      LCD_Draw_Line(x+x0,-y+y0, -x+x0,-y+y0, colour);
-    }
+// 1 if the box x0..x1, y0..y1 (screen co-ordinates) lies inside the clip rectangle, so it can
+// be drawn without checking each pixel
+static inline uint8_t inside_clip(const int x0, const int y0, const int x1, const int y1) {
+  const LCD_View* view = &selected->view;
+  return x0 >= view->clip_x0 && x1 <= view->clip_x1 && y0 >= view->clip_y0 && y1 <= view->clip_y1;
+}
 
-    y++;
-    if (radiusError<0) {
-      radiusError += 2 * y + 1;
-    } 
-    else {
-      x--;
-      radiusError += 2 * (y - x) + 1;
-    }
+#if !LCD_DISPLAY_LIST
+// Sets one pixel (screen co-ordinates) if it is inside the clip rectangle
+static inline void clip_pixel(const int x, const int y, const uint8_t colour) {
+  const LCD_View* view = &selected->view;
+  if (x >= view->clip_x0 && x <= view->clip_x1 && y >= view->clip_y0 && y <= view->clip_y1) {
+    put_pixel(x, y, colour);
   }
 }
 
-void LCD_Draw_Line(const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1, const uint8_t colour) {
-  // Note that the ranges can be negative so we have to turn the input values into signed integers first
-  const int16_t y_range = (int)y1 - (int)y0;
-  const int16_t x_range = (int)x1 - (int)x0;;
+// Sets one pixel of a shape: checked against the clip rectangle unless the whole shape is
+// known to be inside it
+static inline void plot_pixel(const uint8_t checked, const int x, const int y, const uint8_t colour) {
+  if (checked) {
+    clip_pixel(x, y, colour);
+  } else {
+    put_pixel(x, y, colour);
+  }
+}
+#endif
 
-  // Handle single point case (both ranges are zero)
-  if (x_range == 0 && y_range == 0) {
-    LCD_Set_Pixel(x0, y0, colour);
+// Sets pixels x0..x1 (either order) of row y, in screen co-ordinates, clipped to the clip rectangle
+static ST7789V2_RAMFUNC void clip_span(const int y, int x0, int x1, const uint8_t colour) {
+  const LCD_View* view = &selected->view;
+  if (y < view->clip_y0 || y > view->clip_y1) {
     return;
   }
+  if (x0 > x1) {
+    const int tmp = x0;
+    x0 = x1;
+    x1 = tmp;
+  }
+  if (x0 < view->clip_x0) x0 = view->clip_x0;
+  if (x1 > view->clip_x1) x1 = view->clip_x1;
+  if (x0 > x1) {
+    return;
+  }
+#if LCD_DISPLAY_LIST
+  LCD_List_Add_Rect(x0, y, x1 - x0 + 1, 1, colour, 1);
+#else
+  fill_span(y, x0, x1, colour);
+#endif
+}
 
-  // if dotted line, set step to 2, else step is 1
-  // const uint16_t step = (type==2) ? 2:1;
-  uint16_t step = 1;
-
-  // make sure we loop over the largest range to get the most pixels on the display
-  // for instance, if drawing a vertical line (x_range = 0), we need to loop down the y pixels
-  // or else we'll only end up with 1 pixel in the x column
-  if ( abs(x_range) > abs(y_range) ) {
-    // ensure we loop from smallest to largest or else for-loop won't run as expected
-    const uint16_t start = x_range > 0 ? x0:x1;
-    const uint16_t stop =  x_range > 0 ? x1:x0;
+// Makes view the current viewport and clip rectangle
+static void set_view(const LCD_View* view) {
+  selected->view = *view;
+#if LCD_DISPLAY_LIST
+  LCD_List_Set_Clip(view->clip_x0, view->clip_y0, view->clip_x1, view->clip_y1);
+#endif
+}
 
-    // loop between x pixels
-    for (unsigned int x = start; x<= stop ; x+=step) {  // do linear interpolation
-        const int16_t dx = (int)x - (int)x0;
-        const uint16_t y = y0 + y_range * dx / x_range;
+void LCD_Set_Clip(const int16_t x0, const int16_t y0, const uint16_t width, const uint16_t height) {
+  LCD_View view = selected->view;
+  const int left = view.origin_x + x0;
+  const int top = view.origin_y + y0;
+  const int right = left + width - 1;
+  const int bottom = top + height - 1;
+  view.clip_x0 = (left > view.x0) ? left : view.x0;
+  view.clip_y0 = (top > view.y0) ? top : view.y0;
+  view.clip_x1 = (right < view.x1) ? right : view.x1;
+  view.clip_y1 = (bottom < view.y1) ? bottom : view.y1;
+  set_view(&view);
+}
 
-        // If the line type is '0', this will clear the pixel
-        // If it is '1' or '2', the pixel will be set
-        LCD_Set_Pixel(x, y, colour);
-    }
-  } else {
-    // ensure we loop from smallest to largest or else for-loop won't run as expected
-    const uint16_t start = y_range > 0 ? y0:y1;
-    const uint16_t stop =  y_range > 0 ? y1:y0;
+void LCD_Reset_Clip(void) {
+  LCD_View view = selected->view;
+  view.clip_x0 = view.x0;
+  view.clip_y0 = view.y0;
+  view.clip_x1 = view.x1;
+  view.clip_y1 = view.y1;
+  set_view(&view);
+}
 
-    for (unsigned int y = start; y<= stop ; y+=step) {  // do linear interpolation
-        const int16_t dy = (int)y - (int)y0;;
-        const uint16_t x = x0 + x_range * dy / y_range;
+uint8_t LCD_Push_Viewport(const int16_t x0, const int16_t y0, const uint16_t width, const uint16_t height) {
+  if (selected->view_depth >= LCD_VIEWPORT_DEPTH) {
+    return 0;
+  }
+  selected->view_stack[selected->view_depth++] = selected->view;
+  // The new bounds are the rectangle cut down to the clip rectangle in force
+  LCD_View view = selected->view;
+  view.origin_x += x0;
+  view.origin_y += y0;
+  view.x0 = view.clip_x0;
+  view.y0 = view.clip_y0;
+  view.x1 = view.clip_x1;
+  view.y1 = view.clip_y1;
+  selected->view = view;
+  LCD_Set_Clip(0, 0, width, height);
+  selected->view.x0 = selected->view.clip_x0;
+  selected->view.y0 = selected->view.clip_y0;
+  selected->view.x1 = selected->view.clip_x1;
+  selected->view.y1 = selected->view.clip_y1;
+  return 1;
+}
 
-        // If the line type is '0', this will clear the pixel
-        // If it is '1' or '2', the pixel will be set
-        LCD_Set_Pixel(x, y, colour);
-    }
+void LCD_Pop_Viewport(void) {
+  if (selected->view_depth > 0) {
+    set_view(&selected->view_stack[--selected->view_depth]);
   }
 }
 
-void LCD_Draw_Rect(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const uint8_t colour, const uint8_t fill) {
-    if (fill) {
-        for (int y = y0; y<y0+height; y++) {
-            LCD_Draw_Line(x0, y, x0+(width-1), y, colour);
-        }
+#if !LCD_DISPLAY_LIST
+// Draws a character from the glyph cache. Returns 0 without drawing if it can't be cached
+// (cache disabled, size too big, unknown character or not fully on the screen).
+static uint8_t blit_cached_glyph(char c, const int x, const int y, uint8_t colour, const uint8_t size) {
+  clear_wait();
+#if USE_GLYPH_CACHE
+  if (size == 0 || size > LCD_GLYPH_CACHE_MAX_SIZE || (uint8_t)c < 32 || (uint8_t)c >= 32 + 96 ||
+      x + 5 * size > ST7789V2_WIDTH || y + 7 * size > ST7789V2_HEIGHT) {
+    return 0;
+  }
+  const LCD_Glyph* glyph = find_glyph(c, size, colour & 0x0F, x & 1);
+
+  for (int j = 0; j < 7; j++) {
+    if (!(glyph->lit_rows & (1u << j))) {
+      continue;
     }
-    else {
-        LCD_Draw_Line(x0, y0, x0+(width-1), y0, colour);
-        LCD_Draw_Line(x0, y0+(height-1), x0+(width-1), y0+(height-1), colour);
-        LCD_Draw_Line(x0, y0, x0, y0+(height-1), colour);
-        LCD_Draw_Line(x0+(width-1), y0, x0+(width-1), y0+(height-1), colour);
+    for (int m = 0; m < size; m++) {
+      const int row_y = y + j * size + m;
+      uint8_t* dst = &selected->image_buffer[(ST7789V2_WIDTH * row_y + x) >> 1];
+      for (int b = 0; b < glyph->bytes; b++) {
+        dst[b] = (dst[b] & ~glyph->mask[j][b]) | glyph->data[j][b];
+      }
+      mark_span_dirty(row_y, x + glyph->lit_x0, x + glyph->lit_x1);
     }
+  }
+  return 1;
+#else
+  (void)c; (void)x; (void)y; (void)colour; (void)size;
+  return 0;
+#endif
 }
 
-void LCD_Draw_Sprite_Scaled(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint8_t scale){
-  if (scale == 0) {
+// Draws a string at x, y in screen co-ordinates, clipped to the clip rectangle
+static void print_string(char const *str, const int x, const int y, const uint8_t colour, const uint8_t font_size) {
+  const LCD_View* view = &selected->view;
+  if (y > view->clip_y1 || y + 7 * font_size - 1 < view->clip_y0) {
+    return;  // Above or below the clip rectangle
+  }
+  int n = 0 ; // counter for number of characters in string
+  // loop through string and print character
+  while(*str) {
+    const int char_x = x + n*6*font_size;
+    if (char_x > view->clip_x1) {
+      break;  // The rest of the string is past the right of the clip rectangle
+    }
+    // Whole characters inside the clip rectangle can come from the glyph cache
+    if (char_x + 5*font_size - 1 >= view->clip_x0 &&
+        !(inside_clip(char_x, y, char_x + 5*font_size - 1, y + 7*font_size - 1) &&
+          blit_cached_glyph(*str, char_x, y, colour, font_size))) {
+      // writes the character bitmap data to the buffer, so that text and pixels can be displayed at the same time
+      for (int i = 0; i < 5 ; i++ ) {
+        const int pixel_x = char_x + i*font_size;
+        for (int j = 0; j < 7; j ++) {
+          if (current_font[(*str - 32)*5 + i] & (1u << j)) {
+            for (int m = 0; m < font_size; m++) {
+              clip_span(y+(j*font_size)+m, pixel_x, pixel_x+font_size-1, colour);
+            }
+          }
+        }
+      }
+    }
+    str++; // go to next character in string
+    n++; // increment index
+  }
+}
+#endif
+
+void LCD_printString(char const *str, const uint16_t x, const uint16_t y, uint8_t colour, uint8_t font_size) {
+  clear_wait();
+#if LCD_DISPLAY_LIST
+  LCD_List_Add_Text(str, view_x(x), view_y(y), colour, font_size);
+#else
+  print_string(str, view_x(x), view_y(y), colour, font_size);
+#endif
+}
+
+uint16_t LCD_Measure_String(char const *str, uint8_t font_size) {
+  const size_t length = strlen(str);
+  // Characters are 5 columns with a 1-column gap, scaled
+  return length ? (uint16_t)((6 * length - 1) * font_size) : 0;
+}
+
+void LCD_printString_Aligned(char const *str, const uint16_t x, const uint16_t y, uint8_t colour, uint8_t font_size, const LCD_Align align) {
+  const uint16_t width = LCD_Measure_String(str, font_size);
+  const uint16_t shift = (align == LCD_ALIGN_RIGHT) ? width : (align == LCD_ALIGN_CENTRE) ? width / 2 : 0;
+  // Left of 0 wraps round, and is taken as negative (view_x), so the string is clipped there
+  LCD_printString(str, (uint16_t)(x - shift), y, colour, font_size);
+}
+
+void LCD_printChar(char const c, const uint16_t x, const uint16_t y, uint8_t colour) {
+  const char str[2] = { c, '\0' };
+  LCD_printString(str, x, y, colour, 1);
+}
+
+ST7789V2_RAMFUNC void LCD_Set_Pixel(const uint16_t x, const uint16_t y, uint8_t colour) {
+  clear_wait();
+#if LCD_DISPLAY_LIST
+  if (inside_clip(view_x(x), view_y(y), view_x(x), view_y(y))) {
+    LCD_List_Add_Rect(view_x(x), view_y(y), 1, 1, colour, 1);
+  }
+#else
+  clip_pixel(view_x(x), view_y(y), colour);
+#endif
+}
+
+ST7789V2_RAMFUNC void LCD_Set_Pixels(const uint8_t* xs, const uint8_t* ys, const uint8_t* colours, const uint16_t count) {
+  clear_wait();
+  const LCD_View* view = &selected->view;
+  for (uint16_t i = 0; i < count; i++) {
+    const int x = xs[i] + view->origin_x;
+    const int y = ys[i] + view->origin_y;
+    if (x < view->clip_x0 || x > view->clip_x1 || y < view->clip_y0 || y > view->clip_y1) {
+      continue;
+    }
+#if LCD_DISPLAY_LIST
+    LCD_List_Add_Rect(x, y, 1, 1, colours[i], 1);
+#else
+    put_pixel(x, y, colours[i]);
+#endif
+  }
+}
+
+ST7789V2_RAMFUNC void LCD_Fill_Span(const uint16_t y, uint16_t x0, uint16_t x1, uint8_t colour) {
+  clear_wait();
+  clip_span(view_y(y), view_x(x0), view_x(x1), colour);
+}
+
+uint8_t LCD_Get_Pixel(const uint16_t x, const uint16_t y) {
+  clear_wait();
+  if (x >= ST7789V2_WIDTH || y >= ST7789V2_HEIGHT) {
+    return 0;
+  }
+#if LCD_DISPLAY_LIST
+  uint16_t pixel;
+  LCD_List_Render_Rows(y, 1, x, x, selected->palette_native, &pixel);
+  return palette_index(pixel);
+#elif LCD_BITS_PER_PIXEL == 8
+  return selected->image_buffer[PIXEL_BYTE(x, y)];
+#else
+  const uint8_t double_pixel = selected->image_buffer[(ST7789V2_WIDTH * y + x) >> 1];
+  return (x & 1) ? (double_pixel >> 4) : (double_pixel & 0x0F);
+#endif
+}
+
+uint16_t LCD_Get_Row(const uint16_t y, uint16_t x0, uint16_t x1, uint8_t* out) {
+  clear_wait();
+  if (y >= ST7789V2_HEIGHT || x0 > x1 || x0 >= ST7789V2_WIDTH) {
+    return 0;
+  }
+  if (x1 >= ST7789V2_WIDTH) {
+    x1 = ST7789V2_WIDTH - 1;
+  }
+  const uint16_t count = x1 - x0 + 1;
+#if LCD_DISPLAY_LIST
+  uint16_t pixels[ST7789V2_WIDTH];
+  LCD_List_Render_Rows(y, 1, x0, x1, selected->palette_native, pixels);
+  for (uint16_t i = 0; i < count; i++) {
+    out[i] = palette_index(pixels[i]);
+  }
+#elif LCD_BITS_PER_PIXEL == 8
+  memcpy(out, &selected->image_buffer[PIXEL_BYTE(x0, y)], count);
+#else
+  const uint8_t* row = &selected->image_buffer[(ST7789V2_WIDTH * y) >> 1];
+  uint16_t x = x0;
+
+  // Odd start is the high nibble of its byte
+  if (x & 1) {
+    *out++ = row[x >> 1] >> 4;
+    x++;
+  }
+  // Two pixels per byte read
+  for (; x + 1 <= x1; x += 2) {
+    const uint8_t double_pixel = row[x >> 1];
+    *out++ = double_pixel & 0x0F;
+    *out++ = double_pixel >> 4;
+  }
+  // Even end is the low nibble of its byte
+  if (x == x1) {
+    *out = row[x >> 1] & 0x0F;
+  }
+#endif
+  return count;
+}
+
+void LCD_Fill_Buffer(const uint8_t colour) {
+#if LCD_DISPLAY_LIST
+  // The refresh works out from the list which rows this changes
+  LCD_List_Reset(colour);
+  selected->background = colour & LCD_COLOUR_MASK;
+#else
+  mark_all_dirty(selected);
+  selected->background = colour & LCD_COLOUR_MASK;
+#if LCD_DMA_CLEAR
+  clear_start(selected->image_buffer, FILL_BYTE(selected->background), BUFFER_LENGTH);
+#else
+  fill_bytes(selected->image_buffer, FILL_BYTE(selected->background), BUFFER_LENGTH);
+#endif
+  widgets_cleared(-1, 0, 0);
+  // The buffer is now plain background, which the refresh can send as a solid fill
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    selected->track_changes[y].solid = selected->background + 1;
+    mark_span_clean(&selected->drawn[y]);
+    selected->row_colour[y] = selected->background + 1;
+  }
+#endif
+}
+
+void LCD_Clear_Background(const uint8_t colour) {
+#if LCD_DISPLAY_LIST
+  // Empties the list, only what was drawn needs redrawing so there's nothing more to do
+  LCD_Fill_Buffer(colour);
+#else
+  if ((colour & LCD_COLOUR_MASK) != selected->background) {
+    LCD_Fill_Buffer(colour);
+    return;
+  }
+  clear_wait();
+  const uint8_t double_pixel = FILL_BYTE(selected->background);
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    if (selected->drawn[y].x0 <= selected->drawn[y].x1) {
+      widgets_cleared(y, selected->drawn[y].x0, selected->drawn[y].x1);
+      // Neighbouring pixels sharing a byte with the span are background already
+      const uint16_t first = PIXEL_BYTE(selected->drawn[y].x0, y);
+      const uint16_t last = PIXEL_BYTE(selected->drawn[y].x1, y);
+      fill_bytes(&selected->image_buffer[first], double_pixel, last - first + 1);
+      // The panel still shows what was drawn, so resend it as background. If the row was
+      // already dirty elsewhere, the wider span is only a fill when nothing else is on the row.
+      LCD_Dirty_Span* const changes = &selected->track_changes[y];
+      const uint8_t fill = changes->x0 > changes->x1 || changes->solid == selected->background + 1 ||
+                           selected->row_colour[y] == selected->background + 1;
+      widen_span(changes, selected->drawn[y].x0, selected->drawn[y].x1);
+      changes->solid = fill ? selected->background + 1 : 0;
+      mark_span_clean(&selected->drawn[y]);
+    }
+  }
+#endif
+}
+
+// Writes label followed by value in decimal, returns the length
+static uint8_t format_widget_text(char* text, const char* label, int32_t value) {
+  uint8_t len = 0;
+  while (label && *label && len < LCD_WIDGET_TEXT_LENGTH - 12) {
+    text[len++] = *label++;
+  }
+  char digits[11];
+  uint8_t n = 0;
+  uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+  do {
+    digits[n++] = '0' + (magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude);
+  if (value < 0) {
+    text[len++] = '-';
+  }
+  while (n) {
+    text[len++] = digits[--n];
+  }
+  text[len] = '\0';
+  return len;
+}
+
+#if LCD_TEXT_OVERLAY
+// Marks the rows under a widget's text for sending. Nothing in the image buffer changed, so a
+// row that is plain background is still sent as one (unless the text is on it now, see
+// row_solid())
+static void widget_rows_changed(const LCD_Text_Widget* widget) {
+  if (!widget->width || widget->x >= ST7789V2_WIDTH) {
+    return;
+  }
+  const uint16_t x1 = (widget->x + widget->width - 1 < ST7789V2_WIDTH) ? widget->x + widget->width - 1
+                                                                       : ST7789V2_WIDTH - 1;
+  for (uint16_t y = widget->y; y < widget->y + widget->height && y < ST7789V2_HEIGHT; y++) {
+    widen_span(&selected->track_changes[y], widget->x, x1);
+#if LCD_FRAME_DIFF
+    selected->shown_crc_valid[y] = 0;  // Same image buffer row, different text on it
+#endif
+  }
+}
+
+// Works out again which rows of the display have text on them
+static void widget_rows_update(LCD_Display* display) {
+  memset(display->overlay_rows, 0, sizeof(display->overlay_rows));
+  for (const LCD_Text_Widget* widget = display->widgets; widget; widget = widget->next) {
+    if (!widget->width) {
+      continue;
+    }
+    for (uint16_t y = widget->y; y < widget->y + widget->height && y < ST7789V2_HEIGHT; y++) {
+      display->overlay_rows[y >> 5] |= 1u << (y & 31);
+    }
+  }
+}
+
+// Rasterises a widget's text into its strip, from the current font. Bit 6 * n + i of row j is
+// column i, row j of character n.
+static void rasterise_strip(LCD_Text_Widget* widget, const uint8_t len) {
+  memset(widget->strip, 0, sizeof(widget->strip));
+  for (uint8_t n = 0; n < len; n++) {
+    const uint8_t c = (uint8_t)widget->text[n];
+    if (c < 32 || c >= 32 + 96) {
+      continue;
+    }
+    for (int i = 0; i < 5; i++) {
+      const uint8_t column = current_font[(c - 32)*5 + i];
+      const uint16_t bit = 6 * n + i;
+      for (int j = 0; j < 7; j++) {
+        if (column & (1u << j)) {
+          widget->strip[j][bit >> 5] |= 1u << (bit & 31);
+        }
+      }
+    }
+  }
+}
+#endif
+
+void LCD_Text_Widget_Set_Value(LCD_Text_Widget* widget, int32_t value) {
+  if (!widget->registered) {
+    widget->next = selected->widgets;
+    selected->widgets = widget;
+    widget->registered = 1;
+    widget->stale = 1;
+  }
+#if LCD_TEXT_OVERLAY
+  if (!widget->stale && value == widget->value) {
+    return;  // Already on the screen
+  }
+  widget->value = value;
+  widget->stale = 0;
+
+  // The refresh reads the strip and the rows it covers, so let one that is running finish.
+  // The rows under the old text are resent without it, those under the new text with it.
+  refresh_wait(selected);
+  widget_rows_changed(widget);
+  const uint8_t len = format_widget_text(widget->text, widget->label, value);
+  const uint8_t size = widget->font_size ? widget->font_size : 1;
+  widget->width = len * 6 * size;
+  widget->height = 7 * size;
+  rasterise_strip(widget, len);
+  widget_rows_changed(widget);
+  widget_rows_update(selected);
+#else
+#if LCD_DISPLAY_LIST
+  // Every clear empties the list, so the text is recorded again each time. It is only sent
+  // again if it changed, and there is no old text to erase.
+  widget->stale = 1;
+  widget->width = 0;
+#endif
+  if (!widget->stale && value == widget->value) {
+    return;  // Already on the screen
+  }
+  widget->value = value;
+  widget->stale = 0;
+
+  // Widgets are kept in screen co-ordinates, whatever the viewport
+  const LCD_View view = selected->view;
+  set_view(&screen_view);
+  selected->retained_drawing = 1;
+  // Erase the old text, then draw the new one
+  if (widget->width) {
+    for (uint16_t r = 0; r < widget->height; r++) {
+      LCD_Fill_Span(widget->y + r, widget->x, widget->x + widget->width - 1, selected->background);
+    }
+  }
+  const uint8_t len = format_widget_text(widget->text, widget->label, value);
+  const uint8_t size = widget->font_size ? widget->font_size : 1;
+  widget->width = len * 6 * size;
+  widget->height = 7 * size;
+  LCD_printString(widget->text, widget->x, widget->y, widget->colour, size);
+  selected->retained_drawing = 0;
+  set_view(&view);
+#endif
+}
+
+uint8_t LCD_Retained_Begin(LCD_Retained_Area* area) {
+  if (!area->registered) {
+    area->next = selected->retained_areas;
+    selected->retained_areas = area;
+    area->registered = 1;
+    area->stale = 1;
+  }
+#if LCD_DISPLAY_LIST
+  // Nothing outlives a clear of the list, so the area is always redrawn in full
+  area->stale = 1;
+#endif
+  const uint8_t stale = area->stale;
+  area->stale = 0;
+  selected->retained_drawing = 1;
+  return stale;
+}
+
+void LCD_Retained_End(void) {
+  selected->retained_drawing = 0;
+}
+
+void LCD_Set_Row_Watch(const int16_t y0, const int16_t y1, LCD_Refresh_Callback callback) {
+  selected->row_watch.callback = NULL;  // Not seen half-updated by the interrupt
+  selected->row_watch.y0 = y0;
+  selected->row_watch.y1 = y1;
+  selected->row_watch.callback = callback;
+}
+
+void LCD_Set_Lines_Per_Batch(const uint16_t lines) {
+  LCD_Refresh_Wait();
+  if (lines < 1) {
+    selected->lines_per_batch = 1;
+  } else if (lines > LCD_MAX_LINES_PER_BATCH) {
+    selected->lines_per_batch = LCD_MAX_LINES_PER_BATCH;
+  } else {
+    selected->lines_per_batch = lines;
+  }
+}
+
+// Returns 1 if row y of the front buffer has to be sent. With LCD_FRAME_DIFF, a dirty row whose
+// contents match what the panel shows is marked clean instead, otherwise its hash is updated
+// on the assumption that it will be sent.
+static ST7789V2_RAMFUNC uint8_t row_needs_sending(LCD_Display* display, const int16_t y) {
+  if (display->refresh_changes[y].x0 > display->refresh_changes[y].x1) {
+    return 0;  // Nothing changed on this row
+  }
+  if (y < display->active_y0 || y > display->active_y1) {
+    return 0;  // Not shown in the partial power profile, left dirty for later
+  }
+#if LCD_FRAME_DIFF
+  const uint32_t crc = row_crc(display->refresh_buffer, y);
+  if (display->shown_crc_valid[y] && display->shown_crc[y] == crc) {
+    mark_span_clean(&display->refresh_changes[y]);
+    return 0;
+  }
+  display->shown_crc[y] = crc;
+  display->shown_crc_valid[y] = 1;
+#endif
+  return 1;
+}
+
+#if LCD_PALETTE_ROW_MASKS
+// Records the colours now sent to a row: they replace what it showed when the whole row is
+// sent, and add to it otherwise
+static ST7789V2_RAMFUNC void note_row_colours(LCD_Display* display, const LCD_Pending_Batch* batch,
+                                              const int16_t y, const uint16_t colours) {
+  if (batch->x0 == 0 && batch->x1 == ST7789V2_WIDTH - 1) {
+    display->shown_colours[y] = colours;
+  }
+  else {
+    display->shown_colours[y] |= colours;
+  }
+}
+#endif
+
+#if LCD_TEXT_OVERLAY
+// Lays the text widgets over the batch's rows, just expanded into its line buffer: each lit
+// bit of a strip row covers font_size pixels, clipped to the batch's columns
+static ST7789V2_RAMFUNC void composite_widgets(LCD_Display* display, const LCD_Pending_Batch* batch) {
+  const int span = batch->x1 - batch->x0 + 1;
+  for (const LCD_Text_Widget* widget = display->widgets; widget; widget = widget->next) {
+    const int r0 = (widget->y > batch->y) ? widget->y - batch->y : 0;
+    const int r1 = (widget->y + widget->height < batch->y + batch->rows) ? widget->y + widget->height - batch->y
+                                                                         : batch->rows;
+    const int x0 = (widget->x > batch->x0) ? widget->x : batch->x0;
+    const int x1 = (widget->x + widget->width - 1 < batch->x1) ? widget->x + widget->width - 1 : batch->x1;
+    if (r0 >= r1 || x0 > x1) {
+      continue;
+    }
+#if LCD_DISPLAY_LIST || LCD_BITS_PER_PIXEL == 8
+    const uint16_t pixel = display->palette_native[widget->colour];
+#else
+    const uint16_t pixel = (uint16_t)display->pair_map[(widget->colour & 0x0F) * 0x11];
+#endif
+    const int size = widget->font_size ? widget->font_size : 1;
+    const int c0 = (x0 - widget->x) / size;
+    const int c1 = (x1 - widget->x) / size;
+    for (int r = r0; r < r1; r++) {
+      const uint32_t* bits = widget->strip[(batch->y + r - widget->y) / size];
+      uint16_t* dst = batch->line_buffer + r * span - batch->x0;
+      for (int c = c0; c <= c1; c++) {
+        if (!(bits[c >> 5] & (1u << (c & 31)))) {
+          continue;
+        }
+        const int px0 = (widget->x + c * size > x0) ? widget->x + c * size : x0;
+        const int px1 = (widget->x + c * size + size - 1 < x1) ? widget->x + c * size + size - 1 : x1;
+        for (int px = px0; px <= px1; px++) {
+          dst[px] = pixel;
+        }
+      }
+#if LCD_PALETTE_ROW_MASKS
+      display->shown_colours[batch->y + r] |= 1u << (widget->colour & 0x0F);  // After the row's own
+#endif
+    }
+  }
+}
+#endif
+
+// Expands columns x0..x1 of the batch's rows from the frame being sent into its line buffer,
+// row after row, so they can go out in one DMA transfer. With LCD_TEXT_OVERLAY, the text
+// widgets are then laid over them.
+static ST7789V2_RAMFUNC void expand_rows(LCD_Display* display, const LCD_Pending_Batch* batch) {
+  const int16_t y = batch->y;
+  const uint16_t rows = batch->rows;
+  uint16_t* const line_buffer = batch->line_buffer;
+#if LCD_DISPLAY_LIST || LCD_BITS_PER_PIXEL == 8
+  const uint16_t* const palette_native = display->palette_native;
+#else
+  const uint32_t* const pair_map = display->pair_map;
+#endif
+#if LCD_DISPLAY_LIST
+  // Rasterise the rows from the list straight into the line buffer
+  LCD_List_Render_Rows(y, rows, batch->x0, batch->x1, palette_native, line_buffer);
+#elif LCD_BITS_PER_PIXEL == 8
+  const int span = batch->x1 - batch->x0 + 1;
+  uint16_t* dst = line_buffer;
+  for (uint16_t r = 0; r < rows; r++) {
+    const uint8_t* src = &display->refresh_buffer[PIXEL_BYTE(batch->x0, y + r)];
+    int j = 0;
+    // One palette lookup per pixel, 4 pixels per (unaligned) load, and two pixels packed into
+    // each (unaligned) store: an odd span leaves the next row only halfword aligned
+    for (; j + 4 <= span; j += 4) {
+      uint32_t quad;
+      memcpy(&quad, &src[j], sizeof(quad));
+      const uint32_t pairs[2] = {
+        palette_native[quad & 0xFF] | ((uint32_t)palette_native[(quad >> 8) & 0xFF] << 16),
+        palette_native[(quad >> 16) & 0xFF] | ((uint32_t)palette_native[quad >> 24] << 16)
+      };
+      memcpy(&dst[j], pairs, sizeof(pairs));
+    }
+    for (; j < span; j++) {
+      dst[j] = palette_native[src[j]];
+    }
+#if LCD_PALETTE_ROW_MASKS
+    uint16_t colours = 0;
+    for (j = 0; j < span; j++) {
+      colours |= 1u << (src[j] & 0x0F);
+    }
+    note_row_colours(display, batch, y + r, colours);
+#endif
+    dst += span;
+  }
+#else
+  const int bytes_in_span = (batch->x1 - batch->x0 + 1) >> 1;
+  uint16_t* dst = line_buffer;
+  for (uint16_t r = 0; r < rows; r++) {
+    const uint8_t* src = &display->refresh_buffer[(ST7789V2_WIDTH * (y + r) + batch->x0) >> 1];
+    // Each row is a whole number of bytes, so dst stays word aligned from row to row
+    uint32_t* dst_pairs = (uint32_t*)dst;
+    int j = 0;
+    // Read 4 bytes (8 pixels) at a time, the Cortex-M4 handles the unaligned load
+    for (; j + 4 <= bytes_in_span; j += 4) {
+      uint32_t quad;
+      memcpy(&quad, &src[j], sizeof(quad));
+      dst_pairs[j] = pair_map[quad & 0xFF];
+      dst_pairs[j + 1] = pair_map[(quad >> 8) & 0xFF];
+      dst_pairs[j + 2] = pair_map[(quad >> 16) & 0xFF];
+      dst_pairs[j + 3] = pair_map[quad >> 24];
+    }
+    for (; j < bytes_in_span; j++) {
+      dst_pairs[j] = pair_map[src[j]];
+    }
+#if LCD_PALETTE_ROW_MASKS
+    uint16_t colours = 0;
+    for (j = 0; j < bytes_in_span; j++) {
+      colours |= (1u << (src[j] & 0x0F)) | (1u << (src[j] >> 4));
+    }
+    note_row_colours(display, batch, y + r, colours);
+#endif
+    dst += 2 * bytes_in_span;
+  }
+#endif
+#if LCD_TEXT_OVERLAY
+  composite_widgets(display, batch);
+#endif
+}
+
+// 1 + the colour of a dirty row that can be sent as a fill of it, otherwise 0
+static ST7789V2_RAMFUNC uint16_t row_solid(const LCD_Display* display, const int16_t y) {
+#if LCD_TEXT_OVERLAY
+  if (display->overlay_rows[y >> 5] & (1u << (y & 31))) {
+    return 0;  // The text is only laid over expanded rows
+  }
+#endif
+  return display->refresh_changes[y].solid;
+}
+
+#if LCD_ROW_CACHE_ROWS
+// The row cached from pixels with this hash and the current palette, or NULL
+static ST7789V2_RAMFUNC LCD_Cached_Row* row_cache_find(LCD_Display* display, const uint32_t hash) {
+  for (int i = 0; i < LCD_ROW_CACHE_ROWS; i++) {
+    LCD_Cached_Row* const cached = &display->row_cache[i];
+    if (cached->valid && cached->hash == hash && cached->palette == display->palette_generation) {
+      return cached;
+    }
+  }
+  return NULL;
+}
+
+// 1 if row y of the frame being sent can't go from the cache: text is laid over it (which
+// the hash doesn't cover), or it is neither cached nor the same as last time it was sent
+static ST7789V2_RAMFUNC uint8_t row_uncached(LCD_Display* display, const int16_t y, const uint32_t hash) {
+#if LCD_TEXT_OVERLAY
+  if (display->overlay_rows[y >> 5] & (1u << (y & 31))) {
+    return 1;
+  }
+#endif
+  return hash != display->sent_hash[y] && !row_cache_find(display, hash);
+}
+
+// Returns 1 if dirty row y is to be expanded with the rows of a batch, and records that it
+// was sent with its pixels. 0 leaves it to go on its own from the cache, in the next batch
+// (which hashes it again).
+static ST7789V2_RAMFUNC uint8_t row_cache_skip(LCD_Display* display, const int16_t y) {
+  const uint32_t hash = row_crc(display->refresh_buffer, y);
+  if (!row_uncached(display, y, hash)) {
+    return 0;
+  }
+  display->sent_hash[y] = hash;
+  return 1;
+}
+
+// The cached copy of dirty row y, expanded into the least recently used entry first if the
+// row was last sent with the same pixels, or NULL to expand it with the rows after it
+static ST7789V2_RAMFUNC LCD_Cached_Row* row_cache_get(LCD_Display* display, const int16_t y) {
+  const uint32_t hash = row_crc(display->refresh_buffer, y);
+  if (row_uncached(display, y, hash)) {
+    display->sent_hash[y] = hash;
+    return NULL;
+  }
+  LCD_Cached_Row* cached = row_cache_find(display, hash);
+  if (!cached) {
+    // Not an entry a queued batch is still sending from
+    for (int i = 0; i < LCD_ROW_CACHE_ROWS; i++) {
+      LCD_Cached_Row* const entry = &display->row_cache[i];
+      if (!entry->sending && (!cached || !entry->valid || (cached->valid && entry->used < cached->used))) {
+        cached = entry;
+      }
+    }
+    if (!cached) {
+      return NULL;
+    }
+    const LCD_Pending_Batch row = { .y = y, .rows = 1, .x0 = 0, .x1 = ST7789V2_WIDTH - 1,
+                                    .line_buffer = cached->pixels };
+    expand_rows(display, &row);
+    cached->hash = hash;
+    cached->palette = display->palette_generation;
+    cached->valid = 1;
+#if LCD_PALETTE_ROW_MASKS
+    cached->colours = display->shown_colours[y];  // Just worked out for the whole row
+#endif
+  }
+#if LCD_PALETTE_ROW_MASKS
+  else {
+    display->shown_colours[y] = cached->colours;
+  }
+#endif
+  cached->used = ++display->row_cache_clock;
+  return cached;
+}
+#endif
+
+// Finds the next dirty row at or after from_row and gathers up to lines_per_batch
+// contiguous dirty rows after it. The union of their column spans is expanded into the
+// given line buffer, row after row, so the batch can go out in one DMA transfer.
+// Rows that are plain background are batched separately, and only their colour is stored
+// for a fill. The rows are marked clean, as their pixels have now been captured.
+static ST7789V2_RAMFUNC LCD_Pending_Batch prepare_batch(LCD_Display* display, int16_t from_row, uint16_t* line_buffer) {
+  LCD_Pending_Batch batch = { .y = -1, .rows = 0, .line_buffer = line_buffer };
+  LCD_Dirty_Span* const refresh_changes = display->refresh_changes;
+
+  int16_t y = from_row;
+  while (y < ST7789V2_HEIGHT && !row_needs_sending(display, y)) {
+    y++;
+  }
+  if (y >= ST7789V2_HEIGHT) {
+    return batch;
+  }
+
+  // Grow the batch while the following rows are dirty too, and solid in the same colour or not
+  const uint8_t solid = row_solid(display, y);
+  uint16_t x0 = refresh_changes[y].x0;
+  uint16_t x1 = refresh_changes[y].x1;
+#if LCD_ROW_CACHE_ROWS
+  // A cached row goes on its own, sent from the cache
+  LCD_Cached_Row* const cached = solid ? NULL : row_cache_get(display, y);
+  if (cached) {
+    batch.y = y;
+    batch.rows = 1;
+#if LCD_BITS_PER_PIXEL == 8
+    batch.x0 = x0;
+    batch.x1 = x1;
+#else
+    batch.x0 = x0 & ~1u;
+    batch.x1 = x1 | 1u;
+#endif
+    batch.line_buffer = &cached->pixels[batch.x0];
+    batch.cached = cached;
+    display->stats.rows_sent++;
+    display->stats.rows_cached++;
+    display->stats.bytes_sent += 2u * (batch.x1 - batch.x0 + 1);
+    mark_span_clean(&refresh_changes[y]);
+    return batch;
+  }
+#endif
+  uint16_t rows = 1;
+  while (rows < display->lines_per_batch && y + rows < ST7789V2_HEIGHT &&
+         row_solid(display, y + rows) == solid && row_needs_sending(display, y + rows)) {
+#if LCD_ROW_CACHE_ROWS
+    if (!solid && !row_cache_skip(display, y + rows)) {
+      break;
+    }
+#endif
+    if (refresh_changes[y + rows].x0 < x0) x0 = refresh_changes[y + rows].x0;
+    if (refresh_changes[y + rows].x1 > x1) x1 = refresh_changes[y + rows].x1;
+    rows++;
+  }
+
+  batch.y = y;
+  batch.rows = rows;
+#if LCD_BITS_PER_PIXEL == 8
+  batch.x0 = x0;
+  batch.x1 = x1;
+#else
+  // Widen the span to whole bytes, as each byte of the image buffer holds two pixels
+  batch.x0 = x0 & ~1u;
+  batch.x1 = x1 | 1u;
+#endif
+  display->stats.rows_sent += rows;
+  display->stats.bytes_sent += 2u * rows * (batch.x1 - batch.x0 + 1);
+
+#if LCD_DISPLAY_LIST || LCD_BITS_PER_PIXEL == 8
+  const uint16_t* const palette_native = display->palette_native;
+#else
+  const uint32_t* const pair_map = display->pair_map;
+#endif
+  if (solid) {
+    // One pixel of the colour is all a fill needs, low half of its pair map entry
+    const uint8_t colour = solid - 1;
+#if LCD_DISPLAY_LIST || LCD_BITS_PER_PIXEL == 8
+    line_buffer[0] = palette_native[colour];
+#else
+    line_buffer[0] = (uint16_t)pair_map[colour | (colour << 4)];
+#endif
+    batch.solid = 1;
+    for (uint16_t r = 0; r < rows; r++) {
+      mark_span_clean(&refresh_changes[y + r]);
+#if LCD_PALETTE_ROW_MASKS
+      note_row_colours(display, &batch, y + r, 1u << (colour & 0x0F));
+#endif
+    }
+    return batch;
+  }
+
+  for (uint16_t r = 0; r < rows; r++) {
+    mark_span_clean(&refresh_changes[y + r]);
+  }
+  expand_rows(display, &batch);
+  return batch;
+}
+
+// Starts sending a prepared batch. ST7789V2_Set_Address_Window first waits for the
+// previous transfer to drain out of the SPI.
+static ST7789V2_RAMFUNC void send_batch(ST7789V2_cfg_t* cfg, const LCD_Pending_Batch* batch) {
+  ST7789V2_Set_Address_Window(cfg, batch->x0, batch->y, batch->x1, batch->y + batch->rows - 1);
+  if (batch->solid) {
+    // Same pixel over and over, no memory increment (sends RAMWR itself)
+    ST7789V2_Fill(cfg, batch->line_buffer, batch->rows * (batch->x1 - batch->x0 + 1));
+  }
+  else {
+    ST7789V2_Send_Command(cfg, ST7789_RAMWR);
+    ST7789V2_Send_Pixels(cfg, batch->line_buffer, batch->rows * (batch->x1 - batch->x0 + 1));
+  }
+}
+
+#if LCD_REFRESH_CHECK
+static LCD_Check_Callback check_callback = NULL;
+
+void LCD_Set_Check_Callback(LCD_Check_Callback callback) {
+  check_callback = callback;
+}
+
+#if !ST7789V2_HOST
+// CRC-32 of count RGB565 pixels with the CRC peripheral, two to a word write
+static uint32_t pixels_crc(const uint16_t* pixels, const uint16_t count) {
+  CRC->CR = CRC_CR_RESET;
+  uint16_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    CRC->DR = pixels[i] | ((uint32_t)pixels[i + 1] << 16);
+  }
+  if (i < count) {
+    *(__IO uint16_t*)&CRC->DR = pixels[i];  // A halfword write hashes 16 bits
+  }
+  return CRC->DR;
+}
+#else
+// The CRC peripheral's CRC-32 (polynomial 0x04C11DB7, MSB first, from 0xFFFFFFFF) in software,
+// so the host reports the same values
+static uint32_t crc_bits(uint32_t crc, const uint32_t data, const int bits) {
+  for (int b = bits - 1; b >= 0; b--) {
+    crc = (((crc >> 31) ^ (data >> b)) & 1u) ? (crc << 1) ^ 0x04C11DB7u : crc << 1;
+  }
+  return crc;
+}
+
+static uint32_t pixels_crc(const uint16_t* pixels, const uint16_t count) {
+  uint32_t crc = 0xFFFFFFFFu;
+  uint16_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    crc = crc_bits(crc, pixels[i] | ((uint32_t)pixels[i + 1] << 16), 32);
+  }
+  if (i < count) {
+    crc = crc_bits(crc, pixels[i], 16);
+  }
+  return crc;
+}
+#endif
+
+// Columns x0..x1 of row y of the frame being sent, as the refresh should send them, worked out
+// a pixel at a time straight from the palette (8bpp entries above 15 from the native colours
+// kept for them). Text widgets are laid over it as the refresh does.
+static void expected_row(LCD_Display* display, const int16_t y, const uint16_t x0, const uint16_t x1, uint16_t* out) {
+  for (uint16_t x = x0; x <= x1; x++) {
+    const uint8_t byte = display->refresh_buffer[PIXEL_BYTE(x, y)];
+#if LCD_BITS_PER_PIXEL == 8
+    out[x - x0] = (byte < 16) ? native_colour(display->colour_map[byte]) : display->palette_native[byte];
+#else
+    out[x - x0] = native_colour(display->colour_map[(x & 1) ? byte >> 4 : byte & 0x0F]);
+#endif
+  }
+#if LCD_TEXT_OVERLAY
+  const LCD_Pending_Batch row = { .y = y, .rows = 1, .x0 = x0, .x1 = x1, .line_buffer = out };
+  composite_widgets(display, &row);
+#endif
+}
+
+// Counts a row checked, and reports it if the CRC of what went out doesn't match
+static void check_row(LCD_Display* display, const int16_t y, const uint32_t crc, const uint32_t expected,
+                      const uint8_t read_back) {
+  display->stats.check_rows++;
+  if (crc != expected) {
+    display->stats.check_mismatches++;
+    if (check_callback) {
+      check_callback(y, crc, expected, read_back);
+    }
+  }
+}
+
+// Checks each row of a batch that has just started sending, reading its line buffer alongside
+// the DMA
+static void check_batch(LCD_Display* display, const LCD_Pending_Batch* batch) {
+  const uint16_t span = batch->x1 - batch->x0 + 1;
+  uint16_t row[ST7789V2_WIDTH];
+  uint32_t fill_crc = 0;
+  if (batch->solid) {
+    // Every pixel of every row is the fill colour
+    for (uint16_t x = 0; x < span; x++) {
+      row[x] = batch->line_buffer[0];
+    }
+    fill_crc = pixels_crc(row, span);
+  }
+  for (uint16_t r = 0; r < batch->rows; r++) {
+    const uint32_t crc = batch->solid ? fill_crc : pixels_crc(batch->line_buffer + r * span, span);
+    expected_row(display, batch->y + r, batch->x0, batch->x1, row);
+    check_row(display, batch->y + r, crc, pixels_crc(row, span), 0);
+  }
+}
+#endif
+
+#if LCD_DISPLAY_LIST
+// Marks a row the display list reports as changed for sending (only one display with the list)
+static void list_row_changed(const uint16_t y, const uint8_t x0, const uint8_t x1, const uint8_t empty) {
+  widen_span(&displays[0].track_changes[y], x0, x1);
+  displays[0].track_changes[y].solid = empty ? displays[0].background + 1 : 0;
+}
+#endif
+
+// Hands the frame drawn so far over to the refresh. With LCD_DOUBLE_BUFFER the buffers are
+// swapped, and the rows that changed are copied into the new back buffer, so that it matches
+// what is being sent and drawing can carry on incrementally from the frame just presented.
+// With LCD_DISPLAY_LIST the rows whose commands changed are marked dirty.
+// Must only be called when no refresh is running.
+static void present_frame(LCD_Display* display) {
+  clear_wait();
+#if !LCD_DISPLAY_LIST
+  // Dirty rows that are a single colour go as fills, with no expansion through the palette
+  // (e.g. after a palette change or LCD_Set_Palette() marked every row)
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    LCD_Dirty_Span* const changes = &display->track_changes[y];
+    if (!changes->solid && changes->x0 <= changes->x1 && display->row_colour[y] &&
+        display->drawn[y].x0 > display->drawn[y].x1) {
+      changes->solid = display->row_colour[y];
+    }
+  }
+#endif
+#if LCD_DISPLAY_LIST
+  (void)display;
+  LCD_List_Present(list_row_changed);
+#elif LCD_DOUBLE_BUFFER
+  LCD_Dirty_Span* spans = display->track_changes;
+  display->track_changes = display->refresh_changes;
+  display->refresh_changes = spans;
+
+  uint8_t* front = display->image_buffer;
+  display->image_buffer = display->refresh_buffer;
+  display->refresh_buffer = front;
+
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    if (display->refresh_changes[y].x0 <= display->refresh_changes[y].x1) {
+      const uint16_t first = PIXEL_BYTE(display->refresh_changes[y].x0, y);
+      const uint16_t last = PIXEL_BYTE(display->refresh_changes[y].x1, y);
+      memcpy(&display->image_buffer[first], &display->refresh_buffer[first], last - first + 1);
+    }
+  }
+#else
+  (void)display;
+#endif
+}
+
+// Waits for the display's background refresh, and for those of any other display on the same
+// SPI, so that a new refresh of the display can use the bus
+static void bus_wait(LCD_Display* display) {
+  for (int i = 0; i < LCD_MAX_DISPLAYS; i++) {
+    if (&displays[i] == display || (displays[i].refresh_async.cfg &&
+                                    displays[i].refresh_async.cfg->spi == display->cfg->spi)) {
+      refresh_wait(&displays[i]);
+    }
+  }
+}
+
+void LCD_Refresh(ST7789V2_cfg_t* cfg) {
+  LCD_Display* display = display_for(cfg);
+  // Don't interleave with a background refresh that is still running
+  bus_wait(display);
+  present_frame(display);
+  display->stats.refreshes++;
+
+  // Alternate between the two line buffers so one can be filled while the other
+  // is still being sent by DMA. The buffer being filled was last used two transfers
+  // ago, which ST7789V2_Set_Address_Window has already waited for.
+  int buf = 0;
+  LCD_Pending_Batch batch = prepare_batch(display, 0, display->line_buffers[0]);
+  while (batch.y >= 0) {
+    send_batch(cfg, &batch);
+#if LCD_REFRESH_CHECK
+    check_batch(display, &batch);
+#endif
+    buf = !buf;
+    batch = prepare_batch(display, batch.y + batch.rows, display->line_buffers[buf]);
+  }
+}
+
+// Takes columns x0..x1, just sent, off a row's changes. Changes reaching past both ends stay
+// as they are, as a span can't have a hole in it.
+static inline void trim_span(LCD_Dirty_Span* span, const uint16_t x0, const uint16_t x1) {
+  if (span->x0 > span->x1 || span->x1 < x0 || span->x0 > x1) {
+    return;  // Nothing changed in the columns sent
+  }
+  if (span->x0 >= x0 && span->x1 <= x1) {
+    mark_span_clean(span);
+  } else if (span->x0 >= x0) {
+    span->x0 = x1 + 1;
+  } else if (span->x1 <= x1) {
+    span->x1 = x0 - 1;
+  }
+}
+
+void LCD_Refresh_Region(ST7789V2_cfg_t* cfg, const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1) {
+  LCD_Display* display = display_for(cfg);
+  bus_wait(display);
+  present_frame(display);
+
+  // Only the rows shown in the partial power profile
+  const uint16_t top = (y0 > display->active_y0) ? y0 : display->active_y0;
+  uint16_t bottom = (y1 < ST7789V2_HEIGHT - 1) ? y1 : ST7789V2_HEIGHT - 1;
+  if (bottom > display->active_y1) {
+    bottom = display->active_y1;
+  }
+  const uint16_t right = (x1 < ST7789V2_WIDTH - 1) ? x1 : ST7789V2_WIDTH - 1;
+  if (x0 > right || top > bottom) {
+    return;
+  }
+
+  LCD_Pending_Batch batch = { .x0 = x0, .x1 = right, .solid = 0 };
+#if LCD_BITS_PER_PIXEL != 8
+  // Whole bytes of the image buffer, as in prepare_batch()
+  batch.x0 &= ~1u;
+  batch.x1 |= 1u;
+#endif
+  const uint16_t width = batch.x1 - batch.x0 + 1;
+  for (uint16_t y = top; y <= bottom; y++) {
+    trim_span(&display->refresh_changes[y], batch.x0, batch.x1);
+#if LCD_FRAME_DIFF
+    display->shown_crc_valid[y] = 0;  // Part of the row may still differ from the panel
+#endif
+  }
+
+  // One window for the whole region, filled by as many rows as fit in a line buffer at a time,
+  // alternating between the two as LCD_Refresh does
+  const uint16_t rows_per_batch = (LCD_MAX_LINES_PER_BATCH * ST7789V2_WIDTH) / width;
+  ST7789V2_Set_Address_Window(cfg, batch.x0, top, batch.x1, bottom);
+  ST7789V2_Send_Command(cfg, ST7789_RAMWR);
+  int buf = 0;
+  for (uint16_t y = top; y <= bottom; y += batch.rows) {
+    batch.y = y;
+    batch.rows = (bottom - y + 1 < rows_per_batch) ? bottom - y + 1 : rows_per_batch;
+    batch.line_buffer = display->line_buffers[buf];
+    expand_rows(display, &batch);
+    ST7789V2_Send_Pixels(cfg, batch.line_buffer, batch.rows * width);
+#if LCD_REFRESH_CHECK
+    check_batch(display, &batch);
+#endif
+    display->stats.bytes_sent += 2u * batch.rows * width;
+    buf = !buf;
+  }
+}
+
+#if LCD_REFRESH_CHECK
+uint16_t LCD_Self_Test(ST7789V2_cfg_t* cfg) {
+  LCD_Display* display = display_for(cfg);
+#if LCD_MAX_DISPLAYS > 1
+  LCD_Display* const was_selected = selected;
+  selected = display;
+#endif
+  bus_wait(display);
+
+  // Every byte value somewhere on the rows, so every colour and every pair of neighbours is
+  // expanded, and every 8th row plain, to go as a fill
+  LCD_Fill_Buffer(0);
+  clear_wait();
+  for (uint16_t y = 0; y < ST7789V2_HEIGHT; y++) {
+    if ((y & 7) == 7) {
+      continue;
+    }
+    uint8_t* row = &display->image_buffer[PIXEL_BYTE(0, y)];
+    for (uint16_t b = 0; b < ROW_BYTES; b++) {
+      row[b] = (uint8_t)((b * 29u) ^ (y * 87u) ^ (b >> 3));
+    }
+    mark_span_dirty(y, 0, ST7789V2_WIDTH - 1);
+  }
+  const uint32_t mismatches = display->stats.check_mismatches;
+  LCD_Refresh(cfg);
+
+  // What the panel now holds, a row at a time through the first line buffer
+  uint16_t* const pixels = display->line_buffers[0];
+  uint16_t row[ST7789V2_WIDTH];
+  for (uint16_t y = 0; y < ST7789V2_HEIGHT; y += LCD_SELF_TEST_ROW_STEP) {
+    ST7789V2_Read_Pixels(cfg, 0, y, ST7789V2_WIDTH - 1, y, pixels);
+    expected_row(display, y, 0, ST7789V2_WIDTH - 1, row);
+    check_row(display, y, pixels_crc(pixels, ST7789V2_WIDTH), pixels_crc(row, ST7789V2_WIDTH), 1);
+  }
+  const uint16_t failed = display->stats.check_mismatches - mismatches;
+
+  LCD_Fill_Buffer(0);
+#if LCD_MAX_DISPLAYS > 1
+  selected = was_selected;
+#endif
+  return failed;
+}
+#endif
+
+// Sends the rows of an opened image, decoding each batch while the one before goes out
+static uint8_t show_decoded(ST7789V2_cfg_t* cfg, const uint16_t x0, const uint16_t y0, LCD_Image_Decoder* decoder) {
+  LCD_Display* display = display_for(cfg);
+  if (x0 + decoder->width > ST7789V2_WIDTH || y0 >= ST7789V2_HEIGHT) {
+    return 0;
+  }
+  bus_wait(display);
+
+  // Batches of rows, alternating between the line buffers as LCD_Refresh does. The row above
+  // the first of a batch is the last of the one before, still in the other buffer (being sent,
+  // which only reads it).
+  const uint16_t rows = (y0 + decoder->height > ST7789V2_HEIGHT) ? ST7789V2_HEIGHT - y0 : decoder->height;
+  const uint16_t width = decoder->width;
+  const uint16_t* above = NULL;
+  uint8_t ok = 1;
+  int buf = 0;
+  for (uint16_t r = 0; r < rows; ) {
+    LCD_Pending_Batch batch = { .y = y0 + r, .x0 = x0, .x1 = x0 + width - 1,
+                                .line_buffer = display->line_buffers[buf], .solid = 0 };
+    batch.rows = (rows - r < display->lines_per_batch) ? rows - r : display->lines_per_batch;
+    for (uint16_t i = 0; i < batch.rows; i++) {
+      uint16_t* row = batch.line_buffer + i * width;
+      if (ok && !LCD_Image_Decode_Row(decoder, row, above)) {
+        ok = 0;
+      }
+      if (!ok) {
+        memset(row, 0, width * sizeof(uint16_t));
+      }
+      above = row;
+    }
+    send_batch(cfg, &batch);
+    display->stats.bytes_sent += 2u * batch.rows * width;
+    buf = !buf;
+    r += batch.rows;
+  }
+
+  // The image buffer does not have the image: have the next clear resend the rows, and with
+  // LCD_FRAME_DIFF, don't take them for what the panel shows
+  for (uint16_t r = 0; r < rows; r++) {
+    widen_span(&display->drawn[y0 + r], x0, x0 + width - 1);
+#if LCD_FRAME_DIFF
+    display->shown_crc_valid[y0 + r] = 0;
+#endif
+  }
+  return ok;
+}
+
+uint8_t LCD_Show_Image(ST7789V2_cfg_t* cfg, const uint16_t x0, const uint16_t y0, const uint8_t* image, const uint32_t length) {
+  LCD_Image_Decoder decoder;
+  return LCD_Image_Open(&decoder, image, length) && show_decoded(cfg, x0, y0, &decoder);
+}
+
+uint8_t LCD_Show_Image_Stream(ST7789V2_cfg_t* cfg, const uint16_t x0, const uint16_t y0, LCD_Image_Reader reader,
+                              void* context, uint8_t* window, const uint32_t window_bytes) {
+  LCD_Image_Decoder decoder;
+  return LCD_Image_Open_Stream(&decoder, reader, context, window, window_bytes) &&
+         show_decoded(cfg, x0, y0, &decoder);
+}
+
+// Runs when a batch has been sent, given the batch queued after it (or NULL). Batches go out
+// top to bottom, so once one covering the watched rows has been sent and the next starts below
+// them (or there is none), every watched row that changed is on the panel.
+static ST7789V2_RAMFUNC void row_watch_check(LCD_Display* display, const LCD_Pending_Batch* sent, const LCD_Pending_Batch* next) {
+  if (display->row_watch.callback == NULL || display->row_watch.done) {
+    return;
+  }
+  if (sent->y <= display->row_watch.y1 && sent->y + sent->rows - 1 >= display->row_watch.y0) {
+    display->row_watch.seen = 1;
+  }
+  if (display->row_watch.seen && (next == NULL || next->y > display->row_watch.y1)) {
+    display->row_watch.done = 1;
+    display->row_watch.callback();
+  }
+}
+
+// Prepares and queues batches until the rows or the queue run out, or a pixel batch needs a
+// line buffer and both are queued. Fills need none, so a run of them is queued all at once.
+static ST7789V2_RAMFUNC void refresh_async_fill(LCD_Display* display) {
+  LCD_Async_Refresh* const refresh_async = &display->refresh_async;
+  while (refresh_async->next_row < ST7789V2_HEIGHT && refresh_async->queued < ASYNC_BATCHES &&
+         ST7789V2_Queue_Space(&display->refresh_queue) >= 2) {
+    const int8_t buffer = !refresh_async->buffer_busy[0] ? 0 : !refresh_async->buffer_busy[1] ? 1 : -1;
+    if (buffer < 0) {
+      return;
+    }
+    LCD_Pending_Batch* batch = &refresh_async->batches[(refresh_async->first + refresh_async->queued) % ASYNC_BATCHES];
+    *batch = prepare_batch(display, refresh_async->next_row, display->line_buffers[buffer]);
+    if (batch->y < 0) {
+      refresh_async->next_row = ST7789V2_HEIGHT;
+      return;
+    }
+    refresh_async->next_row = batch->y + batch->rows;
+
+    ST7789V2_Transaction txn = { .type = ST7789V2_TXN_WINDOW, .x0 = batch->x0, .y0 = batch->y,
+                                 .x1 = batch->x1, .y1 = batch->y + batch->rows - 1 };
+    ST7789V2_Queue_Push(&display->refresh_queue, &txn);
+    if (batch->solid) {
+      batch->fill = batch->line_buffer[0];
+      batch->buffer = -1;
+      txn.type = ST7789V2_TXN_FILL;
+      txn.pixels = &batch->fill;
+#if LCD_ROW_CACHE_ROWS
+    } else if (batch->cached) {
+      // Sent from the cache, no line buffer held
+      batch->buffer = -1;
+      batch->cached->sending++;
+      txn.type = ST7789V2_TXN_PIXELS;
+      txn.pixels = batch->line_buffer;
+#endif
+    } else {
+      batch->buffer = buffer;
+      refresh_async->buffer_busy[buffer] = 1;
+      txn.type = ST7789V2_TXN_PIXELS;
+      txn.pixels = batch->line_buffer;
+    }
+    txn.count = batch->rows * (batch->x1 - batch->x0 + 1);
+    ST7789V2_Queue_Push(&display->refresh_queue, &txn);
+    refresh_async->queued++;
+  }
+}
+
+static ST7789V2_RAMFUNC void refresh_async_finish(LCD_Display* display) {
+  display->refresh_async.busy = 0;
+  if (display->refresh_async.callback) {
+    display->refresh_async.callback();
+  }
+}
+
+// Drops the rest of a background refresh after a fault, so nothing is left waiting for it.
+// Call with the DMA interrupt unable to run (from it, or masked).
+static ST7789V2_RAMFUNC void refresh_async_abort(LCD_Display* display) {
+  LCD_Async_Refresh* const refresh_async = &display->refresh_async;
+  ST7789V2_DMA_Abort(refresh_async->cfg);
+  display->refresh_queue.head = display->refresh_queue.tail;
+  display->refresh_queue.running = 0;
+  refresh_async->queued = 0;
+  refresh_async->wait_te = 0;
+  refresh_async->buffer_busy[0] = 0;
+  refresh_async->buffer_busy[1] = 0;
+#if LCD_ROW_CACHE_ROWS
+  for (int i = 0; i < LCD_ROW_CACHE_ROWS; i++) {
+    display->row_cache[i].sending = 0;
+  }
+#endif
+  refresh_async_finish(display);
+}
+
+// Starts sending the queued batches, at the TE pulse if the refresh waits for one
+static ST7789V2_RAMFUNC void refresh_async_start(LCD_Display* display) {
+  if (display->refresh_async.queued == 0) {
+    refresh_async_finish(display);
+    return;
+  }
+  ST7789V2_Queue_Run(display->refresh_async.cfg, &display->refresh_queue);
+}
+
+// The oldest queued batch has been sent. The queue has already started the next one, so
+// its line buffer is refilled while that goes out.
+static ST7789V2_RAMFUNC void refresh_async_sent(LCD_Display* display) {
+  LCD_Async_Refresh* const refresh_async = &display->refresh_async;
+  ST7789V2_Queue_Transfer_Done(refresh_async->cfg, &display->refresh_queue);
+  // Copied, as the refill may reuse its slot
+  const LCD_Pending_Batch sent = refresh_async->batches[refresh_async->first];
+  if (sent.buffer >= 0) {
+    refresh_async->buffer_busy[sent.buffer] = 0;
+  }
+#if LCD_ROW_CACHE_ROWS
+  if (sent.cached) {
+    sent.cached->sending--;
+  }
+#endif
+  refresh_async->first = (refresh_async->first + 1) % ASYNC_BATCHES;
+  refresh_async->queued--;
+
+  refresh_async_fill(display);
+  // Only does anything if the queue had run dry before the refill
+  ST7789V2_Queue_Run(refresh_async->cfg, &display->refresh_queue);
+
+  row_watch_check(display, &sent, refresh_async->queued ? &refresh_async->batches[refresh_async->first] : NULL);
+  if (refresh_async->queued == 0) {
+    refresh_async_finish(display);
+  }
+}
+
+void LCD_RefreshAsync(ST7789V2_cfg_t* cfg, LCD_Refresh_Callback callback) {
+  LCD_Display* display = display_for(cfg);
+  bus_wait(display);
+  present_frame(display);
+  display->stats.refreshes++;
+
+  display->refresh_async.cfg = cfg;
+  display->refresh_async.callback = callback;
+  display->refresh_async.first = 0;
+  display->refresh_async.queued = 0;
+  display->refresh_async.next_row = 0;
+  display->refresh_async.buffer_busy[0] = 0;
+  display->refresh_async.buffer_busy[1] = 0;
+  display->row_watch.seen = 0;
+  display->row_watch.done = 0;
+  display->refresh_async.busy = 1;
+
+  // As much of the frame as fits is queued now, the DMA interrupt queues the rest
+  refresh_async_fill(display);
+  if (display->te) {
+    // Start writing at the panel's vertical blank, ahead of its scan, so the frame doesn't tear
+    display->refresh_async.wait_te = 1;
+    return;
+  }
+  refresh_async_start(display);
+}
+
+void LCD_Swap(ST7789V2_cfg_t* cfg) {
+  LCD_RefreshAsync(cfg, NULL);
+}
+
+void LCD_Wait_Draw_Buffer(void) {
+#if !LCD_DOUBLE_BUFFER
+  // The only buffer is the one being sent
+  LCD_Refresh_Wait();
+#endif
+}
+
+ST7789V2_RAMFUNC void LCD_TE_IRQHandler(void) {
+  // Displays' TE pins may share the EXTI line's interrupt, so check each
+  for (int i = 0; i < LCD_MAX_DISPLAYS; i++) {
+    LCD_Display* display = &displays[i];
+    if (display->te && ST7789V2_TE_Clear(display->cfg)) {
+      display->te_count++;
+      if (display->refresh_async.wait_te) {
+        display->refresh_async.wait_te = 0;
+        refresh_async_start(display);
+      }
+    }
+  }
+}
+
+uint32_t LCD_Get_TE_Count(void) {
+  return selected->te_count;
+}
+
+uint8_t LCD_Refresh_Busy(void) {
+  return selected->refresh_async.busy;
+}
+
+static void refresh_wait(LCD_Display* display) {
+  if (display->refresh_async.busy) {
+    display->stats.waits++;
+  }
+#if ST7789V2_HOST
+  while (display->refresh_async.busy);
+#else
+  // Sleeps between the interrupts that move the refresh on. Masked around the check so
+  // the last one landing just before WFI still wakes the core. Each transfer moves the
+  // queue on; one that doesn't for LCD_REFRESH_STALL_MS has stopped for good. A caller
+  // with interrupts masked gets them back masked.
+  uint8_t head = display->refresh_queue.head;
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  const uint32_t stall_cycles = SystemCoreClock / 1000u * LCD_REFRESH_STALL_MS;
+  uint32_t moved_at = DWT->CYCCNT;
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  while (display->refresh_async.busy) {
+    __WFI();
+    __enable_irq();
+    __disable_irq();
+    if (display->refresh_queue.head != head) {
+      head = display->refresh_queue.head;
+      moved_at = DWT->CYCCNT;
+    } else if (DWT->CYCCNT - moved_at >= stall_cycles && display->refresh_async.busy) {
+      display->refresh_async.cfg->fault |= ST7789V2_FAULT_STALLED;
+      display->stats.faults++;
+      refresh_async_abort(display);
+    }
+  }
+  __set_PRIMASK(primask);
+#endif
+}
+
+void LCD_Refresh_Wait(void) {
+  refresh_wait(selected);
+}
+
+uint8_t LCD_Get_Fault(ST7789V2_cfg_t* cfg) {
+  return cfg->fault;
+}
+
+void LCD_Recover(ST7789V2_cfg_t* cfg) {
+  LCD_Display* display = display_for(cfg);
+  // Nothing more of the refresh in flight is wanted, and the DMA interrupt mustn't see it go
+#if !ST7789V2_HOST
+  __disable_irq();
+#endif
+  if (display->refresh_async.busy) {
+    refresh_async_abort(display);
+  }
+#if !ST7789V2_HOST
+  __enable_irq();
+#endif
+  ST7789V2_Recover(cfg);
+  display->scroll_top = 0;
+  display->scroll_rows = ST7789V2_HEIGHT;
+  display->active_y0 = 0;
+  display->active_y1 = ST7789V2_HEIGHT - 1;
+  force_full_refresh(display);
+  display->stats.recoveries++;
+}
+
+void LCD_Get_Refresh_Stats(LCD_Refresh_Stats* stats) {
+  *stats = selected->stats;
+}
+
+void LCD_Reset_Refresh_Stats(void) {
+  memset(&selected->stats, 0, sizeof(selected->stats));
+}
+
+ST7789V2_RAMFUNC void LCD_DMA_IRQHandler(void) {
+  // Each display's refresh runs on its own channel, whose flag says whether it has finished
+  for (int i = 0; i < LCD_MAX_DISPLAYS; i++) {
+    LCD_Display* display = &displays[i];
+    ST7789V2_cfg_t* const cfg = display->cfg;
+    if (cfg == NULL || !cfg->setup_done) {
+      continue;
+    }
+    if (ST7789V2_DMA_Error_Clear(cfg)) {
+      // The rows still to go are lost; the caller sees the fault and calls LCD_Recover()
+      if (display->refresh_async.busy) {
+        display->stats.faults++;
+        refresh_async_abort(display);
+      }
+    } else if (ST7789V2_DMA_TC_Clear(cfg) && !ST7789V2_Transfer_Next(cfg) && display->refresh_async.busy) {
+      // Not a chunk of a longer transfer (the driver started the next): the batch has gone
+      refresh_async_sent(display);
+    }
+  }
+}
+
+void LCD_randomiseBuffer() {
+  clear_wait();
+#if !LCD_DISPLAY_LIST  // No image buffer to fill
+  for(int i = 0; i < BUFFER_LENGTH; i++) {
+    selected->image_buffer[i] = (uint8_t)rand();  // Cast truncates to byte, avoiding slow modulo
+  }
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    selected->row_colour[y] = 0;
+  }
+#endif
+}
+
+void LCD_plotArray(float const array[], const uint8_t colour) {
+  for (int i=0; i<ST7789V2_WIDTH; i++) {  // loop through array
+    // elements are normalised from 0.0 to 1.0, so multiply
+    // by 47 to convert to pixel range, and subtract from 47
+    // since top-left is 0,0 in the display geometry
+    LCD_Set_Pixel(i, ST7789V2_HEIGHT - (int)(array[i]*(float)ST7789V2_HEIGHT), colour);
+  }
+}
+
+// Half-widths of each row of a filled circle (row 0 is the centre), as drawn by the midpoint
+// algorithm below, for the small radii used for sprites like the ball
+const uint8_t circle_half_widths[LCD_CIRCLE_TABLE_MAX_RADIUS + 1][LCD_CIRCLE_TABLE_MAX_RADIUS + 1] = {
+  {0, 0, 0, 0, 0, 0, 0, 0, 0},  // r = 0
+  {1, 0, 0, 0, 0, 0, 0, 0, 0},  // r = 1
+  {2, 2, 1, 0, 0, 0, 0, 0, 0},  // r = 2
+  {3, 3, 2, 1, 0, 0, 0, 0, 0},  // r = 3
+  {4, 4, 3, 3, 1, 0, 0, 0, 0},  // r = 4
+  {5, 5, 5, 4, 3, 2, 0, 0, 0},  // r = 5
+  {6, 6, 6, 5, 4, 3, 2, 0, 0},  // r = 6
+  {7, 7, 7, 6, 6, 5, 4, 2, 0},  // r = 7
+  {8, 8, 8, 7, 7, 6, 5, 4, 2},  // r = 8
+};
+
+#if !LCD_DISPLAY_LIST
+// Fills rows y0 - dy and y0 + dy of a circle with the given half-width, clipped to the clip rectangle
+static void fill_circle_rows(const int x0, const int y0, const int dy, const int half_width, const uint8_t colour) {
+  clip_span(y0 + dy, x0 - half_width, x0 + half_width, colour);
+  if (dy) {
+    clip_span(y0 - dy, x0 - half_width, x0 + half_width, colour);
+  }
+}
+
+// Filled circle drawn one span per row (screen co-ordinates). Rows off the bottom of the screen
+// are never needed, so at most ST7789V2_HEIGHT half-widths are worked out.
+static void fill_circle(const int x0, const int y0, const uint16_t radius, const uint8_t colour) {
+  if (radius <= LCD_CIRCLE_TABLE_MAX_RADIUS) {
+    for (int dy = 0; dy <= radius; dy++) {
+      fill_circle_rows(x0, y0, dy, circle_half_widths[radius][dy], colour);
+    }
+    return;
+  }
+
+  // Same midpoint algorithm as the outline, keeping the widest x reached on each row
+  int16_t half_widths[ST7789V2_HEIGHT];
+  const int rows = (radius < ST7789V2_HEIGHT) ? radius + 1 : ST7789V2_HEIGHT;
+  for (int dy = 0; dy < rows; dy++) {
+    half_widths[dy] = -1;
+  }
+  int x = radius;
+  int y = 0;
+  int radiusError = 1-x;
+  while (x >= y) {
+    if (y < rows && x > half_widths[y]) half_widths[y] = x;
+    if (x < rows && y > half_widths[x]) half_widths[x] = y;
+    y++;
+    if (radiusError<0) {
+      radiusError += 2 * y + 1;
+    }
+    else {
+      x--;
+      radiusError += 2 * (y - x) + 1;
+    }
+  }
+  for (int dy = 0; dy < rows; dy++) {
+    if (half_widths[dy] >= 0) {
+      fill_circle_rows(x0, y0, dy, half_widths[dy], colour);
+    }
+  }
+}
+#endif
+
+void LCD_Draw_Circle(const uint16_t x0, const uint16_t y0, const uint16_t radius, const uint8_t colour, const uint8_t fill) {
+  clear_wait();
+#if LCD_DISPLAY_LIST
+  LCD_List_Add_Circle(view_x(x0), view_y(y0), radius, colour, fill);
+#else
+  const int cx = view_x(x0);
+  const int cy = view_y(y0);
+  if (fill) {
+    fill_circle(cx, cy, radius, colour);
+    return;
+  }
+
+  // Clipped once: only a circle crossing the clip rectangle checks each pixel
+  const uint8_t checked = !inside_clip(cx - radius, cy - radius, cx + radius, cy + radius);
+
+  // from http://en.wikipedia.org/wiki/Midpoint_circle_algorithm
+  int x = radius;
+  int y = 0;
+  int radiusError = 1-x;
+
+  while(x >= y) {
+
+    // Filled circles are drawn by fill_circle(), so just draw the outline
+    plot_pixel(checked,  x + cx,  y + cy, colour);
+    plot_pixel(checked, -x + cx,  y + cy, colour);
+    plot_pixel(checked,  y + cx,  x + cy, colour);
+    plot_pixel(checked, -y + cx,  x + cy, colour);
+    plot_pixel(checked, -y + cx, -x + cy, colour);
+    plot_pixel(checked,  y + cx, -x + cy, colour);
+    plot_pixel(checked,  x + cx, -y + cy, colour);
+    plot_pixel(checked, -x + cx, -y + cy, colour);
+
+    y++;
+    if (radiusError<0) {
+      radiusError += 2 * y + 1;
+    } 
+    else {
+      x--;
+      radiusError += 2 * (y - x) + 1;
+    }
+  }
+#endif
+}
+
+void LCD_Draw_Line(const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1, const uint8_t colour) {
+  clear_wait();
+#if LCD_DISPLAY_LIST
+  LCD_List_Add_Line(view_x(x0), view_y(y0), view_x(x1), view_y(y1), colour);
+#else
+  const int sx0 = view_x(x0), sy0 = view_y(y0);
+  const int sx1 = view_x(x1), sy1 = view_y(y1);
+
+  // Horizontal lines (including the single point case) are a run of pixels on one row
+  if (sy0 == sy1) {
+    clip_span(sy0, sx0, sx1, colour);
+    return;
+  }
+
+  const LCD_View* view = &selected->view;
+  // Vertical lines are a run down one column
+  if (sx0 == sx1) {
+    if (sx0 < view->clip_x0 || sx0 > view->clip_x1) {
+      return;
+    }
+    int top = (sy0 < sy1) ? sy0 : sy1;
+    int bottom = (sy0 < sy1) ? sy1 : sy0;
+    if (top < view->clip_y0) top = view->clip_y0;
+    if (bottom > view->clip_y1) bottom = view->clip_y1;
+    if (top <= bottom) {
+      fill_column(sx0, top, bottom, colour);
+    }
+    return;
+  }
+
+  // Anything else steps one pixel at a time along the longer (major) axis, from its lower
+  // end, and moves the other (minor) co-ordinate by one each time the error term passes the
+  // length. The error is kept doubled so everything stays in whole numbers.
+  const uint8_t x_major = abs(sx1 - sx0) > abs(sy1 - sy0);
+  const uint8_t swap = x_major ? (sx0 > sx1) : (sy0 > sy1);
+  const int a0 = x_major ? (swap ? sx1 : sx0) : (swap ? sy1 : sy0);
+  const int a1 = x_major ? (swap ? sx0 : sx1) : (swap ? sy0 : sy1);
+  const int b0 = x_major ? (swap ? sy1 : sy0) : (swap ? sx1 : sx0);
+  const int b1 = x_major ? (swap ? sy0 : sy1) : (swap ? sx0 : sx1);
+  const int clip_a0 = x_major ? view->clip_x0 : view->clip_y0;
+  const int clip_a1 = x_major ? view->clip_x1 : view->clip_y1;
+  const int clip_b0 = x_major ? view->clip_y0 : view->clip_x0;
+  const int clip_b1 = x_major ? view->clip_y1 : view->clip_x1;
+  const int length = a1 - a0;
+  const int rise = abs(b1 - b0);
+  const int b_step = (b1 > b0) ? 1 : -1;
+
+  // Clipped once: the major axis is cut to the clip rectangle and the error term worked out
+  // for the first pixel kept, so the loop only checks the minor axis, and only when the
+  // line crosses the clip rectangle's edge on that axis
+  const int start = (a0 > clip_a0) ? a0 : clip_a0;
+  const int stop = (a1 < clip_a1) ? a1 : clip_a1;
+  if (start > stop) {
+    return;
+  }
+  const int64_t first_error = (int64_t)2 * (start - a0) * rise + length;
+  int b = b0 + b_step * (int)(first_error / (2 * length));
+  int error = (int)(first_error % (2 * length));
+  const uint8_t checked = ((b0 < b1) ? b0 : b1) < clip_b0 || ((b0 > b1) ? b0 : b1) > clip_b1;
+
+  for (int a = start; a <= stop; a++) {
+    if (checked && (b < clip_b0 || b > clip_b1)) {
+      // The minor co-ordinate only moves one way, so past the far edge nothing more is drawn
+      if ((b_step > 0) ? (b > clip_b1) : (b < clip_b0)) {
+        break;
+      }
+    } else if (x_major) {
+      put_pixel(a, b, colour);
+    } else {
+      put_pixel(b, a, colour);
+    }
+    error += 2 * rise;
+    if (error >= 2 * length) {
+      error -= 2 * length;
+      b += b_step;
+    }
+  }
+#endif
+}
+
+void LCD_Draw_Rect(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const uint8_t colour, const uint8_t fill) {
+  clear_wait();
+#if LCD_DISPLAY_LIST
+  LCD_List_Add_Rect(view_x(x0), view_y(y0), width, height, colour, fill);
+#else
+  if (width == 0 || height == 0) {
+    return;
+  }
+  const LCD_View* view = &selected->view;
+  const int left = view_x(x0), right = left + width - 1;
+  const int top = view_y(y0), bottom = top + height - 1;
+  // The rows and columns inside the clip rectangle, worked out once
+  const int cx0 = (left > view->clip_x0) ? left : view->clip_x0;
+  const int cx1 = (right < view->clip_x1) ? right : view->clip_x1;
+  const int cy0 = (top > view->clip_y0) ? top : view->clip_y0;
+  const int cy1 = (bottom < view->clip_y1) ? bottom : view->clip_y1;
+  if (cx0 > cx1 || cy0 > cy1) {
     return;
   }
+  if (fill) {
+    for (int y = cy0; y <= cy1; y++) {
+      fill_span(y, cx0, cx1, colour);
+    }
+  }
+  else {
+    if (top == cy0) fill_span(top, cx0, cx1, colour);
+    if (bottom == cy1) fill_span(bottom, cx0, cx1, colour);
+    for (int y = cy0; y <= cy1; y++) {
+      if (left == cx0) put_pixel(left, y, colour);
+      if (right == cx1) put_pixel(right, y, colour);
+    }
+  }
+#endif
+}
 
+#if !LCD_DISPLAY_LIST
+// Draws a sprite at x0, y0 in screen co-ordinates, each pixel as a scale x scale square of its
+// own colour, or of colour unless that is LCD_LIST_SPRITE_COLOURS
+static void draw_sprite(const int x0, const int y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint16_t colour, const uint8_t scale) {
+  // Clipped once: a sprite inside the clip rectangle needs no checks
+  const uint8_t checked = !inside_clip(x0, y0, x0 + ncols * scale - 1, y0 + nrows * scale - 1);
   for (int i = 0; i < nrows; i++) {
     for (int j = 0 ; j < ncols ; j++) {
       const int pixel = *((sprite + i * ncols) + j);
       if (pixel != 255) {  // 255 is transparent
-        const uint16_t base_x = x0 + j * scale;
-        const uint16_t base_y = y0 + i * scale;
+        const uint8_t ink = (colour == LCD_LIST_SPRITE_COLOURS) ? pixel : colour;
+        const int base_x = x0 + j * scale;
+        const int base_y = y0 + i * scale;
+        if (scale == 1) {
+          plot_pixel(checked, base_x, base_y, ink);
+          continue;
+        }
         for (uint8_t dy = 0; dy < scale; dy++) {
-          for (uint8_t dx = 0; dx < scale; dx++) {
-            LCD_Set_Pixel(base_x + dx, base_y + dy, pixel);
+          if (checked) {
+            clip_span(base_y + dy, base_x, base_x + scale - 1, ink);
+          } else {
+            fill_span(base_y + dy, base_x, base_x + scale - 1, ink);
           }
         }
       }
     }
   }
 }
+#endif
+
+// Sprite drawing in viewport co-ordinates, to the list or the image buffer
+static void sprite_colour_scaled(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint16_t colour, const uint8_t scale) {
+  if (scale == 0) {
+    return;
+  }
+  clear_wait();
+#if LCD_DISPLAY_LIST
+  LCD_List_Add_Sprite(view_x(x0), view_y(y0), nrows, ncols, sprite, colour, scale);
+#else
+  draw_sprite(view_x(x0), view_y(y0), nrows, ncols, sprite, colour, scale);
+#endif
+}
+
+void LCD_Draw_Sprite_Scaled(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint8_t scale){
+  sprite_colour_scaled(x0, y0, nrows, ncols, sprite, LCD_LIST_SPRITE_COLOURS, scale);
+}
 
 void LCD_Draw_Sprite(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite){
   LCD_Draw_Sprite_Scaled(x0, y0, nrows, ncols, sprite, 1);
 }
 
 void LCD_Draw_Sprite_Colour(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint8_t colour){
-  for (int i = 0; i < nrows; i++) {
-    for (int j = 0 ; j < ncols ; j++) {
-      int pixel = *((sprite+i*ncols)+j);
-      if (pixel != 255) {  // 255 is transparent
-        LCD_Set_Pixel(x0+j,y0+i, colour);
+  sprite_colour_scaled(x0, y0, nrows, ncols, sprite, colour, 1);
+}
+
+void LCD_Draw_Sprite_Colour_Scaled(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint8_t colour, const uint8_t scale){
+  sprite_colour_scaled(x0, y0, nrows, ncols, sprite, colour, scale);
+}
+
+// Offset of the pixel and mask bytes of one row of a baked sprite at x parity phase (always 0 with 8bpp)
+static inline uint32_t baked_row_offset(const LCD_Sprite* sprite, const uint8_t phase, const uint16_t row) {
+  return (phase * sprite->nrows + row) * (sprite->stride + sprite->mask_stride);
+}
+
+static inline const uint8_t* baked_row(const LCD_Sprite* sprite, const uint8_t phase, const uint16_t row) {
+  return sprite->data + baked_row_offset(sprite, phase, row);
+}
+
+void LCD_Bake_Sprite(LCD_Sprite* baked, uint8_t* storage, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite) {
+  baked->nrows = nrows;
+  baked->ncols = ncols;
+  baked->stride = LCD_SPRITE_STRIDE(ncols);
+  baked->mask_stride = LCD_SPRITE_MASK_STRIDE(ncols);
+  baked->data = storage;
+  memset(storage, 0, LCD_SPRITE_BAKED_SIZE(nrows, ncols));
+
+  for (uint8_t phase = 0; phase < LCD_SPRITE_PHASES; phase++) {
+    for (uint16_t i = 0; i < nrows; i++) {
+      uint8_t* pixels = storage + baked_row_offset(baked, phase, i);
+      uint8_t* mask = pixels + baked->stride;
+      for (uint16_t j = 0; j < ncols; j++) {
+        const uint8_t pixel = sprite[i * ncols + j];
+        if (pixel != 255) {  // 255 is transparent
+          const uint16_t n = phase + j;
+#if LCD_BITS_PER_PIXEL == 8
+          pixels[n] = pixel;
+#else
+          // Nibble n of the row, low nibble first as in the image buffer
+          pixels[n >> 1] |= (pixel & 0x0F) << ((n & 1) ? 4 : 0);
+#endif
+          mask[n >> 3] |= 1u << (n & 7);
+        }
       }
     }
   }
 }
 
-void LCD_Draw_Sprite_Colour_Scaled(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint8_t colour, const uint8_t scale){
-  if (scale == 0) {
+void LCD_Draw_Baked_Sprite(const uint16_t x0, const uint16_t y0, const LCD_Sprite* sprite) {
+  clear_wait();
+#if LCD_DISPLAY_LIST
+  LCD_List_Add_Baked_Sprite(view_x(x0), view_y(y0), sprite);
+#else
+  const LCD_View* view = &selected->view;
+  const int sx = view_x(x0);
+  const int sy = view_y(y0);
+  // Rows and columns of the sprite inside the clip rectangle, worked out once
+  const int i0 = (view->clip_y0 > sy) ? view->clip_y0 - sy : 0;
+  const int i1 = (sy + sprite->nrows - 1 > view->clip_y1) ? view->clip_y1 - sy : sprite->nrows - 1;
+  const int j0 = (view->clip_x0 > sx) ? view->clip_x0 - sx : 0;
+  const int j1 = (sx + sprite->ncols - 1 > view->clip_x1) ? view->clip_x1 - sx : sprite->ncols - 1;
+  if (i0 > i1 || j0 > j1) {
+    return;
+  }
+#if LCD_BITS_PER_PIXEL == 8
+  // One pixel per byte: copy the bytes whose mask bit is set. Only the opaque pixels of a row
+  // are marked dirty, so a round sprite sends no more than its outline.
+  for (int i = i0; i <= i1; i++) {
+    const uint8_t* pixels = baked_row(sprite, 0, i);
+    const uint8_t* mask = pixels + sprite->stride;
+    uint8_t* dst = &selected->image_buffer[PIXEL_BYTE(sx + j0, sy + i)];
+    int first = -1, last = -1;
+    for (int b = j0; b <= j1; b++) {
+      if (mask[b >> 3] & (1u << (b & 7))) {
+        dst[b - j0] = pixels[b];
+        if (first < 0) {
+          first = b;
+        }
+        last = b;
+      }
+    }
+    if (first >= 0) {
+      mark_span_dirty(sy + i, sx + first, sx + last);
+    }
+  }
+#else
+  // Byte mask for each pair of mask bits
+  static const uint8_t nibble_masks[4] = { 0x00, 0x0F, 0xF0, 0xFF };
+
+  const uint8_t phase = sx & 1;
+  if (j0 > 0 || j1 < sprite->ncols - 1) {
+    // Cut at the left or right, draw the visible pixels one by one
+    for (int i = i0; i <= i1; i++) {
+      const uint8_t* pixels = baked_row(sprite, phase, i);
+      const uint8_t* mask = pixels + sprite->stride;
+      for (int j = j0; j <= j1; j++) {
+        const uint16_t n = phase + j;
+        if (mask[n >> 3] & (1u << (n & 7))) {
+          put_pixel(sx + j, sy + i, (pixels[n >> 1] >> ((n & 1) ? 4 : 0)) & 0x0F);
+        }
+      }
+    }
     return;
   }
 
-  for (int i = 0; i < nrows; i++) {
-    for (int j = 0 ; j < ncols ; j++) {
-      const int pixel = *((sprite + i * ncols) + j);
-      if (pixel != 255) {  // 255 is transparent
-        const uint16_t base_x = x0 + j * scale;
-        const uint16_t base_y = y0 + i * scale;
-        for (uint8_t dy = 0; dy < scale; dy++) {
-          for (uint8_t dx = 0; dx < scale; dx++) {
-            LCD_Set_Pixel(base_x + dx, base_y + dy, colour);
-          }
+  // Only the opaque pixels of a row are marked dirty (from the first to the last mask nibble
+  // set), so a round sprite sends no more than its outline and a blank row nothing
+  const uint16_t bytes = (phase + sprite->ncols + 1) >> 1;
+  for (int i = i0; i <= i1; i++) {
+    const uint8_t* pixels = baked_row(sprite, phase, i);
+    const uint8_t* mask = pixels + sprite->stride;
+    uint8_t* dst = &selected->image_buffer[(ST7789V2_WIDTH * (sy + i) + sx) >> 1];
+    int first = -1, last = -1;  // Pixels n (phase + column) of the row
+    for (uint16_t b = 0; b < bytes; b++) {
+      const uint8_t bits = (mask[b >> 2] >> ((b & 3) * 2)) & 0x3;
+      if (bits) {
+        dst[b] = (dst[b] & ~nibble_masks[bits]) | pixels[b];
+        if (first < 0) {
+          first = 2 * b + ((bits & 1) ? 0 : 1);
+        }
+        last = 2 * b + ((bits & 2) ? 1 : 0);
+      }
+    }
+    if (first >= 0) {
+      mark_span_dirty(sy + i, sx + first - phase, sx + last - phase);
+    }
+  }
+#endif
+#endif
+}
+
+const LCD_Sprite* LCD_Sprite_Anim_Frame(const LCD_Sprite_Anim* anim, const uint16_t tick) {
+  const uint8_t ticks = (anim->ticks_per_frame > 0) ? anim->ticks_per_frame : 1;
+  return &anim->frames[(tick / ticks) % anim->count];
+}
+
+// Red, green and blue of a palette colour (byte-swapped RGB565), each scaled to 0-252
+static void palette_rgb(const uint8_t index, int rgb[3]) {
+  const uint16_t swapped = LCD_Get_Palette_Colour(index);
+  const uint16_t colour = (uint16_t)((swapped >> 8) | (swapped << 8));
+  rgb[0] = ((colour >> 11) & 0x1F) << 3;
+  rgb[1] = ((colour >> 5) & 0x3F) << 2;
+  rgb[2] = (colour & 0x1F) << 3;
+}
+
+void LCD_Build_Blend_Table(LCD_Blend_Table* table, const uint8_t alpha) {
+  const int a = (alpha > LCD_BLEND_OPAQUE) ? LCD_BLEND_OPAQUE : alpha;
+  int rgb[16][3];
+  for (uint8_t i = 0; i < 16; i++) {
+    palette_rgb(i, rgb[i]);
+  }
+  for (uint8_t over = 0; over < 16; over++) {
+    for (uint8_t under = 0; under < 16; under++) {
+      int target[3];
+      for (int c = 0; c < 3; c++) {
+        target[c] = (rgb[under][c] * (LCD_BLEND_OPAQUE - a) + rgb[over][c] * a + LCD_BLEND_OPAQUE / 2) / LCD_BLEND_OPAQUE;
+      }
+      // Nearest palette colour, green weighted most and blue least, as the eye sees them
+      uint8_t best = under;
+      int32_t best_distance = INT32_MAX;
+      for (uint8_t i = 0; i < 16; i++) {
+        const int dr = rgb[i][0] - target[0], dg = rgb[i][1] - target[1], db = rgb[i][2] - target[2];
+        const int32_t distance = 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+        if (distance < best_distance) {
+          best_distance = distance;
+          best = i;
+        }
+      }
+      table->index[over][under] = best;
+    }
+  }
+}
+
+#if !LCD_DISPLAY_LIST
+// Replaces each pixel p of x0..x1 (x0 <= x1) of row y with map[p], on the screen and clipped
+static ST7789V2_RAMFUNC void blend_span(const uint16_t y, uint16_t x0, const uint16_t x1, const uint8_t* map) {
+  mark_span_dirty(y, x0, x1);
+#if LCD_BITS_PER_PIXEL == 8
+  // Colours 16-255 are not in the table: they are left as they are
+  uint8_t* p = &selected->image_buffer[PIXEL_BYTE(x0, y)];
+  for (uint16_t x = x0; x <= x1; x++, p++) {
+    if (*p < 16) {
+      *p = map[*p];
+    }
+  }
+#else
+  uint8_t* row = &selected->image_buffer[(ST7789V2_WIDTH * y) >> 1];
+  uint16_t x = x0;
+  if (x & 1) {
+    const uint8_t b = row[x >> 1];
+    row[x >> 1] = (map[b >> 4] << 4) | (b & 0x0F);
+    x++;
+  }
+  // Whole bytes: a lookup for each nibble
+  for (; x < x1; x += 2) {
+    const uint8_t b = row[x >> 1];
+    row[x >> 1] = (map[b >> 4] << 4) | map[b & 0x0F];
+  }
+  if (x == x1) {
+    const uint8_t b = row[x >> 1];
+    row[x >> 1] = (b & 0xF0) | map[b & 0x0F];
+  }
+#endif
+}
+
+// Clips x0..x1 of row y (screen co-ordinates) to the clip rectangle; 0 if nothing is left
+static inline uint8_t clip_row(const int y, int* x0, int* x1) {
+  const LCD_View* view = &selected->view;
+  if (y < view->clip_y0 || y > view->clip_y1) {
+    return 0;
+  }
+  if (*x0 < view->clip_x0) *x0 = view->clip_x0;
+  if (*x1 > view->clip_x1) *x1 = view->clip_x1;
+  return *x0 <= *x1;
+}
+
+// 4x4 Bayer matrix: a pixel at (x, y) is set by a dither of level n (of 16) if its entry is below n
+static const uint8_t bayer4[4][4] = {
+  {  0,  8,  2, 10 },
+  { 12,  4, 14,  6 },
+  {  3, 11,  1,  9 },
+  { 15,  7, 13,  5 }
+};
+#endif
+
+void LCD_Blend_Rect(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const uint8_t colour, const LCD_Blend_Table* table) {
+#if LCD_DISPLAY_LIST
+  (void)x0; (void)y0; (void)width; (void)height; (void)colour; (void)table;
+#else
+  clear_wait();
+  if (width == 0 || height == 0) {
+    return;
+  }
+  const uint8_t* map = table->index[colour & 0x0F];
+  const int top = view_y(y0);
+  for (int y = top; y < top + height; y++) {
+    int left = view_x(x0), right = left + width - 1;
+    if (clip_row(y, &left, &right)) {
+      blend_span(y, left, right, map);
+    }
+  }
+#endif
+}
+
+void LCD_Blend_Circle(const uint16_t x0, const uint16_t y0, const uint16_t radius, const uint8_t colour, const LCD_Blend_Table* table) {
+#if LCD_DISPLAY_LIST
+  (void)x0; (void)y0; (void)radius; (void)colour; (void)table;
+#else
+  clear_wait();
+  const uint8_t* map = table->index[colour & 0x0F];
+  const int cx = view_x(x0);
+  const int cy = view_y(y0);
+  // Half-width of each row, the widest that stays within radius + 1/2 (each row once, so no
+  // pixel is blended twice)
+  const int32_t limit = (int32_t)radius * radius + radius;
+  int half = radius;
+  for (int dy = 0; dy <= radius; dy++) {
+    while (half > 0 && (int32_t)half * half + (int32_t)dy * dy > limit) {
+      half--;
+    }
+    for (int side = 0; side < ((dy != 0) ? 2 : 1); side++) {
+      const int y = side ? cy - dy : cy + dy;
+      int left = cx - half, right = cx + half;
+      if (clip_row(y, &left, &right)) {
+        blend_span(y, left, right, map);
+      }
+    }
+  }
+#endif
+}
+
+void LCD_Dither_Rect(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const uint8_t colour, const uint8_t level) {
+#if LCD_DISPLAY_LIST
+  (void)x0; (void)y0; (void)width; (void)height; (void)colour; (void)level;
+#else
+  clear_wait();
+  if (width == 0 || height == 0 || level == 0) {
+    return;
+  }
+  const int top = view_y(y0);
+  for (int y = top; y < top + height; y++) {
+    int left = view_x(x0), right = left + width - 1;
+    if (!clip_row(y, &left, &right)) {
+      continue;
+    }
+    // The matrix row is anchored to the screen, so dithered areas next to each other line up
+    const uint8_t* thresholds = bayer4[y & 3];
+    for (int x = left; x <= right; x++) {
+      if (thresholds[x & 3] < level) {
+        put_pixel(x, y, colour);
+      }
+    }
+  }
+#endif
+}
+
+// ========== Atlas fonts ==========
+
+void LCD_Build_Font_Shades(LCD_Font_Shades* shades) {
+  for (uint8_t i = 0; i < LCD_FONT_SHADES; i++) {
+    LCD_Build_Blend_Table(&shades->table[i], (uint8_t)(LCD_BLEND_OPAQUE * (i + 1) / (LCD_FONT_SHADES + 1)));
+  }
+}
+
+// The glyph of c, NULL if the font doesn't have one
+static inline const LCD_Font_Glyph* font_glyph(const LCD_Font* font, const char c) {
+  const uint8_t code = (uint8_t)c;
+  if (code < font->first || code - font->first >= font->count) {
+    return NULL;
+  }
+  return &font->glyphs[code - font->first];
+}
+
+uint16_t LCD_Font_Width(char const *str, const LCD_Font* font) {
+  uint16_t width = 0;
+  for (; *str; str++) {
+    const LCD_Font_Glyph* glyph = font_glyph(font, *str);
+    if (glyph != NULL) {
+      width += glyph->advance;
+    }
+  }
+  return width;
+}
+
+// Shade of a glyph pixel of coverage 0-15: 0 is not drawn, FONT_SOLID is drawn in the colour,
+// and those between are blended by shade table - 1
+#define FONT_SOLID (LCD_FONT_SHADES + 1)
+static inline uint8_t coverage_shade(const uint8_t coverage, const uint8_t shaded) {
+  if (!shaded) {
+    return (coverage >= 8) ? FONT_SOLID : 0;
+  }
+  return (uint8_t)((coverage * FONT_SOLID + 7) / 15);
+}
+
+// Draws a glyph with the pen at x and the top of the line at y (screen co-ordinates), clipped
+static void draw_font_glyph(const LCD_Font* font, const LCD_Font_Glyph* glyph, const int x, const int y, const uint8_t colour, const LCD_Font_Shades* shades) {
+#if LCD_DISPLAY_LIST
+  shades = NULL;  // Nothing to blend into
+#endif
+  const LCD_View* view = &selected->view;
+  const int left = x + glyph->x_offset;
+  const int top = y + glyph->y_offset;
+  const uint16_t row_bytes = (glyph->width + 1) >> 1;
+  const uint8_t* bits = &font->bitmaps[glyph->offset];
+  for (int r = 0; r < glyph->rows; r++, bits += row_bytes) {
+    const int py = top + r;
+    if (py < view->clip_y0 || py > view->clip_y1) {
+      continue;
+    }
+    int run = -1;  // Start of the run of solid pixels being gathered
+    for (int i = 0; i < glyph->width; i++) {
+      const uint8_t byte = bits[i >> 1];
+      if (byte == 0 && !(i & 1) && run < 0) {
+        i++;  // Two blank pixels at once
+        continue;
+      }
+      const uint8_t shade = coverage_shade((i & 1) ? (byte >> 4) : (byte & 0x0F), shades != NULL);
+      if (shade == FONT_SOLID) {
+        if (run < 0) {
+          run = i;
         }
+        continue;
+      }
+      if (run >= 0) {
+        clip_span(py, left + run, left + i - 1, colour);
+        run = -1;
       }
+#if !LCD_DISPLAY_LIST
+      const int px = left + i;
+      if (shade > 0 && px >= view->clip_x0 && px <= view->clip_x1) {
+        blend_span(py, px, px, shades->table[shade - 1].index[colour & 0x0F]);
+      }
+#endif
+    }
+    if (run >= 0) {
+      clip_span(py, left + run, left + glyph->width - 1, colour);
+    }
+  }
+}
+
+uint16_t LCD_Print_Font(char const *str, const uint16_t x, const uint16_t y, const uint8_t colour, const LCD_Font* font, const LCD_Font_Shades* shades) {
+  clear_wait();
+  const LCD_View* view = &selected->view;
+  const int top = view_y(y);
+  const int start = view_x(x);
+  const uint8_t visible = top <= view->clip_y1 && top + font->height - 1 >= view->clip_y0;
+  int pen = start;
+  for (; *str; str++) {
+    const LCD_Font_Glyph* glyph = font_glyph(font, *str);
+    if (glyph == NULL) {
+      continue;
     }
+    const int left = pen + glyph->x_offset;
+    if (visible && glyph->width > 0 && left <= view->clip_x1 && left + glyph->width - 1 >= view->clip_x0) {
+      draw_font_glyph(font, glyph, pen, top, colour, shades);
+    }
+    pen += glyph->advance;
   }
+  return (uint16_t)(pen - start);
+}
+
+#if LCD_DISPLAY_LIST
+void LCD_Draw_Rect_RGB565(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const uint16_t colour, const uint8_t fill) {
+  LCD_List_Add_Rect(view_x(x0), view_y(y0), width, height, LCD_LIST_RGB | colour, fill);
+}
+
+void LCD_Draw_Circle_RGB565(const uint16_t x0, const uint16_t y0, const uint16_t radius, const uint16_t colour, const uint8_t fill) {
+  LCD_List_Add_Circle(view_x(x0), view_y(y0), radius, LCD_LIST_RGB | colour, fill);
+}
+
+void LCD_printString_RGB565(char const *str, const uint16_t x, const uint16_t y, const uint16_t colour, uint8_t font_size) {
+  LCD_List_Add_Text(str, view_x(x), view_y(y), LCD_LIST_RGB | colour, font_size);
+}
+
+void LCD_Draw_Image_RGB565(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint16_t *pixels) {
+  LCD_List_Add_Image(view_x(x0), view_y(y0), nrows, ncols, pixels);
 }
+#endif
 
 uint16_t colour_ = 0x001F;
 
 void LCD_Fill(ST7789V2_cfg_t* cfg, const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1, const uint16_t colour) {
-  // Wait for not busy
-  while (cfg->spi->SR & SPI_SR_BSY);
-
-  // Set address window
+  // Set address window (waits for the SPI to finish what it was sending)
   ST7789V2_Set_Address_Window(cfg, x0, y0, x1, y1);
   colour_ = colour;
 
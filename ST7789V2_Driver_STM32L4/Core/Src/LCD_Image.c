@@ -0,0 +1,153 @@
+#include "LCD_Image.h"
+#include <string.h>
+
+static inline uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint8_t open_header(LCD_Image_Decoder* decoder, const uint8_t* image, const uint32_t length) {
+  decoder->data = image;
+  decoder->length = length;
+  decoder->pos = LCD_IMAGE_HEADER_BYTES;
+  decoder->row = 0;
+  decoder->width = 0;
+  decoder->height = 0;
+  if (image == 0 || length < LCD_IMAGE_HEADER_BYTES || get16(image) != LCD_IMAGE_MAGIC || get16(image + 6) != 0) {
+    return 0;
+  }
+  decoder->width = get16(image + 2);
+  decoder->height = get16(image + 4);
+  return decoder->width > 0 && decoder->height > 0;
+}
+
+uint8_t LCD_Image_Open(LCD_Image_Decoder* decoder, const uint8_t* image, const uint32_t length) {
+  decoder->reader = 0;
+  decoder->context = 0;
+  decoder->window = 0;
+  decoder->window_bytes = 0;
+  return open_header(decoder, image, length);
+}
+
+// Streamed images: unless the next row is surely in the window already, moves what is left of
+// it to the front and reads until the window is full or the image ends
+static void refill(LCD_Image_Decoder* decoder) {
+  if (decoder->reader == 0 || decoder->length - decoder->pos >= LCD_IMAGE_MAX_ROW_BYTES(decoder->width)) {
+    return;
+  }
+  const uint32_t left = decoder->length - decoder->pos;
+  memmove(decoder->window, decoder->window + decoder->pos, left);
+  decoder->length = left;
+  decoder->pos = 0;
+  while (decoder->length < decoder->window_bytes) {
+    const uint32_t got = decoder->reader(decoder->context, decoder->window + decoder->length,
+                                         decoder->window_bytes - decoder->length);
+    if (got == 0) {
+      break;
+    }
+    decoder->length += got;
+  }
+}
+
+uint8_t LCD_Image_Open_Stream(LCD_Image_Decoder* decoder, LCD_Image_Reader reader, void* context,
+                              uint8_t* window, const uint32_t window_bytes) {
+  decoder->reader = reader;
+  decoder->context = context;
+  decoder->window = window;
+  decoder->window_bytes = window_bytes;
+  uint32_t length = 0;
+  while (reader != 0 && length < window_bytes) {
+    const uint32_t got = reader(context, window + length, window_bytes - length);
+    if (got == 0) {
+      break;
+    }
+    length += got;
+  }
+  return open_header(decoder, window, length) && window_bytes >= LCD_IMAGE_MAX_ROW_BYTES(decoder->width);
+}
+
+// Adds a DELTA byte to a pixel, each channel wrapping within its bits
+static inline uint16_t add_delta(const uint16_t pixel, const uint8_t delta) {
+  const uint16_t r = ((pixel >> 11) + (delta >> 5) - 4) & 0x1F;
+  const uint16_t g = ((pixel >> 5) + ((delta >> 2) & 0x07) - 4) & 0x3F;
+  const uint16_t b = (pixel + (delta & 0x03) - 2) & 0x1F;
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+// Decodes the packets of one row into out, returns the position after them or 0 if damaged
+static uint32_t decode_packets(const LCD_Image_Decoder* decoder, uint16_t* out, const uint16_t* above) {
+  const uint8_t* data = decoder->data;
+  const uint32_t length = decoder->length;
+  const uint16_t width = decoder->width;
+  uint32_t pos = decoder->pos;
+  uint16_t x = 0;
+
+  while (x < width) {
+    if (pos >= length) {
+      return 0;
+    }
+    const uint8_t packet = data[pos++];
+    const uint16_t count = (packet & 0x3F) + 1;
+    if (x + count > width) {
+      return 0;
+    }
+    switch (packet & 0xC0) {
+      case LCD_IMAGE_LITERAL:
+        if (pos + 2u * count > length) {
+          return 0;
+        }
+        for (uint16_t i = 0; i < count; i++) {
+          out[x + i] = get16(&data[pos + 2u * i]);
+        }
+        pos += 2u * count;
+        break;
+      case LCD_IMAGE_RUN: {
+        if (pos + 2 > length) {
+          return 0;
+        }
+        const uint16_t pixel = get16(&data[pos]);
+        pos += 2;
+        for (uint16_t i = 0; i < count; i++) {
+          out[x + i] = pixel;
+        }
+        break;
+      }
+      case LCD_IMAGE_UP:
+        if (above == 0) {
+          return 0;
+        }
+        memcpy(&out[x], &above[x], count * sizeof(uint16_t));
+        break;
+      default: {  // LCD_IMAGE_DELTA
+        if (x == 0 || pos + count > length) {
+          return 0;
+        }
+        uint16_t pixel = out[x - 1];
+        for (uint16_t i = 0; i < count; i++) {
+          pixel = add_delta(pixel, data[pos + i]);
+          out[x + i] = pixel;
+        }
+        pos += count;
+        break;
+      }
+    }
+    x += count;
+  }
+  return pos;
+}
+
+uint8_t LCD_Image_Decode_Row(LCD_Image_Decoder* decoder, uint16_t* out, const uint16_t* above) {
+  if (decoder->row >= decoder->height) {
+    return 0;
+  }
+  refill(decoder);
+  const uint32_t pos = decode_packets(decoder, out, above);
+  if (pos == 0) {
+    // Nothing after this can be trusted either
+    memset(out, 0, decoder->width * sizeof(uint16_t));
+    decoder->row = decoder->height;
+    return 0;
+  }
+  decoder->pos = pos;
+  decoder->row++;
+  return 1;
+}
@@ -0,0 +1,513 @@
+#include "LCD_List.h"
+#include <string.h>
+
+#if LCD_DISPLAY_LIST
+
+typedef enum {
+  LIST_RECT,
+  LIST_CIRCLE,
+  LIST_LINE,
+  LIST_TEXT,
+  LIST_SPRITE,
+  LIST_BAKED_SPRITE,
+  LIST_IMAGE
+} LCD_List_Type;
+
+// Set in a command's type when its colour is RGB565 rather than a palette index
+#define LIST_RGB 0x80
+
+// One recorded drawing call. The bounding box is clipped to the screen, so a command is only
+// looked at by the rows it actually touches.
+typedef struct {
+  uint8_t type;               // LCD_List_Type, plus LIST_RGB
+  uint8_t param;              // Rect/circle fill, text font size or sprite scale
+  uint8_t bx0, bx1, by0, by1; // Bounding box on the screen and in the clip rectangle, inclusive;
+                              // nothing is drawn outside it
+  uint16_t colour;            // Colour index, LCD_LIST_SPRITE_COLOURS or native RGB565
+  uint16_t x, y;              // Position as passed to the LCD_Draw_* function
+  uint16_t a, b;              // Rect width/height, circle radius, line end, text offset/length,
+                              // sprite rows/columns
+  const void* data;           // Sprite pixels, baked sprite or RGB565 image
+  uint32_t hash;              // Everything above bar the text offset, plus the text itself
+} LCD_List_Command;
+
+static LCD_List_Command commands[LCD_LIST_MAX_COMMANDS];
+static uint16_t command_count = 0;
+static char text[LCD_LIST_TEXT_BYTES];
+static uint16_t text_used = 0;
+static uint8_t background = 0;
+static uint8_t shown_background = 0;
+static uint32_t dropped = 0;
+// Clip rectangle of the commands being added (LCD_List_Set_Clip())
+static int16_t clip_left = 0, clip_top = 0, clip_right = ST7789V2_WIDTH - 1, clip_bottom = ST7789V2_HEIGHT - 1;
+
+// Per row hash of the commands covering it, and the columns they cover, for the frame being
+// presented and for the one on the panel. Rows whose hashes match need not be sent again.
+static uint32_t frame_hash[ST7789V2_HEIGHT];
+static uint32_t shown_hash[ST7789V2_HEIGHT];
+static uint8_t frame_x0[ST7789V2_HEIGHT], frame_x1[ST7789V2_HEIGHT];
+static uint8_t shown_x0[ST7789V2_HEIGHT], shown_x1[ST7789V2_HEIGHT];
+
+#define HASH_SEED 2166136261u
+#define HASH_PRIME 16777619u
+
+static inline uint32_t hash_mix(uint32_t hash, const uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * HASH_PRIME;
+  }
+  return hash;
+}
+
+// Records a command covering x0..x1, y0..y1 (before clipping). Returns 0 if the list is full
+// or the command would not show at all.
+static LCD_List_Command* add_command(const uint8_t type, int x0, int y0, int x1, int y1) {
+  if (x0 < clip_left) x0 = clip_left;
+  if (y0 < clip_top) y0 = clip_top;
+  if (x1 > clip_right) x1 = clip_right;
+  if (y1 > clip_bottom) y1 = clip_bottom;
+  if (x0 > x1 || y0 > y1) {
+    return NULL;  // Entirely off the screen or clipped away
+  }
+  if (command_count >= LCD_LIST_MAX_COMMANDS) {
+    dropped++;
+    return NULL;
+  }
+  LCD_List_Command* cmd = &commands[command_count++];
+  memset(cmd, 0, sizeof(*cmd));
+  cmd->type = type;
+  cmd->bx0 = x0;
+  cmd->bx1 = x1;
+  cmd->by0 = y0;
+  cmd->by1 = y1;
+  return cmd;
+}
+
+// Hashes a command once its fields are filled in
+static void seal_command(LCD_List_Command* cmd) {
+  uint32_t hash = HASH_SEED;
+  hash = hash_mix(hash, cmd->type | (cmd->param << 8) | ((uint32_t)cmd->colour << 16));
+  hash = hash_mix(hash, cmd->x | (cmd->y << 16));
+  if ((cmd->type & ~LIST_RGB) == LIST_TEXT) {
+    for (uint16_t i = 0; i < cmd->b; i++) {
+      hash = (hash ^ (uint8_t)text[cmd->a + i]) * HASH_PRIME;
+    }
+  } else {
+    hash = hash_mix(hash, cmd->a | ((uint32_t)cmd->b << 16));
+  }
+  hash = hash_mix(hash, (uint32_t)(uintptr_t)cmd->data);
+  // The same drawing clipped differently shows different pixels
+  hash = hash_mix(hash, cmd->bx0 | (cmd->bx1 << 8) | ((uint32_t)cmd->by0 << 16) | ((uint32_t)cmd->by1 << 24));
+  cmd->hash = hash;
+}
+
+// Stores an LCD_List_Colour in a command
+static void set_colour(LCD_List_Command* cmd, const LCD_List_Colour colour) {
+  if (colour & LCD_LIST_RGB) {
+    // Byte-swapped like the palettes, swapped back once here for the 16-bit refresh
+    const uint16_t rgb = colour & 0xFFFF;
+    cmd->type |= LIST_RGB;
+    cmd->colour = (uint16_t)((rgb >> 8) | (rgb << 8));
+  } else {
+    cmd->colour = colour & LCD_COLOUR_MASK;
+  }
+}
+
+void LCD_List_Set_Clip(const int16_t x0, const int16_t y0, const int16_t x1, const int16_t y1) {
+  clip_left = (x0 < 0) ? 0 : x0;
+  clip_top = (y0 < 0) ? 0 : y0;
+  clip_right = (x1 > ST7789V2_WIDTH - 1) ? ST7789V2_WIDTH - 1 : x1;
+  clip_bottom = (y1 > ST7789V2_HEIGHT - 1) ? ST7789V2_HEIGHT - 1 : y1;
+}
+
+void LCD_List_Reset(const uint8_t colour) {
+  command_count = 0;
+  text_used = 0;
+  background = colour & LCD_COLOUR_MASK;
+}
+
+void LCD_List_Add_Rect(const uint16_t x0, const uint16_t y0, const uint16_t width, const uint16_t height, const LCD_List_Colour colour, const uint8_t fill) {
+  if (width == 0 || height == 0) {
+    return;
+  }
+  LCD_List_Command* cmd = add_command(LIST_RECT, x0, y0, x0 + width - 1, y0 + height - 1);
+  if (cmd) {
+    set_colour(cmd, colour);
+    cmd->param = fill ? 1 : 0;
+    cmd->x = x0;
+    cmd->y = y0;
+    cmd->a = width;
+    cmd->b = height;
+    seal_command(cmd);
+  }
+}
+
+void LCD_List_Add_Circle(const uint16_t x0, const uint16_t y0, const uint16_t radius, const LCD_List_Colour colour, const uint8_t fill) {
+  LCD_List_Command* cmd = add_command(LIST_CIRCLE, x0 - radius, y0 - radius, x0 + radius, y0 + radius);
+  if (cmd) {
+    set_colour(cmd, colour);
+    cmd->param = fill ? 1 : 0;
+    cmd->x = x0;
+    cmd->y = y0;
+    cmd->a = radius;
+    seal_command(cmd);
+  }
+}
+
+void LCD_List_Add_Line(const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1, const LCD_List_Colour colour) {
+  // Ends off the left or top edge arrive as co-ordinates past 32767
+  const int left = ((int16_t)x0 < (int16_t)x1) ? (int16_t)x0 : (int16_t)x1;
+  const int right = ((int16_t)x0 < (int16_t)x1) ? (int16_t)x1 : (int16_t)x0;
+  const int top = ((int16_t)y0 < (int16_t)y1) ? (int16_t)y0 : (int16_t)y1;
+  const int bottom = ((int16_t)y0 < (int16_t)y1) ? (int16_t)y1 : (int16_t)y0;
+  LCD_List_Command* cmd = add_command(LIST_LINE, left, top, right, bottom);
+  if (cmd) {
+    set_colour(cmd, colour);
+    cmd->x = x0;
+    cmd->y = y0;
+    cmd->a = x1;
+    cmd->b = y1;
+    seal_command(cmd);
+  }
+}
+
+void LCD_List_Add_Text(char const *str, const uint16_t x, const uint16_t y, const LCD_List_Colour colour, const uint8_t font_size) {
+  const uint16_t len = strlen(str);
+  if (len == 0 || font_size == 0 || x >= ST7789V2_WIDTH || y >= ST7789V2_HEIGHT) {
+    return;
+  }
+  if (text_used + len > LCD_LIST_TEXT_BYTES) {
+    dropped++;
+    return;
+  }
+  // The last character's five columns end a column short of its six column cell
+  LCD_List_Command* cmd = add_command(LIST_TEXT, x, y, x + (6 * len - 1) * font_size - 1,
+                                      y + 7 * font_size - 1);
+  if (cmd) {
+    memcpy(&text[text_used], str, len);
+    set_colour(cmd, colour);
+    cmd->param = font_size;
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = text_used;
+    cmd->b = len;
+    text_used += len;
+    seal_command(cmd);
+  }
+}
+
+void LCD_List_Add_Sprite(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint8_t *sprite, const uint16_t colour, const uint8_t scale) {
+  if (scale == 0 || nrows == 0 || ncols == 0) {
+    return;
+  }
+  LCD_List_Command* cmd = add_command(LIST_SPRITE, x0, y0, x0 + ncols * scale - 1, y0 + nrows * scale - 1);
+  if (cmd) {
+    cmd->colour = (colour == LCD_LIST_SPRITE_COLOURS) ? colour : (colour & LCD_COLOUR_MASK);
+    cmd->param = scale;
+    cmd->x = x0;
+    cmd->y = y0;
+    cmd->a = nrows;
+    cmd->b = ncols;
+    cmd->data = sprite;
+    seal_command(cmd);
+  }
+}
+
+void LCD_List_Add_Baked_Sprite(const uint16_t x0, const uint16_t y0, const LCD_Sprite* sprite) {
+  LCD_List_Command* cmd = add_command(LIST_BAKED_SPRITE, x0, y0, x0 + sprite->ncols - 1, y0 + sprite->nrows - 1);
+  if (cmd) {
+    cmd->x = x0;
+    cmd->y = y0;
+    cmd->data = sprite;
+    seal_command(cmd);
+  }
+}
+
+void LCD_List_Add_Image(const uint16_t x0, const uint16_t y0, const uint16_t nrows, const uint16_t ncols, const uint16_t *pixels) {
+  if (nrows == 0 || ncols == 0) {
+    return;
+  }
+  LCD_List_Command* cmd = add_command(LIST_IMAGE, x0, y0, x0 + ncols - 1, y0 + nrows - 1);
+  if (cmd) {
+    cmd->x = x0;
+    cmd->y = y0;
+    cmd->a = nrows;
+    cmd->b = ncols;
+    cmd->data = pixels;
+    seal_command(cmd);
+  }
+}
+
+uint16_t LCD_List_Get_Count(void) {
+  return command_count;
+}
+
+uint32_t LCD_List_Get_Dropped(void) {
+  return dropped;
+}
+
+void LCD_List_Present(LCD_List_Row_Changed changed) {
+  const uint32_t seed = (HASH_SEED ^ background) * HASH_PRIME;
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    frame_hash[y] = seed;
+    frame_x0[y] = 0xFF;
+    frame_x1[y] = 0;
+  }
+  // Commands are mixed in drawing order, so reordering overlapping ones changes the hash too
+  for (uint16_t i = 0; i < command_count; i++) {
+    const LCD_List_Command* cmd = &commands[i];
+    for (int y = cmd->by0; y <= cmd->by1; y++) {
+      frame_hash[y] = (frame_hash[y] ^ cmd->hash) * HASH_PRIME;
+      if (cmd->bx0 < frame_x0[y]) frame_x0[y] = cmd->bx0;
+      if (cmd->bx1 > frame_x1[y]) frame_x1[y] = cmd->bx1;
+    }
+  }
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    if (frame_hash[y] != shown_hash[y]) {
+      // Repaint wherever the row has something drawn now or had before, or all of it if
+      // the background colour changed
+      uint8_t x0 = (frame_x0[y] < shown_x0[y]) ? frame_x0[y] : shown_x0[y];
+      uint8_t x1 = (frame_x1[y] > shown_x1[y]) ? frame_x1[y] : shown_x1[y];
+      if (background != shown_background || x0 > x1) {
+        x0 = 0;
+        x1 = ST7789V2_WIDTH - 1;
+      }
+      changed(y, x0, x1, frame_x0[y] > frame_x1[y]);
+    }
+    shown_hash[y] = frame_hash[y];
+    shown_x0[y] = frame_x0[y];
+    shown_x1[y] = frame_x1[y];
+  }
+  shown_background = background;
+}
+
+// ========== Rasterising ==========
+
+// Palette of the batch being rendered, as native RGB565
+static const uint16_t* render_palette;
+
+// Fills columns x0..x1 of a row buffer that starts at column clip_x0 and ends at clip_x1
+static inline void fill_span(uint16_t* row, int x0, int x1, const int clip_x0, const int clip_x1, const uint16_t colour) {
+  if (x0 < clip_x0) x0 = clip_x0;
+  if (x1 > clip_x1) x1 = clip_x1;
+  for (int x = x0; x <= x1; x++) {
+    row[x - clip_x0] = colour;
+  }
+}
+
+// Half-width of row dy of a filled circle, as LCD_Draw_Circle draws it: the table for small
+// radii, otherwise the widest x the midpoint algorithm reaches on that row
+static int circle_half_width(const int radius, const int dy) {
+  if (radius <= LCD_CIRCLE_TABLE_MAX_RADIUS) {
+    return circle_half_widths[radius][dy];
+  }
+  int half_width = -1;
+  int x = radius;
+  int y = 0;
+  int radiusError = 1-x;
+  while (x >= y) {
+    if (y == dy && x > half_width) half_width = x;
+    if (x == dy && y > half_width) half_width = y;
+    y++;
+    if (radiusError<0) {
+      radiusError += 2 * y + 1;
+    }
+    else {
+      x--;
+      radiusError += 2 * (y - x) + 1;
+    }
+  }
+  return half_width;
+}
+
+static void circle_row(const LCD_List_Command* cmd, const int y, uint16_t* row, const int clip_x0, const int clip_x1, const uint16_t ink) {
+  const int x0 = cmd->x;
+  const int dy = y - cmd->y;
+  if (cmd->param) {
+    const int hw = circle_half_width(cmd->a, (dy < 0) ? -dy : dy);
+    if (hw >= 0) {
+      fill_span(row, x0 - hw, x0 + hw, clip_x0, clip_x1, ink);
+    }
+    return;
+  }
+  // Outline: the midpoint points that land on this row, in all eight octants
+  int x = cmd->a;
+  int yy = 0;
+  int radiusError = 1-x;
+  while (x >= yy) {
+    if (yy == dy || -yy == dy) {
+      fill_span(row, x0 + x, x0 + x, clip_x0, clip_x1, ink);
+      fill_span(row, x0 - x, x0 - x, clip_x0, clip_x1, ink);
+    }
+    if (x == dy || -x == dy) {
+      fill_span(row, x0 + yy, x0 + yy, clip_x0, clip_x1, ink);
+      fill_span(row, x0 - yy, x0 - yy, clip_x0, clip_x1, ink);
+    }
+    yy++;
+    if (radiusError<0) {
+      radiusError += 2 * yy + 1;
+    }
+    else {
+      x--;
+      radiusError += 2 * (yy - x) + 1;
+    }
+  }
+}
+
+// Pixels of a line on row y, as LCD_Draw_Line steps them: along the longer axis from its
+// lower end, the other co-ordinate of step i being (2 * i * rise + length) / (2 * length)
+static void line_row(const LCD_List_Command* cmd, const int y, uint16_t* row, const int clip_x0, const int clip_x1, const uint16_t ink) {
+  const int x0 = (int16_t)cmd->x, y0 = (int16_t)cmd->y;
+  const int x1 = (int16_t)cmd->a, y1 = (int16_t)cmd->b;
+  if (y0 == y1) {
+    fill_span(row, (x0 < x1) ? x0 : x1, (x0 < x1) ? x1 : x0, clip_x0, clip_x1, ink);
+    return;
+  }
+  const int64_t dx = abs(x1 - x0);
+  const int64_t dy = abs(y1 - y0);
+  if (dx > dy) {
+    // A run of pixels per row: the steps where y has moved k rows from the left end
+    const int left_x = (x0 < x1) ? x0 : x1;
+    const int left_y = (x0 < x1) ? y0 : y1;
+    const int64_t k = abs(y - left_y);
+    const int64_t first = (k == 0) ? 0 : ((2 * k - 1) * dx + 2 * dy - 1) / (2 * dy);
+    int64_t last = ((2 * k + 1) * dx + 2 * dy - 1) / (2 * dy) - 1;
+    if (last > dx) {
+      last = dx;
+    }
+    fill_span(row, left_x + (int)first, left_x + (int)last, clip_x0, clip_x1, ink);
+  } else {
+    // One pixel per row
+    const int top_x = (y0 < y1) ? x0 : x1;
+    const int top_y = (y0 < y1) ? y0 : y1;
+    const int x_step = (((y0 < y1) ? x1 : x0) > top_x) ? 1 : -1;
+    const int x = top_x + x_step * (int)((2 * (y - top_y) * dx + dy) / (2 * dy));
+    fill_span(row, x, x, clip_x0, clip_x1, ink);
+  }
+}
+
+// Row y of a string, as LCD_printString draws it (each character is 5x7 in a 6 column cell)
+static void text_row(const LCD_List_Command* cmd, const int y, uint16_t* row, const int clip_x0, const int clip_x1, const uint16_t ink) {
+  const int size = cmd->param;
+  const uint8_t bit = 1u << ((y - cmd->y) / size);
+  const unsigned char* font = LCD_Get_Font();
+  for (int n = 0; n < cmd->b; n++) {
+    const uint8_t c = text[cmd->a + n];
+    if (c < 32 || c >= 32 + 96) {
+      continue;  // Not in the font
+    }
+    for (int i = 0; i < 5; i++) {
+      const int pixel_x = cmd->x + (i + n * 6) * size;
+      if (pixel_x > ST7789V2_WIDTH - 1) {
+        return;
+      }
+      if (font[(c - 32) * 5 + i] & bit) {
+        fill_span(row, pixel_x, pixel_x + size - 1, clip_x0, clip_x1, ink);
+      }
+    }
+  }
+}
+
+static void sprite_row(const LCD_List_Command* cmd, const int y, uint16_t* row, const int clip_x0, const int clip_x1, const uint16_t ink) {
+  const uint8_t* pixels = (const uint8_t*)cmd->data + ((y - cmd->y) / cmd->param) * cmd->b;
+  for (int j = 0; j < cmd->b; j++) {
+    if (pixels[j] != 255) {  // 255 is transparent
+      const int base_x = cmd->x + j * cmd->param;
+      const uint16_t colour = (cmd->colour == LCD_LIST_SPRITE_COLOURS) ? render_palette[pixels[j] & LCD_COLOUR_MASK] : ink;
+      fill_span(row, base_x, base_x + cmd->param - 1, clip_x0, clip_x1, colour);
+    }
+  }
+}
+
+// Same layout as the baked sprite rows in LCD.c: [x parity][row] pixel bytes then mask bytes,
+// with 8bpp a single copy of one byte per pixel
+static void baked_sprite_row(const LCD_List_Command* cmd, const int y, uint16_t* row, const int clip_x0, const int clip_x1, const uint16_t ink) {
+  const LCD_Sprite* sprite = cmd->data;
+  const uint8_t phase = (LCD_SPRITE_PHASES == 2) ? (cmd->x & 1) : 0;
+  const uint8_t* pixels = sprite->data + (phase * sprite->nrows + (y - cmd->y)) * (sprite->stride + sprite->mask_stride);
+  const uint8_t* mask = pixels + sprite->stride;
+  for (int j = 0; j < sprite->ncols; j++) {
+    const int n = phase + j;
+    if (mask[n >> 3] & (1u << (n & 7))) {
+#if LCD_BITS_PER_PIXEL == 8
+      const uint8_t pixel = pixels[n];
+#else
+      const uint8_t pixel = (pixels[n >> 1] >> ((n & 1) ? 4 : 0)) & 0x0F;
+#endif
+      fill_span(row, cmd->x + j, cmd->x + j, clip_x0, clip_x1, render_palette[pixel]);
+    }
+  }
+}
+
+// Row y of an RGB565 image, byte-swapped like the palettes
+static void image_row(const LCD_List_Command* cmd, const int y, uint16_t* row, const int clip_x0, const int clip_x1, const uint16_t ink) {
+  const uint16_t* pixels = (const uint16_t*)cmd->data + (y - cmd->y) * cmd->b;
+  for (int j = 0; j < cmd->b; j++) {
+    const int x = cmd->x + j;
+    if (x >= clip_x0 && x <= clip_x1) {
+      row[x - clip_x0] = (uint16_t)((pixels[j] >> 8) | (pixels[j] << 8));
+    }
+  }
+}
+
+static void command_row(const LCD_List_Command* cmd, const int y, uint16_t* row, const int clip_x0, const int clip_x1) {
+  const uint16_t ink = (cmd->type & LIST_RGB) ? cmd->colour : render_palette[cmd->colour & LCD_COLOUR_MASK];
+  switch (cmd->type & ~LIST_RGB) {
+    case LIST_RECT:
+      if (cmd->param || y == cmd->y || y == cmd->y + cmd->b - 1) {
+        fill_span(row, cmd->x, cmd->x + cmd->a - 1, clip_x0, clip_x1, ink);
+      } else {
+        fill_span(row, cmd->x, cmd->x, clip_x0, clip_x1, ink);
+        fill_span(row, cmd->x + cmd->a - 1, cmd->x + cmd->a - 1, clip_x0, clip_x1, ink);
+      }
+      break;
+    case LIST_CIRCLE:
+      circle_row(cmd, y, row, clip_x0, clip_x1, ink);
+      break;
+    case LIST_LINE:
+      line_row(cmd, y, row, clip_x0, clip_x1, ink);
+      break;
+    case LIST_TEXT:
+      text_row(cmd, y, row, clip_x0, clip_x1, ink);
+      break;
+    case LIST_SPRITE:
+      sprite_row(cmd, y, row, clip_x0, clip_x1, ink);
+      break;
+    case LIST_BAKED_SPRITE:
+      baked_sprite_row(cmd, y, row, clip_x0, clip_x1, ink);
+      break;
+    case LIST_IMAGE:
+      image_row(cmd, y, row, clip_x0, clip_x1, ink);
+      break;
+  }
+}
+
+void LCD_List_Render_Rows(const uint16_t y, const uint16_t rows, const uint16_t x0, const uint16_t x1, const uint16_t* palette, uint16_t* out) {
+  // Gather the commands touching the band once, in drawing order, then paint row by row
+  static uint8_t band[LCD_LIST_MAX_COMMANDS];
+  uint16_t count = 0;
+  const uint16_t y1 = y + rows - 1;
+  for (uint16_t i = 0; i < command_count; i++) {
+    const LCD_List_Command* cmd = &commands[i];
+    if (cmd->by0 <= y1 && cmd->by1 >= y && cmd->bx0 <= x1 && cmd->bx1 >= x0) {
+      band[count++] = i;
+    }
+  }
+
+  render_palette = palette;
+  const uint16_t width = x1 - x0 + 1;
+  for (uint16_t r = 0; r < rows; r++) {
+    uint16_t* row = out + r * width;
+    fill_span(row, x0, x1, x0, x1, palette[background]);
+    for (uint16_t i = 0; i < count; i++) {
+      const LCD_List_Command* cmd = &commands[band[i]];
+      if (y + r >= cmd->by0 && y + r <= cmd->by1) {
+        // Only the columns of the bounding box, which holds the clip rectangle
+        const int cx0 = (cmd->bx0 > x0) ? cmd->bx0 : x0;
+        const int cx1 = (cmd->bx1 < x1) ? cmd->bx1 : x1;
+        command_row(cmd, y + r, row + (cx0 - x0), cx0, cx1);
+      }
+    }
+  }
+}
+
+#endif
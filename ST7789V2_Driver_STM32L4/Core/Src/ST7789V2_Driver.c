@@ -1,5 +1,11 @@
 #include "ST7789V2_Driver.h"
 
+static void spi_8bit_mode(SPI_TypeDef* spi_inst);
+static void spi_write_bytes(ST7789V2_cfg_t* cfg, const uint8_t* data, uint8_t len);
+static void spi_wait_idle(ST7789V2_cfg_t* cfg);
+static uint32_t dma_flag_shift(ST7789V2_cfg_t* cfg);
+static void transfer_wait(ST7789V2_cfg_t* cfg);
+
 void delay_ms_approx(uint16_t ms) {
   // Crude ms delay function, use hal for more accurate timing functions
   for (int i = 0; i < 5714*ms; i++) {
@@ -7,43 +13,128 @@ void delay_ms_approx(uint16_t ms) {
   }
 }
 
-void gpio_write(GPIO_Pin_t gpio, uint8_t val) {
+ST7789V2_RAMFUNC void gpio_write(GPIO_Pin_t gpio, uint8_t val) {
   gpio.port->BSRR = gpio.pin << (val ? GPIO_SET_LSB : GPIO_RESET_LSB);
 }
 
-void ST7789V2_Init(ST7789V2_cfg_t* cfg) {
+// Polls until (*reg & mask) == value. Gives up after ST7789V2_SPIN_LIMIT polls (doubled for each
+// slower SPI divider) and records ST7789V2_FAULT_SPI_TIMEOUT, or at once if a fault is already
+// recorded, so a dead bus costs one timeout rather than one per transfer. Returns 0 if it gave up.
+static ST7789V2_RAMFUNC uint8_t spi_wait_for(ST7789V2_cfg_t* cfg, volatile uint32_t* reg, uint32_t mask, uint32_t value) {
+  if ((*reg & mask) == value) {
+    return 1;
+  }
+  if (cfg->fault) {
+    return 0;
+  }
+  uint32_t spins = ST7789V2_SPIN_LIMIT << cfg->spi_baud_div;
+  while ((*reg & mask) != value) {
+    if (--spins == 0) {
+      cfg->fault |= ST7789V2_FAULT_SPI_TIMEOUT;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Steps of the power-up sequence run by ST7789V2_Init_Poll(). Each sends its commands, then
+// waits init_wait_ms before the next
+enum {
+  INIT_RESET_LOW = 1,   // RST held low (by ST7789V2_Init_Start)
+  INIT_SOFT_RESET,      // RST released, SWRESET
+  INIT_SLEEP_OUT,       // Backlight on, SLPOUT
+  INIT_COLOUR_MODE,     // COLMOD
+  INIT_INVERSION,       // MADCTL, INVON
+  INIT_NORMAL_MODE,     // NORON
+  INIT_DISPLAY_ON,      // TEON, address window, DISPON
+  INIT_DONE
+};
+
+void ST7789V2_Init_Start(ST7789V2_cfg_t* cfg, uint32_t now_ms) {
   gpio_init(cfg);
   spi_init(cfg);
   dma_init(cfg);
+  if (cfg->TE.port) {
+    te_init(cfg);
+  }
 
   cfg->setup_done = 1;
-  ST7789V2_Reset(cfg);
-
-  ST7789V2_BL_On(cfg);
-
-  ST7789V2_Send_Command(cfg, ST7789_SLPOUT);
-
-  // Wait for sleep out to propagate
-  delay_ms_approx(50);
-
-  ST7789V2_Send_Command(cfg, ST7789_COLMOD);
-  ST7789V2_Send_Data(cfg, 0x55);
 
-  delay_ms_approx(10);
-
-  ST7789V2_Send_Command(cfg, ST7789_MADCTL);
-  ST7789V2_Send_Data(cfg, 0x00);
-
-  ST7789V2_Send_Command(cfg, ST7789_INVON);
-  delay_ms_approx(10);
+  // Hardware reset: hold RST low for 50ms
+  gpio_write(cfg->RST, 0);
+  cfg->init_step = INIT_RESET_LOW;
+  cfg->init_wait_from = now_ms;
+  cfg->init_wait_ms = 50;
+}
 
-  ST7789V2_Send_Command(cfg, ST7789_NORON);
-  delay_ms_approx(10);
+uint8_t ST7789V2_Init_Poll(ST7789V2_cfg_t* cfg, uint32_t now_ms) {
+  if (cfg->init_step == INIT_DONE) {
+    return 1;
+  }
+  if (cfg->init_step == 0 || now_ms - cfg->init_wait_from < cfg->init_wait_ms) {
+    return 0;
+  }
 
-  ST7789V2_Set_Address_Window(cfg, 0, 20, 239, 299); 
+  uint16_t wait_ms = 10;
+  switch (cfg->init_step) {
+    case INIT_RESET_LOW: {
+      gpio_write(cfg->RST, 1);
+      ST7789V2_Send_Command(cfg, ST7789_SWRESET);
+      // Reset restores the default window, so the cached one is stale
+      cfg->window_valid = 0;
+      // Wait 120ms after resetting before sleep out
+      wait_ms = 150;
+      break;
+    }
+    case INIT_SOFT_RESET: {
+      ST7789V2_BL_On(cfg);
+      ST7789V2_Send_Command(cfg, ST7789_SLPOUT);
+      // Wait for sleep out to propagate
+      wait_ms = 50;
+      break;
+    }
+    case INIT_SLEEP_OUT: {
+      const uint8_t colour_mode = ST7789_COLOR_MODE_16bit;
+      ST7789V2_Send_Command_With_Params(cfg, ST7789_COLMOD, &colour_mode, 1);
+      break;
+    }
+    case INIT_COLOUR_MODE: {
+      const uint8_t memory_access = 0x00;
+      ST7789V2_Send_Command_With_Params(cfg, ST7789_MADCTL, &memory_access, 1);
+      ST7789V2_Send_Command(cfg, ST7789_INVON);
+      break;
+    }
+    case INIT_INVERSION: {
+      ST7789V2_Send_Command(cfg, ST7789_NORON);
+      break;
+    }
+    case INIT_NORMAL_MODE: {
+      if (cfg->TE.port) {
+        // TE output on, pulsing at vertical blank only
+        const uint8_t te_mode = 0x00;
+        ST7789V2_Send_Command_With_Params(cfg, ST7789_TEON, &te_mode, 1);
+      }
+      ST7789V2_Set_Address_Window(cfg, 0, 20, 239, 299);
+      ST7789V2_Send_Command(cfg, ST7789_DISPON);
+      break;
+    }
+    default:  // INIT_DISPLAY_ON, its wait is over
+      break;
+  }
+  cfg->init_step++;
+  cfg->init_wait_from = now_ms;
+  cfg->init_wait_ms = wait_ms;
+  return cfg->init_step == INIT_DONE;
+}
 
-  ST7789V2_Send_Command(cfg, 0x29);
-  delay_ms_approx(10);
+void ST7789V2_Init(ST7789V2_cfg_t* cfg) {
+  // The same sequence, spending the waits in delay_ms_approx
+  uint32_t ms = 0;
+  ST7789V2_Init_Start(cfg, ms);
+  while (!ST7789V2_Init_Poll(cfg, ms)) {
+    delay_ms_approx(1);
+    ms++;
+  }
 }
 
 void ST7789V2_Reset(ST7789V2_cfg_t* cfg) {
@@ -57,13 +148,15 @@ void ST7789V2_Reset(ST7789V2_cfg_t* cfg) {
 
     // Software reset
     ST7789V2_Send_Command(cfg, ST7789_SWRESET);
+    // Reset restores the default window, so the cached one is stale
+    cfg->window_valid = 0;
 
     // Wait 120ms after resetting before sleep out
     delay_ms_approx(150);  
   }
 }
 
-void ST7789V2_Send_Command(ST7789V2_cfg_t* cfg, uint8_t command) {
+ST7789V2_RAMFUNC void ST7789V2_Send_Command(ST7789V2_cfg_t* cfg, uint8_t command) {
   if (cfg->setup_done) {    
     // Deassert CS
     gpio_write(cfg->CS, 1);
@@ -76,6 +169,28 @@ void ST7789V2_Send_Command(ST7789V2_cfg_t* cfg, uint8_t command) {
   }
 }
 
+ST7789V2_RAMFUNC void ST7789V2_Send_Command_With_Params(ST7789V2_cfg_t* cfg, uint8_t command, const uint8_t* params, uint8_t n) {
+  if (cfg->setup_done) {
+    SPI_TypeDef* spi_inst = cfg->spi;
+
+    // Wait for any previous transmissions to finish
+    spi_wait_idle(cfg);
+    spi_8bit_mode(spi_inst);
+
+    // Command byte with DC 0, CS held for the whole transaction
+    gpio_write(cfg->DC, 0);
+    gpio_write(cfg->CS, 0);
+    spi_write_bytes(cfg, &command, 1);
+
+    // Parameters with DC 1
+    gpio_write(cfg->DC, 1);
+    spi_write_bytes(cfg, params, n);
+
+    // Deassert CS
+    gpio_write(cfg->CS, 1);
+  }
+}
+
 void ST7789V2_Send_Data(ST7789V2_cfg_t* cfg, uint8_t data) {
   if (cfg->setup_done) {
     // Set DC 1
@@ -87,6 +202,18 @@ void ST7789V2_Send_Data(ST7789V2_cfg_t* cfg, uint8_t data) {
 }
 
 void ST7789V2_Send_Data_Block(ST7789V2_cfg_t* cfg, uint8_t* data, uint32_t length) {
+  if (cfg->setup_done) {
+    // CS control is done in dma transmit function
+
+    // Set DC 1
+    gpio_write(cfg->DC, 1);
+
+    // Send data, in chunks if it is longer than one DMA run (waits for the SPI first)
+    ST7789V2_Transfer_Start(cfg, data, length, ST7789V2_XFER_BYTES, NULL, NULL);
+  }
+}
+
+ST7789V2_RAMFUNC void ST7789V2_Send_Pixels(ST7789V2_cfg_t* cfg, uint16_t* pixels, uint16_t count) {
   if (cfg->setup_done) {
     // CS control is done in dma transmit function
 
@@ -94,28 +221,42 @@ void ST7789V2_Send_Data_Block(ST7789V2_cfg_t* cfg, uint8_t* data, uint32_t lengt
     gpio_write(cfg->DC, 1);
 
     // Wait for any previous transmissions to finish
-    while(cfg->spi->SR & SPI_SR_BSY) {
-      ;
-    }
+    spi_wait_idle(cfg);
 
-    // Send data
-    spi_transmit_dma_8bit(cfg, data, length);
+    // Send data, one 16-bit frame per pixel (sent MSB first)
+    spi_transmit_dma_16bit(cfg, pixels, count);
   }
 }
 
-void ST7789V2_Set_Address_Window(ST7789V2_cfg_t* cfg, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
-  while (cfg->spi->SR & SPI_SR_BSY);
-  ST7789V2_Send_Command(cfg, ST7789_CASET);
-  ST7789V2_Send_Data(cfg, x0 >> 8);
-  ST7789V2_Send_Data(cfg, x0 & 0xFF);
-  ST7789V2_Send_Data(cfg, x1 >> 8);
-  ST7789V2_Send_Data(cfg, x1 & 0xFF);
+// Sends a CASET/RASET command with its start and end address as one transaction
+static ST7789V2_RAMFUNC void send_address(ST7789V2_cfg_t* cfg, uint8_t command, uint16_t start, uint16_t end) {
+  const uint8_t params[4] = { start >> 8, start & 0xFF, end >> 8, end & 0xFF };
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.window_commands++;
+#endif
+  ST7789V2_Send_Command_With_Params(cfg, command, params, sizeof(params));
+}
 
-  ST7789V2_Send_Command(cfg, ST7789_RASET);
-  ST7789V2_Send_Data(cfg, y0 >> 8);
-  ST7789V2_Send_Data(cfg, y0 & 0xFF);
-  ST7789V2_Send_Data(cfg, y1 >> 8);
-  ST7789V2_Send_Data(cfg, y1 & 0xFF);
+ST7789V2_RAMFUNC void ST7789V2_Set_Address_Window(ST7789V2_cfg_t* cfg, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+  if (!cfg->setup_done) {
+    return;
+  }
+  spi_wait_idle(cfg);
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.windows++;
+#endif
+  // The panel keeps the window until it is changed, so only resend the parts that differ
+  if (!cfg->window_valid || x0 != cfg->window_x0 || x1 != cfg->window_x1) {
+    send_address(cfg, ST7789_CASET, x0, x1);
+    cfg->window_x0 = x0;
+    cfg->window_x1 = x1;
+  }
+  if (!cfg->window_valid || y0 != cfg->window_y0 || y1 != cfg->window_y1) {
+    send_address(cfg, ST7789_RASET, y0, y1);
+    cfg->window_y0 = y0;
+    cfg->window_y1 = y1;
+  }
+  cfg->window_valid = 1;
 }
 
 void ST7789V2_Clear_RAM(ST7789V2_cfg_t* cfg);
@@ -128,31 +269,302 @@ void ST7789V2_BL_Off(ST7789V2_cfg_t* cfg) {
   gpio_write(cfg->BL, 0);
 }
 
-void ST7789V2_Fill(ST7789V2_cfg_t* cfg, uint16_t* colour, uint32_t len) {
+ST7789V2_RAMFUNC void ST7789V2_Fill(ST7789V2_cfg_t* cfg, uint16_t* colour, uint32_t len) {
   ST7789V2_Send_Command(cfg, ST7789_RAMWR);
-  if (len & 0xFFFF0000) {
-    spi_transmit_dma_16bit_noinc(cfg, colour, 65535);
-    while (cfg->spi->SR & SPI_SR_BSY);
-    spi_transmit_dma_16bit_noinc(cfg, colour, len - 65535);
+  ST7789V2_Transfer_Start(cfg, colour, len, ST7789V2_XFER_FILL, NULL, NULL);
+}
+
+static ST7789V2_RAMFUNC uint32_t transfer_item_bytes(uint8_t kind) {
+  return (kind == ST7789V2_XFER_BYTES) ? 1u : 2u;
+}
+
+ST7789V2_RAMFUNC void ST7789V2_Transfer_Start(ST7789V2_cfg_t* cfg, const void* data, uint32_t count, uint8_t kind,
+                                              ST7789V2_Transfer_Done done, void* context) {
+  if (!cfg->setup_done) {
+    return;
+  }
+  // Wait for the previous transfer, chunked or not, to finish
+  spi_wait_idle(cfg);
+  if (count == 0) {
+    if (done != NULL) {
+      done(cfg, context);
+    }
+    return;
+  }
+
+  ST7789V2_Transfer_t* transfer = &cfg->transfer;
+  const uint16_t first = (count > ST7789V2_DMA_MAX_ITEMS) ? ST7789V2_DMA_MAX_ITEMS : (uint16_t)count;
+  transfer->kind = kind;
+  transfer->done = done;
+  transfer->context = context;
+  transfer->remaining = count - first;
+  transfer->next = (const uint8_t*)data + ((kind == ST7789V2_XFER_FILL) ? 0 : first * transfer_item_bytes(kind));
+  // Flagged busy first, the interrupt can come as soon as the DMA starts. Only a transfer that
+  // needs the interrupt is busy: a single chunk with no callback goes as it always did.
+  transfer->busy = (transfer->remaining != 0 || done != NULL);
+
+  if (kind == ST7789V2_XFER_BYTES) {
+    spi_transmit_dma_8bit(cfg, (uint8_t*)data, first);
+  }
+  else if (kind == ST7789V2_XFER_PIXELS) {
+    spi_transmit_dma_16bit(cfg, (uint16_t*)data, first);
   }
   else {
-    spi_transmit_dma_16bit_noinc(cfg, colour, len);
+    spi_transmit_dma_16bit_noinc(cfg, (uint16_t*)data, first);
   }
 }
 
-void gpio_init(ST7789V2_cfg_t* cfg) {
-  RCC->AHB2ENR |= RCC_AHB2ENR_GPIOBEN; // GPIOB for SPI2 pins
+ST7789V2_RAMFUNC uint8_t ST7789V2_Transfer_Next(ST7789V2_cfg_t* cfg) {
+  ST7789V2_Transfer_t* transfer = &cfg->transfer;
+  if (!transfer->busy) {
+    return 0;
+  }
+  if (transfer->remaining == 0) {
+    transfer->busy = 0;
+    if (transfer->done != NULL) {
+      transfer->done(cfg, transfer->context);
+    }
+    return 0;
+  }
+
+  // Re-arm the channel where the last chunk ended. The SPI stays as the first chunk set it up,
+  // still sending what is in its FIFO, and CS stays low, so the panel sees one long write.
+  const uint16_t count = (transfer->remaining > ST7789V2_DMA_MAX_ITEMS) ? ST7789V2_DMA_MAX_ITEMS : (uint16_t)transfer->remaining;
+  cfg->dma.channel->CCR &= ~DMA_CCR_EN;
+  cfg->dma.channel->CMAR = (uint32_t)transfer->next;
+  cfg->dma.channel->CNDTR = count;
+  transfer->remaining -= count;
+  if (transfer->kind != ST7789V2_XFER_FILL) {
+    transfer->next += count * transfer_item_bytes(transfer->kind);
+  }
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.pixel_bytes += count * transfer_item_bytes(transfer->kind);
+#endif
+  cfg->dma.channel->CCR |= DMA_CCR_EN;
+  return 1;
+}
 
-  GPIOB->MODER = 0xB97FFFD7;
-  GPIOB->OTYPER = 0x00000000;
-  GPIOB->OSPEEDR = 0xCF000000;
-  GPIOB->PUPDR = 0x00000010;
-  GPIOB->AFR[1] = 0x50500000;
+// Waits for a chunked transfer to finish. Each chunk gets the time a wait for the SPI does.
+static ST7789V2_RAMFUNC void transfer_wait(ST7789V2_cfg_t* cfg) {
+  while (cfg->transfer.busy && !cfg->fault) {
+    const uint32_t remaining = cfg->transfer.remaining;
+    uint32_t spins = ST7789V2_SPIN_LIMIT << cfg->spi_baud_div;
+    while (cfg->transfer.busy && cfg->transfer.remaining == remaining) {
+      if (--spins == 0) {
+        cfg->fault |= ST7789V2_FAULT_SPI_TIMEOUT;
+        return;
+      }
+    }
+  }
+}
+
+// Changes the baud-rate divider, the SPI must not be busy
+static void spi_set_baud(SPI_TypeDef* spi_inst, uint8_t baud_div) {
+  spi_inst->CR1 &= ~SPI_CR1_SPE;
+  spi_inst->CR1 = (spi_inst->CR1 & ~SPI_CR1_BR_Msk) | ((baud_div & 0x7) << SPI_CR1_BR_Pos);
+  spi_inst->CR1 |= SPI_CR1_SPE;
+}
+
+// Waits for a DMA transfer to be fully shifted out. A transfer error stops the channel with
+// data left to send, so it is checked for while waiting.
+static void spi_wait_dma_done(ST7789V2_cfg_t* cfg) {
+  const uint32_t te_flag = DMA_ISR_TEIF1 << dma_flag_shift(cfg);
+  uint32_t spins = ST7789V2_SPIN_LIMIT << cfg->spi_baud_div;
+  while (cfg->dma.channel->CNDTR && !cfg->fault) {
+    if (cfg->dma.instance->ISR & te_flag) {
+      ST7789V2_DMA_Abort(cfg);
+      cfg->fault |= ST7789V2_FAULT_DMA_ERROR;
+    }
+    else if (--spins == 0) {
+      cfg->fault |= ST7789V2_FAULT_SPI_TIMEOUT;
+    }
+  }
+  spi_wait_for(cfg, &cfg->spi->SR, SPI_SR_FTLVL | SPI_SR_BSY, 0);
+}
+
+// Switches to 1-line receive mode, which starts the clock. CS must be asserted, DC high and the
+// SPI in 8-bit mode. The clock runs freely while receiving, so spi_receive_stop() deasserts CS
+// before stopping the SPI, the panel ignores the extra clocks.
+static void spi_receive_start(ST7789V2_cfg_t* cfg) {
+  SPI_TypeDef* spi_inst = cfg->spi;
+  spi_inst->CR1 &= ~SPI_CR1_SPE;
+  spi_inst->CR1 &= ~SPI_CR1_BIDIOE;
+  spi_inst->CR1 |= SPI_CR1_SPE;  // Starts the clock
+}
+
+static uint8_t spi_receive_byte(ST7789V2_cfg_t* cfg) {
+  spi_wait_for(cfg, &cfg->spi->SR, SPI_SR_RXNE, SPI_SR_RXNE);
+  return *((__IO uint8_t*)&cfg->spi->DR);
+}
+
+static void spi_receive_stop(ST7789V2_cfg_t* cfg) {
+  SPI_TypeDef* spi_inst = cfg->spi;
+  gpio_write(cfg->CS, 1);
+  spi_inst->CR1 &= ~SPI_CR1_SPE;
+
+  // Drain anything received after the last byte
+  while (spi_inst->SR & SPI_SR_RXNE) {
+    (void)*((__IO uint8_t*)&spi_inst->DR);
+  }
+
+  spi_inst->CR1 |= SPI_CR1_BIDIOE;
+  spi_inst->CR1 |= SPI_CR1_SPE;
+}
+
+// Reads len bytes in 1-line receive mode, see spi_receive_start()
+static void spi_read_bytes(ST7789V2_cfg_t* cfg, uint8_t* data, uint8_t len) {
+  spi_receive_start(cfg);
+  for (uint8_t i = 0; i < len; i++) {
+    data[i] = spi_receive_byte(cfg);
+  }
+  spi_receive_stop(cfg);
+}
+
+void ST7789V2_Set_Scroll_Area(ST7789V2_cfg_t* cfg, uint16_t top_fixed, uint16_t bottom_fixed) {
+  const uint16_t bottom = bottom_fixed + (ST7789V2_GRAM_HEIGHT - ST7789V2_HEIGHT);
+  const uint16_t scroll = ST7789V2_GRAM_HEIGHT - top_fixed - bottom;
+  const uint8_t params[6] = { top_fixed >> 8, top_fixed & 0xFF, scroll >> 8, scroll & 0xFF, bottom >> 8, bottom & 0xFF };
+  ST7789V2_Send_Command_With_Params(cfg, ST7789_VSCRDEF, params, sizeof(params));
+}
+
+void ST7789V2_Set_Scroll_Start(ST7789V2_cfg_t* cfg, uint16_t row) {
+  const uint8_t params[2] = { row >> 8, row & 0xFF };
+  ST7789V2_Send_Command_With_Params(cfg, ST7789_VSCSAD, params, sizeof(params));
+}
+
+void ST7789V2_Set_Partial_Mode(ST7789V2_cfg_t* cfg, uint8_t on, uint16_t start, uint16_t end) {
+  if (on) {
+    const uint8_t params[4] = { start >> 8, start & 0xFF, end >> 8, end & 0xFF };
+    ST7789V2_Send_Command_With_Params(cfg, ST7789_PTLAR, params, sizeof(params));
+    ST7789V2_Send_Command(cfg, ST7789_PTLON);
+  } else {
+    ST7789V2_Send_Command(cfg, ST7789_NORON);
+  }
+}
+
+void ST7789V2_Set_Idle_Mode(ST7789V2_cfg_t* cfg, uint8_t on) {
+  ST7789V2_Send_Command(cfg, on ? ST7789_IDMON : ST7789_IDMOFF);
+}
+
+void ST7789V2_Set_Baud_Div(ST7789V2_cfg_t* cfg, uint8_t baud_div) {
+  spi_wait_idle(cfg);
+  spi_set_baud(cfg->spi, baud_div);
+  cfg->spi_baud_div = baud_div & 0x7;
+}
+
+uint8_t ST7789V2_Test_Baud(ST7789V2_cfg_t* cfg, uint8_t baud_div) {
+  // Alternating bits and every colour channel edge
+  uint16_t pattern[8] = { 0xAAAA, 0x5555, 0xFFFF, 0x0000, 0xF800, 0x07E0, 0x001F, 0x1234 };
+  const uint8_t n = sizeof(pattern) / sizeof(pattern[0]);
+  // RAMRD returns 3 bytes (RGB666) per pixel, after a dummy clock, so read one byte extra
+  uint8_t raw[3 * 8 + 1];
+
+  if (!cfg->setup_done) {
+    return 0;
+  }
+
+  // Write the pattern at the divider under test
+  ST7789V2_Set_Baud_Div(cfg, baud_div);
+  ST7789V2_Set_Address_Window(cfg, 0, 0, n - 1, 0);
+  ST7789V2_Send_Command(cfg, ST7789_RAMWR);
+  ST7789V2_Send_Pixels(cfg, pattern, n);
+  spi_wait_dma_done(cfg);
+
+  // Read it back slowly, so only write errors show up
+  spi_set_baud(cfg->spi, ST7789V2_READ_BAUD_DIV);
+  spi_8bit_mode(cfg->spi);
+  gpio_write(cfg->DC, 0);
+  gpio_write(cfg->CS, 0);
+  spi_write_bytes(cfg, (const uint8_t[]){ ST7789_RAMRD }, 1);
+  gpio_write(cfg->DC, 1);
+  spi_read_bytes(cfg, raw, sizeof(raw));
+  spi_set_baud(cfg->spi, baud_div);
+
+  for (uint8_t i = 0; i < n; i++) {
+    uint8_t rgb[3];
+    // Realign the bit stream after the dummy clock
+    for (uint8_t c = 0; c < 3; c++) {
+      rgb[c] = (raw[3 * i + c] << 1) | (raw[3 * i + c + 1] >> 7);
+    }
+    // Colour components come back left aligned in each byte
+    if ((rgb[0] >> 3) != (pattern[i] >> 11) ||
+        (rgb[1] >> 2) != ((pattern[i] >> 5) & 0x3F) ||
+        (rgb[2] >> 3) != (pattern[i] & 0x1F)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void ST7789V2_Read_Pixels(ST7789V2_cfg_t* cfg, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t* pixels) {
+  const uint32_t count = (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+  if (!cfg->setup_done) {
+    return;
+  }
+
+  ST7789V2_Set_Address_Window(cfg, x0, y0, x1, y1);
+  spi_wait_dma_done(cfg);
+  spi_set_baud(cfg->spi, ST7789V2_READ_BAUD_DIV);
+  spi_8bit_mode(cfg->spi);
+  gpio_write(cfg->DC, 0);
+  gpio_write(cfg->CS, 0);
+  spi_write_bytes(cfg, (const uint8_t[]){ ST7789_RAMRD }, 1);
+  gpio_write(cfg->DC, 1);
+
+  // 3 bytes (RGB666) per pixel after a dummy clock, as in ST7789V2_Test_Baud(): each byte is
+  // realigned with the first bit of the next as they come in
+  spi_receive_start(cfg);
+  uint8_t previous = spi_receive_byte(cfg);
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t rgb[3];
+    for (uint8_t c = 0; c < 3; c++) {
+      const uint8_t next = spi_receive_byte(cfg);
+      rgb[c] = (previous << 1) | (next >> 7);
+      previous = next;
+    }
+    pixels[i] = ((uint16_t)(rgb[0] >> 3) << 11) | ((uint16_t)(rgb[1] >> 2) << 5) | (rgb[2] >> 3);
+  }
+  spi_receive_stop(cfg);
+  spi_set_baud(cfg->spi, cfg->spi_baud_div);
+}
+
+// Enables the clock of a pin's port and sets its mode (0 input, 1 output, 2 alternate function),
+// output speed (0 low to 3 very high), pull (0 none, 1 up) and alternate function
+static void gpio_pin_init(GPIO_Pin_t gpio, uint32_t mode, uint32_t speed, uint32_t pull, uint32_t af) {
+  const uint32_t pin = __builtin_ctz(gpio.pin);
+  const uint32_t port = ((uint32_t)gpio.port - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE);
+  RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN << port;
+
+  gpio.port->MODER = (gpio.port->MODER & ~(0x3u << (2 * pin))) | (mode << (2 * pin));
+  gpio.port->OTYPER &= ~(uint32_t)gpio.pin;
+  gpio.port->OSPEEDR = (gpio.port->OSPEEDR & ~(0x3u << (2 * pin))) | (speed << (2 * pin));
+  gpio.port->PUPDR = (gpio.port->PUPDR & ~(0x3u << (2 * pin))) | (pull << (2 * pin));
+  gpio.port->AFR[pin >> 3] = (gpio.port->AFR[pin >> 3] & ~(0xFu << (4 * (pin & 7)))) | (af << (4 * (pin & 7)));
+}
+
+void gpio_init(ST7789V2_cfg_t* cfg) {
+  // Only the panel's own pins are touched, so two panels (or other peripherals) can share a port.
+  // SPI1 and SPI2 are AF5, SPI3 is AF6.
+  const uint32_t af = (cfg->spi == SPI3) ? 6 : 5;
+  gpio_pin_init(cfg->BL, 1, 0, 0, 0);
+  gpio_pin_init(cfg->RST, 1, 0, 1, 0);
+  gpio_pin_init(cfg->DC, 1, 0, 0, 0);
+  gpio_pin_init(cfg->CS, 1, 3, 0, 0);
+  gpio_pin_init(cfg->SCLK, 2, 3, 0, af);
+  gpio_pin_init(cfg->MOSI, 2, 3, 0, af);
 }
 
 void spi_init(ST7789V2_cfg_t* cfg) {
-  // Enable SPI clock
-  RCC->APB1ENR1 |= RCC_APB1ENR1_SPI2EN;
+  // Enable SPI clock (SPI1 is on APB2, SPI2 and SPI3 on APB1)
+  if (cfg->spi == SPI1) {
+    RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;
+  }
+  else if (cfg->spi == SPI3) {
+    RCC->APB1ENR1 |= RCC_APB1ENR1_SPI3EN;
+  }
+  else {
+    RCC->APB1ENR1 |= RCC_APB1ENR1_SPI2EN;
+  }
 
   // Disable SPI
   cfg->spi->CR1 &= ~SPI_CR1_SPE;
@@ -162,8 +574,8 @@ void spi_init(ST7789V2_cfg_t* cfg) {
                   SPI_CR1_BIDIOE   |
                   SPI_CR1_SSM      |
                   SPI_CR1_SSI      |
-                  SPI_CR1_MSTR;
-                  // | SPI_CR1_BR_1;
+                  SPI_CR1_MSTR     |
+                  ((cfg->spi_baud_div & 0x7) << SPI_CR1_BR_Pos);
 
   // Set CR2
   cfg->spi->CR2 = SPI_CR2_FRXTH    |
@@ -174,11 +586,33 @@ void spi_init(ST7789V2_cfg_t* cfg) {
 
   // Enable SPI
   cfg->spi->CR1 |= SPI_CR1_SPE;
+
+#if ST7789V2_BUS_STATS
+  // Busy waits are timed with the cycle counter
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+static IRQn_Type dma_irqn(ST7789V2_cfg_t* cfg) {
+  if (cfg->dma.channel == DMA1_Channel3) {
+    return DMA1_Channel3_IRQn;
+  }
+  else if (cfg->dma.channel == DMA2_Channel2) {
+    return DMA2_Channel2_IRQn;
+  }
+  return DMA1_Channel5_IRQn;
+}
+
+// Each channel owns 4 bits (GIF, TCIF, HTIF, TEIF) of the DMA ISR/IFCR registers
+static uint32_t dma_flag_shift(ST7789V2_cfg_t* cfg) {
+  const uint32_t first_channel = (cfg->dma.instance == DMA1) ? DMA1_Channel1_BASE : DMA2_Channel1_BASE;
+  return 4u * (((uint32_t)cfg->dma.channel - first_channel) / (DMA1_Channel2_BASE - DMA1_Channel1_BASE));
 }
 
 void dma_init(ST7789V2_cfg_t* cfg) {
-  // Enable DMA1 clock
-  RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+  // Enable the DMA controller's clock
+  RCC->AHB1ENR |= (cfg->dma.instance == DMA2) ? RCC_AHB1ENR_DMA2EN : RCC_AHB1ENR_DMA1EN;
 
   // Set DMA CCR
   cfg->dma.channel->CCR = DMA_CCR_PL_0 |
@@ -196,14 +630,103 @@ void dma_init(ST7789V2_cfg_t* cfg) {
   else if (cfg->dma.channel == DMA2_Channel2) {
     DMA2_CSELR->CSELR |= 0x3 << DMA_CSELR_C2S_Pos;
   }
+
+  // Enable the channel interrupt in the NVIC. Transfer errors always raise it, the end of a
+  // transfer only when dma_tc_irq is set or ST7789V2_Transfer_Start() needs it (more chunks to
+  // send, or a callback).
+  NVIC_SetPriority(dma_irqn(cfg), 1);
+  NVIC_EnableIRQ(dma_irqn(cfg));
 }
 
-void spi_transmit_byte(ST7789V2_cfg_t* cfg, uint8_t data) {
-  SPI_TypeDef* spi_inst = cfg->spi;
+static IRQn_Type exti_irqn(uint32_t line) {
+  if (line <= 4) {
+    return (IRQn_Type)(EXTI0_IRQn + line);
+  }
+  else if (line <= 9) {
+    return EXTI9_5_IRQn;
+  }
+  return EXTI15_10_IRQn;
+}
 
-  // Wait for not busy
-  while (spi_inst->SR & SPI_SR_BSY);
-  
+void te_init(ST7789V2_cfg_t* cfg) {
+  const uint32_t line = __builtin_ctz(cfg->TE.pin);
+  const uint32_t port = ((uint32_t)cfg->TE.port - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE);
+
+  // Input, no pull
+  RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN << port;
+  cfg->TE.port->MODER &= ~(0x3u << (2 * line));
+  cfg->TE.port->PUPDR &= ~(0x3u << (2 * line));
+
+  // Route the pin to its EXTI line, interrupt on the rising edge
+  RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+  SYSCFG->EXTICR[line >> 2] = (SYSCFG->EXTICR[line >> 2] & ~(0xFu << (4 * (line & 3)))) |
+                              (port << (4 * (line & 3)));
+  EXTI->RTSR1 |= cfg->TE.pin;
+  EXTI->FTSR1 &= ~(uint32_t)cfg->TE.pin;
+  EXTI->PR1 = cfg->TE.pin;
+  EXTI->IMR1 |= cfg->TE.pin;
+
+  NVIC_SetPriority(exti_irqn(line), 1);
+  NVIC_EnableIRQ(exti_irqn(line));
+}
+
+ST7789V2_RAMFUNC uint8_t ST7789V2_TE_Clear(ST7789V2_cfg_t* cfg) {
+  if (cfg->TE.port && (EXTI->PR1 & cfg->TE.pin)) {
+    EXTI->PR1 = cfg->TE.pin;
+    return 1;
+  }
+  return 0;
+}
+
+ST7789V2_RAMFUNC uint8_t ST7789V2_DMA_TC_Clear(ST7789V2_cfg_t* cfg) {
+  const uint32_t tc_flag = DMA_ISR_TCIF1 << dma_flag_shift(cfg);
+  if (cfg->dma.instance->ISR & tc_flag) {
+    cfg->dma.instance->IFCR = tc_flag;
+    return 1;
+  }
+  return 0;
+}
+
+ST7789V2_RAMFUNC uint8_t ST7789V2_DMA_Error_Clear(ST7789V2_cfg_t* cfg) {
+  if (cfg->dma.instance->ISR & (DMA_ISR_TEIF1 << dma_flag_shift(cfg))) {
+    ST7789V2_DMA_Abort(cfg);
+    cfg->fault |= ST7789V2_FAULT_DMA_ERROR;
+    return 1;
+  }
+  return 0;
+}
+
+ST7789V2_RAMFUNC void ST7789V2_DMA_Abort(ST7789V2_cfg_t* cfg) {
+  cfg->dma.channel->CCR &= ~(DMA_CCR_EN | DMA_CCR_TCIE | DMA_CCR_TEIE);
+  cfg->dma.instance->IFCR = 0xFu << dma_flag_shift(cfg);
+  cfg->dma_tc_irq = 0;
+  cfg->transfer.remaining = 0;
+  cfg->transfer.busy = 0;
+  gpio_write(cfg->CS, 1);
+}
+
+void ST7789V2_Recover(ST7789V2_cfg_t* cfg) {
+  ST7789V2_DMA_Abort(cfg);
+  // Reset the SPI peripheral too, in case it is what got stuck
+  if (cfg->spi == SPI1) {
+    RCC->APB2RSTR |= RCC_APB2RSTR_SPI1RST;
+    RCC->APB2RSTR &= ~RCC_APB2RSTR_SPI1RST;
+  }
+  else if (cfg->spi == SPI2) {
+    RCC->APB1RSTR1 |= RCC_APB1RSTR1_SPI2RST;
+    RCC->APB1RSTR1 &= ~RCC_APB1RSTR1_SPI2RST;
+  }
+  else if (cfg->spi == SPI3) {
+    RCC->APB1RSTR1 |= RCC_APB1RSTR1_SPI3RST;
+    RCC->APB1RSTR1 &= ~RCC_APB1RSTR1_SPI3RST;
+  }
+  cfg->fault = 0;
+  ST7789V2_Init(cfg);
+}
+
+// Puts the SPI in 8-bit, non-DMA mode. Only touches the peripheral if a 16-bit or DMA
+// transfer left it in another mode. Call with the SPI not busy.
+static ST7789V2_RAMFUNC void spi_8bit_mode(SPI_TypeDef* spi_inst) {
   // Check for 16 bit data or DMA enabled
   if (spi_inst->CR2 & (SPI_CR2_DS_3 | SPI_CR2_TXDMAEN)) {
     // Disable SPI and clear DS and DMA en
@@ -216,30 +739,70 @@ void spi_transmit_byte(ST7789V2_cfg_t* cfg, uint8_t data) {
     // Enable SPI
     spi_inst->CR1 |= SPI_CR1_SPE;
   }
+}
 
-  // Assert CS
-  gpio_write(cfg->CS, 0);
+// Writes bytes back to back, keeping the TX FIFO topped up, and waits for them to go out.
+// CS must already be asserted.
+static ST7789V2_RAMFUNC void spi_write_bytes(ST7789V2_cfg_t* cfg, const uint8_t* data, uint8_t len) {
+  SPI_TypeDef* spi_inst = cfg->spi;
+  for (uint8_t i = 0; i < len; i++) {
+    spi_wait_for(cfg, &spi_inst->SR, SPI_SR_TXE, SPI_SR_TXE);
+    *((__IO uint8_t*)&spi_inst->DR) = data[i];
+  }
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.command_bytes += len;
+#endif
+
+  // Wait for not busy
+  spi_wait_idle(cfg);
+}
+
+// Waits for the SPI to finish what it is sending. With ST7789V2_BUS_STATS the cycles spent
+// here are counted, so the time the CPU loses to a busy bus shows up.
+static ST7789V2_RAMFUNC void spi_wait_idle(ST7789V2_cfg_t* cfg) {
+#if ST7789V2_BUS_STATS
+  if (!cfg->transfer.busy && !(cfg->spi->SR & SPI_SR_BSY)) {
+    return;
+  }
+  const uint32_t start = DWT->CYCCNT;
+  transfer_wait(cfg);
+  spi_wait_for(cfg, &cfg->spi->SR, SPI_SR_BSY, 0);
+  cfg->bus_stats.busy_cycles += DWT->CYCCNT - start;
+#else
+  transfer_wait(cfg);
+  spi_wait_for(cfg, &cfg->spi->SR, SPI_SR_BSY, 0);
+#endif
+}
 
-  // Write data
-  *((__IO uint8_t*)&spi_inst->DR) = data;
+ST7789V2_RAMFUNC void spi_transmit_byte(ST7789V2_cfg_t* cfg, uint8_t data) {
+  spi_transmit_bytes(cfg, &data, 1);
+}
+
+ST7789V2_RAMFUNC void spi_transmit_bytes(ST7789V2_cfg_t* cfg, const uint8_t* data, uint8_t len) {
+  SPI_TypeDef* spi_inst = cfg->spi;
 
   // Wait for not busy
-  while (spi_inst->SR & SPI_SR_BSY);
+  spi_wait_idle(cfg);
+  spi_8bit_mode(spi_inst);
+
+  // Assert CS once for the whole burst
+  gpio_write(cfg->CS, 0);
+
+  spi_write_bytes(cfg, data, len);
 
   // Deassert CS
   gpio_write(cfg->CS, 1);
 }
 
-void spi_transmit_dma_8bit(ST7789V2_cfg_t* cfg, uint8_t* data, uint16_t len) {  
+ST7789V2_RAMFUNC void spi_transmit_dma_8bit(ST7789V2_cfg_t* cfg, uint8_t* data, uint16_t len) {  
   // Deassert CS
   gpio_write(cfg->CS, 1);
   
   // Set DC
   gpio_write(cfg->DC, 1);
 
-  // Clear interrupts
-  uint32_t isr = DMA1->ISR;
-  DMA1->IFCR = isr;
+  // Clear this channel's interrupt flags (other channels on the controller may be in use)
+  cfg->dma.instance->IFCR = 0xFu << dma_flag_shift(cfg);
 
   SPI_TypeDef* spi_inst = cfg->spi;
 
@@ -254,8 +817,8 @@ void spi_transmit_dma_8bit(ST7789V2_cfg_t* cfg, uint8_t* data, uint16_t len) {
   // Clear DMA CCR
   cfg->dma.channel->CCR = 0;
 
-  // Peripheral = SPI2 data register
-  cfg->dma.channel->CPAR = (uint32_t)&SPI2->DR; 
+  // Peripheral = the panel's SPI data register
+  cfg->dma.channel->CPAR = (uint32_t)&cfg->spi->DR;
   // Memory = pixel buffer
   cfg->dma.channel->CMAR = (uint32_t)data; 
   // Size of data
@@ -265,7 +828,9 @@ void spi_transmit_dma_8bit(ST7789V2_cfg_t* cfg, uint8_t* data, uint16_t len) {
   cfg->dma.channel->CCR = DMA_CCR_PL_0 |
                           DMA_CCR_PL_1 |
                           DMA_CCR_MINC |
-                          DMA_CCR_DIR;
+                          DMA_CCR_DIR  |
+                          DMA_CCR_TEIE |
+                          ((cfg->dma_tc_irq || cfg->transfer.busy) ? DMA_CCR_TCIE : 0);
   
   // Enable SPI
   spi_inst->CR1 |= SPI_CR1_SPE;
@@ -273,20 +838,23 @@ void spi_transmit_dma_8bit(ST7789V2_cfg_t* cfg, uint8_t* data, uint16_t len) {
   // Assert CS
   gpio_write(cfg->CS, 0);
 
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.pixel_bytes += len;
+#endif
+
   // Enable DMA channel (starts transfer)
   cfg->dma.channel->CCR |= DMA_CCR_EN;
 }
 
-void spi_transmit_dma_16bit(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len) {
+ST7789V2_RAMFUNC void spi_transmit_dma_16bit(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len) {
   // Deassert CS
   gpio_write(cfg->CS, 1);
   
   // Set DC
   gpio_write(cfg->DC, 1);
 
-  // Clear interrupts
-  uint32_t isr = DMA1->ISR;
-  DMA1->IFCR = isr;
+  // Clear this channel's interrupt flags (other channels on the controller may be in use)
+  cfg->dma.instance->IFCR = 0xFu << dma_flag_shift(cfg);
 
   SPI_TypeDef* spi_inst = cfg->spi;
 
@@ -301,8 +869,8 @@ void spi_transmit_dma_16bit(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len) {
   // Clear DMA CCR
   cfg->dma.channel->CCR = 0;
 
-  // Peripheral = SPI2 data register
-  cfg->dma.channel->CPAR = (uint32_t)&SPI2->DR; 
+  // Peripheral = the panel's SPI data register
+  cfg->dma.channel->CPAR = (uint32_t)&cfg->spi->DR;
   // Memory = pixel buffer
   cfg->dma.channel->CMAR = (uint32_t)data; 
   // Size of data
@@ -314,7 +882,9 @@ void spi_transmit_dma_16bit(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len) {
                           DMA_CCR_MSIZE_0 |
                           DMA_CCR_PSIZE_0 |
                           DMA_CCR_MINC    |
-                          DMA_CCR_DIR;
+                          DMA_CCR_DIR     |
+                          DMA_CCR_TEIE    |
+                          ((cfg->dma_tc_irq || cfg->transfer.busy) ? DMA_CCR_TCIE : 0);
   
   // Enable SPI
   spi_inst->CR1 |= SPI_CR1_SPE;
@@ -322,20 +892,23 @@ void spi_transmit_dma_16bit(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len) {
   // Assert CS
   gpio_write(cfg->CS, 0);
 
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.pixel_bytes += 2u * len;
+#endif
+
   // Enable DMA channel (starts transfer)
   cfg->dma.channel->CCR |= DMA_CCR_EN;
 }
 
-void spi_transmit_dma_16bit_noinc(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len) {
+ST7789V2_RAMFUNC void spi_transmit_dma_16bit_noinc(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t len) {
   // Deassert CS
   gpio_write(cfg->CS, 1);
   
   // Set DC
   gpio_write(cfg->DC, 1);
 
-  // Clear interrupts
-  uint32_t isr = DMA1->ISR;
-  DMA1->IFCR = isr;
+  // Clear this channel's interrupt flags (other channels on the controller may be in use)
+  cfg->dma.instance->IFCR = 0xFu << dma_flag_shift(cfg);
 
   SPI_TypeDef* spi_inst = cfg->spi;
 
@@ -350,8 +923,8 @@ void spi_transmit_dma_16bit_noinc(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t
   // Clear DMA CCR
   cfg->dma.channel->CCR = 0;
 
-  // Peripheral = SPI2 data register
-  cfg->dma.channel->CPAR = (uint32_t)&SPI2->DR; 
+  // Peripheral = the panel's SPI data register
+  cfg->dma.channel->CPAR = (uint32_t)&cfg->spi->DR;
   // Memory = pixel buffer
   cfg->dma.channel->CMAR = (uint32_t)data; 
   // Size of data
@@ -362,7 +935,9 @@ void spi_transmit_dma_16bit_noinc(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t
                           DMA_CCR_PL_1    |
                           DMA_CCR_MSIZE_0 |
                           DMA_CCR_PSIZE_0 |
-                          DMA_CCR_DIR;
+                          DMA_CCR_DIR     |
+                          DMA_CCR_TEIE    |
+                          ((cfg->dma_tc_irq || cfg->transfer.busy) ? DMA_CCR_TCIE : 0);
   
   // Enable SPI
   spi_inst->CR1 |= SPI_CR1_SPE;
@@ -370,6 +945,10 @@ void spi_transmit_dma_16bit_noinc(ST7789V2_cfg_t* cfg, uint16_t* data, uint16_t
   // Assert CS
   gpio_write(cfg->CS, 0);
 
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.pixel_bytes += 2u * len;
+#endif
+
   // Enable DMA channel (starts transfer)
   cfg->dma.channel->CCR |= DMA_CCR_EN;
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "ST7789V2_Queue.h"
+
+// head and tail count up freely and wrap at 256, which ST7789V2_QUEUE_LENGTH divides
+#define QUEUE_SLOT(index) ((index) & (ST7789V2_QUEUE_LENGTH - 1))
+
+ST7789V2_RAMFUNC uint8_t ST7789V2_Queue_Push(ST7789V2_Queue_t* queue, const ST7789V2_Transaction* txn) {
+  const uint8_t tail = queue->tail;
+  if ((uint8_t)(tail - queue->head) >= ST7789V2_QUEUE_LENGTH) {
+    return 0;
+  }
+  queue->entries[QUEUE_SLOT(tail)] = *txn;
+  queue->tail = tail + 1;
+  return 1;
+}
+
+ST7789V2_RAMFUNC uint8_t ST7789V2_Queue_Space(const ST7789V2_Queue_t* queue) {
+  return ST7789V2_QUEUE_LENGTH - (uint8_t)(queue->tail - queue->head);
+}
+
+ST7789V2_RAMFUNC void ST7789V2_Queue_Run(ST7789V2_cfg_t* cfg, ST7789V2_Queue_t* queue) {
+  if (queue->running) {
+    return;
+  }
+  while (queue->head != queue->tail) {
+    ST7789V2_Transaction* txn = &queue->entries[QUEUE_SLOT(queue->head)];
+    switch (txn->type) {
+      case ST7789V2_TXN_COMMAND:
+        if (txn->n_params) {
+          ST7789V2_Send_Command_With_Params(cfg, txn->command, txn->params, txn->n_params);
+        } else {
+          ST7789V2_Send_Command(cfg, txn->command);
+        }
+        break;
+      case ST7789V2_TXN_WINDOW:
+        ST7789V2_Set_Address_Window(cfg, txn->x0, txn->y0, txn->x1, txn->y1);
+        break;
+      case ST7789V2_TXN_PIXELS:
+        // Flagged running first, the interrupt can come as soon as the DMA starts
+        queue->running = 1;
+        cfg->dma_tc_irq = 1;
+        ST7789V2_Send_Command(cfg, ST7789_RAMWR);
+        ST7789V2_Send_Pixels(cfg, txn->pixels, txn->count);
+        return;
+      case ST7789V2_TXN_FILL:
+        queue->running = 1;
+        cfg->dma_tc_irq = 1;
+        // Sends RAMWR itself
+        ST7789V2_Fill(cfg, txn->pixels, txn->count);
+        return;
+    }
+    queue->head++;
+  }
+  cfg->dma_tc_irq = 0;
+}
+
+ST7789V2_RAMFUNC void ST7789V2_Queue_Transfer_Done(ST7789V2_cfg_t* cfg, ST7789V2_Queue_t* queue) {
+  if (!queue->running) {
+    return;
+  }
+  queue->head++;
+  queue->running = 0;
+  ST7789V2_Queue_Run(cfg, queue);
+}
@@ -0,0 +1,420 @@
+#include "ST7789V2_Host.h"
+#include <string.h>
+
+// One software panel: its frame memory and the write window, as the controller keeps them
+typedef struct {
+  const ST7789V2_cfg_t* cfg;  // Panel's cfg, NULL until first used
+  uint16_t gram[ST7789V2_HEIGHT][ST7789V2_WIDTH];
+  uint16_t win_x0, win_y0, win_x1, win_y1;
+  uint16_t write_x, write_y;
+  uint8_t last_command;
+  uint8_t transfer_pending;
+  uint8_t dma_error;  // Set by ST7789V2_Host_Fail_Transfer()
+  uint32_t pixel_count;
+  // Vertical scroll area (VSCRDEF) and the row shown at its top (VSCSAD), the power-on defaults
+  // being a whole-memory area that isn't scrolled
+  uint16_t scroll_top, scroll_rows, scroll_start;
+  uint8_t scrolling;  // Set by VSCSAD, cleared by NORON and PTLON
+  // Partial mode (PTLON, rows PTLAR) and idle mode (IDMON)
+  uint8_t partial, idle;
+  uint16_t partial_start, partial_end;
+} Host_Panel;
+
+static Host_Panel panels[ST7789V2_HOST_PANELS];
+
+// Controller power-on state
+static void panel_reset(Host_Panel* panel) {
+  memset(panel->gram, 0, sizeof(panel->gram));
+  panel->win_x0 = 0;
+  panel->win_y0 = 0;
+  panel->win_x1 = ST7789V2_WIDTH - 1;
+  panel->win_y1 = ST7789V2_HEIGHT - 1;
+  panel->scroll_top = 0;
+  panel->scroll_rows = ST7789V2_GRAM_HEIGHT;
+  panel->scroll_start = 0;
+  panel->scrolling = 0;
+  panel->partial = 0;
+  panel->idle = 0;
+  panel->partial_start = 0;
+  panel->partial_end = ST7789V2_GRAM_HEIGHT - 1;
+}
+
+// The panel wired to cfg, given the next unused one the first time. Panels beyond
+// ST7789V2_HOST_PANELS share the last one.
+static Host_Panel* panel_of(const ST7789V2_cfg_t* cfg) {
+  for (int i = 0; i < ST7789V2_HOST_PANELS; i++) {
+    if (panels[i].cfg == cfg) {
+      return &panels[i];
+    }
+    if (panels[i].cfg == NULL) {
+      panels[i].cfg = cfg;
+      panel_reset(&panels[i]);
+      return &panels[i];
+    }
+  }
+  return &panels[ST7789V2_HOST_PANELS - 1];
+}
+
+void delay_ms_approx(uint16_t ms) {
+  (void)ms;
+}
+
+void gpio_write(GPIO_Pin_t gpio, uint8_t val) {
+  (void)gpio;
+  (void)val;
+}
+
+// RAMWR restarts writing at the top-left of the window
+static void start_write(Host_Panel* panel) {
+  panel->write_x = panel->win_x0;
+  panel->write_y = panel->win_y0;
+}
+
+// Writes one pixel at the write position and advances it through the window
+static void write_pixel(Host_Panel* panel, uint16_t colour) {
+  if (panel->write_y > panel->win_y1) {
+    return;  // Past the end of the window, the controller ignores the data
+  }
+  if (panel->write_x < ST7789V2_WIDTH && panel->write_y < ST7789V2_HEIGHT) {
+    panel->gram[panel->write_y][panel->write_x] = colour;
+  }
+  panel->pixel_count++;
+  if (++panel->write_x > panel->win_x1) {
+    panel->write_x = panel->win_x0;
+    panel->write_y++;
+  }
+}
+
+void ST7789V2_Init(ST7789V2_cfg_t* cfg) {
+  panel_reset(panel_of(cfg));
+  cfg->window_valid = 0;
+  cfg->setup_done = 1;
+}
+
+// The software panel has no power-up delays, it is ready at once
+void ST7789V2_Init_Start(ST7789V2_cfg_t* cfg, uint32_t now_ms) {
+  (void)now_ms;
+  ST7789V2_Init(cfg);
+}
+
+uint8_t ST7789V2_Init_Poll(ST7789V2_cfg_t* cfg, uint32_t now_ms) {
+  (void)now_ms;
+  return cfg->setup_done;
+}
+
+void ST7789V2_Reset(ST7789V2_cfg_t* cfg) {
+  (void)cfg;
+}
+
+void ST7789V2_Send_Command(ST7789V2_cfg_t* cfg, uint8_t command) {
+  Host_Panel* panel = panel_of(cfg);
+  panel->last_command = command;
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.command_bytes++;
+#endif
+  if (command == ST7789_RAMWR) {
+    start_write(panel);
+  }
+  else if (command == ST7789_PTLON || command == ST7789_NORON) {
+    panel->partial = (command == ST7789_PTLON);
+    panel->scrolling = 0;
+  }
+  else if (command == ST7789_IDMON || command == ST7789_IDMOFF) {
+    panel->idle = (command == ST7789_IDMON);
+  }
+}
+
+void ST7789V2_Send_Command_With_Params(ST7789V2_cfg_t* cfg, uint8_t command, const uint8_t* params, uint8_t n) {
+  ST7789V2_Send_Command(cfg, command);
+  Host_Panel* panel = panel_of(cfg);
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.command_bytes += n;
+#endif
+  if (n >= 4 && command == ST7789_CASET) {
+    panel->win_x0 = (uint16_t)((params[0] << 8) | params[1]);
+    panel->win_x1 = (uint16_t)((params[2] << 8) | params[3]);
+  }
+  else if (n >= 4 && command == ST7789_RASET) {
+    panel->win_y0 = (uint16_t)((params[0] << 8) | params[1]);
+    panel->win_y1 = (uint16_t)((params[2] << 8) | params[3]);
+  }
+  else if (n >= 6 && command == ST7789_VSCRDEF) {
+    panel->scroll_top = (uint16_t)((params[0] << 8) | params[1]);
+    panel->scroll_rows = (uint16_t)((params[2] << 8) | params[3]);
+  }
+  else if (n >= 2 && command == ST7789_VSCSAD) {
+    panel->scroll_start = (uint16_t)((params[0] << 8) | params[1]);
+    panel->scrolling = 1;
+  }
+  else if (n >= 4 && command == ST7789_PTLAR) {
+    panel->partial_start = (uint16_t)((params[0] << 8) | params[1]);
+    panel->partial_end = (uint16_t)((params[2] << 8) | params[3]);
+  }
+}
+
+void ST7789V2_Send_Data(ST7789V2_cfg_t* cfg, uint8_t data) {
+  (void)cfg;
+  (void)data;
+}
+
+void ST7789V2_Send_Data_Block(ST7789V2_cfg_t* cfg, uint8_t* data, uint32_t length) {
+  ST7789V2_Transfer_Start(cfg, data, length, ST7789V2_XFER_BYTES, NULL, NULL);
+}
+
+void ST7789V2_Send_Pixels(ST7789V2_cfg_t* cfg, uint16_t* pixels, uint16_t count) {
+  Host_Panel* panel = panel_of(cfg);
+  if (!cfg->setup_done || panel->last_command != ST7789_RAMWR) {
+    return;
+  }
+  for (uint16_t i = 0; i < count; i++) {
+    write_pixel(panel, pixels[i]);
+  }
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.pixel_bytes += 2u * count;
+#endif
+  panel->transfer_pending = cfg->dma_tc_irq;
+}
+
+void ST7789V2_Set_Address_Window(ST7789V2_cfg_t* cfg, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+  if (!cfg->setup_done) {
+    return;
+  }
+  const uint8_t columns[4] = { x0 >> 8, x0 & 0xFF, x1 >> 8, x1 & 0xFF };
+  const uint8_t rows[4] = { y0 >> 8, y0 & 0xFF, y1 >> 8, y1 & 0xFF };
+  ST7789V2_Send_Command_With_Params(cfg, ST7789_CASET, columns, sizeof(columns));
+  ST7789V2_Send_Command_With_Params(cfg, ST7789_RASET, rows, sizeof(rows));
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.windows++;
+  cfg->bus_stats.window_commands += 2;
+#endif
+  cfg->window_x0 = x0;
+  cfg->window_y0 = y0;
+  cfg->window_x1 = x1;
+  cfg->window_y1 = y1;
+  cfg->window_valid = 1;
+}
+
+void ST7789V2_BL_On(ST7789V2_cfg_t* cfg) {
+  (void)cfg;
+}
+
+void ST7789V2_BL_Off(ST7789V2_cfg_t* cfg) {
+  (void)cfg;
+}
+
+void ST7789V2_Fill(ST7789V2_cfg_t* cfg, uint16_t* colour, uint32_t len) {
+  ST7789V2_Send_Command(cfg, ST7789_RAMWR);
+  ST7789V2_Transfer_Start(cfg, colour, len, ST7789V2_XFER_FILL, NULL, NULL);
+}
+
+// All the data is written at once. The chunks only show in the interrupts the transfer raises,
+// one per chunk as on the board.
+void ST7789V2_Transfer_Start(ST7789V2_cfg_t* cfg, const void* data, uint32_t count, uint8_t kind,
+                             ST7789V2_Transfer_Done done, void* context) {
+  if (!cfg->setup_done) {
+    return;
+  }
+  if (count == 0) {
+    if (done != NULL) {
+      done(cfg, context);
+    }
+    return;
+  }
+  Host_Panel* panel = panel_of(cfg);
+  if (kind != ST7789V2_XFER_BYTES && panel->last_command == ST7789_RAMWR) {
+    const uint16_t* pixels = (const uint16_t*)data;
+    for (uint32_t i = 0; i < count; i++) {
+      write_pixel(panel, (kind == ST7789V2_XFER_FILL) ? pixels[0] : pixels[i]);
+    }
+  }
+#if ST7789V2_BUS_STATS
+  cfg->bus_stats.pixel_bytes += (kind == ST7789V2_XFER_BYTES) ? count : 2u * count;
+#endif
+  const uint32_t first = (count > ST7789V2_DMA_MAX_ITEMS) ? ST7789V2_DMA_MAX_ITEMS : count;
+  cfg->transfer.kind = kind;
+  cfg->transfer.done = done;
+  cfg->transfer.context = context;
+  cfg->transfer.remaining = count - first;
+  cfg->transfer.busy = (cfg->transfer.remaining != 0 || done != NULL);
+  panel->transfer_pending = cfg->dma_tc_irq || cfg->transfer.busy;
+}
+
+uint8_t ST7789V2_Transfer_Next(ST7789V2_cfg_t* cfg) {
+  ST7789V2_Transfer_t* transfer = &cfg->transfer;
+  if (!transfer->busy) {
+    return 0;
+  }
+  if (transfer->remaining == 0) {
+    transfer->busy = 0;
+    if (transfer->done != NULL) {
+      transfer->done(cfg, transfer->context);
+    }
+    return 0;
+  }
+  transfer->remaining -= (transfer->remaining > ST7789V2_DMA_MAX_ITEMS) ? ST7789V2_DMA_MAX_ITEMS : transfer->remaining;
+  panel_of(cfg)->transfer_pending = 1;
+  return 1;
+}
+
+void ST7789V2_Set_Scroll_Area(ST7789V2_cfg_t* cfg, uint16_t top_fixed, uint16_t bottom_fixed) {
+  const uint16_t bottom = bottom_fixed + (ST7789V2_GRAM_HEIGHT - ST7789V2_HEIGHT);
+  const uint16_t scroll = ST7789V2_GRAM_HEIGHT - top_fixed - bottom;
+  const uint8_t params[6] = { top_fixed >> 8, top_fixed & 0xFF, scroll >> 8, scroll & 0xFF, bottom >> 8, bottom & 0xFF };
+  ST7789V2_Send_Command_With_Params(cfg, ST7789_VSCRDEF, params, sizeof(params));
+}
+
+void ST7789V2_Set_Scroll_Start(ST7789V2_cfg_t* cfg, uint16_t row) {
+  const uint8_t params[2] = { row >> 8, row & 0xFF };
+  ST7789V2_Send_Command_With_Params(cfg, ST7789_VSCSAD, params, sizeof(params));
+}
+
+// Frame memory row shown on screen row y, through the scroll area if scrolling
+static uint16_t shown_row(const Host_Panel* panel, const uint16_t y) {
+  const uint16_t top = panel->scroll_top, rows = panel->scroll_rows, start = panel->scroll_start;
+  if (!panel->scrolling || y < top || y >= top + rows || start < top || start >= top + rows) {
+    return y;
+  }
+  return top + (y - top + start - top) % rows;
+}
+
+void ST7789V2_Set_Partial_Mode(ST7789V2_cfg_t* cfg, uint8_t on, uint16_t start, uint16_t end) {
+  if (on) {
+    const uint8_t params[4] = { start >> 8, start & 0xFF, end >> 8, end & 0xFF };
+    ST7789V2_Send_Command_With_Params(cfg, ST7789_PTLAR, params, sizeof(params));
+    ST7789V2_Send_Command(cfg, ST7789_PTLON);
+  } else {
+    ST7789V2_Send_Command(cfg, ST7789_NORON);
+  }
+}
+
+void ST7789V2_Set_Idle_Mode(ST7789V2_cfg_t* cfg, uint8_t on) {
+  ST7789V2_Send_Command(cfg, on ? ST7789_IDMON : ST7789_IDMOFF);
+}
+
+void ST7789V2_Set_Baud_Div(ST7789V2_cfg_t* cfg, uint8_t baud_div) {
+  cfg->spi_baud_div = baud_div;
+}
+
+uint8_t ST7789V2_Test_Baud(ST7789V2_cfg_t* cfg, uint8_t baud_div) {
+  (void)cfg;
+  (void)baud_div;
+  return 1;
+}
+
+void ST7789V2_Read_Pixels(ST7789V2_cfg_t* cfg, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t* pixels) {
+  const Host_Panel* panel = panel_of(cfg);
+  if (!cfg->setup_done) {
+    return;
+  }
+  // RGB565 in, RGB565 out: the memory model keeps no more bits than that
+  for (uint16_t y = y0; y <= y1; y++) {
+    for (uint16_t x = x0; x <= x1; x++) {
+      *pixels++ = (x < ST7789V2_WIDTH && y < ST7789V2_HEIGHT) ? panel->gram[y][x] : 0;
+    }
+  }
+}
+
+uint8_t ST7789V2_DMA_TC_Clear(ST7789V2_cfg_t* cfg) {
+  Host_Panel* panel = panel_of(cfg);
+  const uint8_t pending = panel->transfer_pending;
+  panel->transfer_pending = 0;
+  return pending;
+}
+
+uint8_t ST7789V2_DMA_Error_Clear(ST7789V2_cfg_t* cfg) {
+  Host_Panel* panel = panel_of(cfg);
+  if (!panel->dma_error) {
+    return 0;
+  }
+  ST7789V2_DMA_Abort(cfg);
+  cfg->fault |= ST7789V2_FAULT_DMA_ERROR;
+  return 1;
+}
+
+void ST7789V2_DMA_Abort(ST7789V2_cfg_t* cfg) {
+  Host_Panel* panel = panel_of(cfg);
+  panel->transfer_pending = 0;
+  panel->dma_error = 0;
+  cfg->dma_tc_irq = 0;
+  cfg->transfer.remaining = 0;
+  cfg->transfer.busy = 0;
+}
+
+void ST7789V2_Recover(ST7789V2_cfg_t* cfg) {
+  ST7789V2_DMA_Abort(cfg);
+  cfg->fault = 0;
+  ST7789V2_Init(cfg);
+}
+
+void ST7789V2_Host_Fail_Transfer(const ST7789V2_cfg_t* cfg) {
+  Host_Panel* panel = panel_of(cfg);
+  panel->dma_error = 1;
+  panel->transfer_pending = 0;
+}
+
+uint8_t ST7789V2_TE_Clear(ST7789V2_cfg_t* cfg) {
+  (void)cfg;
+  return 0;
+}
+
+uint8_t ST7789V2_Host_Transfer_Pending(void) {
+  for (int i = 0; i < ST7789V2_HOST_PANELS; i++) {
+    if (panels[i].transfer_pending || panels[i].dma_error) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// The panel read back by the functions without a cfg: the first one used
+static const ST7789V2_cfg_t* first_panel(void) {
+  return panels[0].cfg;
+}
+
+uint16_t ST7789V2_Host_Get_Panel_Pixel(const ST7789V2_cfg_t* cfg, uint16_t x, uint16_t y) {
+  const Host_Panel* panel = panel_of(cfg);
+  return (x < ST7789V2_WIDTH && y < ST7789V2_HEIGHT) ? panel->gram[y][x] : 0;
+}
+
+uint16_t ST7789V2_Host_Get_Pixel(uint16_t x, uint16_t y) {
+  return ST7789V2_Host_Get_Panel_Pixel(first_panel(), x, y);
+}
+
+uint32_t ST7789V2_Host_Take_Pixel_Count(void) {
+  Host_Panel* panel = panel_of(first_panel());
+  const uint32_t count = panel->pixel_count;
+  panel->pixel_count = 0;
+  return count;
+}
+
+int ST7789V2_Host_Write_Panel_PPM(const ST7789V2_cfg_t* cfg, const char* path) {
+  const Host_Panel* panel = panel_of(cfg);
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    return -1;
+  }
+  fprintf(file, "P6\n%d %d\n255\n", ST7789V2_WIDTH, ST7789V2_HEIGHT);
+  for (int y = 0; y < ST7789V2_HEIGHT; y++) {
+    const uint16_t row = shown_row(panel, y);
+    // Rows outside the partial area aren't driven and show black
+    const uint8_t driven = !panel->partial || (y >= panel->partial_start && y <= panel->partial_end);
+    for (int x = 0; x < ST7789V2_WIDTH; x++) {
+      // RGB565 to 8 bits per channel, repeating the top bits into the bottom ones
+      const uint16_t c = (driven && row < ST7789V2_HEIGHT) ? panel->gram[row][x] : 0;
+      uint8_t r = (uint8_t)((c >> 11) & 0x1F), g = (uint8_t)((c >> 5) & 0x3F), b = (uint8_t)(c & 0x1F);
+      if (panel->idle) {
+        // 8 colours: each channel fully on or off by its top bit
+        r = (r & 0x10) ? 0x1F : 0;
+        g = (g & 0x20) ? 0x3F : 0;
+        b = (b & 0x10) ? 0x1F : 0;
+      }
+      const uint8_t rgb[3] = { (uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)), (uint8_t)((b << 3) | (b >> 2)) };
+      fwrite(rgb, 1, sizeof(rgb), file);
+    }
+  }
+  return (fclose(file) == 0) ? 0 : -1;
+}
+
+int ST7789V2_Host_Write_PPM(const char* path) {
+  return ST7789V2_Host_Write_Panel_PPM(first_panel(), path);
+}
@@ -0,0 +1,61 @@
+/*
+Host backend for the ST7789V2 driver: the same API as ST7789V2_Driver.c, writing into a
+software model of the panel's frame memory instead of the SPI. Link it in place of
+ST7789V2_Driver.c (ST7789V2_Queue.c is linked as usual), with ST7789V2_HOST=1, to run LCD.c
+(and the game drawing on top of it) on a PC and save what the panel would show as an image.
+
+  ST7789V2_cfg_t cfg = {0};
+  LCD_init(&cfg);
+  PongEngine_Draw(&engine);
+  LCD_Refresh(&cfg);
+  ST7789V2_Host_Write_PPM("frame.ppm");
+
+LCD_Refresh() needs nothing more. After LCD_RefreshAsync()/LCD_Swap(), each transfer ends at
+once and raises the "DMA interrupt": run it with
+
+  while (ST7789V2_Host_Transfer_Pending()) LCD_DMA_IRQHandler();
+
+Each cfg drives its own software panel (up to ST7789V2_HOST_PANELS), so the LCD_MAX_DISPLAYS
+refreshes can be checked too. The functions without a cfg read the first panel used.
+*/
+
+#ifndef ST7789V2_Host_h
+#define ST7789V2_Host_h
+
+#include "ST7789V2_Driver.h"
+
+#if !ST7789V2_HOST
+#error "Build with ST7789V2_HOST=1 when linking the host backend"
+#endif
+
+// Panels modelled, one per cfg
+#ifndef ST7789V2_HOST_PANELS
+#define ST7789V2_HOST_PANELS 2
+#endif
+
+// 1 if a transfer has finished with the DMA interrupt enabled, or failed, and
+// LCD_DMA_IRQHandler() has not consumed it yet
+uint8_t ST7789V2_Host_Transfer_Pending(void);
+
+// Makes the transfer in flight on cfg's panel end in a DMA transfer error instead, as seen by
+// the next ST7789V2_DMA_Error_Clear(), to exercise the fault handling and LCD_Recover()
+void ST7789V2_Host_Fail_Transfer(const ST7789V2_cfg_t* cfg);
+
+// RGB565 colour of a pixel of the panel memory
+uint16_t ST7789V2_Host_Get_Pixel(uint16_t x, uint16_t y);
+
+// RGB565 colour of a pixel of the memory of cfg's panel
+uint16_t ST7789V2_Host_Get_Panel_Pixel(const ST7789V2_cfg_t* cfg, uint16_t x, uint16_t y);
+
+// Number of pixels written to the panel since the last call (transfer volume of a refresh)
+uint32_t ST7789V2_Host_Take_Pixel_Count(void);
+
+// Save what the panel shows (its memory, through the vertical scroll, partial and idle mode
+// settings) as a binary
+// PPM (P6) image, returns 0 on success
+int ST7789V2_Host_Write_PPM(const char* path);
+
+// The same for cfg's panel
+int ST7789V2_Host_Write_Panel_PPM(const ST7789V2_cfg_t* cfg, const char* path);
+
+#endif
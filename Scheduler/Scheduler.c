@@ -0,0 +1,145 @@
+#include "Scheduler.h"
+#include <stdio.h>
+
+/**
+ * @file Scheduler.c
+ * @brief Implementation of the multi-rate stage scheduler
+ *
+ * Each stage keeps the tick its next period starts on. Ticks are counted as
+ * unsigned 32-bit values and compared by their difference, so the count can
+ * wrap (after 49 days at 1kHz). Periods are spread like FrameTimer's: whole
+ * ticks, plus one now and then for the remainder of tick_hz / rate_hz.
+ *
+ * Run times are DWT->CYCCNT differences, which Scheduler_Init() enables.
+ * Headless builds (PONG_HEADLESS, the host checks) have no DWT and time
+ * every run as 0 cycles.
+ */
+
+#if PONG_HEADLESS
+#define CYCLE_COUNT() 0u
+#else
+#define CYCLE_COUNT() (DWT->CYCCNT)
+#endif
+
+// Ticks from this period to the next, carrying the fractional tick forward. A rate of 0 (every
+// tick) has no fraction: a carry against rate_hz 0 would add a tick to every period.
+static uint32_t next_period(Scheduler_Stage_t* stage)
+{
+    uint32_t ticks = stage->period_ticks;
+    stage->remainder_acc += stage->period_remainder;
+    if (stage->rate_hz != 0 && stage->remainder_acc >= stage->rate_hz) {
+        stage->remainder_acc -= stage->rate_hz;
+        ticks++;
+    }
+    return ticks;
+}
+
+void Scheduler_Init(Scheduler_t* scheduler, uint32_t tick_hz)
+{
+    scheduler->tick_hz = tick_hz;
+    scheduler->now = 0;
+    scheduler->count = 0;
+
+#if !PONG_HEADLESS
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+// Whole and leftover ticks per period of the stage's rate
+static void set_period(const Scheduler_t* scheduler, Scheduler_Stage_t* stage)
+{
+    if (stage->rate_hz == 0) {
+        stage->period_ticks = 1;
+        stage->period_remainder = 0;
+    } else {
+        stage->period_ticks = scheduler->tick_hz / stage->rate_hz;
+        stage->period_remainder = scheduler->tick_hz % stage->rate_hz;
+    }
+    stage->remainder_acc = 0;
+}
+
+uint8_t Scheduler_Register(Scheduler_t* scheduler, Scheduler_Stage_t* stage)
+{
+    if (scheduler->count >= SCHEDULER_MAX_STAGES || stage->rate_hz > scheduler->tick_hz) {
+        return 0;
+    }
+
+    set_period(scheduler, stage);
+    stage->next_due = scheduler->now + 1;
+    stage->pending = 0;
+    stage->runs = 0;
+    stage->overruns = 0;
+    stage->last_cycles = 0;
+    stage->max_cycles = 0;
+
+    // Insert after every stage of the same or higher priority
+    uint8_t i = scheduler->count;
+    while (i > 0 && scheduler->stages[i - 1]->priority > stage->priority) {
+        scheduler->stages[i] = scheduler->stages[i - 1];
+        i--;
+    }
+    scheduler->stages[i] = stage;
+    scheduler->count++;
+    return 1;
+}
+
+uint8_t Scheduler_Set_Rate(Scheduler_t* scheduler, Scheduler_Stage_t* stage, uint32_t rate_hz)
+{
+    if (rate_hz > scheduler->tick_hz) {
+        return 0;
+    }
+    stage->rate_hz = rate_hz;
+    set_period(scheduler, stage);
+    return 1;
+}
+
+void Scheduler_Run(Scheduler_t* scheduler, uint32_t ticks)
+{
+    scheduler->now += ticks;
+
+    for (uint8_t i = 0; i < scheduler->count; i++) {
+        Scheduler_Stage_t* stage = scheduler->stages[i];
+        while ((int32_t)(scheduler->now - stage->next_due) >= 0) {
+            stage->pending++;
+            stage->next_due += next_period(stage);
+        }
+        if (stage->pending == 0) {
+            continue;
+        }
+
+        uint32_t limit = stage->max_catch_up ? stage->max_catch_up : 1;
+        if (stage->pending > limit) {
+            stage->overruns += stage->pending - limit;
+            stage->pending = limit;
+        }
+
+        uint32_t start = CYCLE_COUNT();
+        if (stage->run(stage->pending)) {
+            uint32_t cycles = CYCLE_COUNT() - start;
+            stage->last_cycles = cycles;
+            if (cycles > stage->max_cycles) {
+                stage->max_cycles = cycles;
+            }
+            stage->runs++;
+            stage->pending = 0;
+        }
+    }
+}
+
+void Scheduler_Report(const Scheduler_t* scheduler)
+{
+#if PONG_HEADLESS
+    const uint32_t cycles_per_us = 1;
+#else
+    const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+#endif
+    printf("Stages at %lu ticks/s:\n", (unsigned long)scheduler->tick_hz);
+    for (uint8_t i = 0; i < scheduler->count; i++) {
+        const Scheduler_Stage_t* stage = scheduler->stages[i];
+        printf("  %-10s %4lu Hz  %7lu runs  %5lu overruns  max %6lu us\n", stage->name,
+               (unsigned long)(stage->rate_hz ? stage->rate_hz : scheduler->tick_hz),
+               (unsigned long)stage->runs, (unsigned long)stage->overruns,
+               (unsigned long)(stage->max_cycles / cycles_per_us));
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <stdint.h>
+#if !PONG_HEADLESS
+#include "stm32l4xx_hal.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Scheduler.h
+ * @brief Multi-rate game loop: registered stages, each run at its own rate from one timebase
+ *
+ * Every subsystem registers a stage with the rate it needs (input, physics, render,
+ * telemetry...) and a priority. The main loop sleeps in FrameTimer_Wait() and hands
+ * the ticks it returns to Scheduler_Run(), which runs the stages that are due, highest
+ * priority (lowest number) first. Nothing runs in the timer interrupt; the stages are
+ * called from the loop, one after another.
+ *
+ * Features:
+ * - Exact average rates, even when the tick rate is not a multiple of the stage rate
+ *   (240Hz from a 1kHz tick alternates 4/4/4/5 ticks), as FrameTimer does for its period
+ * - Catch-up per stage: a stage that fell behind is told how many periods are due, up
+ *   to max_catch_up, so physics can step the missed steps while render draws only once
+ * - A stage can decline to run (return 0), e.g. while the LCD is still busy, and stays due
+ * - Overrun accounting: periods dropped beyond max_catch_up, and the longest run in cycles
+ *
+ * Example usage:
+ * @code
+ * static uint8_t physics(uint32_t periods) { while (periods--) step(); return 1; }
+ * static uint8_t render(uint32_t periods) { if (busy()) return 0; draw(); return 1; }
+ *
+ * Scheduler_Stage_t physics_stage = {.name = "physics", .run = physics, .rate_hz = 240,
+ *                                    .priority = 1, .max_catch_up = 8};
+ * Scheduler_Stage_t render_stage = {.name = "render", .run = render, .rate_hz = 60,
+ *                                   .priority = 2, .max_catch_up = 1};
+ * Scheduler_t scheduler;
+ * Scheduler_Init(&scheduler, 1000);        // frame_timer.fps = 1000
+ * Scheduler_Register(&scheduler, &physics_stage);
+ * Scheduler_Register(&scheduler, &render_stage);
+ *
+ * while (1) {
+ *     Scheduler_Run(&scheduler, FrameTimer_Wait(&frame_timer));
+ * }
+ * Scheduler_Report(&scheduler);             // printf per-stage runs, overruns, longest run
+ * @endcode
+ */
+
+#define SCHEDULER_MAX_STAGES 8
+
+/**
+ * @brief A stage's work
+ *
+ * @param periods Periods due since it last ran, 1 to max_catch_up
+ * @return 1 if it ran, 0 to be called again on the next tick (it stays due)
+ */
+typedef uint8_t (*Scheduler_Fn_t)(uint32_t periods);
+
+/**
+ * @struct Scheduler_Stage_t
+ * @brief One registered stage; fill in the first five fields and leave the rest 0
+ */
+typedef struct {
+    const char* name;           ///< For Scheduler_Report()
+    Scheduler_Fn_t run;         ///< Work to do when due
+    uint32_t rate_hz;           ///< Runs a second, at most the tick rate (0: every tick)
+    uint8_t priority;           ///< Order within a tick, 0 first
+    uint8_t max_catch_up;       ///< Most periods handed to one run; more are dropped (0 counts as 1)
+    uint32_t period_ticks;      ///< Internal: whole ticks per period
+    uint32_t period_remainder;  ///< Internal: leftover ticks per period, in 1/rate_hz units
+    uint32_t remainder_acc;     ///< Internal: accumulated leftover ticks
+    uint32_t next_due;          ///< Internal: tick the next period starts on
+    uint32_t pending;           ///< Internal: periods due and not yet run
+    uint32_t runs;              ///< Times run
+    uint32_t overruns;          ///< Periods dropped because the stage fell more than max_catch_up behind
+    uint32_t last_cycles;       ///< DWT cycles of the latest run
+    uint32_t max_cycles;        ///< DWT cycles of the longest run
+} Scheduler_Stage_t;
+
+/**
+ * @struct Scheduler_t
+ * @brief Stages in priority order and the current tick
+ */
+typedef struct {
+    uint32_t tick_hz;                                ///< Timebase rate (the frame timer's fps)
+    uint32_t now;                                    ///< Ticks since Scheduler_Init()
+    uint8_t count;                                   ///< Stages registered
+    Scheduler_Stage_t* stages[SCHEDULER_MAX_STAGES]; ///< Internal: by priority
+} Scheduler_t;
+
+/**
+ * @brief Start with no stages at tick 0, and start the DWT cycle counter
+ *
+ * @param scheduler Pointer to scheduler
+ * @param tick_hz Rate of the ticks Scheduler_Run() will be given
+ */
+void Scheduler_Init(Scheduler_t* scheduler, uint32_t tick_hz);
+
+/**
+ * @brief Add a stage, due on the next tick
+ *
+ * Stages of equal priority run in the order they were registered.
+ *
+ * @param scheduler Pointer to scheduler
+ * @param stage Stage to add; it must stay valid while the scheduler runs
+ * @return 1 if added, 0 if the scheduler is full or rate_hz is above the tick rate
+ */
+uint8_t Scheduler_Register(Scheduler_t* scheduler, Scheduler_Stage_t* stage);
+
+/**
+ * @brief Change a registered stage's rate
+ *
+ * The period already started keeps its length; the new rate applies from the
+ * one after it.
+ *
+ * @param scheduler Pointer to scheduler
+ * @param stage Registered stage
+ * @param rate_hz New runs a second, at most the tick rate (0: every tick)
+ * @return 1 if changed, 0 if rate_hz is above the tick rate
+ */
+uint8_t Scheduler_Set_Rate(Scheduler_t* scheduler, Scheduler_Stage_t* stage, uint32_t rate_hz);
+
+/**
+ * @brief Advance time and run every stage that is due
+ *
+ * @param scheduler Pointer to scheduler
+ * @param ticks Ticks since the last call (FrameTimer_Wait()'s return value)
+ */
+void Scheduler_Run(Scheduler_t* scheduler, uint32_t ticks);
+
+/**
+ * @brief printf each stage's rate, runs, overruns and longest run
+ *
+ * @param scheduler Pointer to scheduler
+ */
+void Scheduler_Report(const Scheduler_t* scheduler);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,108 @@
+#include "Scope.h"
+#include <string.h>
+
+/**
+ * @file Scope.c
+ * @brief Implementation of the streaming scope view
+ *
+ * Column head is always the blank cursor: a sample is drawn into it, then the
+ * next column is erased and becomes the cursor. Rows are counted down from the
+ * top of the area, so the top row shows max.
+ */
+
+// Row a sample is drawn on
+static uint8_t sample_row(const Scope_t* scope, int16_t value)
+{
+    if (value < scope->min) {
+        value = scope->min;
+    }
+    if (value > scope->max) {
+        value = scope->max;
+    }
+    // (value - min) * scale is at most (height - 1) * 2^16 plus the rounding, so it fits
+    uint32_t offset = ((uint32_t)(value - scope->min) * scope->scale) >> 16;
+    if (offset > scope->height - 1u) {
+        offset = scope->height - 1u;
+    }
+    return (uint8_t)(scope->height - 1u - offset);
+}
+
+static void erase_column(const Scope_t* scope, const uint16_t column)
+{
+    const uint16_t x = scope->x + column;
+    LCD_Draw_Line(x, scope->y, x, scope->y + scope->height - 1, scope->background);
+}
+
+// Draws each trace in a column as a run from the previous sample's row to this one's
+static void draw_column(const Scope_t* scope, const uint16_t column, const uint8_t rows[], const uint8_t from_rows[])
+{
+    const uint16_t x = scope->x + column;
+    for (uint8_t t = 0; t < scope->traces; t++) {
+        LCD_Draw_Line(x, scope->y + from_rows[t], x, scope->y + rows[t], scope->colours[t]);
+    }
+}
+
+static void column_rows(const Scope_t* scope, const uint16_t column, uint8_t rows[])
+{
+    const int16_t* slot = &scope->samples[column * scope->traces];
+    for (uint8_t t = 0; t < scope->traces; t++) {
+        rows[t] = sample_row(scope, slot[t]);
+    }
+}
+
+void Scope_Init(Scope_t* scope)
+{
+    if (scope->traces > SCOPE_MAX_TRACES) {
+        scope->traces = SCOPE_MAX_TRACES;
+    }
+    // Rounded up, so max lands on the top row
+    const uint32_t range = (scope->max > scope->min) ? (uint32_t)(scope->max - scope->min) : 0;
+    const uint32_t rows = ((uint32_t)scope->height - 1u) << 16;
+    scope->scale = range ? (rows + range - 1u) / range : 0;
+    scope->head = 0;
+    scope->count = 0;
+    LCD_Draw_Rect(scope->x, scope->y, scope->width, scope->height, scope->background, 1);
+}
+
+void Scope_Push(Scope_t* scope, const int16_t values[])
+{
+    int16_t* slot = &scope->samples[scope->head * scope->traces];
+    uint8_t rows[SCOPE_MAX_TRACES];
+    for (uint8_t t = 0; t < scope->traces; t++) {
+        slot[t] = values[t];
+        rows[t] = sample_row(scope, values[t]);
+    }
+    // The first sample has nothing to join up to
+    draw_column(scope, scope->head, rows, scope->count ? scope->last_row : rows);
+    memcpy(scope->last_row, rows, sizeof(rows));
+
+    scope->head = (scope->head + 1u == scope->width) ? 0 : scope->head + 1u;
+    erase_column(scope, scope->head);
+    if (scope->count < scope->width) {
+        scope->count++;
+    }
+}
+
+void Scope_Redraw(Scope_t* scope)
+{
+    LCD_Draw_Rect(scope->x, scope->y, scope->width, scope->height, scope->background, 1);
+
+    // Every column but the cursor. Once the ring is full the cursor column still holds the
+    // sample before the oldest one shown, so that one is joined up as it was when pushed.
+    const uint16_t shown = (scope->count < scope->width) ? scope->count : scope->width - 1u;
+    uint16_t column = (scope->head + scope->width - shown) % scope->width;
+    uint8_t from_rows[SCOPE_MAX_TRACES];
+    uint8_t have_from = 0;
+    if (scope->count > shown) {
+        column_rows(scope, scope->head, from_rows);
+        have_from = 1;
+    }
+    for (uint16_t n = 0; n < shown; n++) {
+        uint8_t rows[SCOPE_MAX_TRACES];
+        column_rows(scope, column, rows);
+        draw_column(scope, column, rows, have_from ? from_rows : rows);
+        memcpy(from_rows, rows, sizeof(rows));
+        have_from = 1;
+        column = (column + 1u == scope->width) ? 0 : column + 1u;
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <stdint.h>
+#include "LCD.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Scope.h
+ * @brief Streaming oscilloscope view: live traces of fixed-point samples on the LCD
+ *
+ * The scope sweeps left to right across its area, one column per sample, and
+ * wraps round to the left edge, like an analogue scope. Each Scope_Push()
+ * draws the new samples into the column at the sweep and erases the column
+ * ahead of it, which stays blank as the cursor. Nothing else is touched, so
+ * the next refresh sends just those two columns' pixels on each row of the
+ * area (the LCD's dirty spans), not the whole view.
+ *
+ * Samples are int16_t in whatever unit the caller has (ADC counts, say),
+ * mapped to rows by a Q16 scale worked out once in Scope_Init(): no floats or
+ * divides per sample. Each trace is joined up as a vertical run in its column
+ * from the previous sample's row to the new one, so fast edges stay visible.
+ *
+ * The caller's ring (width * traces samples) keeps the sweep, so
+ * Scope_Redraw() can paint it all again after the screen was cleared.
+ * It draws into the image buffer, so it can't be used with LCD_DISPLAY_LIST,
+ * which throws every frame's drawing away.
+ *
+ * Example usage:
+ * @code
+ * static int16_t ring[200 * 2];
+ * Scope_t scope = {
+ *     .x = 20, .y = 40, .width = 200, .height = 160,
+ *     .min = 0, .max = 4095,                  // 12-bit ADC range
+ *     .traces = 2, .colours = {3, 6}, .background = 0,
+ *     .samples = ring
+ * };
+ * Scope_Init(&scope);
+ *
+ * // Every sample:
+ * int16_t values[2] = { joystick.x_raw, joystick.y_raw };
+ * Scope_Push(&scope, values);
+ * LCD_Refresh(&cfg0);
+ * @endcode
+ */
+
+#define SCOPE_MAX_TRACES 4   ///< Most traces one scope draws
+
+/**
+ * @struct Scope_t
+ * @brief Area, range and traces of a scope; fill in the fields up to samples
+ */
+typedef struct {
+    uint16_t x, y;                      ///< Top-left corner on the screen
+    uint16_t width, height;             ///< Size in pixels, one column per sample (width at least 2)
+    int16_t min, max;                   ///< Sample values shown on the bottom and top rows
+    uint8_t traces;                     ///< Traces drawn, 1 to SCOPE_MAX_TRACES
+    uint8_t colours[SCOPE_MAX_TRACES];  ///< Colour of each trace
+    uint8_t background;                 ///< Colour columns are erased to
+    int16_t* samples;                   ///< Ring of width * traces samples, column by column
+    uint16_t head;                      ///< Internal: column the next sample goes in
+    uint16_t count;                     ///< Internal: columns holding a sample, up to width - 1
+    uint32_t scale;                     ///< Internal: rows per sample unit (Q16)
+    uint8_t last_row[SCOPE_MAX_TRACES]; ///< Internal: row of each trace's latest sample, from the top
+} Scope_t;
+
+/**
+ * @brief Work out the scale, empty the ring and erase the area
+ *
+ * @param scope Pointer to scope
+ */
+void Scope_Init(Scope_t* scope);
+
+/**
+ * @brief Add one sample per trace at the sweep, and move the sweep on a column
+ *
+ * Values outside min..max are drawn on the top or bottom row.
+ *
+ * @param scope Pointer to scope
+ * @param values One sample for each trace
+ */
+void Scope_Push(Scope_t* scope, const int16_t values[]);
+
+/**
+ * @brief Erase the area and draw every sample held again (e.g. after LCD_Fill_Buffer())
+ *
+ * @param scope Pointer to scope
+ */
+void Scope_Redraw(Scope_t* scope);
+
+#ifdef __cplusplus
+}
+#endif
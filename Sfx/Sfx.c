@@ -0,0 +1,52 @@
+/**
+ * @file Sfx.c
+ * @brief Sound effect arbitration implementation
+ *
+ * Times are compared as differences (now - then), so they stay right across
+ * the wrap of a 32-bit millisecond counter, 49 days in.
+ */
+
+#include "Sfx.h"
+
+void Sfx_Init(Sfx_t* sfx, const Sfx_Effect_t* effects, uint8_t count) {
+    sfx->effects = effects;
+    sfx->count = (count > SFX_MAX_EFFECTS) ? SFX_MAX_EFFECTS : count;
+    sfx->started = 0;
+    sfx->playing = -1;
+    sfx->playing_until_ms = 0;
+    sfx->played = 0;
+    sfx->preempted = 0;
+    sfx->coalesced = 0;
+    sfx->suppressed = 0;
+}
+
+Sfx_Action_t Sfx_Request(Sfx_t* sfx, uint8_t effect, uint32_t now_ms) {
+    if (effect >= sfx->count) {
+        return SFX_NONE;
+    }
+    const Sfx_Effect_t* wanted = &sfx->effects[effect];
+
+    // Asked for again too soon: the start a moment ago stands for this one too
+    if ((sfx->started & (1u << effect)) &&
+        now_ms - sfx->last_start_ms[effect] < wanted->retrigger_ms) {
+        sfx->coalesced++;
+        return SFX_NONE;
+    }
+
+    Sfx_Action_t action = SFX_START;
+    if (sfx->playing >= 0 && (int32_t)(sfx->playing_until_ms - now_ms) > 0) {
+        if (sfx->effects[sfx->playing].priority > wanted->priority) {
+            sfx->suppressed++;
+            return SFX_NONE;
+        }
+        action = SFX_PREEMPT;
+        sfx->preempted++;
+    }
+
+    sfx->started |= (uint8_t)(1u << effect);
+    sfx->last_start_ms[effect] = now_ms;
+    sfx->playing = (int8_t)effect;
+    sfx->playing_until_ms = now_ms + wanted->duration_ms;
+    sfx->played++;
+    return action;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file Sfx.h
+ * @brief Sound effect arbitration: priorities, pre-emption and retrigger limits
+ *
+ * Decides whether a sound effect asked for by the game should be heard, and
+ * whether it should cut off the one playing, before anything reaches the
+ * buzzer. A ball worked into a corner can hit a wall and a paddle every step:
+ * queued one after another, those beeps would run on long after the rally,
+ * each one reprogramming the buzzer's timer.
+ *
+ * Each effect has a priority and a retrigger time:
+ *
+ * - An effect asked for again within its retrigger time of its last start is
+ *   coalesced into that one (not played again).
+ * - An effect asked for while one of higher priority is sounding is dropped.
+ * - Otherwise it plays, and cuts off whatever is sounding (same or lower
+ *   priority) rather than waiting behind it.
+ *
+ * Sfx_Request() only makes the decision; the caller plays the effect the way
+ * its audio output does (BuzzerSeq_Play_Now() to cut off, Mixer_Play() to mix
+ * over). Sfx keeps no hardware state and takes the time as an argument, so it
+ * builds on a PC too.
+ *
+ * Example usage:
+ * @code
+ * static const Sfx_Effect_t effects[] = {
+ *     // freq, volume, ms, priority, retrigger ms
+ *     {1200, 50, 40, 1, 80},   // wall
+ *     {800,  50, 40, 2, 60},   // paddle: cuts off a wall beep
+ * };
+ * static Sfx_t sfx;
+ *
+ * Sfx_Init(&sfx, effects, 2);
+ * if (Sfx_Request(&sfx, 1, HAL_GetTick()) != SFX_NONE) {
+ *     BuzzerSeq_Play_Now(&buzzer_seq, effects[1].freq_hz, effects[1].volume_percent,
+ *                        effects[1].duration_ms);
+ * }
+ * @endcode
+ */
+
+#ifndef SFX_H
+#define SFX_H
+
+#include <stdint.h>
+
+// Most effects a table can have
+#define SFX_MAX_EFFECTS 8
+
+/**
+ * @struct Sfx_Effect_t
+ * @brief One sound effect and the rules it is played by
+ */
+typedef struct {
+    uint16_t freq_hz;        // Tone frequency
+    uint8_t volume_percent;  // 0..100
+    uint16_t duration_ms;    // Length of the tone
+    uint8_t priority;        // Higher cuts off lower; lower is dropped while higher sounds
+    uint16_t retrigger_ms;   // Least time between two starts of this effect
+} Sfx_Effect_t;
+
+/**
+ * @enum Sfx_Action_t
+ * @brief What Sfx_Request() decided
+ */
+typedef enum {
+    SFX_NONE = 0,   // Not played: coalesced, or a higher priority effect is sounding
+    SFX_START,      // Play it: nothing is sounding
+    SFX_PREEMPT     // Play it, cutting off the effect sounding
+} Sfx_Action_t;
+
+/**
+ * @struct Sfx_t
+ * @brief Effect table and what was last played
+ */
+typedef struct {
+    const Sfx_Effect_t* effects;              // Table given to Sfx_Init() (not copied)
+    uint8_t count;                            // Effects in the table
+    uint8_t started;                          // Bit per effect: started since Sfx_Init()
+    int8_t playing;                           // Effect last started, or -1
+    uint32_t playing_until_ms;                // When it ends
+    uint32_t last_start_ms[SFX_MAX_EFFECTS];  // Last start of each effect
+    uint32_t played;                          // Requests played (SFX_START or SFX_PREEMPT)
+    uint32_t preempted;                       // Of those, how many cut another effect off
+    uint32_t coalesced;                       // Requests within an effect's retrigger time
+    uint32_t suppressed;                      // Requests dropped for a higher priority effect
+} Sfx_t;
+
+/**
+ * @brief Set up the arbiter with an effect table, nothing playing
+ *
+ * @param sfx Arbiter
+ * @param effects Effect table, indexed by the effect numbers given to Sfx_Request()
+ * @param count Effects in the table (at most SFX_MAX_EFFECTS, the rest are ignored)
+ */
+void Sfx_Init(Sfx_t* sfx, const Sfx_Effect_t* effects, uint8_t count);
+
+/**
+ * @brief Decide whether an effect is played, and note it if it is
+ *
+ * @param sfx Arbiter
+ * @param effect Index into the effect table (out of range: SFX_NONE)
+ * @param now_ms Current time in ms (e.g. HAL_GetTick()), wrapping is fine
+ * @return SFX_NONE, SFX_START or SFX_PREEMPT
+ */
+Sfx_Action_t Sfx_Request(Sfx_t* sfx, uint8_t effect, uint32_t now_ms);
+
+/**
+ * @brief Look up an effect of the table
+ *
+ * @param sfx Arbiter
+ * @param effect Index into the effect table (must be in range)
+ * @return The effect
+ */
+static inline const Sfx_Effect_t* Sfx_Get(const Sfx_t* sfx, uint8_t effect) {
+    return &sfx->effects[effect];
+}
+
+#endif /* SFX_H */
@@ -0,0 +1,57 @@
+/**
+ * @file SnapshotRing.c
+ * @brief Ring of packed engine states implementation
+ */
+
+#include "SnapshotRing.h"
+#include <stddef.h>
+
+void SnapshotRing_Init(SnapshotRing_t* ring) {
+    for (uint16_t i = 0; i < SNAPSHOT_RING_DEPTH; i++) {
+        ring->length[i] = 0;
+    }
+    ring->pushed = 0;
+    ring->too_large = 0;
+}
+
+uint8_t SnapshotRing_Push(SnapshotRing_t* ring, const PongEngine_t* engine, uint32_t step) {
+    const uint16_t slot = (uint16_t)(ring->pushed % SNAPSHOT_RING_DEPTH);
+    ring->pushed++;
+    ring->step[slot] = step;
+    ring->length[slot] = PongEngine_Pack(engine, ring->data[slot], SNAPSHOT_SLOT_BYTES);
+    if (ring->length[slot] == 0) {
+        ring->too_large++;
+        return 0;
+    }
+    return 1;
+}
+
+const uint8_t* SnapshotRing_Find(const SnapshotRing_t* ring, uint32_t step, uint16_t* length) {
+    for (uint16_t i = 0; i < SNAPSHOT_RING_DEPTH; i++) {
+        if (ring->length[i] != 0 && ring->step[i] == step) {
+            *length = ring->length[i];
+            return ring->data[i];
+        }
+    }
+    return NULL;
+}
+
+uint8_t SnapshotRing_Restore(const SnapshotRing_t* ring, PongEngine_t* engine, uint32_t step) {
+    uint16_t length;
+    const uint8_t* data = SnapshotRing_Find(ring, step, &length);
+    return data != NULL && PongEngine_Unpack(engine, data, length);
+}
+
+const uint8_t* SnapshotRing_Oldest(const SnapshotRing_t* ring, uint32_t* step, uint16_t* length) {
+    // From the slot about to be overwritten, in push order, to the first one filled
+    const uint32_t held = (ring->pushed < SNAPSHOT_RING_DEPTH) ? ring->pushed : SNAPSHOT_RING_DEPTH;
+    for (uint32_t k = ring->pushed - held; k < ring->pushed; k++) {
+        const uint16_t slot = (uint16_t)(k % SNAPSHOT_RING_DEPTH);
+        if (ring->length[slot] != 0) {
+            *step = ring->step[slot];
+            *length = ring->length[slot];
+            return ring->data[slot];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file SnapshotRing.h
+ * @brief The last few engine states, packed, one per step
+ *
+ * A ring of SNAPSHOT_RING_DEPTH slots of SNAPSHOT_SLOT_BYTES each, filled
+ * with PongEngine_Pack(). Pushing one every step keeps the game of the last
+ * SNAPSHOT_RING_DEPTH steps at hand: to go back to one (rollback, rewinding
+ * a replay) or to dump after something went wrong, for PongEngine_Unpack()
+ * on a PC.
+ *
+ * Slots are a fixed size, so a push costs the packing and nothing else. A
+ * state too big for a slot (many balls in multi-ball) leaves its slot empty
+ * and counts it in too_large; raise SNAPSHOT_SLOT_BYTES if that happens
+ * (PONG_PACKED_BYTES() gives the size for so many balls and brick rows).
+ *
+ * Example usage:
+ * @code
+ * static SnapshotRing_t history;
+ * SnapshotRing_Init(&history);
+ *
+ * // After every step:
+ * SnapshotRing_Push(&history, &engine, step);
+ *
+ * // Back to 5 steps ago:
+ * SnapshotRing_Restore(&history, &engine, step - 5);
+ * @endcode
+ */
+
+#ifndef SNAPSHOTRING_H
+#define SNAPSHOTRING_H
+
+#include <stdint.h>
+#include "PongEngine.h"
+
+// Steps of history kept
+#ifndef SNAPSHOT_RING_DEPTH
+#define SNAPSHOT_RING_DEPTH 16
+#endif
+
+// Bytes of a slot: with no bricks 128 holds 5 balls, with 16 rows of bricks 3
+#ifndef SNAPSHOT_SLOT_BYTES
+#define SNAPSHOT_SLOT_BYTES 128
+#endif
+
+#if SNAPSHOT_SLOT_BYTES < PONG_PACKED_BYTES(1, 0)
+#error "SNAPSHOT_SLOT_BYTES is too small for one ball"
+#endif
+
+/**
+ * @struct SnapshotRing_t
+ * @brief Packed states of the last SNAPSHOT_RING_DEPTH pushes
+ */
+typedef struct {
+    uint8_t data[SNAPSHOT_RING_DEPTH][SNAPSHOT_SLOT_BYTES];
+    uint32_t step[SNAPSHOT_RING_DEPTH];     // Step each slot was pushed for
+    uint16_t length[SNAPSHOT_RING_DEPTH];   // Bytes in each slot, 0 if empty
+    uint32_t pushed;                        // Pushes since SnapshotRing_Init() (next slot: pushed % depth)
+    uint32_t too_large;                     // Pushes whose state did not fit a slot
+} SnapshotRing_t;
+
+/**
+ * @brief Empty the ring
+ *
+ * @param ring Pointer to snapshot ring
+ */
+void SnapshotRing_Init(SnapshotRing_t* ring);
+
+/**
+ * @brief Pack the engine state into the next slot, over the oldest
+ *
+ * @param ring Pointer to snapshot ring
+ * @param engine Pointer to game engine
+ * @param step Step number to find it by (e.g. steps run so far)
+ * @return 1 if stored, 0 if the state did not fit a slot
+ */
+uint8_t SnapshotRing_Push(SnapshotRing_t* ring, const PongEngine_t* engine, uint32_t step);
+
+/**
+ * @brief Find the state pushed for a step
+ *
+ * @param ring Pointer to snapshot ring
+ * @param step Step number it was pushed with
+ * @param length Set to the bytes of the state
+ * @return The packed state, or NULL if the ring does not hold that step
+ */
+const uint8_t* SnapshotRing_Find(const SnapshotRing_t* ring, uint32_t step, uint16_t* length);
+
+/**
+ * @brief Put the engine back to the state pushed for a step
+ *
+ * @param ring Pointer to snapshot ring
+ * @param engine Pointer to game engine (see PongEngine_Unpack())
+ * @param step Step number it was pushed with
+ * @return 1 if restored, 0 if the ring does not hold that step
+ */
+uint8_t SnapshotRing_Restore(const SnapshotRing_t* ring, PongEngine_t* engine, uint32_t step);
+
+/**
+ * @brief Get the oldest state the ring holds
+ *
+ * @param ring Pointer to snapshot ring
+ * @param step Set to its step number
+ * @param length Set to its bytes
+ * @return The packed state, or NULL if the ring is empty
+ */
+const uint8_t* SnapshotRing_Oldest(const SnapshotRing_t* ring, uint32_t* step, uint16_t* length);
+
+#endif // SNAPSHOTRING_H
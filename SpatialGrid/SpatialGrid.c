@@ -0,0 +1,74 @@
+/**
+ * @file SpatialGrid.c
+ * @brief Uniform-grid broad phase implementation
+ */
+
+#include "SpatialGrid.h"
+#include <string.h>
+
+// Cell column/row containing a pixel coordinate, clamped to the grid
+static uint8_t cell_of(int16_t v, uint8_t cells) {
+    if (v < 0) {
+        return 0;
+    }
+    int16_t c = v / GRID_CELL_SIZE;
+    return (c >= cells) ? (uint8_t)(cells - 1) : (uint8_t)c;
+}
+
+// Range of cells a box touches (inclusive)
+static void cell_range(const AABB* box, uint8_t* c0, uint8_t* c1, uint8_t* r0, uint8_t* r1) {
+    *c0 = cell_of(box->x, GRID_COLS);
+    *c1 = cell_of(box->x + box->width - 1, GRID_COLS);
+    *r0 = cell_of(box->y, GRID_ROWS);
+    *r1 = cell_of(box->y + box->height - 1, GRID_ROWS);
+}
+
+void SpatialGrid_Clear(SpatialGrid_t* grid) {
+    // Only the counts need resetting; stale IDs past count are never read
+    memset(grid->count, 0, sizeof(grid->count));
+    grid->overflow = 0;
+}
+
+void SpatialGrid_Insert(SpatialGrid_t* grid, uint8_t id, const AABB* box) {
+    uint8_t c0, c1, r0, r1;
+    cell_range(box, &c0, &c1, &r0, &r1);
+
+    for (uint8_t r = r0; r <= r1; r++) {
+        for (uint8_t c = c0; c <= c1; c++) {
+            uint16_t cell = r * GRID_COLS + c;
+            if (grid->count[cell] < GRID_CELL_CAPACITY) {
+                grid->ids[cell][grid->count[cell]++] = id;
+            } else {
+                grid->overflow++;
+            }
+        }
+    }
+}
+
+uint8_t SpatialGrid_Query(const SpatialGrid_t* grid, const AABB* box, uint8_t* out, uint8_t max_out) {
+    uint8_t c0, c1, r0, r1;
+    cell_range(box, &c0, &c1, &r0, &r1);
+
+    // One bit per possible ID, so objects spanning several cells are returned once
+    uint32_t seen[256 / 32] = {0};
+    uint8_t n = 0;
+
+    for (uint8_t r = r0; r <= r1; r++) {
+        for (uint8_t c = c0; c <= c1; c++) {
+            uint16_t cell = r * GRID_COLS + c;
+            for (uint8_t k = 0; k < grid->count[cell]; k++) {
+                uint8_t id = grid->ids[cell][k];
+                uint32_t bit = 1u << (id & 31);
+                if (seen[id >> 5] & bit) {
+                    continue;
+                }
+                seen[id >> 5] |= bit;
+                if (n == max_out) {
+                    return n;
+                }
+                out[n++] = id;
+            }
+        }
+    }
+    return n;
+}
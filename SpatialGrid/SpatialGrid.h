@@ -0,0 +1,77 @@
+/**
+ * @file SpatialGrid.h
+ * @brief Uniform-grid broad phase for many-object collision
+ * 
+ * Splits the 240x240 playfield into 16x16 cells of 15px. Each object is
+ * listed in every cell its bounding box touches, so a collision check only
+ * has to look at objects listed in the cells it overlaps instead of testing
+ * every object against every other one (O(n*m)).
+ * 
+ * **Broad phase / narrow phase:**
+ * - Broad phase (this module): cheap, finds objects that MIGHT collide
+ * - Narrow phase (AABB_Collides() / AABB_Sweep()): exact test, only run on
+ *   the candidates the broad phase returns
+ * 
+ * All storage is fixed-size arrays inside SpatialGrid_t (no malloc).
+ */
+
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <stdint.h>
+#include "Utils.h"
+
+#define GRID_CELL_SIZE 15                   // Cell width and height in pixels
+#define GRID_COLS      ((SCREEN_WIDTH + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE)   // 16 for 240 pixels
+#define GRID_ROWS      ((SCREEN_HEIGHT + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE)
+#define GRID_CELLS     (GRID_COLS * GRID_ROWS)
+
+// Most objects listed in one cell. Objects inserted into a full cell are
+// left out of it (and counted in SpatialGrid_t.overflow).
+#ifndef GRID_CELL_CAPACITY
+#define GRID_CELL_CAPACITY 8
+#endif
+
+/**
+ * @struct SpatialGrid_t
+ * @brief Per-cell object lists (object IDs 0-255)
+ */
+typedef struct {
+    uint8_t count[GRID_CELLS];                      // Objects listed in each cell
+    uint8_t ids[GRID_CELLS][GRID_CELL_CAPACITY];    // Object IDs listed in each cell
+    uint16_t overflow;                              // Insertions dropped because a cell was full
+} SpatialGrid_t;
+
+/**
+ * @brief Empty every cell
+ * 
+ * @param grid Pointer to grid
+ */
+void SpatialGrid_Clear(SpatialGrid_t* grid);
+
+/**
+ * @brief List an object in every cell its bounding box touches
+ * 
+ * Boxes partly or fully off the playfield are clamped to the edge cells.
+ * 
+ * @param grid Pointer to grid
+ * @param id Object ID (e.g. ball index)
+ * @param box Object bounding box
+ */
+void SpatialGrid_Insert(SpatialGrid_t* grid, uint8_t id, const AABB* box);
+
+/**
+ * @brief Find the objects listed in the cells a box touches
+ * 
+ * Each object is returned once, even if it shares several cells with the box.
+ * Candidates still need a narrow-phase test.
+ * 
+ * @param grid Pointer to grid
+ * @param box Area to search
+ * @param out Filled with candidate object IDs
+ * @param max_out Size of out
+ * @return Number of IDs written to out
+ */
+uint8_t SpatialGrid_Query(const SpatialGrid_t* grid, const AABB* box, uint8_t* out, uint8_t max_out);
+
+#endif // SPATIALGRID_H
@@ -0,0 +1,164 @@
+#include "StatusLed.h"
+#include "DmaChannel.h"
+#include "DmaBuffer.h"
+#include "ClockProfile.h"
+#include <stddef.h>
+
+/**
+ * @file StatusLed.c
+ * @brief Implementation of the LD2 blink patterns
+ *
+ * A pattern starts from a dark dummy period (two ticks, 0.2ms). The
+ * update at its end reloads the dummy and bursts step 0 into the preload
+ * registers; the one after starts step 0 and bursts step 1, and from then on
+ * each update starts the step written at the one before. With its RCR, a
+ * step only raises an update (and a burst) once its repetitions are done.
+ */
+
+#define STATUSLED_TIM      TIM8
+#define STATUSLED_TICK_HZ  10000u           // 0.1ms ticks: steps up to 6.5s in the 16-bit ARR
+#define STATUSLED_DMA      DMA2_Channel1    // TIM8_UP
+#define STATUSLED_REQUEST  7
+#define STATUSLED_WORDS    3                // Burst of ARR, RCR, CCR1 (consecutive registers)
+
+#define MS(ms) ((uint16_t)((ms) * (STATUSLED_TICK_HZ / 1000u)))
+
+// Two steps of {ARR, RCR, CCR1}, read by the DMA in a loop. In SRAM1, not zeroed: each
+// pattern writes both steps before the DMA is enabled
+static uint16_t steps[2 * STATUSLED_WORDS] ALIGNED_DMA_BUFFER;
+DMA_BUFFER_CHECK(steps, 2);
+static StatusLed_Pattern_t showing = STATUSLED_OFF;
+static uint8_t showing_code = 0;
+static uint8_t have_dma = 0;
+static uint8_t setup_done = 0;
+
+// A step: period_ms long, on for on_ms of it, played repeat times before the next step
+static void set_step(uint32_t index, uint32_t period_ms, uint32_t on_ms, uint32_t repeat)
+{
+    uint16_t* step = &steps[index * STATUSLED_WORDS];
+    step[0] = (uint16_t)(MS(period_ms) - 1u);
+    step[1] = (uint16_t)(repeat - 1u);
+    step[2] = MS(on_ms);
+}
+
+void StatusLed_Init(void)
+{
+    if (setup_done) {
+        return;
+    }
+
+    RCC->APB2ENR |= RCC_APB2ENR_TIM8EN;
+    (void)RCC->APB2ENR;  // the clock has to be on before the registers are written
+
+    // PWM mode 1 on the complementary output only: with CC1E clear, CH1N follows OC1REF
+    STATUSLED_TIM->CR1 = TIM_CR1_ARPE;
+    STATUSLED_TIM->PSC = (ClockProfile_Timer_Hz(STATUSLED_TIM) / STATUSLED_TICK_HZ) - 1;
+    STATUSLED_TIM->ARR = MS(1000) - 1u;
+    STATUSLED_TIM->RCR = 0;
+    STATUSLED_TIM->CCR1 = 0;
+    STATUSLED_TIM->CCMR1 = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE;
+    STATUSLED_TIM->CCER = TIM_CCER_CC1NE;
+    STATUSLED_TIM->BDTR = TIM_BDTR_MOE;
+    STATUSLED_TIM->DCR = ((STATUSLED_WORDS - 1u) << TIM_DCR_DBL_Pos) |
+                         ((offsetof(TIM_TypeDef, ARR) / 4u) << TIM_DCR_DBA_Pos);
+    STATUSLED_TIM->EGR = TIM_EGR_UG;
+    STATUSLED_TIM->SR = 0;
+    STATUSLED_TIM->CR1 |= TIM_CR1_CEN;
+
+    // Only now does PA5 leave the GPIO output (low) for the timer, which is driving it low too
+    GPIO_InitTypeDef gpio = {0};
+    gpio.Pin = GPIO_PIN_5;
+    gpio.Mode = GPIO_MODE_AF_PP;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    gpio.Alternate = GPIO_AF3_TIM8;
+    HAL_GPIO_Init(GPIOA, &gpio);
+
+    // 16-bit steps into the 32-bit DMAR, in a loop; no interrupts, the DMA needs no help
+    have_dma = (DmaChannel_Claim(STATUSLED_DMA, STATUSLED_REQUEST, steps, "StatusLed") == DMACHANNEL_OK);
+    if (have_dma) {
+        STATUSLED_DMA->CCR = 0;
+        DmaChannel_Clear_Flags(STATUSLED_DMA);
+        STATUSLED_DMA->CPAR = (uint32_t)&STATUSLED_TIM->DMAR;
+        STATUSLED_DMA->CMAR = (uint32_t)steps;
+        STATUSLED_DMA->CCR = DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_1 | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_DIR;
+    }
+
+    showing = STATUSLED_OFF;
+    showing_code = 0;
+    setup_done = 1;
+}
+
+void StatusLed_Set(StatusLed_Pattern_t pattern, uint8_t code)
+{
+    if (!setup_done) {
+        return;
+    }
+    if (pattern == STATUSLED_FAULT) {
+        code = (code < 1u) ? 1u : (code > STATUSLED_MAX_CODE) ? STATUSLED_MAX_CODE : code;
+    } else {
+        code = 0;
+    }
+    if (pattern == showing && code == showing_code) {
+        return;
+    }
+    showing = pattern;
+    showing_code = code;
+
+    // Stop the bursts before the table changes under them
+    STATUSLED_TIM->DIER &= ~TIM_DIER_UDE;
+    if (have_dma) {
+        STATUSLED_DMA->CCR &= ~DMA_CCR_EN;
+    }
+    if (pattern != STATUSLED_OFF && !have_dma) {
+        pattern = STATUSLED_ON;  // Nothing to step a blink: steady on at least shows "running"
+    }
+
+    switch (pattern) {
+    case STATUSLED_OFF:
+    case STATUSLED_ON:
+        // One step, held: no DMA. A CCR above ARR keeps OC1REF high all period
+        STATUSLED_TIM->ARR = MS(1000) - 1u;
+        STATUSLED_TIM->RCR = 0;
+        STATUSLED_TIM->CCR1 = (pattern == STATUSLED_ON) ? MS(1000) + 1u : 0u;
+        STATUSLED_TIM->EGR = TIM_EGR_UG;
+        return;
+    case STATUSLED_HEARTBEAT:
+        set_step(0, 150, 50, 2);    // Two short blinks
+        set_step(1, 700, 0, 1);     // and dark for the rest of the second
+        break;
+    case STATUSLED_WARNING:
+        set_step(0, 250, 125, 1);
+        set_step(1, 250, 125, 1);
+        break;
+    case STATUSLED_FAULT:
+    default:
+        set_step(0, 400, 150, code);
+        set_step(1, 1500, 0, 1);
+        break;
+    }
+
+    // Start from the dark dummy period, then let the updates take the steps in turn
+    STATUSLED_TIM->ARR = 1;
+    STATUSLED_TIM->RCR = 0;
+    STATUSLED_TIM->CCR1 = 0;
+    STATUSLED_TIM->EGR = TIM_EGR_UG;
+    DmaChannel_Clear_Flags(STATUSLED_DMA);
+    STATUSLED_DMA->CMAR = (uint32_t)steps;
+    STATUSLED_DMA->CNDTR = 2u * STATUSLED_WORDS;
+    STATUSLED_DMA->CCR |= DMA_CCR_EN;
+    STATUSLED_TIM->DIER |= TIM_DIER_UDE;
+}
+
+StatusLed_Pattern_t StatusLed_Get(void)
+{
+    return showing;
+}
+
+void StatusLed_Clock_Changed(void)
+{
+    if (!setup_done) {
+        return;
+    }
+    STATUSLED_TIM->PSC = (ClockProfile_Timer_Hz(STATUSLED_TIM) / STATUSLED_TICK_HZ) - 1;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file StatusLed.h
+ * @brief Blink patterns on LD2 (PA5) made by TIM8 and DMA, with no CPU
+ *
+ * PA5 is also TIM8_CH1N (AF3), so the Nucleo's green LED can be driven by a
+ * timer channel instead of GPIO writes. TIM8 runs PWM at 10kHz ticks, and
+ * each pattern is two steps of (period, repetitions, on time), written into
+ * ARR, RCR and CCR1 at every update event by a circular DMA burst (TIM8_UP:
+ * DMA2_Channel1, request 7). The repetition counter plays one step several
+ * periods over before the next update, so a fault code of N blinks and a
+ * pause is two steps too.
+ *
+ * Once StatusLed_Set() has started a pattern, the LED runs by itself: it
+ * keeps blinking with interrupts masked, in a HardFault handler, or with the
+ * main loop stuck, as long as the clocks run. Nothing stops it but another
+ * StatusLed_Set() (or the Stop modes, which halt the timer).
+ *
+ * TIM8 and DMA2_Channel1 are set up at register level, so CubeMX does not
+ * need to know about them. PA5 is taken from the GPIO output it is set up as.
+ *
+ * Example usage:
+ * @code
+ * StatusLed_Init();                              // after MX_GPIO_Init()
+ * StatusLed_Set(STATUSLED_HEARTBEAT, 0);         // a double blink every second
+ * StatusLed_Set(STATUSLED_WARNING, 0);           // fast blink
+ * StatusLed_Set(STATUSLED_FAULT, 3);             // 3 blinks, a pause, again...
+ *
+ * // After a core clock change (ClockProfile_Set()):
+ * StatusLed_Clock_Changed();
+ * @endcode
+ */
+
+#define STATUSLED_MAX_CODE 9    ///< Most blinks a fault code can have (more are hard to count)
+
+/**
+ * @enum StatusLed_Pattern_t
+ * @brief What LD2 shows
+ */
+typedef enum {
+    STATUSLED_OFF = 0,          ///< Off
+    STATUSLED_ON,               ///< On
+    STATUSLED_HEARTBEAT,        ///< Double blink once a second: running normally
+    STATUSLED_WARNING,          ///< 4Hz blink: something to look at (e.g. frame overruns)
+    STATUSLED_FAULT             ///< A code of 1..STATUSLED_MAX_CODE blinks, then a pause
+} StatusLed_Pattern_t;
+
+/**
+ * @brief Take PA5 over for TIM8_CH1N, with the LED off
+ *
+ * Also claims DMA2_Channel1 for TIM8_UP (DmaChannel.h). Does nothing if it
+ * is held by another module: StatusLed_Set() then only switches the LED on
+ * or off. Does nothing if already set up.
+ */
+void StatusLed_Init(void);
+
+/**
+ * @brief Show a pattern
+ *
+ * Takes effect straight away. Setting the pattern (and code) already
+ * showing does nothing, so it can be called every frame.
+ *
+ * @param pattern Pattern to show
+ * @param code Blinks for STATUSLED_FAULT (clamped to 1..STATUSLED_MAX_CODE), ignored otherwise
+ *
+ * @note Safe from any context (a fault handler included) where nothing else
+ *       calls it at the same time
+ */
+void StatusLed_Set(StatusLed_Pattern_t pattern, uint8_t code);
+
+/**
+ * @brief Get the pattern showing
+ *
+ * @return Pattern of the last StatusLed_Set() (STATUSLED_OFF before StatusLed_Init())
+ */
+StatusLed_Pattern_t StatusLed_Get(void);
+
+/**
+ * @brief Keep the 10kHz tick after the core clock changed (e.g. ClockProfile_Set())
+ *
+ * Sets the prescaler from the new APB2 clock. It is preloaded, so the step
+ * playing finishes at the old rate.
+ */
+void StatusLed_Clock_Changed(void);
+
+#ifdef __cplusplus
+}
+#endif
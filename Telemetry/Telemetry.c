@@ -0,0 +1,97 @@
+/**
+ * @file Telemetry.c
+ * @brief Telemetry frame encoding (packing, CRC and COBS framing)
+ */
+
+#include "Telemetry.h"
+
+// CRC-16/CCITT-FALSE, four bits at a time (32-byte table instead of 512)
+static const uint16_t crc_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t Telemetry_CRC16(const uint8_t* data, uint16_t length) {
+    return Telemetry_CRC16_Update(0xFFFF, data, length);
+}
+
+uint16_t Telemetry_CRC16_Update(uint16_t crc, const uint8_t* data, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+        crc = (uint16_t)((crc << 4) ^ crc_nibble[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ crc_nibble[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+static uint8_t* put_u16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint8_t* put_u32(uint8_t* p, uint32_t value) {
+    p = put_u16(p, (uint16_t)value);
+    return put_u16(p, (uint16_t)(value >> 16));
+}
+
+uint16_t Telemetry_Encode(const Telemetry_Frame_t* frame, uint8_t* out) {
+    uint8_t raw[TELEMETRY_PAYLOAD_BYTES];
+    uint8_t* p = raw;
+    *p++ = TELEMETRY_VERSION;
+    p = put_u32(p, frame->step);
+    *p++ = frame->ball_count;
+    p = put_u16(p, (uint16_t)frame->ball_x);
+    p = put_u16(p, (uint16_t)frame->ball_y);
+    p = put_u16(p, (uint16_t)frame->ball_vx);
+    p = put_u16(p, (uint16_t)frame->ball_vy);
+    p = put_u16(p, (uint16_t)frame->paddle_y);
+    p = put_u16(p, (uint16_t)frame->opponent_y);
+    p = put_u16(p, frame->score);
+    p = put_u16(p, frame->opponent_score);
+    *p++ = frame->lives;
+    *p++ = frame->steps;
+    p = put_u16(p, frame->update_us);
+    p = put_u16(p, frame->render_us);
+    p = put_u32(p, frame->overruns);
+    p = put_u32(p, frame->log_dropped);
+    *p++ = frame->quality_level;
+    *p++ = frame->frame_load;
+    p = put_u32(p, frame->lcd_pixel_bytes);
+    p = put_u16(p, frame->lcd_command_bytes);
+    p = put_u16(p, frame->lcd_windows);
+    p = put_u16(p, frame->lcd_busy_us);
+    return Telemetry_Encode_Packet(raw, TELEMETRY_PAYLOAD_BYTES, out);
+}
+
+uint16_t Telemetry_Encode_Packet(const uint8_t* payload, uint16_t length, uint8_t* out) {
+    out[0] = 0x00;
+    return (uint16_t)(1 + Telemetry_Encode_Packet_Body(payload, length, out + 1));
+}
+
+uint16_t Telemetry_Encode_Packet_Body(const uint8_t* payload, uint16_t length, uint8_t* out) {
+    if (length > TELEMETRY_MAX_PACKET_PAYLOAD) {
+        length = TELEMETRY_MAX_PACKET_PAYLOAD;
+    }
+    const uint16_t crc = Telemetry_CRC16(payload, length);
+    const uint8_t crc_bytes[2] = {(uint8_t)(crc >> 8), (uint8_t)crc};
+
+    // COBS over the payload and CRC: each zero becomes the distance to the next one, with a
+    // code byte in front of the first run (runs are under 254 bytes, so no 0xFF codes)
+    uint16_t n = 0;
+    uint16_t code_at = n++;
+    uint8_t code = 1;
+    for (uint16_t i = 0; i < length + 2u; i++) {
+        const uint8_t byte = (i < length) ? payload[i] : crc_bytes[i - length];
+        if (byte == 0) {
+            out[code_at] = code;
+            code_at = n++;
+            code = 1;
+        } else {
+            out[n++] = byte;
+            code++;
+        }
+    }
+    out[code_at] = code;
+    out[n++] = 0x00;
+    return n;
+}
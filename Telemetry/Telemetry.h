@@ -0,0 +1,149 @@
+/**
+ * @file Telemetry.h
+ * @brief Compact binary frames of per-frame game state, for streaming over UART
+ * 
+ * One frame per main loop iteration carries the first ball, both paddles,
+ * scores, lives, how long the frame took and what it sent to the LCD, in 53
+ * bytes on the wire
+ * (printf of the same fields is several times that and far slower).
+ * 
+ * **Payload** (little-endian, TELEMETRY_PAYLOAD_BYTES):
+ * | Offset | Size | Field |
+ * |--------|------|-------|
+ * | 0  | 1 | Format version (TELEMETRY_VERSION) |
+ * | 1  | 4 | Physics step count |
+ * | 5  | 1 | Balls in play |
+ * | 6  | 2 | Ball 0 X, pixels (signed) |
+ * | 8  | 2 | Ball 0 Y, pixels (signed) |
+ * | 10 | 2 | Ball 0 X velocity, Q8.8 pixels/step (signed) |
+ * | 12 | 2 | Ball 0 Y velocity, Q8.8 pixels/step (signed) |
+ * | 14 | 2 | Paddle Y (signed) |
+ * | 16 | 2 | Opponent paddle Y (signed) |
+ * | 18 | 2 | Score |
+ * | 20 | 2 | Opponent score |
+ * | 22 | 1 | Lives |
+ * | 23 | 1 | Physics steps run this frame |
+ * | 24 | 2 | Update time, us |
+ * | 26 | 2 | Render time, us (0 if no frame was drawn) |
+ * | 28 | 4 | Physics overruns so far |
+ * | 32 | 4 | Log messages dropped so far |
+ * | 36 | 1 | Drawing work shed by the frame-budget governor, level (0: none) |
+ * | 37 | 1 | Last frame's cost, percent of the governor's budget (0 without it) |
+ * | 38 | 4 | LCD pixel bytes sent since the last frame (0 without ST7789V2_BUS_STATS) |
+ * | 42 | 2 | LCD command and parameter bytes sent since the last frame |
+ * | 44 | 2 | LCD address windows set since the last frame |
+ * | 46 | 2 | Time spent waiting for the LCD's SPI to go idle, us |
+ * 
+ * **Framing**: the payload is followed by its CRC-16/CCITT-FALSE (poly
+ * 0x1021, init 0xFFFF, big-endian), COBS encoded so it holds no zero bytes,
+ * and sent between two 0x00 delimiters. Text printed on the same UART never
+ * contains a zero, so it lands between frames and fails the CRC instead of
+ * corrupting one. Telemetry/telemetry_decode.py decodes the stream on a PC.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+#define TELEMETRY_VERSION 3
+#define TELEMETRY_PAYLOAD_BYTES 48
+
+// Payload + CRC, one COBS overhead byte per 254 bytes, and the two delimiters
+#define TELEMETRY_FRAME_BYTES (TELEMETRY_PAYLOAD_BYTES + 2 + 1 + 2)
+
+// Longest payload Telemetry_Encode_Packet() takes: with its CRC, one COBS run
+#define TELEMETRY_MAX_PACKET_PAYLOAD 252
+
+// Bytes Telemetry_Encode_Packet() writes for a payload of n bytes
+#define TELEMETRY_PACKET_BYTES(n) ((n) + 2 + 1 + 2)
+
+// Bytes Telemetry_Encode_Packet_Body() writes for a payload of n bytes
+#define TELEMETRY_PACKET_BODY_BYTES(n) ((n) + 2 + 1 + 1)
+
+/**
+ * @struct Telemetry_Frame_t
+ * @brief Game state sent in one telemetry frame
+ */
+typedef struct {
+    uint32_t step;              // Physics steps since start
+    uint8_t ball_count;         // Balls in play
+    int16_t ball_x;             // Ball 0 position, pixels
+    int16_t ball_y;
+    int16_t ball_vx;            // Ball 0 velocity, Q8.8 pixels/step
+    int16_t ball_vy;
+    int16_t paddle_y;
+    int16_t opponent_y;
+    uint16_t score;
+    uint16_t opponent_score;
+    uint8_t lives;
+    uint8_t steps;              // Physics steps run this frame
+    uint16_t update_us;         // Time spent in the physics steps
+    uint16_t render_us;         // Time spent drawing (0 if no frame was drawn)
+    uint32_t overruns;          // FrameTimer_Get_Overruns()
+    uint32_t log_dropped;       // UartLog_Get_Dropped()
+    uint8_t quality_level;      // Governor level: drawing work shed (PONG_ADAPTIVE_QUALITY)
+    uint8_t frame_load;         // Governor_Get_Load(): last frame's cost, % of the budget
+    uint32_t lcd_pixel_bytes;   // LCD traffic since the last frame (ST7789V2_BUS_STATS)
+    uint16_t lcd_command_bytes;
+    uint16_t lcd_windows;
+    uint16_t lcd_busy_us;       // Spent spinning on the SPI's BSY flag
+} Telemetry_Frame_t;
+
+/**
+ * @brief Encode a frame ready to send
+ * 
+ * @param frame Game state to send
+ * @param out Buffer of at least TELEMETRY_FRAME_BYTES
+ * @return Number of bytes written to out
+ */
+uint16_t Telemetry_Encode(const Telemetry_Frame_t* frame, uint8_t* out);
+
+/**
+ * @brief Frame any payload the way telemetry frames are: CRC, COBS and delimiters
+ * 
+ * For other binary messages sharing the UART (e.g. FrameDump.h). The
+ * decoder tells them apart by their first byte and length.
+ * 
+ * @param payload Bytes to send
+ * @param length Number of bytes, at most TELEMETRY_MAX_PACKET_PAYLOAD
+ * @param out Buffer of at least TELEMETRY_PACKET_BYTES(length)
+ * @return Number of bytes written to out
+ */
+uint16_t Telemetry_Encode_Packet(const uint8_t* payload, uint16_t length, uint8_t* out);
+
+/**
+ * @brief Telemetry_Encode_Packet() without the leading delimiter
+ * 
+ * For a link that carries nothing but these packets (e.g. Lockstep.h), where
+ * each packet's closing 0x00 is all the receiver needs to find the next.
+ * 
+ * @param payload Bytes to send
+ * @param length Number of bytes, at most TELEMETRY_MAX_PACKET_PAYLOAD
+ * @param out Buffer of at least TELEMETRY_PACKET_BODY_BYTES(length)
+ * @return Number of bytes written to out
+ */
+uint16_t Telemetry_Encode_Packet_Body(const uint8_t* payload, uint16_t length, uint8_t* out);
+
+/**
+ * @brief CRC-16/CCITT-FALSE of a block of bytes
+ * 
+ * @param data Bytes to check
+ * @param length Number of bytes
+ * @return CRC
+ */
+uint16_t Telemetry_CRC16(const uint8_t* data, uint16_t length);
+
+/**
+ * @brief Carry a CRC-16/CCITT-FALSE on over more bytes, for data read a block at a time
+ * 
+ * Telemetry_CRC16(data, n) is Telemetry_CRC16_Update(0xFFFF, data, n).
+ * 
+ * @param crc CRC of the bytes so far (0xFFFF before the first)
+ * @param data Next bytes
+ * @param length Number of bytes
+ * @return CRC of all the bytes
+ */
+uint16_t Telemetry_CRC16_Update(uint16_t crc, const uint8_t* data, uint16_t length);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Decode the Pong telemetry stream (see Telemetry.h) into CSV.
+
+Reads from a serial port (needs pyserial) or from a capture file / stdin:
+
+    python3 telemetry_decode.py /dev/ttyACM0          # live, 115200 baud
+    python3 telemetry_decode.py capture.bin > log.csv
+    python3 telemetry_decode.py --text /dev/ttyACM0   # also show printf text
+
+Segments between 0x00 delimiters that are not valid frames (printf text, or
+frames cut short by a dropped log write) are skipped and counted on stderr.
+"""
+
+import argparse
+import struct
+import sys
+
+VERSION = 3
+PAYLOAD = struct.Struct("<BIBhhhhhhHHBBHHIIBBIHHH")
+FIELDS = ("step", "ball_count", "ball_x", "ball_y", "ball_vx", "ball_vy",
+          "paddle_y", "opponent_y", "score", "opponent_score", "lives",
+          "steps", "update_us", "render_us", "overruns", "log_dropped",
+          "quality_level", "frame_load", "lcd_pixel_bytes",
+          "lcd_command_bytes", "lcd_windows", "lcd_busy_us")
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as Telemetry_CRC16()."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_frame(segment):
+    raw = cobs_decode(segment)
+    if raw is None or len(raw) != PAYLOAD.size + 2:
+        return None
+    payload, crc = raw[:-2], (raw[-2] << 8) | raw[-1]
+    if crc16(payload) != crc or payload[0] != VERSION:
+        return None
+    values = PAYLOAD.unpack(payload)[1:]
+    frame = dict(zip(FIELDS, values))
+    frame["ball_vx"] /= 256.0
+    frame["ball_vy"] /= 256.0
+    return frame
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial
+        return serial.Serial(path, baud, timeout=1)
+    return open(path, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="serial port, capture file, or - for stdin")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--text", action="store_true", help="echo non-frame text to stderr")
+    args = parser.parse_args()
+
+    stream = open_input(args.input, args.baud)
+    print(",".join(FIELDS), flush=True)
+    segment = bytearray()
+    bad = 0
+    last_step = None
+    lost = 0
+    try:
+        while True:
+            chunk = stream.read(256)
+            if not chunk:
+                if not hasattr(stream, "baudrate"):
+                    break
+                continue
+            for byte in chunk:
+                if byte != 0:
+                    segment.append(byte)
+                    continue
+                if segment:
+                    frame = decode_frame(segment)
+                    if frame is None:
+                        bad += 1
+                        if args.text:
+                            sys.stderr.write(segment.decode("ascii", "replace"))
+                    else:
+                        if last_step is not None and frame["step"] > last_step + frame["steps"]:
+                            lost += 1
+                        last_step = frame["step"]
+                        print(",".join(str(frame[f]) for f in FIELDS), flush=True)
+                    segment.clear()
+    except KeyboardInterrupt:
+        pass
+    print(f"skipped segments: {bad}, gaps: {lost}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
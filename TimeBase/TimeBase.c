@@ -0,0 +1,97 @@
+#include "TimeBase.h"
+#include "stm32l4xx_hal.h"
+#include "ClockProfile.h"
+
+/**
+ * @file TimeBase.c
+ * @brief Implementation of the microsecond clock
+ *
+ * The time is epoch_us + wraps * 2^32 + the counter. The counter only
+ * restarts when the clock is re-timed after a clock change, which moves the
+ * time read just before into epoch_us. The update event of that restart is
+ * kept from raising the interrupt (URS): only a wrap counts.
+ */
+
+#define TIMEBASE_TIM TIM5
+#define TIMEBASE_HZ  1000000u
+
+static volatile uint32_t wraps = 0;    // Counter wraps since the last restart
+static uint64_t epoch_us = 0;          // Time at the last restart
+static uint8_t setup_done = 0;
+
+// Restart the counter at 0 with the prescaler for the current clock. Call with the
+// counter stopped or interrupts masked.
+static void restart(void)
+{
+    TIMEBASE_TIM->PSC = (ClockProfile_Timer_Hz(TIMEBASE_TIM) / TIMEBASE_HZ) - 1;
+    TIMEBASE_TIM->EGR = TIM_EGR_UG;   // loads the prescaler and clears the counter
+    TIMEBASE_TIM->SR = ~TIM_SR_UIF;
+    wraps = 0;
+}
+
+void TimeBase_Init(void)
+{
+    if (setup_done) {
+        return;
+    }
+
+    RCC->APB1ENR1 |= RCC_APB1ENR1_TIM5EN;
+    (void)RCC->APB1ENR1;  // the clock has to be on before the registers are written
+
+    TIMEBASE_TIM->CR1 = TIM_CR1_URS;  // only a wrap raises the update interrupt
+    TIMEBASE_TIM->ARR = 0xFFFFFFFFu;
+    epoch_us = 0;
+    restart();
+    TIMEBASE_TIM->DIER = TIM_DIER_UIE;
+
+    // Nothing waits on the wrap count (time_us() also checks the flag), so the lowest priority
+    NVIC_SetPriority(TIM5_IRQn, 15);
+    NVIC_EnableIRQ(TIM5_IRQn);
+
+    setup_done = 1;
+    TIMEBASE_TIM->CR1 |= TIM_CR1_CEN;
+}
+
+uint64_t time_us(void)
+{
+    if (!setup_done) {
+        return 0;
+    }
+
+    // The counter is read before the flag: a wrap after the read shows as a set flag
+    // with a counter near the top, which is not counted twice
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint32_t count = TIMEBASE_TIM->CNT;
+    uint32_t n = wraps;
+    if ((TIMEBASE_TIM->SR & TIM_SR_UIF) && count < 0x80000000u) {
+        n++;
+    }
+    const uint64_t now = epoch_us + ((uint64_t)n << 32) + count;
+    __set_PRIMASK(primask);
+    return now;
+}
+
+void TimeBase_Clock_Changed(void)
+{
+    if (!setup_done) {
+        return;
+    }
+
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint64_t now = time_us();
+    TIMEBASE_TIM->CR1 &= ~TIM_CR1_CEN;
+    epoch_us = now;
+    restart();
+    TIMEBASE_TIM->CR1 |= TIM_CR1_CEN;
+    __set_PRIMASK(primask);
+}
+
+void TimeBase_IRQHandler(void)
+{
+    if (TIMEBASE_TIM->SR & TIM_SR_UIF) {
+        TIMEBASE_TIM->SR = ~TIM_SR_UIF;
+        wraps++;
+    }
+}
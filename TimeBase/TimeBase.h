@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file TimeBase.h
+ * @brief Monotonic 64-bit microsecond clock on the 32-bit TIM5
+ *
+ * HAL_GetTick() counts milliseconds, too coarse to time frames, input latency
+ * or short beeps. TimeBase_Init() runs TIM5, one of the two 32-bit timers, at
+ * 1MHz from reset to the top of its range; its update interrupt counts the
+ * wraps (one every 71.6 minutes), and time_us() joins the count and the
+ * counter into microseconds since TimeBase_Init(). A 64-bit count never wraps.
+ *
+ * time_us() can be called from any context, interrupts included, and with
+ * interrupts masked: a wrap whose interrupt has not run yet is seen from the
+ * timer's update flag. It is a handful of register reads (under 0.5us at 80MHz).
+ *
+ * SysTick stays the HAL's millisecond tick (timeouts, HAL_Delay()) and the RTOS
+ * tick; this is a separate clock to read. It is set up at register level, so
+ * CubeMX does not need to know about TIM5.
+ *
+ * The clock stops in the Stop modes, like every APB timer, so it counts run
+ * and sleep time only.
+ *
+ * Example usage:
+ * @code
+ * TimeBase_Init();                       // after SystemClock_Config()
+ * uint64_t start = time_us();
+ * do_something();
+ * printf("%lu us\n", (unsigned long)(time_us() - start));
+ *
+ * // After a core clock change (ClockProfile_Set()):
+ * TimeBase_Clock_Changed();
+ *
+ * // In TIM5_IRQHandler():
+ * TimeBase_IRQHandler();
+ * @endcode
+ */
+
+/**
+ * @brief Start the clock at 0
+ *
+ * Works the TIM5 prescaler out from the current APB1 clock, which must be a
+ * whole number of MHz. Does nothing if the clock is already running.
+ */
+void TimeBase_Init(void);
+
+/**
+ * @brief Get the time since TimeBase_Init()
+ *
+ * @return Microseconds (0 before TimeBase_Init())
+ */
+uint64_t time_us(void);
+
+/**
+ * @brief Keep the clock at 1MHz after the core clock changed (e.g. ClockProfile_Set())
+ *
+ * Carries the time on and restarts the counter with the prescaler worked out for
+ * the new APB1 clock. Time between the clock change and this call is counted at
+ * the old rate, so call it straight after.
+ */
+void TimeBase_Clock_Changed(void);
+
+/**
+ * @brief TIM5 update interrupt handler (counts a wrap of the counter)
+ *
+ * Call from TIM5_IRQHandler().
+ */
+void TimeBase_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+#include "Trace.h"
+
+/**
+ * @file Trace.c
+ * @brief Implementation of the ITM event trace
+ *
+ * The TPIU is set to NRZ (UART-like) output with the formatter bypassed, so
+ * the SWO carries plain ITM packets; its prescaler divides the core clock
+ * down to the bit rate. The ITM's own timestamps stay off: the DWT cycle
+ * count inside each event is cheaper to send and survives dropped packets.
+ */
+
+#define ITM_UNLOCK_KEY 0xC5ACCE55u
+#define TPI_PROTOCOL_NRZ 2u
+
+volatile uint32_t trace_dropped = 0;
+static uint32_t trace_swo_hz = 0;
+
+// Prescaler for the bit rate at the current core clock (the TPIU runs on HCLK)
+static void set_swo_rate(void)
+{
+    uint32_t divider = (SystemCoreClock + trace_swo_hz / 2u) / trace_swo_hz;
+    TPI->ACPR = (divider > 0) ? divider - 1u : 0;
+}
+
+void Trace_Init(uint32_t swo_hz)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    trace_swo_hz = swo_hz;
+    if (swo_hz) {
+        // Asynchronous trace on PB3 (TRACESWO, its reset alternate function)
+        DBGMCU->CR = (DBGMCU->CR & ~DBGMCU_CR_TRACE_MODE_Msk) | DBGMCU_CR_TRACE_IOEN;
+        TPI->SPPR = TPI_PROTOCOL_NRZ;
+        set_swo_rate();
+        TPI->FFCR = TPI_FFCR_TrigIn_Msk;   // Formatter off: ITM packets go out as they are
+    }
+
+    ITM->LAR = ITM_UNLOCK_KEY;
+    ITM->TCR = 0;   // Settings only change with the ITM off
+    ITM->TPR = 0;   // Ports writable from unprivileged code too
+    ITM->TCR = (1u << ITM_TCR_TraceBusID_Pos) | ITM_TCR_SYNCENA_Msk | ITM_TCR_ITMENA_Msk;
+    ITM->TER |= ((1u << TRACE_PORT_COUNT) - 1u) & ~1u;   // Port 0 stays the debugger's choice
+
+    Trace_Event(TRACE_PORT_CLOCK, (uint8_t)(SystemCoreClock / 1000000u));
+}
+
+void Trace_Clock_Changed(void)
+{
+    if (trace_swo_hz) {
+        set_swo_rate();
+    }
+    Trace_Event(TRACE_PORT_CLOCK, (uint8_t)(SystemCoreClock / 1000000u));
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file Trace.h
+ * @brief Timestamped events on the ITM stimulus ports, out of the SWO pin
+ *
+ * Logging over the UART moves the timings it is trying to show: a printf
+ * costs tens of microseconds and the DMA drain competes for the bus. An ITM
+ * event is a single store to a stimulus port register; the core's trace
+ * hardware sends it out of the SWO pin (PB3, wired to the ST-LINK on the
+ * Nucleo) with no CPU time at all. Each kind of event has its own port, so
+ * the port number says what happened.
+ *
+ * An event is one 32-bit word: DWT->CYCCNT with its low 8 bits replaced by
+ * the event's argument. That is a 256-cycle (3.2us at 80MHz) timestamp that
+ * wraps every 54 seconds, which the decoder unwraps from the stream. If the
+ * port's FIFO is still full the event is dropped and counted in
+ * trace_dropped rather than waited for; with no debugger taking trace, the
+ * ports are disabled and an event costs a load and a compare.
+ *
+ * | Port | Event | Argument |
+ * |------|-------|----------|
+ * | 1 | TRACE_PORT_FRAME     | 0 render started, 1 frame handed to the LCD |
+ * | 2 | TRACE_PORT_UPDATE    | 0 physics step started, 1 finished |
+ * | 3 | TRACE_PORT_REFRESH   | 0 refresh started, 1 last rows sent |
+ * | 4 | TRACE_PORT_DMA       | 0 (an LCD DMA transfer finished) |
+ * | 5 | TRACE_PORT_COLLISION | TRACE_HIT_x |
+ * | 6 | TRACE_PORT_INPUT     | Joystick direction (0-8) when it changes; TRACE_INPUT_PRESS/RELEASE + button |
+ * | 7 | TRACE_PORT_CLOCK     | New core clock, MHz (timestamps count at this rate from here on) |
+ *
+ * Port 0 is left for ITM_SendChar() text. Trace/trace_decode.py turns a
+ * capture of the SWO stream (e.g. STM32CubeProgrammer's SWV, OpenOCD's
+ * "tpiu" output or orbuculum) into Chrome trace / Perfetto JSON.
+ *
+ * Example usage:
+ * @code
+ * Trace_Init(2000000);   // 2MHz SWO; 0 if the debugger sets up the SWO itself
+ *
+ * Trace_Event(TRACE_PORT_FRAME, 0);
+ * draw();
+ * Trace_Event(TRACE_PORT_FRAME, 1);
+ *
+ * // After a core clock change:
+ * Trace_Clock_Changed();
+ * @endcode
+ */
+
+/**
+ * @enum Trace_Port_t
+ * @brief Stimulus port of each kind of event (see the table above)
+ */
+typedef enum {
+    TRACE_PORT_FRAME = 1,
+    TRACE_PORT_UPDATE,
+    TRACE_PORT_REFRESH,
+    TRACE_PORT_DMA,
+    TRACE_PORT_COLLISION,
+    TRACE_PORT_INPUT,
+    TRACE_PORT_CLOCK,
+    TRACE_PORT_COUNT
+} Trace_Port_t;
+
+// TRACE_PORT_COLLISION arguments
+#define TRACE_HIT_WALL   0
+#define TRACE_HIT_PADDLE 1
+#define TRACE_HIT_BRICK  2
+
+// TRACE_PORT_INPUT arguments for the buttons, added to the button index
+#define TRACE_INPUT_PRESS   0x10
+#define TRACE_INPUT_RELEASE 0x20
+
+extern volatile uint32_t trace_dropped;   ///< Events lost to a full port FIFO
+
+/**
+ * @brief Send an event, or drop it if the port is busy
+ *
+ * Callable from interrupts too. One that sends an event between another
+ * event's FIFO check and its store can have that event lost.
+ *
+ * @param port Kind of event
+ * @param arg Argument, 0-255
+ */
+static inline void Trace_Event(Trace_Port_t port, uint8_t arg)
+{
+    if ((ITM->TCR & ITM_TCR_ITMENA_Msk) == 0 || (ITM->TER & (1u << port)) == 0) {
+        return;
+    }
+    if (ITM->PORT[port].u32 == 0) {
+        trace_dropped++;   // FIFO full: the SWO is behind
+        return;
+    }
+    ITM->PORT[port].u32 = (DWT->CYCCNT & ~0xFFu) | arg;
+}
+
+/**
+ * @brief Enable the ITM, the event ports and the cycle counter, and the SWO output
+ *
+ * @param swo_hz SWO bit rate (NRZ), 0 to leave the output to the debugger's own setup
+ *
+ * @note The debugger decides when trace is taken: it has to be set to the same bit rate.
+ */
+void Trace_Init(uint32_t swo_hz);
+
+/**
+ * @brief Reprogram the SWO bit rate for the new core clock, and send a TRACE_PORT_CLOCK event
+ *
+ * Call after every change of SystemCoreClock (ClockProfile_Set()).
+ */
+void Trace_Clock_Changed(void);
+
+#ifdef __cplusplus
+}
+#endif
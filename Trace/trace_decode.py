@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Decode a capture of the Pong ITM trace (see Trace.h) into Chrome trace JSON.
+
+The input is the raw SWO byte stream: ITM packets as the debugger received
+them, e.g. from STM32CubeProgrammer's SWV "save to file", OpenOCD's
+"tpiu create ... -output trace.bin" or orbuculum's raw output:
+
+    python3 trace_decode.py trace.bin > trace.json
+    python3 trace_decode.py --cpu-mhz 80 trace.bin -o trace.json
+
+Open the result in chrome://tracing or https://ui.perfetto.dev. Render,
+physics steps and LCD refreshes show as slices, DMA completions, collisions
+and input as instants, and the core clock as a counter.
+"""
+
+import argparse
+import json
+import sys
+
+PORT_FRAME, PORT_UPDATE, PORT_REFRESH, PORT_DMA, PORT_COLLISION, PORT_INPUT, PORT_CLOCK = range(1, 8)
+
+# Track (thread id) and slice name of the begin/end ports
+SLICES = {PORT_FRAME: (1, "render"), PORT_UPDATE: (2, "update"), PORT_REFRESH: (3, "refresh")}
+TRACKS = {1: "render", 2: "physics", 3: "LCD refresh", 4: "LCD DMA", 5: "input"}
+HITS = ("wall", "paddle", "brick")
+DIRECTIONS = ("centre", "N", "NE", "E", "SE", "S", "SW", "W", "NW")
+INPUT_PRESS, INPUT_RELEASE = 0x10, 0x20
+
+
+def itm_words(data, stats):
+    """Yield (port, value) of each 4-byte software source packet; count the rest in stats."""
+    i = 0
+    n = len(data)
+    while i < n:
+        header = data[i]
+        i += 1
+        if header == 0x00:
+            continue  # Synchronisation
+        if header & 0x03:
+            size = (1, 2, 4)[(header & 0x03) - 1]
+            payload = data[i:i + size]
+            i += size
+            if len(payload) < size:
+                break
+            if header & 0x04 or size != 4:
+                stats["other"] += 1  # Hardware source (DWT) or text on port 0
+                continue
+            yield header >> 3, int.from_bytes(payload, "little")
+            continue
+        if header == 0x70:
+            stats["overflows"] += 1
+            continue
+        # Timestamp or extension packet: continuation bytes while bit 7 is set
+        if header & 0x80:
+            while i < n and data[i] & 0x80:
+                i += 1
+            i += 1
+
+
+def decode(data, cpu_mhz, stats):
+    events = [{"ph": "M", "name": "process_name", "pid": 1, "args": {"name": "Pong"}}]
+    for tid, name in TRACKS.items():
+        events.append({"ph": "M", "name": "thread_name", "pid": 1, "tid": tid, "args": {"name": name}})
+
+    last_cycles = None
+    now_us = 0.0
+    for port, word in itm_words(data, stats):
+        cycles = word & ~0xFF
+        arg = word & 0xFF
+        if last_cycles is not None:
+            delta = (cycles - last_cycles) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                delta -= 0x100000000  # Slightly out of order (sent from an interrupt)
+            now_us += delta / cpu_mhz
+        last_cycles = cycles
+        ts = round(now_us, 2)
+
+        if port in SLICES:
+            tid, name = SLICES[port]
+            events.append({"ph": "B" if arg == 0 else "E", "name": name, "pid": 1, "tid": tid, "ts": ts})
+        elif port == PORT_DMA:
+            events.append({"ph": "i", "s": "t", "name": "dma done", "pid": 1, "tid": 4, "ts": ts})
+        elif port == PORT_COLLISION:
+            name = HITS[arg] if arg < len(HITS) else f"hit {arg}"
+            events.append({"ph": "i", "s": "t", "name": name, "pid": 1, "tid": 2, "ts": ts})
+        elif port == PORT_INPUT:
+            if arg >= INPUT_RELEASE:
+                name = f"button {arg - INPUT_RELEASE} up"
+            elif arg >= INPUT_PRESS:
+                name = f"button {arg - INPUT_PRESS} down"
+            else:
+                name = DIRECTIONS[arg] if arg < len(DIRECTIONS) else f"direction {arg}"
+            events.append({"ph": "i", "s": "t", "name": name, "pid": 1, "tid": 5, "ts": ts})
+        elif port == PORT_CLOCK and arg:
+            cpu_mhz = arg
+            events.append({"ph": "C", "name": "core clock MHz", "pid": 1, "ts": ts, "args": {"MHz": arg}})
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="SWO capture file, or - for stdin")
+    parser.add_argument("-o", "--output", help="JSON file to write (default stdout)")
+    parser.add_argument("--cpu-mhz", type=float, default=80.0,
+                        help="core clock until the first clock event (default 80)")
+    args = parser.parse_args()
+
+    data = sys.stdin.buffer.read() if args.input == "-" else open(args.input, "rb").read()
+    stats = {"overflows": 0, "other": 0}
+    events = decode(data, args.cpu_mhz, stats)
+    out = open(args.output, "w") if args.output else sys.stdout
+    json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, out)
+    print(f"events: {len(events)}, ITM overflows: {stats['overflows']}, other packets: {stats['other']}",
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
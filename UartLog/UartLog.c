@@ -0,0 +1,137 @@
+#include "UartLog.h"
+#include "stm32l4xx_hal.h"
+#include "DmaChannel.h"
+#include <string.h>
+
+/**
+ * @file UartLog.c
+ * @brief Implementation of the DMA-drained UART log
+ *
+ * Each transfer sends the contiguous bytes from tail up to head, or to the
+ * end of the ring if the data wraps (the rest goes in the next transfer).
+ */
+
+#if (UARTLOG_BUFFER_BYTES & (UARTLOG_BUFFER_BYTES - 1)) != 0
+#error "UARTLOG_BUFFER_BYTES must be a power of 2"
+#endif
+
+#define UARTLOG_MASK (UARTLOG_BUFFER_BYTES - 1u)
+
+void UartLog_Init(UartLog_cfg_t* cfg)
+{
+    if (cfg->setup_done) {
+        return;
+    }
+    if (DmaChannel_Claim(cfg->dma_channel, cfg->dma_request, cfg, "UartLog") != DMACHANNEL_OK) {
+        return;  // Not set up: writes are dropped
+    }
+
+    cfg->head = 0;
+    cfg->tail = 0;
+    cfg->sending = 0;
+    cfg->dropped = 0;
+
+    cfg->dma_channel->CCR = 0;
+    cfg->dma_channel->CPAR = (uint32_t)&cfg->huart->Instance->TDR;
+    SET_BIT(cfg->huart->Instance->CR3, USART_CR3_DMAT);
+
+    // Below the LCD's DMA (priority 1): a late log transfer costs nothing but time
+    NVIC_SetPriority(DmaChannel_IRQn(cfg->dma_channel), 3);
+    NVIC_EnableIRQ(DmaChannel_IRQn(cfg->dma_channel));
+
+    cfg->setup_done = 1;
+}
+
+int UartLog_Write(UartLog_cfg_t* cfg, const char* data, int len)
+{
+    if (len <= 0) {
+        return 0;
+    }
+    if (!cfg->setup_done) {
+        // Before Init (start-up messages): nothing to drain a ring, so send directly
+        HAL_UART_Transmit(cfg->huart, (uint8_t*)data, (uint16_t)len, HAL_MAX_DELAY);
+        return len;
+    }
+
+    uint32_t head = cfg->head;
+    if ((uint32_t)len > UARTLOG_BUFFER_BYTES - (head - cfg->tail)) {
+        cfg->dropped++;
+        return 0;
+    }
+
+    // Copy in up to two pieces around the end of the ring
+    uint32_t start = head & UARTLOG_MASK;
+    uint32_t first = UARTLOG_BUFFER_BYTES - start;
+    if (first > (uint32_t)len) {
+        first = (uint32_t)len;
+    }
+    memcpy(&cfg->buf[start], data, first);
+    memcpy(&cfg->buf[0], data + first, (uint32_t)len - first);
+
+    // The bytes must be in memory before the interrupt can see the new head
+    __DMB();
+    cfg->head = head + (uint32_t)len;
+    NVIC_SetPendingIRQ(DmaChannel_IRQn(cfg->dma_channel));
+    return len;
+}
+
+void UartLog_Flush(UartLog_cfg_t* cfg)
+{
+    if (!cfg->setup_done) {
+        return;
+    }
+    while (cfg->tail != cfg->head) {
+    }
+    // The DMA is done once the last byte is in the UART; wait for it to leave too
+    while (!__HAL_UART_GET_FLAG(cfg->huart, UART_FLAG_TC)) {
+    }
+}
+
+void UartLog_Clock_Changed(UartLog_cfg_t* cfg)
+{
+    UartLog_Flush(cfg);
+    __HAL_UART_DISABLE(cfg->huart);
+    UART_SetConfig(cfg->huart);  // BRR from the current clock, DMAT left as it is
+    __HAL_UART_ENABLE(cfg->huart);
+}
+
+uint32_t UartLog_Get_Dropped(UartLog_cfg_t* cfg)
+{
+    return cfg->dropped;
+}
+
+void UartLog_DMA_IRQHandler(UartLog_cfg_t* cfg)
+{
+    DMA_TypeDef* dma = DmaChannel_Controller(cfg->dma_channel);
+    uint32_t shift = DmaChannel_Flag_Shift(cfg->dma_channel);
+    DMA_Channel_TypeDef* channel = cfg->dma_channel;
+
+    if (dma->ISR & (DMA_ISR_TCIF1 << shift)) {
+        dma->IFCR = DMA_IFCR_CGIF1 << shift;
+        channel->CCR &= ~DMA_CCR_EN;
+        cfg->tail += cfg->sending;
+        cfg->sending = 0;
+    }
+
+    // Set pending by UartLog_Write() while a transfer is running: it waits its turn
+    if (cfg->sending != 0) {
+        return;
+    }
+
+    uint32_t tail = cfg->tail;
+    uint32_t queued = cfg->head - tail;
+    if (queued == 0) {
+        return;
+    }
+    uint32_t start = tail & UARTLOG_MASK;
+    uint32_t len = UARTLOG_BUFFER_BYTES - start;
+    if (len > queued) {
+        len = queued;
+    }
+
+    cfg->sending = len;
+    channel->CMAR = (uint32_t)&cfg->buf[start];
+    channel->CNDTR = len;
+    // 8-bit memory to peripheral, increment memory, interrupt when done
+    channel->CCR = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_TCIE | DMA_CCR_EN;
+}
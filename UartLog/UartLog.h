@@ -0,0 +1,131 @@
+#pragma once
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file UartLog.h
+ * @brief Non-blocking, DMA-drained UART logging for STM32L4
+ *
+ * Text written with UartLog_Write() (e.g. from _write(), so printf works) is
+ * copied into a ring buffer and sent by the UART's TX DMA in the background.
+ * A write never waits for the UART: if the message does not fit, the whole
+ * message is dropped and counted instead.
+ *
+ * The ring is single-producer, single-consumer, as in BuzzerSeq: only
+ * UartLog_Write() moves head and only the DMA interrupt moves tail. A write
+ * sets the DMA interrupt pending, and the handler starts the next transfer
+ * if the DMA is idle. Call UartLog_Write() from one context only.
+ *
+ * Example usage:
+ * @code
+ * UartLog_cfg_t uart_log = {
+ *     .huart = &huart2,
+ *     .dma_channel = DMA1_Channel7,   // USART2_TX
+ *     .dma_request = 2,
+ *     .setup_done = 0
+ * };
+ *
+ * UartLog_Init(&uart_log);
+ *
+ * int _write(int file, char *ptr, int len) {
+ *     UartLog_Write(&uart_log, ptr, len);
+ *     return len;
+ * }
+ *
+ * // In DMA1_Channel7_IRQHandler():
+ * UartLog_DMA_IRQHandler(&uart_log);
+ * @endcode
+ */
+
+/**
+ * @brief Ring buffer size in bytes (power of 2)
+ *
+ * At 115200 baud the UART drains about 11.5 bytes per ms, so this is how much
+ * can be written in a burst before messages start being dropped.
+ */
+#ifndef UARTLOG_BUFFER_BYTES
+#define UARTLOG_BUFFER_BYTES 1024
+#endif
+
+/**
+ * @struct UartLog_cfg_t
+ * @brief Configuration and ring buffer for a UART log
+ */
+typedef struct {
+    UART_HandleTypeDef* huart;          ///< UART to send on (e.g., &huart2), initialised by CubeMX
+    DMA_Channel_TypeDef* dma_channel;   ///< DMA channel of the UART's TX request (USART2_TX: DMA1_Channel7)
+    uint8_t dma_request;                ///< DMA request number for that channel (CSELR), 2 for USART2_TX
+    uint8_t setup_done;                 ///< Internal flag: 1 if initialized, 0 otherwise
+    char buf[UARTLOG_BUFFER_BYTES];     ///< Internal: ring buffer
+    volatile uint32_t head;             ///< Internal: bytes written (free-running), UartLog_Write() only
+    volatile uint32_t tail;             ///< Internal: bytes sent (free-running), interrupt only
+    volatile uint32_t sending;          ///< Internal: length of the transfer in flight, 0 when idle
+    uint32_t dropped;                   ///< Internal: messages dropped because the ring was full
+} UartLog_cfg_t;
+
+/**
+ * @brief Initialize the log and its TX DMA channel
+ *
+ * @param cfg Pointer to log configuration struct
+ *
+ * @note The UART must be initialized by CubeMX (MX_USARTx_UART_Init) first.
+ *       Until this is called, UartLog_Write() sends blocking.
+ */
+void UartLog_Init(UartLog_cfg_t* cfg);
+
+/**
+ * @brief Queue bytes for sending
+ *
+ * @param cfg Pointer to log configuration struct
+ * @param data Bytes to send
+ * @param len Number of bytes
+ * @return len if queued, 0 if the message was dropped (ring full)
+ */
+int UartLog_Write(UartLog_cfg_t* cfg, const char* data, int len);
+
+/**
+ * @brief Wait until everything queued has been sent
+ *
+ * For the few places where losing output matters more than time (dumps,
+ * fault reports).
+ *
+ * @param cfg Pointer to log configuration struct
+ */
+void UartLog_Flush(UartLog_cfg_t* cfg);
+
+/**
+ * @brief Keep the baud rate after the core clock changed (e.g. ClockProfile_Set())
+ *
+ * Works the baud rate register out again from the UART's new kernel clock. Call
+ * UartLog_Flush() before the clock changes, or whatever is sent across the switch
+ * comes out garbled (this flushes too, for what was written since).
+ *
+ * @param cfg Pointer to log configuration struct
+ */
+void UartLog_Clock_Changed(UartLog_cfg_t* cfg);
+
+/**
+ * @brief Get the number of messages dropped since UartLog_Init()
+ *
+ * @param cfg Pointer to log configuration struct
+ * @return Dropped message count
+ */
+uint32_t UartLog_Get_Dropped(UartLog_cfg_t* cfg);
+
+/**
+ * @brief TX DMA interrupt handler
+ *
+ * Call from the DMA channel's IRQ handler. Also runs when UartLog_Write()
+ * sets it pending, to start a transfer.
+ *
+ * @param cfg Pointer to log configuration struct
+ */
+void UartLog_DMA_IRQHandler(UartLog_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif